@@ -0,0 +1,183 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/AliasedMemoryAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/Memory.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace gpgmm {
+
+    AliasedMemoryAllocator::AliasedMemoryAllocator(
+        std::unique_ptr<MemoryAllocator> memoryAllocator,
+        uint64_t memoryAlignment)
+        : MemoryAllocator(std::move(memoryAllocator)), mMemoryAlignment(memoryAlignment) {
+    }
+
+    AliasedMemoryAllocator::~AliasedMemoryAllocator() {
+        ASSERT(mAliasedMemory.empty());
+    }
+
+    // static
+    uint64_t AliasedMemoryAllocator::PackRequests(
+        const std::vector<ALIASED_ALLOCATION_REQUEST>& requests,
+        std::vector<uint64_t>* offsetsOut) {
+        std::vector<uint64_t>& offsets = *offsetsOut;
+        offsets.assign(requests.size(), kInvalidOffset);
+
+        // Placing the largest requests first leaves the gaps between them for the smaller ones.
+        std::vector<size_t> requestOrder(requests.size());
+        std::iota(requestOrder.begin(), requestOrder.end(), 0);
+        std::stable_sort(requestOrder.begin(), requestOrder.end(), [&](size_t a, size_t b) {
+            return requests[a].Size > requests[b].Size;
+        });
+
+        uint64_t memorySize = 0;
+        std::vector<size_t> placedRequests;
+        std::vector<std::pair<uint64_t, uint64_t>> usedRanges;
+        for (size_t i : requestOrder) {
+            const ALIASED_ALLOCATION_REQUEST& request = requests[i];
+            const uint64_t alignment = std::max<uint64_t>(request.Alignment, 1);
+
+            // Only requests used at the same time conflict.
+            usedRanges.clear();
+            for (size_t j : placedRequests) {
+                if (requests[j].FirstUse <= request.LastUse &&
+                    request.FirstUse <= requests[j].LastUse) {
+                    usedRanges.push_back({offsets[j], offsets[j] + requests[j].Size});
+                }
+            }
+            std::sort(usedRanges.begin(), usedRanges.end());
+
+            // Use the first gap, from the lowest offset, large enough for the request.
+            uint64_t offset = 0;
+            for (const auto& usedRange : usedRanges) {
+                if (AlignTo(offset, alignment) + request.Size <= usedRange.first) {
+                    break;
+                }
+                offset = std::max(offset, usedRange.second);
+            }
+
+            offsets[i] = AlignTo(offset, alignment);
+            memorySize = std::max(memorySize, offsets[i] + request.Size);
+            placedRequests.push_back(i);
+        }
+
+        return memorySize;
+    }
+
+    std::vector<std::unique_ptr<MemoryAllocation>> AliasedMemoryAllocator::TryAllocateAliasedMemory(
+        const std::vector<ALIASED_ALLOCATION_REQUEST>& requests,
+        bool neverAllocate) {
+        TRACE_EVENT0(TraceEventCategory::Allocation,
+                     "AliasedMemoryAllocator.TryAllocateAliasedMemory");
+
+        uint64_t memoryAlignment = mMemoryAlignment;
+        for (const ALIASED_ALLOCATION_REQUEST& request : requests) {
+            if (request.Size == 0 || request.FirstUse > request.LastUse) {
+                return {};
+            }
+            memoryAlignment = std::max(memoryAlignment, request.Alignment);
+        }
+
+        if (requests.empty()) {
+            return {};
+        }
+
+        std::vector<uint64_t> offsets;
+        const uint64_t memorySize = PackRequests(requests, &offsets);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        MEMORY_ALLOCATION_REQUEST memoryRequest = {};
+        memoryRequest.Size = memorySize;
+        memoryRequest.Alignment = memoryAlignment;
+        memoryRequest.NeverAllocate = neverAllocate;
+
+        std::unique_ptr<MemoryAllocation> memoryAllocation =
+            GetFirstChild()->TryAllocateMemory(memoryRequest);
+        if (memoryAllocation == nullptr) {
+            DebugEvent("AliasedMemoryAllocator.TryAllocateAliasedMemory",
+                       ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Aliased memory could not be allocated (" << memorySize << " bytes).";
+            return {};
+        }
+
+        MemoryBase* memory = memoryAllocation->GetMemory();
+
+        std::vector<std::unique_ptr<MemoryAllocation>> subAllocations;
+        subAllocations.reserve(requests.size());
+        for (size_t i = 0; i < requests.size(); i++) {
+            memory->Ref();
+
+            mInfo.UsedBlockCount++;
+            mInfo.UsedBlockUsage += requests[i].Size;
+
+            subAllocations.push_back(std::make_unique<MemoryAllocation>(
+                this, memory, memoryAllocation->GetOffset() + offsets[i],
+                AllocationMethod::kSubAllocated,
+                mBlockPool.Acquire(MemoryBlock{offsets[i], requests[i].Size})));
+        }
+
+        mAliasedMemory.emplace(memory, std::move(memoryAllocation));
+
+        return subAllocations;
+    }
+
+    std::unique_ptr<MemoryAllocation> AliasedMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        GPGMM_CHECK_NONZERO(request.Size);
+
+        std::vector<std::unique_ptr<MemoryAllocation>> subAllocations = TryAllocateAliasedMemory(
+            {{request.Size, request.Alignment, 0, 0}}, request.NeverAllocate);
+        if (subAllocations.empty()) {
+            return {};
+        }
+        return std::move(subAllocations.front());
+    }
+
+    void AliasedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "AliasedMemoryAllocator.DeallocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mInfo.UsedBlockCount--;
+        mInfo.UsedBlockUsage -= subAllocation->GetSize();
+
+        mBlockPool.Release(subAllocation->GetBlock());
+
+        MemoryBase* memory = subAllocation->GetMemory();
+        if (memory->Unref()) {
+            auto it = mAliasedMemory.find(memory);
+            ASSERT(it != mAliasedMemory.end());
+            GetFirstChild()->DeallocateMemory(std::move(it->second));
+            mAliasedMemory.erase(it);
+        }
+    }
+
+    MEMORY_ALLOCATOR_INFO AliasedMemoryAllocator::QueryInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
+        result += GetFirstChild()->QueryInfo();
+        return result;
+    }
+
+}  // namespace gpgmm
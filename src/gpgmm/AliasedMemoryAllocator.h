@@ -0,0 +1,78 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_ALIASEDMEMORYALLOCATOR_H_
+#define GPGMM_ALIASEDMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace gpgmm {
+
+    // Request for an aliased allocation which is only used between |FirstUse| and |LastUse|,
+    // inclusively (ex. the first and last render pass to use it).
+    struct ALIASED_ALLOCATION_REQUEST {
+        uint64_t Size;
+        uint64_t Alignment;
+        uint64_t FirstUse;
+        uint64_t LastUse;
+    };
+
+    // AliasedMemoryAllocator packs a group of requests into a single memory, allowing requests
+    // whose lifetimes never overlap to share (or alias) the same range of memory. Requests are
+    // placed largest first at the lowest offset which does not overlap any already-placed request
+    // used at the same time, so the memory is typically only as large as the largest set of
+    // requests used at once.
+    //
+    // The memory is released once every allocation within it was deallocated.
+    class AliasedMemoryAllocator final : public MemoryAllocator {
+      public:
+        AliasedMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                               uint64_t memoryAlignment);
+        ~AliasedMemoryAllocator() override;
+
+        // Allocates every request from the same memory, where the allocation of each element
+        // corresponds to the request of the same index. Returns an empty vector if the memory
+        // could not be allocated.
+        std::vector<std::unique_ptr<MemoryAllocation>> TryAllocateAliasedMemory(
+            const std::vector<ALIASED_ALLOCATION_REQUEST>& requests,
+            bool neverAllocate);
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+        // Computes the offset of each request and returns the size of memory needed to contain
+        // them all.
+        static uint64_t PackRequests(const std::vector<ALIASED_ALLOCATION_REQUEST>& requests,
+                                     std::vector<uint64_t>* offsetsOut);
+
+      private:
+        const uint64_t mMemoryAlignment;
+
+        // Guarded by mMutex.
+        std::unordered_map<MemoryBase*, std::unique_ptr<MemoryAllocation>> mAliasedMemory;
+        ObjectPool<MemoryBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_ALIASEDMEMORYALLOCATOR_H_
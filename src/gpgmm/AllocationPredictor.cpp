@@ -0,0 +1,85 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/AllocationPredictor.h"
+
+#include "gpgmm/common/Assert.h"
+
+namespace gpgmm {
+
+    void AllocationPredictor::Record(uint64_t size) {
+        ASSERT(size != kInvalidSize);
+
+        const uint64_t lastSize = mLastSize;
+        mLastSize = size;
+
+        if (lastSize == kInvalidSize) {
+            return;
+        }
+
+        auto it = mSuccessors.find(lastSize);
+        if (it == mSuccessors.end()) {
+            if (mSuccessors.size() >= kMaxSizeCount) {
+                return;
+            }
+            it = mSuccessors.emplace(lastSize, SuccessorTable{}).first;
+        }
+
+        // Count the size, or replace the successor seen the least.
+        SuccessorTable& successors = it->second;
+        Successor* successor = &successors[0];
+        for (Successor& other : successors) {
+            if (other.Size == size) {
+                successor = &other;
+                break;
+            }
+            if (other.Count < successor->Count) {
+                successor = &other;
+            }
+        }
+
+        if (successor->Size != size) {
+            successor->Size = size;
+            successor->Count = 0;
+        }
+
+        if (++successor->Count >= kMaxSuccessorCount) {
+            for (Successor& other : successors) {
+                other.Count /= 2;
+            }
+        }
+    }
+
+    uint64_t AllocationPredictor::Predict() const {
+        const auto it = mSuccessors.find(mLastSize);
+        if (it == mSuccessors.end()) {
+            return kInvalidSize;
+        }
+
+        const Successor* predicted = nullptr;
+        for (const Successor& successor : it->second) {
+            if (successor.Count >= kMinPredictedCount &&
+                (predicted == nullptr || successor.Count > predicted->Count)) {
+                predicted = &successor;
+            }
+        }
+
+        return (predicted != nullptr) ? predicted->Size : kInvalidSize;
+    }
+
+    uint64_t AllocationPredictor::GetSizeCountForTesting() const {
+        return mSuccessors.size();
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,72 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_ALLOCATIONPREDICTOR_H_
+#define GPGMM_ALLOCATIONPREDICTOR_H_
+
+#include "gpgmm/common/Limits.h"
+#include "gpgmm/common/NonCopyable.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace gpgmm {
+
+    // AllocationPredictor learns which allocation size follows which, as a first-order Markov
+    // chain, so memory for the allocation predicted to come next can be created ahead of time.
+    // Apps which repeat the same sequence of allocations (ex. loading a level) are predicted
+    // after seeing the sequence once. Each size only remembers the few sizes which followed it
+    // most often, and counts are halved once saturated so a changing sequence is re-learned.
+    // Not thread-safe, callers must synchronize.
+    class AllocationPredictor final : public NonCopyable {
+      public:
+        AllocationPredictor() = default;
+
+        // Records an allocation of |size|, which followed the size last recorded.
+        void Record(uint64_t size);
+
+        // Returns the size predicted to follow the size last recorded, or kInvalidSize when
+        // no size followed it enough times to be predicted.
+        uint64_t Predict() const;
+
+        // Number of sizes which followed another size recorded. Exposed for testing.
+        uint64_t GetSizeCountForTesting() const;
+
+      private:
+        struct Successor {
+            uint64_t Size = kInvalidSize;
+            uint32_t Count = 0;
+        };
+
+        // Sizes which followed a size, which need not be sorted by count.
+        using SuccessorTable = std::array<Successor, 4>;
+
+        // Times a size must have followed another to be predicted.
+        static constexpr uint32_t kMinPredictedCount = 2;
+
+        // Count which, once reached by a successor, halves the count of every successor.
+        static constexpr uint32_t kMaxSuccessorCount = 64;
+
+        // Most sizes learned, beyond which sizes never seen before are not learned.
+        static constexpr size_t kMaxSizeCount = 1024;
+
+        std::unordered_map<uint64_t, SuccessorTable> mSuccessors;
+        uint64_t mLastSize = kInvalidSize;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_ALLOCATIONPREDICTOR_H_
@@ -0,0 +1,206 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/BinaryEventTrace.h"
+
+#include "gpgmm/EventTraceWriter.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/PlatformUtils.h"
+
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+
+namespace gpgmm {
+
+    namespace {
+
+        template <typename T>
+        void WriteValue(std::ostream* stream, const T& value) {
+            stream->write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        bool ReadValue(std::istream& stream, T* value) {
+            stream.read(reinterpret_cast<char*>(value), sizeof(T));
+            return static_cast<size_t>(stream.gcount()) == sizeof(T);
+        }
+
+    }  // namespace
+
+    // BinaryEventTraceEncoder
+
+    BinaryEventTraceEncoder::BinaryEventTraceEncoder(std::ostream* stream) : mStream(stream) {
+        ASSERT(mStream != nullptr);
+
+        BINARY_EVENT_TRACE_HEADER header = {};
+        std::memcpy(header.Magic, kBinaryEventTraceMagic, sizeof(header.Magic));
+        header.Version = kBinaryEventTraceVersion;
+        header.PID = GetPID();
+        WriteValue(mStream, header);
+    }
+
+    void BinaryEventTraceEncoder::AddEvent(char phase,
+                                           TraceEventCategory category,
+                                           const char* name,
+                                           uint64_t id,
+                                           uint32_t tid,
+                                           uint64_t timestampInMicroseconds,
+                                           uint32_t flags,
+                                           const std::string& args) {
+        BINARY_EVENT_TRACE_RECORD record = {};
+        record.ID = id;
+        record.TimestampInMicroseconds = timestampInMicroseconds;
+        record.NameIndex = InternString(name);
+        record.ArgsIndex = (args.empty()) ? 0 : InternString(args);
+        record.TID = tid;
+        record.Flags = flags;
+        record.Phase = static_cast<uint8_t>(phase);
+        record.Category = static_cast<uint8_t>(category);
+        mPendingRecords.push_back(record);
+    }
+
+    void BinaryEventTraceEncoder::Flush() {
+        if (!mPendingStrings.empty()) {
+            WriteValue(mStream,
+                       BINARY_EVENT_TRACE_CHUNK_HEADER{
+                           BINARY_EVENT_TRACE_CHUNK_TYPE_STRINGS,
+                           static_cast<uint32_t>(mPendingStrings.size())});
+            for (const std::string* str : mPendingStrings) {
+                WriteValue(mStream, static_cast<uint32_t>(str->size()));
+                mStream->write(str->data(), str->size());
+            }
+            mPendingStrings.clear();
+        }
+
+        if (!mPendingRecords.empty()) {
+            WriteValue(mStream, BINARY_EVENT_TRACE_CHUNK_HEADER{
+                                    BINARY_EVENT_TRACE_CHUNK_TYPE_EVENTS,
+                                    static_cast<uint32_t>(mPendingRecords.size())});
+            mStream->write(reinterpret_cast<const char*>(mPendingRecords.data()),
+                           mPendingRecords.size() * sizeof(BINARY_EVENT_TRACE_RECORD));
+            mPendingRecords.clear();
+        }
+
+        mStream->flush();
+    }
+
+    uint32_t BinaryEventTraceEncoder::InternString(const std::string& str) {
+        auto it = mStringIndices.find(str);
+        if (it != mStringIndices.end()) {
+            return it->second;
+        }
+
+        // Element references are never invalidated by inserting into the map.
+        const uint32_t index = static_cast<uint32_t>(mStringIndices.size()) + 1;
+        it = mStringIndices.emplace(str, index).first;
+        mPendingStrings.push_back(&it->first);
+        return index;
+    }
+
+    bool ConvertBinaryEventTraceToJSON(std::istream& binaryTrace, std::ostream& jsonTrace) {
+        BINARY_EVENT_TRACE_HEADER header = {};
+        if (!ReadValue(binaryTrace, &header) ||
+            std::memcmp(header.Magic, kBinaryEventTraceMagic, sizeof(header.Magic)) != 0 ||
+            header.Version != kBinaryEventTraceVersion) {
+            return false;
+        }
+
+        // Zero refers to no string.
+        std::vector<std::string> strings = {""};
+
+        // Written the same as JSONDict and JSONArray would, but one event at a time.
+        jsonTrace << "{ \"traceEvents\": [ ";
+        bool hasEvent = false;
+
+        // Re-used by every event so converting does not allocate per event.
+        JSONWriter eventWriter;
+
+        BINARY_EVENT_TRACE_CHUNK_HEADER chunk = {};
+        while (ReadValue(binaryTrace, &chunk)) {
+            switch (chunk.Type) {
+                case BINARY_EVENT_TRACE_CHUNK_TYPE_STRINGS: {
+                    for (uint32_t i = 0; i < chunk.Count; i++) {
+                        uint32_t size = 0;
+                        if (!ReadValue(binaryTrace, &size)) {
+                            return false;
+                        }
+                        std::string str(size, '\0');
+                        binaryTrace.read(&str[0], size);
+                        if (static_cast<uint32_t>(binaryTrace.gcount()) != size) {
+                            return false;
+                        }
+                        strings.push_back(std::move(str));
+                    }
+                    break;
+                }
+
+                case BINARY_EVENT_TRACE_CHUNK_TYPE_EVENTS: {
+                    for (uint32_t i = 0; i < chunk.Count; i++) {
+                        BINARY_EVENT_TRACE_RECORD record = {};
+                        if (!ReadValue(binaryTrace, &record)) {
+                            return false;
+                        }
+
+                        if (record.NameIndex == 0 || record.NameIndex >= strings.size() ||
+                            record.ArgsIndex >= strings.size() ||
+                            record.Category >= kTraceEventCategoryCount) {
+                            return false;
+                        }
+
+                        eventWriter.Reset();
+                        eventWriter.BeginDict();
+                        EventTraceWriter::SerializeEvent(
+                            &eventWriter, static_cast<char>(record.Phase),
+                            static_cast<TraceEventCategory>(record.Category),
+                            strings[record.NameIndex].c_str(), record.ID, record.TID,
+                            record.TimestampInMicroseconds, record.Flags, header.PID,
+                            strings[record.ArgsIndex]);
+                        eventWriter.EndDict();
+
+                        if (hasEvent) {
+                            jsonTrace << ", ";
+                        }
+                        jsonTrace << eventWriter.GetBuffer();
+                        hasEvent = true;
+                    }
+                    break;
+                }
+
+                default:
+                    return false;
+            }
+        }
+
+        jsonTrace << " ] }";
+        return true;
+    }
+
+    bool ConvertBinaryEventTraceFileToJSON(const std::string& binaryTraceFile,
+                                           const std::string& jsonTraceFile) {
+        std::ifstream binaryTrace(binaryTraceFile, std::ios::binary);
+        if (!binaryTrace.is_open()) {
+            return false;
+        }
+
+        std::ofstream jsonTrace(jsonTraceFile);
+        if (!jsonTrace.is_open()) {
+            return false;
+        }
+
+        return ConvertBinaryEventTraceToJSON(binaryTrace, jsonTrace);
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,114 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_BINARYEVENTTRACE_H_
+#define GPGMM_BINARYEVENTTRACE_H_
+
+#include "gpgmm/TraceEvent.h"
+#include "include/gpgmm_export.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gpgmm {
+
+    // Binary trace file format.
+    //
+    // A file header is followed by any number of chunks, each of which is a chunk header then
+    // |Count| strings or event records. Strings are numbered, starting from one, in the order
+    // they appear in the file and are only written once, before the first event to refer to them,
+    // so every chunk can be written as soon as it is full. Values use the byte order of the
+    // machine which recorded the trace.
+    static constexpr char kBinaryEventTraceMagic[8] = {'G', 'P', 'G', 'M', 'M', 'T', 'R', 'C'};
+    static constexpr uint32_t kBinaryEventTraceVersion = 1;
+
+    struct BINARY_EVENT_TRACE_HEADER {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t PID;
+    };
+
+    enum BINARY_EVENT_TRACE_CHUNK_TYPE : uint32_t {
+        // Each string is its size, as a uint32_t, followed by its characters.
+        BINARY_EVENT_TRACE_CHUNK_TYPE_STRINGS = 0x1,
+
+        // Each event is a BINARY_EVENT_TRACE_RECORD.
+        BINARY_EVENT_TRACE_CHUNK_TYPE_EVENTS = 0x2,
+    };
+
+    struct BINARY_EVENT_TRACE_CHUNK_HEADER {
+        BINARY_EVENT_TRACE_CHUNK_TYPE Type;
+        uint32_t Count;
+    };
+
+    // Fixed-size record of a trace event. Names and args refer to strings by number, where zero
+    // means none.
+    struct BINARY_EVENT_TRACE_RECORD {
+        uint64_t ID;
+        uint64_t TimestampInMicroseconds;
+        uint32_t NameIndex;
+        uint32_t ArgsIndex;
+        uint32_t TID;
+        uint32_t Flags;
+        uint8_t Phase;
+        uint8_t Category;
+        uint16_t Reserved0;
+        uint32_t Reserved1;
+    };
+
+    static_assert(sizeof(BINARY_EVENT_TRACE_RECORD) == 40,
+                  "Binary trace records must not change size.");
+
+    // Encodes trace events to a stream using the binary trace format. Strings are interned, so
+    // repeated names and args are only written once per stream.
+    class BinaryEventTraceEncoder {
+      public:
+        explicit BinaryEventTraceEncoder(std::ostream* stream);
+
+        // Adds an event to the pending chunk. |args| is the JSON encoded args, or empty if none.
+        void AddEvent(char phase,
+                      TraceEventCategory category,
+                      const char* name,
+                      uint64_t id,
+                      uint32_t tid,
+                      uint64_t timestampInMicroseconds,
+                      uint32_t flags,
+                      const std::string& args);
+
+        // Writes the pending chunk, and the strings it refers to, to the stream.
+        void Flush();
+
+      private:
+        uint32_t InternString(const std::string& str);
+
+        std::ostream* mStream;
+
+        std::unordered_map<std::string, uint32_t> mStringIndices;
+        std::vector<const std::string*> mPendingStrings;
+        std::vector<BINARY_EVENT_TRACE_RECORD> mPendingRecords;
+    };
+
+    // Converts a binary trace to the JSON trace event format, which can be viewed with
+    // chrome://tracing. Returns false if the binary trace is malformed.
+    bool ConvertBinaryEventTraceToJSON(std::istream& binaryTrace, std::ostream& jsonTrace);
+
+    GPGMM_EXPORT bool ConvertBinaryEventTraceFileToJSON(const std::string& binaryTraceFile,
+                                                        const std::string& jsonTraceFile);
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_BINARYEVENTTRACE_H_
@@ -0,0 +1,202 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/BitmapSlabBlockAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+
+namespace gpgmm {
+
+    namespace {
+
+        constexpr uint64_t kBitsPerWord = 64;
+
+    }  // namespace
+
+    BitmapSlabBlockAllocator::BitmapSlabBlockAllocator(uint64_t blockCount, uint64_t blockSize)
+        : mBlockCount(blockCount),
+          mBlockSize(blockSize),
+          mFreeBitmap((blockCount + kBitsPerWord - 1) / kBitsPerWord, ~uint64_t(0)) {
+        ASSERT(mBlockCount > 0);
+
+        // Blocks past the end of the slab are never free.
+        const uint64_t remainingBlocks = mBlockCount % kBitsPerWord;
+        if (remainingBlocks != 0) {
+            mFreeBitmap.back() = (uint64_t(1) << remainingBlocks) - 1;
+        }
+    }
+
+    MemoryBlock* BitmapSlabBlockAllocator::TryAllocateBlock(uint64_t size, uint64_t alignment) {
+        GPGMM_CHECK_NONZERO(size);
+
+        const uint64_t blockCount = (size + mBlockSize - 1) / mBlockSize;
+        if (blockCount > mBlockCount) {
+            DebugEvent("BitmapSlabBlockAllocator.TryAllocateBlock",
+                       ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Allocation size exceeded the slab size. (" << size << " vs "
+                << mBlockCount * mBlockSize << " bytes).";
+            return nullptr;
+        }
+
+        // Offset must be equal to a multiple of |mBlockSize|.
+        if (!IsAligned(mBlockSize, alignment)) {
+            DebugEvent("BitmapSlabBlockAllocator.TryAllocateBlock",
+                       ALLOCATOR_MESSAGE_ID_ALIGNMENT_MISMATCH)
+                << "Allocation alignment is not a multiple of the block size. (" << alignment
+                << " vs " << mBlockSize << " bytes).";
+            return nullptr;
+        }
+
+        const uint64_t blockIndex =
+            (blockCount == 1) ? FindFreeBlock() : FindFreeBlocks(blockCount);
+        if (blockIndex == kInvalidIndex) {
+            return nullptr;
+        }
+
+        MarkBlocks(blockIndex, blockCount, /*isFree*/ false);
+
+        MemoryBlock* block = mBlockPool.Acquire();
+        block->Offset = blockIndex * mBlockSize;
+        block->Size = blockCount * mBlockSize;
+        return block;
+    }
+
+    void BitmapSlabBlockAllocator::DeallocateBlock(MemoryBlock* block) {
+        ASSERT(block != nullptr);
+        ASSERT(block->Offset % mBlockSize == 0);
+        ASSERT(block->Size % mBlockSize == 0);
+
+        MarkBlocks(block->Offset / mBlockSize, block->Size / mBlockSize, /*isFree*/ true);
+        mBlockPool.Release(block);
+    }
+
+    // Contiguous free blocks can be allocated together, so the largest free block is the longest
+    // run of free blocks.
+    uint64_t BitmapSlabBlockAllocator::GetLargestFreeBlockSize() const {
+        uint64_t longestRun = 0;
+        uint64_t run = 0;
+        for (uint64_t blockIndex = 0; blockIndex < mBlockCount; blockIndex++) {
+            const uint64_t word = mFreeBitmap[blockIndex / kBitsPerWord];
+            if (word & (uint64_t(1) << (blockIndex % kBitsPerWord))) {
+                longestRun = std::max(longestRun, ++run);
+            } else {
+                run = 0;
+            }
+        }
+        return longestRun * mBlockSize;
+    }
+
+    uint64_t BitmapSlabBlockAllocator::GetFreeBlockCountForTesting() const {
+        uint64_t count = 0;
+        for (uint64_t word : mFreeBitmap) {
+            for (; word != 0; word &= word - 1) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    uint64_t BitmapSlabBlockAllocator::FindFreeBlock() const {
+        for (uint64_t wordIndex = mFirstFreeWordIndex; wordIndex < mFreeBitmap.size();
+             wordIndex++) {
+            const uint64_t word = mFreeBitmap[wordIndex];
+            if (word != 0) {
+                return wordIndex * kBitsPerWord + ScanForward(word);
+            }
+        }
+        return kInvalidIndex;
+    }
+
+    uint64_t BitmapSlabBlockAllocator::FindFreeBlocks(uint64_t blockCount) const {
+        uint64_t blockIndex = mFirstFreeWordIndex * kBitsPerWord;
+        while (blockIndex + blockCount <= mBlockCount) {
+            // Skip to the next free block.
+            const uint64_t freeBits =
+                mFreeBitmap[blockIndex / kBitsPerWord] >> (blockIndex % kBitsPerWord);
+            if (freeBits == 0) {
+                blockIndex = (blockIndex / kBitsPerWord + 1) * kBitsPerWord;
+                continue;
+            }
+
+            blockIndex += ScanForward(freeBits);
+            if (blockIndex + blockCount > mBlockCount) {
+                break;
+            }
+
+            // Find where the run of free blocks ends, which is either the next used block or
+            // just past the end of the range being requested.
+            uint64_t endBlockIndex = blockIndex;
+            while (endBlockIndex < blockIndex + blockCount) {
+                const uint64_t usedBits =
+                    ~mFreeBitmap[endBlockIndex / kBitsPerWord] >> (endBlockIndex % kBitsPerWord);
+                if (usedBits == 0) {
+                    endBlockIndex = (endBlockIndex / kBitsPerWord + 1) * kBitsPerWord;
+                    continue;
+                }
+                endBlockIndex += ScanForward(usedBits);
+                break;
+            }
+
+            if (endBlockIndex >= blockIndex + blockCount) {
+                return blockIndex;
+            }
+
+            blockIndex = endBlockIndex;
+        }
+
+        return kInvalidIndex;
+    }
+
+    void BitmapSlabBlockAllocator::MarkBlocks(uint64_t blockIndex,
+                                              uint64_t blockCount,
+                                              bool isFree) {
+        ASSERT(blockIndex + blockCount <= mBlockCount);
+
+        uint64_t endBlockIndex = blockIndex + blockCount;
+        while (blockIndex < endBlockIndex) {
+            const uint64_t bitIndex = blockIndex % kBitsPerWord;
+            const uint64_t bitCount = std::min(kBitsPerWord - bitIndex, endBlockIndex - blockIndex);
+            const uint64_t mask =
+                ((bitCount == kBitsPerWord) ? ~uint64_t(0) : ((uint64_t(1) << bitCount) - 1))
+                << bitIndex;
+
+            uint64_t& word = mFreeBitmap[blockIndex / kBitsPerWord];
+            if (isFree) {
+                ASSERT((word & mask) == 0);
+                word |= mask;
+            } else {
+                ASSERT((word & mask) == mask);
+                word &= ~mask;
+            }
+
+            blockIndex += bitCount;
+        }
+
+        if (isFree) {
+            mFirstFreeWordIndex =
+                std::min(mFirstFreeWordIndex, (endBlockIndex - blockCount) / kBitsPerWord);
+        } else {
+            while (mFirstFreeWordIndex < mFreeBitmap.size() &&
+                   mFreeBitmap[mFirstFreeWordIndex] == 0) {
+                mFirstFreeWordIndex++;
+            }
+        }
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,61 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_BITMAPSLABBLOCKALLOCATOR_H_
+#define GPGMM_BITMAPSLABBLOCKALLOCATOR_H_
+
+#include "gpgmm/BlockAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <vector>
+
+namespace gpgmm {
+
+    // BitmapSlabBlockAllocator is a slab block allocator which tracks free blocks using a packed
+    // bitmap, one bit per block, instead of a linked free-list. Free blocks are found by scanning
+    // a 64-bit word at a time, which avoids pointer-chasing for slabs with many small blocks.
+    // Unlike SlabBlockAllocator, a request larger than the block size is satisfied by allocating
+    // enough contiguous blocks to fit it.
+    class BitmapSlabBlockAllocator final : public BlockAllocator {
+      public:
+        BitmapSlabBlockAllocator(uint64_t blockCount, uint64_t blockSize);
+        ~BitmapSlabBlockAllocator() override = default;
+
+        // BlockAllocator interface
+        MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment = 1) override;
+        void DeallocateBlock(MemoryBlock* block) override;
+        uint64_t GetLargestFreeBlockSize() const override;
+
+        uint64_t GetFreeBlockCountForTesting() const;
+
+      private:
+        uint64_t FindFreeBlock() const;
+        uint64_t FindFreeBlocks(uint64_t blockCount) const;
+        void MarkBlocks(uint64_t blockIndex, uint64_t blockCount, bool isFree);
+
+        const uint64_t mBlockCount;
+        const uint64_t mBlockSize;
+
+        // Each set bit is a free block.
+        std::vector<uint64_t> mFreeBitmap;
+
+        // Words before this index have no free blocks.
+        uint64_t mFirstFreeWordIndex = 0;
+
+        ObjectPool<MemoryBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_BITMAPSLABBLOCKALLOCATOR_H_
@@ -23,6 +23,9 @@ namespace gpgmm {
     struct MemoryBlock {
         uint64_t Offset = kInvalidOffset;
         uint64_t Size = kInvalidSize;
+
+        // Size originally requested for the block, when tracked by the memory allocator.
+        uint64_t RequestedSize = 0;
     };
 
     // Allocates a sub-range [offset, offset + size) in usually a byte-addressable range.
@@ -32,6 +35,16 @@ namespace gpgmm {
 
         virtual MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment) = 0;
         virtual void DeallocateBlock(MemoryBlock* block) = 0;
+
+        // Attempts to grow |block| to at-least |size| bytes in place, without moving its offset,
+        // by taking the free space which follows it. Returns the block which now covers the range,
+        // which replaces |block| should it differ, or nullptr if |block| is left unchanged.
+        virtual MemoryBlock* TryExtendBlock(MemoryBlock* block, uint64_t size) {
+            return (size <= block->Size) ? block : nullptr;
+        }
+
+        // Returns the size of the largest block which is free, or zero if none are.
+        virtual uint64_t GetLargestFreeBlockSize() const = 0;
     };
 
 }  // namespace gpgmm
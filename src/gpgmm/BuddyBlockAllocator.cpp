@@ -19,21 +19,24 @@
 #include "gpgmm/Error.h"
 #include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Math.h"
-#include "gpgmm/common/Utils.h"
+
+#include <algorithm>
 
 namespace gpgmm {
 
-    BuddyBlockAllocator::BuddyBlockAllocator(uint64_t maxBlockSize) : mMaxBlockSize(maxBlockSize) {
+    BuddyBlockAllocator::BuddyBlockAllocator(uint64_t maxBlockSize,
+                                             uint64_t maxFreeBlockCountPerLevel)
+        : mMaxBlockSize(maxBlockSize), mMaxFreeBlockCountPerLevel(maxFreeBlockCountPerLevel) {
         ASSERT(IsPowerOfTwo(maxBlockSize));
 
         mFreeLists.resize(Log2(mMaxBlockSize) + 1);
 
         // Insert the level0 free block.
-        mRoot = new BuddyBlock{};
+        mRoot = mBlockPool.Acquire();
         mRoot->Size = maxBlockSize;
         mRoot->Offset = 0;
 
-        mFreeLists[0] = {mRoot};
+        mFreeLists[0] = {mRoot, 1};
     }
 
     BuddyBlockAllocator::~BuddyBlockAllocator() {
@@ -43,10 +46,57 @@ namespace gpgmm {
         }
     }
 
+    uint64_t BuddyBlockAllocator::GetLargestFreeBlockSize() const {
+        // Deferred buddies are counted as merged, since they would be merged before failing a
+        // request for the merged size.
+        if (mMaxFreeBlockCountPerLevel > 0) {
+            bool isFree = false;
+            return ComputeLargestMergedFreeBlockSize(mRoot, &isFree);
+        }
+
+        // Lower levels have larger blocks.
+        for (size_t level = 0; level < mFreeLists.size(); level++) {
+            if (mFreeLists[level].head != nullptr) {
+                return mMaxBlockSize >> level;
+            }
+        }
+        return 0;
+    }
+
     uint64_t BuddyBlockAllocator::ComputeTotalNumOfFreeBlocksForTesting() const {
         return ComputeNumOfFreeBlocks(mRoot);
     }
 
+    uint64_t BuddyBlockAllocator::GetSplitCountForTesting() const {
+        return mSplitCount;
+    }
+
+    uint64_t BuddyBlockAllocator::GetMergeCountForTesting() const {
+        return mMergeCount;
+    }
+
+    uint64_t BuddyBlockAllocator::ComputeLargestMergedFreeBlockSize(const BuddyBlock* block,
+                                                                    bool* isFreeOut) const {
+        *isFreeOut = false;
+        if (block->mState == BlockState::Free) {
+            *isFreeOut = true;
+            return block->Size;
+        } else if (block->mState == BlockState::Split) {
+            bool isLeftFree = false;
+            bool isRightFree = false;
+            const uint64_t leftSize =
+                ComputeLargestMergedFreeBlockSize(block->split.pLeft, &isLeftFree);
+            const uint64_t rightSize =
+                ComputeLargestMergedFreeBlockSize(block->split.pLeft->pBuddy, &isRightFree);
+            if (isLeftFree && isRightFree) {
+                *isFreeOut = true;
+                return block->Size;
+            }
+            return std::max(leftSize, rightSize);
+        }
+        return 0;
+    }
+
     uint64_t BuddyBlockAllocator::ComputeNumOfFreeBlocks(BuddyBlock* block) const {
         if (block->mState == BlockState::Free) {
             return 1;
@@ -119,6 +169,7 @@ namespace gpgmm {
         }
 
         mFreeLists[level].head = block;
+        mFreeLists[level].count++;
     }
 
     void BuddyBlockAllocator::RemoveFreeBlock(BuddyBlock* block, size_t level) {
@@ -142,6 +193,9 @@ namespace gpgmm {
                 pNext->free.pPrev = pPrev;
             }
         }
+
+        ASSERT(mFreeLists[level].count > 0);
+        mFreeLists[level].count--;
     }
 
     MemoryBlock* BuddyBlockAllocator::TryAllocateBlock(uint64_t size, uint64_t alignment) {
@@ -160,6 +214,12 @@ namespace gpgmm {
 
         uint64_t currBlockLevel = GetNextFreeAlignedBlock(sizeToLevel, alignment);
 
+        // Deferred buddies could merge into a block large enough.
+        if (currBlockLevel == kInvalidOffset && mMaxFreeBlockCountPerLevel > 0 &&
+            MergeAllFreeBlocks()) {
+            currBlockLevel = GetNextFreeAlignedBlock(sizeToLevel, alignment);
+        }
+
         // Error when no free blocks exist (allocator is full)
         if (currBlockLevel == kInvalidOffset) {
             DebugEvent("BuddyBlockAllocator.TryAllocateBlock",
@@ -181,11 +241,11 @@ namespace gpgmm {
 
             // Create two free child blocks (the buddies).
             const uint64_t nextLevelSize = currBlock->Size / 2;
-            BuddyBlock* leftChildBlock = new BuddyBlock{};
+            BuddyBlock* leftChildBlock = mBlockPool.Acquire();
             leftChildBlock->Size = nextLevelSize;
             leftChildBlock->Offset = currBlock->Offset;
 
-            BuddyBlock* rightChildBlock = new BuddyBlock{};
+            BuddyBlock* rightChildBlock = mBlockPool.Acquire();
             rightChildBlock->Size = nextLevelSize;
             rightChildBlock->Offset = currBlock->Offset + nextLevelSize;
 
@@ -206,6 +266,7 @@ namespace gpgmm {
             // Curr block is now split.
             currBlock->mState = BlockState::Split;
             currBlock->split.pLeft = leftChildBlock;
+            mSplitCount++;
 
             // Decend down into the next level.
             currBlock = leftChildBlock;
@@ -225,11 +286,64 @@ namespace gpgmm {
 
         ASSERT(curr->mState == BlockState::Allocated);
 
-        size_t currBlockLevel = ComputeLevelFromBlockSize(curr->Size);
+        const size_t currBlockLevel = ComputeLevelFromBlockSize(curr->Size);
 
         // Mark curr free so we can merge.
         curr->mState = BlockState::Free;
 
+        // Levels with enough free blocks already merge right away.
+        if (mFreeLists[currBlockLevel].count >= mMaxFreeBlockCountPerLevel) {
+            MergeFreeBlock(curr, currBlockLevel);
+        } else {
+            InsertFreeBlock(curr, currBlockLevel);
+        }
+
+        // Invalidate to ensure it cannot be deallocated again.
+        block = {};
+    }
+
+    // A block only grows by merging with its buddy, so it must be the left child, level by level,
+    // of parents whose right child is free. The merged parent replaces the block.
+    MemoryBlock* BuddyBlockAllocator::TryExtendBlock(MemoryBlock* block, uint64_t size) {
+        ASSERT(block != nullptr);
+
+        BuddyBlock* curr = static_cast<BuddyBlock*>(block);
+        ASSERT(curr->mState == BlockState::Allocated);
+
+        if (size > mMaxBlockSize) {
+            return nullptr;
+        }
+
+        for (const BuddyBlock* mergedBlock = curr; mergedBlock->Size < size;
+             mergedBlock = mergedBlock->pParent) {
+            if (mergedBlock->pParent == nullptr ||
+                mergedBlock->pParent->split.pLeft != mergedBlock ||
+                mergedBlock->pBuddy->mState != BlockState::Free) {
+                return nullptr;
+            }
+        }
+
+        size_t currBlockLevel = ComputeLevelFromBlockSize(curr->Size);
+        while (curr->Size < size) {
+            RemoveFreeBlock(curr->pBuddy, currBlockLevel);
+
+            BuddyBlock* parent = curr->pParent;
+            DeleteBlock(curr->pBuddy);
+            DeleteBlock(curr);
+
+            parent->mState = BlockState::Allocated;
+
+            curr = parent;
+            currBlockLevel--;
+            mMergeCount++;
+        }
+
+        return curr;
+    }
+
+    void BuddyBlockAllocator::MergeFreeBlock(BuddyBlock* curr, size_t currBlockLevel) {
+        ASSERT(curr->mState == BlockState::Free);
+
         // Merge the buddies (LevelN-to-Level0).
         while (currBlockLevel > 0 && curr->pBuddy->mState == BlockState::Free) {
             // Remove the buddy.
@@ -248,12 +362,38 @@ namespace gpgmm {
             // Ascend up to the next level (parent block).
             curr = parent;
             currBlockLevel--;
+            mMergeCount++;
         }
 
         InsertFreeBlock(curr, currBlockLevel);
+    }
 
-        // Invalidate to ensure it cannot be deallocated again.
-        block = {};
+    void BuddyBlockAllocator::MergeFreeBlocksOfLevel(size_t level) {
+        if (level == 0) {
+            return;
+        }
+
+        BuddyBlock* curr = mFreeLists[level].head;
+        while (curr != nullptr) {
+            BuddyBlock* next = curr->free.pNext;
+            if (curr->pBuddy->mState == BlockState::Free) {
+                // The buddy leaves the free-list along with curr.
+                if (next == curr->pBuddy) {
+                    next = next->free.pNext;
+                }
+                RemoveFreeBlock(curr, level);
+                MergeFreeBlock(curr, level);
+            }
+            curr = next;
+        }
+    }
+
+    bool BuddyBlockAllocator::MergeAllFreeBlocks() {
+        const uint64_t mergeCount = mMergeCount;
+        for (size_t level = mFreeLists.size() - 1; level > 0; level--) {
+            MergeFreeBlocksOfLevel(level);
+        }
+        return mMergeCount > mergeCount;
     }
 
     // Helper which deletes a block in the tree recursively (post-order).
@@ -265,7 +405,7 @@ namespace gpgmm {
             DeleteBlock(block->split.pLeft->pBuddy);
             DeleteBlock(block->split.pLeft);
         }
-        SafeDelete(block);
+        mBlockPool.Release(block);
     }
 
 }  // namespace gpgmm
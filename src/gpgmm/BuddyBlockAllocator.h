@@ -18,6 +18,7 @@
 
 #include "gpgmm/BlockAllocator.h"
 #include "gpgmm/common/Limits.h"
+#include "gpgmm/common/ObjectPool.h"
 
 #include <cstddef>
 #include <cstdint>
@@ -36,17 +37,28 @@ namespace gpgmm {
     // the size of the block to be used to satisfy the request. The first level (index=0) represents
     // the root whose size is also called the max block size.
     //
+    // By default, a de-allocated block is merged with its buddy right away, level by level. When
+    // |maxFreeBlockCountPerLevel| is non-zero, merging is deferred instead: de-allocated blocks
+    // stay on the free-list of their level, so allocating and de-allocating the same size re-uses
+    // them without splitting and merging each time. De-allocated blocks are only merged right away
+    // once their level has |maxFreeBlockCountPerLevel| free blocks, and every deferred buddy is
+    // merged when a request cannot be satisfied otherwise.
+    //
     class BuddyBlockAllocator : public BlockAllocator {
       public:
-        explicit BuddyBlockAllocator(uint64_t maxBlockSize);
+        explicit BuddyBlockAllocator(uint64_t maxBlockSize, uint64_t maxFreeBlockCountPerLevel = 0);
         ~BuddyBlockAllocator() override;
 
         // BlockAllocator interface
         MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment) override;
         void DeallocateBlock(MemoryBlock* block) override;
+        MemoryBlock* TryExtendBlock(MemoryBlock* block, uint64_t size) override;
+        uint64_t GetLargestFreeBlockSize() const override;
 
         // For testing purposes only.
         uint64_t ComputeTotalNumOfFreeBlocksForTesting() const;
+        uint64_t GetSplitCountForTesting() const;
+        uint64_t GetMergeCountForTesting() const;
 
       private:
         uint32_t ComputeLevelFromBlockSize(uint64_t blockSize) const;
@@ -91,17 +103,40 @@ namespace gpgmm {
         void RemoveFreeBlock(BuddyBlock* block, size_t level);
         void DeleteBlock(BuddyBlock* block);
 
+        // Merges the free |block|, which is not in a free-list, with its buddies (LevelN-to-Level0)
+        // then inserts the merged block into the free-list of its level.
+        void MergeFreeBlock(BuddyBlock* block, size_t level);
+
+        // Merges every free block of |level| whose buddy is also free.
+        void MergeFreeBlocksOfLevel(size_t level);
+
+        // Merges every free block whose buddy is also free, deepest level first so merged blocks
+        // are merged again. Returns false if nothing was merged.
+        bool MergeAllFreeBlocks();
+
         uint64_t ComputeNumOfFreeBlocks(BuddyBlock* block) const;
 
+        // Returns the size of the largest block which would be free once merged. Sets
+        // |isFreeOut| if every block within |block| is free.
+        uint64_t ComputeLargestMergedFreeBlockSize(const BuddyBlock* block, bool* isFreeOut) const;
+
         // Keep track the head and tail (for faster insertion/removal).
         struct BlockList {
             BuddyBlock* head = nullptr;  // First free block in level.
+            uint64_t count = 0;          // Number of free blocks in level.
             // TODO(crbug.com/dawn/827): Track the tail.
         };
 
         BuddyBlock* mRoot = nullptr;  // Used to deallocate non-free blocks.
 
+        // Recycles blocks created by splitting so splits and merges do not call into the heap.
+        ObjectPool<BuddyBlock> mBlockPool;
+
         uint64_t mMaxBlockSize = 0;
+        uint64_t mMaxFreeBlockCountPerLevel = 0;
+
+        uint64_t mSplitCount = 0;
+        uint64_t mMergeCount = 0;
 
         // List of linked-lists of free blocks where the index is a level that
         // corresponds to a power-of-two sized block.
@@ -15,24 +15,43 @@
 
 #include "gpgmm/BuddyMemoryAllocator.h"
 
+#include "gpgmm/BuddyBlockAllocator.h"
 #include "gpgmm/Debug.h"
+#include "gpgmm/FlatBuddyBlockAllocator.h"
 #include "gpgmm/Memory.h"
 #include "gpgmm/common/Math.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace gpgmm {
 
+    // Largest number of minimum sized blocks per memory to use a FlatBuddyBlockAllocator for.
+    // Each memory then needs at-most 8KB to track its blocks.
+    constexpr static uint64_t kMaxFlatBuddyBlockCount = 1u << 12;
+
+    // Free blocks of each level whose merge is deferred, so re-allocating the same size does not
+    // split and merge each time.
+    constexpr static uint64_t kMaxDeferredFreeBlockCountPerLevel = 4;
+
+    // Largest number of blocks within evicted memory to skip over before using one of them
+    // anyway.
+    constexpr static uint32_t kMaxEvictedMemoryToSkip = 4;
+
     BuddyMemoryAllocator::BuddyMemoryAllocator(uint64_t systemSize,
                                                uint64_t memorySize,
                                                uint64_t memoryAlignment,
-                                               std::unique_ptr<MemoryAllocator> memoryAllocator)
+                                               std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                               uint64_t minBlockSize)
         : MemoryAllocator(std::move(memoryAllocator)),
           mMemorySize(memorySize),
           mMemoryAlignment(memoryAlignment),
-          mBuddyBlockAllocator(systemSize),
-          mUsedPool(mMemorySize) {
+          mMinBlockSize(minBlockSize),
+          mMaxRegionCount(systemSize / memorySize) {
         ASSERT(mMemorySize <= systemSize);
         ASSERT(IsPowerOfTwo(mMemorySize));
         ASSERT(IsAligned(systemSize, mMemorySize));
+        ASSERT(minBlockSize == 0 || IsPowerOfTwo(minBlockSize));
     }
 
     uint64_t BuddyMemoryAllocator::GetMemoryIndex(uint64_t offset) const {
@@ -40,99 +59,344 @@ namespace gpgmm {
         return offset / mMemorySize;
     }
 
-    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateMemory(uint64_t size,
-                                                                              uint64_t alignment,
-                                                                              bool neverAllocate,
-                                                                              bool cacheSize,
-                                                                              bool prefetchMemory) {
-        std::lock_guard<std::mutex> lock(mMutex);
-
-        GPGMM_CHECK_NONZERO(size);
-        TRACE_EVENT0(TraceEventCategory::Default, "BuddyMemoryAllocator.TryAllocateMemory");
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        GPGMM_CHECK_NONZERO(request.Size);
+        TRACE_EVENT0(TraceEventCategory::Buddy, "BuddyMemoryAllocator.TryAllocateMemory");
 
         // Check the unaligned size to avoid overflowing NextPowerOfTwo.
-        if (size > mMemorySize) {
+        if (request.Size > mMemorySize) {
             DebugEvent("BuddyMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
-                << "Allocation size exceeded the memory size (" + std::to_string(size) + " vs " +
-                       std::to_string(mMemorySize) + " bytes).";
+                << "Allocation size exceeded the memory size (" << request.Size << " vs "
+                << mMemorySize << " bytes).";
             return {};
         }
 
         // Round allocation size to nearest power-of-two.
-        const uint64_t allocationSize = NextPowerOfTwo(size);
+        const uint64_t allocationSize = NextPowerOfTwo(request.Size);
 
         // Allocation cannot exceed the memory size.
         if (allocationSize > mMemorySize) {
             DebugEvent("BuddyMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
-                << "Aligned allocation size exceeded the memory size (" +
-                       std::to_string(allocationSize) + " vs " + std::to_string(mMemorySize) +
-                       " bytes).";
+                << "Aligned allocation size exceeded the memory size (" << allocationSize << " vs "
+                << mMemorySize << " bytes).";
 
             return {};
         }
 
-        // Attempt to sub-allocate a block of the requested size.
         std::unique_ptr<MemoryAllocation> subAllocation;
-        GPGMM_TRY_ASSIGN(TrySubAllocateMemory(
-                             &mBuddyBlockAllocator, allocationSize, alignment,
-                             [&](const auto& block) -> MemoryBase* {
-                                 const uint64_t memoryIndex = GetMemoryIndex(block->Offset);
-                                 std::unique_ptr<MemoryAllocation> memoryAllocation =
-                                     mUsedPool.AcquireFromPool(memoryIndex);
-
-                                 // No existing, allocate new memory for the block.
-                                 if (memoryAllocation == nullptr) {
-                                     GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(
-                                                          mMemorySize, mMemoryAlignment,
-                                                          neverAllocate, cacheSize, prefetchMemory),
-                                                      memoryAllocation);
-                                 }
-
-                                 MemoryBase* memory = memoryAllocation->GetMemory();
-                                 mUsedPool.ReturnToPool(std::move(memoryAllocation), memoryIndex);
-
-                                 return memory;
-                             }),
-                         subAllocation);
-
-        MemoryBlock* block = subAllocation->GetBlock();
+        GPGMM_TRY_ASSIGN(TryAllocateFromAnyRegion(allocationSize, request), subAllocation);
+
+        // The block was rounded-up, so remember the size requested to know how much is wasted.
+        subAllocation->GetBlock()->RequestedSize = request.Size;
+        mRequestedBlockUsage += request.Size;
+
+        return subAllocation;
+    }
+
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateFromAnyRegion(
+        uint64_t size,
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        // Attempt to sub-allocate a block within existing memory without waiting on regions
+        // locked by other threads, before waiting on them.
+        std::vector<uint64_t> evictedRegionIndices;
+        bool skippedLockedRegion = false;
+        std::unique_ptr<MemoryAllocation> subAllocation =
+            TryAllocateFromResidentRegion(size, request.Alignment, /*waitOnLockedRegions*/ false,
+                                          &evictedRegionIndices, &skippedLockedRegion);
+        if (subAllocation == nullptr && skippedLockedRegion) {
+            evictedRegionIndices.clear();
+            subAllocation = TryAllocateFromResidentRegion(
+                size, request.Alignment, /*waitOnLockedRegions*/ true, &evictedRegionIndices,
+                &skippedLockedRegion);
+        }
+
+        if (subAllocation != nullptr) {
+            return subAllocation;
+        }
+
+        // Re-use evicted memory rather than create more once enough of it was skipped over.
+        if (evictedRegionIndices.size() >= kMaxEvictedMemoryToSkip) {
+            subAllocation =
+                TryAllocateFromEvictedRegion(size, request.Alignment, evictedRegionIndices);
+            if (subAllocation != nullptr) {
+                return subAllocation;
+            }
+        }
+
+        // No existing, allocate new memory for the block.
+        subAllocation = TryAllocateFromNewRegion(size, request);
+        if (subAllocation != nullptr) {
+            return subAllocation;
+        }
+
+        return TryAllocateFromEvictedRegion(size, request.Alignment, evictedRegionIndices);
+    }
+
+    BuddyMemoryAllocator::MemoryRegion* BuddyMemoryAllocator::GetRegion(
+        uint64_t regionIndex) const {
+        std::shared_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+        ASSERT(regionIndex < mRegions.size());
+        return mRegions[regionIndex].get();
+    }
+
+    // Requires |region| to be locked and have memory.
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateFromRegion(
+        MemoryRegion* region,
+        uint64_t regionIndex,
+        uint64_t size,
+        uint64_t alignment) {
+        ASSERT(region->Memory != nullptr);
+
+        MemoryBlock* regionBlock = region->Allocator->TryAllocateBlock(size, alignment);
+        if (regionBlock == nullptr) {
+            return {};
+        }
+
+        BuddyBlock* block = region->BlockPool.Acquire();
+        block->Offset = regionIndex * mMemorySize + regionBlock->Offset;
+        block->Size = regionBlock->Size;
+        block->pRegionBlock = regionBlock;
+
+        MemoryBase* memory = region->Memory->GetMemory();
+        ASSERT(memory != nullptr);
+        memory->Ref();
+
         mInfo.UsedBlockCount++;
         mInfo.UsedBlockUsage += block->Size;
 
+        mLastRegionIndex.store(regionIndex, std::memory_order_relaxed);
+
         // Memory allocation offset is always memory-relative.
-        const uint64_t memoryOffset = block->Offset % mMemorySize;
+        return std::make_unique<MemoryAllocation>(/*allocator*/ this, memory,
+                                                  regionBlock->Offset,
+                                                  AllocationMethod::kSubAllocated, block);
+    }
+
+    // Tries the region last sub-allocated from, then every other region in order. Blocks within
+    // memory which is still resident are used before blocks within memory which was evicted,
+    // since re-using evicted memory requires it be made resident again before it can be used.
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateFromResidentRegion(
+        uint64_t size,
+        uint64_t alignment,
+        bool waitOnLockedRegions,
+        std::vector<uint64_t>* evictedRegionIndicesOut,
+        bool* skippedLockedRegionOut) {
+        std::shared_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+
+        const uint64_t regionCount = mRegions.size();
+        const uint64_t lastRegionIndex = mLastRegionIndex.load(std::memory_order_relaxed);
+        for (uint64_t i = 0; i < regionCount; i++) {
+            const uint64_t regionIndex =
+                (i == 0) ? lastRegionIndex : ((i <= lastRegionIndex) ? i - 1 : i);
+            MemoryRegion* region = mRegions[regionIndex].get();
+
+            std::unique_lock<std::mutex> regionLock(region->Mutex, std::defer_lock);
+            if (waitOnLockedRegions) {
+                regionLock.lock();
+            } else if (!regionLock.try_lock()) {
+                *skippedLockedRegionOut = true;
+                continue;
+            }
+
+            if (region->Memory == nullptr) {
+                continue;
+            }
+
+            if (region->Memory->GetMemory()->IsEvicted()) {
+                evictedRegionIndicesOut->push_back(regionIndex);
+                continue;
+            }
+
+            std::unique_ptr<MemoryAllocation> subAllocation =
+                TryAllocateFromRegion(region, regionIndex, size, alignment);
+            if (subAllocation != nullptr) {
+                return subAllocation;
+            }
+        }
 
-        return std::make_unique<MemoryAllocation>(/*allocator*/ this, subAllocation->GetMemory(),
-                                                  memoryOffset, AllocationMethod::kSubAllocated,
-                                                  block);
+        return {};
     }
 
-    void BuddyMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
-        std::lock_guard<std::mutex> lock(mMutex);
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateFromEvictedRegion(
+        uint64_t size,
+        uint64_t alignment,
+        const std::vector<uint64_t>& evictedRegionIndices) {
+        for (uint64_t regionIndex : evictedRegionIndices) {
+            MemoryRegion* region = GetRegion(regionIndex);
+            std::lock_guard<std::mutex> regionLock(region->Mutex);
+
+            // Memory could have been released since the region was skipped.
+            if (region->Memory == nullptr) {
+                continue;
+            }
+
+            std::unique_ptr<MemoryAllocation> subAllocation =
+                TryAllocateFromRegion(region, regionIndex, size, alignment);
+            if (subAllocation != nullptr) {
+                mInfo.EvictedMemoryReuseCount++;
+                return subAllocation;
+            }
+        }
+
+        return {};
+    }
+
+    // Memory is created without holding any lock, so only the calling thread waits on it.
+    std::unique_ptr<MemoryAllocation> BuddyMemoryAllocator::TryAllocateFromNewRegion(
+        uint64_t size,
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        // Memory is never smaller than the memory size, so the request is left for dedicated
+        // memory instead.
+        if (request.MemorySizeLimit > 0 && mMemorySize > request.MemorySizeLimit) {
+            DebugEvent("BuddyMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Memory size exceeded the memory size limit (" << mMemorySize << " vs "
+                << request.MemorySizeLimit << " bytes).";
+            return {};
+        }
+
+        uint64_t regionIndex = 0;
+        if (!TryReserveRegion(&regionIndex)) {
+            return {};
+        }
+
+        MEMORY_ALLOCATION_REQUEST memoryRequest = request;
+        memoryRequest.Size = mMemorySize;
+        memoryRequest.Alignment = mMemoryAlignment;
+
+        std::unique_ptr<MemoryAllocation> memoryAllocation =
+            GetFirstChild()->TryAllocateMemory(memoryRequest);
+
+        MemoryRegion* region = GetRegion(regionIndex);
+        std::lock_guard<std::mutex> regionLock(region->Mutex);
+        region->IsMemoryPending = false;
 
-        TRACE_EVENT0(TraceEventCategory::Default, "BuddyMemoryAllocator.DeallocateMemory");
+        if (memoryAllocation == nullptr) {
+            return {};
+        }
+
+        region->Memory = std::move(memoryAllocation);
+
+        std::unique_ptr<MemoryAllocation> subAllocation =
+            TryAllocateFromRegion(region, regionIndex, size, request.Alignment);
+        if (subAllocation == nullptr) {
+            GetFirstChild()->DeallocateMemory(std::move(region->Memory));
+        }
+
+        return subAllocation;
+    }
+
+    // Reserves the first region without memory, or adds one, so no other thread creates memory
+    // for the same region.
+    bool BuddyMemoryAllocator::TryReserveRegion(uint64_t* regionIndexOut) {
+        {
+            std::shared_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+            for (uint64_t regionIndex = 0; regionIndex < mRegions.size(); regionIndex++) {
+                MemoryRegion* region = mRegions[regionIndex].get();
+                std::lock_guard<std::mutex> regionLock(region->Mutex);
+                if (region->Memory == nullptr && !region->IsMemoryPending) {
+                    region->IsMemoryPending = true;
+                    *regionIndexOut = regionIndex;
+                    return true;
+                }
+            }
+        }
+
+        std::unique_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+        if (mRegions.size() >= mMaxRegionCount) {
+            DebugEvent("BuddyMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Allocator has reached capacity";
+            return false;
+        }
+
+        std::unique_ptr<MemoryRegion> region = std::make_unique<MemoryRegion>();
+
+        // Blocks never exceed the memory size, so each region is its own buddy system.
+        if (mMinBlockSize != 0 && mMinBlockSize <= mMemorySize &&
+            mMemorySize / mMinBlockSize <= kMaxFlatBuddyBlockCount) {
+            region->Allocator =
+                std::make_unique<FlatBuddyBlockAllocator>(mMemorySize, mMemorySize, mMinBlockSize);
+        } else {
+            region->Allocator = std::make_unique<BuddyBlockAllocator>(
+                mMemorySize, kMaxDeferredFreeBlockCountPerLevel);
+        }
+
+        region->IsMemoryPending = true;
+
+        *regionIndexOut = mRegions.size();
+        mRegions.push_back(std::move(region));
+        return true;
+    }
+
+    void BuddyMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Buddy, "BuddyMemoryAllocator.DeallocateMemory");
 
         ASSERT(subAllocation != nullptr);
 
+        BuddyBlock* block = static_cast<BuddyBlock*>(subAllocation->GetBlock());
+
         mInfo.UsedBlockCount--;
         mInfo.UsedBlockUsage -= subAllocation->GetSize();
+        mRequestedBlockUsage -= block->RequestedSize;
 
-        const uint64_t memoryIndex = GetMemoryIndex(subAllocation->GetBlock()->Offset);
+        MemoryRegion* region = GetRegion(GetMemoryIndex(block->Offset));
 
-        mBuddyBlockAllocator.DeallocateBlock(subAllocation->GetBlock());
+        std::unique_ptr<MemoryAllocation> memoryAllocation;
+        {
+            std::lock_guard<std::mutex> regionLock(region->Mutex);
+            region->Allocator->DeallocateBlock(block->pRegionBlock);
+            region->BlockPool.Release(block);
 
-        std::unique_ptr<MemoryAllocation> memoryAllocation = mUsedPool.AcquireFromPool(memoryIndex);
+            MemoryBase* memory = region->Memory->GetMemory();
+            ASSERT(memory == subAllocation->GetMemory());
 
-        MemoryBase* memory = memoryAllocation->GetMemory();
-        ASSERT(memory != nullptr);
+            if (memory->Unref()) {
+                memoryAllocation = std::move(region->Memory);
+            }
+        }
 
-        if (memory->Unref()) {
+        // Released without holding the region lock, which could be re-used meanwhile.
+        if (memoryAllocation != nullptr) {
             GetFirstChild()->DeallocateMemory(std::move(memoryAllocation));
-        } else {
-            mUsedPool.ReturnToPool(std::move(memoryAllocation), memoryIndex);
         }
     }
 
+    bool BuddyMemoryAllocator::TryExtendMemory(MemoryAllocation* subAllocation, uint64_t size) {
+        TRACE_EVENT0(TraceEventCategory::Buddy, "BuddyMemoryAllocator.TryExtendMemory");
+
+        ASSERT(subAllocation != nullptr);
+
+        BuddyBlock* block = static_cast<BuddyBlock*>(subAllocation->GetBlock());
+
+        // Blocks never cross regions, so a block cannot grow beyond its memory.
+        if (size > mMemorySize) {
+            return false;
+        }
+
+        MemoryRegion* region = GetRegion(GetMemoryIndex(block->Offset));
+        {
+            std::lock_guard<std::mutex> regionLock(region->Mutex);
+            MemoryBlock* regionBlock =
+                region->Allocator->TryExtendBlock(block->pRegionBlock, NextPowerOfTwo(size));
+            if (regionBlock == nullptr) {
+                return false;
+            }
+
+            mInfo.UsedBlockUsage += regionBlock->Size - block->Size;
+
+            block->pRegionBlock = regionBlock;
+            block->Size = regionBlock->Size;
+        }
+
+        if (size > block->RequestedSize) {
+            mRequestedBlockUsage += size - block->RequestedSize;
+            block->RequestedSize = size;
+        }
+
+        return true;
+    }
+
     uint64_t BuddyMemoryAllocator::GetMemorySize() const {
         return mMemorySize;
     }
@@ -142,20 +406,58 @@ namespace gpgmm {
     }
 
     MEMORY_ALLOCATOR_INFO BuddyMemoryAllocator::QueryInfo() const {
-        std::lock_guard<std::mutex> lock(mMutex);
-
-        MEMORY_ALLOCATOR_INFO result = mInfo;
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
         const MEMORY_ALLOCATOR_INFO& memoryInfo = GetFirstChild()->QueryInfo();
         result.UsedMemoryCount = memoryInfo.UsedMemoryCount;
         result.UsedMemoryUsage = memoryInfo.UsedMemoryUsage;
         result.FreeMemoryUsage = memoryInfo.FreeMemoryUsage;
+        result.EvictedMemoryReuseCount += memoryInfo.EvictedMemoryReuseCount;
+        result.RetainedMemoryReuseCount += memoryInfo.RetainedMemoryReuseCount;
+        result.PrefetchedMemoryReuseCount += memoryInfo.PrefetchedMemoryReuseCount;
+        result.PrefetchedMemoryWaitCount += memoryInfo.PrefetchedMemoryWaitCount;
+        result.PooledMemoryHitCount += memoryInfo.PooledMemoryHitCount;
+        result.PooledMemoryMissCount += memoryInfo.PooledMemoryMissCount;
+        result.BestFitWastedUsage += memoryInfo.BestFitWastedUsage;
         return result;
     }
 
-    uint64_t BuddyMemoryAllocator::GetBuddyMemorySizeForTesting() const {
-        std::lock_guard<std::mutex> lock(mMutex);
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO BuddyMemoryAllocator::QueryFragmentationInfo() const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+
+        uint64_t memoryUsage = 0;
+        {
+            std::shared_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+            for (const auto& region : mRegions) {
+                std::lock_guard<std::mutex> regionLock(region->Mutex);
+                if (region->Memory == nullptr) {
+                    continue;
+                }
+                memoryUsage += mMemorySize;
+                result.LargestFreeBlockSize = std::max(result.LargestFreeBlockSize,
+                                                       region->Allocator->GetLargestFreeBlockSize());
+            }
+        }
 
-        return mUsedPool.GetPoolSize();
+        // Counters could be updated by other threads after the regions were visited.
+        const uint64_t usedBlockUsage = mInfo.UsedBlockUsage.Load();
+        const uint64_t requestedBlockUsage = mRequestedBlockUsage.Load();
+        result.FreeBlockUsage = (memoryUsage > usedBlockUsage) ? memoryUsage - usedBlockUsage : 0;
+        result.InternalFragmentationUsage =
+            (usedBlockUsage > requestedBlockUsage) ? usedBlockUsage - requestedBlockUsage : 0;
+        return result;
+    }
+
+    uint64_t BuddyMemoryAllocator::GetBuddyMemorySizeForTesting() const {
+        std::shared_lock<std::shared_timed_mutex> regionsLock(mRegionsMutex);
+
+        uint64_t count = 0;
+        for (const auto& region : mRegions) {
+            std::lock_guard<std::mutex> regionLock(region->Mutex);
+            if (region->Memory != nullptr) {
+                count++;
+            }
+        }
+        return count;
     }
 
 }  // namespace gpgmm
@@ -16,11 +16,15 @@
 #ifndef GPGMM_BUDDYMEMORYALLOCATOR_H_
 #define GPGMM_BUDDYMEMORYALLOCATOR_H_
 
-#include "gpgmm/BuddyBlockAllocator.h"
-#include "gpgmm/IndexedMemoryPool.h"
+#include "gpgmm/BlockAllocator.h"
 #include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 namespace gpgmm {
 
@@ -31,41 +35,97 @@ namespace gpgmm {
     // Upon sub-allocating, the offset gets mapped to device memory by computing the corresponding
     // memory index and should the memory not exist, it is created. If two sub-allocations share the
     // same memory index, the memory refcount is incremented to ensure de-allocating one doesn't
-    // release the other prematurely.
+    // release the other prematurely. Blocks within memory which is still resident are used before
+    // blocks within memory which was evicted.
     //
     // The MemoryAllocator should return ResourceHeaps that are all compatible with each other.
     // It should also outlive all the resources that are in the buddy allocator.
+    //
+    // When |minBlockSize| is specified, blocks are never smaller than it. Should each memory then
+    // have few enough blocks, a FlatBuddyBlockAllocator is used instead of a BuddyBlockAllocator
+    // so splitting and merging blocks never allocates.
+    //
+    // Since blocks never exceed the memory size, the buddy system is split into regions of
+    // |memorySize|, one per memory index, which are locked independently. Threads skip over
+    // regions locked by another thread and memory is created without holding any lock, so
+    // sub-allocating from one memory never waits on another being created.
     class BuddyMemoryAllocator final : public MemoryAllocator {
       public:
         BuddyMemoryAllocator(uint64_t systemSize,
                              uint64_t memorySize,
                              uint64_t memoryAlignment,
-                             std::unique_ptr<MemoryAllocator> memoryAllocator);
+                             std::unique_ptr<MemoryAllocator> memoryAllocator,
+                             uint64_t minBlockSize = 0);
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+        bool TryExtendMemory(MemoryAllocation* subAllocation, uint64_t size) override;
 
         uint64_t GetMemorySize() const override;
         uint64_t GetMemoryAlignment() const override;
         MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
 
         uint64_t GetBuddyMemorySizeForTesting() const;
 
       private:
+        // Block of the buddy system, which refers to the block of the region it is within. Unlike
+        // the region block, the offset is relative to the entire buddy system.
+        struct BuddyBlock : public MemoryBlock {
+            MemoryBlock* pRegionBlock = nullptr;
+        };
+
+        // Part of the buddy system backed by a single memory. Guarded by |Mutex|.
+        struct MemoryRegion {
+            std::mutex Mutex;
+            std::unique_ptr<BlockAllocator> Allocator;
+            ObjectPool<BuddyBlock> BlockPool;
+
+            // Memory containing at-least one sub-allocation, or null.
+            std::unique_ptr<MemoryAllocation> Memory;
+
+            // Set while memory is created for the region, so no other thread creates it too.
+            bool IsMemoryPending = false;
+        };
+
         uint64_t GetMemoryIndex(uint64_t offset) const;
 
+        MemoryRegion* GetRegion(uint64_t regionIndex) const;
+        std::unique_ptr<MemoryAllocation> TryAllocateFromAnyRegion(
+            uint64_t size,
+            const MEMORY_ALLOCATION_REQUEST& request);
+        std::unique_ptr<MemoryAllocation> TryAllocateFromRegion(MemoryRegion* region,
+                                                                uint64_t regionIndex,
+                                                                uint64_t size,
+                                                                uint64_t alignment);
+        std::unique_ptr<MemoryAllocation> TryAllocateFromResidentRegion(
+            uint64_t size,
+            uint64_t alignment,
+            bool waitOnLockedRegions,
+            std::vector<uint64_t>* evictedRegionIndicesOut,
+            bool* skippedLockedRegionOut);
+        std::unique_ptr<MemoryAllocation> TryAllocateFromEvictedRegion(
+            uint64_t size,
+            uint64_t alignment,
+            const std::vector<uint64_t>& evictedRegionIndices);
+        std::unique_ptr<MemoryAllocation> TryAllocateFromNewRegion(
+            uint64_t size,
+            const MEMORY_ALLOCATION_REQUEST& request);
+        bool TryReserveRegion(uint64_t* regionIndexOut);
+
         const uint64_t mMemorySize;
         const uint64_t mMemoryAlignment;
+        const uint64_t mMinBlockSize;
+        const uint64_t mMaxRegionCount;
 
-        BuddyBlockAllocator mBuddyBlockAllocator;
+        // Regions are only added, never removed, so a region outlives any lock on |mRegionsMutex|.
+        mutable std::shared_timed_mutex mRegionsMutex;
+        std::vector<std::unique_ptr<MemoryRegion>> mRegions;
 
-        // Set of fixed memory allocations containing at-least one sub-allocation.
-        IndexedMemoryPool mUsedPool;
+        // Region last sub-allocated from, which is tried first.
+        std::atomic<uint64_t> mLastRegionIndex{0};
     };
 
 }  // namespace gpgmm
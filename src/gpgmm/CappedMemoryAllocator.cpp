@@ -0,0 +1,53 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/CappedMemoryAllocator.h"
+
+#include "gpgmm/Debug.h"
+
+namespace gpgmm {
+
+    CappedMemoryAllocator::CappedMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                                 uint64_t maxMemoryUsage)
+        : MemoryAllocator(std::move(memoryAllocator)), mMaxMemoryUsage(maxMemoryUsage) {
+    }
+
+    std::unique_ptr<MemoryAllocation> CappedMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "CappedMemoryAllocator.TryAllocateMemory");
+
+        // Locked so concurrent requests cannot both fit under the cap then exceed it together.
+        std::lock_guard<std::mutex> lock(mMutex);
+        const uint64_t memoryUsage = GetFirstChild()->QueryInfo().UsedMemoryUsage;
+        if (request.Size > mMaxMemoryUsage || memoryUsage > mMaxMemoryUsage - request.Size) {
+            DebugEvent("CappedMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Allocation would exceed the memory cap (" << memoryUsage + request.Size
+                << " vs " << mMaxMemoryUsage << " bytes).";
+            return {};
+        }
+
+        return GetFirstChild()->TryAllocateMemory(request);
+    }
+
+    void CappedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        // CappedMemoryAllocator never allocates memory itself, so it must not deallocate.
+        allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+    }
+
+    MEMORY_ALLOCATOR_INFO CappedMemoryAllocator::QueryInfo() const {
+        return GetFirstChild()->QueryInfo();
+    }
+
+}  // namespace gpgmm
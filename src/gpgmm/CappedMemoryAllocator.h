@@ -0,0 +1,43 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_CAPPEDMEMORYALLOCATOR_H_
+#define GPGMM_CAPPEDMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+
+namespace gpgmm {
+
+    // Allocates memory from |memoryAllocator| until it would use more than |maxMemoryUsage|
+    // bytes of memory at once. Memory is deallocated by |memoryAllocator| directly.
+    class CappedMemoryAllocator final : public MemoryAllocator {
+      public:
+        CappedMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                              uint64_t maxMemoryUsage);
+        ~CappedMemoryAllocator() override = default;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+      private:
+        const uint64_t mMaxMemoryUsage;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_CAPPEDMEMORYALLOCATOR_H_
@@ -17,51 +17,71 @@
 #include "gpgmm/TraceEvent.h"
 #include "gpgmm/common/Assert.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace gpgmm {
 
+    namespace {
+
+        std::vector<std::unique_ptr<MemoryAllocator>> MakeAllocators(
+            std::unique_ptr<MemoryAllocator> firstAllocator,
+            std::unique_ptr<MemoryAllocator> secondAllocator) {
+            std::vector<std::unique_ptr<MemoryAllocator>> allocators;
+            allocators.push_back(std::move(firstAllocator));
+            allocators.push_back(std::move(secondAllocator));
+            return allocators;
+        }
+
+    }  // namespace
+
+    ConditionalMemoryAllocator::ConditionalMemoryAllocator(
+        std::vector<std::unique_ptr<MemoryAllocator>> allocators,
+        std::vector<uint64_t> conditionalSizes)
+        : mConditionalSizes(std::move(conditionalSizes)) {
+        ASSERT(allocators.size() == mConditionalSizes.size() + 1);
+        ASSERT(std::is_sorted(mConditionalSizes.begin(), mConditionalSizes.end()));
+        for (std::unique_ptr<MemoryAllocator>& allocator : allocators) {
+            mAllocators.push_back(AppendChild(std::move(allocator)));
+        }
+    }
+
     ConditionalMemoryAllocator::ConditionalMemoryAllocator(
         std::unique_ptr<MemoryAllocator> firstAllocator,
         std::unique_ptr<MemoryAllocator> secondAllocator,
         uint64_t conditionalSize)
-        : mFirstAllocator(AppendChild(std::move(firstAllocator))),
-          mSecondAllocator(AppendChild(std::move(secondAllocator))),
-          mConditionalSize(conditionalSize) {
+        : ConditionalMemoryAllocator(
+              MakeAllocators(std::move(firstAllocator), std::move(secondAllocator)),
+              {conditionalSize}) {
+    }
+
+    // There are few size classes, so the first conditional size which fits is found by a
+    // binary search.
+    MemoryAllocator* ConditionalMemoryAllocator::GetAllocator(uint64_t size) const {
+        const auto it = std::lower_bound(mConditionalSizes.begin(), mConditionalSizes.end(), size);
+        return mAllocators[std::distance(mConditionalSizes.begin(), it)];
     }
 
     std::unique_ptr<MemoryAllocation> ConditionalMemoryAllocator::TryAllocateMemory(
-        uint64_t size,
-        uint64_t alignment,
-        bool neverAllocate,
-        bool cacheSize,
-        bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ConditionalMemoryAllocator.TryAllocateMemory");
-
-        if (size <= mConditionalSize) {
-            return mFirstAllocator->TryAllocateMemory(size, alignment, neverAllocate, cacheSize,
-                                                      prefetchMemory);
-        } else {
-            return mSecondAllocator->TryAllocateMemory(size, alignment, neverAllocate, cacheSize,
-                                                       prefetchMemory);
-        }
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation,
+                     "ConditionalMemoryAllocator.TryAllocateMemory");
+
+        return GetAllocator(request.Size)->TryAllocateMemory(request);
     }
 
     MEMORY_ALLOCATOR_INFO ConditionalMemoryAllocator::QueryInfo() const {
-        std::lock_guard<std::mutex> lock(mMutex);
-
         MEMORY_ALLOCATOR_INFO result = {};
-        {
-            const MEMORY_ALLOCATOR_INFO& info = mFirstAllocator->QueryInfo();
-            result.FreeMemoryUsage += info.FreeMemoryUsage;
-            result.UsedBlockCount += info.UsedBlockCount;
-            result.UsedMemoryUsage += info.UsedMemoryUsage;
-            result.UsedMemoryCount += info.UsedMemoryCount;
-        }
-        {
-            const MEMORY_ALLOCATOR_INFO& info = mSecondAllocator->QueryInfo();
+        for (const MemoryAllocator* allocator : mAllocators) {
+            const MEMORY_ALLOCATOR_INFO& info = allocator->QueryInfo();
             result.FreeMemoryUsage += info.FreeMemoryUsage;
             result.UsedBlockCount += info.UsedBlockCount;
             result.UsedMemoryUsage += info.UsedMemoryUsage;
             result.UsedMemoryCount += info.UsedMemoryCount;
+            result.EvictedMemoryReuseCount += info.EvictedMemoryReuseCount;
+            result.RetainedMemoryReuseCount += info.RetainedMemoryReuseCount;
+            result.PredictedSizeHitCount += info.PredictedSizeHitCount;
+            result.PredictedSizeMissCount += info.PredictedSizeMissCount;
         }
 
         return result;
@@ -73,12 +93,17 @@ namespace gpgmm {
         allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
     }
 
+    MemoryAllocator* ConditionalMemoryAllocator::GetAllocatorForTesting(
+        size_t sizeClassIndex) const {
+        return mAllocators[sizeClassIndex];
+    }
+
     MemoryAllocator* ConditionalMemoryAllocator::GetFirstAllocatorForTesting() const {
-        return mFirstAllocator;
+        return mAllocators.front();
     }
 
     MemoryAllocator* ConditionalMemoryAllocator::GetSecondAllocatorForTesting() const {
-        return mSecondAllocator;
+        return mAllocators[1];
     }
 
 }  // namespace gpgmm
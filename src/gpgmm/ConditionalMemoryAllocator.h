@@ -17,36 +17,44 @@
 
 #include "gpgmm/MemoryAllocator.h"
 
+#include <vector>
+
 namespace gpgmm {
 
     // Conditionally allocates depending on the size.
-    // If the allocation size is less then or equal to the |conditionalSize|, the |firstAllocator|
-    // will be used, else |secondAllocator|.
+    // Sizes are split into size classes by the ascending |conditionalSizes|, each allocated by
+    // its own allocator. If the allocation size is less then or equal to |conditionalSizes[i]|,
+    // and greater than any smaller conditional size, |allocators[i]| will be used. Allocations
+    // larger than every conditional size use the last allocator, so there must be exactly one
+    // more allocator than conditional sizes.
     class ConditionalMemoryAllocator final : public MemoryAllocator {
       public:
+        ConditionalMemoryAllocator(std::vector<std::unique_ptr<MemoryAllocator>> allocators,
+                                   std::vector<uint64_t> conditionalSizes);
+
+        // If the allocation size is less then or equal to the |conditionalSize|, the
+        // |firstAllocator| will be used, else |secondAllocator|.
         ConditionalMemoryAllocator(std::unique_ptr<MemoryAllocator> firstAllocator,
                                    std::unique_ptr<MemoryAllocator> secondAllocator,
                                    uint64_t conditionalSize);
         ~ConditionalMemoryAllocator() override = default;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
 
         MEMORY_ALLOCATOR_INFO QueryInfo() const override;
 
+        MemoryAllocator* GetAllocatorForTesting(size_t sizeClassIndex) const;
         MemoryAllocator* GetFirstAllocatorForTesting() const;
         MemoryAllocator* GetSecondAllocatorForTesting() const;
 
       private:
-        MemoryAllocator* mFirstAllocator = nullptr;
-        MemoryAllocator* mSecondAllocator = nullptr;
+        MemoryAllocator* GetAllocator(uint64_t size) const;
 
-        uint64_t mConditionalSize;
+        std::vector<MemoryAllocator*> mAllocators;
+        const std::vector<uint64_t> mConditionalSizes;
     };
 
 }  // namespace gpgmm
@@ -16,8 +16,40 @@
 
 #include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Log.h"
+#include "gpgmm/common/RateLimiter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
 
 namespace gpgmm {
+
+    namespace {
+
+        // Messages which hash to the same limiter share its limit. Enough that messages of
+        // different names and IDs rarely do.
+        constexpr uint32_t kEventMessageRateLimiterCount = 64;
+
+        RateLimiter gEventMessageRateLimiters[kEventMessageRateLimiterCount];
+
+        RateLimiter* GetEventMessageRateLimiter(const char* name, int messageId) {
+            // The name is a string literal, so its address identifies it.
+            const uint64_t hash =
+                (reinterpret_cast<uintptr_t>(name) >> 3) ^
+                (static_cast<uint64_t>(static_cast<uint32_t>(messageId)) * 0x9E3779B97F4A7C15ull);
+            return &gEventMessageRateLimiters[(hash >> 32) % kEventMessageRateLimiterCount];
+        }
+
+        thread_local bool tlsIsTraceEventCallSampled = true;
+
+        uint64_t GetTimeInMicroseconds() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+    }  // namespace
+
     // Messages with equal or greater to severity will be logged.
     LogSeverity gRecordEventLevel = LogSeverity::Info;
 
@@ -27,21 +59,50 @@ namespace gpgmm {
 
     EventMessage::EventMessage(const LogSeverity& level, const char* name, int messageId)
         : LogMessage(level), mSeverity(level), mName(name), mMessageId(messageId) {
+        mIsEnabled = IsLogMessageEnabled(mSeverity) ||
+                     (mSeverity >= gRecordEventLevel && IsEventTraceEnabled());
+        if (mIsEnabled) {
+            mIsEnabled = GetEventMessageRateLimiter(mName, mMessageId)
+                             ->TryAcquire(GetTimeInMicroseconds(), /*period*/ 1000000,
+                                          kMaxMessagesPerSecond, &mSuppressedCount);
+        }
     }
 
     EventMessage::~EventMessage() {
-        const std::string description = mStream.str();
-
-        gpgmm::Log(mSeverity) << mName << ": " << description;
 #if defined(GPGMM_ENABLE_ASSERT_ON_WARNING)
         ASSERT(mSeverity < LogSeverity::Warning);
 #endif
+        // If this message has been moved or was not enabled, it has no stream.
+        if (mStream == nullptr) {
+            return;
+        }
+
+        std::string description = mStream->str();
+        if (mSuppressedCount > 0) {
+            description += " (" + std::to_string(mSuppressedCount) +
+                           " similar messages were suppressed.)";
+        }
+
+        gpgmm::Log(mSeverity) << mName << ": " << description;
         if (mSeverity >= gRecordEventLevel) {
             LOG_MESSAGE message{description, mMessageId};
             GPGMM_TRACE_EVENT_OBJECT_CALL(mName, message);
         }
     }
 
+    bool IsTraceEventCallSampled() {
+        return tlsIsTraceEventCallSampled;
+    }
+
+    ScopedTraceEventCallSampling::ScopedTraceEventCallSampling(bool isSampled)
+        : mWasSampled(tlsIsTraceEventCallSampled) {
+        tlsIsTraceEventCallSampled = mWasSampled && isSampled;
+    }
+
+    ScopedTraceEventCallSampling::~ScopedTraceEventCallSampling() {
+        tlsIsTraceEventCallSampled = mWasSampled;
+    }
+
     EventMessage DebugEvent(const char* name, int messageId) {
         return {LogSeverity::Debug, name, messageId};
     }
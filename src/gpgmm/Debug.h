@@ -18,7 +18,10 @@
 #include "gpgmm/JSONSerializer.h"
 #include "gpgmm/TraceEvent.h"
 #include "gpgmm/common/Log.h"
+#include "gpgmm/common/NonCopyable.h"
 
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -29,6 +32,7 @@
 #define GPGMM_TRACE_EVENT_OBJECT_DESTROY(objPtr) TRACE_EMPTY
 #define GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(objPtr, desc) TRACE_EMPTY
 #define GPGMM_TRACE_EVENT_OBJECT_CALL(name, desc) TRACE_EMPTY
+#define GPGMM_TRACE_EVENT_OBJECT_CALL_DEFERRED(name, deferredArgs) TRACE_EMPTY
 
 #else // !GPGMM_DISABLE_TRACING
 
@@ -57,6 +61,15 @@
                             GPGMM_LAZY_SERIALIZE(desc, IsEventTraceEnabled())); \
     } while (false)
 
+// Same as GPGMM_TRACE_EVENT_OBJECT_CALL but |deferredArgs|, a TraceEventDeferredArgs, is only
+// serialized once the event is written.
+#define GPGMM_TRACE_EVENT_OBJECT_CALL_DEFERRED(name, deferredArgs)                           \
+    do {                                                                                     \
+        if (IsEventTraceEnabled()) {                                                         \
+            TRACE_EVENT_INSTANT_DEFERRED1(TraceEventCategory::Default, name, deferredArgs); \
+        }                                                                                    \
+    } while (false)
+
 // Helper macro to avoid evaluating the arguments when the condition doesn't hold.
 #define GPGMM_LAZY_SERIALIZE(object, condition) \
     !(condition) ? JSONSerializer::Serialize() : JSONSerializer::Serialize(object)
@@ -70,6 +83,9 @@ namespace gpgmm {
         int ID;
     };
 
+    // Message which is logged and recorded as a trace event. Whether the message is enabled is
+    // decided when it is created, before any values are given to it: messages below both the log
+    // and record levels, or repeated too often with the same name and ID, ignore their values.
     class EventMessage : public LogMessage {
       public:
         EventMessage(const LogSeverity& level, const char* name, int messageId = 0);
@@ -80,16 +96,28 @@ namespace gpgmm {
 
         template <typename T>
         EventMessage& operator<<(T&& value) {
-            mStream << value;
+            if (mIsEnabled) {
+                if (mStream == nullptr) {
+                    mStream = std::make_unique<std::ostringstream>();
+                }
+                *mStream << value;
+            }
             return *this;
         }
 
+        // Most messages of the same name and ID output per second. Messages over the limit are
+        // counted and the count is output with the next message allowed.
+        constexpr static uint32_t kMaxMessagesPerSecond = 10;
+
       private:
         LogSeverity mSeverity;
         const char* mName = nullptr;
         int mMessageId = 0;
 
-        std::ostringstream mStream;
+        bool mIsEnabled = false;
+        uint32_t mSuppressedCount = 0;
+
+        std::unique_ptr<std::ostringstream> mStream;
     };
 
     EventMessage DebugEvent(const char* name, int messageId = 0);
@@ -100,6 +128,22 @@ namespace gpgmm {
     // Messages of a given severity to be recorded.
     void SetEventMessageLevel(const LogSeverity& level);
 
+    // Whether the calls of the calling thread, and the objects created by them, are recorded.
+    // Only false while a call which was not sampled runs, see ScopedTraceEventCallSampling.
+    bool IsTraceEventCallSampled();
+
+    // Skips recording the calls made by the calling thread while in scope, unless |isSampled|.
+    // Objects created meanwhile check IsTraceEventCallSampled() once, so they skip every later
+    // event too, including the release by another thread.
+    class ScopedTraceEventCallSampling : public NonCopyable {
+      public:
+        explicit ScopedTraceEventCallSampling(bool isSampled);
+        ~ScopedTraceEventCallSampling();
+
+      private:
+        const bool mWasSampled;
+    };
+
 }  // namespace gpgmm
 
 #endif  // GPGMM_DEBUG_H_
@@ -19,7 +19,10 @@
 
 namespace gpgmm {
     static constexpr const char* kDefaultTraceFile = "gpgmm_event_trace.json";
+    static constexpr const char* kDefaultBinaryTraceFile = "gpgmm_event_trace.bin";
     static constexpr double kDefaultFragmentationLimit = 0.125;  // 1/8th or 12.5%
+    static constexpr uint64_t kDefaultMagazineSize = 16;
+    static constexpr uint64_t kDefaultMaxEmptySlabCount = 1;
 }  // namespace gpgmm
 
 #endif  // GPGMM_DEFAULTS_H_
@@ -0,0 +1,118 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/ETWEventTrace.h"
+
+#include <windows.h>
+
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+#include <atomic>
+
+// GUID is derived from the provider name, so tools can also refer to the provider by "*GPGMM".
+TRACELOGGING_DEFINE_PROVIDER(
+    gGPGMMProvider,
+    "GPGMM",
+    // {dde1fe76-d060-5867-60a9-5b857c310ed0}
+    (0xdde1fe76, 0xd060, 0x5867, 0x60, 0xa9, 0x5b, 0x85, 0x7c, 0x31, 0x0e, 0xd0));
+
+// TraceLoggingWrite requires the event name, opcode and level to be constants, so the name of
+// the trace event is written as a field of a single "TraceEvent" event instead.
+#define GPGMM_ETW_WRITE_TRACE_EVENT(opcode)                                               \
+    TraceLoggingWrite(gGPGMMProvider, "TraceEvent", TraceLoggingOpcode(opcode),           \
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),                          \
+                      TraceLoggingString(name, "Name"),                                   \
+                      TraceLoggingUInt32(static_cast<uint32_t>(category), "Category"),    \
+                      TraceLoggingChar(phase, "Phase"), TraceLoggingHexUInt64(id, "ID"),  \
+                      TraceLoggingString(args.c_str(), "Args"))
+
+namespace gpgmm {
+
+    namespace {
+
+        std::atomic<uint32_t> gETWTraceEventCategories{0};
+
+        // Called by ETW whenever a session enables or disables the provider, after the provider
+        // state was updated, so it can be queried for the keywords of every session.
+        void NTAPI ETWEnableCallback(LPCGUID sourceId,
+                                     ULONG isEnabled,
+                                     UCHAR level,
+                                     ULONGLONG matchAnyKeyword,
+                                     ULONGLONG matchAllKeyword,
+                                     PEVENT_FILTER_DESCRIPTOR filterData,
+                                     PVOID callbackContext) {
+            uint32_t categoryMask = 0;
+            for (uint32_t i = 0; i < kTraceEventCategoryCount; i++) {
+                const TraceEventCategory category = static_cast<TraceEventCategory>(i);
+
+                // ETW names threads and processes itself.
+                if (category == TraceEventCategory::Metadata) {
+                    continue;
+                }
+
+                if (TraceLoggingProviderEnabled(gGPGMMProvider, WINEVENT_LEVEL_VERBOSE,
+                                                GetTraceEventCategoryMask(category))) {
+                    categoryMask |= GetTraceEventCategoryMask(category);
+                }
+            }
+
+            gETWTraceEventCategories.store(categoryMask, std::memory_order_relaxed);
+            UpdateEnabledTraceEventCategories();
+        }
+
+        // Registers the provider for the lifetime of the module. The provider must be unregistered
+        // before the module unloads, which the destructor does.
+        class ETWProviderRegistration {
+          public:
+            ETWProviderRegistration() {
+                TraceLoggingRegisterEx(gGPGMMProvider, ETWEnableCallback, nullptr);
+            }
+
+            ~ETWProviderRegistration() {
+                TraceLoggingUnregister(gGPGMMProvider);
+                gETWTraceEventCategories.store(0, std::memory_order_relaxed);
+                UpdateEnabledTraceEventCategories();
+            }
+        };
+
+        ETWProviderRegistration gETWProviderRegistration;
+
+    }  // namespace
+
+    uint32_t GetETWTraceEventCategories() {
+        return gETWTraceEventCategories.load(std::memory_order_relaxed);
+    }
+
+    void WriteETWTraceEvent(char phase,
+                            TraceEventCategory category,
+                            const char* name,
+                            uint64_t id,
+                            const std::string& args) {
+        // Begin and end events are written as start and stop opcodes, which WPA pairs into
+        // regions.
+        switch (phase) {
+            case TRACE_EVENT_PHASE_BEGIN:
+                GPGMM_ETW_WRITE_TRACE_EVENT(WINEVENT_OPCODE_START);
+                break;
+            case TRACE_EVENT_PHASE_END:
+                GPGMM_ETW_WRITE_TRACE_EVENT(WINEVENT_OPCODE_STOP);
+                break;
+            default:
+                GPGMM_ETW_WRITE_TRACE_EVENT(WINEVENT_OPCODE_INFO);
+                break;
+        }
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,48 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_ETWEVENTTRACE_H_
+#define GPGMM_ETWEVENTTRACE_H_
+
+#include "gpgmm/TraceEvent.h"
+
+#include <cstdint>
+#include <string>
+
+namespace gpgmm {
+
+    // Trace events are also written to the "GPGMM" TraceLogging provider, whose name-based GUID is
+    // {dde1fe76-d060-5867-60a9-5b857c310ed0}, so an ETW session can collect them alongside GPU
+    // and driver events (ex. DxgKrnl paging) to view them together in WPA, ex.
+    //
+    //   xperf -start gpgmm -on dde1fe76-d060-5867-60a9-5b857c310ed0
+    //
+    // Bit N of the session keywords enables the TraceEventCategory of value N, or every category
+    // when no keyword is given. Events are only written while a session listens, so the provider
+    // costs nothing otherwise. ETW records the timestamp and thread of each event itself.
+
+    // Categories which an ETW session listens to. Updated whenever a session enables or disables
+    // the provider.
+    uint32_t GetETWTraceEventCategories();
+
+    // Writes an event to the provider. |args| is the JSON encoded args, or empty if none.
+    void WriteETWTraceEvent(char phase,
+                            TraceEventCategory category,
+                            const char* name,
+                            uint64_t id,
+                            const std::string& args);
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_ETWEVENTTRACE_H_
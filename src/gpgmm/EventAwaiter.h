@@ -0,0 +1,109 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_EVENTAWAITER_H_
+#define GPGMM_EVENTAWAITER_H_
+
+// Optional header which lets C++20 coroutines co_await events. Empty unless compiled with
+// coroutine support, since the rest of GPGMM only requires C++14.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#    if __has_include(<coroutine>)
+#        define GPGMM_HAS_COROUTINES
+#    endif
+#endif
+
+#if defined(GPGMM_HAS_COROUTINES)
+
+#    include "gpgmm/MemoryAllocator.h"
+#    include "gpgmm/WorkerThread.h"
+
+#    include <coroutine>
+#    include <memory>
+#    include <utility>
+
+namespace gpgmm {
+
+    // Resumes an awaiting coroutine, on the calling thread or as a task of |scheduler|.
+    class ResumeCoroutineTask final : public VoidCallback {
+      public:
+        ResumeCoroutineTask(std::coroutine_handle<> handle, TaskScheduler* scheduler)
+            : mHandle(handle), mScheduler(scheduler) {
+        }
+
+        void operator()() override {
+            if (mScheduler == nullptr) {
+                mHandle.resume();
+                return;
+            }
+            mScheduler->ScheduleTask(std::make_shared<ResumeCoroutineTask>(mHandle, nullptr),
+                                     TaskClass::kRequested);
+        }
+
+      private:
+        const std::coroutine_handle<> mHandle;
+        TaskScheduler* const mScheduler;
+    };
+
+    // Awaitable which suspends the coroutine until |event| is signaled, without blocking a
+    // thread. The coroutine is resumed by |scheduler|, or by the thread which signals the event
+    // if nullptr. co_await returns the event, which is then signaled.
+    template <typename EventT>
+    class EventAwaiter {
+      public:
+        explicit EventAwaiter(std::shared_ptr<EventT> event, TaskScheduler* scheduler = nullptr)
+            : mEvent(std::move(event)), mScheduler(scheduler) {
+        }
+
+        bool await_ready() const {
+            return mEvent->IsSignaled();
+        }
+
+        // Signaling after await_ready resumes the coroutine from here, which is allowed since it
+        // is already suspended.
+        void await_suspend(std::coroutine_handle<> handle) {
+            mEvent->AddSignaledCallback(std::make_shared<ResumeCoroutineTask>(handle, mScheduler));
+        }
+
+        std::shared_ptr<EventT> await_resume() {
+            return mEvent;
+        }
+
+      protected:
+        std::shared_ptr<EventT> mEvent;
+        TaskScheduler* const mScheduler;
+    };
+
+    // co_await returns the allocation made by MemoryAllocator::TryAllocateMemoryAsync.
+    class MemoryAllocationAwaiter final : public EventAwaiter<MemoryAllocationEvent> {
+      public:
+        using EventAwaiter::EventAwaiter;
+
+        std::unique_ptr<MemoryAllocation> await_resume() {
+            return mEvent->AcquireAllocation();
+        }
+    };
+
+    // Allocates memory asynchronously with |allocator|, for use with co_await.
+    inline MemoryAllocationAwaiter TryAllocateMemoryAwaitable(
+        MemoryAllocator* allocator,
+        const MEMORY_ALLOCATION_REQUEST& request,
+        TaskScheduler* scheduler = nullptr) {
+        return MemoryAllocationAwaiter(allocator->TryAllocateMemoryAsync(request), scheduler);
+    }
+
+}  // namespace gpgmm
+
+#endif  // defined(GPGMM_HAS_COROUTINES)
+
+#endif  // GPGMM_EVENTAWAITER_H_
@@ -14,32 +14,61 @@
 
 #include "gpgmm/EventTraceWriter.h"
 
+#include "gpgmm/BinaryEventTrace.h"
 #include "gpgmm/common/Assert.h"
-#include "gpgmm/common/PlatformTime.h"
+#include "gpgmm/common/Log.h"
 #include "gpgmm/common/PlatformUtils.h"
-#include "gpgmm/common/Utils.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <string>
 #include <thread>
 
 namespace gpgmm {
 
-    EventTraceWriter::EventTraceWriter() : mPlatformTime(CreatePlatformTime()) {
+    // How often the thread buffers are drained.
+    constexpr static std::chrono::milliseconds kDrainInterval(100);
+
+    // Number of events each thread can record between drains before newer events are dropped.
+    constexpr static uint64_t kThreadBufferCapacity = 8192;
+
+    EventTraceWriter::EventTraceWriter() : mStartTime(std::chrono::steady_clock::now()) {
     }
 
     void EventTraceWriter::SetConfiguration(const std::string& traceFile,
                                             bool skipDurationEvents,
                                             bool skipObjectEvents,
-                                            bool skipInstantEvents) {
+                                            bool skipInstantEvents,
+                                            bool useBinaryFormat,
+                                            double flightRecorderDurationInSeconds) {
+        StopDraining();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mBinaryEncoder.reset();
+        if (mBinaryTraceFile.is_open()) {
+            mBinaryTraceFile.close();
+        }
+
         mTraceFile = traceFile;
         mSkipDurationEvents = skipDurationEvents;
         mSkipObjectEvents = skipObjectEvents;
         mSkipInstantEvents = skipInstantEvents;
+        mUseBinaryFormat = useBinaryFormat;
+        mFlightRecorderDurationInMicroseconds =
+            static_cast<uint64_t>(flightRecorderDurationInSeconds * 1000.0 * 1000.0);
+
+        if (mUseBinaryFormat && mFlightRecorderDurationInMicroseconds == 0) {
+            mBinaryTraceFile.open(mTraceFile, std::ios::binary | std::ios::trunc);
+            mBinaryEncoder = std::make_unique<BinaryEventTraceEncoder>(&mBinaryTraceFile);
+        }
+
+        StartDraining();
     }
 
     EventTraceWriter::~EventTraceWriter() {
+        StopDraining();
         FlushQueuedEventsToDisk();
     }
 
@@ -49,137 +78,352 @@ namespace gpgmm {
                                              uint64_t id,
                                              uint32_t flags,
                                              const JSONDict& args) {
-        const double timestampInSeconds = mPlatformTime->GetRelativeTime();
-        const uint32_t threadID = std::stoi(ToString(std::this_thread::get_id()));
-        if (timestampInSeconds != 0) {
-            GetOrCreateBufferFromTLS()->push_back(
-                {phase, category, name, id, threadID, timestampInSeconds, flags, args});
+        EnqueueTraceEventInternal(phase, category, name, id, flags, args);
+    }
+
+    void EventTraceWriter::EnqueueTraceEvent(char phase,
+                                             TraceEventCategory category,
+                                             const char* name,
+                                             uint64_t id,
+                                             uint32_t flags,
+                                             const TraceEventDeferredArgs& deferredArgs) {
+        EnqueueTraceEventInternal(phase, category, name, id, flags, deferredArgs);
+    }
+
+    template <typename ArgsT>
+    void EventTraceWriter::EnqueueTraceEventInternal(char phase,
+                                                     TraceEventCategory category,
+                                                     const char* name,
+                                                     uint64_t id,
+                                                     uint32_t flags,
+                                                     const ArgsT& args) {
+        const uint64_t timestampInMicroseconds =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - mStartTime)
+                .count();
+
+        ThreadBuffer* buffer = GetOrCreateBufferFromTLS();
+        if (!buffer->Events.TryEmplace(phase, category, name, id, buffer->ThreadID,
+                                       timestampInMicroseconds, flags, args)) {
+            mDroppedEventCount.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
     void EventTraceWriter::FlushQueuedEventsToDisk() {
-        std::unique_lock<std::mutex> lock(mMutex);
+        std::lock_guard<std::mutex> lock(mMutex);
 
-        JSONArray traceEvents;
-        std::vector<TraceEvent> mergedBuffer = MergeAndClearBuffers();
-        for (const TraceEvent& traceEvent : mergedBuffer) {
-            if (mSkipDurationEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_BEGIN ||
-                                        traceEvent.mPhase == TRACE_EVENT_PHASE_END)) {
-                continue;
-            }
+        DrainBuffers();
+        WarnDroppedEvents();
 
-            if (mSkipObjectEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_CREATE_OBJECT ||
-                                      traceEvent.mPhase == TRACE_EVENT_PHASE_DELETE_OBJECT ||
-                                      traceEvent.mPhase == TRACE_EVENT_PHASE_SNAPSHOT_OBJECT)) {
-                continue;
-            }
+        // Flight recordings are only written when dumped and binary traces were already
+        // streamed.
+        if (mFlightRecorderDurationInMicroseconds > 0 || mBinaryEncoder != nullptr) {
+            return;
+        }
 
-            if (mSkipInstantEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_INSTANT)) {
-                continue;
-            }
+        // Flush was already called and flushing again would overwrite using an empty trace file.
+        if (mDrainedEvents.empty()) {
+            return;
+        }
+
+        WriteJSONTraceFile(mDrainedEvents);
+        mDrainedEvents.clear();
+    }
+
+    void EventTraceWriter::DumpFlightRecordingToDisk() {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mFlightRecorderDurationInMicroseconds == 0) {
+            return;
+        }
+
+        DrainBuffers();
+        WarnDroppedEvents();
+
+        // Events are kept so a later dump still covers the whole duration.
+        if (mUseBinaryFormat) {
+            WriteBinaryTraceFile(mDrainedEvents);
+        } else {
+            WriteJSONTraceFile(mDrainedEvents);
+        }
+    }
+
+    // static
+    JSONDict EventTraceWriter::SerializeEvent(char phase,
+                                              TraceEventCategory category,
+                                              const char* name,
+                                              uint64_t id,
+                                              uint32_t tid,
+                                              uint64_t timestampInMicroseconds,
+                                              uint32_t flags,
+                                              uint32_t pid,
+                                              const std::string& args) {
+        JSONDict eventData;
+        SerializeEvent(eventData.GetWriter(), phase, category, name, id, tid,
+                       timestampInMicroseconds, flags, pid, args);
+        return eventData;
+    }
+
+    // static
+    void EventTraceWriter::SerializeEvent(JSONWriter* writer,
+                                          char phase,
+                                          TraceEventCategory category,
+                                          const char* name,
+                                          uint64_t id,
+                                          uint32_t tid,
+                                          uint64_t timestampInMicroseconds,
+                                          uint32_t flags,
+                                          uint32_t pid,
+                                          const std::string& args) {
+        writer->AddItem("name", name);
+
+        switch (category) {
+            case TraceEventCategory::Default:
+                writer->AddItem("cat", "default");
+                break;
+
+            case TraceEventCategory::Metadata:
+                writer->AddItem("cat", "__metadata");
+                break;
+
+            case TraceEventCategory::Allocation:
+                writer->AddItem("cat", "allocation");
+                break;
+
+            case TraceEventCategory::Residency:
+                writer->AddItem("cat", "residency");
+                break;
+
+            case TraceEventCategory::Slab:
+                writer->AddItem("cat", "slab");
+                break;
+
+            case TraceEventCategory::Buddy:
+                writer->AddItem("cat", "buddy");
+                break;
+
+            case TraceEventCategory::Pool:
+                writer->AddItem("cat", "pool");
+                break;
+
+            case TraceEventCategory::ThreadPool:
+                writer->AddItem("cat", "thread_pool");
+                break;
+
+            default:
+                UNREACHABLE();
+                break;
+        }
 
-            JSONDict eventData;
-            eventData.AddItem("name", traceEvent.mName);
+        writer->AddItem("ph", phase);
 
-            switch (traceEvent.mCategory) {
-                case TraceEventCategory::Default:
-                    eventData.AddItem("cat", "default");
+        const uint32_t idFlags = flags & (TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_HAS_LOCAL_ID |
+                                          TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
+
+        if (idFlags) {
+            char traceEventID[24];
+            std::snprintf(traceEventID, sizeof(traceEventID), "0x%llx",
+                          static_cast<unsigned long long>(id));
+
+            switch (idFlags) {
+                case TRACE_EVENT_FLAG_HAS_ID:
+                    writer->AddItem("id", traceEventID);
+                    break;
+
+                case TRACE_EVENT_FLAG_HAS_LOCAL_ID: {
+                    writer->AddName("id2");
+                    writer->BeginDict();
+                    writer->AddItem("local", traceEventID);
+                    writer->EndDict();
                     break;
+                }
 
-                case TraceEventCategory::Metadata:
-                    eventData.AddItem("cat", "__metadata");
+                case TRACE_EVENT_FLAG_HAS_GLOBAL_ID: {
+                    writer->AddName("id2");
+                    writer->BeginDict();
+                    writer->AddItem("global", traceEventID);
+                    writer->EndDict();
                     break;
+                }
 
                 default:
                     UNREACHABLE();
                     break;
             }
+        }
 
-            eventData.AddItem("ph", traceEvent.mPhase);
-
-            const uint32_t idFlags =
-                traceEvent.mFlags & (TRACE_EVENT_FLAG_HAS_ID | TRACE_EVENT_FLAG_HAS_LOCAL_ID |
-                                     TRACE_EVENT_FLAG_HAS_GLOBAL_ID);
-
-            if (idFlags) {
-                std::stringstream traceEventID;
-                traceEventID << std::hex << traceEvent.mID;
-
-                switch (idFlags) {
-                    case TRACE_EVENT_FLAG_HAS_ID:
-                        eventData.AddItem("id", "0x" + traceEventID.str());
-                        break;
-
-                    case TRACE_EVENT_FLAG_HAS_LOCAL_ID: {
-                        JSONDict localID;
-                        localID.AddItem("local", "0x" + traceEventID.str());
-                        eventData.AddItem("id2", localID);
-                        break;
-                    }
-
-                    case TRACE_EVENT_FLAG_HAS_GLOBAL_ID: {
-                        JSONDict globalID;
-                        globalID.AddItem("global", "0x" + traceEventID.str());
-                        eventData.AddItem("id2", globalID);
-                        break;
-                    }
-
-                    default:
-                        UNREACHABLE();
-                        break;
-                }
-            }
-
-            eventData.AddItem("tid", traceEvent.mTID);
+        writer->AddItem("tid", tid);
+        writer->AddItem("ts", timestampInMicroseconds);
+        writer->AddItem("pid", pid);
 
-            const uint64_t microseconds =
-                static_cast<uint64_t>(traceEvent.mTimestamp * 1000.0 * 1000.0);
-            eventData.AddItem("ts", microseconds);
-            eventData.AddItem("pid", GetPID());
+        if (!args.empty()) {
+            writer->AddName("args");
+            writer->AddEncodedValue(args);
+        }
+    }
 
-            if (!traceEvent.mArgs.IsEmpty()) {
-                eventData.AddItem("args", traceEvent.mArgs);
-            }
+    bool EventTraceWriter::IsSkipped(const TraceEvent& traceEvent) const {
+        if (mSkipDurationEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_BEGIN ||
+                                    traceEvent.mPhase == TRACE_EVENT_PHASE_END)) {
+            return true;
+        }
 
-            traceEvents.AddItem(eventData);
+        if (mSkipObjectEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_CREATE_OBJECT ||
+                                  traceEvent.mPhase == TRACE_EVENT_PHASE_DELETE_OBJECT ||
+                                  traceEvent.mPhase == TRACE_EVENT_PHASE_SNAPSHOT_OBJECT)) {
+            return true;
         }
 
-        // Flush was already called and flushing again would overwrite using an empty trace file.
-        if (mergedBuffer.size() == 0) {
-            return;
+        if (mSkipInstantEvents && (traceEvent.mPhase == TRACE_EVENT_PHASE_INSTANT)) {
+            return true;
         }
 
-        JSONDict traceData;
-        traceData.AddItem("traceEvents", traceEvents);
+        return false;
+    }
+
+    void EventTraceWriter::WriteJSONTraceFile(const std::deque<TraceEvent>& events) {
+        const uint32_t pid = GetPID();
 
         std::ofstream outFile;
         outFile.open(mTraceFile);
-        outFile << traceData.ToString();
+
+        // Written the same as JSONDict and JSONArray would, but one event at a time into a
+        // re-used buffer, so the whole trace is never held in memory as a string.
+        outFile << "{ \"traceEvents\": [ ";
+
+        JSONWriter eventWriter;
+        bool hasEvent = false;
+        for (const TraceEvent& traceEvent : events) {
+            eventWriter.Reset();
+            eventWriter.BeginDict();
+            SerializeEvent(&eventWriter, traceEvent.mPhase, traceEvent.mCategory, traceEvent.mName,
+                           traceEvent.mID, traceEvent.mTID, traceEvent.mTimestampInMicroseconds,
+                           traceEvent.mFlags, pid, traceEvent.mArgs);
+            eventWriter.EndDict();
+
+            if (hasEvent) {
+                outFile << ", ";
+            }
+            outFile << eventWriter.GetBuffer();
+            hasEvent = true;
+        }
+
+        outFile << " ] }";
         outFile.flush();
         outFile.close();
     }
 
-    std::vector<TraceEvent>* EventTraceWriter::GetOrCreateBufferFromTLS() {
-        thread_local std::vector<TraceEvent>* pBufferInTLS = nullptr;
-        if (pBufferInTLS == nullptr) {
-            auto buffer = std::make_unique<std::vector<TraceEvent>>();
-            pBufferInTLS = buffer.get();
+    void EventTraceWriter::WriteBinaryTraceFile(const std::deque<TraceEvent>& events) {
+        std::ofstream outFile(mTraceFile, std::ios::binary | std::ios::trunc);
+        BinaryEventTraceEncoder encoder(&outFile);
+        for (const TraceEvent& traceEvent : events) {
+            encoder.AddEvent(traceEvent.mPhase, traceEvent.mCategory, traceEvent.mName,
+                             traceEvent.mID, traceEvent.mTID, traceEvent.mTimestampInMicroseconds,
+                             traceEvent.mFlags, traceEvent.mArgs);
+        }
+        encoder.Flush();
+    }
+
+    void EventTraceWriter::WarnDroppedEvents() {
+        const uint64_t droppedEventCount = mDroppedEventCount.exchange(0);
+        if (droppedEventCount > 0) {
+            WarningLog() << "Trace dropped " << droppedEventCount
+                         << " events because a thread recorded more than "
+                         << kThreadBufferCapacity << " events between drains.\n";
+        }
+    }
+
+    void EventTraceWriter::StartDraining() {
+        ASSERT(!mDrainThread.joinable());
 
+        mStopDraining = false;
+        mDrainThread = std::thread([this]() {
+            std::unique_lock<std::mutex> drainLock(mMutex);
+            while (!mStopDraining) {
+                mDrainCondition.wait_for(drainLock, kDrainInterval);
+                DrainBuffers();
+            }
+        });
+    }
+
+    void EventTraceWriter::StopDraining() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopDraining = true;
+        }
+
+        mDrainCondition.notify_all();
+        if (mDrainThread.joinable()) {
+            mDrainThread.join();
+        }
+    }
+
+    EventTraceWriter::ThreadBuffer* EventTraceWriter::GetOrCreateBufferFromTLS() {
+        thread_local ThreadBuffer* pBufferInTLS = nullptr;
+        if (pBufferInTLS == nullptr) {
             std::lock_guard<std::mutex> mutex(mMutex);
+            auto buffer = std::make_unique<ThreadBuffer>(mNextThreadID++, kThreadBufferCapacity);
+            pBufferInTLS = buffer.get();
             mBufferPerThread[std::this_thread::get_id()] = std::move(buffer);
         }
         ASSERT(pBufferInTLS != nullptr);
         return pBufferInTLS;
     }
 
-    std::vector<TraceEvent> EventTraceWriter::MergeAndClearBuffers() const {
-        std::vector<TraceEvent> mergedBuffer;
+    // Must be called with mMutex held.
+    void EventTraceWriter::DrainBuffers() {
+        // Events of each thread are already ordered by timestamp, so each thread's events only
+        // need to be merged with those drained before them.
+        std::vector<TraceEvent> drainedEvents;
         for (auto& bufferOfThread : mBufferPerThread) {
-            mergedBuffer.insert(mergedBuffer.end(), bufferOfThread.second->begin(),
-                                bufferOfThread.second->end());
-            bufferOfThread.second->clear();
+            const size_t mergeBegin = drainedEvents.size();
+            bufferOfThread.second->Events.PopAll(&drainedEvents);
+            std::inplace_merge(drainedEvents.begin(), drainedEvents.begin() + mergeBegin,
+                               drainedEvents.end(), [](const TraceEvent& a, const TraceEvent& b) {
+                                   return a.mTimestampInMicroseconds < b.mTimestampInMicroseconds;
+                               });
+        }
+
+        // Deferred args are serialized here, instead of by the thread which recorded them.
+        JSONWriter argsWriter;
+        for (TraceEvent& traceEvent : drainedEvents) {
+            if (IsSkipped(traceEvent)) {
+                continue;
+            }
+
+            if (!traceEvent.mDeferredArgs.IsEmpty()) {
+                argsWriter.Reset();
+                argsWriter.BeginDict();
+                traceEvent.mDeferredArgs.Serialize(&argsWriter);
+                argsWriter.EndDict();
+                traceEvent.mArgs = argsWriter.GetBuffer();
+                traceEvent.mDeferredArgs = {};
+            }
+
+            mDrainedEvents.push_back(std::move(traceEvent));
+        }
+
+        if (mBinaryEncoder != nullptr) {
+            for (const TraceEvent& traceEvent : mDrainedEvents) {
+                mBinaryEncoder->AddEvent(traceEvent.mPhase, traceEvent.mCategory,
+                                         traceEvent.mName, traceEvent.mID, traceEvent.mTID,
+                                         traceEvent.mTimestampInMicroseconds, traceEvent.mFlags,
+                                         traceEvent.mArgs);
+            }
+            mBinaryEncoder->Flush();
+            mDrainedEvents.clear();
+            return;
+        }
+
+        // Only keep events recorded within the duration of the latest one.
+        if (mFlightRecorderDurationInMicroseconds > 0) {
+            while (!mDrainedEvents.empty() &&
+                   mDrainedEvents.front().mTimestampInMicroseconds +
+                           mFlightRecorderDurationInMicroseconds <
+                       mDrainedEvents.back().mTimestampInMicroseconds) {
+                mDrainedEvents.pop_front();
+            }
         }
-        return mergedBuffer;
     }
 
 }  // namespace gpgmm
@@ -16,24 +16,44 @@
 #define GPGMM_EVENTTRACEWRITER_H_
 
 #include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/RingBuffer.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 namespace gpgmm {
 
-    class PlatformTime;
+    class BinaryEventTraceEncoder;
 
+    // Records trace events to a trace file. Each thread records events to its own fixed-size
+    // ring buffer, without locking, which a background thread periodically drains and merges by
+    // timestamp. JSON traces are written once recording ends (or the trace is re-configured).
+    // Binary traces are instead streamed to disk as they are drained.
+    //
+    // When flight recording, only the most recent events are kept and nothing is written until
+    // DumpFlightRecordingToDisk is called (ex. once a frame-time spike was detected), so tracing
+    // can always be enabled.
     class EventTraceWriter {
       public:
         EventTraceWriter();
 
+        // |flightRecorderDurationInSeconds| is how long events are kept when flight recording,
+        // or zero to record every event.
         void SetConfiguration(const std::string& traceFile,
                               bool skipDurationEvents,
                               bool skipObjectEvents,
-                              bool skipInstantEvents);
+                              bool skipInstantEvents,
+                              bool useBinaryFormat,
+                              double flightRecorderDurationInSeconds);
 
         ~EventTraceWriter();
 
@@ -43,22 +63,103 @@ namespace gpgmm {
                                uint64_t id,
                                uint32_t flags,
                                const JSONDict& args);
+        void EnqueueTraceEvent(char phase,
+                               TraceEventCategory category,
+                               const char* name,
+                               uint64_t id,
+                               uint32_t flags,
+                               const TraceEventDeferredArgs& deferredArgs);
         void FlushQueuedEventsToDisk();
 
+        // Writes the events kept by the flight recorder to the trace file, overwriting any
+        // earlier dump. Does nothing unless flight recording.
+        void DumpFlightRecordingToDisk();
+
+        // Serializes an event using the JSON trace event format. |args| is the JSON encoded args,
+        // or empty if none.
+        static JSONDict SerializeEvent(char phase,
+                                       TraceEventCategory category,
+                                       const char* name,
+                                       uint64_t id,
+                                       uint32_t tid,
+                                       uint64_t timestampInMicroseconds,
+                                       uint32_t flags,
+                                       uint32_t pid,
+                                       const std::string& args);
+
+        // Same as above but writes the event into the dict open in |writer|.
+        static void SerializeEvent(JSONWriter* writer,
+                                   char phase,
+                                   TraceEventCategory category,
+                                   const char* name,
+                                   uint64_t id,
+                                   uint32_t tid,
+                                   uint64_t timestampInMicroseconds,
+                                   uint32_t flags,
+                                   uint32_t pid,
+                                   const std::string& args);
+
       private:
-        std::vector<TraceEvent>* GetOrCreateBufferFromTLS();
-        std::vector<TraceEvent> MergeAndClearBuffers() const;
+        // Events of a single thread. Only the thread pushes to the ring buffer and it is only
+        // drained with mMutex held. The thread ID is numbered once, when the thread first records
+        // an event, so recording never needs to format or parse the std::thread::id.
+        struct ThreadBuffer {
+            ThreadBuffer(uint32_t threadID, uint64_t capacity)
+                : ThreadID(threadID), Events(capacity) {
+            }
+
+            const uint32_t ThreadID;
+            SPSCRingBuffer<TraceEvent> Events;
+        };
+
+        template <typename ArgsT>
+        void EnqueueTraceEventInternal(char phase,
+                                       TraceEventCategory category,
+                                       const char* name,
+                                       uint64_t id,
+                                       uint32_t flags,
+                                       const ArgsT& args);
+
+        ThreadBuffer* GetOrCreateBufferFromTLS();
+        void DrainBuffers();
+        bool IsSkipped(const TraceEvent& traceEvent) const;
+
+        void WriteJSONTraceFile(const std::deque<TraceEvent>& events);
+        void WriteBinaryTraceFile(const std::deque<TraceEvent>& events);
+        void WarnDroppedEvents();
+
+        void StartDraining();
+        void StopDraining();
 
         std::string mTraceFile;
-        std::unique_ptr<PlatformTime> mPlatformTime;
+
+        // Timestamps are relative to when the writer was created.
+        const std::chrono::steady_clock::time_point mStartTime;
+
         mutable std::mutex mMutex;
 
-        std::unordered_map<std::thread::id, std::unique_ptr<std::vector<TraceEvent>>>
-            mBufferPerThread;
+        std::unordered_map<std::thread::id, std::unique_ptr<ThreadBuffer>> mBufferPerThread;
+        uint32_t mNextThreadID = 1;
 
         bool mSkipDurationEvents = false;
         bool mSkipObjectEvents = false;
         bool mSkipInstantEvents = false;
+        bool mUseBinaryFormat = false;
+        uint64_t mFlightRecorderDurationInMicroseconds = 0;
+
+        // Drained events, ordered by timestamp, which are not yet written. Guarded by mMutex.
+        std::deque<TraceEvent> mDrainedEvents;
+
+        // Events recorded while the ring buffer of their thread was full.
+        std::atomic<uint64_t> mDroppedEventCount{0};
+
+        std::thread mDrainThread;
+        std::condition_variable mDrainCondition;
+        bool mStopDraining = false;
+
+        // Only used by binary traces, when not flight recording. Guarded by mMutex.
+        std::ofstream mBinaryTraceFile;
+        std::unique_ptr<BinaryEventTraceEncoder> mBinaryEncoder;
     };
 
 }  // namespace gpgmm
@@ -0,0 +1,319 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/FlatBuddyBlockAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Limits.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace gpgmm {
+
+    namespace {
+
+        uint64_t GetFirstNodeIndex(uint32_t level) {
+            return (uint64_t(1) << level) - 1;
+        }
+
+    }  // namespace
+
+    FlatBuddyBlockAllocator::FlatBuddyBlockAllocator(uint64_t maxBlockSize,
+                                                     uint64_t rootBlockSize,
+                                                     uint64_t minBlockSize)
+        : mMaxBlockSize(maxBlockSize),
+          mRootBlockSize(rootBlockSize),
+          mMinBlockSize(minBlockSize),
+          mLevelCount(Log2(rootBlockSize) - Log2(minBlockSize) + 1) {
+        ASSERT(IsPowerOfTwo(mMaxBlockSize));
+        ASSERT(IsPowerOfTwo(mRootBlockSize));
+        ASSERT(IsPowerOfTwo(mMinBlockSize));
+        ASSERT(mRootBlockSize <= mMaxBlockSize);
+        ASSERT(mMinBlockSize <= mRootBlockSize);
+
+        // The tree must be small enough to be indexed and for the free order to fit in a byte.
+        ASSERT(mLevelCount < 32);
+    }
+
+    // Free order of a level is one more than the order of its block size relative to the minimum
+    // block size. Zero is reserved for nodes without any free block.
+    uint8_t FlatBuddyBlockAllocator::GetFreeOrder(uint32_t level) const {
+        ASSERT(level < mLevelCount);
+        return static_cast<uint8_t>(mLevelCount - level);
+    }
+
+    uint64_t FlatBuddyBlockAllocator::GetBlockSize(uint32_t level) const {
+        return mRootBlockSize >> level;
+    }
+
+    MemoryBlock* FlatBuddyBlockAllocator::TryAllocateBlock(uint64_t size, uint64_t alignment) {
+        GPGMM_CHECK_NONZERO(size);
+
+        if (size > mRootBlockSize) {
+            DebugEvent("FlatBuddyBlockAllocator.TryAllocateBlock",
+                       ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "MemoryBlock size exceeded the root block size.";
+            return nullptr;
+        }
+
+        ASSERT(IsPowerOfTwo(alignment));
+
+        const uint64_t blockSize = std::max(NextPowerOfTwo(size), mMinBlockSize);
+        const uint32_t level = Log2(mRootBlockSize) - Log2(blockSize);
+
+        // Roots are aligned to their size, so only larger alignments exclude a root.
+        const uint64_t rootIndexAlignment =
+            (alignment > mRootBlockSize) ? alignment / mRootBlockSize : 1;
+
+        // Try the existing trees first.
+        uint64_t rootIndex = kInvalidIndex;
+        uint64_t nodeIndex = kInvalidIndex;
+        for (auto& tree : mTrees) {
+            if (tree.first % rootIndexAlignment != 0) {
+                continue;
+            }
+            nodeIndex = TryAllocateNode(tree.second.get(), level, alignment);
+            if (nodeIndex != kInvalidIndex) {
+                rootIndex = tree.first;
+                break;
+            }
+        }
+
+        // Otherwise, create a tree for the lowest unused (and aligned) root.
+        if (nodeIndex == kInvalidIndex) {
+            rootIndex = 0;
+            for (const auto& tree : mTrees) {
+                if (tree.first < rootIndex) {
+                    continue;
+                }
+                if (tree.first != rootIndex) {
+                    break;
+                }
+                rootIndex += rootIndexAlignment;
+            }
+
+            if (rootIndex >= mMaxBlockSize / mRootBlockSize) {
+                DebugEvent("FlatBuddyBlockAllocator.TryAllocateBlock",
+                           ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                    << "Allocator has reached capacity";
+                return nullptr;
+            }
+
+            std::unique_ptr<uint8_t[]> nodes(new uint8_t[GetFirstNodeIndex(mLevelCount)]);
+            for (uint32_t nodeLevel = 0; nodeLevel < mLevelCount; nodeLevel++) {
+                std::fill_n(nodes.get() + GetFirstNodeIndex(nodeLevel), uint64_t(1) << nodeLevel,
+                            GetFreeOrder(nodeLevel));
+            }
+
+            nodeIndex = TryAllocateNode(nodes.get(), level, alignment);
+            ASSERT(nodeIndex != kInvalidIndex);
+
+            mTrees.emplace(rootIndex, std::move(nodes));
+        }
+
+        MemoryBlock* block = mBlockPool.Acquire();
+        block->Offset =
+            rootIndex * mRootBlockSize + (nodeIndex - GetFirstNodeIndex(level)) * blockSize;
+        block->Size = blockSize;
+        return block;
+    }
+
+    void FlatBuddyBlockAllocator::DeallocateBlock(MemoryBlock* block) {
+        ASSERT(block != nullptr);
+
+        const uint64_t rootIndex = block->Offset / mRootBlockSize;
+        auto it = mTrees.find(rootIndex);
+        ASSERT(it != mTrees.end());
+
+        uint8_t* nodes = it->second.get();
+
+        const uint32_t level = Log2(mRootBlockSize) - Log2(block->Size);
+        const uint64_t nodeIndex =
+            GetFirstNodeIndex(level) + (block->Offset % mRootBlockSize) / block->Size;
+
+        ASSERT(nodes[nodeIndex] == 0);
+        nodes[nodeIndex] = GetFreeOrder(level);
+        UpdateParents(nodes, nodeIndex, level);
+
+        // Release the tree once the root is entirely free.
+        if (nodes[0] == GetFreeOrder(0)) {
+            mTrees.erase(it);
+        }
+
+        mBlockPool.Release(block);
+    }
+
+    // Like BuddyBlockAllocator, the node must be the left child, level by level, of parents whose
+    // right child is entirely free. The node is freed then its merged parent allocated instead.
+    MemoryBlock* FlatBuddyBlockAllocator::TryExtendBlock(MemoryBlock* block, uint64_t size) {
+        ASSERT(block != nullptr);
+
+        if (size <= block->Size) {
+            return block;
+        }
+
+        if (size > mRootBlockSize) {
+            return nullptr;
+        }
+
+        auto it = mTrees.find(block->Offset / mRootBlockSize);
+        ASSERT(it != mTrees.end());
+
+        uint8_t* nodes = it->second.get();
+
+        const uint32_t level = Log2(mRootBlockSize) - Log2(block->Size);
+        const uint64_t nodeIndex =
+            GetFirstNodeIndex(level) + (block->Offset % mRootBlockSize) / block->Size;
+        ASSERT(nodes[nodeIndex] == 0);
+
+        uint64_t mergedNodeIndex = nodeIndex;
+        uint32_t mergedLevel = level;
+        for (; GetBlockSize(mergedLevel) < size; mergedLevel--) {
+            // Left children have odd indices.
+            if (mergedNodeIndex % 2 == 0 ||
+                nodes[mergedNodeIndex + 1] != GetFreeOrder(mergedLevel)) {
+                return nullptr;
+            }
+            mergedNodeIndex = (mergedNodeIndex - 1) / 2;
+        }
+
+        nodes[nodeIndex] = GetFreeOrder(level);
+        UpdateParents(nodes, nodeIndex, level);
+
+        ASSERT(nodes[mergedNodeIndex] == GetFreeOrder(mergedLevel));
+        nodes[mergedNodeIndex] = 0;
+        UpdateParents(nodes, mergedNodeIndex, mergedLevel);
+
+        block->Size = GetBlockSize(mergedLevel);
+        return block;
+    }
+
+    uint64_t FlatBuddyBlockAllocator::TryAllocateNode(uint8_t* nodes,
+                                                       uint32_t level,
+                                                       uint64_t alignment) {
+        const uint8_t freeOrder = GetFreeOrder(level);
+        if (nodes[0] < freeOrder) {
+            return kInvalidIndex;
+        }
+
+        uint64_t nodeIndex = 0;
+        if (alignment <= GetBlockSize(level)) {
+            // Any free block is aligned, so descend towards the left-most one large enough.
+            for (uint32_t nodeLevel = 0; nodeLevel < level; nodeLevel++) {
+                const uint64_t leftIndex = 2 * nodeIndex + 1;
+                nodeIndex = (nodes[leftIndex] >= freeOrder) ? leftIndex : leftIndex + 1;
+            }
+        } else {
+            const uint32_t alignmentLevel =
+                (alignment >= mRootBlockSize) ? 0 : Log2(mRootBlockSize) - Log2(alignment);
+            nodeIndex = FindAlignedNode(nodes, 0, 0, alignmentLevel, level);
+            if (nodeIndex == kInvalidIndex) {
+                return kInvalidIndex;
+            }
+        }
+
+        ASSERT(nodes[nodeIndex] == freeOrder);
+        nodes[nodeIndex] = 0;
+        UpdateParents(nodes, nodeIndex, level);
+        return nodeIndex;
+    }
+
+    // Only the left-most block of a node whose size is equal to the alignment is aligned, so
+    // search the nodes of that size for one whose left-most block of |level| is free.
+    uint64_t FlatBuddyBlockAllocator::FindAlignedNode(const uint8_t* nodes,
+                                                      uint64_t nodeIndex,
+                                                      uint32_t nodeLevel,
+                                                      uint32_t alignmentLevel,
+                                                      uint32_t level) const {
+        const uint8_t freeOrder = GetFreeOrder(level);
+        if (nodes[nodeIndex] < freeOrder) {
+            return kInvalidIndex;
+        }
+
+        if (nodeLevel == alignmentLevel) {
+            for (; nodeLevel < level; nodeLevel++) {
+                nodeIndex = 2 * nodeIndex + 1;
+                if (nodes[nodeIndex] < freeOrder) {
+                    return kInvalidIndex;
+                }
+            }
+            return nodeIndex;
+        }
+
+        const uint64_t leftIndex = 2 * nodeIndex + 1;
+        const uint64_t alignedIndex =
+            FindAlignedNode(nodes, leftIndex, nodeLevel + 1, alignmentLevel, level);
+        if (alignedIndex != kInvalidIndex) {
+            return alignedIndex;
+        }
+        return FindAlignedNode(nodes, leftIndex + 1, nodeLevel + 1, alignmentLevel, level);
+    }
+
+    // Ascend from the node to the root, merging buddies which are both entirely free.
+    void FlatBuddyBlockAllocator::UpdateParents(uint8_t* nodes,
+                                                uint64_t nodeIndex,
+                                                uint32_t level) {
+        for (; nodeIndex > 0; level--) {
+            const uint64_t parentIndex = (nodeIndex - 1) / 2;
+            const uint8_t leftOrder = nodes[2 * parentIndex + 1];
+            const uint8_t rightOrder = nodes[2 * parentIndex + 2];
+            if (leftOrder == GetFreeOrder(level) && rightOrder == GetFreeOrder(level)) {
+                nodes[parentIndex] = GetFreeOrder(level - 1);
+            } else {
+                nodes[parentIndex] = std::max(leftOrder, rightOrder);
+            }
+            nodeIndex = parentIndex;
+        }
+    }
+
+    // Only considers roots which contain an allocation, like
+    // ComputeTotalNumOfFreeBlocksForTesting.
+    uint64_t FlatBuddyBlockAllocator::GetLargestFreeBlockSize() const {
+        // The root of each tree stores the free order of its largest free block.
+        uint8_t freeOrder = 0;
+        for (const auto& tree : mTrees) {
+            freeOrder = std::max(freeOrder, tree.second[0]);
+        }
+        return (freeOrder == 0) ? 0 : GetBlockSize(mLevelCount - freeOrder);
+    }
+
+    uint64_t FlatBuddyBlockAllocator::ComputeTotalNumOfFreeBlocksForTesting() const {
+        uint64_t count = 0;
+        for (const auto& tree : mTrees) {
+            const uint8_t* nodes = tree.second.get();
+
+            // Count the entirely free nodes without visiting their children.
+            std::vector<std::pair<uint64_t, uint32_t>> nodesToVisit = {{0, 0}};
+            while (!nodesToVisit.empty()) {
+                const uint64_t nodeIndex = nodesToVisit.back().first;
+                const uint32_t nodeLevel = nodesToVisit.back().second;
+                nodesToVisit.pop_back();
+
+                if (nodes[nodeIndex] == GetFreeOrder(nodeLevel)) {
+                    count++;
+                } else if (nodes[nodeIndex] != 0) {
+                    nodesToVisit.push_back({2 * nodeIndex + 1, nodeLevel + 1});
+                    nodesToVisit.push_back({2 * nodeIndex + 2, nodeLevel + 1});
+                }
+            }
+        }
+        return count;
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,81 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_FLATBUDDYBLOCKALLOCATOR_H_
+#define GPGMM_FLATBUDDYBLOCKALLOCATOR_H_
+
+#include "gpgmm/BlockAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+namespace gpgmm {
+
+    // FlatBuddyBlockAllocator uses the buddy memory allocation technique like BuddyBlockAllocator
+    // but stores each tree implicitly in a flat array instead of linking nodes together. Nodes are
+    // indexed level-by-level (root is 0, children of node i are 2i+1 and 2i+2) so the parent and
+    // buddy of any block is computed, not looked up, and splitting or merging never allocates.
+    //
+    // Each node stores the order of the largest free block within it, which lets a request
+    // descend directly to a free block in O(log n).
+    //
+    // The system of size |maxBlockSize| is partitioned into root blocks of |rootBlockSize|. Only
+    // roots which contain an allocation have a tree, so a very large system costs nothing until
+    // used. Blocks cannot be larger than |rootBlockSize| or smaller than |minBlockSize|.
+    class FlatBuddyBlockAllocator final : public BlockAllocator {
+      public:
+        FlatBuddyBlockAllocator(uint64_t maxBlockSize,
+                                uint64_t rootBlockSize,
+                                uint64_t minBlockSize);
+        ~FlatBuddyBlockAllocator() override = default;
+
+        // BlockAllocator interface
+        MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment) override;
+        void DeallocateBlock(MemoryBlock* block) override;
+        MemoryBlock* TryExtendBlock(MemoryBlock* block, uint64_t size) override;
+        uint64_t GetLargestFreeBlockSize() const override;
+
+        // Only counts free blocks in roots which contain an allocation.
+        uint64_t ComputeTotalNumOfFreeBlocksForTesting() const;
+
+      private:
+        uint64_t TryAllocateNode(uint8_t* nodes, uint32_t level, uint64_t alignment);
+        uint64_t FindAlignedNode(const uint8_t* nodes,
+                                 uint64_t nodeIndex,
+                                 uint32_t nodeLevel,
+                                 uint32_t alignmentLevel,
+                                 uint32_t level) const;
+        void UpdateParents(uint8_t* nodes, uint64_t nodeIndex, uint32_t level);
+
+        uint8_t GetFreeOrder(uint32_t level) const;
+        uint64_t GetBlockSize(uint32_t level) const;
+
+        const uint64_t mMaxBlockSize;
+        const uint64_t mRootBlockSize;
+        const uint64_t mMinBlockSize;
+
+        // Number of levels in each tree, where the root is level 0.
+        const uint32_t mLevelCount;
+
+        // Trees ordered by root index so lower offsets are allocated first.
+        std::map<uint64_t, std::unique_ptr<uint8_t[]>> mTrees;
+
+        ObjectPool<MemoryBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_FLATBUDDYBLOCKALLOCATOR_H_
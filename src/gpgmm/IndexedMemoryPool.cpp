@@ -23,36 +23,72 @@ namespace gpgmm {
     }
 
     std::unique_ptr<MemoryAllocation> IndexedMemoryPool::AcquireFromPool(uint64_t memoryIndex) {
-        if (memoryIndex >= mPool.size()) {
-            mPool.resize(memoryIndex + 1);
+        auto it = mPages.find(memoryIndex / kPageSize);
+        if (it == mPages.end()) {
+            return nullptr;
         }
-        return std::move(mPool[memoryIndex]);
+
+        Page* page = it->second.get();
+        std::unique_ptr<MemoryAllocation> allocation =
+            std::move(page->Slots[memoryIndex % kPageSize]);
+        if (allocation == nullptr) {
+            return nullptr;
+        }
+
+        mPoolSize--;
+        if (--page->Count == 0) {
+            // Kept for the next page needed, since memory is typically returned to the same
+            // index right after being acquired.
+            mSparePage = std::move(it->second);
+            mPages.erase(it);
+        }
+
+        return allocation;
     }
 
     void IndexedMemoryPool::ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
                                          uint64_t memoryIndex) {
         ASSERT(allocation != nullptr);
-        ASSERT(memoryIndex < mPool.size());
-        mPool[memoryIndex] = std::move(allocation);
+
+        std::unique_ptr<Page>& page = mPages[memoryIndex / kPageSize];
+        if (page == nullptr) {
+            page = (mSparePage != nullptr) ? std::move(mSparePage) : std::make_unique<Page>();
+        }
+
+        std::unique_ptr<MemoryAllocation>& slot = page->Slots[memoryIndex % kPageSize];
+        ASSERT(slot == nullptr);
+        slot = std::move(allocation);
+
+        page->Count++;
+        mPoolSize++;
     }
 
-    void IndexedMemoryPool::ReleasePool() {
-        for (auto& allocation : mPool) {
-            if (allocation != nullptr) {
-                allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+    uint64_t IndexedMemoryPool::ReleasePool(uint64_t bytesToRelease) {
+        uint64_t bytesReleased = 0;
+        for (auto it = mPages.begin(); it != mPages.end();) {
+            Page* page = it->second.get();
+            for (auto& allocation : page->Slots) {
+                if (bytesReleased >= bytesToRelease) {
+                    return bytesReleased;
+                }
+                if (allocation != nullptr) {
+                    bytesReleased += allocation->GetSize();
+                    allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+                    page->Count--;
+                    mPoolSize--;
+                }
             }
+
+            ASSERT(page->Count == 0);
+            it = mPages.erase(it);
         }
 
-        mPool.clear();
+        mSparePage = nullptr;
+        return bytesReleased;
     }
 
     uint64_t IndexedMemoryPool::GetPoolSize() const {
-        uint64_t count = 0;
-        for (auto& allocation : mPool) {
-            if (allocation != nullptr) {
-                count++;
-            }
-        }
-        return count;
+        return mPoolSize;
     }
+
 }  // namespace gpgmm
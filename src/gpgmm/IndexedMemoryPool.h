@@ -17,10 +17,15 @@
 
 #include "gpgmm/MemoryPool.h"
 
-#include <vector>
+#include <array>
+#include <unordered_map>
 
 namespace gpgmm {
 
+    // Pool of memory by index. Indices are grouped into fixed-size pages, created once memory is
+    // returned to one of its indices and deleted once empty, then looked up by page number. Memory
+    // overhead stays proportional to the memory pooled rather than the highest index used, which
+    // could be far apart in a large system (ex. offset / memory size).
     class IndexedMemoryPool final : public MemoryPool {
       public:
         explicit IndexedMemoryPool(uint64_t memorySize);
@@ -30,12 +35,21 @@ namespace gpgmm {
         std::unique_ptr<MemoryAllocation> AcquireFromPool(uint64_t memoryIndex) override;
         void ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
                           uint64_t memoryIndex) override;
-        void ReleasePool() override;
+        uint64_t ReleasePool(uint64_t bytesToRelease = kInvalidSize) override;
 
         uint64_t GetPoolSize() const override;
 
       private:
-        std::vector<std::unique_ptr<MemoryAllocation>> mPool;
+        static constexpr uint64_t kPageSize = 64;
+
+        struct Page {
+            std::array<std::unique_ptr<MemoryAllocation>, kPageSize> Slots;
+            uint64_t Count = 0;
+        };
+
+        std::unordered_map<uint64_t, std::unique_ptr<Page>> mPages;
+        std::unique_ptr<Page> mSparePage;
+        uint64_t mPoolSize = 0;
     };
 
 }  // namespace gpgmm
@@ -29,35 +29,56 @@ namespace gpgmm {
 
     // static
     JSONDict JSONSerializer::Serialize(const POOL_INFO& info) {
-        JSONDict dict;
-        dict.AddItem("PoolSizeInBytes", info.PoolSizeInBytes);
-        return dict;
+        return SerializeToDict<JSONSerializer>(info);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const LOG_MESSAGE& desc) {
-        JSONDict dict;
-        dict.AddItem("Description", desc.Description);
-        dict.AddItem("ID", desc.ID);
-        return dict;
+        return SerializeToDict<JSONSerializer>(desc);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const MEMORY_ALLOCATOR_INFO& info) {
-        JSONDict dict;
-        dict.AddItem("UsedBlockCount", info.UsedBlockCount);
-        dict.AddItem("UsedMemoryCount", info.UsedMemoryCount);
-        dict.AddItem("UsedBlockUsage", info.UsedBlockUsage);
-        dict.AddItem("FreeMemoryUsage", info.FreeMemoryUsage);
-        dict.AddItem("UsedMemoryUsage", info.UsedMemoryUsage);
-        return dict;
+        return SerializeToDict<JSONSerializer>(info);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const void* objectPtr) {
-        JSONDict dict;
-        dict.AddItem(TraceEventID::kIdRefKey, ToString(objectPtr));
-        return dict;
+        return SerializeToDict<JSONSerializer>(objectPtr);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const POOL_INFO& info) {
+        writer->AddItem("PoolSizeInBytes", info.PoolSizeInBytes);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const LOG_MESSAGE& desc) {
+        writer->AddItem("Description", desc.Description);
+        writer->AddItem("ID", desc.ID);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const MEMORY_ALLOCATOR_INFO& info) {
+        writer->AddItem("UsedBlockCount", info.UsedBlockCount);
+        writer->AddItem("UsedMemoryCount", info.UsedMemoryCount);
+        writer->AddItem("UsedBlockUsage", info.UsedBlockUsage);
+        writer->AddItem("FreeMemoryUsage", info.FreeMemoryUsage);
+        writer->AddItem("UsedMemoryUsage", info.UsedMemoryUsage);
+        writer->AddItem("EvictedMemoryReuseCount", info.EvictedMemoryReuseCount);
+        writer->AddItem("RetainedMemoryReuseCount", info.RetainedMemoryReuseCount);
+        writer->AddItem("PrefetchedMemoryReuseCount", info.PrefetchedMemoryReuseCount);
+        writer->AddItem("PrefetchedMemoryWaitCount", info.PrefetchedMemoryWaitCount);
+        writer->AddItem("PooledMemoryHitCount", info.PooledMemoryHitCount);
+        writer->AddItem("PooledMemoryMissCount", info.PooledMemoryMissCount);
+        writer->AddItem("PredictedSizeHitCount", info.PredictedSizeHitCount);
+        writer->AddItem("PredictedSizeMissCount", info.PredictedSizeMissCount);
+        writer->AddItem("BestFitWastedUsage", info.BestFitWastedUsage);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const void* objectPtr) {
+        writer->AddItem(TraceEventID::kIdRefKey, ToString(objectPtr));
     }
 
 }  // namespace gpgmm
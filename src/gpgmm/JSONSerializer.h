@@ -31,6 +31,21 @@ namespace gpgmm {
         static JSONDict Serialize(const MEMORY_ALLOCATOR_INFO& info);
         static JSONDict Serialize(const POOL_INFO& desc);
         static JSONDict Serialize(const void* objectPtr);
+
+        // Writes the members of |desc| into the dict open in |writer|, so nested dicts are
+        // written in place.
+        static void Serialize(JSONWriter* writer, const LOG_MESSAGE& desc);
+        static void Serialize(JSONWriter* writer, const MEMORY_ALLOCATOR_INFO& info);
+        static void Serialize(JSONWriter* writer, const POOL_INFO& desc);
+        static void Serialize(JSONWriter* writer, const void* objectPtr);
+
+      protected:
+        template <typename SerializerT, typename T>
+        static JSONDict SerializeToDict(const T& desc) {
+            JSONDict dict;
+            SerializerT::Serialize(dict.GetWriter(), desc);
+            return dict;
+        }
     };
 
 }  // namespace gpgmm
@@ -42,13 +42,19 @@ namespace gpgmm {
         mPool.push_front(std::move(allocation));
     }
 
-    void LIFOMemoryPool::ReleasePool() {
-        for (auto& allocation : mPool) {
+    // Newest allocations are at the front, so release from the back.
+    uint64_t LIFOMemoryPool::ReleasePool(uint64_t bytesToRelease) {
+        uint64_t bytesReleased = 0;
+        while (!mPool.empty() && bytesReleased < bytesToRelease) {
+            std::unique_ptr<MemoryAllocation> allocation = std::move(mPool.back());
+            mPool.pop_back();
+
             ASSERT(allocation != nullptr);
+            bytesReleased += allocation->GetSize();
             allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
         }
 
-        mPool.clear();
+        return bytesReleased;
     }
 
     uint64_t LIFOMemoryPool::GetPoolSize() const {
@@ -21,7 +21,7 @@
 
 namespace gpgmm {
 
-    // Pool using LIFO (newest are recycled first).
+    // Pool using LIFO (newest are recycled first). Oldest are released first.
     class LIFOMemoryPool : public MemoryPool {
       public:
         explicit LIFOMemoryPool(uint64_t memorySize);
@@ -32,7 +32,7 @@ namespace gpgmm {
             uint64_t memoryIndex = kInvalidIndex) override;
         void ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
                           uint64_t memoryIndex = kInvalidIndex) override;
-        void ReleasePool() override;
+        uint64_t ReleasePool(uint64_t bytesToRelease = kInvalidSize) override;
 
         uint64_t GetPoolSize() const override;
 
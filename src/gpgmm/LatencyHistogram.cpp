@@ -0,0 +1,104 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/LatencyHistogram.h"
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gpgmm {
+
+    namespace {
+
+        // Returns the latency of the bucket containing the |percentile| ranked recorded latency.
+        template <size_t BucketCount>
+        uint64_t GetPercentile(const std::array<uint64_t, BucketCount>& counts,
+                               uint64_t totalCount,
+                               double percentile) {
+            const uint64_t rank = std::max<uint64_t>(
+                1, static_cast<uint64_t>(std::ceil(totalCount * percentile)));
+
+            uint64_t countSoFar = 0;
+            for (uint32_t i = 0; i < counts.size(); i++) {
+                countSoFar += counts[i];
+                if (countSoFar >= rank) {
+                    return LatencyHistogram::GetBucketMaxLatency(i);
+                }
+            }
+
+            UNREACHABLE();
+            return 0;
+        }
+
+    }  // namespace
+
+    LatencyHistogram::LatencyHistogram() {
+        for (std::atomic<uint64_t>& bucket : mBuckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void LatencyHistogram::Record(uint64_t latency) {
+        mBuckets[GetBucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    LATENCY_HISTOGRAM_INFO LatencyHistogram::QueryInfo() const {
+        std::array<uint64_t, kBucketCount> counts;
+        uint64_t totalCount = 0;
+        for (uint32_t i = 0; i < kBucketCount; i++) {
+            counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+            totalCount += counts[i];
+        }
+
+        LATENCY_HISTOGRAM_INFO result = {};
+        result.Count = totalCount;
+        if (totalCount == 0) {
+            return result;
+        }
+
+        result.P50 = GetPercentile(counts, totalCount, 0.5);
+        result.P99 = GetPercentile(counts, totalCount, 0.99);
+        result.P999 = GetPercentile(counts, totalCount, 0.999);
+        return result;
+    }
+
+    // static
+    uint32_t LatencyHistogram::GetBucketIndex(uint64_t latency) {
+        if (latency < kSubBucketCount) {
+            return static_cast<uint32_t>(latency);
+        }
+
+        // The highest bits, after the leading one, pick the linear bucket within the range.
+        const uint32_t shift = Log2(latency) - kSubBucketBits;
+        const uint32_t subBucket = static_cast<uint32_t>(latency >> shift) - kSubBucketCount;
+        return (shift + 1) * kSubBucketCount + subBucket;
+    }
+
+    // static
+    uint64_t LatencyHistogram::GetBucketMaxLatency(uint32_t bucketIndex) {
+        ASSERT(bucketIndex < kBucketCount);
+        const uint32_t subBucket = bucketIndex % kSubBucketCount;
+        if (bucketIndex < kSubBucketCount) {
+            return subBucket;
+        }
+
+        const uint32_t shift = bucketIndex / kSubBucketCount - 1;
+        const uint64_t minLatency = static_cast<uint64_t>(kSubBucketCount + subBucket) << shift;
+        return minLatency + ((1ull << shift) - 1);
+    }
+
+}  // namespace gpgmm
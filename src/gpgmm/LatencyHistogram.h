@@ -0,0 +1,72 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_LATENCYHISTOGRAM_H_
+#define GPGMM_LATENCYHISTOGRAM_H_
+
+#include "gpgmm/common/NonCopyable.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace gpgmm {
+
+    // Summary of the latencies recorded by a LatencyHistogram. Percentiles are the highest value
+    // of the bucket the percentile falls in, so they never under-report the latency.
+    struct LATENCY_HISTOGRAM_INFO {
+        // Number of latencies recorded.
+        uint64_t Count = 0;
+
+        // Median latency.
+        uint64_t P50 = 0;
+
+        // 99th and 99.9th percentile (or tail) latency.
+        uint64_t P99 = 0;
+        uint64_t P999 = 0;
+    };
+
+    // LatencyHistogram counts latencies using log-linear buckets, like an HDR histogram. Every
+    // power-of-two range is split into the same number of linear buckets so each bucket is within
+    // 1/16th of the values it counts, whatever their magnitude. Recording is a single relaxed
+    // atomic increment, so any number of threads can record without locking.
+    class LatencyHistogram final : public NonCopyable {
+      public:
+        LatencyHistogram();
+
+        void Record(uint64_t latency);
+
+        // Computes the percentiles from the counts at the time of the call. Latencies recorded
+        // concurrently may or may not be included.
+        LATENCY_HISTOGRAM_INFO QueryInfo() const;
+
+        // Bucket of |latency| and the highest latency it counts. Exposed for testing.
+        static uint32_t GetBucketIndex(uint64_t latency);
+        static uint64_t GetBucketMaxLatency(uint32_t bucketIndex);
+
+      private:
+        // Linear buckets per power-of-two range. Latencies below this are counted exactly.
+        constexpr static uint32_t kSubBucketBits = 4;
+        constexpr static uint32_t kSubBucketCount = 1u << kSubBucketBits;
+
+        // One group of linear buckets for the latencies below kSubBucketCount, then one for each
+        // power-of-two range above it.
+        constexpr static uint32_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+        std::array<std::atomic<uint64_t>, kBucketCount> mBuckets;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_LATENCYHISTOGRAM_H_
@@ -0,0 +1,76 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/LifetimeMemoryAllocator.h"
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+
+namespace gpgmm {
+
+    LifetimeMemoryAllocator::LifetimeMemoryAllocator(
+        std::vector<std::unique_ptr<MemoryAllocator>> allocators) {
+        ASSERT(allocators.size() == kNumOfMemoryAllocationLifetimes);
+        for (size_t i = 0; i < kNumOfMemoryAllocationLifetimes; i++) {
+            mAllocators[i] = AppendChild(std::move(allocators[i]));
+        }
+    }
+
+    std::unique_ptr<MemoryAllocation> LifetimeMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "LifetimeMemoryAllocator.TryAllocateMemory");
+
+        return GetAllocator(request.Lifetime)->TryAllocateMemory(request);
+    }
+
+    void LifetimeMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        // LifetimeMemoryAllocator cannot allocate memory itself, so it must not deallocate.
+        allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+    }
+
+    // Every lifetime is allocated from memory of the same size and alignment.
+    uint64_t LifetimeMemoryAllocator::GetMemorySize() const {
+        return mAllocators.front()->GetMemorySize();
+    }
+
+    uint64_t LifetimeMemoryAllocator::GetMemoryAlignment() const {
+        return mAllocators.front()->GetMemoryAlignment();
+    }
+
+    MEMORY_ALLOCATOR_INFO LifetimeMemoryAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = {};
+        for (const MemoryAllocator* allocator : mAllocators) {
+            result += allocator->QueryInfo();
+        }
+
+        return result;
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO LifetimeMemoryAllocator::QueryFragmentationInfo(
+        MemoryAllocationLifetime lifetime) const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        for (const MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO& layer :
+             GetAllocator(lifetime)->QueryFragmentation()) {
+            result += layer.Info;
+        }
+        return result;
+    }
+
+    MemoryAllocator* LifetimeMemoryAllocator::GetAllocator(
+        MemoryAllocationLifetime lifetime) const {
+        ASSERT(static_cast<size_t>(lifetime) < kNumOfMemoryAllocationLifetimes);
+        return mAllocators[static_cast<size_t>(lifetime)];
+    }
+
+}  // namespace gpgmm
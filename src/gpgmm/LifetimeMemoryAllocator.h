@@ -0,0 +1,60 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_LIFETIMEMEMORYALLOCATOR_H_
+#define GPGMM_LIFETIMEMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+
+#include <array>
+#include <vector>
+
+namespace gpgmm {
+
+    // Allocates depending on the expected lifetime of the requested memory.
+    // Each MemoryAllocationLifetime is allocated by its own allocator, indexed by the lifetime, so
+    // memory released soon is never sub-allocated next to memory which is kept and the memory of
+    // one lifetime cannot be pinned by allocations of another.
+    class LifetimeMemoryAllocator final : public MemoryAllocator {
+      public:
+        // There must be exactly one allocator per MemoryAllocationLifetime.
+        explicit LifetimeMemoryAllocator(
+            std::vector<std::unique_ptr<MemoryAllocator>> allocators);
+        ~LifetimeMemoryAllocator() override = default;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+        // Returns the fragmentation of the allocator used for |lifetime| and every allocator it
+        // allocates memory from.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo(
+            MemoryAllocationLifetime lifetime) const;
+        using MemoryAllocator::QueryFragmentationInfo;
+
+        MemoryAllocator* GetAllocator(MemoryAllocationLifetime lifetime) const;
+
+      private:
+        std::array<MemoryAllocator*, kNumOfMemoryAllocationLifetimes> mAllocators = {};
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_LIFETIMEMEMORYALLOCATOR_H_
@@ -0,0 +1,275 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/LinearMemoryAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/Memory.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+
+namespace gpgmm {
+
+    LinearMemoryAllocator::LinearMemoryAllocator(uint64_t memorySize,
+                                                 uint64_t memoryAlignment,
+                                                 std::unique_ptr<MemoryAllocator> memoryAllocator)
+        : MemoryAllocator(std::move(memoryAllocator)),
+          mMemorySize(memorySize),
+          mMemoryAlignment(memoryAlignment),
+          mUpperOffset(memorySize) {
+        ASSERT(mMemorySize > 0);
+    }
+
+    LinearMemoryAllocator::~LinearMemoryAllocator() {
+        for (LinearMemory& memory : mMemories) {
+            GetFirstChild()->DeallocateMemory(std::move(memory.Allocation));
+        }
+    }
+
+    std::unique_ptr<MemoryAllocation> LinearMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "LinearMemoryAllocator.TryAllocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        GPGMM_CHECK_NONZERO(request.Size);
+
+        if (request.Size > mMemorySize) {
+            DebugEvent("LinearMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Allocation size exceeded the memory size (" << request.Size << " vs "
+                << mMemorySize << " bytes).";
+            return {};
+        }
+
+        if (mMemories.empty() && !TryCreateMemory(request)) {
+            return {};
+        }
+
+        if (request.UpperAddress) {
+            return TryAllocateUpperAddress(request);
+        }
+
+        return TryAllocateLowerAddress(request);
+    }
+
+    // Requires the first memory to exist.
+    std::unique_ptr<MemoryAllocation> LinearMemoryAllocator::TryAllocateLowerAddress(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        const uint64_t lowerOffset = mMemories[mMemoryIndex].LowerOffset;
+        const uint64_t alignedOffset = AlignTo(lowerOffset, request.Alignment);
+        if (alignedOffset + request.Size <= GetLowerLimit()) {
+            return CreateSubAllocation(mMemoryIndex, alignedOffset, request.Size, lowerOffset,
+                                       /*isUpperAddress*/ false);
+        }
+
+        // Does not fit, move on to the next memory. The rest of the current memory is only
+        // re-used once the allocator is reset.
+        if (mMemoryIndex + 1 == mMemories.size() && !TryCreateMemory(request)) {
+            return {};
+        }
+
+        mMemoryIndex++;
+        mMemories[mMemoryIndex].LowerOffset = 0;
+
+        return CreateSubAllocation(mMemoryIndex, /*offset*/ 0, request.Size, /*prevStackOffset*/ 0,
+                                   /*isUpperAddress*/ false);
+    }
+
+    // Upper allocations are only made from the first memory, so the lower allocations are the
+    // limit only while they are still within it.
+    std::unique_ptr<MemoryAllocation> LinearMemoryAllocator::TryAllocateUpperAddress(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        const uint64_t lowerOffset = mMemories[0].LowerOffset;
+        const uint64_t alignment = std::max<uint64_t>(request.Alignment, 1);
+        if (request.Size > mUpperOffset - lowerOffset) {
+            DebugEvent("LinearMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Both ends of the memory met.";
+            return {};
+        }
+
+        const uint64_t alignedOffset = ((mUpperOffset - request.Size) / alignment) * alignment;
+        if (alignedOffset < lowerOffset) {
+            DebugEvent("LinearMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Both ends of the memory met.";
+            return {};
+        }
+
+        return CreateSubAllocation(/*memoryIndex*/ 0, alignedOffset, request.Size, mUpperOffset,
+                                   /*isUpperAddress*/ true);
+    }
+
+    bool LinearMemoryAllocator::TryCreateMemory(const MEMORY_ALLOCATION_REQUEST& request) {
+        MEMORY_ALLOCATION_REQUEST memoryRequest = request;
+        memoryRequest.Size = mMemorySize;
+        memoryRequest.Alignment = mMemoryAlignment;
+        memoryRequest.UpperAddress = false;
+
+        std::unique_ptr<MemoryAllocation> memory =
+            GetFirstChild()->TryAllocateMemory(memoryRequest);
+        if (memory == nullptr) {
+            return false;
+        }
+
+        LinearMemory linearMemory = {};
+        linearMemory.Allocation = std::move(memory);
+        mMemories.push_back(std::move(linearMemory));
+        return true;
+    }
+
+    std::unique_ptr<MemoryAllocation> LinearMemoryAllocator::CreateSubAllocation(
+        uint64_t memoryIndex,
+        uint64_t offset,
+        uint64_t size,
+        uint64_t prevStackOffset,
+        bool isUpperAddress) {
+        if (isUpperAddress) {
+            mUpperOffset = offset;
+        } else {
+            mMemories[memoryIndex].LowerOffset = offset + size;
+        }
+
+        LinearBlock* block = mBlockPool.Acquire();
+        block->Offset = offset;
+        block->Size = size;
+        block->MemoryIndex = memoryIndex;
+        block->PrevStackOffset = prevStackOffset;
+        block->IsUpperAddress = isUpperAddress;
+
+        mInfo.UsedBlockCount++;
+        mInfo.UsedBlockUsage += size;
+
+        MemoryBase* memory = mMemories[memoryIndex].Allocation->GetMemory();
+        ASSERT(memory != nullptr);
+        memory->Ref();
+
+        return std::make_unique<MemoryAllocation>(/*allocator*/ this, memory, offset,
+                                                  AllocationMethod::kSubAllocated, block);
+    }
+
+    void LinearMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "LinearMemoryAllocator.DeallocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        LinearBlock* block = static_cast<LinearBlock*>(subAllocation->GetBlock());
+        ASSERT(block != nullptr);
+
+        // Only the most recent allocation of either end gives back its space, like a stack.
+        // Anything else is only re-used once the allocator is reset.
+        if (block->IsUpperAddress) {
+            if (block->Offset == mUpperOffset) {
+                mUpperOffset = block->PrevStackOffset;
+            }
+        } else if (block->MemoryIndex == mMemoryIndex &&
+                   block->Offset + block->Size == mMemories[mMemoryIndex].LowerOffset) {
+            mMemories[mMemoryIndex].LowerOffset = block->PrevStackOffset;
+
+            // Once empty, go back to the previous memory so its end can be popped too.
+            if (mMemoryIndex > 0 && mMemories[mMemoryIndex].LowerOffset == 0) {
+                mMemoryIndex--;
+            }
+        }
+
+        mInfo.UsedBlockCount--;
+        mInfo.UsedBlockUsage -= block->Size;
+
+        subAllocation->GetMemory()->Unref();
+        mBlockPool.Release(block);
+    }
+
+    bool LinearMemoryAllocator::Reset() {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "LinearMemoryAllocator.Reset");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mInfo.UsedBlockCount.Load() > 0) {
+            return false;
+        }
+
+        // Memory after the first has its offset reset once moved on to.
+        mMemoryIndex = 0;
+        mUpperOffset = mMemorySize;
+        if (!mMemories.empty()) {
+            mMemories[0].LowerOffset = 0;
+        }
+
+        return true;
+    }
+
+    // Memory is returned to the child allocator, which releases it, so only the bytes it
+    // released are counted.
+    uint64_t LinearMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Without allocations, every memory can be returned.
+        const bool isEmpty = mInfo.UsedBlockCount.Load() == 0;
+        if (isEmpty) {
+            mMemoryIndex = 0;
+            mUpperOffset = mMemorySize;
+        }
+
+        // Memory after the current one contains no allocation.
+        const uint64_t usedMemoryCount = isEmpty ? 0 : mMemoryIndex + 1;
+        while (mMemories.size() > usedMemoryCount) {
+            GetFirstChild()->DeallocateMemory(std::move(mMemories.back().Allocation));
+            mMemories.pop_back();
+        }
+
+        return GetFirstChild()->ReleaseMemory(bytesToRelease);
+    }
+
+    uint64_t LinearMemoryAllocator::GetLowerLimit() const {
+        return (mMemoryIndex == 0) ? mUpperOffset : mMemorySize;
+    }
+
+    uint64_t LinearMemoryAllocator::GetMemorySize() const {
+        return mMemorySize;
+    }
+
+    uint64_t LinearMemoryAllocator::GetMemoryAlignment() const {
+        return mMemoryAlignment;
+    }
+
+    uint64_t LinearMemoryAllocator::GetMemoryCountForTesting() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mMemories.size();
+    }
+
+    MEMORY_ALLOCATOR_INFO LinearMemoryAllocator::QueryInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
+        result += GetFirstChild()->QueryInfo();
+        return result;
+    }
+
+    // Only the space left between both ends of the current memory can be allocated from until
+    // the allocator is reset.
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO LinearMemoryAllocator::QueryFragmentationInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        if (mInfo.UsedBlockCount.Load() == 0 || mMemories.empty()) {
+            return result;
+        }
+
+        result.FreeBlockUsage = GetLowerLimit() - mMemories[mMemoryIndex].LowerOffset;
+        result.LargestFreeBlockSize = result.FreeBlockUsage;
+        return result;
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,104 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_LINEARMEMORYALLOCATOR_H_
+#define GPGMM_LINEARMEMORYALLOCATOR_H_
+
+#include "gpgmm/BlockAllocator.h"
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <memory>
+#include <vector>
+
+namespace gpgmm {
+
+    // LinearMemoryAllocator sub-allocates memory of |memorySize| by bumping an offset, moving on
+    // to the next memory once the end is reached. Memory is created upon first use and kept, so
+    // allocating costs no more than aligning an offset. This suits per-frame data which is freed
+    // all at once, by calling Reset once every allocation was deallocated.
+    //
+    // Deallocating the most recent allocation frees its space right away, so the allocator can
+    // also be used as a stack. Requests with UpperAddress are allocated from the end of the first
+    // memory instead, growing down towards the other allocations (ie. a double-ended stack).
+    //
+    // The MemoryAllocator should return memory that is all compatible with each other.
+    class LinearMemoryAllocator final : public MemoryAllocator {
+      public:
+        LinearMemoryAllocator(uint64_t memorySize,
+                              uint64_t memoryAlignment,
+                              std::unique_ptr<MemoryAllocator> memoryAllocator);
+        ~LinearMemoryAllocator() override;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+        // Releases memory no allocation could be in, last created first.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
+
+        // Frees the space of every allocation at once, in constant time, without releasing any
+        // memory. Returns false, and frees nothing, if any allocation was not deallocated.
+        bool Reset();
+
+        uint64_t GetMemoryCountForTesting() const;
+
+      private:
+        struct LinearBlock : public MemoryBlock {
+            uint64_t MemoryIndex = 0;
+
+            // Offset of the stack the block was allocated from, before it was.
+            uint64_t PrevStackOffset = 0;
+
+            bool IsUpperAddress = false;
+        };
+
+        struct LinearMemory {
+            std::unique_ptr<MemoryAllocation> Allocation;
+
+            // End of the allocations, from the start of the memory. Only valid up to the current
+            // memory.
+            uint64_t LowerOffset = 0;
+        };
+
+        std::unique_ptr<MemoryAllocation> TryAllocateLowerAddress(
+            const MEMORY_ALLOCATION_REQUEST& request);
+        std::unique_ptr<MemoryAllocation> TryAllocateUpperAddress(
+            const MEMORY_ALLOCATION_REQUEST& request);
+        bool TryCreateMemory(const MEMORY_ALLOCATION_REQUEST& request);
+        std::unique_ptr<MemoryAllocation> CreateSubAllocation(uint64_t memoryIndex,
+                                                              uint64_t offset,
+                                                              uint64_t size,
+                                                              uint64_t prevStackOffset,
+                                                              bool isUpperAddress);
+        uint64_t GetLowerLimit() const;
+
+        const uint64_t mMemorySize;
+        const uint64_t mMemoryAlignment;
+
+        // Guarded by mMutex.
+        std::vector<LinearMemory> mMemories;
+        uint64_t mMemoryIndex = 0;  // Memory the lower allocations end in.
+        uint64_t mUpperOffset = 0;  // Start of the upper allocations, within the first memory.
+        ObjectPool<LinearBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_LINEARMEMORYALLOCATOR_H_
@@ -0,0 +1,164 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/LockFreeMemoryPool.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/MemoryAllocation.h"
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+namespace gpgmm {
+
+    namespace {
+
+        constexpr uint32_t kInvalidNodeIndex = 0;
+
+        uint32_t GetHeadIndex(uint64_t head) {
+            return static_cast<uint32_t>(head);
+        }
+
+        uint64_t MakeHead(uint64_t prevHead, uint32_t nodeIndex) {
+            const uint64_t tag = (prevHead >> 32) + 1;
+            return (tag << 32) | nodeIndex;
+        }
+
+    }  // namespace
+
+    LockFreeMemoryPool::LockFreeMemoryPool(uint64_t memorySize) : MemoryPool(memorySize) {
+        for (auto& chunk : mChunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeMemoryPool::~LockFreeMemoryPool() {
+        for (auto& chunk : mChunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::unique_ptr<MemoryAllocation> LockFreeMemoryPool::AcquireFromPool(uint64_t memoryIndex) {
+        ASSERT(memoryIndex == kInvalidIndex);
+
+        const uint32_t nodeIndex = Pop(&mAllocationsHead);
+        if (nodeIndex == kInvalidNodeIndex) {
+            return {};
+        }
+
+        mPoolSize.fetch_sub(1, std::memory_order_relaxed);
+
+        Node* node = GetNode(nodeIndex);
+        std::unique_ptr<MemoryAllocation> allocation = std::move(node->Allocation);
+        Push(&mFreeNodesHead, nodeIndex);
+
+        ASSERT(allocation != nullptr);
+        return allocation;
+    }
+
+    void LockFreeMemoryPool::ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
+                                          uint64_t memoryIndex) {
+        ASSERT(memoryIndex == kInvalidIndex);
+        ASSERT(allocation != nullptr);
+
+        const uint32_t nodeIndex = AcquireNode();
+        GetNode(nodeIndex)->Allocation = std::move(allocation);
+
+        // Counted before it could be acquired so the size never underflows.
+        mPoolSize.fetch_add(1, std::memory_order_relaxed);
+        Push(&mAllocationsHead, nodeIndex);
+    }
+
+    uint64_t LockFreeMemoryPool::ReleasePool(uint64_t bytesToRelease) {
+        uint64_t bytesReleased = 0;
+        while (bytesReleased < bytesToRelease) {
+            std::unique_ptr<MemoryAllocation> allocation = AcquireFromPool();
+            if (allocation == nullptr) {
+                break;
+            }
+
+            bytesReleased += allocation->GetSize();
+            allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+        }
+
+        return bytesReleased;
+    }
+
+    uint64_t LockFreeMemoryPool::GetPoolSize() const {
+        return mPoolSize.load(std::memory_order_relaxed);
+    }
+
+    LockFreeMemoryPool::Node* LockFreeMemoryPool::GetNode(uint32_t nodeIndex) const {
+        ASSERT(nodeIndex != kInvalidNodeIndex);
+
+        const uint32_t index = nodeIndex - 1;
+        const uint32_t chunkIndex = Log2(index / kNodesPerFirstChunk + 1);
+        const uint32_t firstIndexInChunk = kNodesPerFirstChunk * ((1u << chunkIndex) - 1);
+
+        Node* chunk = mChunks[chunkIndex].load(std::memory_order_acquire);
+        ASSERT(chunk != nullptr);
+        return &chunk[index - firstIndexInChunk];
+    }
+
+    // Re-uses an unused node or otherwise, claims a new one and creates its chunk if needed.
+    uint32_t LockFreeMemoryPool::AcquireNode() {
+        const uint32_t freeNodeIndex = Pop(&mFreeNodesHead);
+        if (freeNodeIndex != kInvalidNodeIndex) {
+            return freeNodeIndex;
+        }
+
+        const uint32_t index = mNodeCount.fetch_add(1, std::memory_order_relaxed);
+        const uint32_t chunkIndex = Log2(index / kNodesPerFirstChunk + 1);
+        ASSERT(chunkIndex < kMaxChunkCount);
+
+        if (mChunks[chunkIndex].load(std::memory_order_acquire) == nullptr) {
+            Node* newChunk = new Node[kNodesPerFirstChunk << chunkIndex];
+            Node* expectedChunk = nullptr;
+            if (!mChunks[chunkIndex].compare_exchange_strong(expectedChunk, newChunk,
+                                                             std::memory_order_acq_rel)) {
+                // Another thread created the chunk first.
+                delete[] newChunk;
+            }
+        }
+
+        return index + 1;
+    }
+
+    void LockFreeMemoryPool::Push(std::atomic<uint64_t>* head, uint32_t nodeIndex) {
+        Node* node = GetNode(nodeIndex);
+        uint64_t prevHead = head->load(std::memory_order_relaxed);
+        do {
+            node->Next.store(GetHeadIndex(prevHead), std::memory_order_relaxed);
+        } while (!head->compare_exchange_weak(prevHead, MakeHead(prevHead, nodeIndex),
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    uint32_t LockFreeMemoryPool::Pop(std::atomic<uint64_t>* head) {
+        uint64_t prevHead = head->load(std::memory_order_acquire);
+        while (GetHeadIndex(prevHead) != kInvalidNodeIndex) {
+            // The node may be popped by another thread in the meantime, in which case the tag
+            // will have changed and the exchange fails.
+            const uint32_t nextIndex =
+                GetNode(GetHeadIndex(prevHead))->Next.load(std::memory_order_relaxed);
+            if (head->compare_exchange_weak(prevHead, MakeHead(prevHead, nextIndex),
+                                            std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                return GetHeadIndex(prevHead);
+            }
+        }
+        return kInvalidNodeIndex;
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,74 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_LOCKFREEMEMORYPOOL_H_
+#define GPGMM_LOCKFREEMEMORYPOOL_H_
+
+#include "gpgmm/MemoryPool.h"
+
+#include <array>
+#include <atomic>
+
+namespace gpgmm {
+
+    // Thread-safe pool using LIFO (newest are recycled first) which never blocks.
+    // Allocations are kept in a lock-free (Treiber) stack of nodes. Nodes are referenced by index
+    // and the stack head is tagged with a counter which is incremented on every update, so a node
+    // which is popped and pushed again in between cannot be mistaken for the original (ABA).
+    // Nodes are never freed until the pool is destroyed so they can always be safely read.
+    class LockFreeMemoryPool : public MemoryPool {
+      public:
+        explicit LockFreeMemoryPool(uint64_t memorySize);
+        ~LockFreeMemoryPool() override;
+
+        // MemoryPool interface
+        std::unique_ptr<MemoryAllocation> AcquireFromPool(
+            uint64_t memoryIndex = kInvalidIndex) override;
+        void ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
+                          uint64_t memoryIndex = kInvalidIndex) override;
+        uint64_t ReleasePool(uint64_t bytesToRelease = kInvalidSize) override;
+
+        uint64_t GetPoolSize() const override;
+
+      private:
+        struct Node {
+            std::unique_ptr<MemoryAllocation> Allocation;
+            std::atomic<uint32_t> Next;
+        };
+
+        // Chunk k holds |kNodesPerFirstChunk| << k nodes, so the pool can grow without ever
+        // moving nodes.
+        static constexpr uint32_t kNodesPerFirstChunk = 64;
+        static constexpr uint32_t kMaxChunkCount = 25;
+
+        Node* GetNode(uint32_t nodeIndex) const;
+        uint32_t AcquireNode();
+
+        void Push(std::atomic<uint64_t>* head, uint32_t nodeIndex);
+        uint32_t Pop(std::atomic<uint64_t>* head);
+
+        // Heads of the stacks of pooled allocations and unused nodes. The lower 32 bits are the
+        // top node index, plus one so zero means empty, and the upper 32 bits are the tag.
+        std::atomic<uint64_t> mAllocationsHead = {0};
+        std::atomic<uint64_t> mFreeNodesHead = {0};
+
+        std::array<std::atomic<Node*>, kMaxChunkCount> mChunks;
+        std::atomic<uint32_t> mNodeCount = {0};
+
+        std::atomic<uint64_t> mPoolSize = {0};
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_LOCKFREEMEMORYPOOL_H_
@@ -0,0 +1,257 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/MagazineMemoryAllocator.h"
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Math.h"
+
+#include <unordered_map>
+
+namespace gpgmm {
+
+    namespace {
+
+        // Limits the number of block sizes each thread caches. Requests of any other size go
+        // directly to the memory allocator.
+        constexpr size_t kMaxMagazinesPerThread = 16;
+
+        std::atomic<uint64_t> gNextAllocatorID{0};
+
+        bool IsOffsetAligned(uint64_t offset, uint64_t alignment) {
+            return alignment <= 1 || (offset % alignment) == 0;
+        }
+
+    }  // namespace
+
+    MagazineMemoryAllocator::MagazineMemoryAllocator(
+        std::unique_ptr<MemoryAllocator> memoryAllocator,
+        uint64_t minBlockSize,
+        uint64_t magazineSize)
+        : MemoryAllocator(std::move(memoryAllocator)),
+          mMinBlockSize(minBlockSize),
+          mMagazineSize(magazineSize),
+          mAllocatorID(gNextAllocatorID.fetch_add(1, std::memory_order_relaxed)) {
+        ASSERT(mMinBlockSize > 0);
+        ASSERT(mMagazineSize > 0);
+    }
+
+    MagazineMemoryAllocator::~MagazineMemoryAllocator() {
+        // No other thread may use the allocator once it is being destroyed, so every thread's
+        // magazines are returned then freed from here.
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& threadMagazines : mThreadMagazines) {
+            std::lock_guard<std::mutex> threadLock(threadMagazines->Mutex);
+            DrainThreadMagazines(threadMagazines.get());
+        }
+        mThreadMagazines.clear();
+    }
+
+    std::unique_ptr<MemoryAllocation> MagazineMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "MagazineMemoryAllocator.TryAllocateMemory");
+
+        GPGMM_CHECK_NONZERO(request.Size);
+
+        ThreadMagazines* threadMagazines = GetOrCreateThreadMagazines();
+        std::lock_guard<std::mutex> threadLock(threadMagazines->Mutex);
+
+        const uint64_t blockSize = AlignTo(request.Size, mMinBlockSize);
+        Magazine* magazine = GetOrCreateMagazine(threadMagazines, blockSize);
+
+        // Fast-path: re-use the most recently cached block without locking.
+        if (magazine != nullptr && !magazine->Rounds.empty() &&
+            IsOffsetAligned(magazine->Rounds.back()->GetOffset(), request.Alignment)) {
+            std::unique_ptr<MemoryAllocation> allocation = std::move(magazine->Rounds.back());
+            magazine->Rounds.pop_back();
+
+            mCachedBlockCount--;
+            mCachedBlockUsage -= allocation->GetSize();
+
+            allocation->SetAllocator(this);
+            return allocation;
+        }
+
+        MEMORY_ALLOCATION_REQUEST blockRequest = request;
+        blockRequest.Size = blockSize;
+
+        std::unique_ptr<MemoryAllocation> allocation;
+        GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(blockRequest), allocation);
+
+        // Refill up to half the magazine so the next requests of the same size can be satisfied
+        // without calling into the memory allocator again. Only blocks from memory that already
+        // exists are cached, so refilling never grows the memory footprint.
+        if (magazine != nullptr) {
+            MEMORY_ALLOCATION_REQUEST roundRequest = blockRequest;
+            roundRequest.NeverAllocate = true;
+            roundRequest.CacheSize = false;
+            roundRequest.PrefetchMemory = false;
+
+            while (magazine->Rounds.size() < mMagazineSize / 2) {
+                std::unique_ptr<MemoryAllocation> round =
+                    GetFirstChild()->TryAllocateMemory(roundRequest);
+                if (round == nullptr) {
+                    break;
+                }
+
+                mCachedBlockCount++;
+                mCachedBlockUsage += round->GetSize();
+
+                magazine->Rounds.push_back(std::move(round));
+            }
+        }
+
+        allocation->SetAllocator(this);
+        return allocation;
+    }
+
+    void MagazineMemoryAllocator::DeallocateMemory(
+        std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "MagazineMemoryAllocator.DeallocateMemory");
+
+        ThreadMagazines* threadMagazines = GetOrCreateThreadMagazines();
+        std::lock_guard<std::mutex> threadLock(threadMagazines->Mutex);
+
+        Magazine* magazine = GetOrCreateMagazine(threadMagazines, subAllocation->GetSize());
+        if (magazine == nullptr) {
+            GetFirstChild()->DeallocateMemory(std::move(subAllocation));
+            return;
+        }
+
+        // Keep half the magazine when full so alternating allocate and deallocate requests do
+        // not repeatedly drain and refill it.
+        if (magazine->Rounds.size() >= mMagazineSize) {
+            DrainMagazine(magazine, mMagazineSize / 2);
+        }
+
+        // The allocation could be derived from MemoryAllocation (ex. a resource allocation) which
+        // must not outlive the deallocation request, so only the sub-allocated block is cached.
+        std::unique_ptr<MemoryAllocation> round = std::make_unique<MemoryAllocation>(
+            GetFirstChild(), subAllocation->GetMemory(), subAllocation->GetOffset(),
+            subAllocation->GetMethod(), subAllocation->GetBlock(),
+            subAllocation->GetMappedPointer());
+
+        mCachedBlockCount++;
+        mCachedBlockUsage += round->GetSize();
+
+        magazine->Rounds.push_back(std::move(round));
+    }
+
+    uint64_t MagazineMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        // Magazines are drained one thread at a time, so only the thread whose magazines are
+        // being drained waits.
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto& threadMagazines : mThreadMagazines) {
+                std::lock_guard<std::mutex> threadLock(threadMagazines->Mutex);
+                DrainThreadMagazines(threadMagazines.get());
+            }
+        }
+
+        return GetFirstChild()->ReleaseMemory(bytesToRelease);
+    }
+
+    uint64_t MagazineMemoryAllocator::GetMemorySize() const {
+        return GetFirstChild()->GetMemorySize();
+    }
+
+    uint64_t MagazineMemoryAllocator::GetMemoryAlignment() const {
+        return GetFirstChild()->GetMemoryAlignment();
+    }
+
+    MEMORY_ALLOCATOR_INFO MagazineMemoryAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = GetFirstChild()->QueryInfo();
+        result.UsedBlockCount -= static_cast<uint32_t>(mCachedBlockCount.Load());
+        result.UsedBlockUsage -= mCachedBlockUsage.Load();
+        return result;
+    }
+
+    // Cached blocks are kept instead of being de-allocated, so they are pooled.
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO MagazineMemoryAllocator::QueryFragmentationInfo() const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        result.PooledMemoryUsage = mCachedBlockUsage.Load();
+        return result;
+    }
+
+    uint64_t MagazineMemoryAllocator::GetCachedBlockCountForTesting() const {
+        return mCachedBlockCount.Load();
+    }
+
+    MagazineMemoryAllocator::ThreadMagazines*
+    MagazineMemoryAllocator::GetOrCreateThreadMagazines() {
+        // The raw pointer is only used while the allocator, which owns the magazines, is alive.
+        // The weak reference tells which entries belong to destroyed allocators.
+        struct ThreadMagazinesEntry {
+            ThreadMagazines* Magazines;
+            std::weak_ptr<ThreadMagazines> Owner;
+        };
+        static thread_local std::unordered_map<uint64_t, ThreadMagazinesEntry> tlsThreadMagazines;
+
+        auto it = tlsThreadMagazines.find(mAllocatorID);
+        if (it != tlsThreadMagazines.end()) {
+            return it->second.Magazines;
+        }
+
+        // Entries of destroyed allocators are never looked-up again since allocator IDs are
+        // unique, so they are removed before this thread adds another.
+        for (auto entry = tlsThreadMagazines.begin(); entry != tlsThreadMagazines.end();) {
+            entry = entry->second.Owner.expired() ? tlsThreadMagazines.erase(entry) : ++entry;
+        }
+
+        // Only taken once per thread.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreadMagazines.push_back(std::make_shared<ThreadMagazines>());
+        const std::shared_ptr<ThreadMagazines>& threadMagazines = mThreadMagazines.back();
+        tlsThreadMagazines.emplace(mAllocatorID,
+                                   ThreadMagazinesEntry{threadMagazines.get(), threadMagazines});
+        return threadMagazines.get();
+    }
+
+    MagazineMemoryAllocator::Magazine* MagazineMemoryAllocator::GetOrCreateMagazine(
+        ThreadMagazines* threadMagazines,
+        uint64_t blockSize) {
+        for (Magazine& magazine : threadMagazines->Magazines) {
+            if (magazine.BlockSize == blockSize) {
+                return &magazine;
+            }
+        }
+
+        if (threadMagazines->Magazines.size() >= kMaxMagazinesPerThread) {
+            return nullptr;
+        }
+
+        threadMagazines->Magazines.push_back(Magazine{blockSize, {}});
+        threadMagazines->Magazines.back().Rounds.reserve(mMagazineSize);
+        return &threadMagazines->Magazines.back();
+    }
+
+    void MagazineMemoryAllocator::DrainMagazine(Magazine* magazine, size_t roundsToKeep) {
+        while (magazine->Rounds.size() > roundsToKeep) {
+            std::unique_ptr<MemoryAllocation> round = std::move(magazine->Rounds.back());
+            magazine->Rounds.pop_back();
+
+            mCachedBlockCount--;
+            mCachedBlockUsage -= round->GetSize();
+
+            GetFirstChild()->DeallocateMemory(std::move(round));
+        }
+    }
+
+    void MagazineMemoryAllocator::DrainThreadMagazines(ThreadMagazines* threadMagazines) {
+        for (Magazine& magazine : threadMagazines->Magazines) {
+            DrainMagazine(&magazine, 0);
+        }
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,95 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_MAGAZINEMEMORYALLOCATOR_H_
+#define GPGMM_MAGAZINEMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gpgmm {
+
+    // MagazineMemoryAllocator caches sub-allocated blocks per-thread in front of another
+    // allocator so the common allocate and deallocate requests never contend on a lock. Each
+    // thread keeps a small stack of blocks, or "magazine", per block size and only calls into the
+    // (locked) memory allocator to refill or drain half a magazine at a time.
+    // See "Magazines and Vmem: Extending the Slab Allocator to Many CPUs and Arbitrary
+    // Resources" by Bonwick and Adams.
+    class MagazineMemoryAllocator final : public MemoryAllocator {
+      public:
+        // |minBlockSize| must match the block size granularity of |memoryAllocator| so blocks
+        // can be re-used for any request which rounds-up to the same size.
+        MagazineMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                uint64_t minBlockSize,
+                                uint64_t magazineSize);
+        ~MagazineMemoryAllocator() override;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+
+        // Blocks cached by every thread are returned, including threads which exited.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+
+        // Cached blocks are not considered used.
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
+
+        uint64_t GetCachedBlockCountForTesting() const;
+
+      private:
+        struct Magazine {
+            uint64_t BlockSize;
+            std::vector<std::unique_ptr<MemoryAllocation>> Rounds;
+        };
+
+        // Used by the thread that created it, so its mutex is only contended when another
+        // thread releases memory.
+        struct ThreadMagazines {
+            std::mutex Mutex;
+            std::vector<Magazine> Magazines;
+        };
+
+        ThreadMagazines* GetOrCreateThreadMagazines();
+        Magazine* GetOrCreateMagazine(ThreadMagazines* threadMagazines, uint64_t blockSize);
+
+        void DrainMagazine(Magazine* magazine, size_t roundsToKeep);
+        void DrainThreadMagazines(ThreadMagazines* threadMagazines);
+
+        const uint64_t mMinBlockSize;
+        const uint64_t mMagazineSize;
+
+        // Identifies this allocator within each thread's list of magazines. Never re-used so a
+        // thread cannot mistake the magazines of a destroyed allocator for a new one.
+        const uint64_t mAllocatorID;
+
+        // Magazines of every thread which used this allocator, guarded by mMutex. Threads only
+        // keep weak references, so the magazines are freed along with the allocator.
+        std::vector<std::shared_ptr<ThreadMagazines>> mThreadMagazines;
+
+        RelaxedCounter<uint64_t> mCachedBlockCount;
+        RelaxedCounter<uint64_t> mCachedBlockUsage;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_MAGAZINEMEMORYALLOCATOR_H_
@@ -40,4 +40,8 @@ namespace gpgmm {
         mPool = pool;
     }
 
+    bool MemoryBase::IsEvicted() const {
+        return false;
+    }
+
 }  // namespace gpgmm
@@ -37,6 +37,10 @@ namespace gpgmm {
         MemoryPool* GetPool() const;
         void SetPool(MemoryPool* pool);
 
+        // Checks if the memory was evicted and must be made resident again before it can be used.
+        // Memory is never evicted unless the backend manages residency.
+        virtual bool IsEvicted() const;
+
       private:
         const uint64_t mSize;
         MemoryPool* mPool = nullptr;
@@ -24,11 +24,11 @@ namespace gpgmm {
 
     MemoryAllocation::MemoryAllocation()
         : mAllocator(nullptr),
-          mMemory(nullptr),
-          mOffset(kInvalidOffset),
-          mMethod(AllocationMethod::kUndefined),
           mBlock(nullptr),
-          mMappedPointer(nullptr) {
+          mMappedPointer(nullptr),
+          mMethod(AllocationMethod::kUndefined),
+          mOffset(kInvalidOffset),
+          mMemory(nullptr) {
     }
 
     MemoryAllocation::MemoryAllocation(MemoryAllocator* allocator,
@@ -38,22 +38,22 @@ namespace gpgmm {
                                        MemoryBlock* block,
                                        uint8_t* mappedPointer)
         : mAllocator(allocator),
-          mMemory(memory),
-          mOffset(offset),
-          mMethod(method),
           mBlock(block),
-          mMappedPointer(mappedPointer) {
+          mMappedPointer(mappedPointer),
+          mMethod(method),
+          mOffset(offset),
+          mMemory(memory) {
     }
 
     MemoryAllocation::MemoryAllocation(MemoryAllocator* allocator,
                                        MemoryBase* memory,
                                        uint8_t* mappedPointer)
         : mAllocator(allocator),
-          mMemory(memory),
-          mOffset(0),
-          mMethod(AllocationMethod::kStandalone),
           mBlock(nullptr),
-          mMappedPointer(mappedPointer) {
+          mMappedPointer(mappedPointer),
+          mMethod(AllocationMethod::kStandalone),
+          mOffset(0),
+          mMemory(memory) {
     }
 
     bool MemoryAllocation::operator==(const MemoryAllocation& other) const {
@@ -73,6 +73,10 @@ namespace gpgmm {
         return mMappedPointer;
     }
 
+    void MemoryAllocation::SetMappedPointer(uint8_t* mappedPointer) {
+        mMappedPointer = mappedPointer;
+    }
+
     MemoryAllocator* MemoryAllocation::GetAllocator() const {
         return mAllocator;
     }
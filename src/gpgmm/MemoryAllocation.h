@@ -80,15 +80,18 @@ namespace gpgmm {
       protected:
         friend class MemoryAllocator;
 
+        void SetMappedPointer(uint8_t* mappedPointer);
+
       private:
+        // Ordered by how often they are used once allocated: memory and offset last, so they are
+        // adjacent to the fields of derived allocations which are used with them.
         MemoryAllocator* mAllocator;
-        MemoryBase* mMemory;
-
-        uint64_t mOffset;  // Offset always local to the memory.
-        AllocationMethod mMethod;
         MemoryBlock* mBlock;
-
         uint8_t* mMappedPointer;
+        AllocationMethod mMethod;
+
+        uint64_t mOffset;  // Offset always local to the memory.
+        MemoryBase* mMemory;
     };
 }  // namespace gpgmm
 
@@ -18,24 +18,77 @@ namespace gpgmm {
 
     class AllocateMemoryTask : public VoidCallback {
       public:
-        AllocateMemoryTask(MemoryAllocator* allocator, uint64_t size, uint64_t alignment)
-            : mAllocator(allocator), mSize(size), mAlignment(alignment) {
+        AllocateMemoryTask(MemoryAllocator* allocator, const MEMORY_ALLOCATION_REQUEST& request)
+            : mAllocator(allocator), mRequest(request) {
         }
 
         void operator()() override {
-            mAllocation = mAllocator->TryAllocateMemory(mSize, mAlignment, /*neverAllocate*/
-                                                        false, true, false);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mIsCancelled) {
+                    return;
+                }
+                mState = State::kRunning;
+            }
+
+            std::unique_ptr<MemoryAllocation> allocation = mAllocator->TryAllocateMemory(mRequest);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mState = State::kCompleted;
+                if (!mIsCancelled) {
+                    mAllocation = std::move(allocation);
+                }
+            }
+
+            if (allocation != nullptr) {
+                mAllocator->DeallocateMemory(std::move(allocation));
+            }
+
+            mAllocator->OnPendingAllocationCompleted();
         }
 
         std::unique_ptr<MemoryAllocation> AcquireAllocation() {
+            std::lock_guard<std::mutex> lock(mMutex);
             return std::move(mAllocation);
         }
 
+        void Cancel() {
+            std::unique_ptr<MemoryAllocation> allocation;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mIsCancelled) {
+                    return;
+                }
+                mIsCancelled = true;
+
+                switch (mState) {
+                    // Never started, so the task will not use the allocator.
+                    case State::kPending:
+                        mAllocator->OnPendingAllocationCompleted();
+                        return;
+                    // The task de-allocates once it completes.
+                    case State::kRunning:
+                        return;
+                    case State::kCompleted:
+                        allocation = std::move(mAllocation);
+                        break;
+                }
+            }
+
+            if (allocation != nullptr) {
+                mAllocator->DeallocateMemory(std::move(allocation));
+            }
+        }
+
       private:
+        enum class State { kPending, kRunning, kCompleted };
+
         MemoryAllocator* const mAllocator;
-        const uint64_t mSize;
-        const uint64_t mAlignment;
+        const MEMORY_ALLOCATION_REQUEST mRequest;
 
+        std::mutex mMutex;
+        State mState = State::kPending;
+        bool mIsCancelled = false;
         std::unique_ptr<MemoryAllocation> mAllocation;
     };
 
@@ -58,10 +111,18 @@ namespace gpgmm {
         return mEvent->Signal();
     }
 
+    void MemoryAllocationEvent::AddSignaledCallback(std::shared_ptr<VoidCallback> callback) {
+        mEvent->AddSignaledCallback(callback);
+    }
+
     std::unique_ptr<MemoryAllocation> MemoryAllocationEvent::AcquireAllocation() const {
         return mTask->AcquireAllocation();
     }
 
+    void MemoryAllocationEvent::Cancel() {
+        mTask->Cancel();
+    }
+
     // MemoryAllocator
 
     MemoryAllocator::MemoryAllocator() : mThreadPool(ThreadPool::Create()) {
@@ -72,29 +133,60 @@ namespace gpgmm {
         AppendChild(std::move(child));
     }
 
-    std::unique_ptr<MemoryAllocation> MemoryAllocator::TryAllocateMemory(uint64_t size,
-                                                                         uint64_t alignment,
-                                                                         bool neverAllocate,
-                                                                         bool cacheSize,
-                                                                         bool prefetchMemory) {
+    std::unique_ptr<MemoryAllocation> MemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
         ASSERT(false);
         return {};
     }
 
     std::shared_ptr<MemoryAllocationEvent> MemoryAllocator::TryAllocateMemoryAsync(
-        uint64_t size,
-        uint64_t alignment) {
+        const MEMORY_ALLOCATION_REQUEST& request,
+        TaskClass taskClass) {
         std::shared_ptr<AllocateMemoryTask> task =
-            std::make_shared<AllocateMemoryTask>(this, size, alignment);
-        return std::make_shared<MemoryAllocationEvent>(ThreadPool::PostTask(mThreadPool, task),
-                                                       task);
+            std::make_shared<AllocateMemoryTask>(this, request);
+        {
+            std::lock_guard<std::mutex> lock(mPendingAllocationMutex);
+            mPendingAllocationCount++;
+        }
+        return std::make_shared<MemoryAllocationEvent>(
+            ThreadPool::PostTask(mThreadPool, task, taskClass), task);
+    }
+
+    void MemoryAllocator::WaitForPendingAllocations() {
+        std::unique_lock<std::mutex> lock(mPendingAllocationMutex);
+        mPendingAllocationCondition.wait(lock, [this] { return mPendingAllocationCount == 0; });
+    }
+
+    // Notified with the lock held, since the allocator could be destroyed as soon as it is
+    // released.
+    void MemoryAllocator::OnPendingAllocationCompleted() {
+        std::lock_guard<std::mutex> lock(mPendingAllocationMutex);
+        ASSERT(mPendingAllocationCount > 0);
+        mPendingAllocationCount--;
+        mPendingAllocationCondition.notify_all();
     }
 
-    void MemoryAllocator::ReleaseMemory() {
+    std::unique_ptr<MemoryAllocation> MemoryAllocator::TryRelocateMemory(
+        const MemoryAllocation& allocation,
+        uint64_t alignment,
+        double maxUsedPercent) {
+        return {};
+    }
+
+    bool MemoryAllocator::TryExtendMemory(MemoryAllocation* allocation, uint64_t size) {
+        return size <= allocation->GetSize();
+    }
+
+    uint64_t MemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
         std::lock_guard<std::mutex> lock(mMutex);
-        for (auto alloc = mChildren.head(); alloc != mChildren.end(); alloc = alloc->next()) {
-            alloc->value()->ReleaseMemory();
+        uint64_t bytesReleased = 0;
+        for (MemoryAllocator* allocator : mChildren) {
+            if (bytesReleased >= bytesToRelease) {
+                break;
+            }
+            bytesReleased += allocator->ReleaseMemory(bytesToRelease - bytesReleased);
         }
+        return bytesReleased;
     }
 
     uint64_t MemoryAllocator::GetMemorySize() const {
@@ -106,8 +198,28 @@ namespace gpgmm {
     }
 
     MEMORY_ALLOCATOR_INFO MemoryAllocator::QueryInfo() const {
-        std::lock_guard<std::mutex> lock(mMutex);
-        return mInfo;
+        return mInfo.Load();
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO MemoryAllocator::QueryFragmentationInfo() const {
+        // Only allocators which pool memory count free memory.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        result.PooledMemoryUsage = mInfo.FreeMemoryUsage.Load();
+        return result;
+    }
+
+    std::vector<MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO> MemoryAllocator::QueryFragmentation()
+        const {
+        std::vector<MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO> layers = {
+            {/*Depth*/ 0, QueryFragmentationInfo()}};
+        for (auto* node = mChildren.head(); node != mChildren.end(); node = node->next()) {
+            for (MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO& layer :
+                 node->value()->QueryFragmentation()) {
+                layer.Depth++;
+                layers.push_back(layer);
+            }
+        }
+        return layers;
     }
 
 }  // namespace gpgmm
@@ -25,11 +25,79 @@
 #include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Limits.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 namespace gpgmm {
 
+    // Expected lifetime of the memory requested.
+    enum class MemoryAllocationLifetime {
+        // Lifetime is unknown.
+        kUnknown = 0,
+
+        // Released soon after being used, often within the same frame.
+        kTransient,
+
+        // Released after a few frames.
+        kFrame,
+
+        // Kept for most of the lifetime of the application.
+        kPersistent,
+    };
+
+    constexpr uint32_t kNumOfMemoryAllocationLifetimes = 4;
+
+    // Relative importance of the memory requested.
+    enum class MemoryAllocationPriority {
+        kNormal = 0,
+        kLow,
+        kHigh,
+    };
+
+    // Describes the memory to allocate along with hints about how it will be used. Hints are
+    // never required to be honored, a memory allocator which does not understand them must
+    // ignore them and forward them to the allocator it allocates memory from.
+    struct MEMORY_ALLOCATION_REQUEST {
+        // Size (in bytes) of the memory to allocate.
+        uint64_t Size;
+
+        // Alignment (in bytes) which the allocated memory must be a multiple of.
+        uint64_t Alignment;
+
+        // When true, the memory allocator will not create memory and may only allocate from memory
+        // it already has.
+        bool NeverAllocate;
+
+        // When true, the memory allocator may cache the requested size to speed-up subsequent
+        // requests of the same size.
+        bool CacheSize;
+
+        // When true, the memory allocator may allocate additional memory ahead of subsequent
+        // requests. Memory allocators may also refuse prefetched memory, for example, when it
+        // would exceed the budget.
+        bool PrefetchMemory;
+
+        // Expected lifetime of the memory.
+        MemoryAllocationLifetime Lifetime;
+
+        // Relative priority of the memory.
+        MemoryAllocationPriority Priority;
+
+        // When true, the memory is allocated from the upper end of the memory instead, by
+        // allocators which grow from both ends (ie. a double-ended stack). Ignored by the others.
+        bool UpperAddress;
+
+        // When non-zero, the largest size (in bytes) of memory the memory allocator should create
+        // for the request, ex. the budget remaining. Memory allocators which create memory larger
+        // than the request use smaller memory instead or refuse the request so it gets dedicated
+        // memory. Zero means no limit.
+        uint64_t MemorySizeLimit;
+    };
+
     struct MEMORY_ALLOCATOR_INFO {
         // Number of used sub-allocated blocks within the same memory.
         uint32_t UsedBlockCount;
@@ -46,16 +114,162 @@ namespace gpgmm {
         // Total size (in bytes) of free memory.
         uint64_t FreeMemoryUsage;
 
+        // Number of times evicted memory was re-used because no resident memory was available.
+        uint64_t EvictedMemoryReuseCount;
+
+        // Number of times memory kept once empty, instead of being de-allocated, was re-used.
+        uint64_t RetainedMemoryReuseCount;
+
+        // Number of times memory allocated ahead of time (prefetched) was used, and how many of
+        // those had to wait for the prefetch to complete.
+        uint64_t PrefetchedMemoryReuseCount;
+        uint64_t PrefetchedMemoryWaitCount;
+
+        // Number of times memory was re-used from a pool (hits), or allocated since none was
+        // pooled (misses).
+        uint64_t PooledMemoryHitCount;
+        uint64_t PooledMemoryMissCount;
+
+        // Number of allocations whose size was predicted by the allocation before it (hits), or
+        // which followed a prediction of another size (misses).
+        uint64_t PredictedSizeHitCount;
+        uint64_t PredictedSizeMissCount;
+
+        // Total size (in bytes) of used memory which exceeds the size requested for it, since
+        // larger pooled memory was re-used instead (best-fit).
+        uint64_t BestFitWastedUsage;
+
         MEMORY_ALLOCATOR_INFO& operator+=(const MEMORY_ALLOCATOR_INFO& rhs) {
             UsedBlockCount += rhs.UsedBlockCount;
             UsedBlockUsage += rhs.UsedBlockUsage;
             FreeMemoryUsage += rhs.FreeMemoryUsage;
             UsedMemoryUsage += rhs.UsedMemoryUsage;
             UsedMemoryCount += rhs.UsedMemoryCount;
+            EvictedMemoryReuseCount += rhs.EvictedMemoryReuseCount;
+            RetainedMemoryReuseCount += rhs.RetainedMemoryReuseCount;
+            PrefetchedMemoryReuseCount += rhs.PrefetchedMemoryReuseCount;
+            PrefetchedMemoryWaitCount += rhs.PrefetchedMemoryWaitCount;
+            PooledMemoryHitCount += rhs.PooledMemoryHitCount;
+            PooledMemoryMissCount += rhs.PooledMemoryMissCount;
+            PredictedSizeHitCount += rhs.PredictedSizeHitCount;
+            PredictedSizeMissCount += rhs.PredictedSizeMissCount;
+            BestFitWastedUsage += rhs.BestFitWastedUsage;
+            return *this;
+        }
+    };
+
+    struct MEMORY_ALLOCATOR_FRAGMENTATION_INFO {
+        // Total size (in bytes) of used blocks which exceeds the size requested for them (ie.
+        // internal fragmentation).
+        uint64_t InternalFragmentationUsage;
+
+        // Total size (in bytes) of free blocks within memory which contains a used block.
+        uint64_t FreeBlockUsage;
+
+        // Size (in bytes) of the largest of those free blocks.
+        uint64_t LargestFreeBlockSize;
+
+        // Total size (in bytes) of memory which is kept in a pool (or cache) instead of being
+        // released.
+        uint64_t PooledMemoryUsage;
+
+        // Fraction of free blocks that cannot be used by a request for the size of all of them
+        // (ie. external fragmentation). Zero when every free block is contiguous.
+        double GetExternalFragmentation() const {
+            if (FreeBlockUsage == 0) {
+                return 0;
+            }
+            return 1.0 - (LargestFreeBlockSize / static_cast<double>(FreeBlockUsage));
+        }
+
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO& operator+=(
+            const MEMORY_ALLOCATOR_FRAGMENTATION_INFO& rhs) {
+            InternalFragmentationUsage += rhs.InternalFragmentationUsage;
+            FreeBlockUsage += rhs.FreeBlockUsage;
+            LargestFreeBlockSize = std::max(LargestFreeBlockSize, rhs.LargestFreeBlockSize);
+            PooledMemoryUsage += rhs.PooledMemoryUsage;
             return *this;
         }
     };
 
+    // Fragmentation of a single allocator in the tree of allocators queried.
+    struct MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO {
+        // Number of allocators between this allocator and the allocator queried.
+        uint32_t Depth;
+
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO Info;
+    };
+
+    // Counter which is updated and read using relaxed atomics. Allocator statistics are only
+    // ever observed as a snapshot, so they need not be ordered with any other memory operation.
+    template <typename T>
+    class RelaxedCounter {
+      public:
+        RelaxedCounter& operator+=(T value) {
+            mValue.fetch_add(value, std::memory_order_relaxed);
+            return *this;
+        }
+
+        RelaxedCounter& operator-=(T value) {
+            mValue.fetch_sub(value, std::memory_order_relaxed);
+            return *this;
+        }
+
+        void operator++(int) {
+            mValue.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void operator--(int) {
+            mValue.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        T Load() const {
+            return mValue.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<T> mValue = {0};
+    };
+
+    // Incrementally maintained MEMORY_ALLOCATOR_INFO. Since each counter is updated
+    // independently, Load() could observe a partially updated allocation but never requires
+    // the allocator to be locked.
+    struct MemoryAllocatorCounters {
+        RelaxedCounter<uint32_t> UsedBlockCount;
+        RelaxedCounter<uint64_t> UsedBlockUsage;
+        RelaxedCounter<uint32_t> UsedMemoryCount;
+        RelaxedCounter<uint64_t> UsedMemoryUsage;
+        RelaxedCounter<uint64_t> FreeMemoryUsage;
+        RelaxedCounter<uint64_t> EvictedMemoryReuseCount;
+        RelaxedCounter<uint64_t> RetainedMemoryReuseCount;
+        RelaxedCounter<uint64_t> PrefetchedMemoryReuseCount;
+        RelaxedCounter<uint64_t> PrefetchedMemoryWaitCount;
+        RelaxedCounter<uint64_t> PooledMemoryHitCount;
+        RelaxedCounter<uint64_t> PooledMemoryMissCount;
+        RelaxedCounter<uint64_t> PredictedSizeHitCount;
+        RelaxedCounter<uint64_t> PredictedSizeMissCount;
+        RelaxedCounter<uint64_t> BestFitWastedUsage;
+
+        MEMORY_ALLOCATOR_INFO Load() const {
+            MEMORY_ALLOCATOR_INFO info = {};
+            info.UsedBlockCount = UsedBlockCount.Load();
+            info.UsedBlockUsage = UsedBlockUsage.Load();
+            info.UsedMemoryCount = UsedMemoryCount.Load();
+            info.UsedMemoryUsage = UsedMemoryUsage.Load();
+            info.FreeMemoryUsage = FreeMemoryUsage.Load();
+            info.EvictedMemoryReuseCount = EvictedMemoryReuseCount.Load();
+            info.RetainedMemoryReuseCount = RetainedMemoryReuseCount.Load();
+            info.PrefetchedMemoryReuseCount = PrefetchedMemoryReuseCount.Load();
+            info.PrefetchedMemoryWaitCount = PrefetchedMemoryWaitCount.Load();
+            info.PooledMemoryHitCount = PooledMemoryHitCount.Load();
+            info.PooledMemoryMissCount = PooledMemoryMissCount.Load();
+            info.PredictedSizeHitCount = PredictedSizeHitCount.Load();
+            info.PredictedSizeMissCount = PredictedSizeMissCount.Load();
+            info.BestFitWastedUsage = BestFitWastedUsage.Load();
+            return info;
+        }
+    };
+
     class AllocateMemoryTask;
 
     class MemoryAllocationEvent final : public Event {
@@ -67,9 +281,15 @@ namespace gpgmm {
         void Wait() override;
         bool IsSignaled() override;
         void Signal() override;
+        void AddSignaledCallback(std::shared_ptr<VoidCallback> callback) override;
 
         std::unique_ptr<MemoryAllocation> AcquireAllocation() const;
 
+        // Cancels the allocation without blocking. Should the task not have started, it never
+        // allocates. Otherwise, the allocation is de-allocated once the task completes, which
+        // returns its memory to the allocator.
+        void Cancel();
+
       private:
         std::shared_ptr<AllocateMemoryTask> mTask;
         std::shared_ptr<Event> mEvent;
@@ -85,31 +305,50 @@ namespace gpgmm {
         virtual ~MemoryAllocator() = default;
 
         // Attempts to allocate memory and return a allocation that is at-least of the requested
-        // |size| whose value is a multiple of |alignment|. If it cannot, return
+        // size whose value is a multiple of the requested alignment. If it cannot, return
         // nullptr. The returned MemoryAllocation is only valid for the lifetime of this allocator.
-        // When |neverAllocate| is true, the memory allocator will not allocate anything and
-        // effectively no-op.
-        // When |cacheSize| is true, the memory allocator may cache for the requested
-        // allocation to speed-up subsequent requests of the same size.
-        virtual std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                                    uint64_t alignment,
-                                                                    bool neverAllocate,
-                                                                    bool cacheSize,
-                                                                    bool prefetchMemory);
+        virtual std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request);
 
         // Non-blocking version of TryAllocateMemory.
         // Caller must wait for the event to complete before using the resulting allocation.
-        std::shared_ptr<MemoryAllocationEvent> TryAllocateMemoryAsync(uint64_t size,
-                                                                      uint64_t alignment);
+        // |taskClass| determines how urgently the allocation runs relative to other tasks.
+        std::shared_ptr<MemoryAllocationEvent> TryAllocateMemoryAsync(
+            const MEMORY_ALLOCATION_REQUEST& request,
+            TaskClass taskClass = TaskClass::kRequested);
+
+        // Blocks until every allocation made by TryAllocateMemoryAsync completed or was
+        // cancelled before starting. Must be called before destroying an allocator whose
+        // asynchronous allocations could have been cancelled while in-flight.
+        void WaitForPendingAllocations();
 
         // Free the allocation by deallocating the block used to sub-allocate it and the underlying
         // memory block used with it. The |allocation| will be considered invalid after
         // DeallocateMemory.
         virtual void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) = 0;
 
+        // Attempts to allocate memory to move |allocation| into, from memory which is used more
+        // than the memory containing |allocation|, so |allocation| can be deallocated once its
+        // contents were copied (ie. defragmented). Only relocates when the memory containing
+        // |allocation| is used less than |maxUsedPercent|. Returns nullptr if no memory would be
+        // used more or the allocator cannot relocate allocations.
+        virtual std::unique_ptr<MemoryAllocation> TryRelocateMemory(
+            const MemoryAllocation& allocation,
+            uint64_t alignment,
+            double maxUsedPercent);
+
+        // Attempts to grow |allocation| to at-least |size| bytes in place, so its offset and
+        // contents are kept, by taking the free space which follows it within the same memory.
+        // Returns false, leaving |allocation| unchanged, if the allocator cannot, so the caller
+        // can allocate anew and copy instead. By default, only succeeds if |allocation| is
+        // already large enough, ex. the size was rounded-up.
+        virtual bool TryExtendMemory(MemoryAllocation* allocation, uint64_t size);
+
         // Free memory retained by this memory allocator.
         // Used to reuse memory blocks between calls to TryAllocateMemory.
-        virtual void ReleaseMemory();
+        // Stops once at-least |bytesToRelease| bytes were freed and returns the number of bytes
+        // freed.
+        virtual uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize);
 
         // If this allocator only allocates memory blocks using the same size, this value
         // must be specified. Otherwise, kInvalidSize is returned to denote any alignment is
@@ -123,8 +362,19 @@ namespace gpgmm {
 
         // Collect and return the number and size of memory blocks allocated by this allocator.
         // Should be overridden when a child allocator or block allocator is used.
+        // Does not lock the allocator so it can be called at any time, from any thread.
         virtual MEMORY_ALLOCATOR_INFO QueryInfo() const;
 
+        // Collect and return the fragmentation of this allocator alone, excluding the allocators
+        // it allocates memory from. Should be overridden by allocators which sub-allocate blocks
+        // or keep memory that was de-allocated. Unlike QueryInfo, sub-allocators lock to visit
+        // their free blocks.
+        virtual MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const;
+
+        // Returns the fragmentation of this allocator followed by every allocator it allocates
+        // memory from, in pre-order.
+        std::vector<MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO> QueryFragmentation() const;
+
       protected:
         // Combine TryAllocateBlock and TryAllocateMemory into a single call so a partial
         // or uninitalized memory allocation cannot be created. If memory cannot be allocated for
@@ -154,10 +404,27 @@ namespace gpgmm {
                                                       AllocationMethod::kUndefined, block);
         }
 
-        MEMORY_ALLOCATOR_INFO mInfo = {};
+        MemoryAllocatorCounters mInfo;
+
+        // Total size (in bytes) requested by used blocks. Only maintained by allocators which
+        // round-up the size of blocks, so the difference with UsedBlockUsage is wasted.
+        RelaxedCounter<uint64_t> mRequestedBlockUsage;
 
         mutable std::mutex mMutex;
+
+        // Only owned by |this| allocator so its workers are joined once the allocator is
+        // destroyed.
         std::shared_ptr<ThreadPool> mThreadPool;
+
+      private:
+        friend AllocateMemoryTask;
+
+        // Called once an asynchronous allocation no longer uses |this| allocator.
+        void OnPendingAllocationCompleted();
+
+        std::mutex mPendingAllocationMutex;
+        std::condition_variable mPendingAllocationCondition;
+        uint64_t mPendingAllocationCount = 0;  // Guarded by mPendingAllocationMutex.
     };
 
 }  // namespace gpgmm
@@ -16,9 +16,13 @@
 #define GPGMM_MEMORYCACHE_H_
 
 #include "gpgmm/common/Assert.h"
+#include "gpgmm/common/LinkedList.h"
 #include "gpgmm/common/NonCopyable.h"
 #include "gpgmm/common/RefCount.h"
 
+#include <array>
+#include <limits>
+#include <mutex>
 #include <unordered_set>
 
 namespace gpgmm {
@@ -53,11 +57,23 @@ namespace gpgmm {
     //      MyValue value = entry->GetValue();
     //  }
     //
+    //  Entries created with keepAlive are referenced by the cache itself. To bound how many of
+    //  these are kept, construct the cache with a maximum count: once exceeded, the least
+    //  recently used entry is no longer kept alive, and is deleted if nothing else references it.
+    //
+    //  MemoryCache<MyValue> cache(/*maxKeepAliveCount*/ 64);
+    //
+    //  MemoryCache is not thread-safe: the cache and its entries, including their references,
+    //  must only be used while holding the lock of the owner. See ShardedMemoryCache to look up
+    //  entries from multiple threads.
+    //
     template <typename T>
     class MemoryCache;
 
     template <typename T, typename KeyT = size_t>
-    class CacheEntry final : public RefCounted, public NonCopyable {
+    class CacheEntry final : public NonAtomicRefCounted,
+                             public LinkNode<CacheEntry<T, KeyT>>,
+                             public NonCopyable {
       public:
         ~CacheEntry() {
             if (mCache != nullptr) {  // for lookup or not
@@ -81,13 +97,13 @@ namespace gpgmm {
         CacheEntry() = delete;
 
         // Constructs entry for lookup.
-        CacheEntry(T&& value) : RefCounted(0), mValue(std::move(value)) {
+        CacheEntry(T&& value) : NonAtomicRefCounted(0), mValue(std::move(value)) {
             ASSERT(mCache == nullptr);
         }
 
         // Constructs entry to store.
         CacheEntry(MemoryCache<T>* cache, T&& value)
-            : RefCounted(0), mCache(cache), mValue(std::move(value)) {
+            : NonAtomicRefCounted(0), mCache(cache), mValue(std::move(value)) {
             ASSERT(mCache != nullptr);
         }
 
@@ -129,26 +145,39 @@ namespace gpgmm {
 
         MemoryCache() = default;
 
+        // Keeps at most |maxKeepAliveCount| entries alive, evicting the least recently used.
+        explicit MemoryCache(size_t maxKeepAliveCount) : mMaxKeepAliveCount(maxKeepAliveCount) {
+        }
+
         ~MemoryCache() {
             RemoveAndDeleteAll();
             ASSERT(GetSize() == 0);
         }
 
-        // Inserts |value| into a cache. The |value| may be kept alive until the cache destructs
-        // when |keepAlive| is true.
+        // Inserts |value| into a cache. The |value| may be kept alive until the cache destructs,
+        // or is evicted, when |keepAlive| is true.
         ScopedRef<CacheEntryT> GetOrCreate(T&& value, bool keepAlive) {
             CacheEntryT tmp(std::move(value));
             const auto& iter = mCache.find(&tmp);
             if (iter != mCache.end()) {
-                return (*iter);
+                CacheEntryT* entry = *iter;
+                if (entry->IsInList()) {
+                    mKeepAliveEntries.Splice(mKeepAliveEntries.begin(), entry);
+                } else if (keepAlive) {
+                    KeepAlive(entry);
+                }
+                return ScopedRef<CacheEntryT>(entry);
             }
             CacheEntryT* entry = new CacheEntryT(this, tmp.AcquireValue());
-            if (keepAlive) {
-                entry->Ref();
-            }
             const bool success = mCache.insert(entry).second;
             ASSERT(success);
-            return ScopedRef<CacheEntryT>(entry);
+
+            // Referenced before evicting so |entry| cannot be the one deleted.
+            ScopedRef<CacheEntryT> scopedEntry(entry);
+            if (keepAlive) {
+                KeepAlive(entry);
+            }
+            return scopedEntry;
         }
 
         // Return number of entries.
@@ -156,12 +185,17 @@ namespace gpgmm {
             return mCache.size();
         }
 
+        // Return number of entries referenced by the cache itself.
+        size_t GetKeepAliveCount() const {
+            return mKeepAliveEntries.size();
+        }
+
         // Forward iterator interfaces.
-        iterator begin() const {
+        const_iterator begin() const {
             return mCache.begin();
         }
 
-        iterator end() const {
+        const_iterator end() const {
             return mCache.end();
         }
 
@@ -173,30 +207,116 @@ namespace gpgmm {
             return mCache.cend();
         }
 
+        // Releases every entry kept alive by the cache. Entries still referenced elsewhere
+        // remain until released.
         void RemoveAndDeleteAll() {
-            for (auto it = mCache.begin(); it != mCache.end();) {
-                if ((*it)->Unref()) {
-                    auto curr = it;
-                    it++;
-                    RemoveCacheEntry(*curr);
-                } else {
-                    it++;
-                }
+            while (!mKeepAliveEntries.empty()) {
+                Evict(mKeepAliveEntries.tail()->value());
             }
         }
 
       private:
         friend CacheEntryT;
 
+        void KeepAlive(CacheEntryT* entry) {
+            entry->Ref();
+            mKeepAliveEntries.Prepend(entry);
+            if (mKeepAliveEntries.size() > mMaxKeepAliveCount) {
+                Evict(mKeepAliveEntries.tail()->value());
+            }
+        }
+
+        void Evict(CacheEntryT* entry) {
+            entry->RemoveFromList();
+            if (entry->Unref()) {
+                delete entry;
+            }
+        }
+
         void RemoveCacheEntry(CacheEntryT* entry) {
             ASSERT(entry != nullptr);
             ASSERT(entry->GetRefCount() == 0);
+            ASSERT(!entry->IsInList());
             const size_t removedCount = mCache.erase(entry);
             ASSERT(removedCount == 1);
         }
 
+        const size_t mMaxKeepAliveCount = std::numeric_limits<size_t>::max();
+
         Cache mCache;
+
+        // Entries referenced by the cache, from most to least recently used.
+        LinkedList<CacheEntryT> mKeepAliveEntries;
+    };
+
+    // ShardedMemoryCache splits entries between |ShardCount| MemoryCaches by key, each with
+    // its own lock, so threads looking up different keys rarely wait on each other. Entries are
+    // only ever used while their shard is locked, which is why they are passed to a function
+    // instead of being returned.
+    //
+    //   ShardedMemoryCache<MyValue> cache;
+    //   cache.GetOrCreate(MyValue(key), false, [](CacheEntry<MyValue>* entry) {...});
+    //
+    template <typename T, size_t ShardCount = 16>
+    class ShardedMemoryCache final : public NonCopyable {
+      public:
+        using CacheEntryT = typename MemoryCache<T>::CacheEntryT;
+
+        ShardedMemoryCache() = default;
+
+        // Inserts |value| into the cache, like MemoryCache::GetOrCreate, then calls |fn| with
+        // its entry. The entry must not be used once |fn| returns.
+        template <typename Fn>
+        void GetOrCreate(T&& value, bool keepAlive, Fn&& fn) {
+            Shard& shard = mShards[GetShardIndex(value.GetKey())];
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            ScopedRef<CacheEntryT> entry = shard.Cache.GetOrCreate(std::move(value), keepAlive);
+            fn(entry.Get());
+        }
+
+        // Calls |fn| with every entry, locking one shard at a time.
+        template <typename Fn>
+        void ForEach(Fn&& fn) const {
+            for (const Shard& shard : mShards) {
+                std::lock_guard<std::mutex> lock(shard.Mutex);
+                for (const CacheEntryT* entry : shard.Cache) {
+                    fn(entry);
+                }
+            }
+        }
+
+        // Return number of entries.
+        size_t GetSize() const {
+            size_t size = 0;
+            for (const Shard& shard : mShards) {
+                std::lock_guard<std::mutex> lock(shard.Mutex);
+                size += shard.Cache.GetSize();
+            }
+            return size;
+        }
+
+        void RemoveAndDeleteAll() {
+            for (Shard& shard : mShards) {
+                std::lock_guard<std::mutex> lock(shard.Mutex);
+                shard.Cache.RemoveAndDeleteAll();
+            }
+        }
+
+      private:
+        struct Shard {
+            mutable std::mutex Mutex;
+            MemoryCache<T> Cache;
+        };
+
+        // Keys are often aligned addresses or sizes, so the low bits are mixed into the high
+        // bits (ie. Fibonacci hashing) before picking the shard.
+        static size_t GetShardIndex(uint64_t key) {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) % ShardCount;
+        }
+
+        std::array<Shard, ShardCount> mShards;
     };
+
 }  // namespace gpgmm
 
 #endif  // GPGMM_MEMORYCACHE_H_
@@ -41,8 +41,9 @@ namespace gpgmm {
         virtual void ReturnToPool(std::unique_ptr<MemoryAllocation> allocation,
                                   uint64_t memoryIndex = kInvalidIndex) = 0;
 
-        // Deallocates memory allocations owned by the pool.
-        virtual void ReleasePool() = 0;
+        // Deallocates memory allocations owned by the pool until at-least |bytesToRelease| bytes
+        // were released. Returns the number of bytes released.
+        virtual uint64_t ReleasePool(uint64_t bytesToRelease = kInvalidSize) = 0;
 
         // Returns number of memory allocations in the pool.
         virtual uint64_t GetPoolSize() const = 0;
@@ -27,20 +27,14 @@ namespace gpgmm {
     }
 
     std::unique_ptr<MemoryAllocation> PooledMemoryAllocator::TryAllocateMemory(
-        uint64_t size,
-        uint64_t alignment,
-        bool neverAllocate,
-        bool cacheSize,
-        bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "PooledMemoryAllocator.TryAllocateMemory");
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "PooledMemoryAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
         std::unique_ptr<MemoryAllocation> allocation = mPool->AcquireFromPool();
         if (allocation == nullptr) {
-            GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(size, alignment, neverAllocate,
-                                                                cacheSize, prefetchMemory),
-                             allocation);
+            GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(request), allocation);
         } else {
             mInfo.FreeMemoryUsage -= allocation->GetSize();
         }
@@ -55,7 +49,7 @@ namespace gpgmm {
     }
 
     void PooledMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "PooledMemoryAllocator.DeallocateMemory");
+        TRACE_EVENT0(TraceEventCategory::Pool, "PooledMemoryAllocator.DeallocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
@@ -64,7 +58,12 @@ namespace gpgmm {
         mInfo.UsedMemoryCount--;
         mInfo.UsedMemoryUsage -= allocationSize;
 
-        mPool->ReturnToPool(std::move(allocation));
+        // Pooled memory must be released by the child allocator which allocated it, otherwise
+        // releasing the pool would only return the memory back to it.
+        MemoryBase* memory = allocation->GetMemory();
+        ASSERT(memory != nullptr);
+
+        mPool->ReturnToPool(std::make_unique<MemoryAllocation>(GetFirstChild(), memory));
     }
 
     uint64_t PooledMemoryAllocator::GetMemorySize() const {
@@ -0,0 +1,171 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/RingMemoryAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/Memory.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+
+namespace gpgmm {
+
+    RingMemoryAllocator::RingMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                             uint64_t ringSize,
+                                             uint64_t ringAlignment)
+        : MemoryAllocator(std::move(memoryAllocator)),
+          mRingSize(ringSize),
+          mRingAlignment(ringAlignment) {
+        ASSERT(mRingSize > 0);
+    }
+
+    RingMemoryAllocator::~RingMemoryAllocator() {
+        if (mRingMemory != nullptr) {
+            GetFirstChild()->DeallocateMemory(std::move(mRingMemory));
+        }
+    }
+
+    std::unique_ptr<MemoryAllocation> RingMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "RingMemoryAllocator.TryAllocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        GPGMM_CHECK_NONZERO(request.Size);
+
+        if (request.Size > mRingSize) {
+            DebugEvent("RingMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Allocation size exceeded the ring size (" << request.Size << " vs "
+                << mRingSize << " bytes).";
+            return {};
+        }
+
+        if (mRingMemory == nullptr) {
+            MEMORY_ALLOCATION_REQUEST memoryRequest = request;
+            memoryRequest.Size = mRingSize;
+            memoryRequest.Alignment = mRingAlignment;
+            memoryRequest.PrefetchMemory = false;
+            GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(memoryRequest), mRingMemory);
+        }
+
+        // Once everything retired, start again from the front so the largest range is free.
+        if (mUsedSize == 0) {
+            mUsedStartOffset = 0;
+            mUsedEndOffset = 0;
+        }
+
+        // Padding skipped to align (or wrap) the allocation is used until the allocation retires.
+        uint64_t startOffset = kInvalidOffset;
+        uint64_t allocatedSize = 0;
+        const uint64_t alignedOffset = AlignTo(mUsedEndOffset, request.Alignment);
+        if (mUsedStartOffset < mUsedEndOffset || mUsedSize == 0) {
+            // Used range is contiguous, so try the back of the ring then the front.
+            if (alignedOffset + request.Size <= mRingSize) {
+                startOffset = alignedOffset;
+                allocatedSize = alignedOffset + request.Size - mUsedEndOffset;
+            } else if (request.Size <= mUsedStartOffset) {
+                startOffset = 0;
+                allocatedSize = mRingSize - mUsedEndOffset + request.Size;
+            }
+        } else if (alignedOffset + request.Size <= mUsedStartOffset) {
+            // Used range wrapped around, so only the middle of the ring is free.
+            startOffset = alignedOffset;
+            allocatedSize = alignedOffset + request.Size - mUsedEndOffset;
+        }
+
+        if (startOffset == kInvalidOffset) {
+            DebugEvent("RingMemoryAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Ring has no space left until more memory retires.";
+            return {};
+        }
+
+        mUsedEndOffset = startOffset + request.Size;
+        mUsedSize += allocatedSize;
+
+        if (!mInflightRequests.empty() && mInflightRequests.back().Serial == mPendingSerial) {
+            mInflightRequests.back().EndOffset = mUsedEndOffset;
+            mInflightRequests.back().Size += allocatedSize;
+        } else {
+            mInflightRequests.push_back({mPendingSerial, mUsedEndOffset, allocatedSize});
+        }
+
+        mInfo.UsedBlockCount++;
+        mInfo.UsedBlockUsage += request.Size;
+
+        MemoryBase* memory = mRingMemory->GetMemory();
+        memory->Ref();
+
+        return std::make_unique<MemoryAllocation>(
+            this, memory, mRingMemory->GetOffset() + startOffset, AllocationMethod::kSubAllocated,
+            mBlockPool.Acquire(MemoryBlock{startOffset, request.Size}));
+    }
+
+    void RingMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "RingMemoryAllocator.DeallocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Space is only re-used once the allocation retires.
+        mInfo.UsedBlockCount--;
+        mInfo.UsedBlockUsage -= subAllocation->GetSize();
+
+        subAllocation->GetMemory()->Unref();
+        mBlockPool.Release(subAllocation->GetBlock());
+    }
+
+    uint64_t RingMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (bytesToRelease == 0 || mRingMemory == nullptr || mUsedSize > 0 ||
+            mInfo.UsedBlockCount.Load() > 0) {
+            return 0;
+        }
+
+        GetFirstChild()->DeallocateMemory(std::move(mRingMemory));
+        return mRingSize;
+    }
+
+    void RingMemoryAllocator::SetPendingSerial(uint64_t serial) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingSerial = std::max(mPendingSerial, serial);
+    }
+
+    void RingMemoryAllocator::RetireMemory(uint64_t completedSerial) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "RingMemoryAllocator.RetireMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        while (!mInflightRequests.empty() && mInflightRequests.front().Serial <= completedSerial) {
+            const Request& request = mInflightRequests.front();
+            mUsedStartOffset = request.EndOffset;
+            mUsedSize -= request.Size;
+            mInflightRequests.pop_front();
+        }
+    }
+
+    uint64_t RingMemoryAllocator::GetUsedSizeForTesting() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mUsedSize;
+    }
+
+    MEMORY_ALLOCATOR_INFO RingMemoryAllocator::QueryInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
+        result += GetFirstChild()->QueryInfo();
+        return result;
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,86 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_RINGMEMORYALLOCATOR_H_
+#define GPGMM_RINGMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <deque>
+#include <memory>
+
+namespace gpgmm {
+
+    // RingMemoryAllocator sub-allocates a single memory of |ringSize| by bumping an offset,
+    // wrapping around to the front once the end is reached. Allocations are not freed one at a
+    // time but all at once, by serial (ex. fence value): an allocation belongs to the pending
+    // serial when it was made, and its space is only re-used once RetireMemory is called with a
+    // completed serial greater than or equal to it. This suits transient data that is re-written
+    // every frame, since allocating costs no more than updating a few offsets.
+    //
+    // The memory is allocated upon first use and kept until released by ReleaseMemory, once
+    // every allocation has retired.
+    class RingMemoryAllocator final : public MemoryAllocator {
+      public:
+        RingMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
+                            uint64_t ringSize,
+                            uint64_t ringAlignment);
+        ~RingMemoryAllocator() override;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+
+        // The ring cannot be partially released, so it is released whole once every allocation
+        // has retired, unless |bytesToRelease| is zero.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+        // Subsequent allocations belong to |serial|. Serials can only increase, so a smaller
+        // serial is ignored.
+        void SetPendingSerial(uint64_t serial);
+
+        // Frees every allocation which belongs to a serial less than or equal to
+        // |completedSerial|.
+        void RetireMemory(uint64_t completedSerial);
+
+        uint64_t GetUsedSizeForTesting() const;
+
+      private:
+        // Contiguous range of the ring, ending at |EndOffset|, allocated for the same serial.
+        struct Request {
+            uint64_t Serial;
+            uint64_t EndOffset;
+            uint64_t Size;
+        };
+
+        const uint64_t mRingSize;
+        const uint64_t mRingAlignment;
+
+        // Guarded by mMutex.
+        std::unique_ptr<MemoryAllocation> mRingMemory;
+        std::deque<Request> mInflightRequests;  // Oldest first.
+        uint64_t mUsedStartOffset = 0;
+        uint64_t mUsedEndOffset = 0;
+        uint64_t mUsedSize = 0;
+        uint64_t mPendingSerial = 0;
+        ObjectPool<MemoryBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_RINGMEMORYALLOCATOR_H_
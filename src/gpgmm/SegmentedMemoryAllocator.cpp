@@ -16,56 +16,36 @@
 
 #include "gpgmm/Debug.h"
 #include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
 #include "gpgmm/common/Utils.h"
 
-namespace gpgmm {
-
-    // Helper for FindSegment to find the middle of a linked-list.
-    LinkNode<MemorySegment>* GetMiddleSegment(LinkNode<MemorySegment>* start,
-                                              LinkNode<MemorySegment>* end) {
-        LinkNode<MemorySegment>* slow = start;
-        LinkNode<MemorySegment>* fast = start->next();
-        while (fast != end) {
-            fast = fast->next();
-            if (fast != end) {
-                slow = slow->next();
-                fast = fast->next();
-            }
-        }
+#include <algorithm>
+#include <vector>
 
-        return slow;
-    }
-
-    // Perform a slower, O(n) binary search, over a non-contigious array (linked-list).
-    LinkNode<MemorySegment>* FindSegment(LinkNode<MemorySegment>* start,
-                                         LinkNode<MemorySegment>* end,
-                                         uint64_t size) {
-        LinkNode<MemorySegment>* left = start;
-        LinkNode<MemorySegment>* right = end;
+namespace gpgmm {
 
-        while (left != right) {
-            LinkNode<MemorySegment>* middle = GetMiddleSegment(left, right);
-            if (middle == nullptr) {
-                return nullptr;
-            }
-            if (middle->value()->GetMemorySize() == size) {
-                return middle;
+    // Largest number of evicted memory to skip over before re-using one of them anyway. Keeps
+    // allocation constant time should a segment only have evicted memory.
+    constexpr static uint32_t kMaxEvictedMemoryToSkip = 4;
 
-            } else if (middle->value()->GetMemorySize() > size) {
-                // Smaller then middle, go left.
-                right = middle;
+    class ReserveMemoryTask : public VoidCallback {
+      public:
+        ReserveMemoryTask(SegmentedMemoryAllocator* allocator, MemorySegment* segment)
+            : mAllocator(allocator), mSegment(segment) {
+        }
 
-            } else {
-                // Larger then middle, go right.
-                left = middle->next();
-            }
+        void operator()() override {
+            mAllocator->ReserveMemory(mSegment);
         }
-        return left;
-    }
+
+      private:
+        SegmentedMemoryAllocator* const mAllocator;
+        MemorySegment* const mSegment;
+    };
 
     // MemorySegment
 
-    MemorySegment::MemorySegment(uint64_t memorySize) : LIFOMemoryPool(memorySize) {
+    MemorySegment::MemorySegment(uint64_t memorySize) : LockFreeMemoryPool(memorySize) {
     }
 
     MemorySegment::~MemorySegment() {
@@ -75,15 +55,49 @@ namespace gpgmm {
         ReleasePool();
     }
 
+    uint64_t MemorySegment::GetLastUsedSequence() const {
+        return mLastUsedSequence;
+    }
+
+    void MemorySegment::SetLastUsedSequence(uint64_t sequence) {
+        mLastUsedSequence = sequence;
+    }
+
     // SegmentedMemoryAllocator
 
     SegmentedMemoryAllocator::SegmentedMemoryAllocator(
         std::unique_ptr<MemoryAllocator> memoryAllocator,
-        uint64_t memoryAlignment)
-        : MemoryAllocator(std::move(memoryAllocator)), mMemoryAlignment(memoryAlignment) {
+        uint64_t memoryAlignment,
+        uint64_t reservedMemorySize,
+        uint64_t reservedMemoryCount,
+        double bestFitWasteLimit,
+        uint64_t maxSegmentPoolSize,
+        uint64_t maxPoolSize,
+        uint64_t peakUsageWindow)
+        : MemoryAllocator(std::move(memoryAllocator)),
+          mMemoryAlignment(memoryAlignment),
+          mReservedMemorySize(reservedMemorySize),
+          mReservedMemoryCount(reservedMemoryCount),
+          mBestFitWasteLimit(bestFitWasteLimit),
+          mMaxSegmentPoolSize(maxSegmentPoolSize),
+          mMaxPoolSize(maxPoolSize),
+          mPeakUsageWindow(peakUsageWindow) {
+        mPowerOfTwoSegments.fill(nullptr);
+
+        if (mReservedMemoryCount > 0) {
+            ASSERT(mReservedMemorySize > 0);
+            std::lock_guard<std::mutex> lock(mMutex);
+            ReserveMemoryAsync(GetOrCreateFreeSegment(mReservedMemorySize));
+        }
     }
 
     SegmentedMemoryAllocator::~SegmentedMemoryAllocator() {
+        // Reserved memory is returned to segments, so it must be allocated before any segment
+        // gets destroyed.
+        for (const std::shared_ptr<Event>& event : mReservedMemoryEvents) {
+            event->Wait();
+        }
+
         auto curr = mFreeSegments.head();
         while (curr != mFreeSegments.end()) {
             auto next = curr->next();
@@ -96,106 +110,298 @@ namespace gpgmm {
     }
 
     MemorySegment* SegmentedMemoryAllocator::GetOrCreateFreeSegment(uint64_t memorySize) {
-        LinkNode<MemorySegment>* existingFreeSegment =
-            FindSegment(mFreeSegments.head(), mFreeSegments.tail(), memorySize);
-
-        // List is empty, append it at end.
-        if (existingFreeSegment == mFreeSegments.end()) {
-            ASSERT(mFreeSegments.empty());
-            MemorySegment* newFreeSegment = new MemorySegment{memorySize};
-            mFreeSegments.Append(newFreeSegment);
-            return newFreeSegment;
+        // Power-of-two sizes are indexed directly by their log2.
+        MemorySegment** existingFreeSegment = nullptr;
+        if (IsPowerOfTwo(memorySize)) {
+            existingFreeSegment = &mPowerOfTwoSegments[Log2(memorySize)];
+        } else {
+            existingFreeSegment = &mSegmentsBySize[memorySize];
         }
 
-        ASSERT(existingFreeSegment->value() != nullptr);
-
         // Segment already exists, reuse it.
-        if (existingFreeSegment->value()->GetMemorySize() == memorySize) {
-            return existingFreeSegment->value();
+        if (*existingFreeSegment != nullptr) {
+            ASSERT((*existingFreeSegment)->GetMemorySize() == memorySize);
+            return *existingFreeSegment;
         }
 
         MemorySegment* newFreeSegment = new MemorySegment{memorySize};
-
-        // Or insert a new segment in sorted order.
-        if (memorySize > existingFreeSegment->value()->GetMemorySize()) {
-            newFreeSegment->InsertAfter(existingFreeSegment);
-        } else {
-            newFreeSegment->InsertBefore(existingFreeSegment);
-        }
-
+        mFreeSegments.Append(newFreeSegment);
+        *existingFreeSegment = newFreeSegment;
         return newFreeSegment;
     }
 
     std::unique_ptr<MemoryAllocation> SegmentedMemoryAllocator::TryAllocateMemory(
-        uint64_t size,
-        uint64_t alignment,
-        bool neverAllocate,
-        bool cacheSize,
-        bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SegmentedMemoryAllocator.TryAllocateMemory");
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "SegmentedMemoryAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
-        GPGMM_CHECK_NONZERO(size);
+        GPGMM_CHECK_NONZERO(request.Size);
 
-        if (alignment != mMemoryAlignment) {
+        if (request.Alignment != mMemoryAlignment) {
             DebugEvent("SegmentedMemoryAllocator.TryAllocateMemory",
                        ALLOCATOR_MESSAGE_ID_ALIGNMENT_MISMATCH)
                 << "Allocation alignment does not match memory alignment.";
             return {};
         }
 
-        MemorySegment* segment = GetOrCreateFreeSegment(size);
-        ASSERT(segment != nullptr);
+        MemorySegment* requestedSegment = GetOrCreateFreeSegment(request.Size);
+        ASSERT(requestedSegment != nullptr);
+
+        MemorySegment* segment = requestedSegment;
+        std::unique_ptr<MemoryAllocation> allocation = AcquireResidentFromSegment(segment);
+        if (allocation == nullptr && mBestFitWasteLimit > 0) {
+            allocation = AcquireBestFitFromLargerSegment(request.Size, &segment);
+        }
 
-        std::unique_ptr<MemoryAllocation> allocation = segment->AcquireFromPool();
         if (allocation == nullptr) {
-            GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(
-                                 size, mMemoryAlignment, neverAllocate, cacheSize, prefetchMemory),
-                             allocation);
+            mInfo.PooledMemoryMissCount++;
+            GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(request), allocation);
         } else {
+            mInfo.PooledMemoryHitCount++;
             mInfo.FreeMemoryUsage -= allocation->GetSize();
         }
 
         mInfo.UsedMemoryCount++;
         mInfo.UsedMemoryUsage += allocation->GetSize();
 
+        mPeakUsage = std::max(mPeakUsage, mInfo.UsedMemoryUsage.Load());
+
         MemoryBase* memory = allocation->GetMemory();
         ASSERT(memory != nullptr);
 
         memory->SetPool(segment);
 
+        if (segment != requestedSegment) {
+            const uint64_t wastedSize = allocation->GetSize() - request.Size;
+            mBestFitWastedSizes[memory] = wastedSize;
+            mInfo.BestFitWastedUsage += wastedSize;
+        }
+
+        if (request.Size == mReservedMemorySize && !request.NeverAllocate) {
+            ReserveMemoryAsync(requestedSegment);
+        }
+
         return std::make_unique<MemoryAllocation>(this, memory);
     }
 
-    void SegmentedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SegmentedMemoryAllocator.DeallocateMemory");
+    void SegmentedMemoryAllocator::ReserveMemoryAsync(MemorySegment* segment) {
+        // Forget reservations which already completed, so the events do not grow unbounded.
+        mReservedMemoryEvents.erase(
+            std::remove_if(mReservedMemoryEvents.begin(), mReservedMemoryEvents.end(),
+                           [](const std::shared_ptr<Event>& event) { return event->IsSignaled(); }),
+            mReservedMemoryEvents.end());
+
+        // Racing another thread's allocation could under-count the pool, which only reserves
+        // one more memory than needed.
+        while (segment->GetPoolSize() + mPendingReservedMemoryCount.load() <
+               mReservedMemoryCount) {
+            mPendingReservedMemoryCount++;
+            mReservedMemoryEvents.push_back(ThreadPool::PostTask(
+                mThreadPool, std::make_shared<ReserveMemoryTask>(this, segment),
+                TaskClass::kPrefetch));
+        }
+    }
 
-        std::lock_guard<std::mutex> lock(mMutex);
+    void SegmentedMemoryAllocator::ReserveMemory(MemorySegment* segment) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "SegmentedMemoryAllocator.ReserveMemory");
 
-        ASSERT(allocation != nullptr);
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = mReservedMemorySize;
+        request.Alignment = mMemoryAlignment;
+        request.PrefetchMemory = true;
 
-        mInfo.FreeMemoryUsage += allocation->GetSize();
-        mInfo.UsedMemoryCount--;
-        mInfo.UsedMemoryUsage -= allocation->GetSize();
+        std::unique_ptr<MemoryAllocation> allocation = GetFirstChild()->TryAllocateMemory(request);
+        if (allocation != nullptr) {
+            mInfo.FreeMemoryUsage += allocation->GetSize();
+            segment->ReturnToPool(std::move(allocation));
+        }
+
+        mPendingReservedMemoryCount--;
+    }
+
+    // Prefers memory which is still resident, since re-using evicted memory requires it be made
+    // resident again before it can be used. Evicted memory is only re-used if no resident memory
+    // was found.
+    std::unique_ptr<MemoryAllocation> SegmentedMemoryAllocator::AcquireResidentFromSegment(
+        MemorySegment* segment) {
+        std::vector<std::unique_ptr<MemoryAllocation>> evictedAllocations;
+        std::unique_ptr<MemoryAllocation> allocation;
+        while (evictedAllocations.size() < kMaxEvictedMemoryToSkip) {
+            allocation = segment->AcquireFromPool();
+            if (allocation == nullptr || !allocation->GetMemory()->IsEvicted()) {
+                break;
+            }
+            evictedAllocations.push_back(std::move(allocation));
+        }
+
+        if (allocation == nullptr && !evictedAllocations.empty()) {
+            allocation = std::move(evictedAllocations.front());
+            evictedAllocations.erase(evictedAllocations.begin());
+            mInfo.EvictedMemoryReuseCount++;
+        }
+
+        // Return the skipped memory in reverse so the pool order is unchanged.
+        for (auto it = evictedAllocations.rbegin(); it != evictedAllocations.rend(); ++it) {
+            segment->ReturnToPool(std::move(*it));
+        }
+
+        return allocation;
+    }
+
+    std::unique_ptr<MemoryAllocation> SegmentedMemoryAllocator::AcquireBestFitFromLargerSegment(
+        uint64_t memorySize,
+        MemorySegment** segmentOut) {
+        MemorySegment* bestFitSegment = nullptr;
+        for (MemorySegment* segment : mFreeSegments) {
+            const uint64_t segmentSize = segment->GetMemorySize();
+            if (segmentSize <= memorySize || segment->GetPoolSize() == 0) {
+                continue;
+            }
+
+            // Waste is relative to the memory re-used, so a limit of 0.5 allows re-using twice
+            // the size requested.
+            if (segmentSize - memorySize > segmentSize * mBestFitWasteLimit) {
+                continue;
+            }
+
+            if (bestFitSegment == nullptr || segmentSize < bestFitSegment->GetMemorySize()) {
+                bestFitSegment = segment;
+            }
+        }
+
+        if (bestFitSegment == nullptr) {
+            return nullptr;
+        }
+
+        std::unique_ptr<MemoryAllocation> allocation = AcquireResidentFromSegment(bestFitSegment);
+        if (allocation != nullptr) {
+            *segmentOut = bestFitSegment;
+        }
+        return allocation;
+    }
+
+    void SegmentedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "SegmentedMemoryAllocator.DeallocateMemory");
+
+        ASSERT(allocation != nullptr);
 
         MemoryBase* memory = allocation->GetMemory();
         ASSERT(memory != nullptr);
 
-        MemoryPool* pool = memory->GetPool();
-        ASSERT(pool != nullptr);
+        // Only segments are set as the pool of memory allocated by this allocator.
+        MemorySegment* segment = static_cast<MemorySegment*>(memory->GetPool());
+        ASSERT(segment != nullptr);
+
+        bool isPooled = true;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            mInfo.UsedMemoryCount--;
+            mInfo.UsedMemoryUsage -= allocation->GetSize();
+
+            if (!mBestFitWastedSizes.empty()) {
+                auto it = mBestFitWastedSizes.find(memory);
+                if (it != mBestFitWastedSizes.end()) {
+                    mInfo.BestFitWastedUsage -= it->second;
+                    mBestFitWastedSizes.erase(it);
+                }
+            }
+
+            if (mPeakUsageWindow > 0 && ++mDeallocationCountInWindow >= mPeakUsageWindow) {
+                mPrevPeakUsage = mPeakUsage;
+                mPeakUsage = mInfo.UsedMemoryUsage.Load();
+                mDeallocationCountInWindow = 0;
+            }
+
+            // Memory returned by other threads, outside the lock, could be missed by the segment
+            // pool size, which only exceeds the cap by the memory being returned.
+            const uint64_t memorySize = allocation->GetSize();
+            const uint64_t freeMemoryUsage = mInfo.FreeMemoryUsage.Load();
+            const uint64_t poolSizeLimit = GetPoolSizeLimit();
+            if (segment->GetPoolSize() * segment->GetMemorySize() + memorySize >
+                    mMaxSegmentPoolSize ||
+                freeMemoryUsage + memorySize > poolSizeLimit) {
+                isPooled = false;
+            } else {
+                mInfo.FreeMemoryUsage += memorySize;
+                segment->SetLastUsedSequence(++mNextUsedSequence);
+            }
+
+            // Peak usage could have decreased, leaving more free memory than would be re-used.
+            if (freeMemoryUsage > poolSizeLimit) {
+                ReleaseLeastRecentlyUsedMemory(freeMemoryUsage - poolSizeLimit);
+            }
+        }
+
+        // The pool is full so the memory is deallocated, by the child allocator, rather than
+        // kept. The child allocator is responsible for deallocating it in the background.
+        if (!isPooled) {
+            GetFirstChild()->DeallocateMemory(
+                std::make_unique<MemoryAllocation>(GetFirstChild(), memory));
+            return;
+        }
 
-        pool->ReturnToPool(std::make_unique<MemoryAllocation>(GetFirstChild(), memory));
+        // Segments are never destroyed before the allocator, so the memory can be returned to it
+        // without waiting on another thread's allocation.
+        segment->ReturnToPool(std::make_unique<MemoryAllocation>(GetFirstChild(), memory));
     }
 
-    void SegmentedMemoryAllocator::ReleaseMemory() {
+    uint64_t SegmentedMemoryAllocator::GetPoolSizeLimit() const {
+        uint64_t poolSizeLimit = mMaxPoolSize;
+        if (mPeakUsageWindow > 0) {
+            const uint64_t peakUsage = std::max(mPeakUsage, mPrevPeakUsage);
+            const uint64_t usedMemoryUsage = mInfo.UsedMemoryUsage.Load();
+            poolSizeLimit = std::min(
+                poolSizeLimit, (peakUsage > usedMemoryUsage) ? peakUsage - usedMemoryUsage : 0);
+        }
+        return poolSizeLimit;
+    }
+
+    uint64_t SegmentedMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
         std::lock_guard<std::mutex> lock(mMutex);
+        return ReleaseLeastRecentlyUsedMemory(bytesToRelease);
+    }
 
-        for (auto node = mFreeSegments.head(); node != mFreeSegments.end(); node = node->next()) {
-            MemorySegment* segment = node->value();
+    uint64_t SegmentedMemoryAllocator::ReleaseLeastRecentlyUsedMemory(uint64_t bytesToRelease) {
+        std::vector<MemorySegment*> segments;
+        for (MemorySegment* segment : mFreeSegments) {
             ASSERT(segment != nullptr);
-            segment->ReleasePool();
+            if (segment->GetPoolSize() > 0) {
+                segments.push_back(segment);
+            }
         }
+
+        std::sort(segments.begin(), segments.end(), [](MemorySegment* a, MemorySegment* b) {
+            return a->GetLastUsedSequence() < b->GetLastUsedSequence();
+        });
+
+        uint64_t bytesReleased = 0;
+        for (MemorySegment* segment : segments) {
+            if (bytesReleased >= bytesToRelease) {
+                break;
+            }
+            bytesReleased += segment->ReleasePool(bytesToRelease - bytesReleased);
+        }
+
+        mInfo.FreeMemoryUsage -= bytesReleased;
+
+        return bytesReleased;
+    }
+
+    void SegmentedMemoryAllocator::ImportMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        TRACE_EVENT0(TraceEventCategory::Pool, "SegmentedMemoryAllocator.ImportMemory");
+
+        ASSERT(allocation != nullptr);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        MemorySegment* segment = GetOrCreateFreeSegment(allocation->GetSize());
+        ASSERT(segment != nullptr);
+
+        mInfo.FreeMemoryUsage += allocation->GetSize();
+        segment->SetLastUsedSequence(++mNextUsedSequence);
+        segment->ReturnToPool(std::move(allocation));
     }
 
     uint64_t SegmentedMemoryAllocator::GetMemoryAlignment() const {
@@ -205,11 +411,15 @@ namespace gpgmm {
     uint64_t SegmentedMemoryAllocator::GetSegmentSizeForTesting() const {
         std::lock_guard<std::mutex> lock(mMutex);
 
-        uint64_t count = 0;
-        for (auto node = mFreeSegments.head(); node != mFreeSegments.end(); node = node->next()) {
-            count += 1;
+        return mFreeSegments.size();
+    }
+
+    void SegmentedMemoryAllocator::WaitForReservedMemoryForTesting() {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (const std::shared_ptr<Event>& event : mReservedMemoryEvents) {
+            event->Wait();
         }
-        return count;
     }
 
 }  // namespace gpgmm
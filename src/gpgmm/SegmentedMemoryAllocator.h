@@ -15,47 +15,140 @@
 #ifndef GPGMM_SEGMENTEDMEMORYALLOCATOR_H_
 #define GPGMM_SEGMENTEDMEMORYALLOCATOR_H_
 
-#include "gpgmm/LIFOMemoryPool.h"
+#include "gpgmm/LockFreeMemoryPool.h"
 #include "gpgmm/MemoryAllocator.h"
 #include "gpgmm/common/LinkedList.h"
 
+#include <array>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
 namespace gpgmm {
 
     // Represents one or more memory blocks managed in a pool.
     // A memory segment is a node in a linked-list so it may be cached and reuse by the segmented
-    // allocator.
-    class MemorySegment : public LIFOMemoryPool, public LinkNode<MemorySegment> {
+    // allocator. Memory is returned to the segment without holding the allocator lock, so the
+    // pool must be thread-safe.
+    class MemorySegment : public LockFreeMemoryPool, public LinkNode<MemorySegment> {
       public:
         explicit MemorySegment(uint64_t memorySize);
         virtual ~MemorySegment();
+
+        // Order in which memory was last returned to this segment, so the least recently used
+        // segments can be released first.
+        uint64_t GetLastUsedSequence() const;
+        void SetLastUsedSequence(uint64_t sequence);
+
+      private:
+        uint64_t mLastUsedSequence = 0;
     };
 
-    // SegmentedMemoryAllocator maintains a sorted segmented list of memory pools to allocate
-    // variable-size memory blocks.
-    class SegmentedMemoryAllocator : public MemoryAllocator {
+    // SegmentedMemoryAllocator maintains a segmented list of memory pools to allocate
+    // variable-size memory blocks. Segments are indexed by size so finding the segment for a
+    // given size is done in constant time. Memory which is still resident is re-used before memory
+    // which was evicted.
+    // When |reservedMemoryCount| is non-zero, that many memory blocks of |reservedMemorySize| are
+    // kept free in the pool, ahead of demand. Reserved memory is allocated in the background, once
+    // created and whenever memory of that size gets used, so allocating it never waits on the
+    // child allocator. Reserved memory is allocated using PrefetchMemory so the child allocator
+    // may refuse it, for example, when it would not fit within the budget.
+    // When |bestFitWasteLimit| is non-zero, a request whose segment has no free memory re-uses
+    // free memory of the smallest larger segment instead, so long as at-most that fraction of the
+    // memory goes unused, rather than allocating memory of the requested size. The memory returns
+    // to its own segment once deallocated. Only suitable when any memory can be used in place of
+    // smaller memory (ex. resource heaps which resources are placed in).
+    // Free memory is pooled up to |maxSegmentPoolSize| bytes per segment and |maxPoolSize| bytes
+    // in total; memory deallocated once a pool is full is deallocated by the child allocator
+    // instead. When |peakUsageWindow| is non-zero, free memory is also limited to what the peak
+    // used memory, over the last one to two windows of that many deallocations, could re-use, so
+    // the pool shrinks back once a spike in demand has passed.
+    class SegmentedMemoryAllocator final : public MemoryAllocator {
       public:
         SegmentedMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator,
-                                 uint64_t memoryAlignment);
+                                 uint64_t memoryAlignment,
+                                 uint64_t reservedMemorySize = 0,
+                                 uint64_t reservedMemoryCount = 0,
+                                 double bestFitWasteLimit = 0,
+                                 uint64_t maxSegmentPoolSize = kInvalidSize,
+                                 uint64_t maxPoolSize = kInvalidSize,
+                                 uint64_t peakUsageWindow = 0);
         ~SegmentedMemoryAllocator() override;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
-        void ReleaseMemory() override;
+        // Releases memory from the least recently used segments first.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
         uint64_t GetMemoryAlignment() const override;
 
+        // Adds memory which was allocated by the child allocator outside of this allocator (ex.
+        // imported), as free memory of its size. Deallocated by the child allocator once released.
+        void ImportMemory(std::unique_ptr<MemoryAllocation> allocation);
+
         uint64_t GetSegmentSizeForTesting() const;
 
+        // Blocks until every reserved memory requested so far was allocated.
+        void WaitForReservedMemoryForTesting();
+
       private:
+        friend class ReserveMemoryTask;
+
         MemorySegment* GetOrCreateFreeSegment(uint64_t memorySize);
+        std::unique_ptr<MemoryAllocation> AcquireResidentFromSegment(MemorySegment* segment);
+
+        // Returns free memory of the smallest segment larger than |memorySize| within the
+        // best-fit waste limit, and the segment it came from, or nullptr if none was free.
+        std::unique_ptr<MemoryAllocation> AcquireBestFitFromLargerSegment(
+            uint64_t memorySize,
+            MemorySegment** segmentOut);
+
+        // Returns the most free memory to keep pooled, given the recent peak used memory.
+        // Must be called with the allocator locked.
+        uint64_t GetPoolSizeLimit() const;
+
+        // Releases free memory from the least recently used segments first. Must be called with
+        // the allocator locked.
+        uint64_t ReleaseLeastRecentlyUsedMemory(uint64_t bytesToRelease);
+
+        // Requests enough reserved memory be allocated in the background to refill |segment|.
+        // Must be called with the allocator locked.
+        void ReserveMemoryAsync(MemorySegment* segment);
+
+        // Allocates reserved memory then returns it to |segment|. Called without the allocator
+        // locked, by ReserveMemoryTask.
+        void ReserveMemory(MemorySegment* segment);
 
         LinkedList<MemorySegment> mFreeSegments;
 
+        // Segments of power-of-two sizes, indexed by log2 of the size, and every other size.
+        std::array<MemorySegment*, 64> mPowerOfTwoSegments;
+        std::unordered_map<uint64_t, MemorySegment*> mSegmentsBySize;
+        uint64_t mNextUsedSequence = 0;
+
         const uint64_t mMemoryAlignment;
+
+        const uint64_t mReservedMemorySize;
+        const uint64_t mReservedMemoryCount;
+
+        const double mBestFitWasteLimit;
+
+        // Size (in bytes) wasted by each used memory re-used from a larger segment.
+        std::unordered_map<MemoryBase*, uint64_t> mBestFitWastedSizes;
+
+        const uint64_t mMaxSegmentPoolSize;
+        const uint64_t mMaxPoolSize;
+
+        // Peak used memory of the current and previous window of deallocations.
+        const uint64_t mPeakUsageWindow;
+        uint64_t mPeakUsage = 0;
+        uint64_t mPrevPeakUsage = 0;
+        uint64_t mDeallocationCountInWindow = 0;
+
+        // Reserved memory requested but not yet returned to its segment.
+        std::atomic<uint64_t> mPendingReservedMemoryCount = {0};
+        std::vector<std::shared_ptr<Event>> mReservedMemoryEvents;
     };
 
 }  // namespace gpgmm
@@ -0,0 +1,89 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/ShardedMemoryAllocator.h"
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace gpgmm {
+
+    namespace {
+
+        std::atomic<uint64_t> gNextShardedThreadIndex{0};
+
+        // Numbered once per thread, so a thread keeps using the same shard of every sharded
+        // allocator.
+        uint64_t GetShardedThreadIndex() {
+            static thread_local const uint64_t tlsThreadIndex =
+                gNextShardedThreadIndex.fetch_add(1, std::memory_order_relaxed);
+            return tlsThreadIndex;
+        }
+
+    }  // namespace
+
+    ShardedMemoryAllocator::ShardedMemoryAllocator(
+        std::vector<std::unique_ptr<MemoryAllocator>> shards) {
+        ASSERT(!shards.empty());
+        for (std::unique_ptr<MemoryAllocator>& shard : shards) {
+            mShards.push_back(AppendChild(std::move(shard)));
+        }
+    }
+
+    MemoryAllocator* ShardedMemoryAllocator::GetShardOfCurrentThread() const {
+        return mShards[GetShardedThreadIndex() % mShards.size()];
+    }
+
+    std::unique_ptr<MemoryAllocation> ShardedMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ShardedMemoryAllocator.TryAllocateMemory");
+
+        return GetShardOfCurrentThread()->TryAllocateMemory(request);
+    }
+
+    void ShardedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        // ShardedMemoryAllocator cannot allocate memory itself, so it must not deallocate.
+        allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+    }
+
+    // Every shard is allocated from memory of the same size and alignment.
+    uint64_t ShardedMemoryAllocator::GetMemorySize() const {
+        return mShards.front()->GetMemorySize();
+    }
+
+    uint64_t ShardedMemoryAllocator::GetMemoryAlignment() const {
+        return mShards.front()->GetMemoryAlignment();
+    }
+
+    MEMORY_ALLOCATOR_INFO ShardedMemoryAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = {};
+        for (const MemoryAllocator* shard : mShards) {
+            result += shard->QueryInfo();
+        }
+
+        return result;
+    }
+
+    bool ShardedMemoryAllocator::IsShard(const MemoryAllocator* allocator) const {
+        return std::find(mShards.begin(), mShards.end(), allocator) != mShards.end();
+    }
+
+    MemoryAllocator* ShardedMemoryAllocator::GetShardForTesting(size_t shardIndex) const {
+        return mShards[shardIndex];
+    }
+
+}  // namespace gpgmm
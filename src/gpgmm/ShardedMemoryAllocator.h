@@ -0,0 +1,60 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_SHARDEDMEMORYALLOCATOR_H_
+#define GPGMM_SHARDEDMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+
+#include <vector>
+
+namespace gpgmm {
+
+    // ShardedMemoryAllocator spreads allocations over independent allocators, or "shards", by the
+    // calling thread, so threads allocating at once only contend with the threads of the same
+    // shard. Threads are assigned a shard round-robin, in the order they first allocate through
+    // any sharded allocator. With fewer shards than threads, each shard is used by several.
+    //
+    // Memory is always de-allocated by the shard which allocated it, from any thread. Shards
+    // typically allocate memory from the same (shared) allocator, so memory de-allocated by one
+    // shard can be re-used by another.
+    class ShardedMemoryAllocator final : public MemoryAllocator {
+      public:
+        explicit ShardedMemoryAllocator(std::vector<std::unique_ptr<MemoryAllocator>> shards);
+        ~ShardedMemoryAllocator() override = default;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+        // Returns true if |allocator| is one of the shards.
+        bool IsShard(const MemoryAllocator* allocator) const;
+
+        MemoryAllocator* GetShardForTesting(size_t shardIndex) const;
+
+      private:
+        MemoryAllocator* GetShardOfCurrentThread() const;
+
+        std::vector<MemoryAllocator*> mShards;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_SHARDEDMEMORYALLOCATOR_H_
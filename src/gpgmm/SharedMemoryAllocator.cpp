@@ -0,0 +1,47 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/SharedMemoryAllocator.h"
+
+#include "gpgmm/common/Assert.h"
+
+namespace gpgmm {
+
+    SharedMemoryAllocator::SharedMemoryAllocator(MemoryAllocator* memoryAllocator)
+        : mMemoryAllocator(memoryAllocator) {
+        ASSERT(mMemoryAllocator != nullptr);
+    }
+
+    std::unique_ptr<MemoryAllocation> SharedMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        return mMemoryAllocator->TryAllocateMemory(request);
+    }
+
+    void SharedMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        mMemoryAllocator->DeallocateMemory(std::move(allocation));
+    }
+
+    uint64_t SharedMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        return mMemoryAllocator->ReleaseMemory(bytesToRelease);
+    }
+
+    uint64_t SharedMemoryAllocator::GetMemorySize() const {
+        return mMemoryAllocator->GetMemorySize();
+    }
+
+    uint64_t SharedMemoryAllocator::GetMemoryAlignment() const {
+        return mMemoryAllocator->GetMemoryAlignment();
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,43 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_SHAREDMEMORYALLOCATOR_H_
+#define GPGMM_SHAREDMEMORYALLOCATOR_H_
+
+#include "gpgmm/MemoryAllocator.h"
+
+namespace gpgmm {
+
+    // SharedMemoryAllocator allocates memory from a memory allocator owned elsewhere, so memory
+    // de-allocated by one allocator can be re-used by another. The owner must outlive it and is
+    // responsible for querying the shared allocator, since it is not a child of this one.
+    class SharedMemoryAllocator final : public MemoryAllocator {
+      public:
+        explicit SharedMemoryAllocator(MemoryAllocator* memoryAllocator);
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+
+      private:
+        MemoryAllocator* const mMemoryAllocator;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_SHAREDMEMORYALLOCATOR_H_
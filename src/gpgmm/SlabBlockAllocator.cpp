@@ -45,8 +45,8 @@ namespace gpgmm {
 
         if (size > mBlockSize) {
             DebugEvent("SlabBlockAllocator.TryAllocateBlock", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
-                << "Allocation size exceeded the block size. (" + std::to_string(size) + " vs " +
-                       std::to_string(mBlockSize) + " bytes).";
+                << "Allocation size exceeded the block size. (" << size << " vs " << mBlockSize
+                << " bytes).";
             return nullptr;
         }
 
@@ -54,8 +54,8 @@ namespace gpgmm {
         if (!IsAligned(mBlockSize, alignment)) {
             DebugEvent("SlabBlockAllocator.TryAllocateBlock",
                        ALLOCATOR_MESSAGE_ID_ALIGNMENT_MISMATCH)
-                << "Allocation alignment is not a multiple of the block size. (" +
-                       std::to_string(alignment) + " vs " + std::to_string(mBlockSize) + " bytes).";
+                << "Allocation alignment is not a multiple of the block size. (" << alignment
+                << " vs " << mBlockSize << " bytes).";
             return nullptr;
         }
 
@@ -77,6 +77,11 @@ namespace gpgmm {
         return head;
     }
 
+    uint64_t SlabBlockAllocator::GetLargestFreeBlockSize() const {
+        // Blocks are never split, so any free block is the largest.
+        return (mFreeList.pHead != nullptr) ? mBlockSize : 0;
+    }
+
     void SlabBlockAllocator::DeallocateBlock(MemoryBlock* block) {
         ASSERT(block != nullptr);
 
@@ -35,6 +35,7 @@ namespace gpgmm {
         // BlockAllocator interface
         MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment = 1) override;
         void DeallocateBlock(MemoryBlock* block) override;
+        uint64_t GetLargestFreeBlockSize() const override;
 
       private:
         struct SlabBlock : public MemoryBlock {
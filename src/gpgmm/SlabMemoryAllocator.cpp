@@ -18,6 +18,7 @@
 #include "gpgmm/Memory.h"
 #include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Math.h"
+#include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/common/Utils.h"
 
 #include <algorithm>  // std::max
@@ -26,6 +27,20 @@ namespace gpgmm {
 
     constexpr static uint64_t kSlabPrefetchTotalBlockCount = 4u;
     constexpr static double kSlabPrefetchUsageThreshold = 0.50;
+    constexpr static uint64_t kMaxSlabPrefetchDepth = 4u;
+    constexpr static double kSlabPrefetchTimeoutInSeconds = 1.0;
+    constexpr static double kEmptySlabTimeoutInSeconds = 1.0;
+
+    namespace {
+
+        // Slab allocators must be unlinked from the list of the SlabCacheAllocator before being
+        // deleted.
+        void DeleteSlabAllocator(SlabMemoryAllocator*& slabAllocator) {
+            slabAllocator->RemoveFromList();
+            SafeDelete(slabAllocator);
+        }
+
+    }  // namespace
 
     // SlabMemoryAllocator
 
@@ -35,24 +50,30 @@ namespace gpgmm {
                                              uint64_t slabAlignment,
                                              double slabFragmentationLimit,
                                              bool prefetchSlab,
-                                             MemoryAllocator* memoryAllocator)
+                                             MemoryAllocator* memoryAllocator,
+                                             bool adaptSlabSize,
+                                             uint64_t maxEmptySlabCount,
+                                             MemoryAllocatorCounters* reuseCounters)
         : mBlockSize(blockSize),
           mMaxSlabSize(maxSlabSize),
           mSlabSize(slabSize),
           mSlabAlignment(slabAlignment),
           mSlabFragmentationLimit(slabFragmentationLimit),
           mPrefetchSlab(prefetchSlab),
-          mMemoryAllocator(memoryAllocator) {
+          mAdaptSlabSize(adaptSlabSize),
+          mMaxEmptySlabCount(maxEmptySlabCount),
+          mReuseCounters((reuseCounters != nullptr) ? reuseCounters : &mInfo),
+          mMemoryAllocator(memoryAllocator),
+          mPrefetchTimer(CreatePlatformTime()) {
         ASSERT(IsPowerOfTwo(mMaxSlabSize));
         ASSERT(mMemoryAllocator != nullptr);
         ASSERT(mSlabSize <= mMaxSlabSize);
     }
 
     SlabMemoryAllocator::~SlabMemoryAllocator() {
-        if (mNextSlabAllocationEvent != nullptr) {
-            mNextSlabAllocationEvent->Wait();
-            mMemoryAllocator->DeallocateMemory(mNextSlabAllocationEvent->AcquireAllocation());
-        }
+        CancelPrefetchedSlabMemory();
+        DrainRemoteFreeList();
+        ReleaseEmptySlabMemory(/*minEmptySeconds*/ 0);
 
         for (SlabCache& cache : mCaches) {
             cache.FreeList.RemoveAndDeleteAll();
@@ -88,72 +109,234 @@ namespace gpgmm {
         return cache;
     }
 
-    std::unique_ptr<MemoryAllocation> SlabMemoryAllocator::TryAllocateMemory(uint64_t size,
-                                                                             uint64_t alignment,
-                                                                             bool neverAllocate,
-                                                                             bool cacheSize,
-                                                                             bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SlabMemoryAllocator.TryAllocateMemory");
+    SlabMemoryAllocator::SlabCache* SlabMemoryAllocator::GetCacheForAllocation(
+        uint64_t slabSize) {
+        // Get or create the cache containing slabs of the slab size.
+        SlabCache* cache = GetOrCreateCache(slabSize);
+        ASSERT(cache != nullptr);
+
+        // Splice full slabs from the free-list to full-list. More than one slab could be full
+        // since deallocating from a full slab moves it ahead of the (possibly full) HEAD.
+        while (!cache->FreeList.empty() && cache->FreeList.head()->value()->IsFull()) {
+            cache->FullList.Splice(cache->FullList.begin(), cache->FreeList.head());
+        }
+
+        return cache;
+    }
+
+    SlabMemoryAllocator::Slab* SlabMemoryAllocator::FindFreeSlabWithMemory() {
+        for (SlabCache& cache : mCaches) {
+            for (Slab* slab : cache.FreeList) {
+                if (!slab->IsFull() && slab->SlabMemory != nullptr) {
+                    return slab;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<MemoryAllocation> SlabMemoryAllocator::AcquirePrefetchedSlabMemory(
+        uint64_t slabSize) {
+        const double now = mPrefetchTimer->GetAbsoluteTime();
+
+        // Slabs being created faster than the prefetch depth allows need a deeper prefetch.
+        const bool isPrefetchBehind =
+            mPrefetchedSlabs.empty() || !mPrefetchedSlabs.front().Event->IsSignaled();
+        if (isPrefetchBehind && mLastSlabMemoryTime >= 0 &&
+            now - mLastSlabMemoryTime < kSlabPrefetchTimeoutInSeconds) {
+            mPrefetchDepth = std::min(mPrefetchDepth + 1, kMaxSlabPrefetchDepth);
+        }
+
+        mLastSlabMemoryTime = now;
+
+        // The slab size could have changed since the prefetch started.
+        while (!mPrefetchedSlabs.empty()) {
+            std::shared_ptr<MemoryAllocationEvent> event = mPrefetchedSlabs.front().Event;
+            mPrefetchedSlabs.pop_front();
+
+            const bool isWaiting = !event->IsSignaled();
+            event->Wait();
+            std::unique_ptr<MemoryAllocation> slabMemory = event->AcquireAllocation();
+            if (slabMemory == nullptr) {
+                continue;
+            }
+
+            if (slabMemory->GetSize() == slabSize) {
+                mReuseCounters->PrefetchedMemoryReuseCount++;
+                if (isWaiting) {
+                    mReuseCounters->PrefetchedMemoryWaitCount++;
+                }
+                return slabMemory;
+            }
+
+            mMemoryAllocator->DeallocateMemory(std::move(slabMemory));
+        }
+
+        return nullptr;
+    }
+
+    void SlabMemoryAllocator::ReleaseExpiredPrefetchedSlabMemory() {
+        if (mPrefetchedSlabs.empty()) {
+            return;
+        }
+
+        const double now = mPrefetchTimer->GetAbsoluteTime();
+        while (!mPrefetchedSlabs.empty()) {
+            const SlabPrefetch& prefetch = mPrefetchedSlabs.front();
+            if (now - prefetch.PrefetchTime < kSlabPrefetchTimeoutInSeconds ||
+                !prefetch.Event->IsSignaled()) {
+                break;
+            }
+
+            std::unique_ptr<MemoryAllocation> slabMemory = prefetch.Event->AcquireAllocation();
+            if (slabMemory != nullptr) {
+                mMemoryAllocator->DeallocateMemory(std::move(slabMemory));
+            }
+
+            mPrefetchedSlabs.pop_front();
+            mPrefetchDepth = std::max(mPrefetchDepth - 1, uint64_t(1));
+        }
+    }
+
+    uint64_t SlabMemoryAllocator::CancelPrefetchedSlabMemory() {
+        uint64_t bytesReleased = 0;
+        for (SlabPrefetch& prefetch : mPrefetchedSlabs) {
+            if (!prefetch.Event->IsSignaled()) {
+                prefetch.Event->Cancel();
+                continue;
+            }
+
+            std::unique_ptr<MemoryAllocation> slabMemory = prefetch.Event->AcquireAllocation();
+            if (slabMemory != nullptr) {
+                bytesReleased += slabMemory->GetSize();
+                mMemoryAllocator->DeallocateMemory(std::move(slabMemory));
+            }
+        }
+
+        mPrefetchedSlabs.clear();
+        return bytesReleased;
+    }
+
+    uint64_t SlabMemoryAllocator::ReleaseEmptySlabMemory(double minEmptySeconds,
+                                                         uint64_t bytesToRelease) {
+        if (mEmptySlabCount == 0) {
+            return 0;
+        }
+
+        const double now = mPrefetchTimer->GetAbsoluteTime();
+
+        uint64_t bytesReleased = 0;
+        for (SlabCache& cache : mCaches) {
+            for (Slab* slab : cache.FreeList) {
+                if (bytesReleased >= bytesToRelease) {
+                    return bytesReleased;
+                }
+                if (slab->GetRefCount() > 0 || slab->SlabMemory == nullptr ||
+                    now - slab->EmptyTime < minEmptySeconds) {
+                    continue;
+                }
+
+                bytesReleased += slab->SlabMemory->GetSize();
+                mMemoryAllocator->DeallocateMemory(std::move(slab->SlabMemory));
+
+                ASSERT(cache.EmptySlabCount > 0);
+                cache.EmptySlabCount--;
+                mEmptySlabCount--;
+            }
+        }
+
+        return bytesReleased;
+    }
+
+    std::unique_ptr<MemoryAllocation> SlabMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabMemoryAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
-        if (size > mBlockSize) {
+        DrainRemoteFreeList();
+
+        if (request.Size > mBlockSize) {
             DebugEvent("SlabMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
-                << "Allocation size exceeded the block size (" + std::to_string(size) + " vs " +
-                       std::to_string(mBlockSize) + " bytes).";
+                << "Allocation size exceeded the block size (" << request.Size << " vs "
+                << mBlockSize << " bytes).";
             return {};
         }
 
-        const uint64_t slabSize = ComputeSlabSize(size);
+        uint64_t slabSize = std::max(ComputeSlabSize(request.Size), mAdaptedSlabSize);
         if (slabSize > mMaxSlabSize) {
             DebugEvent("SlabMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
-                << "Slab size exceeded the max slab size (" + std::to_string(slabSize) + " vs " +
-                       std::to_string(mMaxSlabSize) + " bytes).";
+                << "Slab size exceeded the max slab size (" << slabSize << " vs " << mMaxSlabSize
+                << " bytes).";
             return {};
         }
 
-        // Get or create the cache containing slabs of the slab size.
-        SlabCache* cache = GetOrCreateCache(slabSize);
-        ASSERT(cache != nullptr);
-
-        auto* node = cache->FreeList.head();
+        SlabCache* cache = GetCacheForAllocation(slabSize);
+
+        // Should a slab of this size need new memory larger than the limit, use smaller slabs
+        // instead, down to a single block.
+        const bool isSlabSizeLimited =
+            request.MemorySizeLimit > 0 && slabSize > request.MemorySizeLimit &&
+            (cache->FreeList.empty() || cache->FreeList.head()->value()->SlabMemory == nullptr);
+        if (isSlabSizeLimited) {
+            slabSize =
+                std::max(NextPowerOfTwo(mBlockSize), PrevPowerOfTwo(request.MemorySizeLimit));
+            cache = GetCacheForAllocation(slabSize);
+        }
 
+        // Slabs created before the slab size changed are in another cache, use those before
+        // creating a new slab.
         Slab* slab = nullptr;
-        if (!cache->FreeList.empty()) {
-            slab = node->value();
+        if (cache->FreeList.empty() && mAdaptSlabSize) {
+            slab = FindFreeSlabWithMemory();
         }
 
-        // Splice the full slab from the free-list to full-list.
-        if (slab != nullptr && slab->IsFull()) {
-            node->RemoveFromList();
-            node->InsertBefore(cache->FullList.head());
+        if (slab == nullptr) {
+            // Push new slab at HEAD if free-list is empty.
+            if (cache->FreeList.empty()) {
+                Slab* newSlab = new Slab(slabSize / mBlockSize, mBlockSize);
+                cache->FreeList.Prepend(newSlab);
+            }
+
+            slab = cache->FreeList.head()->value();
+            ASSERT(!cache->FreeList.empty());
         }
 
-        // Push new slab at HEAD if free-list is empty.
-        if (cache->FreeList.empty()) {
-            Slab* newSlab = new Slab(slabSize / mBlockSize, mBlockSize);
-            newSlab->InsertBefore(cache->FreeList.head());
-            slab = newSlab;
+        // Empty slabs which kept their memory could be behind the HEAD, use those before
+        // allocating memory for it.
+        if (slab->SlabMemory == nullptr && mEmptySlabCount > 0) {
+            Slab* slabWithMemory = FindFreeSlabWithMemory();
+            if (slabWithMemory != nullptr) {
+                slab = slabWithMemory;
+            }
         }
 
-        ASSERT(!cache->FreeList.empty());
         ASSERT(slab != nullptr);
 
+        const bool isEmptySlabReused = slab->GetRefCount() == 0 && slab->SlabMemory != nullptr;
+
+        // Hot size classes, which need memory for another slab while one is full, get larger
+        // slabs next time.
+        const bool isSlabSizeGrowing = mAdaptSlabSize && !isSlabSizeLimited &&
+                                       slab->SlabMemory == nullptr && !cache->FullList.empty() &&
+                                       slabSize < mMaxSlabSize;
+
+        // Slab memory keeps the hints of the request which first needed it.
+        MEMORY_ALLOCATION_REQUEST slabRequest = request;
+        slabRequest.Size = slabSize;
+        slabRequest.Alignment = mSlabAlignment;
+        slabRequest.PrefetchMemory = false;
+
         std::unique_ptr<MemoryAllocation> subAllocation;
         GPGMM_TRY_ASSIGN(
             TrySubAllocateMemory(
-                &slab->Allocator, mBlockSize, alignment,
-                [&](const auto& block) -> MemoryBase* {
+                &slab->Allocator, mBlockSize, request.Alignment,
+                [&](const auto&) -> MemoryBase* {
                     if (slab->SlabMemory == nullptr) {
-                        // Resolve the pending pre-fetched allocation.
-                        if (mNextSlabAllocationEvent != nullptr) {
-                            mNextSlabAllocationEvent->Wait();
-                            slab->SlabMemory = mNextSlabAllocationEvent->AcquireAllocation();
-                            mNextSlabAllocationEvent.reset();
-                        } else {
-                            GPGMM_TRY_ASSIGN(mMemoryAllocator->TryAllocateMemory(
-                                                 slabSize, mSlabAlignment, neverAllocate, cacheSize,
-                                                 /*prefetchMemory*/ false),
+                        // Resolve the oldest pending pre-fetched allocation.
+                        slab->SlabMemory = AcquirePrefetchedSlabMemory(slabSize);
+                        if (slab->SlabMemory == nullptr) {
+                            GPGMM_TRY_ASSIGN(mMemoryAllocator->TryAllocateMemory(slabRequest),
                                              slab->SlabMemory);
                         }
                     }
@@ -166,7 +349,24 @@ namespace gpgmm {
         // deallocated, can slab memory be safely released.
         slab->Ref();
 
-        // Prefetch memory for future slab.
+        if (isEmptySlabReused) {
+            SlabCache* emptySlabCache = GetOrCreateCache(slab->SlabMemory->GetSize());
+            ASSERT(emptySlabCache->EmptySlabCount > 0);
+            emptySlabCache->EmptySlabCount--;
+            mEmptySlabCount--;
+            mReuseCounters->RetainedMemoryReuseCount++;
+        }
+
+        if (isSlabSizeGrowing) {
+            mAdaptedSlabSize = slabSize * 2;
+            TRACE_COUNTER1(TraceEventCategory::Slab, "GPU slab size (KBytes)",
+                           mAdaptedSlabSize / 1e3);
+        }
+
+        ReleaseExpiredPrefetchedSlabMemory();
+        ReleaseEmptySlabMemory(kEmptySlabTimeoutInSeconds);
+
+        // Prefetch memory for future slabs, one per allocation until the prefetch depth is met.
         //
         // Algorithm is overly conservative since waiting for the device to return prefetched memory
         // could block a current allocation from being created until the device is free.
@@ -177,18 +377,74 @@ namespace gpgmm {
         // TODO: Measure if the slab allocation time remaining exceeds the prefetch memory task
         // time before deciding to prefetch.
         //
-        if ((prefetchMemory || mPrefetchSlab) && !neverAllocate &&
-            mNextSlabAllocationEvent == nullptr && cache->FullList.head() != nullptr &&
+        if ((request.PrefetchMemory || mPrefetchSlab) && !request.NeverAllocate &&
+            !isSlabSizeLimited && mPrefetchedSlabs.size() < mPrefetchDepth &&
+            cache->FullList.head() != nullptr &&
             slab->GetUsedPercent() >= kSlabPrefetchUsageThreshold &&
             slab->BlockCount >= kSlabPrefetchTotalBlockCount) {
-            mNextSlabAllocationEvent =
-                mMemoryAllocator->TryAllocateMemoryAsync(slabSize, mSlabAlignment);
+            MEMORY_ALLOCATION_REQUEST prefetchRequest = slabRequest;
+            prefetchRequest.CacheSize = true;
+
+            SlabPrefetch prefetch;
+            prefetch.Event = mMemoryAllocator->TryAllocateMemoryAsync(prefetchRequest,
+                                                                     TaskClass::kPrefetch);
+            prefetch.PrefetchTime = mPrefetchTimer->GetAbsoluteTime();
+            mPrefetchedSlabs.push_back(prefetch);
+        }
+
+        return CreateBlockInSlab(slab, std::move(subAllocation));
+    }
+
+    bool SlabMemoryAllocator::TryPrefetchSlabMemory(const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabMemoryAllocator.TryPrefetchSlabMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        ASSERT(request.Size <= mBlockSize);
+
+        ReleaseExpiredPrefetchedSlabMemory();
+
+        if (mPrefetchedSlabs.size() >= mPrefetchDepth || mEmptySlabCount > 0) {
+            return false;
+        }
+
+        const uint64_t slabSize = std::max(ComputeSlabSize(request.Size), mAdaptedSlabSize);
+        if (slabSize > mMaxSlabSize ||
+            (request.MemorySizeLimit > 0 && slabSize > request.MemorySizeLimit)) {
+            return false;
         }
 
+        // Full slabs are moved to the full-list, so the slab at the HEAD has a free block.
+        SlabCache* cache = GetCacheForAllocation(slabSize);
+        if (!cache->FreeList.empty() && cache->FreeList.head()->value()->SlabMemory != nullptr) {
+            return false;
+        }
+
+        if (cache->FreeList.empty() && mAdaptSlabSize && FindFreeSlabWithMemory() != nullptr) {
+            return false;
+        }
+
+        MEMORY_ALLOCATION_REQUEST prefetchRequest = request;
+        prefetchRequest.Size = slabSize;
+        prefetchRequest.Alignment = mSlabAlignment;
+        prefetchRequest.PrefetchMemory = false;
+        prefetchRequest.CacheSize = true;
+
+        SlabPrefetch prefetch;
+        prefetch.Event =
+            mMemoryAllocator->TryAllocateMemoryAsync(prefetchRequest, TaskClass::kPrefetch);
+        prefetch.PrefetchTime = mPrefetchTimer->GetAbsoluteTime();
+        mPrefetchedSlabs.push_back(prefetch);
+        return true;
+    }
+
+    std::unique_ptr<MemoryAllocation> SlabMemoryAllocator::CreateBlockInSlab(
+        Slab* slab,
+        std::unique_ptr<MemoryAllocation> subAllocation) {
         // Wrap the block in the containing slab. Since the slab's block could reside in another
         // allocated block, the slab's allocation offset must be made relative to slab's underlying
         // memory and not the slab.
-        BlockInSlab* blockInSlab = new BlockInSlab();
+        BlockInSlab* blockInSlab = mBlockInSlabPool.Acquire();
         blockInSlab->pBlock = subAllocation->GetBlock();
         blockInSlab->pSlab = slab;
         blockInSlab->Size = subAllocation->GetBlock()->Size;
@@ -202,25 +458,97 @@ namespace gpgmm {
                                                   AllocationMethod::kSubAllocated, blockInSlab);
     }
 
-    void SlabMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SlabMemoryAllocator.DeallocateMemory");
+    std::unique_ptr<MemoryAllocation> SlabMemoryAllocator::TryRelocateMemory(
+        const MemoryAllocation& allocation,
+        uint64_t alignment,
+        double maxUsedPercent) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabMemoryAllocator.TryRelocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
-        const BlockInSlab* blockInSlab = static_cast<BlockInSlab*>(subAllocation->GetBlock());
+        const BlockInSlab* blockInSlab = static_cast<const BlockInSlab*>(allocation.GetBlock());
         ASSERT(blockInSlab != nullptr);
 
+        Slab* srcSlab = blockInSlab->pSlab;
+        ASSERT(srcSlab != nullptr);
+
+        if (srcSlab->GetUsedPercent() > maxUsedPercent) {
+            return {};
+        }
+
+        // Denser slabs could be in any cache since the slab size could have changed.
+        Slab* dstSlab = nullptr;
+        for (SlabCache& cache : mCaches) {
+            for (Slab* slab : cache.FreeList) {
+                if (slab == srcSlab || slab->IsFull() || slab->SlabMemory == nullptr ||
+                    slab->GetUsedPercent() <= srcSlab->GetUsedPercent()) {
+                    continue;
+                }
+                if (dstSlab == nullptr || slab->GetUsedPercent() > dstSlab->GetUsedPercent()) {
+                    dstSlab = slab;
+                }
+            }
+        }
+
+        if (dstSlab == nullptr) {
+            return {};
+        }
+
+        std::unique_ptr<MemoryAllocation> subAllocation;
+        GPGMM_TRY_ASSIGN(TrySubAllocateMemory(&dstSlab->Allocator, mBlockSize, alignment,
+                                              [&](const auto&) -> MemoryBase* {
+                                                  return dstSlab->SlabMemory->GetMemory();
+                                              }),
+                         subAllocation);
+
+        dstSlab->Ref();
+
+        return CreateBlockInSlab(dstSlab, std::move(subAllocation));
+    }
+
+    void SlabMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabMemoryAllocator.DeallocateMemory");
+
+        BlockInSlab* blockInSlab = static_cast<BlockInSlab*>(subAllocation->GetBlock());
+        ASSERT(blockInSlab != nullptr);
+        ASSERT(blockInSlab->pSlab->SlabMemory->GetMemory() == subAllocation->GetMemory());
+
+        // Rather than wait on the thread holding the lock, leave the block for it to drain.
+        std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            BlockInSlab* head = mRemoteFreeList.load(std::memory_order_relaxed);
+            do {
+                blockInSlab->pNextRemoteFree = head;
+            } while (!mRemoteFreeList.compare_exchange_weak(
+                head, blockInSlab, std::memory_order_release, std::memory_order_relaxed));
+            return;
+        }
+
+        DrainRemoteFreeList();
+        DeallocateBlockInSlab(blockInSlab);
+    }
+
+    void SlabMemoryAllocator::DrainRemoteFreeList() {
+        BlockInSlab* blockInSlab = mRemoteFreeList.exchange(nullptr, std::memory_order_acquire);
+        while (blockInSlab != nullptr) {
+            BlockInSlab* next = blockInSlab->pNextRemoteFree;
+            blockInSlab->pNextRemoteFree = nullptr;
+            DeallocateBlockInSlab(blockInSlab);
+            blockInSlab = next;
+        }
+    }
+
+    void SlabMemoryAllocator::DeallocateBlockInSlab(BlockInSlab* blockInSlab) {
         Slab* slab = blockInSlab->pSlab;
         ASSERT(slab != nullptr);
 
-        MemoryBase* slabMemory = subAllocation->GetMemory();
+        MemoryBase* slabMemory = slab->SlabMemory->GetMemory();
         ASSERT(slabMemory != nullptr);
 
         // Splice the slab from the full-list to free-list.
         if (slab->IsFull()) {
             SlabCache* cache = GetOrCreateCache(slabMemory->GetSize());
-            slab->RemoveFromList();
-            slab->InsertBefore(cache->FreeList.head());
+            cache->FreeList.Splice(cache->FreeList.begin(), slab);
         }
 
         mInfo.UsedBlockCount--;
@@ -228,23 +556,82 @@ namespace gpgmm {
 
         MemoryBlock* block = blockInSlab->pBlock;
         slab->Allocator.DeallocateBlock(block);
-        SafeDelete(blockInSlab);
+        mBlockInSlabPool.Release(blockInSlab);
 
         slabMemory->Unref();
 
-        // If the slab will be empty, release the underlying memory.
+        ReleaseEmptySlabMemory(kEmptySlabTimeoutInSeconds);
+
+        // If the slab will be empty, release the underlying memory unless the slab keeps it.
         if (slab->Unref()) {
-            mMemoryAllocator->DeallocateMemory(std::move(slab->SlabMemory));
+            SlabCache* cache = GetOrCreateCache(slabMemory->GetSize());
+            if (cache->EmptySlabCount < mMaxEmptySlabCount) {
+                slab->EmptyTime = mPrefetchTimer->GetAbsoluteTime();
+                cache->EmptySlabCount++;
+                mEmptySlabCount++;
+            } else {
+                mMemoryAllocator->DeallocateMemory(std::move(slab->SlabMemory));
+            }
+        }
+
+        // Cold size classes, which no longer have any blocks allocated, get smaller slabs next
+        // time.
+        if (mAdaptSlabSize && mAdaptedSlabSize > 0 && mInfo.UsedBlockCount.Load() == 0) {
+            mAdaptedSlabSize /= 2;
+            TRACE_COUNTER1(TraceEventCategory::Slab, "GPU slab size (KBytes)",
+                           mAdaptedSlabSize / 1e3);
         }
     }
 
-    MEMORY_ALLOCATOR_INFO SlabMemoryAllocator::QueryInfo() const {
+    uint64_t SlabMemoryAllocator::ReleaseMemory(uint64_t bytesToRelease) {
         std::lock_guard<std::mutex> lock(mMutex);
-        MEMORY_ALLOCATOR_INFO result = mInfo;
+        DrainRemoteFreeList();
+        const uint64_t bytesReleased = CancelPrefetchedSlabMemory();
+        if (bytesReleased >= bytesToRelease) {
+            return bytesReleased;
+        }
+        return bytesReleased +
+               ReleaseEmptySlabMemory(/*minEmptySeconds*/ 0, bytesToRelease - bytesReleased);
+    }
+
+    MEMORY_ALLOCATOR_INFO SlabMemoryAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
         const MEMORY_ALLOCATOR_INFO& info = mMemoryAllocator->QueryInfo();
         result.UsedMemoryCount = info.UsedMemoryCount;
         result.UsedMemoryUsage = info.UsedMemoryUsage;
         result.FreeMemoryUsage = info.FreeMemoryUsage;
+        result.EvictedMemoryReuseCount += info.EvictedMemoryReuseCount;
+        result.RetainedMemoryReuseCount += info.RetainedMemoryReuseCount;
+        result.PrefetchedMemoryReuseCount += info.PrefetchedMemoryReuseCount;
+        result.PrefetchedMemoryWaitCount += info.PrefetchedMemoryWaitCount;
+        result.PooledMemoryHitCount += info.PooledMemoryHitCount;
+        result.PooledMemoryMissCount += info.PooledMemoryMissCount;
+        result.BestFitWastedUsage += info.BestFitWastedUsage;
+        return result;
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO SlabMemoryAllocator::QueryFragmentationInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Full slabs have no free blocks.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        for (const SlabCache& cache : mCaches) {
+            for (auto* node = cache.FreeList.head(); node != cache.FreeList.end();
+                 node = node->next()) {
+                const Slab* slab = node->value();
+                if (slab->SlabMemory == nullptr) {
+                    continue;
+                }
+                if (slab->GetRefCount() == 0) {
+                    result.PooledMemoryUsage += slab->SlabMemory->GetSize();
+                    continue;
+                }
+                result.FreeBlockUsage +=
+                    (slab->BlockCount - static_cast<uint32_t>(slab->GetRefCount())) * mBlockSize;
+                result.LargestFreeBlockSize = std::max(result.LargestFreeBlockSize,
+                                                       slab->Allocator.GetLargestFreeBlockSize());
+            }
+        }
         return result;
     }
 
@@ -270,6 +657,36 @@ namespace gpgmm {
         return slabMemoryCount;
     }
 
+    uint64_t SlabMemoryAllocator::GetEmptySlabCount() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEmptySlabCount;
+    }
+
+    uint64_t SlabMemoryAllocator::GetPrefetchDepthForTesting() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPrefetchDepth;
+    }
+
+    // SlabCacheAllocator::SlabAllocatorCacheEntry
+
+    SlabCacheAllocator::SlabAllocatorCacheEntry::SlabAllocatorCacheEntry(uint64_t blockSize)
+        : mBlockSize(blockSize) {
+    }
+
+    SlabCacheAllocator::SlabAllocatorCacheEntry::SlabAllocatorCacheEntry(
+        SlabAllocatorCacheEntry&& other)
+        : NonCopyable(std::move(other)),
+          pSlabAllocator(other.pSlabAllocator),
+          mBlockSize(other.mBlockSize) {
+        other.pSlabAllocator = nullptr;
+    }
+
+    SlabCacheAllocator::SlabAllocatorCacheEntry::~SlabAllocatorCacheEntry() {
+        if (pSlabAllocator != nullptr) {
+            DeleteSlabAllocator(pSlabAllocator);
+        }
+    }
+
     // SlabCacheAllocator
 
     SlabCacheAllocator::SlabCacheAllocator(uint64_t minBlockSize,
@@ -278,55 +695,105 @@ namespace gpgmm {
                                            uint64_t slabAlignment,
                                            double slabFragmentationLimit,
                                            bool prefetchSlab,
-                                           std::unique_ptr<MemoryAllocator> memoryAllocator)
+                                           std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                           bool adaptSlabSize,
+                                           uint64_t maxEmptySlabCount,
+                                           bool predictSlab)
         : MemoryAllocator(std::move(memoryAllocator)),
           mMinBlockSize(minBlockSize),
           mMaxSlabSize(maxSlabSize),
           mSlabSize(slabSize),
           mSlabAlignment(slabAlignment),
           mSlabFragmentationLimit(slabFragmentationLimit),
-          mPrefetchSlab(prefetchSlab) {
+          mPrefetchSlab(prefetchSlab),
+          mAdaptSlabSize(adaptSlabSize),
+          mMaxEmptySlabCount(maxEmptySlabCount),
+          mSizeCache(kMaxCachedSlabAllocatorCount) {
         ASSERT(IsPowerOfTwo(mMaxSlabSize));
+        if (predictSlab) {
+            mPredictor = std::make_unique<AllocationPredictor>();
+        }
     }
 
     SlabCacheAllocator::~SlabCacheAllocator() {
         mSizeCache.RemoveAndDeleteAll();
         mSlabAllocators.RemoveAndDeleteAll();
+
+        // Prefetches cancelled while in-flight still use the memory allocator.
+        GetFirstChild()->WaitForPendingAllocations();
     }
 
-    std::unique_ptr<MemoryAllocation> SlabCacheAllocator::TryAllocateMemory(uint64_t size,
-                                                                            uint64_t alignment,
-                                                                            bool neverAllocate,
-                                                                            bool cacheSize,
-                                                                            bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SlabCacheAllocator.TryAllocateMemory");
+    std::unique_ptr<MemoryAllocation> SlabCacheAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabCacheAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
-        GPGMM_CHECK_NONZERO(size);
+        GPGMM_CHECK_NONZERO(request.Size);
 
-        const uint64_t blockSize = AlignTo(size, mMinBlockSize);
+        const uint64_t blockSize = AlignTo(request.Size, mMinBlockSize);
 
-        // Create a slab allocator for the new entry.
-        auto entry = mSizeCache.GetOrCreate(SlabAllocatorCacheEntry(blockSize), cacheSize);
-        SlabMemoryAllocator* slabAllocator = entry->GetValue().pSlabAllocator;
-        if (slabAllocator == nullptr) {
-            slabAllocator =
-                new SlabMemoryAllocator(blockSize, mMaxSlabSize, mSlabSize, mSlabAlignment,
-                                        mSlabFragmentationLimit, mPrefetchSlab, GetFirstChild());
-            entry->GetValue().pSlabAllocator = slabAllocator;
-            mSlabAllocators.Append(slabAllocator);
+        if (mPredictor != nullptr) {
+            if (mPredictedBlockSize != kInvalidSize) {
+                if (mPredictedBlockSize == blockSize) {
+                    mInfo.PredictedSizeHitCount++;
+                } else {
+                    mInfo.PredictedSizeMissCount++;
+                }
+            }
+            mPredictor->Record(blockSize);
+            mPredictedBlockSize = mPredictor->Predict();
+        }
+
+        // Create a slab allocator for the new size class or entry.
+        SlabMemoryAllocator* slabAllocator = nullptr;
+        ScopedRef<MemoryCache<SlabAllocatorCacheEntry>::CacheEntryT> entry;
+        SlabAllocatorSizeClass* sizeClass = GetOrCreateSizeClass(blockSize);
+        if (sizeClass != nullptr) {
+            if (sizeClass->pSlabAllocator == nullptr) {
+                sizeClass->pSlabAllocator = CreateSlabAllocator(blockSize);
+            }
+            sizeClass->IsCached |= request.CacheSize;
+            slabAllocator = sizeClass->pSlabAllocator;
+        } else {
+            entry = mSizeCache.GetOrCreate(SlabAllocatorCacheEntry(blockSize), request.CacheSize);
+            if (entry->GetValue().pSlabAllocator == nullptr) {
+                entry->GetValue().pSlabAllocator = CreateSlabAllocator(blockSize);
+            }
+            slabAllocator = entry->GetValue().pSlabAllocator;
         }
 
         ASSERT(slabAllocator != nullptr);
 
+        MEMORY_ALLOCATION_REQUEST blockRequest = request;
+        blockRequest.Size = blockSize;
+
         std::unique_ptr<MemoryAllocation> subAllocation;
-        GPGMM_TRY_ASSIGN(slabAllocator->TryAllocateMemory(blockSize, alignment, neverAllocate,
-                                                          cacheSize, prefetchMemory),
-                         subAllocation);
+        GPGMM_TRY_ASSIGN(slabAllocator->TryAllocateMemory(blockRequest), subAllocation);
 
-        // Hold onto the cached allocator until the last allocation gets deallocated.
-        entry->Ref();
+        // Hold onto the allocator until the last allocation gets deallocated.
+        if (sizeClass != nullptr) {
+            sizeClass->UsedBlockCount++;
+        } else {
+            entry->Ref();
+        }
+
+        mInfo.UsedBlockCount++;
+        mInfo.UsedBlockUsage += blockSize;
+
+        // Blocks are rounded-up to the size class, which is wasted.
+        subAllocation->GetBlock()->RequestedSize = request.Size;
+        mRequestedBlockUsage += request.Size;
+
+        // Only size classes which were allocated before have a slab allocator to prefetch with.
+        if (mPredictedBlockSize != kInvalidSize && !request.NeverAllocate) {
+            SlabAllocatorSizeClass* predictedSizeClass = GetOrCreateSizeClass(mPredictedBlockSize);
+            if (predictedSizeClass != nullptr && predictedSizeClass->pSlabAllocator != nullptr) {
+                MEMORY_ALLOCATION_REQUEST predictedRequest = request;
+                predictedRequest.Size = mPredictedBlockSize;
+                predictedSizeClass->pSlabAllocator->TryPrefetchSlabMemory(predictedRequest);
+            }
+        }
 
         return std::make_unique<MemoryAllocation>(
             this, subAllocation->GetMemory(), subAllocation->GetOffset(),
@@ -334,10 +801,31 @@ namespace gpgmm {
     }
 
     void SlabCacheAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "SlabCacheAllocator.DeallocateMemory");
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabCacheAllocator.DeallocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
+        mInfo.UsedBlockCount--;
+        mInfo.UsedBlockUsage -= subAllocation->GetSize();
+        mRequestedBlockUsage -= subAllocation->GetBlock()->RequestedSize;
+
+        SlabAllocatorSizeClass* sizeClass = GetOrCreateSizeClass(subAllocation->GetSize());
+        if (sizeClass != nullptr) {
+            ASSERT(sizeClass->pSlabAllocator != nullptr);
+            ASSERT(sizeClass->UsedBlockCount > 0);
+
+            sizeClass->pSlabAllocator->DeallocateMemory(std::move(subAllocation));
+
+            // If this is the last sub-allocation, remove the allocator unless it was cached or
+            // kept empty slabs.
+            sizeClass->UsedBlockCount--;
+            if (sizeClass->UsedBlockCount == 0 && !sizeClass->IsCached &&
+                sizeClass->pSlabAllocator->GetEmptySlabCount() == 0) {
+                DeleteSlabAllocator(sizeClass->pSlabAllocator);
+            }
+            return;
+        }
+
         auto entry =
             mSizeCache.GetOrCreate(SlabAllocatorCacheEntry(subAllocation->GetSize()), false);
         SlabMemoryAllocator* slabAllocator = entry->GetValue().pSlabAllocator;
@@ -345,32 +833,136 @@ namespace gpgmm {
 
         slabAllocator->DeallocateMemory(std::move(subAllocation));
 
-        // If this is the last sub-allocation, remove the cached allocator.
-        // Once |entry| goes out of scope, it will unlink itself from the cache.
+        // If this is the last sub-allocation and the allocator was not cached, once |entry| goes
+        // out of scope, it will unlink itself from the cache and delete the allocator.
         entry->Unref();
-        if (entry->HasOneRef()) {
-            SafeDelete(slabAllocator);
+    }
+
+    std::unique_ptr<MemoryAllocation> SlabCacheAllocator::TryRelocateMemory(
+        const MemoryAllocation& allocation,
+        uint64_t alignment,
+        double maxUsedPercent) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabCacheAllocator.TryRelocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Relocate within the slab allocator of the same block size.
+        SlabMemoryAllocator* slabAllocator = nullptr;
+        ScopedRef<MemoryCache<SlabAllocatorCacheEntry>::CacheEntryT> entry;
+        SlabAllocatorSizeClass* sizeClass = GetOrCreateSizeClass(allocation.GetSize());
+        if (sizeClass != nullptr) {
+            slabAllocator = sizeClass->pSlabAllocator;
+        } else {
+            entry = mSizeCache.GetOrCreate(SlabAllocatorCacheEntry(allocation.GetSize()), false);
+            slabAllocator = entry->GetValue().pSlabAllocator;
+        }
+
+        ASSERT(slabAllocator != nullptr);
+
+        std::unique_ptr<MemoryAllocation> subAllocation;
+        GPGMM_TRY_ASSIGN(slabAllocator->TryRelocateMemory(allocation, alignment, maxUsedPercent),
+                         subAllocation);
+
+        // Hold onto the allocator until the last allocation gets deallocated.
+        if (sizeClass != nullptr) {
+            sizeClass->UsedBlockCount++;
+        } else {
+            entry->Ref();
         }
+
+        mInfo.UsedBlockCount++;
+        mInfo.UsedBlockUsage += subAllocation->GetSize();
+
+        subAllocation->GetBlock()->RequestedSize = allocation.GetBlock()->RequestedSize;
+        mRequestedBlockUsage += subAllocation->GetBlock()->RequestedSize;
+
+        return std::make_unique<MemoryAllocation>(
+            this, subAllocation->GetMemory(), subAllocation->GetOffset(),
+            subAllocation->GetMethod(), subAllocation->GetBlock());
     }
 
-    MEMORY_ALLOCATOR_INFO SlabCacheAllocator::QueryInfo() const {
+    uint64_t SlabCacheAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        TRACE_EVENT0(TraceEventCategory::Slab, "SlabCacheAllocator.ReleaseMemory");
+
         std::lock_guard<std::mutex> lock(mMutex);
 
-        MEMORY_ALLOCATOR_INFO result = {};
+        // Empty slabs only return their memory to the memory allocator, which releases it. Slab
+        // allocators are visited only until |bytesToRelease| bytes of slab memory were returned.
+        uint64_t bytesReturned = 0;
+        for (auto& table : mSizeClassTables) {
+            if (table == nullptr) {
+                continue;
+            }
+            for (SlabAllocatorSizeClass& sizeClass : *table) {
+                if (bytesReturned >= bytesToRelease) {
+                    break;
+                }
+                if (sizeClass.pSlabAllocator == nullptr) {
+                    continue;
+                }
+                bytesReturned +=
+                    sizeClass.pSlabAllocator->ReleaseMemory(bytesToRelease - bytesReturned);
+                if (bytesReturned < bytesToRelease && sizeClass.UsedBlockCount == 0 &&
+                    !sizeClass.IsCached) {
+                    DeleteSlabAllocator(sizeClass.pSlabAllocator);
+                }
+            }
+        }
+
         for (const auto& entry : mSizeCache) {
-            const MEMORY_ALLOCATOR_INFO& info = entry->GetValue().pSlabAllocator->QueryInfo();
-            result.UsedBlockCount += info.UsedBlockCount;
-            result.UsedBlockUsage += info.UsedBlockUsage;
+            if (bytesReturned >= bytesToRelease) {
+                break;
+            }
+            bytesReturned +=
+                entry->GetValue().pSlabAllocator->ReleaseMemory(bytesToRelease - bytesReturned);
         }
 
+        return GetFirstChild()->ReleaseMemory(bytesToRelease);
+    }
+
+    MEMORY_ALLOCATOR_INFO SlabCacheAllocator::QueryInfo() const {
+        // Blocks are counted when allocated through this allocator so the slab allocators do not
+        // need to be visited.
+        MEMORY_ALLOCATOR_INFO result = {};
+        result.UsedBlockCount = mInfo.UsedBlockCount.Load();
+        result.UsedBlockUsage = mInfo.UsedBlockUsage.Load();
+
         // Memory allocator is common across slab allocators.
         {
             const MEMORY_ALLOCATOR_INFO& info = GetFirstChild()->QueryInfo();
             result.FreeMemoryUsage = info.FreeMemoryUsage;
             result.UsedMemoryCount = info.UsedMemoryCount;
             result.UsedMemoryUsage = info.UsedMemoryUsage;
+            result.EvictedMemoryReuseCount = info.EvictedMemoryReuseCount;
+            result.RetainedMemoryReuseCount =
+                mInfo.RetainedMemoryReuseCount.Load() + info.RetainedMemoryReuseCount;
+            result.PrefetchedMemoryReuseCount =
+                mInfo.PrefetchedMemoryReuseCount.Load() + info.PrefetchedMemoryReuseCount;
+            result.PrefetchedMemoryWaitCount =
+                mInfo.PrefetchedMemoryWaitCount.Load() + info.PrefetchedMemoryWaitCount;
+            result.PooledMemoryHitCount = info.PooledMemoryHitCount;
+            result.PooledMemoryMissCount = info.PooledMemoryMissCount;
+            result.BestFitWastedUsage = info.BestFitWastedUsage;
+        }
+
+        result.PredictedSizeHitCount = mInfo.PredictedSizeHitCount.Load();
+        result.PredictedSizeMissCount = mInfo.PredictedSizeMissCount.Load();
+
+        return result;
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO SlabCacheAllocator::QueryFragmentationInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Free blocks are only known by the slab allocators, which never round-up blocks.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        for (auto* node = mSlabAllocators.head(); node != mSlabAllocators.end();
+             node = node->next()) {
+            result += node->value()->QueryFragmentationInfo();
         }
 
+        result.InternalFragmentationUsage =
+            mInfo.UsedBlockUsage.Load() - mRequestedBlockUsage.Load();
         return result;
     }
 
@@ -382,6 +974,17 @@ namespace gpgmm {
         std::lock_guard<std::mutex> lock(mMutex);
 
         uint64_t count = 0;
+        for (const auto& table : mSizeClassTables) {
+            if (table == nullptr) {
+                continue;
+            }
+            for (const SlabAllocatorSizeClass& sizeClass : *table) {
+                if (sizeClass.pSlabAllocator != nullptr) {
+                    count += sizeClass.pSlabAllocator->GetSlabSizeForTesting();
+                }
+            }
+        }
+
         for (const auto& entry : mSizeCache) {
             const SlabMemoryAllocator* allocator = entry->GetValue().pSlabAllocator;
             ASSERT(allocator != nullptr);
@@ -390,4 +993,31 @@ namespace gpgmm {
         return count;
     }
 
+    SlabCacheAllocator::SlabAllocatorSizeClass* SlabCacheAllocator::GetOrCreateSizeClass(
+        uint64_t blockSize) {
+        ASSERT(blockSize >= mMinBlockSize && blockSize % mMinBlockSize == 0);
+
+        const uint64_t sizeClassIndex = blockSize / mMinBlockSize - 1;
+        const uint64_t tableIndex = sizeClassIndex / kSizeClassesPerTable;
+        if (tableIndex >= kSizeClassTableCount) {
+            return nullptr;
+        }
+
+        std::unique_ptr<SizeClassTable>& table = mSizeClassTables[tableIndex];
+        if (table == nullptr) {
+            table = std::make_unique<SizeClassTable>();
+        }
+
+        return &(*table)[sizeClassIndex % kSizeClassesPerTable];
+    }
+
+    SlabMemoryAllocator* SlabCacheAllocator::CreateSlabAllocator(uint64_t blockSize) {
+        SlabMemoryAllocator* slabAllocator =
+            new SlabMemoryAllocator(blockSize, mMaxSlabSize, mSlabSize, mSlabAlignment,
+                                    mSlabFragmentationLimit, mPrefetchSlab, GetFirstChild(),
+                                    mAdaptSlabSize, mMaxEmptySlabCount, &mInfo);
+        mSlabAllocators.Append(slabAllocator);
+        return slabAllocator;
+    }
+
 }  // namespace gpgmm
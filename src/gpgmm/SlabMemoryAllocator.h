@@ -15,15 +15,23 @@
 #ifndef GPGMM_SLABMEMORYALLOCATOR_H_
 #define GPGMM_SLABMEMORYALLOCATOR_H_
 
+#include "gpgmm/AllocationPredictor.h"
 #include "gpgmm/MemoryAllocator.h"
 #include "gpgmm/MemoryCache.h"
 #include "gpgmm/SlabBlockAllocator.h"
 #include "gpgmm/common/LinkedList.h"
+#include "gpgmm/common/ObjectPool.h"
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 namespace gpgmm {
 
+    class PlatformTime;
+
     // SlabMemoryAllocator uses the slab allocation technique to sub-allocate slabs of device
     // memory. Unlike other allocators, the slab allocator eliminates memory fragmentation caused by
     // frequent allocation and de-allocations and always services requests in constant-time. The
@@ -38,6 +46,33 @@ namespace gpgmm {
     // cached on the block which is used to release the underlying slab memory once the last block
     // is de-allocated.
     //
+    // When |adaptSlabSize| is true, the slab size also adapts to how frequently blocks are
+    // allocated: each time a slab must be created because every other slab is full, the next slab
+    // is made twice as large, up to |maxSlabSize|, so fewer slabs (and memory) get created. Once
+    // every block is de-allocated, the slab size is halved again.
+    //
+    // When |prefetchSlab| is true, memory for up to the prefetch depth of future slabs is
+    // allocated in the background and handed out in the order prefetched. The depth grows while
+    // slabs are created faster than prefetches complete and shrinks when prefetched slab memory
+    // goes unused long enough to be released.
+    //
+    // When |maxEmptySlabCount| is non-zero, up to that many slabs of each slab size keep their
+    // memory once every block is de-allocated, so allocating from them again does not allocate
+    // memory. Otherwise, allocating and de-allocating a block across a slab boundary would
+    // allocate then de-allocate slab memory each time. Empty slabs are released once empty for
+    // longer than a timeout, checked upon allocation or de-allocation, or by ReleaseMemory. Each
+    // re-use of retained or prefetched slab memory is counted by |reuseCounters|, or by this
+    // allocator if nullptr.
+    //
+    // De-allocating never waits on another thread: should the allocator be locked, the block is
+    // pushed onto a lock-free remote-free list instead, which the thread holding the lock next
+    // drains (upon allocation, de-allocation, ReleaseMemory or destruction). Until drained, the
+    // block counts as used.
+    //
+    // Neither destroying the allocator nor ReleaseMemory waits on in-flight prefetches: they are
+    // cancelled, and memory they allocate is returned to |memoryAllocator| once they complete.
+    // The owner of |memoryAllocator| calls WaitForPendingAllocations before destroying it.
+    //
     // Slab allocator implementation is closely based on Jeff Bonwick's paper "The Slab Allocator".
     // https://people.eecs.berkeley.edu/~kubitron/courses/cs194-24-S13/hand-outs/bonwick_slab.pdf
     //
@@ -49,29 +84,50 @@ namespace gpgmm {
                             uint64_t slabAlignment,
                             double slabFragmentationLimit,
                             bool prefetchSlab,
-                            MemoryAllocator* memoryAllocator);
+                            MemoryAllocator* memoryAllocator,
+                            bool adaptSlabSize = false,
+                            uint64_t maxEmptySlabCount = 0,
+                            MemoryAllocatorCounters* reuseCounters = nullptr);
         ~SlabMemoryAllocator() override;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
 
+        // Releases the memory of empty slabs to the memory allocator, up to |bytesToRelease|
+        // bytes. Prefetched slab memory is always released first.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+
+        // Relocates to the most used slab with a free block, if it is used more than the slab
+        // containing |allocation|.
+        std::unique_ptr<MemoryAllocation> TryRelocateMemory(const MemoryAllocation& allocation,
+                                                            uint64_t alignment,
+                                                            double maxUsedPercent) override;
+
         MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
+
+        // Prefetches memory for another slab, for a |request| predicted to come next, unless a
+        // slab with a free block already has memory or the prefetch depth is met. Returns true
+        // if prefetched.
+        bool TryPrefetchSlabMemory(const MEMORY_ALLOCATION_REQUEST& request);
+
+        // Number of empty slabs which kept their memory.
+        uint64_t GetEmptySlabCount() const;
 
         uint64_t GetSlabSizeForTesting() const;
+        uint64_t GetPrefetchDepthForTesting() const;
 
       private:
         uint64_t ComputeSlabSize(uint64_t size) const;
 
         // Slab is a node in a doubly-linked list that contains a free-list of blocks
         // and a reference to the underlying memory.
-        struct Slab : public LinkNode<Slab>, public RefCounted {
+        // Only referenced while holding the allocator mutex.
+        struct Slab : public LinkNode<Slab>, public NonAtomicRefCounted {
             Slab(uint64_t blockCount, uint64_t blockSize)
-                : RefCounted(0), BlockCount(blockCount), Allocator(blockCount, blockSize) {
+                : NonAtomicRefCounted(0), BlockCount(blockCount), Allocator(blockCount, blockSize) {
             }
             ~Slab() {
                 if (IsInList()) {
@@ -89,6 +145,9 @@ namespace gpgmm {
             uint64_t BlockCount = 0;
             SlabBlockAllocator Allocator;
             std::unique_ptr<MemoryAllocation> SlabMemory;
+
+            // Time the last block was de-allocated, when the slab kept its memory.
+            double EmptyTime = 0;
         };
 
         // Stores a reference back to the slab containing the block so DeallocateMemory
@@ -96,6 +155,9 @@ namespace gpgmm {
         struct BlockInSlab : public MemoryBlock {
             MemoryBlock* pBlock = nullptr;
             Slab* pSlab = nullptr;
+
+            // Next block in the remote-free list, while de-allocation is pending.
+            BlockInSlab* pNextRemoteFree = nullptr;
         };
 
         // Group of one or more slabs of the same size.
@@ -104,26 +166,91 @@ namespace gpgmm {
                                         // slabs or some free blocks.
             LinkedList<Slab> FullList;  // Slabs that are full or all blocks
                                         // are marked as used.
+            uint64_t EmptySlabCount = 0;  // Empty slabs in the free-list that kept
+                                          // their memory.
         };
 
         SlabCache* GetOrCreateCache(uint64_t slabSize);
 
+        // Returns the cache of |slabSize| with its full slabs moved to the full-list.
+        SlabCache* GetCacheForAllocation(uint64_t slabSize);
+
+        // Returns a slab with free blocks and memory from any cache, or nullptr if none exist.
+        Slab* FindFreeSlabWithMemory();
+
+        // Returns the sub-allocation of a block from |slab|.
+        std::unique_ptr<MemoryAllocation> CreateBlockInSlab(
+            Slab* slab,
+            std::unique_ptr<MemoryAllocation> subAllocation);
+
+        // Returns |blockInSlab| to its slab. Must be called with mMutex held.
+        void DeallocateBlockInSlab(BlockInSlab* blockInSlab);
+
+        // De-allocates every block pushed onto the remote-free list. Must be called with mMutex
+        // held.
+        void DrainRemoteFreeList();
+
+        // Returns the oldest prefetched slab memory of |slabSize|, or nullptr if none exist.
+        std::unique_ptr<MemoryAllocation> AcquirePrefetchedSlabMemory(uint64_t slabSize);
+
+        // Releases prefetched slab memory that went unused for too long.
+        void ReleaseExpiredPrefetchedSlabMemory();
+
+        // Releases every prefetched slab memory, cancelling prefetches which did not complete
+        // instead of waiting on them. Returns the number of bytes released.
+        uint64_t CancelPrefetchedSlabMemory();
+
+        // Releases the memory of slabs which were empty for at-least |minEmptySeconds|, stopping
+        // once |bytesToRelease| bytes were released. Returns the number of bytes released.
+        uint64_t ReleaseEmptySlabMemory(double minEmptySeconds,
+                                        uint64_t bytesToRelease = kInvalidSize);
+
+        struct SlabPrefetch {
+            std::shared_ptr<MemoryAllocationEvent> Event;
+            double PrefetchTime = 0;
+        };
+
         std::vector<SlabCache> mCaches;
 
+        // Recycles the block of every sub-allocation. Guarded by mMutex.
+        ObjectPool<BlockInSlab> mBlockInSlabPool;
+
+        // Blocks de-allocated while mMutex was held by another thread, most recent first.
+        std::atomic<BlockInSlab*> mRemoteFreeList = {nullptr};
+
         const uint64_t mBlockSize;
         const uint64_t mMaxSlabSize;
         const uint64_t mSlabSize;
         const uint64_t mSlabAlignment;
         const double mSlabFragmentationLimit;
         const bool mPrefetchSlab;
+        const bool mAdaptSlabSize;
+        const uint64_t mMaxEmptySlabCount;
+
+        // Empty slabs which kept their memory, across every slab size.
+        uint64_t mEmptySlabCount = 0;
+        MemoryAllocatorCounters* const mReuseCounters;
+
+        // Minimum slab size of the next slab, when adapting the slab size.
+        uint64_t mAdaptedSlabSize = 0;
 
         MemoryAllocator* mMemoryAllocator = nullptr;
-        std::shared_ptr<MemoryAllocationEvent> mNextSlabAllocationEvent;
+
+        // Pending prefetches, oldest first.
+        std::deque<SlabPrefetch> mPrefetchedSlabs;
+        uint64_t mPrefetchDepth = 1;
+        double mLastSlabMemoryTime = -1;
+        std::unique_ptr<PlatformTime> mPrefetchTimer;
     };
 
     // SlabCacheAllocator slab-allocates |minBlockSize|-size aligned allocations from
     // fixed-sized slabs.
-    class SlabCacheAllocator : public MemoryAllocator {
+    //
+    // With |predictSlab|, the block size of each allocation is recorded by an
+    // AllocationPredictor and, should the block size predicted to come next need a new slab,
+    // its memory is prefetched. Predictions are counted by PredictedSizeHitCount and
+    // PredictedSizeMissCount.
+    class SlabCacheAllocator final : public MemoryAllocator {
       public:
         SlabCacheAllocator(uint64_t minBlockSize,
                            uint64_t maxSlabSize,
@@ -131,29 +258,39 @@ namespace gpgmm {
                            uint64_t slabAlignment,
                            double slabFragmentationLimit,
                            bool prefetchSlab,
-                           std::unique_ptr<MemoryAllocator> memoryAllocator);
+                           std::unique_ptr<MemoryAllocator> memoryAllocator,
+                           bool adaptSlabSize = false,
+                           uint64_t maxEmptySlabCount = 0,
+                           bool predictSlab = false);
 
         ~SlabCacheAllocator() override;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+        std::unique_ptr<MemoryAllocation> TryRelocateMemory(const MemoryAllocation& allocation,
+                                                            uint64_t alignment,
+                                                            double maxUsedPercent) override;
+
+        // Releases empty slabs before releasing memory from the memory allocator.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
 
         MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
 
         uint64_t GetMemorySize() const override;
 
         uint64_t GetSlabCacheSizeForTesting() const;
 
       private:
+        // Owns the slab allocator of a block size too large to have a size class, which is
+        // deleted with the entry once unused or evicted from the cache.
         class SlabAllocatorCacheEntry : public NonCopyable {
           public:
-            explicit SlabAllocatorCacheEntry(uint64_t blockSize) : mBlockSize(blockSize) {
-            }
+            explicit SlabAllocatorCacheEntry(uint64_t blockSize);
+            SlabAllocatorCacheEntry(SlabAllocatorCacheEntry&& other);
+            ~SlabAllocatorCacheEntry();
 
             size_t GetKey() const {
                 return mBlockSize;
@@ -165,14 +302,46 @@ namespace gpgmm {
             const uint64_t mBlockSize;
         };
 
+        // Slab allocator of a block size which is indexed directly by its size class, the block
+        // size in multiples of |mMinBlockSize|, instead of being looked up in the cache.
+        struct SlabAllocatorSizeClass {
+            SlabMemoryAllocator* pSlabAllocator = nullptr;
+            uint64_t UsedBlockCount = 0;
+            bool IsCached = false;
+        };
+
+        static constexpr uint64_t kSizeClassesPerTable = 256;
+        static constexpr uint64_t kSizeClassTableCount = 256;
+
+        // Most slab allocators kept cached for block sizes without a size class.
+        static constexpr size_t kMaxCachedSlabAllocatorCount = 64;
+
+        using SizeClassTable = std::array<SlabAllocatorSizeClass, kSizeClassesPerTable>;
+
+        // Returns nullptr when the block size is too large to be indexed.
+        SlabAllocatorSizeClass* GetOrCreateSizeClass(uint64_t blockSize);
+
+        SlabMemoryAllocator* CreateSlabAllocator(uint64_t blockSize);
+
         const uint64_t mMinBlockSize;
         const uint64_t mMaxSlabSize;
         const uint64_t mSlabSize;  // Optional size when non-zero.
         const uint64_t mSlabAlignment;
         const double mSlabFragmentationLimit;
         const bool mPrefetchSlab;
+        const bool mAdaptSlabSize;
+        const uint64_t mMaxEmptySlabCount;
 
         LinkedList<MemoryAllocator> mSlabAllocators;
+
+        // Learns which block size follows which, to prefetch a slab for the next allocation.
+        // Only created when |predictSlab| is true.
+        std::unique_ptr<AllocationPredictor> mPredictor;
+        uint64_t mPredictedBlockSize = kInvalidSize;
+
+        // Two-level table of size classes, where tables are only created once used. Block sizes
+        // beyond the last size class fallback to the cache.
+        std::array<std::unique_ptr<SizeClassTable>, kSizeClassTableCount> mSizeClassTables;
         MemoryCache<SlabAllocatorCacheEntry> mSizeCache;
     };
 
@@ -24,41 +24,34 @@ namespace gpgmm {
     }
 
     std::unique_ptr<MemoryAllocation> StandaloneMemoryAllocator::TryAllocateMemory(
-        uint64_t size,
-        uint64_t alignment,
-        bool neverAllocate,
-        bool cacheSize,
-        bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "StandaloneMemoryAllocator.TryAllocateMemory");
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "StandaloneMemoryAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
         std::unique_ptr<MemoryAllocation> allocation;
-        GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(size, alignment, neverAllocate,
-                                                            cacheSize, prefetchMemory),
-                         allocation);
+        GPGMM_TRY_ASSIGN(GetFirstChild()->TryAllocateMemory(request), allocation);
 
         mInfo.UsedBlockCount++;
-        mInfo.UsedBlockUsage += size;
+        mInfo.UsedBlockUsage += request.Size;
 
         return std::make_unique<MemoryAllocation>(this, allocation->GetMemory(), /*offset*/ 0,
                                                   allocation->GetMethod(),
-                                                  new MemoryBlock{0, size});
+                                                  mBlockPool.Acquire(MemoryBlock{0, request.Size}));
     }
 
     void StandaloneMemoryAllocator::DeallocateMemory(
         std::unique_ptr<MemoryAllocation> subAllocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "StandaloneMemoryAllocator.DeallocateMemory");
+        TRACE_EVENT0(TraceEventCategory::Allocation, "StandaloneMemoryAllocator.DeallocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
         mInfo.UsedBlockCount--;
         mInfo.UsedBlockUsage -= subAllocation->GetSize();
-        SafeDelete(subAllocation->GetBlock());
+        mBlockPool.Release(subAllocation->GetBlock());
         GetFirstChild()->DeallocateMemory(std::move(subAllocation));
     }
 
     MEMORY_ALLOCATOR_INFO StandaloneMemoryAllocator::QueryInfo() const {
-        std::lock_guard<std::mutex> lock(mMutex);
-        MEMORY_ALLOCATOR_INFO result = mInfo;
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
         result += GetFirstChild()->QueryInfo();
         return result;
     }
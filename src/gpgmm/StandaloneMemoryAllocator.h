@@ -16,6 +16,7 @@
 #define GPGMM_STANDALONEMEMORYALLOCATOR_H_
 
 #include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
 
 #include <memory>
 
@@ -27,14 +28,15 @@ namespace gpgmm {
         StandaloneMemoryAllocator(std::unique_ptr<MemoryAllocator> memoryAllocator);
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
 
         MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+      private:
+        // Guarded by mMutex.
+        ObjectPool<MemoryBlock> mBlockPool;
     };
 
 }  // namespace gpgmm
@@ -0,0 +1,357 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/TLSFBlockAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Error.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+
+#include <algorithm>
+
+namespace gpgmm {
+
+    TLSFBlockAllocator::TLSFBlockAllocator(uint64_t maxBlockSize,
+                                           uint64_t rootBlockSize,
+                                           uint64_t minBlockSize)
+        : mMaxBlockSize(maxBlockSize),
+          mRootBlockSize(rootBlockSize),
+          mMinBlockSize(minBlockSize),
+          mMinBlockSizeLog2(Log2(minBlockSize)) {
+        ASSERT(IsPowerOfTwo(mRootBlockSize));
+        ASSERT(IsPowerOfTwo(mMinBlockSize));
+        ASSERT(mMinBlockSize <= mRootBlockSize);
+        ASSERT(mRootBlockSize <= mMaxBlockSize);
+        ASSERT(mMaxBlockSize % mRootBlockSize == 0);
+    }
+
+    MemoryBlock* TLSFBlockAllocator::TryAllocateBlock(uint64_t size, uint64_t alignment) {
+        GPGMM_CHECK_NONZERO(size);
+
+        if (size > mRootBlockSize) {
+            DebugEvent("TLSFBlockAllocator.TryAllocateBlock", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "MemoryBlock size exceeded the root block size.";
+            return nullptr;
+        }
+
+        ASSERT(IsPowerOfTwo(alignment));
+
+        // Roots are aligned to their size but are not otherwise guaranteed to be aligned.
+        if (alignment > mRootBlockSize) {
+            DebugEvent("TLSFBlockAllocator.TryAllocateBlock",
+                       ALLOCATOR_MESSAGE_ID_ALIGNMENT_MISMATCH)
+                << "MemoryBlock alignment exceeded the root block size.";
+            return nullptr;
+        }
+
+        const uint64_t blockSize = AlignToPowerOfTwo(size, mMinBlockSize);
+
+        // Every block is aligned to the minimum block size so only a larger alignment could
+        // require skipping over the front of a free block. Should the first free block found not
+        // be aligned, search again for one large enough to be aligned, which is at-most an entire
+        // root since roots are always aligned.
+        uint64_t searchSize = blockSize;
+        if (alignment > mMinBlockSize) {
+            searchSize = std::min(searchSize + alignment - mMinBlockSize, mRootBlockSize);
+        }
+
+        TLSFBlock* block = FindFreeBlock(blockSize);
+        if (block != nullptr && AlignToPowerOfTwo(block->Offset, alignment) + blockSize >
+                                    block->Offset + block->Size) {
+            block = FindFreeBlock(searchSize);
+        }
+
+        if (block == nullptr) {
+            if (!TryAddRoot()) {
+                DebugEvent("TLSFBlockAllocator.TryAllocateBlock",
+                           ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                    << "Allocator has reached capacity";
+                return nullptr;
+            }
+            block = FindFreeBlock(searchSize);
+        }
+
+        ASSERT(block != nullptr);
+        RemoveFreeBlock(block);
+
+        // Return the unaligned front and unused back of the block to the free lists. Neither can
+        // be merged since a free block never has a free neighbor.
+        const uint64_t alignedOffset = AlignToPowerOfTwo(block->Offset, alignment);
+        if (alignedOffset != block->Offset) {
+            TLSFBlock* front = block;
+            block = SplitBlock(front, alignedOffset - front->Offset);
+            InsertFreeBlock(front);
+        }
+
+        ASSERT(block->Size >= blockSize);
+        if (block->Size > blockSize) {
+            InsertFreeBlock(SplitBlock(block, blockSize));
+        }
+
+        return block;
+    }
+
+    void TLSFBlockAllocator::DeallocateBlock(MemoryBlock* block) {
+        ASSERT(block != nullptr);
+
+        TLSFBlock* freeBlock = static_cast<TLSFBlock*>(block);
+        ASSERT(!freeBlock->IsFree);
+
+        if (freeBlock->pPrevPhysical != nullptr && freeBlock->pPrevPhysical->IsFree) {
+            TLSFBlock* prevBlock = freeBlock->pPrevPhysical;
+            RemoveFreeBlock(prevBlock);
+            freeBlock = MergeBlocks(prevBlock, freeBlock);
+        }
+
+        if (freeBlock->pNextPhysical != nullptr && freeBlock->pNextPhysical->IsFree) {
+            TLSFBlock* nextBlock = freeBlock->pNextPhysical;
+            RemoveFreeBlock(nextBlock);
+            freeBlock = MergeBlocks(freeBlock, nextBlock);
+        }
+
+        if (freeBlock->Size == mRootBlockSize) {
+            RemoveRoot(freeBlock);
+        } else {
+            InsertFreeBlock(freeBlock);
+        }
+    }
+
+    // Only the next block can be taken, since the offset must not move. Should the next block be
+    // free and large enough, whatever is left of it is returned to the free lists.
+    MemoryBlock* TLSFBlockAllocator::TryExtendBlock(MemoryBlock* block, uint64_t size) {
+        ASSERT(block != nullptr);
+
+        TLSFBlock* usedBlock = static_cast<TLSFBlock*>(block);
+        ASSERT(!usedBlock->IsFree);
+
+        if (size <= usedBlock->Size) {
+            return usedBlock;
+        }
+
+        if (size > mRootBlockSize) {
+            return nullptr;
+        }
+
+        const uint64_t blockSize = AlignToPowerOfTwo(size, mMinBlockSize);
+
+        TLSFBlock* nextBlock = usedBlock->pNextPhysical;
+        if (nextBlock == nullptr || !nextBlock->IsFree ||
+            usedBlock->Size + nextBlock->Size < blockSize) {
+            return nullptr;
+        }
+
+        RemoveFreeBlock(nextBlock);
+        MergeBlocks(usedBlock, nextBlock);
+
+        if (usedBlock->Size > blockSize) {
+            InsertFreeBlock(SplitBlock(usedBlock, blockSize));
+        }
+
+        return usedBlock;
+    }
+
+    // Sizes are indexed in units of the minimum block size, the same as the buckets of a
+    // LatencyHistogram: the highest bits, after the leading one, pick the linear range within the
+    // power-of-two range.
+    void TLSFBlockAllocator::GetFreeListIndex(uint64_t size,
+                                              uint32_t* firstLevel,
+                                              uint32_t* secondLevel) const {
+        const uint64_t count = size >> mMinBlockSizeLog2;
+        ASSERT(count != 0);
+        if (count < kSecondLevelCount) {
+            *firstLevel = 0;
+            *secondLevel = static_cast<uint32_t>(count);
+            return;
+        }
+
+        const uint32_t shift = Log2(count) - kSecondLevelBits;
+        *firstLevel = shift + 1;
+        *secondLevel = static_cast<uint32_t>(count >> shift) - kSecondLevelCount;
+    }
+
+    // Rounds up the size to the next size class so that any block in that list, or any list
+    // after it, is large enough. Unlike a best-fit search, no list needs to be walked.
+    TLSFBlockAllocator::TLSFBlock* TLSFBlockAllocator::FindFreeBlock(uint64_t size) const {
+        uint64_t searchSize = size;
+        const uint64_t count = size >> mMinBlockSizeLog2;
+        if (count >= kSecondLevelCount) {
+            searchSize += ((1ull << (Log2(count) - kSecondLevelBits)) - 1) << mMinBlockSizeLog2;
+        }
+
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        GetFreeListIndex(searchSize, &firstLevel, &secondLevel);
+
+        uint32_t secondLevelBitmap = mSecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        if (secondLevelBitmap == 0) {
+            const uint64_t firstLevelBitmap = mFirstLevelBitmap & (~0ull << (firstLevel + 1));
+            if (firstLevelBitmap == 0) {
+                return nullptr;
+            }
+
+            firstLevel = ScanForward(firstLevelBitmap);
+            secondLevelBitmap = mSecondLevelBitmaps[firstLevel];
+        }
+
+        secondLevel = ScanForward(secondLevelBitmap);
+        return mFreeLists[firstLevel][secondLevel];
+    }
+
+    void TLSFBlockAllocator::InsertFreeBlock(TLSFBlock* block) {
+        ASSERT(!block->IsFree);
+
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        GetFreeListIndex(block->Size, &firstLevel, &secondLevel);
+
+        TLSFBlock*& head = mFreeLists[firstLevel][secondLevel];
+        block->IsFree = true;
+        block->pPrevFree = nullptr;
+        block->pNextFree = head;
+        if (head != nullptr) {
+            head->pPrevFree = block;
+        }
+        head = block;
+
+        mSecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+        mFirstLevelBitmap |= 1ull << firstLevel;
+    }
+
+    void TLSFBlockAllocator::RemoveFreeBlock(TLSFBlock* block) {
+        ASSERT(block->IsFree);
+
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        GetFreeListIndex(block->Size, &firstLevel, &secondLevel);
+
+        if (block->pPrevFree != nullptr) {
+            block->pPrevFree->pNextFree = block->pNextFree;
+        } else {
+            ASSERT(mFreeLists[firstLevel][secondLevel] == block);
+            mFreeLists[firstLevel][secondLevel] = block->pNextFree;
+        }
+
+        if (block->pNextFree != nullptr) {
+            block->pNextFree->pPrevFree = block->pPrevFree;
+        }
+
+        block->IsFree = false;
+        block->pPrevFree = nullptr;
+        block->pNextFree = nullptr;
+
+        if (mFreeLists[firstLevel][secondLevel] == nullptr) {
+            mSecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (mSecondLevelBitmaps[firstLevel] == 0) {
+                mFirstLevelBitmap &= ~(1ull << firstLevel);
+            }
+        }
+    }
+
+    // Shrinks |block| to |size| and returns the block which follows it, made from the rest.
+    TLSFBlockAllocator::TLSFBlock* TLSFBlockAllocator::SplitBlock(TLSFBlock* block, uint64_t size) {
+        ASSERT(size < block->Size);
+
+        TLSFBlock* backBlock = mBlockPool.Acquire();
+        backBlock->Offset = block->Offset + size;
+        backBlock->Size = block->Size - size;
+        backBlock->pPrevPhysical = block;
+        backBlock->pNextPhysical = block->pNextPhysical;
+        if (backBlock->pNextPhysical != nullptr) {
+            backBlock->pNextPhysical->pPrevPhysical = backBlock;
+        }
+
+        block->Size = size;
+        block->pNextPhysical = backBlock;
+        return backBlock;
+    }
+
+    // Grows |front| to include |back|, which is then deleted.
+    TLSFBlockAllocator::TLSFBlock* TLSFBlockAllocator::MergeBlocks(TLSFBlock* front,
+                                                                   TLSFBlock* back) {
+        ASSERT(front->pNextPhysical == back);
+
+        front->Size += back->Size;
+        front->pNextPhysical = back->pNextPhysical;
+        if (front->pNextPhysical != nullptr) {
+            front->pNextPhysical->pPrevPhysical = front;
+        }
+
+        mBlockPool.Release(back);
+        return front;
+    }
+
+    bool TLSFBlockAllocator::TryAddRoot() {
+        uint64_t rootIndex = 0;
+        if (!mRemovedRootIndices.empty()) {
+            rootIndex = mRemovedRootIndices.top();
+            mRemovedRootIndices.pop();
+        } else if (mRootCount < mMaxBlockSize / mRootBlockSize) {
+            rootIndex = mRootCount++;
+        } else {
+            return false;
+        }
+
+        TLSFBlock* root = mBlockPool.Acquire();
+        root->Offset = rootIndex * mRootBlockSize;
+        root->Size = mRootBlockSize;
+        InsertFreeBlock(root);
+        return true;
+    }
+
+    void TLSFBlockAllocator::RemoveRoot(TLSFBlock* block) {
+        ASSERT(block->Size == mRootBlockSize);
+        ASSERT(block->pPrevPhysical == nullptr && block->pNextPhysical == nullptr);
+
+        mRemovedRootIndices.push(block->Offset / mRootBlockSize);
+        mBlockPool.Release(block);
+    }
+
+    uint64_t TLSFBlockAllocator::GetLargestFreeBlockSize() const {
+        if (mFirstLevelBitmap == 0) {
+            return 0;
+        }
+
+        // The largest free block is in the highest non-empty free list, but sizes only
+        // partially determine the list, so every block in it must be visited.
+        const uint32_t firstLevel = Log2(mFirstLevelBitmap);
+        const uint32_t secondLevelBitmap = mSecondLevelBitmaps[firstLevel];
+        ASSERT(secondLevelBitmap != 0);
+        const uint32_t secondLevel = Log2(secondLevelBitmap);
+
+        uint64_t largestBlockSize = 0;
+        for (const TLSFBlock* block = mFreeLists[firstLevel][secondLevel]; block != nullptr;
+             block = block->pNextFree) {
+            largestBlockSize = std::max(largestBlockSize, block->Size);
+        }
+        return largestBlockSize;
+    }
+
+    uint64_t TLSFBlockAllocator::ComputeTotalNumOfFreeBlocksForTesting() const {
+        uint64_t count = 0;
+        for (const auto& secondLevelLists : mFreeLists) {
+            for (const TLSFBlock* block : secondLevelLists) {
+                for (; block != nullptr; block = block->pNextFree) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    uint64_t TLSFBlockAllocator::GetRootCountForTesting() const {
+        return mRootCount - mRemovedRootIndices.size();
+    }
+
+}  // namespace gpgmm
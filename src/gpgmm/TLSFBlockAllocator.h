@@ -0,0 +1,105 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_TLSFBLOCKALLOCATOR_H_
+#define GPGMM_TLSFBLOCKALLOCATOR_H_
+
+#include "gpgmm/BlockAllocator.h"
+#include "gpgmm/common/ObjectPool.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace gpgmm {
+
+    // TLSFBlockAllocator uses the two-level segregated fit (TLSF) technique to satisfy an
+    // allocation request. Free blocks are kept in lists by size class, where every power-of-two
+    // range (first level) is split into the same number of linear ranges (second level). A bitmap
+    // per level records which lists have a free block, so finding a large enough free block and
+    // freeing a block (which merges it with any free neighbor) are both O(1).
+    //
+    // Unlike the buddy allocators, blocks are only rounded up to |minBlockSize|, not to a
+    // power-of-two, so less memory is wasted by sizes which are not a power-of-two.
+    //
+    // The system of size |maxBlockSize| is partitioned into root blocks of |rootBlockSize| which
+    // blocks never cross. Roots are only added once no free block is large enough and removed as
+    // soon as they are entirely free again.
+    class TLSFBlockAllocator final : public BlockAllocator {
+      public:
+        TLSFBlockAllocator(uint64_t maxBlockSize, uint64_t rootBlockSize, uint64_t minBlockSize);
+        ~TLSFBlockAllocator() override = default;
+
+        // BlockAllocator interface
+        MemoryBlock* TryAllocateBlock(uint64_t size, uint64_t alignment) override;
+        void DeallocateBlock(MemoryBlock* block) override;
+        MemoryBlock* TryExtendBlock(MemoryBlock* block, uint64_t size) override;
+        uint64_t GetLargestFreeBlockSize() const override;
+
+        // Only counts free blocks in roots which contain an allocation.
+        uint64_t ComputeTotalNumOfFreeBlocksForTesting() const;
+        uint64_t GetRootCountForTesting() const;
+
+      private:
+        struct TLSFBlock : public MemoryBlock {
+            // Adjacent blocks within the same root.
+            TLSFBlock* pPrevPhysical = nullptr;
+            TLSFBlock* pNextPhysical = nullptr;
+
+            // Neighbors within the same free list, when free.
+            TLSFBlock* pPrevFree = nullptr;
+            TLSFBlock* pNextFree = nullptr;
+
+            bool IsFree = false;
+        };
+
+        // Linear ranges per power-of-two range. Sizes below this many minimum sized blocks are
+        // kept exactly.
+        constexpr static uint32_t kSecondLevelBits = 4;
+        constexpr static uint32_t kSecondLevelCount = 1u << kSecondLevelBits;
+        constexpr static uint32_t kFirstLevelCount = 64 - kSecondLevelBits + 1;
+
+        void GetFreeListIndex(uint64_t size, uint32_t* firstLevel, uint32_t* secondLevel) const;
+        TLSFBlock* FindFreeBlock(uint64_t size) const;
+        void InsertFreeBlock(TLSFBlock* block);
+        void RemoveFreeBlock(TLSFBlock* block);
+
+        TLSFBlock* SplitBlock(TLSFBlock* block, uint64_t size);
+        TLSFBlock* MergeBlocks(TLSFBlock* front, TLSFBlock* back);
+
+        bool TryAddRoot();
+        void RemoveRoot(TLSFBlock* block);
+
+        const uint64_t mMaxBlockSize;
+        const uint64_t mRootBlockSize;
+        const uint64_t mMinBlockSize;
+        const uint32_t mMinBlockSizeLog2;
+
+        uint64_t mFirstLevelBitmap = 0;
+        std::array<uint32_t, kFirstLevelCount> mSecondLevelBitmaps = {};
+        std::array<std::array<TLSFBlock*, kSecondLevelCount>, kFirstLevelCount> mFreeLists = {};
+
+        // Number of roots ever added. Roots which were removed are re-added lowest offset first.
+        uint64_t mRootCount = 0;
+        std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>
+            mRemovedRootIndices;
+
+        ObjectPool<TLSFBlock> mBlockPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_TLSFBLOCKALLOCATOR_H_
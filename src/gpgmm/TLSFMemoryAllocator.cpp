@@ -0,0 +1,190 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/TLSFMemoryAllocator.h"
+
+#include "gpgmm/Debug.h"
+#include "gpgmm/Memory.h"
+#include "gpgmm/common/Math.h"
+
+namespace gpgmm {
+
+    TLSFMemoryAllocator::TLSFMemoryAllocator(uint64_t systemSize,
+                                             uint64_t memorySize,
+                                             uint64_t memoryAlignment,
+                                             std::unique_ptr<MemoryAllocator> memoryAllocator,
+                                             uint64_t minBlockSize)
+        : MemoryAllocator(std::move(memoryAllocator)),
+          mMemorySize(memorySize),
+          mMemoryAlignment(memoryAlignment),
+          mTLSFBlockAllocator(systemSize, mMemorySize, minBlockSize),
+          mUsedPool(mMemorySize) {
+        ASSERT(mMemorySize <= systemSize);
+        ASSERT(IsPowerOfTwo(mMemorySize));
+        ASSERT(IsPowerOfTwo(minBlockSize));
+    }
+
+    uint64_t TLSFMemoryAllocator::GetMemoryIndex(uint64_t offset) const {
+        ASSERT(offset != kInvalidOffset);
+        return offset / mMemorySize;
+    }
+
+    std::unique_ptr<MemoryAllocation> TLSFMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        GPGMM_CHECK_NONZERO(request.Size);
+        TRACE_EVENT0(TraceEventCategory::Allocation, "TLSFMemoryAllocator.TryAllocateMemory");
+
+        if (request.Size > mMemorySize) {
+            DebugEvent("TLSFMemoryAllocator.TryAllocateMemory", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Allocation size exceeded the memory size (" << request.Size << " vs "
+                << mMemorySize << " bytes).";
+            return {};
+        }
+
+        // Attempt to sub-allocate a block of the requested size.
+        MemoryBlock* block = nullptr;
+        GPGMM_TRY_ASSIGN(mTLSFBlockAllocator.TryAllocateBlock(request.Size, request.Alignment),
+                         block);
+
+        const uint64_t memoryIndex = GetMemoryIndex(block->Offset);
+        std::unique_ptr<MemoryAllocation> memoryAllocation = mUsedPool.AcquireFromPool(memoryIndex);
+
+        // No existing, allocate new memory for the block.
+        if (memoryAllocation == nullptr) {
+            MEMORY_ALLOCATION_REQUEST memoryRequest = request;
+            memoryRequest.Size = mMemorySize;
+            memoryRequest.Alignment = mMemoryAlignment;
+            memoryAllocation = GetFirstChild()->TryAllocateMemory(memoryRequest);
+            if (memoryAllocation == nullptr) {
+                mTLSFBlockAllocator.DeallocateBlock(block);
+                return {};
+            }
+        }
+
+        MemoryBase* memory = memoryAllocation->GetMemory();
+        ASSERT(memory != nullptr);
+        memory->Ref();
+
+        mUsedPool.ReturnToPool(std::move(memoryAllocation), memoryIndex);
+
+        mInfo.UsedBlockCount++;
+        mInfo.UsedBlockUsage += block->Size;
+
+        // Blocks are rounded-up to the minimum block size, which is wasted.
+        block->RequestedSize = request.Size;
+        mRequestedBlockUsage += request.Size;
+
+        // Memory allocation offset is always memory-relative.
+        const uint64_t memoryOffset = block->Offset % mMemorySize;
+
+        return std::make_unique<MemoryAllocation>(/*allocator*/ this, memory, memoryOffset,
+                                                  AllocationMethod::kSubAllocated, block);
+    }
+
+    void TLSFMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "TLSFMemoryAllocator.DeallocateMemory");
+
+        ASSERT(subAllocation != nullptr);
+
+        mInfo.UsedBlockCount--;
+        mInfo.UsedBlockUsage -= subAllocation->GetSize();
+        mRequestedBlockUsage -= subAllocation->GetBlock()->RequestedSize;
+
+        const uint64_t memoryIndex = GetMemoryIndex(subAllocation->GetBlock()->Offset);
+
+        mTLSFBlockAllocator.DeallocateBlock(subAllocation->GetBlock());
+
+        std::unique_ptr<MemoryAllocation> memoryAllocation = mUsedPool.AcquireFromPool(memoryIndex);
+
+        MemoryBase* memory = memoryAllocation->GetMemory();
+        ASSERT(memory != nullptr);
+
+        if (memory->Unref()) {
+            GetFirstChild()->DeallocateMemory(std::move(memoryAllocation));
+        } else {
+            mUsedPool.ReturnToPool(std::move(memoryAllocation), memoryIndex);
+        }
+    }
+
+    bool TLSFMemoryAllocator::TryExtendMemory(MemoryAllocation* subAllocation, uint64_t size) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "TLSFMemoryAllocator.TryExtendMemory");
+
+        ASSERT(subAllocation != nullptr);
+
+        // Roots are the size of the memory, so the block never grows into other memory.
+        MemoryBlock* block = subAllocation->GetBlock();
+        const uint64_t blockSize = block->Size;
+        if (mTLSFBlockAllocator.TryExtendBlock(block, size) == nullptr) {
+            return false;
+        }
+
+        mInfo.UsedBlockUsage += block->Size - blockSize;
+
+        if (size > block->RequestedSize) {
+            mRequestedBlockUsage += size - block->RequestedSize;
+            block->RequestedSize = size;
+        }
+
+        return true;
+    }
+
+    uint64_t TLSFMemoryAllocator::GetMemorySize() const {
+        return mMemorySize;
+    }
+
+    uint64_t TLSFMemoryAllocator::GetMemoryAlignment() const {
+        return mMemoryAlignment;
+    }
+
+    MEMORY_ALLOCATOR_INFO TLSFMemoryAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = mInfo.Load();
+        const MEMORY_ALLOCATOR_INFO& memoryInfo = GetFirstChild()->QueryInfo();
+        result.UsedMemoryCount = memoryInfo.UsedMemoryCount;
+        result.UsedMemoryUsage = memoryInfo.UsedMemoryUsage;
+        result.FreeMemoryUsage = memoryInfo.FreeMemoryUsage;
+        result.EvictedMemoryReuseCount += memoryInfo.EvictedMemoryReuseCount;
+        result.RetainedMemoryReuseCount += memoryInfo.RetainedMemoryReuseCount;
+        result.PrefetchedMemoryReuseCount += memoryInfo.PrefetchedMemoryReuseCount;
+        result.PrefetchedMemoryWaitCount += memoryInfo.PrefetchedMemoryWaitCount;
+        result.PooledMemoryHitCount += memoryInfo.PooledMemoryHitCount;
+        result.PooledMemoryMissCount += memoryInfo.PooledMemoryMissCount;
+        result.BestFitWastedUsage += memoryInfo.BestFitWastedUsage;
+        return result;
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO TLSFMemoryAllocator::QueryFragmentationInfo() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Roots are removed once entirely free, so free blocks are always within used memory.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        result.FreeBlockUsage = mUsedPool.GetPoolSize() * mMemorySize - mInfo.UsedBlockUsage.Load();
+        result.LargestFreeBlockSize = mTLSFBlockAllocator.GetLargestFreeBlockSize();
+        result.InternalFragmentationUsage =
+            mInfo.UsedBlockUsage.Load() - mRequestedBlockUsage.Load();
+        return result;
+    }
+
+    uint64_t TLSFMemoryAllocator::GetTLSFMemorySizeForTesting() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return mUsedPool.GetPoolSize();
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,75 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_TLSFMEMORYALLOCATOR_H_
+#define GPGMM_TLSFMEMORYALLOCATOR_H_
+
+#include "gpgmm/IndexedMemoryPool.h"
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/TLSFBlockAllocator.h"
+
+#include <memory>
+
+namespace gpgmm {
+
+    // TLSFMemoryAllocator uses the TLSF allocator to sub-allocate blocks of device memory created
+    // by MemoryAllocator clients. It can be used in place of a BuddyMemoryAllocator: the system
+    // is partitioned the same way, where each memory is a root in the TLSF system, but blocks are
+    // sized to fit instead of rounded up to a power-of-two.
+    //
+    // Upon sub-allocating, the offset gets mapped to device memory by computing the corresponding
+    // memory index and should the memory not exist, it is created. If two sub-allocations share the
+    // same memory index, the memory refcount is incremented to ensure de-allocating one doesn't
+    // release the other prematurely.
+    //
+    // The MemoryAllocator should return ResourceHeaps that are all compatible with each other.
+    // It should also outlive all the resources that are in the TLSF allocator.
+    //
+    // Blocks are never smaller than, and always aligned to, |minBlockSize|.
+    class TLSFMemoryAllocator final : public MemoryAllocator {
+      public:
+        TLSFMemoryAllocator(uint64_t systemSize,
+                            uint64_t memorySize,
+                            uint64_t memoryAlignment,
+                            std::unique_ptr<MemoryAllocator> memoryAllocator,
+                            uint64_t minBlockSize = 1);
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> subAllocation) override;
+        bool TryExtendMemory(MemoryAllocation* subAllocation, uint64_t size) override;
+
+        uint64_t GetMemorySize() const override;
+        uint64_t GetMemoryAlignment() const override;
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
+
+        uint64_t GetTLSFMemorySizeForTesting() const;
+
+      private:
+        uint64_t GetMemoryIndex(uint64_t offset) const;
+
+        const uint64_t mMemorySize;
+        const uint64_t mMemoryAlignment;
+
+        TLSFBlockAllocator mTLSFBlockAllocator;
+
+        // Set of fixed memory allocations containing at-least one sub-allocation.
+        IndexedMemoryPool mUsedPool;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_TLSFMEMORYALLOCATOR_H_
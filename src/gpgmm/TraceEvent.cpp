@@ -16,27 +16,76 @@
 
 #include "gpgmm/EventTraceWriter.h"
 
+#if defined(GPGMM_ENABLE_ETW)
+#    include "gpgmm/ETWEventTrace.h"
+#endif
+
+#include <mutex>
 #include <string>
 
 namespace gpgmm {
 
     static std::unique_ptr<EventTraceWriter> gEventTrace;
 
+    std::atomic<uint32_t> gEnabledTraceEventCategories{0};
+
+    // Categories recorded to the trace file.
+    static std::atomic<uint32_t> gEventTraceCategories{0};
+
+    static uint32_t GetETWCategories() {
+#if defined(GPGMM_ENABLE_ETW)
+        return GetETWTraceEventCategories();
+#else
+        return 0;
+#endif
+    }
+
     void StartupEventTrace(const std::string& traceFile,
                            bool skipDurationEvents,
                            bool skipObjectEvents,
-                           bool skipInstantEvents) {
+                           bool skipInstantEvents,
+                           bool useBinaryFormat,
+                           double flightRecorderDurationInSeconds,
+                           uint32_t categoryMask) {
         if (gEventTrace == nullptr) {
             gEventTrace = std::make_unique<EventTraceWriter>();
         }
 
+        SetEnabledTraceEventCategories(categoryMask);
+
         InitializeThreadName("GPGMM_MainThread");
 
 #if !defined(GPGMM_ENABLE_RECORDING_UNTIL_TERMINATION)
         gEventTrace->FlushQueuedEventsToDisk();
 #endif
         gEventTrace->SetConfiguration(traceFile, skipDurationEvents, skipObjectEvents,
-                                      skipInstantEvents);
+                                      skipInstantEvents, useBinaryFormat,
+                                      flightRecorderDurationInSeconds);
+    }
+
+    void SetEnabledTraceEventCategories(uint32_t categoryMask) {
+        if (gEventTrace == nullptr) {
+            return;
+        }
+        gEventTraceCategories.store(
+            categoryMask | GetTraceEventCategoryMask(TraceEventCategory::Metadata),
+            std::memory_order_relaxed);
+        UpdateEnabledTraceEventCategories();
+    }
+
+    void UpdateEnabledTraceEventCategories() {
+        // Serialized so a stale mask of one backend never overwrites the update of the other.
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        gEnabledTraceEventCategories.store(
+            gEventTraceCategories.load(std::memory_order_relaxed) | GetETWCategories(),
+            std::memory_order_relaxed);
+    }
+
+    void DumpEventTraceToDisk() {
+        if (gEventTrace != nullptr) {
+            gEventTrace->DumpFlightRecordingToDisk();
+        }
     }
 
     void InitializeThreadName(const char* name) {
@@ -54,7 +103,7 @@ namespace gpgmm {
                            const char* name,
                            uint64_t id,
                            uint32_t tid,
-                           double timestamp,
+                           uint64_t timestampInMicroseconds,
                            uint32_t flags,
                            const JSONDict& args)
         : mPhase(phase),
@@ -62,9 +111,27 @@ namespace gpgmm {
           mName(name),
           mID(id),
           mTID(tid),
-          mTimestamp(timestamp),
+          mTimestampInMicroseconds(timestampInMicroseconds),
+          mFlags(flags),
+          mArgs((args.IsEmpty()) ? std::string() : args.ToString()) {
+    }
+
+    TraceEvent::TraceEvent(char phase,
+                           TraceEventCategory category,
+                           const char* name,
+                           uint64_t id,
+                           uint32_t tid,
+                           uint64_t timestampInMicroseconds,
+                           uint32_t flags,
+                           const TraceEventDeferredArgs& deferredArgs)
+        : mPhase(phase),
+          mCategory(category),
+          mName(name),
+          mID(id),
+          mTID(tid),
+          mTimestampInMicroseconds(timestampInMicroseconds),
           mFlags(flags),
-          mArgs(args) {
+          mDeferredArgs(deferredArgs) {
     }
 
     void TraceBuffer::AddTraceEvent(char phase,
@@ -73,8 +140,41 @@ namespace gpgmm {
                                     uint64_t id,
                                     uint32_t flags,
                                     const JSONDict& args) {
-        if (gEventTrace != nullptr) {
+        const uint32_t categoryMask = GetTraceEventCategoryMask(category);
+        if (gEventTrace != nullptr &&
+            (gEventTraceCategories.load(std::memory_order_relaxed) & categoryMask)) {
             gEventTrace->EnqueueTraceEvent(phase, category, name, id, flags, args);
         }
+#if defined(GPGMM_ENABLE_ETW)
+        if (GetETWTraceEventCategories() & categoryMask) {
+            WriteETWTraceEvent(phase, category, name, id,
+                               (args.IsEmpty()) ? std::string() : args.ToString());
+        }
+#endif
+    }
+
+    void TraceBuffer::AddDeferredTraceEvent(char phase,
+                                            TraceEventCategory category,
+                                            const char* name,
+                                            uint64_t id,
+                                            uint32_t flags,
+                                            const TraceEventDeferredArgs& deferredArgs) {
+        const uint32_t categoryMask = GetTraceEventCategoryMask(category);
+        if (gEventTrace != nullptr &&
+            (gEventTraceCategories.load(std::memory_order_relaxed) & categoryMask)) {
+            gEventTrace->EnqueueTraceEvent(phase, category, name, id, flags, deferredArgs);
+        }
+#if defined(GPGMM_ENABLE_ETW)
+        // ETW events are written right away, so the args are serialized on the recording thread.
+        if (GetETWTraceEventCategories() & categoryMask) {
+            JSONWriter argsWriter;
+            if (!deferredArgs.IsEmpty()) {
+                argsWriter.BeginDict();
+                deferredArgs.Serialize(&argsWriter);
+                argsWriter.EndDict();
+            }
+            WriteETWTraceEvent(phase, category, name, id, argsWriter.ToString());
+        }
+#endif
     }
 }  // namespace gpgmm
@@ -16,10 +16,16 @@
 #define GPGMM_TRACEEVENT_H_
 
 #include "gpgmm/common/JSONEncoder.h"
+#include "include/gpgmm_export.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <thread>
+#include <type_traits>
 
 // Trace Event Format
 // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/edit?pli=1
@@ -48,7 +54,9 @@
 #define TRACE_EVENT0(category_group, name) TRACE_EMPTY
 #define TRACE_EVENT_INSTANT0(category_group, name, scope, args) TRACE_EMPTY
 #define TRACE_COUNTER1(category_group, name, value) TRACE_EMPTY
+#define TRACE_COUNTER(category_group, name, args) TRACE_EMPTY
 #define TRACE_EVENT_METADATA1(name, args) TRACE_EMPTY
+#define TRACE_EVENT_INSTANT_DEFERRED1(category_group, name, deferredArgs) TRACE_EMPTY
 
 #else // !GPGMM_DISABLE_TRACING
 
@@ -67,9 +75,24 @@ const uint64_t kNoId = 0;
     INTERNAL_TRACE_EVENT_ADD(TRACE_EVENT_PHASE_COUNTER, category_group, name, "value", \
                              static_cast<int>(value))
 
+// Same as TRACE_COUNTER1 but with a value per series, each named by an item of |args|.
+#define TRACE_COUNTER(category_group, name, args) \
+    INTERNAL_TRACE_EVENT_ADD(TRACE_EVENT_PHASE_COUNTER, category_group, name, args)
+
 #define TRACE_EVENT_INSTANT1(category_group, name, args) \
     INTERNAL_TRACE_EVENT_ADD(TRACE_EVENT_PHASE_INSTANT, category_group, name, args)
 
+// Same as TRACE_EVENT_INSTANT1 but |deferredArgs| is a TraceEventDeferredArgs, which is only
+// serialized once the event is written.
+#define TRACE_EVENT_INSTANT_DEFERRED1(category_group, name, deferredArgs)                   \
+    do {                                                                                    \
+        if (gpgmm::IsTraceEventCategoryEnabled(category_group)) {                           \
+            gpgmm::TraceBuffer::AddDeferredTraceEvent(TRACE_EVENT_PHASE_INSTANT,            \
+                                                      category_group, name, kNoId,          \
+                                                      TRACE_EVENT_FLAG_NONE, deferredArgs); \
+        }                                                                                   \
+    } while (false)
+
 #define TRACE_EVENT_BEGIN(category_group, name) \
     INTERNAL_TRACE_EVENT_ADD(TRACE_EVENT_PHASE_BEGIN, category_group, name, {})
 
@@ -99,34 +122,85 @@ const uint64_t kNoId = 0;
     } scopedTraceEvent {                                      \
     }
 
-#define INTERNAL_TRACE_EVENT_ADD_WITH_ID(phase, category_group, name, id, ...)           \
-    do {                                                                                 \
-        gpgmm::TraceBuffer::AddTraceEvent(phase, category_group, name,                   \
-                                          gpgmm::TraceEventID(id).GetID(), __VA_ARGS__); \
+// Events of a disabled category skip evaluating their args. Compiled out categories are never
+// enabled, so the whole event is removed.
+#define INTERNAL_TRACE_EVENT_ADD_WITH_ID(phase, category_group, name, id, ...)               \
+    do {                                                                                     \
+        if (gpgmm::IsTraceEventCategoryEnabled(category_group)) {                            \
+            gpgmm::TraceBuffer::AddTraceEvent(phase, category_group, name,                   \
+                                              gpgmm::TraceEventID(id).GetID(), __VA_ARGS__); \
+        }                                                                                    \
     } while (false)
 
-#define INTERNAL_TRACE_EVENT_ADD(phase, category_group, name, ...)             \
-    do {                                                                       \
-        gpgmm::TraceBuffer::AddTraceEvent(phase, category_group, name, kNoId,  \
-                                          TRACE_EVENT_FLAG_NONE, __VA_ARGS__); \
+#define INTERNAL_TRACE_EVENT_ADD(phase, category_group, name, ...)                 \
+    do {                                                                           \
+        if (gpgmm::IsTraceEventCategoryEnabled(category_group)) {                  \
+            gpgmm::TraceBuffer::AddTraceEvent(phase, category_group, name, kNoId,  \
+                                              TRACE_EVENT_FLAG_NONE, __VA_ARGS__); \
+        }                                                                          \
     } while (false)
 
 #endif
 
 namespace gpgmm {
 
-    enum TraceEventCategory {
+    // Categories are recorded as a single byte and used as bit indices of a category mask.
+    enum class TraceEventCategory {
         Default = 0,
         Metadata = 1,
+        Allocation = 2,
+        Residency = 3,
+        Slab = 4,
+        Buddy = 5,
+        Pool = 6,
+        ThreadPool = 7,
     };
 
+    constexpr static uint32_t kTraceEventCategoryCount = 8;
+    constexpr static uint32_t kAllTraceEventCategories = (1u << kTraceEventCategoryCount) - 1;
+
+    // Categories which are compiled in. Defaults to all.
+#if defined(GPGMM_TRACE_CATEGORY_MASK)
+    constexpr static uint32_t kCompiledTraceEventCategories = GPGMM_TRACE_CATEGORY_MASK;
+#else
+    constexpr static uint32_t kCompiledTraceEventCategories = kAllTraceEventCategories;
+#endif
+
+    // Categories which are recorded, by the trace file or an ETW session. Zero unless tracing was
+    // started or a session listens.
+    extern std::atomic<uint32_t> gEnabledTraceEventCategories;
+
+    constexpr uint32_t GetTraceEventCategoryMask(TraceEventCategory category) {
+        return 1u << static_cast<uint32_t>(category);
+    }
+
+    inline bool IsTraceEventCategoryEnabled(TraceEventCategory category) {
+        return (kCompiledTraceEventCategories & GetTraceEventCategoryMask(category)) &&
+               (gEnabledTraceEventCategories.load(std::memory_order_relaxed) &
+                GetTraceEventCategoryMask(category));
+    }
+
     class EventTraceWriter;
     class PlatformTime;
 
     void StartupEventTrace(const std::string& traceFile,
                            bool skipDurationEvents,
                            bool skipObjectEvents,
-                           bool skipInstantEvents);
+                           bool skipInstantEvents,
+                           bool useBinaryFormat = false,
+                           double flightRecorderDurationInSeconds = 0,
+                           uint32_t categoryMask = kAllTraceEventCategories);
+
+    // Changes which categories are recorded, once tracing was started. Metadata is always
+    // recorded.
+    GPGMM_EXPORT void SetEnabledTraceEventCategories(uint32_t categoryMask);
+
+    // Recomputes the categories which are recorded, once those of a trace backend changed.
+    void UpdateEnabledTraceEventCategories();
+
+    // Writes the last recorded events to the trace file when flight recording. Call once the
+    // problem to capture happened, ex. a frame-time spike.
+    GPGMM_EXPORT void DumpEventTraceToDisk();
 
     bool IsEventTraceEnabled();
 
@@ -152,6 +226,47 @@ namespace gpgmm {
         uint64_t mID;
     };
 
+    // Args copied as-is when the event is recorded and only serialized, by the thread writing
+    // the trace, once the event is written. Recording them is then a copy of plain data, instead
+    // of encoding JSON on the recording thread.
+    class TraceEventDeferredArgs {
+      public:
+        // Largest args which can be deferred. Kept small since every recorded event holds them.
+        constexpr static size_t kMaxSize = 128;
+
+        TraceEventDeferredArgs() = default;
+
+        // |SerializeFn| writes the members of the args into the dict open in the writer.
+        template <typename ArgsT, void (*SerializeFn)(JSONWriter*, const ArgsT&)>
+        static TraceEventDeferredArgs Create(const ArgsT& args) {
+            static_assert(std::is_trivially_copyable<ArgsT>::value,
+                          "Deferred args must be copied as-is.");
+            static_assert(sizeof(ArgsT) <= kMaxSize, "Deferred args are too large.");
+            static_assert(alignof(ArgsT) <= alignof(std::max_align_t),
+                          "Deferred args are over-aligned.");
+
+            TraceEventDeferredArgs deferredArgs;
+            std::memcpy(deferredArgs.mStorage, &args, sizeof(ArgsT));
+            deferredArgs.mSerializeFn = [](JSONWriter* writer, const void* storage) {
+                SerializeFn(writer, *static_cast<const ArgsT*>(storage));
+            };
+            return deferredArgs;
+        }
+
+        bool IsEmpty() const {
+            return mSerializeFn == nullptr;
+        }
+
+        // Writes the args into the dict open in |writer|.
+        void Serialize(JSONWriter* writer) const {
+            mSerializeFn(writer, mStorage);
+        }
+
+      private:
+        void (*mSerializeFn)(JSONWriter* writer, const void* storage) = nullptr;
+        alignas(std::max_align_t) unsigned char mStorage[kMaxSize];
+    };
+
     class TraceEvent {
       public:
         TraceEvent(char phase,
@@ -159,10 +274,19 @@ namespace gpgmm {
                    const char* name,
                    uint64_t id,
                    uint32_t tid,
-                   double timestamp,
+                   uint64_t timestampInMicroseconds,
                    uint32_t flags,
                    const JSONDict& args);
 
+        TraceEvent(char phase,
+                   TraceEventCategory category,
+                   const char* name,
+                   uint64_t id,
+                   uint32_t tid,
+                   uint64_t timestampInMicroseconds,
+                   uint32_t flags,
+                   const TraceEventDeferredArgs& deferredArgs);
+
       private:
         friend EventTraceWriter;
 
@@ -171,9 +295,15 @@ namespace gpgmm {
         const char* mName = nullptr;
         uint64_t mID = 0;
         uint32_t mTID = 0;
-        double mTimestamp = 0;
+        uint64_t mTimestampInMicroseconds = 0;
         uint32_t mFlags = 0;
-        JSONDict mArgs;
+
+        // Encoded once when the event is added, or empty if there are no args, so queued events
+        // do not each hold a string stream.
+        std::string mArgs;
+
+        // Encoded into mArgs once the event is drained.
+        TraceEventDeferredArgs mDeferredArgs;
     };
 
     class TraceBuffer {
@@ -185,6 +315,13 @@ namespace gpgmm {
                                   uint32_t flags,
                                   const JSONDict& args = {});
 
+        static void AddDeferredTraceEvent(char phase,
+                                          TraceEventCategory category,
+                                          const char* name,
+                                          uint64_t id,
+                                          uint32_t flags,
+                                          const TraceEventDeferredArgs& deferredArgs);
+
         template <class Arg1T>
         static void AddTraceEvent(char phase,
                                   TraceEventCategory category,
@@ -15,83 +15,276 @@
 #include "gpgmm/WorkerThread.h"
 
 #include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Log.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <deque>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace gpgmm {
 
     static const char* kWorkerThreadName = "GPGMM_ThreadPoolBackgroundWorker";
 
+    // Number of times Wait checks the event before blocking, since short tasks often complete
+    // sooner than the waiting thread could be woken up.
+    static constexpr uint32_t kEventSpinCount = 64u;
+
+    namespace {
+
+        std::mutex gWorkerThreadDescMutex;
+        WORKER_THREAD_DESC gWorkerThreadDesc = {};
+
+        WORKER_THREAD_DESC GetWorkerThreadDesc() {
+            std::lock_guard<std::mutex> lock(gWorkerThreadDescMutex);
+            return gWorkerThreadDesc;
+        }
+
+    }  // namespace
+
+    void SetWorkerThreadDesc(const WORKER_THREAD_DESC& desc) {
+        std::lock_guard<std::mutex> lock(gWorkerThreadDescMutex);
+        gWorkerThreadDesc = desc;
+    }
+
     class AsyncEventImpl final : public Event {
       public:
         AsyncEventImpl() = default;
 
         void Wait() override {
-            TRACE_EVENT0(TraceEventCategory::Default, "AsyncEventImpl.Wait");
+            TRACE_EVENT0(TraceEventCategory::ThreadPool, "AsyncEventImpl.Wait");
+
+            for (uint32_t i = 0; i < kEventSpinCount; i++) {
+                if (IsSignaled()) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
 
             std::unique_lock<std::mutex> lock(mMutex);
-            mCondition.wait(lock, [this] { return mIsSignaled; });
+            mCondition.wait(lock, [this] { return IsSignaled(); });
         }
 
         bool IsSignaled() override {
-            std::unique_lock<std::mutex> lock(mMutex);
-            return mIsSignaled;
+            return mIsSignaled.load(std::memory_order_acquire);
         }
 
         void Signal() override {
+            std::vector<std::shared_ptr<VoidCallback>> callbacks;
             {
+                // Set with the lock held so a waiter cannot miss the notification between
+                // checking the event and blocking.
                 std::unique_lock<std::mutex> lock(mMutex);
-                mIsSignaled = true;
+                mIsSignaled.store(true, std::memory_order_release);
+                callbacks.swap(mSignaledCallbacks);
             }
             mCondition.notify_all();
+
+            for (std::shared_ptr<VoidCallback>& callback : callbacks) {
+                (*callback)();
+            }
+        }
+
+        void AddSignaledCallback(std::shared_ptr<VoidCallback> callback) override {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                if (!IsSignaled()) {
+                    mSignaledCallbacks.push_back(callback);
+                    return;
+                }
+            }
+            (*callback)();
         }
 
       private:
         std::mutex mMutex;
         std::condition_variable mCondition;
-        bool mIsSignaled = false;
+        std::atomic<bool> mIsSignaled = {false};
+        std::vector<std::shared_ptr<VoidCallback>> mSignaledCallbacks;  // Guarded by mMutex.
     };
 
     class AsyncThreadPoolImpl final : public ThreadPool {
       public:
-        AsyncThreadPoolImpl() = default;
-        ~AsyncThreadPoolImpl() override = default;
+        AsyncThreadPoolImpl(uint32_t maxWorkerCount, const WORKER_THREAD_DESC& desc)
+            : mMaxWorkerCount(maxWorkerCount), mDesc(desc) {
+            ASSERT(mMaxWorkerCount > 0);
+        }
 
-        std::shared_ptr<Event> postTaskImpl(std::shared_ptr<VoidCallback> callback) override {
+        ~AsyncThreadPoolImpl() override {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mIsShutdown = true;
+            }
+            mCondition.notify_all();
+
+            for (std::thread& worker : mWorkers) {
+                ASSERT(worker.get_id() != std::this_thread::get_id());
+                worker.join();
+            }
+        }
+
+        std::shared_ptr<Event> postTaskImpl(std::shared_ptr<VoidCallback> callback,
+                                            TaskClass taskClass) override {
             std::shared_ptr<Event> event = std::make_shared<AsyncEventImpl>();
-            std::thread thread([callback, event]() {
-                InitializeThreadName(kWorkerThreadName);
-                (*callback)();
-                event->Signal();
-            });
-            thread.detach();
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                ASSERT(!mIsShutdown);
+                mTasksOfClass[static_cast<size_t>(taskClass)].push_back({callback, event});
+                mTaskCount++;
+
+                // Only start another worker when every existing one is busy.
+                if (mIdleWorkerCount < mTaskCount && mWorkers.size() < mMaxWorkerCount) {
+                    mWorkers.emplace_back([this]() { RunWorker(); });
+                }
+            }
+            mCondition.notify_one();
             return event;
         }
+
+      private:
+        struct Task {
+            std::shared_ptr<VoidCallback> Callback;
+            std::shared_ptr<Event> CompletionEvent;
+        };
+
+        void RunWorker() {
+            InitializeThreadName(kWorkerThreadName);
+
+            if (mDesc.Priority != ThreadPriority::kNormal &&
+                !SetCurrentThreadPriority(mDesc.Priority)) {
+                WarningLog() << "Worker thread priority could not be set.\n";
+            }
+
+            if (mDesc.AffinityMask != 0 && !SetCurrentThreadAffinityMask(mDesc.AffinityMask)) {
+                WarningLog() << "Worker thread affinity could not be set.\n";
+            }
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (true) {
+                mIdleWorkerCount++;
+                mCondition.wait(lock, [this] { return mIsShutdown || mTaskCount > 0; });
+                mIdleWorkerCount--;
+
+                // Remaining tasks are run before shutting down so every event gets signaled.
+                if (mTaskCount == 0) {
+                    ASSERT(mIsShutdown);
+                    return;
+                }
+
+                // Most urgent class first.
+                auto tasks = std::find_if(mTasksOfClass.begin(), mTasksOfClass.end(),
+                                          [](const std::deque<Task>& t) { return !t.empty(); });
+                ASSERT(tasks != mTasksOfClass.end());
+
+                Task task = std::move(tasks->front());
+                tasks->pop_front();
+                mTaskCount--;
+
+                lock.unlock();
+                (*task.Callback)();
+                task.CompletionEvent->Signal();
+                lock.lock();
+            }
+        }
+
+        const uint32_t mMaxWorkerCount;
+        const WORKER_THREAD_DESC mDesc;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::array<std::deque<Task>, kNumOfTaskClasses> mTasksOfClass;
+        size_t mTaskCount = 0;
+        std::vector<std::thread> mWorkers;
+        size_t mIdleWorkerCount = 0;
+        bool mIsShutdown = false;
     };
 
-    // Event
+    // Runs tasks on the TaskScheduler of the host. Destroying the pool waits for every task
+    // scheduled to complete, since the scheduler could still be running them.
+    class ScheduledThreadPoolImpl final : public ThreadPool {
+      public:
+        explicit ScheduledThreadPoolImpl(TaskScheduler* scheduler) : mScheduler(scheduler) {
+            ASSERT(mScheduler != nullptr);
+        }
 
-    void Event::SetThreadPool(std::shared_ptr<ThreadPool> pool) {
-        mPool = pool;
-    }
+        ~ScheduledThreadPoolImpl() override {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mPendingTaskCount == 0; });
+        }
+
+        std::shared_ptr<Event> postTaskImpl(std::shared_ptr<VoidCallback> callback,
+                                            TaskClass taskClass) override {
+            std::shared_ptr<Event> event = std::make_shared<AsyncEventImpl>();
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mPendingTaskCount++;
+            }
+            mScheduler->ScheduleTask(std::make_shared<ScheduledTask>(this, callback, event),
+                                     taskClass);
+            return event;
+        }
+
+      private:
+        class ScheduledTask final : public VoidCallback {
+          public:
+            ScheduledTask(ScheduledThreadPoolImpl* pool,
+                          std::shared_ptr<VoidCallback> callback,
+                          std::shared_ptr<Event> completionEvent)
+                : mPool(pool), mCallback(callback), mCompletionEvent(completionEvent) {
+            }
+
+            void operator()() override {
+                (*mCallback)();
+                mCompletionEvent->Signal();
+                mPool->OnTaskCompleted();
+            }
+
+          private:
+            ScheduledThreadPoolImpl* const mPool;
+            std::shared_ptr<VoidCallback> mCallback;
+            std::shared_ptr<Event> mCompletionEvent;
+        };
+
+        // Notified with the lock held, since the pool could be destroyed as soon as it is
+        // released.
+        void OnTaskCompleted() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPendingTaskCount--;
+            mCondition.notify_all();
+        }
+
+        TaskScheduler* const mScheduler;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        uint64_t mPendingTaskCount = 0;
+    };
 
     // ThreadPool
 
     // static
-    std::shared_ptr<ThreadPool> ThreadPool::Create() {
-        return std::shared_ptr<ThreadPool>(new AsyncThreadPoolImpl());
+    std::shared_ptr<ThreadPool> ThreadPool::Create(uint32_t maxWorkerCount) {
+        const WORKER_THREAD_DESC desc = GetWorkerThreadDesc();
+        if (desc.Scheduler != nullptr) {
+            return std::shared_ptr<ThreadPool>(new ScheduledThreadPoolImpl(desc.Scheduler));
+        }
+
+        if (maxWorkerCount == 0) {
+            maxWorkerCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        return std::shared_ptr<ThreadPool>(new AsyncThreadPoolImpl(maxWorkerCount, desc));
     }
 
     // static
     std::shared_ptr<Event> ThreadPool::PostTask(std::shared_ptr<ThreadPool> pool,
-                                                std::shared_ptr<VoidCallback> callback) {
-        std::shared_ptr<Event> event = pool->postTaskImpl(callback);
-        if (event != nullptr) {
-            event->SetThreadPool(pool);
-        }
-        return event;
+                                                std::shared_ptr<VoidCallback> callback,
+                                                TaskClass taskClass) {
+        return pool->postTaskImpl(callback, taskClass);
     }
 
 }  // namespace gpgmm
@@ -16,7 +16,10 @@
 #define GPGMM_WORKERTHREAD_H_
 
 #include "gpgmm/common/NonCopyable.h"
+#include "gpgmm/common/PlatformUtils.h"
+#include "include/gpgmm_export.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace gpgmm {
@@ -29,6 +32,52 @@ namespace gpgmm {
         virtual void operator()() = 0;
     };
 
+    // Kinds of tasks posted to a ThreadPool, from the most to the least urgent. Each class is
+    // queued separately and workers always run the oldest task of the most urgent class first.
+    enum class TaskClass {
+        // Work a caller waits on, such as CreateResourceAsync.
+        kRequested = 0,
+
+        // Evicting memory to stay within budget.
+        kEviction = 1,
+
+        // Allocating memory ahead of demand, such as prefetching slabs or reserving heaps.
+        kPrefetch = 2,
+
+        // Releasing memory no longer needed, such as destroying heaps.
+        kRelease = 3,
+    };
+
+    static constexpr size_t kNumOfTaskClasses = 4u;
+
+    // Runs the tasks of thread pools on a job system of the host, such as a fiber scheduler,
+    // instead of on worker threads created by GPGMM.
+    class TaskScheduler {
+      public:
+        virtual ~TaskScheduler() = default;
+
+        // Runs |task| exactly once, on any thread. |taskClass| tells how urgent it is. Tasks
+        // may block the thread they run on, for example to wait on another task.
+        virtual void ScheduleTask(std::shared_ptr<VoidCallback> task, TaskClass taskClass) = 0;
+    };
+
+    struct WORKER_THREAD_DESC {
+        // OS priority of worker threads.
+        ThreadPriority Priority = ThreadPriority::kNormal;
+
+        // Logical processors worker threads may run on, one bit per processor. When 0 is
+        // specified, workers may run on any processor.
+        uint64_t AffinityMask = 0;
+
+        // Runs tasks instead of worker threads, when specified, so |Priority| and |AffinityMask|
+        // are ignored. Must outlive every thread pool created while it is set.
+        TaskScheduler* Scheduler = nullptr;
+    };
+
+    // Decides how tasks are run by thread pools created afterwards, typically set once before
+    // creating any allocator. Thread pools already created are unaffected.
+    GPGMM_EXPORT void SetWorkerThreadDesc(const WORKER_THREAD_DESC& desc);
+
     class ThreadPool;
 
     // An event that we can wait on, useful for joining worker threads.
@@ -46,25 +95,33 @@ namespace gpgmm {
         // Signals the event is ready. If ready, wait() will not block.
         virtual void Signal() = 0;
 
-        void SetThreadPool(std::shared_ptr<ThreadPool> pool);
-
-      private:
-        std::shared_ptr<ThreadPool> mPool;
+        // Runs |callback| once |this| event is signaled, on the thread which signals it, or on
+        // the calling thread if already signaled. Lets the caller be notified without a thread
+        // blocked in Wait.
+        virtual void AddSignaledCallback(std::shared_ptr<VoidCallback> callback) = 0;
     };
 
+    // ThreadPool runs posted tasks on a fixed set of worker threads which are started on demand
+    // and re-used for the lifetime of the pool, or on the TaskScheduler of the host. Destroying
+    // the pool runs any remaining tasks then joins all of its workers, so no worker can outlive
+    // the pool.
     class ThreadPool : public NonCopyable {
       public:
         ThreadPool() = default;
         virtual ~ThreadPool() = default;
 
-        static std::shared_ptr<ThreadPool> Create();
+        // Creates a pool which runs at-most |maxWorkerCount| tasks concurrently, or one worker per
+        // hardware thread if zero.
+        static std::shared_ptr<ThreadPool> Create(uint32_t maxWorkerCount = 0);
 
         static std::shared_ptr<Event> PostTask(std::shared_ptr<ThreadPool> pool,
-                                               std::shared_ptr<VoidCallback> callback);
+                                               std::shared_ptr<VoidCallback> callback,
+                                               TaskClass taskClass = TaskClass::kRequested);
 
       private:
         // Return event to wait on until the callback runs.
-        virtual std::shared_ptr<Event> postTaskImpl(std::shared_ptr<VoidCallback> callback) = 0;
+        virtual std::shared_ptr<Event> postTaskImpl(std::shared_ptr<VoidCallback> callback,
+                                                    TaskClass taskClass) = 0;
     };
 
 }  // namespace gpgmm
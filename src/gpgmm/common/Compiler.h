@@ -20,6 +20,7 @@
 //  - GPGMM_COMPILER_[CLANG|GCC|MSVC]: Compiler detection
 //  - GPGMM_BREAKPOINT(): Raises an exception and breaks in the debugger
 //  - GPGMM_BUILTIN_UNREACHABLE(): Hints the compiler that a code path is unreachable
+//  - GPGMM_RETURN_ADDRESS(): Address the calling function returns to, ie. its call site
 //  - GPGMM_NO_DISCARD: An attribute that is C++17 [[nodiscard]] where available
 //  - GPGMM_(UN)?LIKELY(EXPR): Where available, hints the compiler that the expression will be true
 //      (resp. false) to help it generate code that leads to better branch prediction.
@@ -45,6 +46,7 @@
 #    endif
 
 #    define GPGMM_BUILTIN_UNREACHABLE() __builtin_unreachable()
+#    define GPGMM_RETURN_ADDRESS() __builtin_return_address(0)
 #    define GPGMM_LIKELY(x) __builtin_expect(!!(x), 1)
 #    define GPGMM_UNLIKELY(x) __builtin_expect(!!(x), 0)
 
@@ -75,6 +77,10 @@ extern void __cdecl __debugbreak(void);
 
 #    define GPGMM_BUILTIN_UNREACHABLE() __assume(false)
 
+extern "C" void* _ReturnAddress(void);
+#    pragma intrinsic(_ReturnAddress)
+#    define GPGMM_RETURN_ADDRESS() _ReturnAddress()
+
 // Visual Studio 2017 15.3 adds support for [[nodiscard]]
 #    if _MSC_VER >= 1911 && DAWN_CPP_VERSION >= 17
 #        define GPGMM_NO_DISCARD [[nodiscard]]
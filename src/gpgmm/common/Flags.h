@@ -15,106 +15,109 @@
 #ifndef GPGMM_COMMON_FLAGS_H_
 #define GPGMM_COMMON_FLAGS_H_
 
+#include <ostream>
+
 namespace gpgmm {
 
     // Flags is a type-safe means of storing enum values that can be OR'd
-    // together without requiring a cast.
+    // together without requiring a cast. Every operation is constexpr, so a fixed set of flags,
+    // and any check of it, can be evaluated at compile-time.
     template <typename EnumT, typename ValueT = int>
     class Flags final {
       public:
         using enum_type = EnumT;
         using value_type = ValueT;
 
-        constexpr Flags() : mValue(0) {
+        constexpr Flags() noexcept : mValue(0) {
         }
 
-        constexpr Flags(EnumT flag) : mValue(static_cast<ValueT>(flag)) {
+        constexpr Flags(EnumT flag) noexcept : mValue(static_cast<ValueT>(flag)) {
         }
 
-        constexpr explicit Flags(ValueT value) : mValue(static_cast<ValueT>(value)) {
+        constexpr explicit Flags(ValueT value) noexcept : mValue(static_cast<ValueT>(value)) {
         }
 
-        constexpr bool operator==(EnumT flag) const {
+        constexpr bool operator==(EnumT flag) const noexcept {
             return mValue == static_cast<ValueT>(flag);
         }
 
-        constexpr bool operator!=(EnumT flag) const {
+        constexpr bool operator!=(EnumT flag) const noexcept {
             return mValue != static_cast<ValueT>(flag);
         }
 
-        constexpr friend std::ostream& operator<<(std::ostream& out, const Flags& flag) {
+        friend std::ostream& operator<<(std::ostream& out, const Flags& flag) {
             out << flag.mValue;
             return out;
         }
 
         // Compound assignment between Flags.
 
-        Flags& operator&=(const Flags& flags) {
+        constexpr Flags& operator&=(const Flags& flags) noexcept {
             mValue &= flags.mValue;
             return *this;
         }
 
-        Flags& operator|=(const Flags& flags) {
+        constexpr Flags& operator|=(const Flags& flags) noexcept {
             mValue |= flags.mValue;
             return *this;
         }
 
-        Flags& operator^=(const Flags& flags) {
+        constexpr Flags& operator^=(const Flags& flags) noexcept {
             mValue ^= flags.mValue;
             return *this;
         }
 
         // Bitwise between Flags.
 
-        constexpr Flags operator&(const Flags& flags) const {
+        constexpr Flags operator&(const Flags& flags) const noexcept {
             return Flags(mValue & flags.mValue);
         }
 
-        constexpr Flags operator|(const Flags& flags) const {
+        constexpr Flags operator|(const Flags& flags) const noexcept {
             return Flags(mValue | flags.mValue);
         }
 
-        constexpr Flags operator^(const Flags& flags) const {
+        constexpr Flags operator^(const Flags& flags) const noexcept {
             return Flags(mValue ^ flags.mValue);
         }
 
         // Bitwise using raw enum.
 
-        constexpr Flags operator&(EnumT flag) const {
+        constexpr Flags operator&(EnumT flag) const noexcept {
             return operator&(Flags(flag));
         }
 
-        constexpr Flags operator|(EnumT flag) const {
+        constexpr Flags operator|(EnumT flag) const noexcept {
             return operator|(Flags(flag));
         }
 
-        constexpr Flags operator^(EnumT flag) const {
+        constexpr Flags operator^(EnumT flag) const noexcept {
             return operator^(Flags(flag));
         }
 
         // Compound assignment using raw enum.
 
-        Flags& operator&=(EnumT flag) {
+        constexpr Flags& operator&=(EnumT flag) noexcept {
             return operator&=(Flags(flag));
         }
 
-        Flags& operator|=(EnumT flag) {
+        constexpr Flags& operator|=(EnumT flag) noexcept {
             return operator|=(Flags(flag));
         }
 
-        Flags& operator^=(EnumT flag) {
+        constexpr Flags& operator^=(EnumT flag) noexcept {
             return operator^=(Flags(flag));
         }
 
-        constexpr Flags operator~() const {
+        constexpr Flags operator~() const noexcept {
             return Flags(~mValue);
         }
 
-        constexpr bool operator!() const {
+        constexpr bool operator!() const noexcept {
             return !mValue;
         }
 
-        operator int() const {
+        constexpr operator int() const noexcept {
             return mValue;
         }
 
@@ -124,33 +127,33 @@ namespace gpgmm {
 
 // Overloaded operations are inline to avoid duplicate symbols from being
 // generated and failing to link when using the macro across multiple cpps.
-#define DEFINE_OPERATORS_FOR_FLAGS(Type)                                        \
-    inline constexpr Type operator&(Type::enum_type lhs, Type::enum_type rhs) { \
-        return Type(lhs) & rhs;                                                 \
-    }                                                                           \
-    inline constexpr Type operator&(Type::enum_type lhs, const Type& rhs) {     \
-        return rhs & lhs;                                                       \
-    }                                                                           \
-    inline void operator&(Type::enum_type lhs, Type::value_type rhs) {          \
-    }                                                                           \
-    inline constexpr Type operator|(Type::enum_type lhs, Type::enum_type rhs) { \
-        return Type(lhs) | rhs;                                                 \
-    }                                                                           \
-    inline constexpr Type operator|(Type::enum_type lhs, const Type& rhs) {     \
-        return rhs | lhs;                                                       \
-    }                                                                           \
-    inline void operator|(Type::enum_type lhs, Type::value_type rhs) {          \
-    }                                                                           \
-    inline constexpr Type operator^(Type::enum_type lhs, Type::enum_type rhs) { \
-        return Type(lhs) ^ rhs;                                                 \
-    }                                                                           \
-    inline constexpr Type operator^(Type::enum_type lhs, const Type& rhs) {     \
-        return rhs ^ lhs;                                                       \
-    }                                                                           \
-    inline void operator^(Type::enum_type lhs, Type::value_type rhs) {          \
-    }                                                                           \
-    inline constexpr Type operator~(Type::enum_type val) {                      \
-        return ~Type(val);                                                      \
+#define DEFINE_OPERATORS_FOR_FLAGS(Type)                                                 \
+    inline constexpr Type operator&(Type::enum_type lhs, Type::enum_type rhs) noexcept { \
+        return Type(lhs) & rhs;                                                          \
+    }                                                                                    \
+    inline constexpr Type operator&(Type::enum_type lhs, const Type& rhs) noexcept {     \
+        return rhs & lhs;                                                                \
+    }                                                                                    \
+    inline void operator&(Type::enum_type lhs, Type::value_type rhs) noexcept {          \
+    }                                                                                    \
+    inline constexpr Type operator|(Type::enum_type lhs, Type::enum_type rhs) noexcept { \
+        return Type(lhs) | rhs;                                                          \
+    }                                                                                    \
+    inline constexpr Type operator|(Type::enum_type lhs, const Type& rhs) noexcept {     \
+        return rhs | lhs;                                                                \
+    }                                                                                    \
+    inline void operator|(Type::enum_type lhs, Type::value_type rhs) noexcept {          \
+    }                                                                                    \
+    inline constexpr Type operator^(Type::enum_type lhs, Type::enum_type rhs) noexcept { \
+        return Type(lhs) ^ rhs;                                                          \
+    }                                                                                    \
+    inline constexpr Type operator^(Type::enum_type lhs, const Type& rhs) noexcept {     \
+        return rhs ^ lhs;                                                                \
+    }                                                                                    \
+    inline void operator^(Type::enum_type lhs, Type::value_type rhs) noexcept {          \
+    }                                                                                    \
+    inline constexpr Type operator~(Type::enum_type val) noexcept {                      \
+        return ~Type(val);                                                               \
     }
 
 }  // namespace gpgmm
@@ -0,0 +1,163 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_COMMON_FLATPOINTERMAP_H_
+#define GPGMM_COMMON_FLATPOINTERMAP_H_
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/NonCopyable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace gpgmm {
+
+    // FlatPointerMap maps non-null pointers to values stored in a single array, using open
+    // addressing with linear probing. Unlike std::unordered_map, inserting does not allocate a
+    // node per entry and removing leaves no tombstones behind, since the entries after the
+    // removed one are shifted back instead. Inserting, finding, and removing are O(1) on
+    // average; the array only grows (and rehashes) once half full.
+    //
+    // FlatPointerMap is not thread-safe.
+    template <typename ValueT>
+    class FlatPointerMap final : public NonCopyable {
+      public:
+        FlatPointerMap() = default;
+
+        // Returns false when |key| already exists, in which case the value is unchanged.
+        bool Insert(const void* key, ValueT value) {
+            ASSERT(key != nullptr);
+            if ((mSize + 1) * 2 > mSlots.size()) {
+                Grow();
+            }
+
+            size_t index = GetHomeIndex(key);
+            while (mSlots[index].Key != nullptr) {
+                if (mSlots[index].Key == key) {
+                    return false;
+                }
+                index = (index + 1) & GetMask();
+            }
+
+            mSlots[index].Key = key;
+            mSlots[index].Value = std::move(value);
+            mSize++;
+            return true;
+        }
+
+        // Returns nullptr when |key| does not exist.
+        ValueT* Find(const void* key) {
+            const size_t index = FindIndex(key);
+            return (index == kInvalidIndex) ? nullptr : &mSlots[index].Value;
+        }
+
+        // Removes |key|, moving its value into |valueOut| when non-null. Returns false when
+        // |key| does not exist.
+        bool Remove(const void* key, ValueT* valueOut = nullptr) {
+            size_t index = FindIndex(key);
+            if (index == kInvalidIndex) {
+                return false;
+            }
+
+            if (valueOut != nullptr) {
+                *valueOut = std::move(mSlots[index].Value);
+            }
+
+            // Shift back every following entry of the probe sequence which is not already at its
+            // home slot or after the hole, so lookups never need to skip over removed entries.
+            size_t next = (index + 1) & GetMask();
+            while (mSlots[next].Key != nullptr) {
+                const size_t home = GetHomeIndex(mSlots[next].Key);
+                if (((next - home) & GetMask()) >= ((next - index) & GetMask())) {
+                    mSlots[index] = std::move(mSlots[next]);
+                    index = next;
+                }
+                next = (next + 1) & GetMask();
+            }
+
+            mSlots[index] = {};
+            mSize--;
+            return true;
+        }
+
+        // Calls |fn| with the key and value of every entry, in no particular order.
+        template <typename Fn>
+        void ForEach(Fn&& fn) const {
+            for (const Slot& slot : mSlots) {
+                if (slot.Key != nullptr) {
+                    fn(slot.Key, slot.Value);
+                }
+            }
+        }
+
+        size_t GetSize() const {
+            return mSize;
+        }
+
+      private:
+        struct Slot {
+            const void* Key = nullptr;
+            ValueT Value = {};
+        };
+
+        constexpr static size_t kMinCapacity = 16;
+        constexpr static size_t kInvalidIndex = ~static_cast<size_t>(0);
+
+        size_t GetMask() const {
+            return mSlots.size() - 1;
+        }
+
+        // Pointers are aligned, so the low bits are mixed into the high bits (ie. Fibonacci
+        // hashing) before being masked.
+        size_t GetHomeIndex(const void* key) const {
+            const uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key)) *
+                                  0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(hash >> 32) & GetMask();
+        }
+
+        size_t FindIndex(const void* key) const {
+            if (mSize == 0) {
+                return kInvalidIndex;
+            }
+
+            size_t index = GetHomeIndex(key);
+            while (mSlots[index].Key != nullptr) {
+                if (mSlots[index].Key == key) {
+                    return index;
+                }
+                index = (index + 1) & GetMask();
+            }
+            return kInvalidIndex;
+        }
+
+        void Grow() {
+            std::vector<Slot> slots((mSlots.empty()) ? kMinCapacity : mSlots.size() * 2);
+            std::swap(slots, mSlots);
+            mSize = 0;
+            for (Slot& slot : slots) {
+                if (slot.Key != nullptr) {
+                    Insert(slot.Key, std::move(slot.Value));
+                }
+            }
+        }
+
+        std::vector<Slot> mSlots;
+        size_t mSize = 0;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_COMMON_FLATPOINTERMAP_H_
@@ -14,151 +14,315 @@
 
 #include "JSONEncoder.h"
 
+#include "gpgmm/common/Assert.h"
+
+#include <cstdio>
+
 namespace gpgmm {
 
-    // JSONDict
+    namespace {
+
+        // Formats |value| like std::to_string would, but without creating a string unless it
+        // does not fit on the stack.
+        template <typename T>
+        void AppendFormatted(std::string* buffer, const char* format, T value) {
+            char formatted[32];
+            const int length = std::snprintf(formatted, sizeof(formatted), format, value);
+            if (length < 0 || static_cast<size_t>(length) >= sizeof(formatted)) {
+                buffer->append(std::to_string(value));
+                return;
+            }
+            buffer->append(formatted, length);
+        }
 
-    JSONDict::JSONDict() {
-        mSS << "{ ";
+        void AppendQuoted(std::string* buffer, const char* value, size_t size) {
+            buffer->push_back('"');
+            buffer->append(value, size);
+            buffer->push_back('"');
+        }
+
+    }  // namespace
+
+    // JSONWriter
+
+    void JSONWriter::BeginDict() {
+        BeginScope('{', /*isArray*/ false);
     }
 
-    JSONDict::JSONDict(const std::string& name, const JSONDict& object) {
-        mSS << "{ ";
-        AddItem(name, object);
+    void JSONWriter::EndDict() {
+        ASSERT(mDepth > 0 && !(mIsArrayMask & (1ull << (mDepth - 1))));
+        EndScope('}');
+    }
+
+    void JSONWriter::BeginArray() {
+        BeginScope('[', /*isArray*/ true);
+    }
+
+    void JSONWriter::EndArray() {
+        ASSERT(mDepth > 0 && (mIsArrayMask & (1ull << (mDepth - 1))));
+        EndScope(']');
+    }
+
+    void JSONWriter::AddName(const char* name) {
+        ASSERT(mDepth > 0 && !(mIsArrayMask & (1ull << (mDepth - 1))));
+        BeginValue();
+        AppendQuoted(&mBuffer, name, std::char_traits<char>::length(name));
+        mBuffer.append(": ");
+        mHasName = true;
+    }
+
+    void JSONWriter::AddValue(const std::string& value) {
+        BeginValue();
+        AppendQuoted(&mBuffer, value.data(), value.size());
+    }
+
+    void JSONWriter::AddValue(const char* value) {
+        BeginValue();
+        AppendQuoted(&mBuffer, value, std::char_traits<char>::length(value));
+    }
+
+    void JSONWriter::AddValue(char value) {
+        BeginValue();
+        AppendQuoted(&mBuffer, &value, 1);
+    }
+
+    void JSONWriter::AddValue(uint64_t value) {
+        BeginValue();
+        AppendFormatted(&mBuffer, "%llu", static_cast<unsigned long long>(value));
+    }
+
+    void JSONWriter::AddValue(uint32_t value) {
+        BeginValue();
+        AppendFormatted(&mBuffer, "%u", value);
+    }
+
+    void JSONWriter::AddValue(bool value) {
+        // Same as std::to_string, which encodes booleans as integers.
+        BeginValue();
+        mBuffer.push_back(value ? '1' : '0');
+    }
+
+    void JSONWriter::AddValue(float value) {
+        BeginValue();
+        AppendFormatted(&mBuffer, "%f", value);
+    }
+
+    void JSONWriter::AddValue(double value) {
+        BeginValue();
+        AppendFormatted(&mBuffer, "%f", value);
+    }
+
+    void JSONWriter::AddValue(int value) {
+        BeginValue();
+        AppendFormatted(&mBuffer, "%d", value);
+    }
+
+    void JSONWriter::AddValue(unsigned char value) {
+        return AddValue(static_cast<uint32_t>(value));
+    }
+
+    void JSONWriter::AddEncodedValue(const std::string& encodedValue) {
+        BeginValue();
+        mBuffer.append(encodedValue);
     }
 
-    JSONDict::JSONDict(const JSONDict& other) {
-        mSS = std::stringstream(other.mSS.str());
-        mHasItem = other.mHasItem;
+    void JSONWriter::AddValue(const JSONWriter& other) {
+        BeginValue();
+        mBuffer.append(other.mBuffer);
+        other.AppendClosers(&mBuffer);
     }
 
-    JSONDict& JSONDict::operator=(const JSONDict& other) {
-        mSS = std::stringstream(other.mSS.str());
-        mHasItem = other.mHasItem;
-        return *this;
+    bool JSONWriter::IsEmpty() const {
+        return !(mHasItemMask & 1);
+    }
+
+    std::string JSONWriter::ToString() const {
+        std::string json;
+        json.reserve(mBuffer.size() + mDepth * 2);
+        json.append(mBuffer);
+        AppendClosers(&json);
+        return json;
+    }
+
+    const std::string& JSONWriter::GetBuffer() const {
+        return mBuffer;
+    }
+
+    void JSONWriter::Reset() {
+        mBuffer.clear();
+        mDepth = 0;
+        mHasItemMask = 0;
+        mIsArrayMask = 0;
+        mHasName = false;
+    }
+
+    void JSONWriter::BeginScope(char begin, bool isArray) {
+        ASSERT(mDepth < kMaxDepth);
+        BeginValue();
+        mBuffer.push_back(begin);
+        mBuffer.push_back(' ');
+
+        const uint64_t scopeBit = 1ull << mDepth;
+        mHasItemMask &= ~scopeBit;
+        if (isArray) {
+            mIsArrayMask |= scopeBit;
+        } else {
+            mIsArrayMask &= ~scopeBit;
+        }
+        mDepth++;
+    }
+
+    void JSONWriter::EndScope(char end) {
+        mBuffer.push_back(' ');
+        mBuffer.push_back(end);
+        mDepth--;
+    }
+
+    void JSONWriter::BeginValue() {
+        // Values named within a dict were already separated from the previous item.
+        if (mHasName) {
+            mHasName = false;
+            return;
+        }
+
+        if (mDepth == 0) {
+            return;
+        }
+
+        const uint64_t scopeBit = 1ull << (mDepth - 1);
+        if (mHasItemMask & scopeBit) {
+            mBuffer.append(", ");
+        }
+        mHasItemMask |= scopeBit;
+    }
+
+    void JSONWriter::AppendClosers(std::string* buffer) const {
+        for (uint32_t depth = mDepth; depth > 0; depth--) {
+            buffer->push_back(' ');
+            buffer->push_back((mIsArrayMask & (1ull << (depth - 1))) ? ']' : '}');
+        }
+    }
+
+    // JSONDict
+
+    JSONDict::JSONDict() {
+        mWriter.BeginDict();
+    }
+
+    JSONDict::JSONDict(const char* name, const JSONDict& object) {
+        mWriter.BeginDict();
+        AddItem(name, object);
     }
 
     std::string JSONDict::ToString() const {
-        return mSS.str() + " }";
+        return mWriter.ToString();
     }
 
     bool JSONDict::IsEmpty() const {
-        return !mHasItem;
+        return mWriter.IsEmpty();
     }
 
-    void JSONDict::AddItem(const std::string& name, std::string value) {
-        return AddItemInternal(name, "\"" + value + "\"");
+    void JSONDict::AddItem(const char* name, const std::string& value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, char value) {
-        return AddItemInternal(name, "\"" + std::string(1, value) + "\"");
+    void JSONDict::AddItem(const char* name, char value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, const char* value) {
-        return AddItemInternal(name, "\"" + std::string(value) + "\"");
+    void JSONDict::AddItem(const char* name, const char* value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, uint64_t value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, uint64_t value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, uint32_t value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, uint32_t value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, bool value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, bool value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, float value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, float value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, double value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, double value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, int value) {
-        return AddItemInternal(name, std::to_string(value));
+    void JSONDict::AddItem(const char* name, int value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, unsigned char value) {
-        return AddItem(name, static_cast<uint32_t>(value));
+    void JSONDict::AddItem(const char* name, unsigned char value) {
+        mWriter.AddItem(name, value);
     }
 
-    void JSONDict::AddItem(const std::string& name, const JSONDict& object) {
-        return AddItemInternal(name, object.ToString());
+    void JSONDict::AddItem(const char* name, const JSONDict& object) {
+        mWriter.AddItem(name, object.mWriter);
     }
 
-    void JSONDict::AddItem(const std::string& name, const JSONArray& object) {
-        return AddItemInternal(name, object.ToString());
+    void JSONDict::AddItem(const char* name, const JSONArray& object) {
+        mWriter.AddItem(name, object.mWriter);
     }
 
-    void JSONDict::AddItemInternal(const std::string& name, const std::string& value) {
-        if (mHasItem) {
-            mSS << ", ";
-        }
-        mSS << "\"" + name + "\": " << value;
-        mHasItem = true;
+    void JSONDict::AddEncodedItem(const char* name, const std::string& encodedValue) {
+        mWriter.AddName(name);
+        mWriter.AddEncodedValue(encodedValue);
+    }
+
+    JSONWriter* JSONDict::GetWriter() {
+        return &mWriter;
     }
 
     // JSONArray
 
     JSONArray::JSONArray() {
-        mSS << "[ ";
-    }
-
-    JSONArray::JSONArray(const JSONArray& other) {
-        mSS = std::stringstream(other.mSS.str());
-        mHasItem = other.mHasItem;
+        mWriter.BeginArray();
     }
 
     std::string JSONArray::ToString() const {
-        return mSS.str() + " ]";
+        return mWriter.ToString();
     }
 
     void JSONArray::AddItem(const std::string& value) {
-        return AddItemInternal("\"" + value + "\"");
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(uint64_t value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(uint32_t value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(bool value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(float value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(double value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(int value) {
-        return AddItemInternal(std::to_string(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(unsigned char value) {
-        return AddItem(static_cast<uint32_t>(value));
+        mWriter.AddValue(value);
     }
 
     void JSONArray::AddItem(const JSONDict& object) {
-        return AddItemInternal(object.ToString());
-    }
-
-    void JSONArray::AddItemInternal(const std::string& value) {
-        if (mHasItem) {
-            mSS << ", ";
-        }
-        mSS << value;
-        mHasItem = true;
+        mWriter.AddValue(object.mWriter);
     }
 
 }  // namespace gpgmm
@@ -15,48 +15,119 @@
 #ifndef GPGMM_COMMON_JSON_ENCODER_H_
 #define GPGMM_COMMON_JSON_ENCODER_H_
 
-#include <sstream>
+#include <cstdint>
 #include <string>
 
 namespace gpgmm {
 
+    // JSONWriter appends JSON to a single buffer as values are added, so dicts and arrays nested
+    // within each other are written in place instead of each being encoded then copied into
+    // their parent. Only the buffer itself can allocate, as it grows.
+    class JSONWriter {
+      public:
+        JSONWriter() = default;
+
+        void BeginDict();
+        void EndDict();
+        void BeginArray();
+        void EndArray();
+
+        // Name of the next value, within a dict.
+        void AddName(const char* name);
+
+        // Per JSON data type
+        void AddValue(const std::string& value);
+        void AddValue(const char* value);
+        void AddValue(char value);
+        void AddValue(uint64_t value);
+        void AddValue(uint32_t value);
+        void AddValue(bool value);
+        void AddValue(float value);
+        void AddValue(double value);
+        void AddValue(int value);
+        void AddValue(unsigned char value);
+
+        // Adds a value which is already encoded as JSON.
+        void AddEncodedValue(const std::string& encodedValue);
+
+        // Adds the JSON written by |other|, closing any dicts or arrays it left open.
+        void AddValue(const JSONWriter& other);
+
+        template <typename T>
+        void AddItem(const char* name, const T& value) {
+            AddName(name);
+            AddValue(value);
+        }
+
+        // True if nothing was added to the outermost dict or array.
+        bool IsEmpty() const;
+
+        // Returns the JSON written so far, closing any dicts or arrays left open.
+        std::string ToString() const;
+
+        // JSON written so far, as is. Only complete once every dict and array has ended.
+        const std::string& GetBuffer() const;
+
+        // Clears the JSON written so far but keeps the buffer, so it can be re-used without
+        // allocating.
+        void Reset();
+
+      private:
+        void BeginScope(char begin, bool isArray);
+        void EndScope(char end);
+        void BeginValue();
+        void AppendClosers(std::string* buffer) const;
+
+        std::string mBuffer;
+
+        // One bit per open dict or array, starting from the outermost.
+        constexpr static uint32_t kMaxDepth = 64;
+        uint32_t mDepth = 0;
+        uint64_t mHasItemMask = 0;
+        uint64_t mIsArrayMask = 0;
+
+        bool mHasName = false;
+    };
+
     class JSONArray;
 
     class JSONDict {
       public:
         JSONDict();
-        JSONDict(const std::string& name, const JSONDict& object);
-        JSONDict(const JSONDict& other);
-        JSONDict& operator=(const JSONDict& other);
+        JSONDict(const char* name, const JSONDict& object);
 
         std::string ToString() const;
         bool IsEmpty() const;
 
         // Per JSON data type
-        void AddItem(const std::string& name, std::string value);
-        void AddItem(const std::string& name, char value);
-        void AddItem(const std::string& name, const char* value);
-        void AddItem(const std::string& name, uint64_t value);
-        void AddItem(const std::string& name, uint32_t value);
-        void AddItem(const std::string& name, bool value);
-        void AddItem(const std::string& name, float value);
-        void AddItem(const std::string& name, double value);
-        void AddItem(const std::string& name, int value);
-        void AddItem(const std::string& name, unsigned char value);
-        void AddItem(const std::string& name, const JSONDict& object);
-        void AddItem(const std::string& name, const JSONArray& object);
+        void AddItem(const char* name, const std::string& value);
+        void AddItem(const char* name, char value);
+        void AddItem(const char* name, const char* value);
+        void AddItem(const char* name, uint64_t value);
+        void AddItem(const char* name, uint32_t value);
+        void AddItem(const char* name, bool value);
+        void AddItem(const char* name, float value);
+        void AddItem(const char* name, double value);
+        void AddItem(const char* name, int value);
+        void AddItem(const char* name, unsigned char value);
+        void AddItem(const char* name, const JSONDict& object);
+        void AddItem(const char* name, const JSONArray& object);
+
+        // Adds a value which is already encoded as JSON (ex. by ToString()).
+        void AddEncodedItem(const char* name, const std::string& encodedValue);
+
+        // Writer of the dict, to stream nested values into it.
+        JSONWriter* GetWriter();
 
       private:
-        void AddItemInternal(const std::string& name, const std::string& value);
+        friend JSONArray;
 
-        bool mHasItem = false;
-        std::stringstream mSS;
+        JSONWriter mWriter;
     };
 
     class JSONArray {
       public:
         JSONArray();
-        JSONArray(const JSONArray& other);
 
         std::string ToString() const;
 
@@ -72,10 +143,9 @@ namespace gpgmm {
         void AddItem(const JSONDict& object);
 
       private:
-        void AddItemInternal(const std::string& value);
+        friend JSONDict;
 
-        bool mHasItem = false;
-        std::stringstream mSS;
+        JSONWriter mWriter;
     };
 
 }  // namespace gpgmm
@@ -10,6 +10,7 @@
 #include "Assert.h"
 #include "Utils.h"
 
+#include <cstddef>
 #include <utility>
 
 namespace gpgmm {
@@ -41,6 +42,12 @@ namespace gpgmm {
     //
     // Lastly, to iterate through the linked list forwards:
     //
+    //   for (MyNodeType* value : list) {
+    //     ...
+    //   }
+    //
+    // Or, when nodes are removed while iterating:
+    //
     //   for (LinkNode<MyNodeType>* node = list.head();
     //        node != list.end();
     //        node = node->next()) {
@@ -75,23 +82,25 @@ namespace gpgmm {
     //    * Insertion operations with base::LinkedList<T> never require
     //      heap allocations.
     //
+    //    * Moving a node to another position, or another list, is an O(1)
+    //      operation with LinkedList::Splice.
+    //
     // Q. How does base::LinkedList implementation differ from std::list?
     //
     // A. Doubly-linked lists are made up of nodes that contain "next" and
     //    "previous" pointers that reference other nodes in the list.
     //
     //    With base::LinkedList<T>, the type being inserted already reserves
-    //    space for the "next" and "previous" pointers (base::LinkNode<T>*).
-    //    Whereas with std::list<T> the type can be anything, so the implementation
-    //    needs to glue on the "next" and "previous" pointers using
-    //    some internal node type.
+       template <typename T>
+    class LinkedList;
 
     template <typename T>
     class LinkNode {
       public:
-        LinkNode() : previous_(nullptr), next_(nullptr) {
+        LinkNode() : previous_(nullptr), next_(nullptr), list_(nullptr) {
         }
-        LinkNode(LinkNode<T>* previous, LinkNode<T>* next) : previous_(previous), next_(next) {
+        LinkNode(LinkNode<T>* previous, LinkNode<T>* next)
+            : previous_(previous), next_(next), list_(nullptr) {
         }
 
         LinkNode(LinkNode<T>&& rhs) {
@@ -99,6 +108,8 @@ namespace gpgmm {
             rhs.next_ = nullptr;
             previous_ = rhs.previous_;
             rhs.previous_ = nullptr;
+            list_ = rhs.list_;
+            rhs.list_ = nullptr;
 
             // If the node belongs to a list, next_ and previous_ are both non-null.
             // Otherwise, they are both null.
@@ -114,6 +125,7 @@ namespace gpgmm {
             this->previous_ = e->previous_;
             e->previous_->next_ = this;
             e->previous_ = this;
+            SetList(e->list_);
         }
 
         // Insert |this| into the linked list, after |e|.
@@ -122,6 +134,7 @@ namespace gpgmm {
             this->previous_ = e;
             e->next_->previous_ = this;
             e->next_ = this;
+            SetList(e->list_);
         }
 
         // Check if |this| is in a list.
@@ -138,6 +151,7 @@ namespace gpgmm {
             // list.
             this->next_ = nullptr;
             this->previous_ = nullptr;
+            SetList(nullptr);
         }
 
         LinkNode<T>* previous() const {
@@ -158,29 +172,85 @@ namespace gpgmm {
         }
 
       private:
+        friend class LinkedList<T>;
+
+        // Moves the count of this node from the list it was in to |list|.
+        void SetList(LinkedList<T>* list) {
+            if (list_ != nullptr) {
+                list_->size_--;
+            }
+            list_ = list;
+            if (list_ != nullptr) {
+                list_->size_++;
+            }
+        }
+
         LinkNode<T>* previous_;
         LinkNode<T>* next_;
+
+        // List the node is counted by, so the list size is known without walking it. Only null
+        // when the node is not in a list, or its list was destroyed.
+        LinkedList<T>* list_;
     };
 
     template <typename T>
     class LinkedList {
       public:
+        // Iterates the values of the list, from head to tail. Nodes cannot be removed while
+        // iterated. Compares equal to the node it is at, so head()/end() loops still work.
+        class Iterator {
+          public:
+            Iterator(const LinkNode<T>* node) : mNode(const_cast<LinkNode<T>*>(node)) {
+            }
+
+            T* operator*() const {
+                return mNode->value();
+            }
+
+            Iterator& operator++() {
+                mNode = mNode->next();
+                return *this;
+            }
+
+            LinkNode<T>* GetNode() const {
+                return mNode;
+            }
+
+            friend bool operator==(const Iterator& a, const Iterator& b) {
+                return a.mNode == b.mNode;
+            }
+
+            friend bool operator!=(const Iterator& a, const Iterator& b) {
+                return a.mNode != b.mNode;
+            }
+
+          private:
+            LinkNode<T>* mNode;
+        };
+
         // The "root" node is self-referential, and forms the basis of a circular
         // list (root_.next() will point back to the start of the list,
         // and root_->previous() wraps around to the end of the list).
         LinkedList() : root_(&root_, &root_) {
+            root_.list_ = this;
         }
 
         ~LinkedList() {
             // If any LinkNodes still exist in the LinkedList, there will be outstanding references
             // to root_ even after it has been freed. We should remove root_ from the list to
             // prevent any future access.
+            for (LinkNode<T>* node = head(); node != end(); node = node->next()) {
+                node->list_ = nullptr;
+            }
+            root_.list_ = nullptr;
             root_.RemoveFromList();
         }
 
         // Using LinkedList in std::vector or STL container requires the move constructor to not
-        // throw.
-        LinkedList(LinkedList&& other) noexcept : root_(std::move(other.root_)) {
+        // throw. Moving is O(n) since every node is then counted by this list.
+        LinkedList(LinkedList&& other) noexcept : root_(&root_, &root_) {
+            root_.list_ = this;
+            Splice(end(), other.begin(), other.end());
         }
 
         // Appends |e| to the end of the linked list.
@@ -188,6 +258,54 @@ namespace gpgmm {
             e->InsertBefore(&root_);
         }
 
+        // Prepends |e| to the start of the linked list.
+        void Prepend(LinkNode<T>* e) {
+            e->InsertAfter(&root_);
+        }
+
+        // Moves |e|, from whichever list it is in, if any, to before |position| in this list.
+        void Splice(Iterator position, LinkNode<T>* e) {
+            // Already in place.
+            if (position.GetNode() == e) {
+                return;
+            }
+
+            if (e->IsInList()) {
+                e->RemoveFromList();
+            }
+            e->InsertBefore(position.GetNode());
+        }
+
+        // Moves the nodes in [first, last), of the same list, to before |position| in this list.
+        // Moving within this list is O(1), otherwise O(n) of the nodes moved. |position| cannot
+        // be one of the nodes moved.
+        void Splice(Iterator position, Iterator first, Iterator last) {
+            if (first == last) {
+                return;
+            }
+
+            LinkNode<T>* firstNode = first.GetNode();
+            LinkNode<T>* lastNode = last.GetNode()->previous_;
+
+            LinkedList<T>* otherList = firstNode->list_;
+            if (otherList != this) {
+                for (LinkNode<T>* node = firstNode; node != last.GetNode(); node = node->next_) {
+                    node->SetList(this);
+                }
+            }
+
+            // Unlink the nodes from where they were.
+            firstNode->previous_->next_ = last.GetNode();
+            last.GetNode()->previous_ = firstNode->previous_;
+
+            // And link them before |position|.
+            LinkNode<T>* positionNode = position.GetNode();
+            firstNode->previous_ = positionNode->previous_;
+            positionNode->previous_->next_ = firstNode;
+            lastNode->next_ = positionNode;
+            positionNode->previous_ = lastNode;
+        }
+
         LinkNode<T>* head() const {
             return root_.next();
         }
@@ -196,7 +314,11 @@ namespace gpgmm {
             return root_.previous();
         }
 
-        const LinkNode<T>* end() const {
+        Iterator begin() const {
+            return head();
+        }
+
+        Iterator end() const {
             return &root_;
         }
 
@@ -204,6 +326,11 @@ namespace gpgmm {
             return head() == end();
         }
 
+        // Number of nodes in the list, in O(1).
+        size_t size() const {
+            return size_;
+        }
+
         // Empty the list by deleting all nodes.
         // ~T must check if IsInList and call RemoveFromList to unlink itself or RemoveAndDeleteAll
         // will ASSERT to indicate programmer error.
@@ -218,7 +345,12 @@ namespace gpgmm {
         }
 
       private:
+        friend class LinkNode<T>;
+
         LinkNode<T> root_;
+
+        // Counts the nodes, not including root_.
+        size_t size_ = 0;
     };
 
 }  // namespace gpgmm
@@ -16,11 +16,18 @@
 #include "Log.h"
 
 #include "Assert.h"
+#include "NonCopyable.h"
 #include "Platform.h"
 #include "Utils.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #if defined(GPGMM_PLATFORM_ANDROID)
 #    include <android/log.h>
@@ -79,6 +86,104 @@ namespace gpgmm {
         }
 #endif  // defined(GPGMM_PLATFORM_ANDROID)
 
+        // Set once the log sink is destroyed, after which messages are written directly.
+        std::atomic<bool> gIsLogSinkDestroyed(false);
+
+        // Writes log messages to stdout from a thread of its own. Messages are written in the
+        // order they were logged, whether queued or written directly.
+        class LogSink final : public NonCopyable {
+          public:
+            LogSink() : mThread([this]() { ThreadLoop(); }) {
+            }
+
+            ~LogSink() {
+                {
+                    std::lock_guard<std::mutex> lock(mQueueMutex);
+                    mIsExiting = true;
+                }
+                mQueueCondition.notify_one();
+                mThread.join();
+
+                gIsLogSinkDestroyed.store(true);
+                Flush();
+            }
+
+            void Enqueue(std::string line) {
+                {
+                    std::lock_guard<std::mutex> lock(mQueueMutex);
+                    mQueuedLines.push_back(std::move(line));
+                }
+                mQueueCondition.notify_one();
+            }
+
+            // Writes |line| once the messages queued before it are written.
+            void Write(FILE* stream, const std::string& line) {
+                std::lock_guard<std::mutex> lock(mWriteMutex);
+                WriteQueuedLines();
+                fputs(line.c_str(), stream);
+                fflush(stream);
+            }
+
+            void Flush() {
+                std::lock_guard<std::mutex> lock(mWriteMutex);
+                WriteQueuedLines();
+            }
+
+          private:
+            void ThreadLoop() {
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mQueueMutex);
+                        mQueueCondition.wait(
+                            lock, [this]() { return mIsExiting || !mQueuedLines.empty(); });
+                        if (mIsExiting) {
+                            return;
+                        }
+                    }
+                    Flush();
+                }
+            }
+
+            // Lines are taken from the queue while holding mWriteMutex, so lines written
+            // directly cannot be written before lines queued before them.
+            void WriteQueuedLines() {
+                {
+                    std::lock_guard<std::mutex> lock(mQueueMutex);
+                    mWritingLines.swap(mQueuedLines);
+                }
+
+                if (mWritingLines.empty()) {
+                    return;
+                }
+
+                for (const std::string& line : mWritingLines) {
+                    fputs(line.c_str(), stdout);
+                }
+                fflush(stdout);
+                mWritingLines.clear();
+            }
+
+            std::mutex mQueueMutex;
+            std::condition_variable mQueueCondition;
+            std::vector<std::string> mQueuedLines;
+            bool mIsExiting = false;
+
+            // Guards writing, and the lines being written, so their capacity is re-used.
+            std::mutex mWriteMutex;
+            std::vector<std::string> mWritingLines;
+
+            std::thread mThread;
+        };
+
+        // Returns nullptr once the sink is destroyed, when exiting.
+        LogSink* GetLogSink() {
+            static LogSink sink;
+            if (gIsLogSinkDestroyed.load()) {
+                return nullptr;
+            }
+            return &sink;
+        }
+
     }  // anonymous namespace
 
     void SetLogMessageLevel(const LogSeverity& newLevel) {
@@ -89,15 +194,38 @@ namespace gpgmm {
         return gLogMessageLevel;
     }
 
+    bool IsLogMessageEnabled(const LogSeverity& severity) {
+        if (gLogMessageLevel <= severity) {
+            return true;
+        }
+#if defined(GPGMM_PLATFORM_WINDOWS)
+        // Messages are always output to the debug console.
+        return IsDebuggerPresent();
+#else
+        return false;
+#endif  // defined(GPGMM_PLATFORM_WINDOWS)
+    }
+
+    void FlushLogMessages() {
+        LogSink* sink = GetLogSink();
+        if (sink != nullptr) {
+            sink->Flush();
+        }
+    }
+
     // LogMessage
 
-    LogMessage::LogMessage(LogSeverity severity) : mSeverity(severity) {
+    LogMessage::LogMessage(LogSeverity severity)
+        : mSeverity(severity), mIsEnabled(IsLogMessageEnabled(severity)) {
     }
 
     LogMessage::~LogMessage() {
-        std::string fullMessage = mStream.str();
+        // If this message has been moved or was never given a value, it has no stream.
+        if (mStream == nullptr) {
+            return;
+        }
 
-        // If this message has been moved, its stream is empty.
+        std::string fullMessage = mStream->str();
         if (fullMessage.empty()) {
             return;
         }
@@ -131,10 +259,20 @@ namespace gpgmm {
         __android_log_print(androidPriority, "GPGMM", "%s: %s\n", severityName,
                             fullMessage.c_str());
 #else  // defined(GPGMM_PLATFORM_ANDROID)
-       // Note: we use fprintf because <iostream> includes static initializers.
-        fprintf(outputStream, "%s %s (tid:%s): %s\n", kLogTag, severityName,
-                ToString(std::this_thread::get_id()).c_str(), fullMessage.c_str());
-        fflush(outputStream);
+       // Note: we use fputs because <iostream> includes static initializers.
+        std::string outputString = std::string(kLogTag) + " " + severityName + " (tid:" +
+                                   ToString(std::this_thread::get_id()) + "): " + fullMessage +
+                                   "\n";
+
+        LogSink* sink = GetLogSink();
+        if (sink == nullptr) {
+            fputs(outputString.c_str(), outputStream);
+            fflush(outputStream);
+        } else if (outputStream == stdout) {
+            sink->Enqueue(std::move(outputString));
+        } else {
+            sink->Write(outputStream, outputString);
+        }
 #endif
     }
 
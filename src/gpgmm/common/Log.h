@@ -44,6 +44,7 @@
 //   // Get more information
 //   GPGMM_DEBUG() << texture.GetFormat();
 
+#include <memory>
 #include <sstream>
 
 namespace gpgmm {
@@ -61,7 +62,19 @@ namespace gpgmm {
     void SetLogMessageLevel(const LogSeverity& level);
     const LogSeverity& GetLogMessageLevel();
 
-    // Essentially an ostringstream that will print itself in its destructor.
+    // Returns true if a message of |severity| would be output. Checked before a message is
+    // formatted, so disabled messages cost no more than the check.
+    bool IsLogMessageEnabled(const LogSeverity& severity);
+
+    // Debug and info messages are written by a log thread, so logging them does not wait on the
+    // output. Warnings and errors are written before returning, after any messages queued before
+    // them.
+    //
+    // Writes any messages still queued for the log thread.
+    void FlushLogMessages();
+
+    // Essentially an ostringstream that will print itself in its destructor. Messages which are
+    // not enabled ignore any values given to them.
     class LogMessage {
       public:
         LogMessage(LogSeverity severity);
@@ -72,7 +85,12 @@ namespace gpgmm {
 
         template <typename T>
         LogMessage& operator<<(T&& value) {
-            mStream << value;
+            if (mIsEnabled) {
+                if (mStream == nullptr) {
+                    mStream = std::make_unique<std::ostringstream>();
+                }
+                *mStream << value;
+            }
             return *this;
         }
 
@@ -81,7 +99,10 @@ namespace gpgmm {
         LogMessage& operator=(const LogMessage& other) = delete;
 
         LogSeverity mSeverity;
-        std::ostringstream mStream;
+        bool mIsEnabled;
+
+        // Only created once a value is given, so disabled messages never construct a stream.
+        std::unique_ptr<std::ostringstream> mStream;
     };
 
     // Short-hands to create a LogMessage with the respective severity.
@@ -17,45 +17,149 @@
 #define GPGMM_COMMON_MATH_H_
 
 #include "Assert.h"
+#include "Platform.h"
 
 #include <cstddef>
 #include <cstdint>
 
 #include <limits>
 
+#if defined(GPGMM_COMPILER_MSVC)
+#    include <intrin.h>
+#endif
+
+// GCC and Clang bit-scan builtins can be constant evaluated, so the math below is constexpr and
+// folds for constant sizes. MSVC intrinsics cannot, so there the math is only inlined.
+#if defined(GPGMM_COMPILER_MSVC)
+#    define GPGMM_MATH_CONSTEXPR inline
+#else
+#    define GPGMM_MATH_CONSTEXPR constexpr
+#endif
+
 namespace gpgmm {
 
     // The following are not valid for 0
-    uint32_t ScanForward(uint32_t bits);
-    uint32_t Log2(uint32_t number);
-    uint32_t Log2(uint64_t number);
-    uint64_t PrevPowerOfTwo(uint64_t number);
+    GPGMM_MATH_CONSTEXPR uint32_t ScanForward(uint32_t bits) {
+        ASSERT(bits != 0);
+#if defined(GPGMM_COMPILER_MSVC)
+        unsigned long firstBitIndex = 0ul;
+        unsigned char ret = _BitScanForward(&firstBitIndex, bits);
+        ASSERT(ret != 0);
+        return firstBitIndex;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+    }
+
+    GPGMM_MATH_CONSTEXPR uint32_t ScanForward(uint64_t bits) {
+        ASSERT(bits != 0);
+#if defined(GPGMM_COMPILER_MSVC)
+#    if defined(GPGMM_PLATFORM_64_BIT)
+        unsigned long firstBitIndex = 0ul;
+        unsigned char ret = _BitScanForward64(&firstBitIndex, bits);
+        ASSERT(ret != 0);
+        return firstBitIndex;
+#    else   // defined(GPGMM_PLATFORM_64_BIT)
+        unsigned long firstBitIndex = 0ul;
+        if (_BitScanForward(&firstBitIndex, bits & 0xFFFFFFFF)) {
+            return firstBitIndex;
+        }
+        unsigned char ret = _BitScanForward(&firstBitIndex, bits >> 32);
+        ASSERT(ret != 0);
+        return firstBitIndex + 32;
+#    endif  // defined(GPGMM_PLATFORM_64_BIT)
+#else       // defined(GPGMM_COMPILER_MSVC)
+        return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif      // defined(GPGMM_COMPILER_MSVC)
+    }
+
+    GPGMM_MATH_CONSTEXPR uint32_t Log2(uint32_t number) {
+        ASSERT(number != 0);
+#if defined(GPGMM_COMPILER_MSVC)
+        unsigned long firstBitIndex = 0ul;
+        unsigned char ret = _BitScanReverse(&firstBitIndex, number);
+        ASSERT(ret != 0);
+        return firstBitIndex;
+#else
+        return 31 - static_cast<uint32_t>(__builtin_clz(number));
+#endif
+    }
+
+    GPGMM_MATH_CONSTEXPR uint32_t Log2(uint64_t number) {
+        ASSERT(number != 0);
+#if defined(GPGMM_COMPILER_MSVC)
+#    if defined(GPGMM_PLATFORM_64_BIT)
+        unsigned long firstBitIndex = 0ul;
+        unsigned char ret = _BitScanReverse64(&firstBitIndex, number);
+        ASSERT(ret != 0);
+        return firstBitIndex;
+#    else   // defined(GPGMM_PLATFORM_64_BIT)
+        unsigned long firstBitIndex = 0ul;
+        if (_BitScanReverse(&firstBitIndex, number >> 32)) {
+            return firstBitIndex + 32;
+        }
+        unsigned char ret = _BitScanReverse(&firstBitIndex, number & 0xFFFFFFFF);
+        ASSERT(ret != 0);
+        return firstBitIndex;
+#    endif  // defined(GPGMM_PLATFORM_64_BIT)
+#else       // defined(GPGMM_COMPILER_MSVC)
+        return 63 - static_cast<uint32_t>(__builtin_clzll(number));
+#endif      // defined(GPGMM_COMPILER_MSVC)
+    }
+
+    GPGMM_MATH_CONSTEXPR uint64_t PrevPowerOfTwo(uint64_t number) {
+        ASSERT(number != 0);
+        return 1ull << Log2(number);
+    }
+
+    constexpr bool IsPowerOfTwo(uint64_t number) {
+        return (number == 0) ? false : (number & (number - 1)) == 0;
+    }
+
+    GPGMM_MATH_CONSTEXPR uint64_t NextPowerOfTwo(uint64_t number) {
+        if (number <= 1) {
+            return 1;
+        }
+
+        return 1ull << (Log2(number - 1) + 1);
+    }
 
-    bool IsPowerOfTwo(uint64_t number);
-    uint64_t NextPowerOfTwo(uint64_t number);
-    bool IsAligned(uint32_t number, size_t multiple);
+    GPGMM_MATH_CONSTEXPR bool IsAligned(uint32_t number, size_t multiple) {
+        ASSERT(multiple <= UINT32_MAX);
+        ASSERT(multiple != 0);
+        if (IsPowerOfTwo(multiple)) {
+            const uint32_t multiple32 = static_cast<uint32_t>(multiple);
+            return (number & (multiple32 - 1)) == 0;
+        }
+        return number % multiple == 0;
+    }
 
     template <typename T>
-    T AlignToPowerOfTwo(T number, size_t alignment) {
+    GPGMM_MATH_CONSTEXPR T AlignToPowerOfTwo(T number, size_t alignment) {
         ASSERT(number <= std::numeric_limits<T>::max() - (alignment - 1));
         ASSERT(IsPowerOfTwo(alignment));
         ASSERT(alignment != 0);
-        const T& alignmentT = static_cast<T>(alignment);
+        const T alignmentT = static_cast<T>(alignment);
         return (number + (alignmentT - 1)) & ~(alignmentT - 1);
     }
 
     template <typename T>
-    T AlignTo(T number, size_t multiple) {
+    GPGMM_MATH_CONSTEXPR T AlignTo(T number, size_t multiple) {
         if (IsPowerOfTwo(multiple)) {
             return AlignToPowerOfTwo(number, multiple);
         }
         ASSERT(number <= std::numeric_limits<T>::max() - (multiple - 1));
         ASSERT(multiple != 0);
-        const T& multipleT = static_cast<T>(multiple);
+        const T multipleT = static_cast<T>(multiple);
         return ((number + multipleT - 1) / multipleT) * multipleT;
     }
 
-    uint64_t RoundUp(uint64_t n, uint64_t m);
+    GPGMM_MATH_CONSTEXPR uint64_t RoundUp(uint64_t n, uint64_t m) {
+        ASSERT(m > 0);
+        ASSERT(n > 0);
+        ASSERT(m <= std::numeric_limits<uint64_t>::max() - n);
+        return ((n + m - 1) / m) * m;
+    }
 
 }  // namespace gpgmm
 
@@ -0,0 +1,82 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/common/Memcpy.h"
+
+#include <cstdint>
+#include <cstring>
+
+// SSE2 is always available on x64, so no runtime check is needed.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define GPGMM_ENABLE_SSE2_COPY 1
+#    include <emmintrin.h>
+#endif
+
+namespace gpgmm {
+
+    namespace {
+
+        // Below this size, the fence costs more than the stores save.
+        static constexpr size_t kMinStreamingCopySize = 64u;
+
+    }  // namespace
+
+    void CopyToWriteCombined(void* dst, const void* src, size_t size) {
+        uint8_t* dstBytes = static_cast<uint8_t*>(dst);
+        const uint8_t* srcBytes = static_cast<const uint8_t*>(src);
+
+#if defined(GPGMM_ENABLE_SSE2_COPY)
+        if (size >= kMinStreamingCopySize) {
+            // Non-temporal stores require an aligned destination, so copy up to the first
+            // 16-byte boundary first.
+            const size_t headSize = (16u - (reinterpret_cast<uintptr_t>(dstBytes) & 15u)) & 15u;
+            std::memcpy(dstBytes, srcBytes, headSize);
+            dstBytes += headSize;
+            srcBytes += headSize;
+            size -= headSize;
+
+            // Fill a whole 64-byte line per iteration.
+            for (; size >= 64u; size -= 64u) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBytes));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBytes + 16));
+                const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBytes + 32));
+                const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBytes + 48));
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dstBytes), a);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dstBytes + 16), b);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dstBytes + 32), c);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dstBytes + 48), d);
+                dstBytes += 64;
+                srcBytes += 64;
+            }
+
+            for (; size >= 16u; size -= 16u) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBytes));
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dstBytes), a);
+                dstBytes += 16;
+                srcBytes += 16;
+            }
+
+            std::memcpy(dstBytes, srcBytes, size);
+
+            // Streaming stores are weakly ordered, so make them visible before the caller
+            // unmaps or submits work which reads them.
+            _mm_sfence();
+            return;
+        }
+#endif
+
+        std::memcpy(dstBytes, srcBytes, size);
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,30 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_COMMON_MEMCPY_H_
+#define GPGMM_COMMON_MEMCPY_H_
+
+#include <cstddef>
+
+namespace gpgmm {
+
+    // Copies |size| bytes from |src| to write-combined |dst|, such as mapped upload memory.
+    // Unlike memcpy, |dst| is never read and is written in whole 16-byte blocks with
+    // non-temporal stores where supported, so the write-combine buffers only flush full lines.
+    // The stores are fenced before returning.
+    void CopyToWriteCombined(void* dst, const void* src, size_t size);
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_COMMON_MEMCPY_H_
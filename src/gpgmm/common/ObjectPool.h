@@ -0,0 +1,91 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_COMMON_OBJECTPOOL_H_
+#define GPGMM_COMMON_OBJECTPOOL_H_
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/NonCopyable.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gpgmm {
+
+    // ObjectPool recycles objects of the same type so small, frequently created objects (ex.
+    // block metadata) do not call into the heap allocator every time. Objects are carved out of
+    // fixed-size chunks which are only freed once the pool is destroyed. Released objects are
+    // re-used in LIFO order so the most recently released (and likely cached) one is used next.
+    //
+    // ObjectPool is not thread-safe; the owner must synchronize access.
+    template <typename T>
+    class ObjectPool final : public NonCopyable {
+      public:
+        explicit ObjectPool(size_t objectsPerChunk = 64) : mObjectsPerChunk(objectsPerChunk) {
+            ASSERT(mObjectsPerChunk > 0);
+        }
+
+        ~ObjectPool() = default;
+
+        // Constructs an object using storage from the pool.
+        template <typename... Args>
+        T* Acquire(Args&&... args) {
+            Slot* slot = mFreeList;
+            if (slot != nullptr) {
+                mFreeList = slot->pNext;
+            } else {
+                if (mChunks.empty() || mNextSlotInChunk == mObjectsPerChunk) {
+                    mChunks.emplace_back(new Slot[mObjectsPerChunk]);
+                    mNextSlotInChunk = 0;
+                }
+                slot = &mChunks.back()[mNextSlotInChunk++];
+            }
+            return new (&slot->Storage) T(std::forward<Args>(args)...);
+        }
+
+        // Destroys an object previously acquired from this pool and returns its storage.
+        void Release(T* object) {
+            ASSERT(object != nullptr);
+            object->~T();
+            Slot* slot = reinterpret_cast<Slot*>(object);
+            slot->pNext = mFreeList;
+            mFreeList = slot;
+        }
+
+        // Number of objects which could be acquired without allocating another chunk.
+        size_t GetCapacityForTesting() const {
+            return mChunks.size() * mObjectsPerChunk;
+        }
+
+      private:
+        union Slot {
+            Slot* pNext;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+        };
+
+        const size_t mObjectsPerChunk;
+
+        std::vector<std::unique_ptr<Slot[]>> mChunks;
+        size_t mNextSlotInChunk = 0;
+
+        Slot* mFreeList = nullptr;
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_COMMON_OBJECTPOOL_H_
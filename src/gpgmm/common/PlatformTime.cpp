@@ -20,4 +20,15 @@ namespace gpgmm {
         static double origin = GetAbsoluteTime();
         return GetAbsoluteTime() - origin;
     }
+
+    uint64_t PlatformTime::TicksToNanoseconds(uint64_t ticks) const {
+        constexpr static uint64_t kNanosecondsPerSecond = 1000000000ull;
+        const uint64_t ticksPerSecond = GetTicksPerSecond();
+
+        // Whole seconds and the remainder are converted separately so |ticks| * 1e9 cannot
+        // overflow.
+        return (ticks / ticksPerSecond) * kNanosecondsPerSecond +
+               (ticks % ticksPerSecond) * kNanosecondsPerSecond / ticksPerSecond;
+    }
+
 }  // namespace gpgmm
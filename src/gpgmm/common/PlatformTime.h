@@ -15,8 +15,21 @@
 #ifndef GPGMM_COMMON_PLATFORMTIME_H_
 #define GPGMM_COMMON_PLATFORMTIME_H_
 
+#include <cstdint>
+
 namespace gpgmm {
 
+    // Counter used to measure the time of the platform.
+    enum class PlatformTimeSource {
+        // Counter of the OS, which is safe to compare between threads and processors.
+        kDefault,
+
+        // Cycle counter of the processor, which can be read without calling into the OS. Its
+        // frequency is calibrated against the default counter once per process. Falls back to the
+        // default counter when the processor has no invariant (constant rate) cycle counter.
+        kCycleCounter,
+    };
+
     class PlatformTime {
       public:
         virtual ~PlatformTime() {
@@ -25,6 +38,16 @@ namespace gpgmm {
         // Return the current time (in seconds) of the platform.
         virtual double GetAbsoluteTime() = 0;
 
+        // Return the current time (in ticks) of the platform. Unlike GetAbsoluteTime(), no
+        // conversion is done, so subtracting two ticks is the cheapest way to measure a duration.
+        virtual uint64_t GetTicks() = 0;
+
+        // Return the number of ticks per second, which is constant for the lifetime of the timer.
+        virtual uint64_t GetTicksPerSecond() const = 0;
+
+        // Convert a duration of ticks to nanoseconds, using only integer math.
+        uint64_t TicksToNanoseconds(uint64_t ticks) const;
+
         // Return the elasped time (in seconds) since GetAbsoluteTime() was first called.
         double GetRelativeTime();
 
@@ -35,7 +58,7 @@ namespace gpgmm {
         virtual double EndElapsedTime() = 0;
     };
 
-    PlatformTime* CreatePlatformTime();
+    PlatformTime* CreatePlatformTime(PlatformTimeSource source = PlatformTimeSource::kDefault);
 
 }  // namespace gpgmm
 
@@ -22,6 +22,10 @@
 #    include <vector>
 #elif defined(GPGMM_PLATFORM_LINUX)
 #    include <limits.h>
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/resource.h>
+#    include <sys/syscall.h>
 #    include <unistd.h>
 #    include <cstdlib>
 #endif
@@ -113,6 +117,83 @@ namespace gpgmm {
 #    error "Implement GetExecutablePath for your platform."
 #endif
 
+#if defined(GPGMM_PLATFORM_WIN32)
+    bool SetCurrentThreadPriority(ThreadPriority priority) {
+        int threadPriority = THREAD_PRIORITY_NORMAL;
+        switch (priority) {
+            case ThreadPriority::kLowest:
+                threadPriority = THREAD_PRIORITY_LOWEST;
+                break;
+            case ThreadPriority::kBelowNormal:
+                threadPriority = THREAD_PRIORITY_BELOW_NORMAL;
+                break;
+            case ThreadPriority::kNormal:
+                threadPriority = THREAD_PRIORITY_NORMAL;
+                break;
+            case ThreadPriority::kAboveNormal:
+                threadPriority = THREAD_PRIORITY_ABOVE_NORMAL;
+                break;
+            case ThreadPriority::kHighest:
+                threadPriority = THREAD_PRIORITY_HIGHEST;
+                break;
+        }
+        return SetThreadPriority(GetCurrentThread(), threadPriority) == TRUE;
+    }
+
+    bool SetCurrentThreadAffinityMask(uint64_t affinityMask) {
+        return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(affinityMask)) !=
+               0;
+    }
+#elif defined(GPGMM_PLATFORM_LINUX)
+    // Threads are scheduled by their own nice value, which only privileged processes can lower.
+    bool SetCurrentThreadPriority(ThreadPriority priority) {
+        int niceValue = 0;
+        switch (priority) {
+            case ThreadPriority::kLowest:
+                niceValue = 19;
+                break;
+            case ThreadPriority::kBelowNormal:
+                niceValue = 10;
+                break;
+            case ThreadPriority::kNormal:
+                niceValue = 0;
+                break;
+            case ThreadPriority::kAboveNormal:
+                niceValue = -5;
+                break;
+            case ThreadPriority::kHighest:
+                niceValue = -10;
+                break;
+        }
+        return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), niceValue) == 0;
+    }
+
+#    if defined(GPGMM_PLATFORM_ANDROID)
+    bool SetCurrentThreadAffinityMask(uint64_t affinityMask) {
+        return false;
+    }
+#    else
+    bool SetCurrentThreadAffinityMask(uint64_t affinityMask) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (uint32_t cpu = 0; cpu < 64; cpu++) {
+            if (affinityMask & (1ull << cpu)) {
+                CPU_SET(cpu, &cpuSet);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+    }
+#    endif
+#else
+    bool SetCurrentThreadPriority(ThreadPriority priority) {
+        return false;
+    }
+
+    bool SetCurrentThreadAffinityMask(uint64_t affinityMask) {
+        return false;
+    }
+#endif
+
     std::string GetExecutableDirectory() {
         std::string exePath = GetExecutablePath();
         size_t lastPathSepLoc = exePath.find_last_of(GetPathSeparator());
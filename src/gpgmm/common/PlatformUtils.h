@@ -18,16 +18,33 @@
 
 #include "Platform.h"
 
+#include <cstdint>
 #include <string>
 
 namespace gpgmm {
 
+    enum class ThreadPriority {
+        kLowest,
+        kBelowNormal,
+        kNormal,
+        kAboveNormal,
+        kHighest,
+    };
+
     const char* GetPathSeparator();
     std::string GetEnvironmentVar(const char* variableName);
     bool SetEnvironmentVar(const char* variableName, const char* value);
     std::string GetExecutableDirectory();
     uint32_t GetPID();
 
+    // Returns false if the OS refused or the platform does not support it. Raising the priority
+    // above normal typically requires elevated privileges.
+    bool SetCurrentThreadPriority(ThreadPriority priority);
+
+    // Restricts the calling thread to the logical processors of |affinityMask|, one bit per
+    // processor. Returns false if the OS refused or the platform does not support it.
+    bool SetCurrentThreadAffinityMask(uint64_t affinityMask);
+
 }  // namespace gpgmm
 
 #endif  // GPGMM_COMMON_PLATFORMUTILS_H_
@@ -0,0 +1,65 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_COMMON_RATELIMITER_H_
+#define GPGMM_COMMON_RATELIMITER_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace gpgmm {
+
+    // RateLimiter allows up to a fixed count of acquires per period of time, and counts the
+    // acquires it rejected. Time is given by the caller, in any unit, so the same limiter can be
+    // driven by a real clock or a test. Acquiring is a few atomic operations and never locks, so
+    // the count allowed is approximate when many threads acquire at once.
+    class RateLimiter {
+      public:
+        RateLimiter() = default;
+
+        // Returns true if the acquire at |now| is allowed. The first acquire allowed in a new
+        // period returns, in |suppressedCountOut|, how many were rejected since the last
+        // acquire allowed, or zero otherwise.
+        bool TryAcquire(uint64_t now,
+                        uint64_t period,
+                        uint32_t maxCountPerPeriod,
+                        uint32_t* suppressedCountOut) {
+            *suppressedCountOut = 0;
+
+            uint64_t periodStart = mPeriodStart.load(std::memory_order_relaxed);
+            if (now - periodStart >= period &&
+                mPeriodStart.compare_exchange_strong(periodStart, now,
+                                                     std::memory_order_relaxed)) {
+                mCount.store(1, std::memory_order_relaxed);
+                *suppressedCountOut = mSuppressedCount.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (mCount.fetch_add(1, std::memory_order_relaxed) < maxCountPerPeriod) {
+                return true;
+            }
+
+            mSuppressedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+      private:
+        std::atomic<uint64_t> mPeriodStart{0};
+        std::atomic<uint32_t> mCount{0};
+        std::atomic<uint32_t> mSuppressedCount{0};
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_COMMON_RATELIMITER_H_
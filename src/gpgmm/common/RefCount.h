@@ -25,33 +25,99 @@ namespace gpgmm {
     template <typename T>
     class ScopedRef;
 
-    class RefCounted {
+    // Ref count which any thread can modify at once. Defined inline since objects are referenced
+    // far more often than they are created.
+    class AtomicRefCount {
+      public:
+        explicit AtomicRefCount(int_fast32_t initialCount) : mCount(initialCount) {
+        }
+
+        // Taking a new reference requires an existing one, so nothing needs to be ordered.
+        void Increment() {
+            mCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Returns true when the count reaches zero. Prior writes by every thread which released
+        // a reference are visible to the thread which released the last one.
+        bool Decrement() {
+            return mCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        int_fast32_t Load() const {
+            return mCount.load(std::memory_order_acquire);
+        }
+
+      private:
+        std::atomic_int_fast32_t mCount;
+    };
+
+    // Ref count which is only modified while holding the lock of its owner, ex. the allocator
+    // mutex, so it needs no atomic (locked) instructions to modify.
+    class NonAtomicRefCount {
+      public:
+        explicit NonAtomicRefCount(int_fast32_t initialCount) : mCount(initialCount) {
+        }
+
+        void Increment() {
+            mCount++;
+        }
+
+        bool Decrement() {
+            return --mCount == 0;
+        }
+
+        int_fast32_t Load() const {
+            return mCount;
+        }
+
+      private:
+        int_fast32_t mCount;
+    };
+
+    // |RefCountT| decides if the count can be modified by any thread, see AtomicRefCount, or
+    // must be externally locked, see NonAtomicRefCount.
+    template <typename RefCountT>
+    class RefCountedT {
       public:
         // Always require an initial refcount to construct because it is not known
         // what is being referenced (count vs object).
-        RefCounted() = delete;
+        RefCountedT() = delete;
 
-        explicit RefCounted(int_fast32_t initialCount);
+        explicit RefCountedT(int_fast32_t initialCount) : mRef(initialCount) {
+        }
 
         // Increments ref by one.
-        void Ref();
+        void Ref() {
+            mRef.Increment();
+        }
 
         // Decrements ref by one. If count is positive, returns false.
         // Otherwise, returns true when it reaches zero.
-        bool Unref();
+        bool Unref() {
+            return mRef.Decrement();
+        }
 
         // Get the ref count.
-        int_fast32_t GetRefCount() const;
+        int_fast32_t GetRefCount() const {
+            return mRef.Load();
+        }
 
         // Returns true if calling Unref() will reach a zero refcount.
-        bool HasOneRef() const;
+        bool HasOneRef() const {
+            return GetRefCount() == 1;
+        }
 
       private:
-        friend ScopedRef<RefCounted>;
+        friend ScopedRef<RefCountedT>;
 
-        mutable std::atomic_int_fast32_t mRef;
+        RefCountT mRef;
     };
 
+    using RefCounted = RefCountedT<AtomicRefCount>;
+
+    // Ref counted object only referenced while holding the lock of its owner.
+    using NonAtomicRefCounted = RefCountedT<NonAtomicRefCount>;
+
     // RAII style wrapper around RefCounted based objects.
     template <typename T>
     class ScopedRef {
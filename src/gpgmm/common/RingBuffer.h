@@ -0,0 +1,106 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_COMMON_RINGBUFFER_H_
+#define GPGMM_COMMON_RINGBUFFER_H_
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/common/NonCopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gpgmm {
+
+    // SPSCRingBuffer is a fixed-capacity FIFO queue which one thread (the producer) pushes to
+    // while another thread (the consumer) pops from, without either taking a lock. Once full,
+    // pushes fail instead of growing the buffer, so the memory used never changes after it is
+    // created.
+    //
+    // Only a single producer and a single consumer may use the buffer at once.
+    template <typename T>
+    class SPSCRingBuffer final : public NonCopyable {
+      public:
+        // |capacity| is rounded up to a power-of-two so indices can be masked.
+        explicit SPSCRingBuffer(uint64_t capacity)
+            : mCapacity(NextPowerOfTwo(capacity)), mSlots(new Slot[mCapacity]) {
+            ASSERT(capacity > 0);
+        }
+
+        ~SPSCRingBuffer() {
+            const uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+            for (uint64_t i = mReadIndex.load(std::memory_order_relaxed); i < writeIndex; i++) {
+                GetSlot(i)->~T();
+            }
+        }
+
+        // Constructs an item at the back of the buffer. Returns false if the buffer was full.
+        // Only called by the producer.
+        template <typename... Args>
+        bool TryEmplace(Args&&... args) {
+            const uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+            if (writeIndex - mReadIndex.load(std::memory_order_acquire) == mCapacity) {
+                return false;
+            }
+
+            new (GetSlot(writeIndex)) T(std::forward<Args>(args)...);
+            mWriteIndex.store(writeIndex + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Moves every item pushed so far, in FIFO order, to the end of |items|. Returns the
+        // number of items popped. Only called by the consumer.
+        uint64_t PopAll(std::vector<T>* items) {
+            const uint64_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+            const uint64_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+            for (uint64_t i = readIndex; i < writeIndex; i++) {
+                T* item = GetSlot(i);
+                items->push_back(std::move(*item));
+                item->~T();
+            }
+
+            mReadIndex.store(writeIndex, std::memory_order_release);
+            return writeIndex - readIndex;
+        }
+
+        uint64_t GetCapacity() const {
+            return mCapacity;
+        }
+
+      private:
+        using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+        T* GetSlot(uint64_t index) const {
+            return reinterpret_cast<T*>(&mSlots[index & (mCapacity - 1)]);
+        }
+
+        const uint64_t mCapacity;
+        std::unique_ptr<Slot[]> mSlots;
+
+        // Indices only ever increase and are masked to find the slot. The write index is only
+        // written by the producer and the read index only by the consumer.
+        std::atomic<uint64_t> mWriteIndex{0};
+        std::atomic<uint64_t> mReadIndex{0};
+    };
+
+}  // namespace gpgmm
+
+#endif  // GPGMM_COMMON_RINGBUFFER_H_
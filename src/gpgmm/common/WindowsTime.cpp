@@ -17,52 +17,126 @@
 
 #include <windows.h>
 
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <intrin.h>
+#endif
+
 namespace gpgmm {
 
+    namespace {
+
+        // The cycle counter is calibrated against the performance counter over 1/500th of a
+        // second (or 2ms).
+        constexpr static uint64_t kCalibrationsPerSecond = 500;
+
+        uint64_t QueryCounter() {
+            LARGE_INTEGER count;
+            const bool success = QueryPerformanceCounter(&count);
+            ASSERT(success);
+            return static_cast<uint64_t>(count.QuadPart);
+        }
+
+        // The performance counter frequency is fixed at boot, so it is only queried once.
+        uint64_t GetCounterFrequency() {
+            static const uint64_t frequency = []() {
+                LARGE_INTEGER frequency = {};
+                QueryPerformanceFrequency(&frequency);
+                return static_cast<uint64_t>(frequency.QuadPart);
+            }();
+            return frequency;
+        }
+
+#if defined(_M_IX86) || defined(_M_X64)
+        bool HasInvariantCycleCounter() {
+            int regs[4] = {};
+            __cpuid(regs, 0x80000000);
+            if (static_cast<uint32_t>(regs[0]) < 0x80000007) {
+                return false;
+            }
+
+            // Advanced power management leaf, EDX bit 8.
+            __cpuid(regs, 0x80000007);
+            return (regs[3] & (1 << 8)) != 0;
+        }
+
+        uint64_t QueryCycleCounter() {
+            return __rdtsc();
+        }
+
+        // Returns the cycle counter frequency, calibrated the first time it is called, or zero
+        // when the cycle counter cannot be used to measure time.
+        uint64_t GetCycleCounterFrequency() {
+            static const uint64_t frequency = []() -> uint64_t {
+                if (!HasInvariantCycleCounter()) {
+                    return 0;
+                }
+
+                const uint64_t counterFrequency = GetCounterFrequency();
+                const uint64_t counterStart = QueryCounter();
+                const uint64_t cycleStart = QueryCycleCounter();
+
+                uint64_t counterEnd = counterStart;
+                while (counterEnd - counterStart < counterFrequency / kCalibrationsPerSecond) {
+                    counterEnd = QueryCounter();
+                }
+
+                const uint64_t cycleEnd = QueryCycleCounter();
+                return (cycleEnd - cycleStart) * counterFrequency / (counterEnd - counterStart);
+            }();
+            return frequency;
+        }
+#else
+        uint64_t QueryCycleCounter() {
+            UNREACHABLE();
+            return 0;
+        }
+
+        uint64_t GetCycleCounterFrequency() {
+            return 0;
+        }
+#endif
+
+    }  // namespace
+
     class WindowsTime final : public PlatformTime {
       public:
-        WindowsTime() : PlatformTime(), mFrequency(0) {
+        explicit WindowsTime(PlatformTimeSource source)
+            : PlatformTime(),
+              mUseCycleCounter(source == PlatformTimeSource::kCycleCounter &&
+                               GetCycleCounterFrequency() != 0),
+              mTicksPerSecond(mUseCycleCounter ? GetCycleCounterFrequency()
+                                               : GetCounterFrequency()),
+              mTicksStart(0) {
         }
 
         double GetAbsoluteTime() override {
-            LARGE_INTEGER curTime;
-            const bool success = QueryPerformanceCounter(&curTime);
-            ASSERT(success);
-            return static_cast<double>(curTime.QuadPart) / GetFrequency();
+            return static_cast<double>(GetTicks()) / mTicksPerSecond;
         }
 
-        void StartElapsedTime() override {
-            LARGE_INTEGER startCount;
-            const bool success = QueryPerformanceCounter(&startCount);
-            ASSERT(success);
-            mCounterStart = startCount.QuadPart;
+        uint64_t GetTicks() override {
+            return (mUseCycleCounter) ? QueryCycleCounter() : QueryCounter();
         }
 
-        double EndElapsedTime() override {
-            LARGE_INTEGER endCount;
-            const bool success = QueryPerformanceCounter(&endCount);
-            ASSERT(success);
-            return static_cast<double>(endCount.QuadPart - mCounterStart) / GetFrequency();
+        uint64_t GetTicksPerSecond() const override {
+            return mTicksPerSecond;
         }
 
-      private:
-        LONGLONG GetFrequency() {
-            if (mFrequency == 0) {
-                LARGE_INTEGER frequency = {};
-                QueryPerformanceFrequency(&frequency);
-
-                mFrequency = frequency.QuadPart;
-            }
+        void StartElapsedTime() override {
+            mTicksStart = GetTicks();
+        }
 
-            return mFrequency;
+        double EndElapsedTime() override {
+            return static_cast<double>(GetTicks() - mTicksStart) / mTicksPerSecond;
         }
 
-        LONGLONG mFrequency;
-        LONGLONG mCounterStart;
+      private:
+        const bool mUseCycleCounter;
+        const uint64_t mTicksPerSecond;
+        uint64_t mTicksStart;
     };
 
-    PlatformTime* CreatePlatformTime() {
-        return new WindowsTime();
+    PlatformTime* CreatePlatformTime(PlatformTimeSource source) {
+        return new WindowsTime(source);
     }
 
 }  // namespace gpgmm
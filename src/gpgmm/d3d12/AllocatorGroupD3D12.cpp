@@ -0,0 +1,130 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/AllocatorGroupD3D12.h"
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/d3d12/ErrorD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace gpgmm { namespace d3d12 {
+
+    // static
+    HRESULT AllocatorGroup::CreateAllocatorGroup(const ALLOCATOR_GROUP_DESC& descriptor,
+                                                 AllocatorGroup** allocatorGroupOut) {
+        if (allocatorGroupOut == nullptr) {
+            return E_POINTER;
+        }
+
+        *allocatorGroupOut = new AllocatorGroup(descriptor);
+        return S_OK;
+    }
+
+    AllocatorGroup::AllocatorGroup(const ALLOCATOR_GROUP_DESC& descriptor)
+        : mTotalResourceBudgetLimit(descriptor.TotalResourceBudgetLimit) {
+    }
+
+    AllocatorGroup::~AllocatorGroup() {
+        // Every allocator holds a reference to the group.
+        ASSERT(mAllocators.empty());
+    }
+
+    HRESULT AllocatorGroup::CreateAllocator(const ALLOCATOR_DESC& descriptor,
+                                            ResourceAllocator** resourceAllocatorOut,
+                                            ResidencyManager** residencyManagerOut) {
+        if (resourceAllocatorOut == nullptr) {
+            return E_POINTER;
+        }
+
+        ResourceAllocator* resourceAllocator = nullptr;
+        ReturnIfFailed(ResourceAllocator::CreateAllocator(descriptor, &resourceAllocator,
+                                                          residencyManagerOut));
+
+        resourceAllocator->mGroup = this;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mAllocators.push_back(resourceAllocator);
+        }
+
+        *resourceAllocatorOut = resourceAllocator;
+        return S_OK;
+    }
+
+    void AllocatorGroup::Trim() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (ResourceAllocator* allocator : mAllocators) {
+            allocator->Trim();
+        }
+    }
+
+    uint64_t AllocatorGroup::GetResourceHeapUsage() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return GetResourceHeapUsageInternal();
+    }
+
+    uint64_t AllocatorGroup::GetResourceHeapUsageInternal() const {
+        uint64_t resourceHeapUsage = 0;
+        for (const ResourceAllocator* allocator : mAllocators) {
+            resourceHeapUsage += allocator->GetResourceHeapUsage();
+        }
+        return resourceHeapUsage;
+    }
+
+    void AllocatorGroup::ReserveBudget(ResourceAllocator* allocator, uint64_t size) {
+        if (mTotalResourceBudgetLimit == 0) {
+            return;
+        }
+
+        // Called without holding any lock of the allocators, so other allocators can be trimmed
+        // while holding the group lock.
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const uint64_t resourceHeapUsage = GetResourceHeapUsageInternal();
+        if (resourceHeapUsage + size <= mTotalResourceBudgetLimit) {
+            return;
+        }
+
+        uint64_t bytesToRelease = resourceHeapUsage + size - mTotalResourceBudgetLimit;
+
+        // Memory pooled by the allocator in need will likely be re-used by it, so it is released
+        // last.
+        for (ResourceAllocator* otherAllocator : mAllocators) {
+            if (bytesToRelease == 0) {
+                return;
+            }
+            if (otherAllocator == allocator) {
+                continue;
+            }
+            bytesToRelease -= std::min(
+                bytesToRelease,
+                otherAllocator->Trim(bytesToRelease, std::numeric_limits<double>::max()));
+        }
+
+        if (bytesToRelease > 0) {
+            allocator->Trim(bytesToRelease, std::numeric_limits<double>::max());
+        }
+    }
+
+    void AllocatorGroup::RemoveAllocator(ResourceAllocator* allocator) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = std::find(mAllocators.begin(), mAllocators.end(), allocator);
+        ASSERT(it != mAllocators.end());
+        mAllocators.erase(it);
+    }
+
+}}  // namespace gpgmm::d3d12
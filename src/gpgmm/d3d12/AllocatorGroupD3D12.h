@@ -0,0 +1,89 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_ALLOCATORGROUPD3D12_H_
+#define GPGMM_D3D12_ALLOCATORGROUPD3D12_H_
+
+#include "gpgmm/d3d12/IUnknownImplD3D12.h"
+#include "include/gpgmm_export.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace gpgmm { namespace d3d12 {
+
+    class ResidencyManager;
+    class ResourceAllocator;
+    struct ALLOCATOR_DESC;
+
+    struct ALLOCATOR_GROUP_DESC {
+        // Total size of resource heaps, in bytes, which may be allocated by every allocator of
+        // the group combined, regardless of the device or adapter each allocator was created
+        // for. Once exceeded, unused pooled resource heaps of the other allocators are released
+        // first so the memory counts towards the allocator in need.
+        // Optional parameter. By default (or zero), the group has no budget.
+        uint64_t TotalResourceBudgetLimit;
+    };
+
+    // Shares one budget between the resource allocators of a process, such as when an app
+    // creates a device per adapter. Each allocator still manages residency of its own device
+    // through its own residency manager, but resource heaps pooled by one allocator can be
+    // released to make room for another.
+    //
+    // Allocators of the group keep the group alive, so the group can be released once every
+    // allocator was created.
+    class GPGMM_EXPORT AllocatorGroup final : public IUnknownImpl {
+      public:
+        static HRESULT CreateAllocatorGroup(const ALLOCATOR_GROUP_DESC& descriptor,
+                                            AllocatorGroup** allocatorGroupOut);
+
+        ~AllocatorGroup() override;
+
+        // Equivalent to ResourceAllocator::CreateAllocator except the allocator belongs to the
+        // group.
+        HRESULT CreateAllocator(const ALLOCATOR_DESC& descriptor,
+                                ResourceAllocator** resourceAllocatorOut,
+                                ResidencyManager** residencyManagerOut = nullptr);
+
+        // Releases unused pooled resource heaps of every allocator in the group.
+        void Trim();
+
+        // Returns the size of resource heaps, in bytes, allocated by every allocator of the
+        // group combined.
+        uint64_t GetResourceHeapUsage() const;
+
+      private:
+        friend ResourceAllocator;
+
+        explicit AllocatorGroup(const ALLOCATOR_GROUP_DESC& descriptor);
+
+        // Makes room for |size| bytes to be allocated by |allocator|, by releasing unused pooled
+        // resource heaps from the other allocators first, then from |allocator| itself.
+        // Allocating may still exceed the budget if not enough could be released.
+        void ReserveBudget(ResourceAllocator* allocator, uint64_t size);
+
+        void RemoveAllocator(ResourceAllocator* allocator);
+
+        uint64_t GetResourceHeapUsageInternal() const;
+
+        const uint64_t mTotalResourceBudgetLimit;
+
+        mutable std::mutex mMutex;
+        std::vector<ResourceAllocator*> mAllocators;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_ALLOCATORGROUPD3D12_H_
@@ -27,8 +27,10 @@ namespace gpgmm { namespace d3d12 {
                                      D3D12_RESOURCE_FLAGS resourceFlags,
                                      D3D12_RESOURCE_STATES initialResourceState,
                                      uint64_t bufferSize,
-                                     uint64_t bufferAlignment)
+                                     uint64_t bufferAlignment,
+                                     MemoryAllocator* resourceHeapAllocator)
         : mResourceAllocator(resourceAllocator),
+          mResourceHeapAllocator(resourceHeapAllocator),
           mHeapType(heapType),
           mResourceFlags(resourceFlags),
           mInitialResourceState(initialResourceState),
@@ -36,21 +38,27 @@ namespace gpgmm { namespace d3d12 {
           mBufferAlignment(bufferAlignment) {
     }
 
-    std::unique_ptr<MemoryAllocation> BufferAllocator::TryAllocateMemory(uint64_t size,
-                                                                         uint64_t alignment,
-                                                                         bool neverAllocate,
-                                                                         bool cacheSize,
-                                                                         bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "BufferAllocator.TryAllocateMemory");
+    BufferAllocator::~BufferAllocator() {
+        ASSERT(mResourceHeapAllocations.GetSize() == 0);
+    }
+
+    std::unique_ptr<MemoryAllocation> BufferAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "BufferAllocator.TryAllocateMemory");
 
-        if (GetMemorySize() != size || GetMemoryAlignment() != alignment || neverAllocate) {
+        if (GetMemoryAlignment() != request.Alignment || request.NeverAllocate) {
+            return {};
+        }
+
+        if ((mBufferSize != kInvalidSize && mBufferSize != request.Size) ||
+            request.Size % request.Alignment != 0) {
             return {};
         }
 
         D3D12_RESOURCE_DESC resourceDescriptor;
         resourceDescriptor.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-        resourceDescriptor.Alignment = alignment;
-        resourceDescriptor.Width = size;
+        resourceDescriptor.Alignment = request.Alignment;
+        resourceDescriptor.Width = request.Size;
         resourceDescriptor.Height = 1;
         resourceDescriptor.DepthOrArraySize = 1;
         resourceDescriptor.MipLevels = 1;
@@ -60,10 +68,14 @@ namespace gpgmm { namespace d3d12 {
         resourceDescriptor.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
         resourceDescriptor.Flags = mResourceFlags;
 
+        if (mResourceHeapAllocator != nullptr) {
+            return TryAllocatePlacedBuffer(resourceDescriptor, request);
+        }
+
         // Optimized clear is not supported for buffers.
         Heap* resourceHeap = nullptr;
         if (FAILED(mResourceAllocator->CreateCommittedResource(
-                mHeapType, D3D12_HEAP_FLAG_NONE, size, &resourceDescriptor,
+                mHeapType, D3D12_HEAP_FLAG_NONE, request.Size, &resourceDescriptor,
                 /*pOptimizedClearValue*/ nullptr, mInitialResourceState, /*resourceOut*/ nullptr,
                 &resourceHeap))) {
             return {};
@@ -72,9 +84,60 @@ namespace gpgmm { namespace d3d12 {
         return std::make_unique<MemoryAllocation>(this, resourceHeap);
     }
 
+    std::unique_ptr<MemoryAllocation> BufferAllocator::TryAllocatePlacedBuffer(
+        const D3D12_RESOURCE_DESC& resourceDescriptor,
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        MEMORY_ALLOCATION_REQUEST resourceHeapRequest = request;
+        resourceHeapRequest.Size = resourceDescriptor.Width;
+        resourceHeapRequest.Alignment = mBufferAlignment;
+        resourceHeapRequest.PrefetchMemory = false;
+
+        std::unique_ptr<MemoryAllocation> resourceHeapAllocation;
+        GPGMM_TRY_ASSIGN(mResourceHeapAllocator->TryAllocateMemory(resourceHeapRequest),
+                         resourceHeapAllocation);
+
+        // Optimized clear is not supported for buffers.
+        Heap* resourceHeap = ToBackend(resourceHeapAllocation->GetMemory());
+        ComPtr<ID3D12Resource> placedBuffer;
+        if (FAILED(mResourceAllocator->CreatePlacedResource(
+                resourceHeap, /*resourceOffset*/ 0, &resourceDescriptor,
+                /*pOptimizedClearValue*/ nullptr, mInitialResourceState, &placedBuffer))) {
+            mResourceHeapAllocator->DeallocateMemory(std::move(resourceHeapAllocation));
+            return {};
+        }
+
+        resourceHeap->SetPlacedBuffer(std::move(placedBuffer));
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mResourceHeapAllocations.Insert(resourceHeap, std::move(resourceHeapAllocation));
+        }
+
+        return std::make_unique<MemoryAllocation>(this, resourceHeap);
+    }
+
     void BufferAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "BufferAllocator.DeallocateMemory");
-        mResourceAllocator->DeallocateMemory(std::move(allocation));
+        TRACE_EVENT0(TraceEventCategory::Allocation, "BufferAllocator.DeallocateMemory");
+
+        if (mResourceHeapAllocator == nullptr) {
+            mResourceAllocator->DeallocateMemory(std::move(allocation));
+            return;
+        }
+
+        // Releases the placed buffer but not the resource heap, which is returned to the resource
+        // heap allocator to be re-used.
+        Heap* resourceHeap = ToBackend(allocation->GetMemory());
+        resourceHeap->SetPlacedBuffer(nullptr);
+
+        std::unique_ptr<MemoryAllocation> resourceHeapAllocation;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const bool wasRemoved =
+                mResourceHeapAllocations.Remove(resourceHeap, &resourceHeapAllocation);
+            ASSERT(wasRemoved);
+        }
+
+        mResourceHeapAllocator->DeallocateMemory(std::move(resourceHeapAllocation));
     }
 
     uint64_t BufferAllocator::GetMemorySize() const {
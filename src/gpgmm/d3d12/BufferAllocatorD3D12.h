@@ -16,6 +16,7 @@
 #define GPGMM_D3D12_BUFFERALLOCATORD3D12_H_
 
 #include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/FlatPointerMap.h"
 
 #include "gpgmm/d3d12/d3d12_platform.h"
 
@@ -23,6 +24,14 @@ namespace gpgmm { namespace d3d12 {
 
     class ResourceAllocator;
 
+    // Creates committed buffers of |bufferSize|. When |bufferSize| is kInvalidSize, buffers are
+    // created of whatever size is requested instead, as long as the size is a multiple of
+    // |bufferAlignment|.
+    //
+    // When |resourceHeapAllocator| is specified, buffers are placed in resource heaps allocated
+    // from it instead of being committed. Should the heaps be pooled, creating a buffer only
+    // costs a CreatePlacedResource and the heap of a released buffer can be re-used by the next
+    // one. The |resourceHeapAllocator| must outlive the BufferAllocator.
     class BufferAllocator : public MemoryAllocator {
       public:
         BufferAllocator(ResourceAllocator* resourceAllocator,
@@ -30,28 +39,34 @@ namespace gpgmm { namespace d3d12 {
                         D3D12_RESOURCE_FLAGS resourceFlags,
                         D3D12_RESOURCE_STATES initialResourceState,
                         uint64_t bufferSize,
-                        uint64_t bufferAlignment);
-        ~BufferAllocator() override = default;
+                        uint64_t bufferAlignment,
+                        MemoryAllocator* resourceHeapAllocator = nullptr);
+        ~BufferAllocator() override;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t allocationSize,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
 
         uint64_t GetMemorySize() const override;
         uint64_t GetMemoryAlignment() const override;
 
       private:
+        std::unique_ptr<MemoryAllocation> TryAllocatePlacedBuffer(
+            const D3D12_RESOURCE_DESC& resourceDescriptor,
+            const MEMORY_ALLOCATION_REQUEST& request);
+
         ResourceAllocator* const mResourceAllocator;
+        MemoryAllocator* const mResourceHeapAllocator;
 
         const D3D12_HEAP_TYPE mHeapType;
         const D3D12_RESOURCE_FLAGS mResourceFlags;
         const D3D12_RESOURCE_STATES mInitialResourceState;
         const uint64_t mBufferSize;
         const uint64_t mBufferAlignment;
+
+        // Allocation of the resource heap of every placed buffer, by heap.
+        FlatPointerMap<std::unique_ptr<MemoryAllocation>> mResourceHeapAllocations;
     };
 
 }}  // namespace gpgmm::d3d12
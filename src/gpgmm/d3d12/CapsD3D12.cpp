@@ -14,6 +14,8 @@
 
 #include "gpgmm/d3d12/CapsD3D12.h"
 
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/d3d12/DefaultsD3D12.h"
 #include "gpgmm/d3d12/ErrorD3D12.h"
 
 #include <cmath>
@@ -21,6 +23,54 @@
 
 namespace gpgmm { namespace d3d12 {
 
+    namespace {
+
+        constexpr uint64_t kMB = 1024ll * 1024ll;
+        constexpr uint64_t kGB = 1024ll * kMB;
+
+        // Resource heap tuning of discrete adapters with at least |MinDedicatedVideoMemory|,
+        // ordered so the first matching entry is used. Zero |VendorID| matches any vendor.
+        struct ResourceHeapTuning {
+            uint32_t VendorID;
+            uint64_t MinDedicatedVideoMemory;
+            uint64_t PreferredResourceHeapSize;
+            double ResourceFragmentationLimit;
+        };
+
+        constexpr ResourceHeapTuning kResourceHeapTunings[] = {
+            {kNvidia_VkVendor, 12 * kGB, 64 * kMB, kDefaultFragmentationLimit},
+            {kAMD_VkVendor, 12 * kGB, 64 * kMB, kDefaultFragmentationLimit},
+            {0, 12 * kGB, 32 * kMB, kDefaultFragmentationLimit},
+            {0, 4 * kGB, 16 * kMB, kDefaultFragmentationLimit},
+            {0, 1 * kGB, 8 * kMB, kDefaultFragmentationLimit},
+            {0, 0, kDefaultPreferredResourceHeapSize, kDefaultFragmentationLimit},
+        };
+
+        // Video memory of UMA adapters is system memory, which other processes also need, so it is
+        // never wasted on larger heaps or looser slabs.
+        constexpr ResourceHeapTuning kUMAResourceHeapTuning = {
+            0, 0, kDefaultPreferredResourceHeapSize, kDefaultFragmentationLimit / 2};
+
+        const ResourceHeapTuning& GetResourceHeapTuning(uint32_t vendorID,
+                                                        uint64_t dedicatedVideoMemorySize,
+                                                        bool isUMA) {
+            if (isUMA) {
+                return kUMAResourceHeapTuning;
+            }
+
+            for (const ResourceHeapTuning& tuning : kResourceHeapTunings) {
+                if ((tuning.VendorID == 0 || tuning.VendorID == vendorID) &&
+                    dedicatedVideoMemorySize >= tuning.MinDedicatedVideoMemory) {
+                    return tuning;
+                }
+            }
+
+            UNREACHABLE();
+            return kResourceHeapTunings[0];
+        }
+
+    }  // namespace
+
     HRESULT SetMaxResourceSize(ID3D12Device* device, uint64_t* sizeOut) {
         D3D12_FEATURE_DATA_GPU_VIRTUAL_ADDRESS_SUPPORT feature = {};
         ReturnIfFailed(
@@ -41,6 +91,41 @@ namespace gpgmm { namespace d3d12 {
         return S_OK;
     }
 
+    HRESULT SetArchitecture(ID3D12Device* device, bool* isUMAOut, bool* isCacheCoherentUMAOut) {
+        // D3D12_FEATURE_ARCHITECTURE1 requires a newer runtime, which older ones do not know.
+        D3D12_FEATURE_DATA_ARCHITECTURE1 feature1 = {};
+        if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE1, &feature1,
+                                                  sizeof(D3D12_FEATURE_DATA_ARCHITECTURE1)))) {
+            *isUMAOut = feature1.UMA;
+            *isCacheCoherentUMAOut = feature1.UMA && feature1.CacheCoherentUMA;
+            return S_OK;
+        }
+
+        D3D12_FEATURE_DATA_ARCHITECTURE feature = {};
+        ReturnIfFailed(device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &feature,
+                                                   sizeof(D3D12_FEATURE_DATA_ARCHITECTURE)));
+
+        *isUMAOut = feature.UMA;
+        *isCacheCoherentUMAOut = feature.UMA && feature.CacheCoherentUMA;
+        return S_OK;
+    }
+
+    // D3D12_HEAP_FLAG_CREATE_NOT_ZEROED is only known by runtimes which expose ID3D12Device8.
+    void SetIsCreateNotZeroedSupported(ID3D12Device* device, bool* isSupportedOut) {
+        ComPtr<ID3D12Device8> device8;
+        *isSupportedOut = SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&device8)));
+    }
+
+    // Runtimes which do not know D3D12_FEATURE_D3D12_OPTIONS16 fail the check, so do not support
+    // it either.
+    void SetIsGPUUploadHeapSupported(ID3D12Device* device, bool* isSupportedOut) {
+        FEATURE_DATA_D3D12_OPTIONS16 feature = {};
+        *isSupportedOut =
+            SUCCEEDED(device->CheckFeatureSupport(kFeatureD3D12Options16, &feature,
+                                                  sizeof(FEATURE_DATA_D3D12_OPTIONS16))) &&
+            feature.GPUUploadHeapSupported;
+    }
+
     // static
     HRESULT Caps::CreateCaps(ID3D12Device* device, IDXGIAdapter* adapter, Caps** capsOut) {
         DXGI_ADAPTER_DESC adapterDesc;
@@ -49,6 +134,17 @@ namespace gpgmm { namespace d3d12 {
         Caps* caps = new Caps();
         ReturnIfFailed(SetMaxResourceSize(device, &caps->mMaxResourceSize));
         ReturnIfFailed(SetMaxResourceHeapSize(device, &caps->mMaxResourceHeapSize));
+        ReturnIfFailed(SetArchitecture(device, &caps->mIsUMA, &caps->mIsCacheCoherentUMA));
+
+        SetIsCreateNotZeroedSupported(device, &caps->mIsCreateNotZeroedSupported);
+        SetIsGPUUploadHeapSupported(device, &caps->mIsGPUUploadHeapSupported);
+        caps->mVendorID = adapterDesc.VendorId;
+        caps->mDedicatedVideoMemorySize = adapterDesc.DedicatedVideoMemory;
+
+        const ResourceHeapTuning& tuning = GetResourceHeapTuning(
+            caps->mVendorID, caps->mDedicatedVideoMemorySize, caps->mIsUMA);
+        caps->mPreferredResourceHeapSize = tuning.PreferredResourceHeapSize;
+        caps->mResourceFragmentationLimit = tuning.ResourceFragmentationLimit;
 
         *capsOut = caps;
         return S_OK;
@@ -62,4 +158,41 @@ namespace gpgmm { namespace d3d12 {
         return mMaxResourceHeapSize;
     }
 
+    bool Caps::IsCacheCoherentUMA() const {
+        return mIsCacheCoherentUMA;
+    }
+
+    bool Caps::IsUMA() const {
+        return mIsUMA;
+    }
+
+    bool Caps::IsCreateNotZeroedSupported() const {
+        return mIsCreateNotZeroedSupported;
+    }
+
+    bool Caps::IsGPUUploadHeapSupported() const {
+        return mIsGPUUploadHeapSupported;
+    }
+
+    uint32_t Caps::GetVendorID() const {
+        return mVendorID;
+    }
+
+    uint64_t Caps::GetDedicatedVideoMemorySize() const {
+        return mDedicatedVideoMemorySize;
+    }
+
+    uint64_t Caps::GetPreferredResourceHeapSize(D3D12_HEAP_TYPE heapType) const {
+        // Upload and readback heaps of discrete adapters are in system memory, and mostly hold
+        // short-lived staging resources. GPU upload heaps are in video memory.
+        if (!mIsUMA && heapType != D3D12_HEAP_TYPE_DEFAULT && heapType != kHeapTypeGPUUpload) {
+            return kDefaultPreferredResourceHeapSize;
+        }
+        return mPreferredResourceHeapSize;
+    }
+
+    double Caps::GetResourceFragmentationLimit() const {
+        return mResourceFragmentationLimit;
+    }
+
 }}  // namespace gpgmm::d3d12
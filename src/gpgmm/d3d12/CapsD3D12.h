@@ -32,11 +32,48 @@ namespace gpgmm { namespace d3d12 {
         // Largest resource heap that this device can make available.
         uint64_t GetMaxResourceHeapSize() const;
 
+        // Whether CPU caches are coherent with the GPU on a UMA adapter, which allows CPU-visible
+        // heaps to use write-back pages.
+        bool IsCacheCoherentUMA() const;
+
+        // Whether the adapter shares memory with the CPU, instead of having dedicated video memory.
+        bool IsUMA() const;
+
+        // Whether heaps and committed resources can be created with
+        // D3D12_HEAP_FLAG_CREATE_NOT_ZEROED.
+        bool IsCreateNotZeroedSupported() const;
+
+        // Whether resources can be created in heaps of kHeapTypeGPUUpload, which the CPU writes
+        // directly into video memory.
+        bool IsGPUUploadHeapSupported() const;
+
+        // PCI ID of the adapter's vendor, see GPUVendor.
+        uint32_t GetVendorID() const;
+
+        // Video memory which is not shared with the CPU.
+        uint64_t GetDedicatedVideoMemorySize() const;
+
+        // Resource heap size which sub-allocates resources of |heapType| best on this adapter.
+        // Adapters with more video memory prefer larger heaps, which are fewer to create and make
+        // resident. Heaps in system memory keep the default size.
+        uint64_t GetPreferredResourceHeapSize(D3D12_HEAP_TYPE heapType) const;
+
+        // Internal fragmentation which slab-allocated resources are allowed on this adapter.
+        double GetResourceFragmentationLimit() const;
+
       private:
         Caps() = default;
 
         uint64_t mMaxResourceSize = 0;
         uint64_t mMaxResourceHeapSize = 0;
+        bool mIsUMA = false;
+        bool mIsCacheCoherentUMA = false;
+        bool mIsCreateNotZeroedSupported = false;
+        bool mIsGPUUploadHeapSupported = false;
+        uint32_t mVendorID = 0;
+        uint64_t mDedicatedVideoMemorySize = 0;
+        uint64_t mPreferredResourceHeapSize = 0;
+        double mResourceFragmentationLimit = 0;
     };
 
 }}  // namespace gpgmm::d3d12
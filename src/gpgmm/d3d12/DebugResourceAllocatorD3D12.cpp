@@ -21,60 +21,131 @@
 #include "gpgmm/d3d12/JSONSerializerD3D12.h"
 #include "gpgmm/d3d12/ResourceAllocationD3D12.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 namespace gpgmm { namespace d3d12 {
 
-    DebugResourceAllocator::ResourceAllocationEntry::ResourceAllocationEntry(
-        ResourceAllocation* allocation)
-        : mAllocation(allocation) {
-    }
+    namespace {
 
-    DebugResourceAllocator::ResourceAllocationEntry::ResourceAllocationEntry(
-        ResourceAllocation* allocation,
-        MemoryAllocator* allocator)
-        : mAllocation(allocation), mAllocator(allocator) {
-    }
+        struct CALL_SITE_INFO {
+            const void* CallSite;
+            uint64_t Count;
+            uint64_t SizeInBytes;
+        };
 
-    MemoryAllocator* DebugResourceAllocator::ResourceAllocationEntry::GetAllocator() const {
-        return mAllocator;
-    }
+    }  // namespace
 
-    ResourceAllocation* DebugResourceAllocator::ResourceAllocationEntry::GetAllocation() const {
-        return mAllocation;
+    void DebugResourceAllocator::ReportLiveAllocations() const {
+        for (const LiveAllocationShard& shard : mLiveAllocationShards) {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Allocations.ForEach([](const void* key, const LiveAllocation& liveAllocation) {
+                const ResourceAllocation* allocation = static_cast<const ResourceAllocation*>(key);
+                gpgmm::WarningLog()
+                    << "Live ResourceAllocation: "
+                    << "Addr=" << ToString(allocation) << ", "
+                    << "ExtRef=" << allocation->GetRefCount() << ", "
+                    << "CallSite=" << ToString(liveAllocation.CallSite) << ", "
+                    << "Info=" << JSONSerializer::Serialize(allocation->GetInfo()).ToString();
+            });
+        }
     }
 
-    size_t DebugResourceAllocator::ResourceAllocationEntry::GetKey() const {
-        return reinterpret_cast<uintptr_t>(mAllocation);
+    void DebugResourceAllocator::ReportLiveAllocationsByCallSite() const {
+        std::unordered_map<const void*, CALL_SITE_INFO> callSites;
+        for (const LiveAllocationShard& shard : mLiveAllocationShards) {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Allocations.ForEach([&](const void* key, const LiveAllocation& liveAllocation) {
+                const ResourceAllocation* allocation = static_cast<const ResourceAllocation*>(key);
+                CALL_SITE_INFO& info = callSites[liveAllocation.CallSite];
+                info.CallSite = liveAllocation.CallSite;
+                info.Count++;
+                info.SizeInBytes += allocation->GetSize();
+            });
+        }
+
+        std::vector<CALL_SITE_INFO> sortedCallSites;
+        sortedCallSites.reserve(callSites.size());
+        for (const auto& callSite : callSites) {
+            sortedCallSites.push_back(callSite.second);
+        }
+
+        std::sort(sortedCallSites.begin(), sortedCallSites.end(),
+                  [](const CALL_SITE_INFO& a, const CALL_SITE_INFO& b) {
+                      return a.SizeInBytes > b.SizeInBytes;
+                  });
+
+        for (const CALL_SITE_INFO& info : sortedCallSites) {
+            gpgmm::InfoLog() << "Live ResourceAllocations by call site: "
+                             << "CallSite=" << ToString(info.CallSite) << ", "
+                             << "Count=" << info.Count << ", "
+                             << "SizeInBytes=" << info.SizeInBytes;
+        }
     }
 
-    void DebugResourceAllocator::ReportLiveAllocations() const {
-        for (auto allocationEntry : mLiveAllocations) {
-            const ResourceAllocation* allocation = allocationEntry->GetValue().GetAllocation();
-            gpgmm::WarningLog() << "Live ResourceAllocation: "
-                                << "Addr=" << ToString(allocation) << ", "
-                                << "ExtRef=" << allocation->GetRefCount() << ", "
-                                << "Info="
-                                << JSONSerializer::Serialize(allocation->GetInfo()).ToString();
+    void DebugResourceAllocator::ForEachLiveAllocation(
+        const std::function<void(const ResourceAllocation*)>& fn) const {
+        for (const LiveAllocationShard& shard : mLiveAllocationShards) {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Allocations.ForEach([&](const void* key, const LiveAllocation&) {
+                fn(static_cast<const ResourceAllocation*>(key));
+            });
         }
     }
 
-    void DebugResourceAllocator::AddLiveAllocation(ResourceAllocation* allocation) {
-        mLiveAllocations.GetOrCreate(
-            ResourceAllocationEntry(allocation, allocation->GetAllocator()), true);
+    void DebugResourceAllocator::AddLiveAllocation(ResourceAllocation* allocation,
+                                                   const void* callSite) {
+        {
+            LiveAllocationShard& shard = GetShard(allocation);
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+
+            LiveAllocation liveAllocation = {};
+            liveAllocation.Allocator = allocation->GetAllocator();
+            liveAllocation.CallSite = callSite;
+
+            const bool success = shard.Allocations.Insert(allocation, liveAllocation);
+            ASSERT(success);
+        }
 
-        // Inject |this| allocator so DeallocateMemory shrinks the cache.
+        // Inject |this| allocator so DeallocateMemory stops tracking the allocation.
         allocation->SetAllocator(this);
     }
 
     void DebugResourceAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
-        // KeepAlive must be false so |mLiveAllocations| cache will shrink by 1 entry once |entry|
-        // falls out of scope below since AddLiveAllocation() adds one (and only one) ref.
-        auto entry = mLiveAllocations.GetOrCreate(
-            ResourceAllocationEntry(ToBackend(allocation.get())), false);
+        LiveAllocation liveAllocation = {};
+        {
+            ResourceAllocation* resourceAllocation = ToBackend(allocation.get());
+            LiveAllocationShard& shard = GetShard(resourceAllocation);
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+
+            const bool success = shard.Allocations.Remove(resourceAllocation, &liveAllocation);
+            ASSERT(success);
+        }
 
-        entry->Unref();
-        ASSERT(entry->HasOneRef());
+        liveAllocation.Allocator->DeallocateMemory(std::move(allocation));
+    }
+
+    bool DebugResourceAllocator::TryExtendMemory(MemoryAllocation* allocation, uint64_t size) {
+        MemoryAllocator* allocator = nullptr;
+        {
+            ResourceAllocation* resourceAllocation = ToBackend(allocation);
+            LiveAllocationShard& shard = GetShard(resourceAllocation);
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+
+            const LiveAllocation* liveAllocation = shard.Allocations.Find(resourceAllocation);
+            ASSERT(liveAllocation != nullptr);
+            allocator = liveAllocation->Allocator;
+        }
+
+        return allocator->TryExtendMemory(allocation, size);
+    }
 
-        entry->GetValue().GetAllocator()->DeallocateMemory(std::move(allocation));
+    DebugResourceAllocator::LiveAllocationShard& DebugResourceAllocator::GetShard(
+        const ResourceAllocation* allocation) {
+        // Allocations are aligned heap addresses, so the low bits are skipped.
+        const uintptr_t address = reinterpret_cast<uintptr_t>(allocation);
+        return mLiveAllocationShards[(address >> 6) % kLiveAllocationShardCount];
     }
 
 }}  // namespace gpgmm::d3d12
@@ -16,39 +16,55 @@
 #define GPGMM_D3D12_DEBUGRESOURCEALLOCATORD3D12_H_
 
 #include "gpgmm/MemoryAllocator.h"
-#include "gpgmm/MemoryCache.h"
+#include "gpgmm/common/FlatPointerMap.h"
+
+#include <array>
+#include <functional>
+#include <mutex>
 
 namespace gpgmm { namespace d3d12 {
 
     class ResourceAllocation;
 
     // DebugResourceAllocator tracks live allocations (ie. created allocations, not yet
-    // deallocated) so they can be reported if leaked.
+    // deallocated) so they can be reported if leaked, or by the call site that created them.
     class DebugResourceAllocator final : public MemoryAllocator {
       public:
         DebugResourceAllocator() = default;
 
-        void AddLiveAllocation(ResourceAllocation* allocation);
+        // |callSite| is the return address of the call which created |allocation|.
+        void AddLiveAllocation(ResourceAllocation* allocation, const void* callSite);
         void ReportLiveAllocations() const;
 
+        // Logs the count and size of live allocations of each call site, largest first. Only
+        // one shard is locked at a time, so allocating and deallocating can continue meanwhile.
+        void ReportLiveAllocationsByCallSite() const;
+
+        // Calls |fn| for every live allocation. Only one shard is locked at a time, so the
+        // allocation is only guaranteed to be alive while |fn| is called.
+        void ForEachLiveAllocation(const std::function<void(const ResourceAllocation*)>& fn) const;
+
       private:
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+        bool TryExtendMemory(MemoryAllocation* allocation, uint64_t size) override;
 
-        class ResourceAllocationEntry {
-          public:
-            explicit ResourceAllocationEntry(ResourceAllocation* allocation);  // For lookup
-            ResourceAllocationEntry(ResourceAllocation* allocation, MemoryAllocator* allocator);
-
-            MemoryAllocator* GetAllocator() const;
-            ResourceAllocation* GetAllocation() const;
-            size_t GetKey() const;
+        struct LiveAllocation {
+            MemoryAllocator* Allocator = nullptr;
+            const void* CallSite = nullptr;
+        };
 
-          private:
-            ResourceAllocation* mAllocation = nullptr;
-            MemoryAllocator* mAllocator = nullptr;
+        // Live allocations are split by address between shards, each with its own lock, so
+        // allocations of different threads can be tracked without sharing a lock.
+        struct LiveAllocationShard {
+            mutable std::mutex Mutex;
+            FlatPointerMap<LiveAllocation> Allocations;
         };
 
-        MemoryCache<ResourceAllocationEntry> mLiveAllocations = {};
+        static constexpr size_t kLiveAllocationShardCount = 16;
+
+        LiveAllocationShard& GetShard(const ResourceAllocation* allocation);
+
+        std::array<LiveAllocationShard, kLiveAllocationShardCount> mLiveAllocationShards;
     };
 
 }}  // namespace gpgmm::d3d12
@@ -22,6 +22,11 @@ namespace gpgmm { namespace d3d12 {
     static constexpr uint64_t kDefaultPreferredResourceHeapSize = 4ll * 1024ll * 1024ll;  // 4MB
     static constexpr uint32_t kDefaultVideoMemoryEvictSize = 50ll * 1024ll * 1024ll;      // 50MB
     static constexpr float kDefaultMaxVideoMemoryBudget = 0.95f;                          // 95%
+    static constexpr uint32_t kDefaultVideoMemoryInfoRefreshMs = 1000;                    // 1s
+    static constexpr uint64_t kDefaultTransientBufferSize = 4ll * 1024ll * 1024ll;        // 4MB
+    static constexpr uint64_t kDefaultMaxBufferSlabSize = 4ll * 1024ll * 1024ll;          // 4MB
+    static constexpr double kDefaultMemoryPressureYellowThreshold = 0.80;                 // 80%
+    static constexpr double kDefaultSharedStatsIntervalInSeconds = 0.1;                   // 100ms
 
 }}  // namespace gpgmm::d3d12
 
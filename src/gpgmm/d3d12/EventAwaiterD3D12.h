@@ -0,0 +1,82 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_EVENTAWAITERD3D12_H_
+#define GPGMM_D3D12_EVENTAWAITERD3D12_H_
+
+// Optional header, see gpgmm/EventAwaiter.h.
+#include "gpgmm/EventAwaiter.h"
+
+#if defined(GPGMM_HAS_COROUTINES)
+
+#    include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+
+namespace gpgmm { namespace d3d12 {
+
+    struct CREATE_RESOURCE_RESULT {
+        // Result of CreateResourceAsync, or of CreateResource once the resource was created.
+        HRESULT Result = E_PENDING;
+
+        Microsoft::WRL::ComPtr<ResourceAllocation> Allocation;
+    };
+
+    // co_await creates the resource on a background thread, like CreateResourceAsync, and
+    // returns it once created. Thousands can be awaited at once since no thread blocks while
+    // the coroutine is suspended. The coroutine is resumed by |scheduler|, or by the thread
+    // which created the resource if nullptr.
+    class CreateResourceAwaiter final {
+      public:
+        CreateResourceAwaiter(ResourceAllocator* resourceAllocator,
+                              const ALLOCATION_DESC& allocationDescriptor,
+                              const D3D12_RESOURCE_DESC& resourceDescriptor,
+                              D3D12_RESOURCE_STATES initialResourceState,
+                              const D3D12_CLEAR_VALUE* clearValue,
+                              TaskScheduler* scheduler = nullptr)
+            : mScheduler(scheduler) {
+            mResult = resourceAllocator->CreateResourceAsync(allocationDescriptor,
+                                                             resourceDescriptor,
+                                                             initialResourceState, clearValue,
+                                                             &mEvent);
+        }
+
+        // Does not suspend should CreateResourceAsync have failed.
+        bool await_ready() const {
+            return FAILED(mResult) || mEvent->IsSignaled();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            mEvent->AddSignaledCallback(std::make_shared<ResumeCoroutineTask>(handle, mScheduler));
+        }
+
+        CREATE_RESOURCE_RESULT await_resume() {
+            CREATE_RESOURCE_RESULT result = {};
+            result.Result = mResult;
+            if (SUCCEEDED(mResult)) {
+                result.Result = mEvent->AcquireResourceAllocation(&result.Allocation);
+            }
+            return result;
+        }
+
+      private:
+        TaskScheduler* const mScheduler;
+
+        HRESULT mResult = E_PENDING;
+        std::shared_ptr<ResourceAllocationEvent> mEvent;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // defined(GPGMM_HAS_COROUTINES)
+
+#endif  // GPGMM_D3D12_EVENTAWAITERD3D12_H_
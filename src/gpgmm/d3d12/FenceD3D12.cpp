@@ -19,6 +19,27 @@
 
 namespace gpgmm { namespace d3d12 {
 
+    namespace {
+
+        // Waits made outside of a fence re-use one event per thread, rather than having
+        // SetEventOnCompletion create (and destroy) one per wait.
+        HANDLE GetThreadCompletionEvent() {
+            struct ScopedEvent {
+                ScopedEvent() : Handle(CreateEvent(nullptr, false, false, nullptr)) {
+                }
+                ~ScopedEvent() {
+                    if (Handle != nullptr) {
+                        CloseHandle(Handle);
+                    }
+                }
+                HANDLE Handle;
+            };
+            static thread_local ScopedEvent tlsCompletionEvent;
+            return tlsCompletionEvent.Handle;
+        }
+
+    }  // namespace
+
     // static
     HRESULT Fence::CreateFence(ComPtr<ID3D12Device> device,
                                uint64_t initialValue,
@@ -68,6 +89,64 @@ namespace gpgmm { namespace d3d12 {
         return S_OK;
     }
 
+    HRESULT Fence::WaitForCompletion(uint64_t fenceValue) const {
+        if (fenceValue <= mFence->GetCompletedValue()) {
+            return S_OK;
+        }
+
+        HANDLE completionEvent = GetThreadCompletionEvent();
+        if (completionEvent == nullptr) {
+            // Without an event, SetEventOnCompletion blocks until the fence value completes.
+            return mFence->SetEventOnCompletion(fenceValue, nullptr);
+        }
+
+        ReturnIfFailed(mFence->SetEventOnCompletion(fenceValue, completionEvent));
+        const uint32_t result = WaitForSingleObject(completionEvent, INFINITE);
+        ASSERT(result == 0);
+        return S_OK;
+    }
+
+    // static
+    HRESULT Fence::WaitForAll(ID3D12Device* device, const std::vector<FenceValue>& fenceValues) {
+        std::vector<ID3D12Fence*> fencesToWaitFor;
+        std::vector<uint64_t> fenceValuesToWaitFor;
+        for (const FenceValue& fenceValue : fenceValues) {
+            if (!fenceValue.first->IsCompleted(fenceValue.second)) {
+                fencesToWaitFor.push_back(fenceValue.first->mFence.Get());
+                fenceValuesToWaitFor.push_back(fenceValue.second);
+            }
+        }
+
+        if (fencesToWaitFor.empty()) {
+            return S_OK;
+        }
+
+        ComPtr<ID3D12Device1> device1;
+        HANDLE completionEvent = GetThreadCompletionEvent();
+        if (fencesToWaitFor.size() == 1 || completionEvent == nullptr ||
+            FAILED(device->QueryInterface(IID_PPV_ARGS(&device1)))) {
+            for (const FenceValue& fenceValue : fenceValues) {
+                ReturnIfFailed(fenceValue.first->WaitFor(fenceValue.second));
+            }
+            return S_OK;
+        }
+
+        ReturnIfFailed(device1->SetEventOnMultipleFenceCompletion(
+            fencesToWaitFor.data(), fenceValuesToWaitFor.data(),
+            static_cast<UINT>(fencesToWaitFor.size()), D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL,
+            completionEvent));
+
+        const uint32_t result = WaitForSingleObject(completionEvent, INFINITE);
+        ASSERT(result == 0);
+
+        // Update the latest completed fence values.
+        for (const FenceValue& fenceValue : fenceValues) {
+            fenceValue.first->GetAndCacheLastCompletedFence();
+        }
+
+        return S_OK;
+    }
+
     bool Fence::IsCompleted(uint64_t fenceValue) {
         if (fenceValue <= mLastCompletedFence) {
             return true;
@@ -75,6 +154,10 @@ namespace gpgmm { namespace d3d12 {
         return fenceValue <= GetAndCacheLastCompletedFence();
     }
 
+    uint64_t Fence::GetCompletedValue() {
+        return GetAndCacheLastCompletedFence();
+    }
+
     uint64_t Fence::GetAndCacheLastCompletedFence() {
         mLastCompletedFence = mFence->GetCompletedValue();
         return mLastCompletedFence;
@@ -88,6 +171,21 @@ namespace gpgmm { namespace d3d12 {
         return S_OK;
     }
 
+    HRESULT Fence::EnqueueMakeResident(ID3D12Device3* device,
+                                       uint32_t numObjects,
+                                       ID3D12Pageable* const* objects) {
+        ASSERT(mLastSignaledFence != mCurrentFence);
+        ReturnIfFailed(device->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE, numObjects, objects,
+                                                   mFence.Get(), mCurrentFence));
+        mLastSignaledFence = mCurrentFence;
+        mCurrentFence++;
+        return S_OK;
+    }
+
+    HRESULT Fence::Wait(ID3D12CommandQueue* pCommandQueue) const {
+        return pCommandQueue->Wait(mFence.Get(), mLastSignaledFence);
+    }
+
     uint64_t Fence::GetLastSignaledFence() const {
         return mLastSignaledFence;
     }
@@ -18,6 +18,8 @@
 #include "gpgmm/d3d12/d3d12_platform.h"
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace gpgmm { namespace d3d12 {
 
@@ -29,16 +31,40 @@ namespace gpgmm { namespace d3d12 {
 
         ~Fence();
 
+        using FenceValue = std::pair<Fence*, uint64_t>;
+
+        // Blocks the calling thread until every fence value completes, using a single wait
+        // regardless of how many fences are given.
+        static HRESULT WaitForAll(ID3D12Device* device, const std::vector<FenceValue>& fenceValues);
+
         HRESULT WaitFor(uint64_t fenceValue);
         HRESULT Signal(ID3D12CommandQueue* pCommandQueue);
 
+        // Makes |objects| resident without blocking the calling thread, where the fence is
+        // signaled once paging completes.
+        HRESULT EnqueueMakeResident(ID3D12Device3* device,
+                                    uint32_t numObjects,
+                                    ID3D12Pageable* const* objects);
+
+        // Makes the queue wait, on the GPU, for the last signaled fence value.
+        HRESULT Wait(ID3D12CommandQueue* pCommandQueue) const;
+
+        // Blocks the calling thread until the fence value completes. Unlike WaitFor, no state is
+        // updated so it may be called from any thread without synchronization.
+        HRESULT WaitForCompletion(uint64_t fenceValue) const;
+
+        // Checks if the fence value completed without waiting for it.
+        bool IsCompleted(uint64_t fenceValue);
+
+        // Returns the last completed fence value without waiting.
+        uint64_t GetCompletedValue();
+
         uint64_t GetLastSignaledFence() const;
         uint64_t GetCurrentFence() const;
 
       private:
         Fence(ComPtr<ID3D12Fence> fence, uint64_t initialValue);
 
-        bool IsCompleted(uint64_t fenceValue);
         uint64_t GetAndCacheLastCompletedFence();
 
         ComPtr<ID3D12Fence> mFence;
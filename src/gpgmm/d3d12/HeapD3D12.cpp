@@ -17,16 +17,18 @@
 
 #include "gpgmm/Debug.h"
 #include "gpgmm/d3d12/JSONSerializerD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
 #include "gpgmm/d3d12/ResidencySetD3D12.h"
 
 namespace gpgmm { namespace d3d12 {
     Heap::Heap(ComPtr<ID3D12Pageable> pageable,
                const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
-               uint64_t size)
+               uint64_t size,
+               D3D12_RESIDENCY_PRIORITY residencyPriority)
         : MemoryBase(size),
           mPageable(std::move(pageable)),
           mMemorySegmentGroup(memorySegmentGroup),
-          mResidencyLock(0) {
+          mResidencyPriority(residencyPriority) {
         ASSERT(mPageable != nullptr);
 
         GPGMM_TRACE_EVENT_OBJECT_NEW(this);
@@ -43,6 +45,18 @@ namespace gpgmm { namespace d3d12 {
             RemoveFromList();
         }
 
+        if (mSubmissionHistoryOwner != nullptr) {
+            mSubmissionHistoryOwner->RemoveFromSubmissionHistory(this);
+        }
+
+        if (mOfferedBy != nullptr) {
+            mOfferedBy->ReclaimOfferedHeap(this);
+        }
+
+        if (mSharedHandle != nullptr) {
+            CloseHandle(mSharedHandle);
+        }
+
         GPGMM_TRACE_EVENT_OBJECT_DESTROY(this);
     }
 
@@ -54,18 +68,68 @@ namespace gpgmm { namespace d3d12 {
         return mPageable;
     }
 
+    ComPtr<ID3D12Resource> Heap::GetPlacedBuffer() const {
+        return mPlacedBuffer;
+    }
+
+    void Heap::SetPlacedBuffer(ComPtr<ID3D12Resource> placedBuffer) {
+        mPlacedBuffer = std::move(placedBuffer);
+    }
+
+    HANDLE Heap::GetSharedHandle() const {
+        return mSharedHandle;
+    }
+
+    void Heap::SetSharedHandle(HANDLE sharedHandle) {
+        ASSERT(mSharedHandle == nullptr);
+        mSharedHandle = sharedHandle;
+    }
+
     ID3D12Heap* Heap::GetHeap() const {
         ComPtr<ID3D12Heap> heap;
         mPageable.As(&heap);
         return heap.Get();
     }
 
-    uint64_t Heap::GetLastUsedFenceValue() const {
-        return mLastUsedFenceValue;
+    const std::vector<Heap::FenceValue>& Heap::GetLastUsedFenceValues() const {
+        return mLastUsedFenceValues;
+    }
+
+    void Heap::SetLastUsedFenceValue(Fence* fence, uint64_t fenceValue) {
+        for (FenceValue& lastUsedFenceValue : mLastUsedFenceValues) {
+            if (lastUsedFenceValue.first == fence) {
+                lastUsedFenceValue.second = fenceValue;
+                return;
+            }
+        }
+        mLastUsedFenceValues.push_back({fence, fenceValue});
+    }
+
+    uint64_t Heap::GetAccessCount() const {
+        return mAccessCount;
+    }
+
+    void Heap::IncrementAccessCount() {
+        mAccessCount++;
+    }
+
+    void Heap::DecayAccessCount() {
+        mAccessCount /= 2;
     }
 
-    void Heap::SetLastUsedFenceValue(uint64_t fenceValue) {
-        mLastUsedFenceValue = fenceValue;
+    D3D12_RESIDENCY_PRIORITY Heap::GetResidencyPriority() const {
+        return static_cast<D3D12_RESIDENCY_PRIORITY>(mResidencyPriority.load());
+    }
+
+    HRESULT Heap::SetResidencyPriority(ID3D12Device1* device, D3D12_RESIDENCY_PRIORITY priority) {
+        uint32_t currentPriority = mResidencyPriority.load();
+        while (static_cast<uint32_t>(priority) > currentPriority) {
+            if (mResidencyPriority.compare_exchange_weak(currentPriority, priority)) {
+                ID3D12Pageable* pageable = mPageable.Get();
+                return device->SetResidencyPriority(1, &pageable, &priority);
+            }
+        }
+        return S_OK;
     }
 
     DXGI_MEMORY_SEGMENT_GROUP Heap::GetMemorySegmentGroup() const {
@@ -77,26 +141,61 @@ namespace gpgmm { namespace d3d12 {
     }
 
     void Heap::AddResidencyLockRef() {
-        mResidencyLock.Ref();
+        mResidencyLockCount.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    bool Heap::ReleaseResidencyLock() {
+        // A concurrent TryAddResidencyLockRef either adds its lock first, so the heap stays
+        // locked, or sees no lock and fails.
+        return mResidencyLockCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
     }
 
-    void Heap::ReleaseResidencyLock() {
-        mResidencyLock.Unref();
+    bool Heap::TryAddResidencyLockRef() {
+        uint32_t lockCount = mResidencyLockCount.load(std::memory_order_relaxed);
+        while (lockCount > 0) {
+            if (mResidencyLockCount.compare_exchange_weak(lockCount, lockCount + 1,
+                                                          std::memory_order_acquire,
+                                                          std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Heap::TryReleaseResidencyLock() {
+        uint32_t lockCount = mResidencyLockCount.load(std::memory_order_relaxed);
+        while (lockCount > 1) {
+            if (mResidencyLockCount.compare_exchange_weak(lockCount, lockCount - 1,
+                                                          std::memory_order_release,
+                                                          std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
     }
 
     bool Heap::IsResidencyLocked() const {
-        return mResidencyLock.GetRefCount() > 0;
+        return mResidencyLockCount.load(std::memory_order_acquire) > 0;
     }
 
     bool Heap::IsResident() const {
         return IsInList() || IsResidencyLocked();
     }
 
+    bool Heap::IsEvicted() const {
+        return mIsEvicted.load(std::memory_order_relaxed);
+    }
+
+    void Heap::SetEvicted(bool isEvicted) {
+        mIsEvicted.store(isEvicted, std::memory_order_relaxed);
+    }
+
     HRESULT Heap::UpdateResidency(ResidencySet* residencySet) {
         return residencySet->Insert(this);
     }
 
     HEAP_INFO Heap::GetInfo() const {
-        return {GetSize(), IsResident(), mMemorySegmentGroup, GetRefCount(), GetPool(), GetHeap()};
+        return {GetSize(), IsResident(), mMemorySegmentGroup,    GetRefCount(),
+                GetPool(), GetHeap(),    mAccessCount,           GetResidencyPriority()};
     }
 }}  // namespace gpgmm::d3d12
@@ -22,13 +22,19 @@
 #include "gpgmm/d3d12/d3d12_platform.h"
 #include "include/gpgmm_export.h"
 
+#include <atomic>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace gpgmm { namespace d3d12 {
 
+    class BufferAllocator;
+    class Fence;
     class ResidencySet;
     class ResidencyManager;
     class ResourceAllocator;
+    class ResourceHeapAllocator;
 
     struct HEAP_INFO {
         uint64_t SizeInBytes;
@@ -37,6 +43,8 @@ namespace gpgmm { namespace d3d12 {
         int SubAllocatedRefs;
         MemoryPool* MemoryPool;
         ID3D12Heap* Heap;
+        uint64_t AccessCount;
+        D3D12_RESIDENCY_PRIORITY ResidencyPriority;
     };
 
     // This class is used to represent ID3D12Heap allocations, as well as an implicit heap
@@ -49,7 +57,8 @@ namespace gpgmm { namespace d3d12 {
       public:
         Heap(ComPtr<ID3D12Pageable> pageable,
              const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
-             uint64_t size);
+             uint64_t size,
+             D3D12_RESIDENCY_PRIORITY residencyPriority = D3D12_RESIDENCY_PRIORITY_NORMAL);
         ~Heap();
 
         ID3D12Heap* GetHeap() const;
@@ -58,37 +67,107 @@ namespace gpgmm { namespace d3d12 {
 
         bool IsResident() const;
 
+        // MemoryBase interface
+        bool IsEvicted() const override;
+
+        D3D12_RESIDENCY_PRIORITY GetResidencyPriority() const;
+
         // Testing only.
         bool IsInResidencyLRUCache() const;
         bool IsResidencyLocked() const;
 
         HEAP_INFO GetInfo() const;
 
+        // NT handle of a heap created with D3D12_HEAP_FLAG_SHARED, created once along with the
+        // heap and closed once released. Null for other heaps.
+        HANDLE GetSharedHandle() const;
+
       private:
+        friend BufferAllocator;
         friend ResidencyManager;
+        friend ResidencySet;
         friend ResourceAllocator;
+        friend ResourceHeapAllocator;
 
         const char* GetTypename() const;
         ComPtr<ID3D12Pageable> GetPageable() const;
         DXGI_MEMORY_SEGMENT_GROUP GetMemorySegmentGroup() const;
 
+        // Buffer placed at the start of the heap by a BufferAllocator, which other buffers are
+        // sub-allocated within. Null unless the heap is used by a BufferAllocator.
+        ComPtr<ID3D12Resource> GetPlacedBuffer() const;
+        void SetPlacedBuffer(ComPtr<ID3D12Resource> placedBuffer);
+
         // The residency manager must know the last fence value that any portion of the pageable was
         // submitted to be used so that we can ensure this pageable stays resident in memory at
-        // least until that fence has completed.
-        uint64_t GetLastUsedFenceValue() const;
-        void SetLastUsedFenceValue(uint64_t fenceValue);
+        // least until that fence has completed. Each queue signals its own fence, so one value
+        // is kept per fence.
+        using FenceValue = std::pair<Fence*, uint64_t>;
+        const std::vector<FenceValue>& GetLastUsedFenceValues() const;
+        void SetLastUsedFenceValue(Fence* fence, uint64_t fenceValue);
+
+        // Number of submissions which used the heap, which decays by half every time heaps are
+        // evicted so the count favors recent use. Used by EVICTION_POLICY_LFU.
+        uint64_t GetAccessCount() const;
+        void IncrementAccessCount();
+        void DecayAccessCount();
+
+        // Raises the residency priority of the heap, which is never lowered since a heap could be
+        // shared by allocations of different priorities. Heaps of lower priority are evicted
+        // first.
+        HRESULT SetResidencyPriority(ID3D12Device1* device, D3D12_RESIDENCY_PRIORITY priority);
 
         // Locks residency to ensure the heap cannot be evicted (ex. shader-visible descriptor
-        // heaps or mapping resources).
+        // heaps or mapping resources). Called with the residency manager locked. Release returns
+        // true once the heap is no longer locked.
         void AddResidencyLockRef();
-        void ReleaseResidencyLock();
+        bool ReleaseResidencyLock();
+
+        // Adds or releases a lock without the residency manager locked, which only succeeds when
+        // the heap stays locked either way, so it remains resident and out of the LRU cache.
+        // Returns false when the residency manager must lock or unlock the heap instead.
+        bool TryAddResidencyLockRef();
+        bool TryReleaseResidencyLock();
+
+        // Set by the residency manager once the heap was evicted, until made resident again, so
+        // allocators can prefer re-using heaps which are still resident.
+        void SetEvicted(bool isEvicted);
+
+        // Takes ownership of the NT handle of the heap.
+        void SetSharedHandle(HANDLE sharedHandle);
 
         ComPtr<ID3D12Pageable> mPageable;
+        ComPtr<ID3D12Resource> mPlacedBuffer;
+        HANDLE mSharedHandle = nullptr;
 
-        // mLastUsedFenceValue denotes the last time this pageable was submitted to the GPU.
-        uint64_t mLastUsedFenceValue = 0;
+        // mLastUsedFenceValues denotes the last time this pageable was submitted to each queue.
+        std::vector<FenceValue> mLastUsedFenceValues;
         DXGI_MEMORY_SEGMENT_GROUP mMemorySegmentGroup;
-        RefCounted mResidencyLock;
+        std::atomic<uint32_t> mResidencyLockCount{0};
+        uint64_t mAccessCount = 0;
+
+        // Set by every submission using the heap, instead of moving it to the end of the LRU
+        // cache, then cleared once the residency manager ages the cache before evicting.
+        // Guarded by the residency manager.
+        bool mIsReferenced = false;
+
+        // Stored unsigned since residency priorities may not fit in the range of the enum.
+        std::atomic<uint32_t> mResidencyPriority;
+
+        // Generation of the residency set this heap was last inserted into.
+        std::atomic<uint64_t> mResidencySetGeneration{0};
+
+        // Read by allocators without holding the residency manager lock.
+        std::atomic<bool> mIsEvicted{false};
+
+        // Residency manager which recorded this heap as used by past submissions, and by how
+        // many, so the heap can be forgotten once released. Guarded by the residency manager.
+        ResidencyManager* mSubmissionHistoryOwner = nullptr;
+        uint32_t mSubmissionHistoryRefs = 0;
+
+        // Residency manager which offered this heap while pooled, until made resident again.
+        // Guarded by the residency manager.
+        ResidencyManager* mOfferedBy = nullptr;
     };
 }}  // namespace gpgmm::d3d12
 
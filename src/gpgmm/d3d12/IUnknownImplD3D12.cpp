@@ -35,19 +35,6 @@ namespace gpgmm { namespace d3d12 {
         return E_NOINTERFACE;
     }
 
-    ULONG IUnknownImpl::AddRef() {
-        Ref();
-        return GetRefCount();
-    }
-
-    ULONG IUnknownImpl::Release() {
-        const ULONG refCount = Unref() ? 0 : GetRefCount();
-        if (refCount == 0) {
-            DeleteThis();
-        }
-        return refCount;
-    }
-
     void IUnknownImpl::DeleteThis() {
         delete this;
     }
@@ -21,6 +21,8 @@
 
 namespace gpgmm { namespace d3d12 {
 
+    // AddRef and Release are called on every ComPtr copy, so they are final and inline: calls
+    // through a derived class need no virtual dispatch and only DeleteThis is virtual.
     class GPGMM_EXPORT IUnknownImpl : public IUnknown, public RefCounted {
       public:
         IUnknownImpl();
@@ -28,8 +30,19 @@ namespace gpgmm { namespace d3d12 {
 
         // IUnknown interface
         HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
-        ULONG STDMETHODCALLTYPE AddRef() override;
-        ULONG STDMETHODCALLTYPE Release() override;
+
+        ULONG STDMETHODCALLTYPE AddRef() final {
+            Ref();
+            return static_cast<ULONG>(GetRefCount());
+        }
+
+        ULONG STDMETHODCALLTYPE Release() final {
+            if (Unref()) {
+                DeleteThis();
+                return 0;
+            }
+            return static_cast<ULONG>(GetRefCount());
+        }
 
         // Derived class may override this if they require a custom deleter.
         virtual void DeleteThis();
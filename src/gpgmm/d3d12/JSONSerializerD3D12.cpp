@@ -34,154 +34,208 @@ namespace gpgmm { namespace d3d12 {
 
     // static
     JSONDict JSONSerializer::Serialize(const ALLOCATOR_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("Flags", desc.Flags);
-        dict.AddItem("RecordOptions", Serialize(desc.RecordOptions));
-        dict.AddItem("IsUMA", desc.IsUMA);
-        dict.AddItem("ResourceHeapTier", desc.ResourceHeapTier);
-        dict.AddItem("PreferredResourceHeapSize", desc.PreferredResourceHeapSize);
-        dict.AddItem("MaxResourceHeapSize", desc.MaxResourceHeapSize);
-        dict.AddItem("MaxResourceSizeForPooling", desc.MaxResourceSizeForPooling);
-        dict.AddItem("MaxVideoMemoryBudget", desc.MaxVideoMemoryBudget);
-        dict.AddItem("TotalResourceBudgetLimit", desc.TotalResourceBudgetLimit);
-        dict.AddItem("VideoMemoryEvictSize", desc.VideoMemoryEvictSize);
-        dict.AddItem("ResourceFragmentationLimit", desc.ResourceFragmentationLimit);
-        return dict;
+        return SerializeToDict<JSONSerializer>(desc);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const CREATE_RESOURCE_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("allocationDescriptor", Serialize(desc.allocationDescriptor));
-        dict.AddItem("resourceDescriptor", Serialize(desc.resourceDescriptor));
-        dict.AddItem("initialResourceState", desc.initialResourceState);
-        dict.AddItem("clearValue", Serialize(desc.clearValue));
-        return dict;
+        return SerializeToDict<JSONSerializer>(desc);
+    }
+
+    // static
+    JSONDict JSONSerializer::Serialize(const QUERY_VIDEO_MEMORY_INFO_DESC& desc) {
+        return SerializeToDict<JSONSerializer>(desc);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const ALLOCATION_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("Flags", desc.Flags);
-        dict.AddItem("HeapType", desc.HeapType);
-        return dict;
+        return SerializeToDict<JSONSerializer>(desc);
     }
 
     // static
     JSONDict JSONSerializer::Serialize(const D3D12_RESOURCE_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("Dimension", desc.Dimension);
-        dict.AddItem("Alignment", desc.Alignment);
-        dict.AddItem("Width", desc.Width);
-        dict.AddItem("Height", desc.Height);
-        dict.AddItem("DepthOrArraySize", desc.DepthOrArraySize);
-        dict.AddItem("MipLevels", desc.MipLevels);
-        dict.AddItem("Format", desc.Format);
-        dict.AddItem("Layout", desc.Layout);
-        dict.AddItem("SampleDesc", Serialize(desc.SampleDesc));
-        dict.AddItem("Flags", desc.Flags);
-        return dict;
+        return SerializeToDict<JSONSerializer>(desc);
+    }
+
+    // static
+    JSONDict JSONSerializer::Serialize(const HEAP_INFO& desc) {
+        return SerializeToDict<JSONSerializer>(desc);
+    }
+
+    // static
+    JSONDict JSONSerializer::Serialize(const RESOURCE_ALLOCATION_INFO& desc) {
+        return SerializeToDict<JSONSerializer>(desc);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const ALLOCATOR_DESC& desc) {
+        writer->AddItem("Flags", desc.Flags);
+        SerializeItem(writer, "RecordOptions", desc.RecordOptions);
+        writer->AddItem("IsUMA", desc.IsUMA);
+        writer->AddItem("ResourceHeapTier", desc.ResourceHeapTier);
+        writer->AddItem("PreferredResourceHeapSize", desc.PreferredResourceHeapSize);
+        writer->AddItem("MaxResourceHeapSize", desc.MaxResourceHeapSize);
+        writer->AddItem("MaxResourceSizeForPooling", desc.MaxResourceSizeForPooling);
+        writer->AddItem("MaxResourceSizeForSubAllocation", desc.MaxResourceSizeForSubAllocation);
+        writer->AddItem("MaxVideoMemoryBudget", desc.MaxVideoMemoryBudget);
+        writer->AddItem("TotalResourceBudgetLimit", desc.TotalResourceBudgetLimit);
+        writer->AddItem("VideoMemoryEvictSize", desc.VideoMemoryEvictSize);
+        writer->AddItem("EvictionPolicy", desc.EvictionPolicy);
+        writer->AddItem("ResidencyPredictionSubmissionCount",
+                        desc.ResidencyPredictionSubmissionCount);
+        writer->AddItem("VideoMemoryReservationSubmissionCount",
+                        desc.VideoMemoryReservationSubmissionCount);
+        writer->AddItem("ResourceFragmentationLimit", desc.ResourceFragmentationLimit);
+        writer->AddItem("ReservedResourceHeapCount", desc.ReservedResourceHeapCount);
+        writer->AddItem("PooledResourceHeapWasteLimit", desc.PooledResourceHeapWasteLimit);
+        writer->AddItem("MaxPooledResourceHeapUsage", desc.MaxPooledResourceHeapUsage);
+        writer->AddItem("MaxPooledResourceHeapUsagePerSize",
+                        desc.MaxPooledResourceHeapUsagePerSize);
+        writer->AddItem("PooledResourceHeapPeakWindow", desc.PooledResourceHeapPeakWindow);
+        writer->AddItem("TransientBufferSize", desc.TransientBufferSize);
+        writer->AddItem("LargeBufferSize", desc.LargeBufferSize);
+        writer->AddItem("MaxBufferSlabSize", desc.MaxBufferSlabSize);
+        writer->AddItem("SubAllocatorShardCount", desc.SubAllocatorShardCount);
+        writer->AddItem("FrameTrimTimeInSeconds", desc.FrameTrimTimeInSeconds);
+        writer->AddItem("SharedStatsName", desc.SharedStatsName);
+        writer->AddItem("SharedStatsIntervalInSeconds", desc.SharedStatsIntervalInSeconds);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const CREATE_RESOURCE_DESC& desc) {
+        SerializeItem(writer, "allocationDescriptor", desc.allocationDescriptor);
+        SerializeItem(writer, "resourceDescriptor", desc.resourceDescriptor);
+        writer->AddItem("initialResourceState", desc.initialResourceState);
+        SerializeItem(writer, "clearValue", desc.clearValue);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const QUERY_VIDEO_MEMORY_INFO_DESC& desc) {
+        writer->AddItem("MemorySegmentGroup", desc.memorySegmentGroup);
+        writer->AddItem("Budget", desc.videoMemoryInfo.Budget);
+        writer->AddItem("CurrentUsage", desc.videoMemoryInfo.CurrentUsage);
+        writer->AddItem("AvailableForReservation", desc.videoMemoryInfo.AvailableForReservation);
+        writer->AddItem("CurrentReservation", desc.videoMemoryInfo.CurrentReservation);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const ALLOCATION_DESC& desc) {
+        writer->AddItem("Flags", desc.Flags);
+        writer->AddItem("HeapType", desc.HeapType);
+        writer->AddItem("FenceValue", desc.FenceValue);
+        writer->AddItem("ResidencyPriority", desc.ResidencyPriority);
+        writer->AddItem("Lifetime", desc.Lifetime);
+        writer->AddItem("Tag", desc.Tag);
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const ALLOCATOR_RECORD_OPTIONS& desc) {
-        JSONDict dict;
-        dict.AddItem("Flags", desc.Flags);
-        dict.AddItem("MinMessageLevel", desc.MinMessageLevel);
-        return dict;
+    void JSONSerializer::Serialize(JSONWriter* writer, const D3D12_RESOURCE_DESC& desc) {
+        writer->AddItem("Dimension", desc.Dimension);
+        writer->AddItem("Alignment", desc.Alignment);
+        writer->AddItem("Width", desc.Width);
+        writer->AddItem("Height", desc.Height);
+        writer->AddItem("DepthOrArraySize", desc.DepthOrArraySize);
+        writer->AddItem("MipLevels", desc.MipLevels);
+        writer->AddItem("Format", desc.Format);
+        writer->AddItem("Layout", desc.Layout);
+        SerializeItem(writer, "SampleDesc", desc.SampleDesc);
+        writer->AddItem("Flags", desc.Flags);
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const D3D12_DEPTH_STENCIL_VALUE& depthStencilValue) {
-        JSONDict dict;
-        dict.AddItem("Depth", depthStencilValue.Depth);
-        dict.AddItem("Stencil", depthStencilValue.Stencil);
-        return dict;
+    void JSONSerializer::Serialize(JSONWriter* writer, const ALLOCATOR_RECORD_OPTIONS& desc) {
+        writer->AddItem("Flags", desc.Flags);
+        writer->AddItem("MinMessageLevel", desc.MinMessageLevel);
+        writer->AddItem("UseBinaryTraceFormat", desc.UseBinaryTraceFormat);
+        writer->AddItem("FlightRecorderDurationInSeconds", desc.FlightRecorderDurationInSeconds);
+        writer->AddItem("CallSampleRate", desc.CallSampleRate);
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const FLOAT rgba[4]) {
-        JSONDict dict;
-        dict.AddItem("R", rgba[0]);
-        dict.AddItem("G", rgba[1]);
-        dict.AddItem("B", rgba[2]);
-        dict.AddItem("A", rgba[3]);
-        return dict;
+    void JSONSerializer::Serialize(JSONWriter* writer,
+                                   const D3D12_DEPTH_STENCIL_VALUE& depthStencilValue) {
+        writer->AddItem("Depth", depthStencilValue.Depth);
+        writer->AddItem("Stencil", depthStencilValue.Stencil);
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const D3D12_CLEAR_VALUE* clearValue) {
-        JSONDict dict;
+    void JSONSerializer::Serialize(JSONWriter* writer, const FLOAT rgba[4]) {
+        writer->AddItem("R", rgba[0]);
+        writer->AddItem("G", rgba[1]);
+        writer->AddItem("B", rgba[2]);
+        writer->AddItem("A", rgba[3]);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const D3D12_CLEAR_VALUE* clearValue) {
         if (clearValue == nullptr) {
-            return dict;
+            return;
         }
 
-        dict.AddItem("Format", clearValue->Format);
+        writer->AddItem("Format", clearValue->Format);
 
         if (IsDepthFormat(clearValue->Format)) {
-            dict.AddItem("DepthStencil", Serialize(clearValue->DepthStencil));
+            SerializeItem(writer, "DepthStencil", clearValue->DepthStencil);
         } else {
-            dict.AddItem("Color", Serialize(clearValue->Color));
+            SerializeItem(writer, "Color", clearValue->Color);
         }
-
-        return dict;
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const DXGI_SAMPLE_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("Count", desc.Count);
-        dict.AddItem("Quality", desc.Quality);
-        return dict;
+    void JSONSerializer::Serialize(JSONWriter* writer, const DXGI_SAMPLE_DESC& desc) {
+        writer->AddItem("Count", desc.Count);
+        writer->AddItem("Quality", desc.Quality);
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const HEAP_INFO& desc) {
-        JSONDict dict;
-        dict.AddItem("SizeInBytes", desc.SizeInBytes);
-        dict.AddItem("IsResident", desc.IsResident);
-        dict.AddItem("MemorySegmentGroup", desc.MemorySegmentGroup);
-        dict.AddItem("SubAllocatedRefs", desc.SubAllocatedRefs);
+    void JSONSerializer::Serialize(JSONWriter* writer, const HEAP_INFO& desc) {
+        writer->AddItem("SizeInBytes", desc.SizeInBytes);
+        writer->AddItem("IsResident", desc.IsResident);
+        writer->AddItem("MemorySegmentGroup", desc.MemorySegmentGroup);
+        writer->AddItem("SubAllocatedRefs", desc.SubAllocatedRefs);
+        writer->AddItem("AccessCount", desc.AccessCount);
+        writer->AddItem("ResidencyPriority", desc.ResidencyPriority);
         if (desc.MemoryPool != nullptr) {
-            dict.AddItem("MemoryPool", gpgmm::JSONSerializer::Serialize(desc.MemoryPool));
+            writer->AddName("MemoryPool");
+            writer->BeginDict();
+            gpgmm::JSONSerializer::Serialize(writer, desc.MemoryPool);
+            writer->EndDict();
         }
         if (desc.Heap != nullptr) {
-            dict.AddItem("Heap", Serialize(desc.Heap->GetDesc()));
+            SerializeItem(writer, "Heap", desc.Heap->GetDesc());
         }
-        return dict;
     }
 
     // static
-    JSONDict JSONSerializer::Serialize(const RESOURCE_ALLOCATION_INFO& desc) {
-        JSONDict dict;
-        dict.AddItem("SizeInBytes", desc.SizeInBytes);
-        dict.AddItem("HeapOffset", desc.HeapOffset);
-        dict.AddItem("OffsetFromResource", desc.OffsetFromResource);
-        dict.AddItem("Method", desc.Method);
-        dict.AddItem("ResourceHeap", gpgmm::JSONSerializer::Serialize(desc.ResourceHeap));
-        dict.AddItem("Resource", Serialize(desc.Resource->GetDesc()));
-        return dict;
-    }
-
-    // static
-    JSONDict JSONSerializer::Serialize(const D3D12_HEAP_DESC& desc) {
-        JSONDict dict;
-        dict.AddItem("SizeInBytes", desc.SizeInBytes);
-        dict.AddItem("Properties", Serialize(desc.Properties));
-        dict.AddItem("Alignment", desc.Alignment);
-        dict.AddItem("Flags", desc.Flags);
-        return dict;
-    }
-
-    // static
-    JSONDict JSONSerializer::Serialize(const D3D12_HEAP_PROPERTIES& desc) {
-        JSONDict dict;
-        dict.AddItem("SizeInBytes", desc.Type);
-        dict.AddItem("CPUPageProperty", desc.CPUPageProperty);
-        dict.AddItem("MemoryPoolPreference", desc.MemoryPoolPreference);
-        dict.AddItem("CreationNodeMask", desc.CreationNodeMask);
-        dict.AddItem("VisibleNodeMask", desc.VisibleNodeMask);
-        return dict;
+    void JSONSerializer::Serialize(JSONWriter* writer, const RESOURCE_ALLOCATION_INFO& desc) {
+        writer->AddItem("SizeInBytes", desc.SizeInBytes);
+        writer->AddItem("HeapOffset", desc.HeapOffset);
+        writer->AddItem("OffsetFromResource", desc.OffsetFromResource);
+        writer->AddItem("Method", desc.Method);
+        writer->AddName("ResourceHeap");
+        writer->BeginDict();
+        gpgmm::JSONSerializer::Serialize(writer, desc.ResourceHeap);
+        writer->EndDict();
+        if (desc.Resource != nullptr) {
+            SerializeItem(writer, "Resource", desc.Resource->GetDesc());
+        }
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const D3D12_HEAP_DESC& desc) {
+        writer->AddItem("SizeInBytes", desc.SizeInBytes);
+        SerializeItem(writer, "Properties", desc.Properties);
+        writer->AddItem("Alignment", desc.Alignment);
+        writer->AddItem("Flags", desc.Flags);
+    }
+
+    // static
+    void JSONSerializer::Serialize(JSONWriter* writer, const D3D12_HEAP_PROPERTIES& desc) {
+        writer->AddItem("SizeInBytes", desc.Type);
+        writer->AddItem("CPUPageProperty", desc.CPUPageProperty);
+        writer->AddItem("MemoryPoolPreference", desc.MemoryPoolPreference);
+        writer->AddItem("CreationNodeMask", desc.CreationNodeMask);
+        writer->AddItem("VisibleNodeMask", desc.VisibleNodeMask);
     }
 
 }}  // namespace gpgmm::d3d12
@@ -34,25 +34,51 @@ namespace gpgmm { namespace d3d12 {
         const D3D12_CLEAR_VALUE* clearValue;
     };
 
+    struct QUERY_VIDEO_MEMORY_INFO_DESC {
+        DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup;
+        const DXGI_QUERY_VIDEO_MEMORY_INFO& videoMemoryInfo;
+    };
+
     class JSONSerializer final : public gpgmm::JSONSerializer {
       public:
         static JSONDict Serialize();
         static JSONDict Serialize(const MEMORY_ALLOCATOR_INFO& info);
         static JSONDict Serialize(const ALLOCATOR_DESC& desc);
         static JSONDict Serialize(const CREATE_RESOURCE_DESC& desc);
+        static JSONDict Serialize(const QUERY_VIDEO_MEMORY_INFO_DESC& desc);
         static JSONDict Serialize(const ALLOCATION_DESC& desc);
         static JSONDict Serialize(const D3D12_RESOURCE_DESC& desc);
         static JSONDict Serialize(const HEAP_INFO& desc);
         static JSONDict Serialize(const RESOURCE_ALLOCATION_INFO& desc);
 
+        // Writes the members of |desc| into the dict open in |writer|, so nested dicts are
+        // written in place.
+        static void Serialize(JSONWriter* writer, const ALLOCATOR_DESC& desc);
+        static void Serialize(JSONWriter* writer, const CREATE_RESOURCE_DESC& desc);
+        static void Serialize(JSONWriter* writer, const QUERY_VIDEO_MEMORY_INFO_DESC& desc);
+        static void Serialize(JSONWriter* writer, const ALLOCATION_DESC& desc);
+        static void Serialize(JSONWriter* writer, const D3D12_RESOURCE_DESC& desc);
+        static void Serialize(JSONWriter* writer, const HEAP_INFO& desc);
+        static void Serialize(JSONWriter* writer, const RESOURCE_ALLOCATION_INFO& desc);
+
       private:
-        static JSONDict Serialize(const ALLOCATOR_RECORD_OPTIONS& desc);
-        static JSONDict Serialize(const D3D12_DEPTH_STENCIL_VALUE& depthStencilValue);
-        static JSONDict Serialize(const FLOAT rgba[4]);
-        static JSONDict Serialize(const D3D12_CLEAR_VALUE* clearValue);
-        static JSONDict Serialize(const DXGI_SAMPLE_DESC& desc);
-        static JSONDict Serialize(const D3D12_HEAP_DESC& desc);
-        static JSONDict Serialize(const D3D12_HEAP_PROPERTIES& desc);
+        static void Serialize(JSONWriter* writer, const ALLOCATOR_RECORD_OPTIONS& desc);
+        static void Serialize(JSONWriter* writer,
+                              const D3D12_DEPTH_STENCIL_VALUE& depthStencilValue);
+        static void Serialize(JSONWriter* writer, const FLOAT rgba[4]);
+        static void Serialize(JSONWriter* writer, const D3D12_CLEAR_VALUE* clearValue);
+        static void Serialize(JSONWriter* writer, const DXGI_SAMPLE_DESC& desc);
+        static void Serialize(JSONWriter* writer, const D3D12_HEAP_DESC& desc);
+        static void Serialize(JSONWriter* writer, const D3D12_HEAP_PROPERTIES& desc);
+
+        // Writes |desc| as a dict value named |name|.
+        template <typename T>
+        static void SerializeItem(JSONWriter* writer, const char* name, const T& desc) {
+            writer->AddName(name);
+            writer->BeginDict();
+            Serialize(writer, desc);
+            writer->EndDict();
+        }
     };
 
 }}  // namespace gpgmm::d3d12
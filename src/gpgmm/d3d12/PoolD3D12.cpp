@@ -0,0 +1,126 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/PoolD3D12.h"
+
+#include "gpgmm/LinearMemoryAllocator.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/d3d12/ResourceHeapAllocatorD3D12.h"
+
+#include <algorithm>
+
+namespace gpgmm { namespace d3d12 {
+
+    Pool::Pool(ComPtr<ResourceAllocator> resourceAllocator,
+               const POOL_DESC& descriptor,
+               uint64_t heapSize,
+               std::unique_ptr<MemoryAllocator> allocator,
+               SegmentedMemoryAllocator* pooledAllocator,
+               ResourceHeapAllocator* resourceHeapAllocator)
+        : mResourceAllocator(std::move(resourceAllocator)),
+          mDesc(descriptor),
+          mHeapSize(heapSize),
+          mAllocator(std::move(allocator)),
+          mPooledAllocator(pooledAllocator),
+          mResourceHeapAllocator(resourceHeapAllocator) {
+        ASSERT(mResourceAllocator != nullptr);
+        ASSERT(mAllocator != nullptr);
+        ASSERT(mPooledAllocator != nullptr);
+        ASSERT(mResourceHeapAllocator != nullptr);
+    }
+
+    Pool::~Pool() = default;
+
+    void Pool::Trim() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAllocator->ReleaseMemory();
+    }
+
+    HRESULT Pool::Reset() {
+        if (mDesc.Algorithm != ALLOCATOR_ALGORITHM_LINEAR) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!static_cast<LinearMemoryAllocator*>(mAllocator.get())->Reset()) {
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT Pool::ImportHeap(ComPtr<ID3D12Heap> heap) {
+        if (heap == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        if (mDesc.HeapFlags & D3D12_HEAP_FLAG_SHARED) {
+            return E_INVALIDARG;
+        }
+
+        // The heap flags which determine the resources a heap can contain must match, otherwise
+        // resources of the pool could be placed in a heap which cannot contain them.
+        constexpr D3D12_HEAP_FLAGS kResourceCategoryHeapFlags =
+            D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES |
+            D3D12_HEAP_FLAG_DENY_NON_RT_DS_TEXTURES;
+
+        const D3D12_HEAP_DESC heapDesc = heap->GetDesc();
+        if (heapDesc.Properties.Type != mDesc.HeapType || heapDesc.SizeInBytes != mHeapSize ||
+            (heapDesc.Flags & kResourceCategoryHeapFlags) !=
+                (mDesc.HeapFlags & kResourceCategoryHeapFlags)) {
+            return E_INVALIDARG;
+        }
+
+        // An alignment of 0 is the default heap alignment of 64KB.
+        const uint64_t heapAlignment = std::max(
+            heapDesc.Alignment, static_cast<uint64_t>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+        if (heapAlignment < mPooledAllocator->GetMemoryAlignment()) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const uint64_t heapUsage = mResourceHeapAllocator->QueryInfo().UsedMemoryUsage;
+        if (mDesc.MaxHeapCount > 0 && heapUsage + mHeapSize > mDesc.MaxHeapCount * mHeapSize) {
+            return E_OUTOFMEMORY;
+        }
+
+        std::unique_ptr<MemoryAllocation> heapAllocation =
+            mResourceHeapAllocator->ImportHeap(std::move(heap));
+        if (heapAllocation == nullptr) {
+            return E_FAIL;
+        }
+
+        mPooledAllocator->ImportMemory(std::move(heapAllocation));
+        return S_OK;
+    }
+
+    QUERY_RESOURCE_ALLOCATOR_INFO Pool::QueryInfo() const {
+        return mAllocator->QueryInfo();
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO Pool::QueryFragmentationInfo() const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        for (const MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO& layer :
+             mAllocator->QueryFragmentation()) {
+            result += layer.Info;
+        }
+        return result;
+    }
+
+    const POOL_DESC& Pool::GetDesc() const {
+        return mDesc;
+    }
+
+}}  // namespace gpgmm::d3d12
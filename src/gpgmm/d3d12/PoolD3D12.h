@@ -0,0 +1,142 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_POOLD3D12_H_
+#define GPGMM_D3D12_POOLD3D12_H_
+
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/d3d12/IUnknownImplD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+#include "include/gpgmm_export.h"
+
+#include <memory>
+#include <mutex>
+
+namespace gpgmm { namespace d3d12 {
+
+    class ResourceHeapAllocator;
+
+    struct POOL_DESC {
+        // Heap type of the resource heaps of the pool. Custom heaps are not supported.
+        D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+        // Heap flags of the resource heaps of the pool, which determine the resources the pool
+        // can contain. One of D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+        // D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+        // D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES or, on resource heap tier 2,
+        // D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES. Textures are only allowed in default
+        // heaps.
+        //
+        // Default heaps can also be shared with other processes by adding
+        // D3D12_HEAP_FLAG_SHARED. Each resource heap of the pool then gets a single NT handle,
+        // see ResourceAllocation::GetSharedHandle, which stays valid while the heap is pooled. A
+        // process placing resources in it every frame (ex. a video pipeline) then only creates
+        // and opens each heap once, instead of once per resource.
+        D3D12_HEAP_FLAGS HeapFlags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+
+        // Size of every resource heap of the pool, in bytes. Must be a power-of-two which is not
+        // smaller than the heap alignment (64KB, or 4MB for heaps which allow MSAA textures).
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the heap size
+        // to the default value of 4MB.
+        uint64_t HeapSizeInBytes = 0;
+
+        // Number of resource heaps created along with the pool, so the first resources created
+        // from it never wait on a resource heap to be created.
+        uint32_t MinHeapCount = 0;
+
+        // Maximum number of resource heaps of the pool, used or not. Once reached, resources
+        // which do not fit in the existing heaps fail to be created with E_OUTOFMEMORY.
+        //
+        // Optional parameter. When 0 is specified, the pool has no maximum.
+        uint32_t MaxHeapCount = 0;
+
+        // Algorithm used to place resources in the resource heaps of the pool. Every algorithm
+        // but ALLOCATOR_ALGORITHM_DEDICATED is supported, since heaps are of a fixed size. Pools
+        // using ALLOCATOR_ALGORITHM_LINEAR only re-use space once Pool::Reset is called.
+        ALLOCATOR_ALGORITHM Algorithm = ALLOCATOR_ALGORITHM_SLAB;
+    };
+
+    // Resource heaps dedicated to the resources created with ALLOCATION_DESC::CustomPool, such as a
+    // streaming texture cache with a hard limit. Resource heaps of a pool are never used by
+    // other resources, nor released by ResourceAllocator::Trim, and resources of a pool are
+    // never placed elsewhere.
+    //
+    // A pool keeps the resource allocator which created it alive, and must outlive every
+    // resource allocation created from it.
+    class GPGMM_EXPORT Pool final : public IUnknownImpl {
+      public:
+        ~Pool() override;
+
+        // Releases the resource heaps of the pool which contain no resource, including those
+        // created along with the pool.
+        void Trim();
+
+        // Frees the space of every resource of a pool created with ALLOCATOR_ALGORITHM_LINEAR at
+        // once, without releasing any resource heap, so the next resources are placed from the
+        // start of the first heap again. Every resource allocation of the pool must be released
+        // beforehand, otherwise E_FAIL is returned. Returns E_INVALIDARG for other algorithms.
+        HRESULT Reset();
+
+        // Adds a heap created by the application (ex. opened from a handle of another process)
+        // to the pool, as if it were created by the pool, so resources of the pool can be placed
+        // in it. The pool takes a reference to |heap| and treats it as resident, since it was
+        // just created or opened; the heap is released along with the other resource heaps of
+        // the pool (ex. by Trim).
+        //
+        // |heap| must be of the heap type, heap flags and heap size of the pool, and aligned to
+        // at least the heap alignment of the pool, otherwise E_INVALIDARG is returned. Imported
+        // heaps count towards POOL_DESC::MaxHeapCount, and E_OUTOFMEMORY is returned once
+        // reached. Heaps cannot be imported into shared pools, since they would have no shared
+        // handle.
+        HRESULT ImportHeap(ComPtr<ID3D12Heap> heap);
+
+        // Return the current pool usage. Not included in ResourceAllocator::QueryInfo.
+        QUERY_RESOURCE_ALLOCATOR_INFO QueryInfo() const;
+
+        // Return the fragmentation of the resource heaps of the pool.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const;
+
+        const POOL_DESC& GetDesc() const;
+
+      private:
+        friend ResourceAllocator;
+
+        Pool(ComPtr<ResourceAllocator> resourceAllocator,
+             const POOL_DESC& descriptor,
+             uint64_t heapSize,
+             std::unique_ptr<MemoryAllocator> allocator,
+             SegmentedMemoryAllocator* pooledAllocator,
+             ResourceHeapAllocator* resourceHeapAllocator);
+
+        // Declared before the allocator so the resource allocator, which owns the resource
+        // allocations and counts the heaps, outlives it.
+        ComPtr<ResourceAllocator> mResourceAllocator;
+
+        const POOL_DESC mDesc;
+        const uint64_t mHeapSize;
+
+        // Serializes resource creation from the pool, like the mutex of a resource heap type.
+        std::mutex mMutex;
+        std::unique_ptr<MemoryAllocator> mAllocator;
+
+        // Owned by |mAllocator|, which pools the resource heaps of the pool.
+        SegmentedMemoryAllocator* mPooledAllocator = nullptr;
+        ResourceHeapAllocator* mResourceHeapAllocator = nullptr;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_POOLD3D12_H_
@@ -0,0 +1,466 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/ReadbackManagerD3D12.h"
+
+#include "gpgmm/RingMemoryAllocator.h"
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/d3d12/BackendD3D12.h"
+#include "gpgmm/d3d12/BufferAllocatorD3D12.h"
+#include "gpgmm/d3d12/DefaultsD3D12.h"
+#include "gpgmm/d3d12/ErrorD3D12.h"
+#include "gpgmm/d3d12/FenceD3D12.h"
+#include "gpgmm/d3d12/HeapD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocationD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+
+namespace gpgmm { namespace d3d12 {
+
+    namespace {
+
+        // Keeps each readback in whole 16-byte blocks of the staging buffer, so it can be read
+        // with aligned loads.
+        static constexpr uint64_t kReadbackAlignment = 16u;
+
+    }  // namespace
+
+    // Waits, on a thread of the readback manager, for a submission to be submitted then for its
+    // copies to complete, which signals the events of its readbacks. Also counts the readbacks
+    // which were not released, since their staging space cannot be re-used until then.
+    class ReadbackSubmission final : public VoidCallback {
+      public:
+        explicit ReadbackSubmission(const Fence* fence) : mFence(fence) {
+        }
+
+        void operator()() override {
+            TRACE_EVENT0(TraceEventCategory::Default, "ReadbackManager.WaitForReadback");
+
+            uint64_t fenceValue = 0;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mSubmittedCondition.wait(lock, [this] { return mIsSubmitted; });
+                fenceValue = mFenceValue;
+            }
+
+            // Dropped submissions have no data.
+            if (fenceValue > 0) {
+                mHasData = SUCCEEDED(mFence->WaitForCompletion(fenceValue));
+            }
+        }
+
+        // Called once the copies were submitted, with the fence value which completes them, or
+        // 0 if they were dropped.
+        void SetSubmitted(uint64_t fenceValue) {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mIsSubmitted = true;
+                mFenceValue = fenceValue;
+            }
+            mSubmittedCondition.notify_all();
+        }
+
+        uint64_t GetFenceValue() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mFenceValue;
+        }
+
+        // Only valid once the event of the submission was signaled.
+        bool HasData() const {
+            return mHasData;
+        }
+
+        void AddReadback() {
+            mReadbackCount++;
+        }
+
+        void ReleaseReadback() {
+            mReadbackCount--;
+        }
+
+        uint32_t GetReadbackCount() const {
+            return mReadbackCount.load();
+        }
+
+      private:
+        const Fence* const mFence;
+
+        std::mutex mMutex;
+        std::condition_variable mSubmittedCondition;
+        bool mIsSubmitted = false;  // Guarded by mMutex.
+        uint64_t mFenceValue = 0;   // Guarded by mMutex.
+
+        bool mHasData = false;
+        std::atomic<uint32_t> mReadbackCount = {0};
+    };
+
+    // ReadbackEvent
+
+    ReadbackEvent::ReadbackEvent(std::shared_ptr<Event> event,
+                                 std::shared_ptr<ReadbackSubmission> submission,
+                                 const uint8_t* data,
+                                 uint64_t size)
+        : mSubmission(std::move(submission)), mEvent(std::move(event)), mData(data), mSize(size) {
+        mSubmission->AddReadback();
+    }
+
+    ReadbackEvent::~ReadbackEvent() {
+        mSubmission->ReleaseReadback();
+    }
+
+    void ReadbackEvent::Wait() {
+        mEvent->Wait();
+    }
+
+    bool ReadbackEvent::IsSignaled() {
+        return mEvent->IsSignaled();
+    }
+
+    void ReadbackEvent::Signal() {
+        return mEvent->Signal();
+    }
+
+    void ReadbackEvent::AddSignaledCallback(std::shared_ptr<VoidCallback> callback) {
+        mEvent->AddSignaledCallback(callback);
+    }
+
+    const void* ReadbackEvent::GetData() {
+        Wait();
+        return (mSubmission->HasData()) ? mData : nullptr;
+    }
+
+    uint64_t ReadbackEvent::GetSize() const {
+        return mSize;
+    }
+
+    // ReadbackManager
+
+    // static
+    HRESULT ReadbackManager::CreateReadbackManager(const READBACK_MANAGER_DESC& descriptor,
+                                                   ReadbackManager** readbackManagerOut) {
+        if (descriptor.Allocator == nullptr || descriptor.CommandQueue == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        const uint64_t stagingBufferSize =
+            AlignTo((descriptor.StagingBufferSize > 0) ? descriptor.StagingBufferSize
+                                                       : kDefaultTransientBufferSize,
+                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+        ComPtr<ID3D12Device> device;
+        ReturnIfFailed(descriptor.CommandQueue->GetDevice(IID_PPV_ARGS(&device)));
+
+        Fence* fencePtr = nullptr;
+        ReturnIfFailed(Fence::CreateFence(device, 0, &fencePtr));
+        std::unique_ptr<Fence> fence(fencePtr);
+
+        if (readbackManagerOut != nullptr) {
+            *readbackManagerOut = new ReadbackManager(descriptor.Allocator, std::move(device),
+                                                      descriptor.CommandQueue, std::move(fence),
+                                                      stagingBufferSize);
+        }
+
+        return S_OK;
+    }
+
+    ReadbackManager::ReadbackManager(ComPtr<ResourceAllocator> resourceAllocator,
+                                     ComPtr<ID3D12Device> device,
+                                     ComPtr<ID3D12CommandQueue> commandQueue,
+                                     std::unique_ptr<Fence> fence,
+                                     uint64_t stagingBufferSize)
+        : mResourceAllocator(std::move(resourceAllocator)),
+          mDevice(std::move(device)),
+          mCommandQueue(std::move(commandQueue)),
+          mResidencyManager(mResourceAllocator->GetResidencyManager()),
+          mCommandListType(mCommandQueue->GetDesc().Type),
+          mStagingBufferSize(stagingBufferSize),
+          mThreadPool(ThreadPool::Create(/*maxWorkerCount*/ 1)),
+          mFence(std::move(fence)) {
+        ASSERT(mFence != nullptr);
+
+        mStagingAllocator = std::make_unique<RingMemoryAllocator>(
+            std::make_unique<BufferAllocator>(
+                mResourceAllocator.Get(), D3D12_HEAP_TYPE_READBACK, D3D12_RESOURCE_FLAG_NONE,
+                D3D12_RESOURCE_STATE_COPY_DEST, mStagingBufferSize,
+                D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+            mStagingBufferSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    }
+
+    ReadbackManager::~ReadbackManager() {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Copies recorded but never submitted are dropped.
+        if (mIsCommandListOpen) {
+            mCommandList->Close();
+        }
+
+        if (mPendingSubmission != nullptr) {
+            mPendingSubmission->SetSubmitted(0);
+            mPendingSubmissionEvent->Wait();
+        }
+
+        // The fence cannot be released while waited on, nor the staging buffer while copies
+        // still write to it.
+        for (auto& submission : mInflightSubmissions) {
+            submission.second->Wait();
+        }
+
+        ASSERT(std::all_of(mInflightSubmissions.begin(), mInflightSubmissions.end(),
+                           [](const auto& submission) {
+                               return submission.first->GetReadbackCount() == 0;
+                           }));
+
+        mStagingAllocator->RetireMemory(mFence->GetLastSignaledFence());
+
+        if (mStagingData != nullptr) {
+            const D3D12_RANGE writtenRange = {0, 0};
+            mStagingBuffer->Unmap(0, &writtenRange);
+            if (mResidencyManager != nullptr) {
+                mResidencyManager->UnlockHeap(mStagingHeap);
+            }
+        }
+
+        mStagingBuffer = nullptr;
+        mStagingAllocator->ReleaseMemory();
+    }
+
+    HRESULT ReadbackManager::ReadbackBuffer(ID3D12Resource* srcResource,
+                                            uint64_t srcOffset,
+                                            uint64_t size,
+                                            std::shared_ptr<ReadbackEvent>* readbackEventOut) {
+        if (srcResource == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        return ReadbackBufferInternal(srcResource, srcOffset, size, readbackEventOut);
+    }
+
+    HRESULT ReadbackManager::ReadbackBuffer(ResourceAllocation* srcAllocation,
+                                            uint64_t srcOffset,
+                                            uint64_t size,
+                                            std::shared_ptr<ReadbackEvent>* readbackEventOut) {
+        if (srcAllocation == nullptr || srcAllocation->GetResource() == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        ReturnIfFailed(ReadbackBufferInternal(srcAllocation->GetResource(),
+                                              srcAllocation->GetOffsetFromResource() + srcOffset,
+                                              size, readbackEventOut));
+
+        // Fails if the resource heap was already inserted by another readback, which is fine.
+        if (mResidencyManager != nullptr) {
+            srcAllocation->UpdateResidency(&mResidencySet);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ReadbackManager::ReadbackBufferInternal(
+        ID3D12Resource* srcResource,
+        uint64_t srcOffset,
+        uint64_t size,
+        std::shared_ptr<ReadbackEvent>* readbackEventOut) {
+        TRACE_EVENT0(TraceEventCategory::Default, "ReadbackManager.ReadbackBuffer");
+
+        if (readbackEventOut == nullptr || size == 0) {
+            return E_INVALIDARG;
+        }
+
+        if (size > mStagingBufferSize) {
+            return E_OUTOFMEMORY;
+        }
+
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = size;
+        request.Alignment = kReadbackAlignment;
+
+        // Staging space belongs to the submission which will copy into it.
+        RetireSubmissions();
+        mStagingAllocator->SetPendingSerial(mFence->GetCurrentFence());
+
+        std::unique_ptr<MemoryAllocation> stagingAllocation =
+            mStagingAllocator->TryAllocateMemory(request);
+        if (stagingAllocation == nullptr) {
+            // Staging space is only free again once submissions complete, and their readbacks
+            // were released, which may never happen while blocking.
+            if (mPendingSubmission != nullptr) {
+                ReturnIfFailed(SubmitInternal());
+            }
+            ReturnIfFailed(mFence->WaitFor(mFence->GetLastSignaledFence()));
+            RetireSubmissions();
+
+            mStagingAllocator->SetPendingSerial(mFence->GetCurrentFence());
+            stagingAllocation = mStagingAllocator->TryAllocateMemory(request);
+            if (stagingAllocation == nullptr) {
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        // The staging buffer is only mapped once, then kept mapped until destroyed.
+        if (mStagingData == nullptr) {
+            Heap* stagingHeap = ToBackend(stagingAllocation->GetMemory());
+            ComPtr<ID3D12Resource> stagingBuffer = stagingHeap->GetPlacedBuffer();
+            if (stagingBuffer == nullptr) {
+                ReturnIfFailed(stagingHeap->GetPageable().As(&stagingBuffer));
+            }
+
+            if (mResidencyManager != nullptr) {
+                ReturnIfFailed(mResidencyManager->LockHeap(stagingHeap));
+            }
+
+            // Every readback is read by the CPU.
+            const D3D12_RANGE readRange = {0, static_cast<SIZE_T>(mStagingBufferSize)};
+            void* stagingData = nullptr;
+            const HRESULT hr = stagingBuffer->Map(0, &readRange, &stagingData);
+            if (FAILED(hr)) {
+                if (mResidencyManager != nullptr) {
+                    mResidencyManager->UnlockHeap(stagingHeap);
+                }
+                mStagingAllocator->DeallocateMemory(std::move(stagingAllocation));
+                return hr;
+            }
+
+            mStagingHeap = stagingHeap;
+            mStagingBuffer = std::move(stagingBuffer);
+            mStagingData = static_cast<const uint8_t*>(stagingData);
+        }
+
+        ASSERT(ToBackend(stagingAllocation->GetMemory()) == mStagingHeap);
+
+        const uint64_t stagingOffset = stagingAllocation->GetOffset();
+
+        // Space is only re-used once the submission retires, so the allocation can be released
+        // right away.
+        mStagingAllocator->DeallocateMemory(std::move(stagingAllocation));
+
+        ReturnIfFailed(OpenCommandList());
+        mCommandList->CopyBufferRegion(mStagingBuffer.Get(), stagingOffset, srcResource,
+                                       srcOffset, size);
+
+        // Readbacks of the same submission share the same wait.
+        if (mPendingSubmission == nullptr) {
+            mPendingSubmission = std::make_shared<ReadbackSubmission>(mFence.get());
+            mPendingSubmissionEvent =
+                ThreadPool::PostTask(mThreadPool, mPendingSubmission, TaskClass::kRequested);
+        }
+
+        *readbackEventOut = std::make_shared<ReadbackEvent>(
+            mPendingSubmissionEvent, mPendingSubmission, mStagingData + stagingOffset, size);
+
+        return S_OK;
+    }
+
+    HRESULT ReadbackManager::OpenCommandList() {
+        if (mIsCommandListOpen) {
+            return S_OK;
+        }
+
+        // Re-use the command allocator of the oldest submission, once completed.
+        if (!mInflightAllocators.empty() &&
+            mFence->IsCompleted(mInflightAllocators.front().first)) {
+            mCommandAllocator = std::move(mInflightAllocators.front().second);
+            mInflightAllocators.pop_front();
+            ReturnIfFailed(mCommandAllocator->Reset());
+        } else {
+            ReturnIfFailed(mDevice->CreateCommandAllocator(mCommandListType,
+                                                           IID_PPV_ARGS(&mCommandAllocator)));
+        }
+
+        if (mCommandList == nullptr) {
+            ReturnIfFailed(mDevice->CreateCommandList(0, mCommandListType, mCommandAllocator.Get(),
+                                                      nullptr, IID_PPV_ARGS(&mCommandList)));
+        } else {
+            ReturnIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
+        }
+
+        mIsCommandListOpen = true;
+        return S_OK;
+    }
+
+    HRESULT ReadbackManager::Submit(uint64_t* fenceValueOut) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mPendingSubmission != nullptr) {
+            ReturnIfFailed(SubmitInternal());
+        }
+
+        if (fenceValueOut != nullptr) {
+            *fenceValueOut = mFence->GetLastSignaledFence();
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ReadbackManager::SubmitInternal() {
+        TRACE_EVENT0(TraceEventCategory::Default, "ReadbackManager.Submit");
+
+        ASSERT(mIsCommandListOpen);
+        ASSERT(mPendingSubmission != nullptr);
+        ReturnIfFailed(mCommandList->Close());
+        mIsCommandListOpen = false;
+
+        ID3D12CommandList* commandLists[] = {mCommandList.Get()};
+        if (mResidencyManager != nullptr) {
+            ResidencySet* residencySets[] = {&mResidencySet};
+            ReturnIfFailed(mResidencyManager->ExecuteCommandLists(
+                mCommandQueue.Get(), commandLists, residencySets, 1));
+        } else {
+            mCommandQueue->ExecuteCommandLists(1, commandLists);
+        }
+
+        ReturnIfFailed(mFence->Signal(mCommandQueue.Get()));
+
+        const uint64_t fenceValue = mFence->GetLastSignaledFence();
+        mInflightAllocators.emplace_back(fenceValue, std::move(mCommandAllocator));
+
+        mPendingSubmission->SetSubmitted(fenceValue);
+        mInflightSubmissions.emplace_back(std::move(mPendingSubmission),
+                                          std::move(mPendingSubmissionEvent));
+
+        return mResidencySet.Reset();
+    }
+
+    uint64_t ReadbackManager::GetCompletedFenceValue() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFence->GetCompletedValue();
+    }
+
+    void ReadbackManager::RetireSubmissions() {
+        // The ring can only free its oldest space, so a submission whose readbacks were not
+        // released keeps every later submission from retiring.
+        uint64_t retiredFenceValue = 0;
+        while (!mInflightSubmissions.empty()) {
+            const std::shared_ptr<ReadbackSubmission>& submission =
+                mInflightSubmissions.front().first;
+            if (!mFence->IsCompleted(submission->GetFenceValue()) ||
+                submission->GetReadbackCount() > 0) {
+                break;
+            }
+            retiredFenceValue = submission->GetFenceValue();
+            mInflightSubmissions.pop_front();
+        }
+
+        if (retiredFenceValue > 0) {
+            mStagingAllocator->RetireMemory(retiredFenceValue);
+        }
+    }
+
+}}  // namespace gpgmm::d3d12
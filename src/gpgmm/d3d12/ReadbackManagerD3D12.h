@@ -0,0 +1,194 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_READBACKMANAGERD3D12_H_
+#define GPGMM_D3D12_READBACKMANAGERD3D12_H_
+
+#include "gpgmm/WorkerThread.h"
+#include "gpgmm/d3d12/IUnknownImplD3D12.h"
+#include "gpgmm/d3d12/ResidencySetD3D12.h"
+#include "gpgmm/d3d12/d3d12_platform.h"
+#include "include/gpgmm_export.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace gpgmm {
+    class RingMemoryAllocator;
+}  // namespace gpgmm
+
+namespace gpgmm { namespace d3d12 {
+
+    class Fence;
+    class Heap;
+    class ReadbackSubmission;
+    class ResidencyManager;
+    class ResourceAllocation;
+    class ResourceAllocator;
+
+    struct READBACK_MANAGER_DESC {
+        // Allocator which creates the staging buffer.
+        ResourceAllocator* Allocator = nullptr;
+
+        // Queue which executes the copies, typically of D3D12_COMMAND_LIST_TYPE_COPY. The
+        // readback manager signals its own fence on it.
+        ID3D12CommandQueue* CommandQueue = nullptr;
+
+        // Size of the readback buffer data is copied into, in bytes. Bounds the largest readback
+        // and how much data can be read back but not yet released.
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the staging
+        // buffer size to the default value of 4MB.
+        uint64_t StagingBufferSize = 0;
+    };
+
+    // Event returned by ReadbackManager::ReadbackBuffer which is signaled, from a background
+    // thread, once the copy completed and the data can be read. Signaled callbacks run on that
+    // thread, so the thread which requested the readback never waits on the GPU. The staging
+    // space holding the data is only re-used once the event is released, which must happen
+    // before the readback manager is released.
+    class GPGMM_EXPORT ReadbackEvent final : public Event {
+      public:
+        ReadbackEvent(std::shared_ptr<Event> event,
+                      std::shared_ptr<ReadbackSubmission> submission,
+                      const uint8_t* data,
+                      uint64_t size);
+        ~ReadbackEvent() override;
+
+        // Event overrides
+        void Wait() override;
+        bool IsSignaled() override;
+        void Signal() override;
+        void AddSignaledCallback(std::shared_ptr<VoidCallback> callback) override;
+
+        // Waits for the copy to complete then returns the data read back. Returns nullptr
+        // should the copy never have been submitted, ex. the readback manager was released.
+        const void* GetData();
+
+        uint64_t GetSize() const;
+
+      private:
+        std::shared_ptr<ReadbackSubmission> mSubmission;
+        std::shared_ptr<Event> mEvent;
+        const uint8_t* const mData;
+        const uint64_t mSize;
+    };
+
+    // Reads back data from buffers through a single readback buffer, used as a ring, created
+    // upon first use and kept mapped. Readbacks are recorded into one copy command list until
+    // Submit, which executes them at once and signals a fence. Instead of the caller waiting on
+    // the fence then mapping, the ReadbackEvent of each readback is signaled once its copy
+    // completes. Staging space is re-used once every readback of a submission was released, so
+    // reading back never creates a resource.
+    //
+    // Source buffers must be in the D3D12_RESOURCE_STATE_COPY_SOURCE state, or one which the
+    // copy queue promotes to it, and must not be written by another queue until the readback
+    // completes.
+    class GPGMM_EXPORT ReadbackManager final : public IUnknownImpl {
+      public:
+        static HRESULT CreateReadbackManager(const READBACK_MANAGER_DESC& descriptor,
+                                             ReadbackManager** readbackManagerOut);
+
+        // Waits for every submission to complete. Readbacks recorded but not yet submitted are
+        // dropped, and their events signaled with no data.
+        ~ReadbackManager() override;
+
+        // Records a copy of |size| bytes of |srcResource| at |srcOffset|. Returns the event
+        // signaled once the data was copied, after Submit. Should the staging buffer be full,
+        // recorded copies are submitted and the calling thread blocks until they complete.
+        // Returns E_OUTOFMEMORY if |size| is larger than the staging buffer or should the
+        // staging buffer remain full of readbacks which were not released.
+        HRESULT ReadbackBuffer(ID3D12Resource* srcResource,
+                               uint64_t srcOffset,
+                               uint64_t size,
+                               std::shared_ptr<ReadbackEvent>* readbackEventOut);
+
+        // Equivalent to ReadbackBuffer except |srcOffset| is from the start of the allocation,
+        // and the resource heap of the allocation is made resident for the copy.
+        HRESULT ReadbackBuffer(ResourceAllocation* srcAllocation,
+                               uint64_t srcOffset,
+                               uint64_t size,
+                               std::shared_ptr<ReadbackEvent>* readbackEventOut);
+
+        // Executes every copy recorded since the last submission, then signals the fence.
+        // Returns the fence value which completes once the copies complete, or the last one
+        // signaled if nothing was recorded.
+        HRESULT Submit(uint64_t* fenceValueOut = nullptr);
+
+        // Returns the last fence value completed, without waiting.
+        uint64_t GetCompletedFenceValue();
+
+      private:
+        ReadbackManager(ComPtr<ResourceAllocator> resourceAllocator,
+                        ComPtr<ID3D12Device> device,
+                        ComPtr<ID3D12CommandQueue> commandQueue,
+                        std::unique_ptr<Fence> fence,
+                        uint64_t stagingBufferSize);
+
+        HRESULT ReadbackBufferInternal(ID3D12Resource* srcResource,
+                                       uint64_t srcOffset,
+                                       uint64_t size,
+                                       std::shared_ptr<ReadbackEvent>* readbackEventOut);
+        HRESULT OpenCommandList();
+        HRESULT SubmitInternal();
+
+        // Frees staging space and command allocators of completed submissions whose readbacks
+        // were all released.
+        void RetireSubmissions();
+
+        // Declared before the staging allocator so the resource allocator, which creates the
+        // staging buffer, outlives it.
+        ComPtr<ResourceAllocator> mResourceAllocator;
+        ComPtr<ID3D12Device> mDevice;
+        ComPtr<ID3D12CommandQueue> mCommandQueue;
+        ResidencyManager* const mResidencyManager;
+
+        const D3D12_COMMAND_LIST_TYPE mCommandListType;
+        const uint64_t mStagingBufferSize;
+
+        // Waits on submissions to signal their readback events.
+        std::shared_ptr<ThreadPool> mThreadPool;
+
+        std::mutex mMutex;
+
+        // Guarded by mMutex.
+        std::unique_ptr<Fence> mFence;
+        std::unique_ptr<RingMemoryAllocator> mStagingAllocator;
+        Heap* mStagingHeap = nullptr;  // Locked resident while mapped.
+        ComPtr<ID3D12Resource> mStagingBuffer;
+        const uint8_t* mStagingData = nullptr;
+
+        ComPtr<ID3D12GraphicsCommandList> mCommandList;
+        ComPtr<ID3D12CommandAllocator> mCommandAllocator;
+        bool mIsCommandListOpen = false;
+        ResidencySet mResidencySet;
+
+        // Submission the recorded copies belong to, and the event signaled once it completes.
+        std::shared_ptr<ReadbackSubmission> mPendingSubmission;
+        std::shared_ptr<Event> mPendingSubmissionEvent;
+
+        // Submissions by the fence value which completes them, oldest first.
+        std::deque<std::pair<std::shared_ptr<ReadbackSubmission>, std::shared_ptr<Event>>>
+            mInflightSubmissions;
+
+        // Command allocators of submissions, by the fence value which completes them.
+        std::deque<std::pair<uint64_t, ComPtr<ID3D12CommandAllocator>>> mInflightAllocators;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_READBACKMANAGERD3D12_H_
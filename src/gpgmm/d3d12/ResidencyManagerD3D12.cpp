@@ -16,6 +16,8 @@
 #include "gpgmm/d3d12/ResidencyManagerD3D12.h"
 
 #include "gpgmm/Debug.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/d3d12/DefaultsD3D12.h"
 #include "gpgmm/d3d12/ErrorD3D12.h"
 #include "gpgmm/d3d12/FenceD3D12.h"
@@ -24,10 +26,73 @@
 #include "gpgmm/d3d12/ResidencySetD3D12.h"
 
 #include <algorithm>
+#include <thread>
 #include <vector>
 
 namespace gpgmm { namespace d3d12 {
 
+    namespace {
+
+        // Heaps returned to a memory pool do not contain any resources, so they can be evicted
+        // without affecting the application.
+        bool IsPooledAndUnused(Heap* heap) {
+            return heap->GetPool() != nullptr && heap->GetRefCount() == 0;
+        }
+
+    }  // namespace
+
+    // Evicts heaps of a memory segment until under budget, waiting for the GPU to finish using
+    // them without holding the residency manager lock.
+    class EvictTask : public VoidCallback {
+      public:
+        EvictTask(ResidencyManager* residencyManager,
+                  uint64_t sizeToMakeResident,
+                  const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup)
+            : mResidencyManager(residencyManager),
+              mSizeToMakeResident(sizeToMakeResident),
+              mMemorySegmentGroup(memorySegmentGroup) {
+        }
+
+        void operator()() override {
+            TRACE_EVENT0(TraceEventCategory::Residency, "EvictTask");
+
+            while (true) {
+                Fence* fenceToWaitFor = nullptr;
+                uint64_t fenceValueToWaitFor = 0;
+                {
+                    std::lock_guard<std::recursive_mutex> lock(mResidencyManager->mMutex);
+                    if (FAILED(mResidencyManager->EvictInternal(
+                            mSizeToMakeResident, mMemorySegmentGroup, /*waitForGPU*/ false,
+                            nullptr, &fenceToWaitFor, &fenceValueToWaitFor))) {
+                        return;
+                    }
+                }
+
+                if (fenceToWaitFor == nullptr) {
+                    return;
+                }
+
+                // Fences are never destroyed before the residency manager.
+                const uint64_t waitStartTicks = mResidencyManager->mPagingTimer->GetTicks();
+                const HRESULT hr = fenceToWaitFor->WaitForCompletion(fenceValueToWaitFor);
+                mResidencyManager->RecordPagingLatency(
+                    &ResidencyManager::PagingCounters::FenceWaitTicks,
+                    &mResidencyManager->mFenceWaitLatency, "GPU fence wait latency (us)",
+                    waitStartTicks);
+                mResidencyManager->RecordPaging(&ResidencyManager::PagingCounters::FenceWaitCount,
+                                                1);
+                if (FAILED(hr)) {
+                    return;
+                }
+            }
+        }
+
+      private:
+        ResidencyManager* const mResidencyManager;
+        const uint64_t mSizeToMakeResident;
+        const DXGI_MEMORY_SEGMENT_GROUP mMemorySegmentGroup;
+    };
+
     // static
     HRESULT ResidencyManager::CreateResidencyManager(ComPtr<ID3D12Device> device,
                                                      ComPtr<IDXGIAdapter> adapter,
@@ -35,37 +100,37 @@ namespace gpgmm { namespace d3d12 {
                                                      float maxVideoMemoryBudget,
                                                      uint64_t totalResourceBudgetLimit,
                                                      uint64_t videoMemoryEvictSize,
+                                                     bool evictInBackground,
+                                                     bool offerPooledHeaps,
+                                                     EVICTION_POLICY evictionPolicy,
+                                                     uint32_t predictionSubmissionCount,
+                                                     uint32_t reservationSubmissionCount,
                                                      ResidencyManager** residencyManagerOut) {
         // Requires DXGI 1.4 due to IDXGIAdapter3::QueryVideoMemoryInfo.
         Microsoft::WRL::ComPtr<IDXGIAdapter3> adapter3;
         ReturnIfFailed(adapter.As(&adapter3));
 
-        // Residency manager needs it's own fence to know when heaps are no longer being used by the
-        // GPU.
-        std::unique_ptr<Fence> residencyFence;
-        {
-            Fence* ptr = nullptr;
-            ReturnIfFailed(Fence::CreateFence(device, 0, &ptr));
-            residencyFence.reset(ptr);
-        }
-
         std::unique_ptr<ResidencyManager> residencyManager =
             std::unique_ptr<ResidencyManager>(new ResidencyManager(
-                std::move(device), std::move(adapter3), std::move(residencyFence), isUMA,
-                maxVideoMemoryBudget, totalResourceBudgetLimit, videoMemoryEvictSize));
+                std::move(device), std::move(adapter3), isUMA, maxVideoMemoryBudget,
+                totalResourceBudgetLimit, videoMemoryEvictSize, evictInBackground, offerPooledHeaps,
+                evictionPolicy, predictionSubmissionCount, reservationSubmissionCount));
 
         // Query and set the video memory limits per segment.
-        DXGI_QUERY_VIDEO_MEMORY_INFO* queryVideoMemoryInfo =
-            residencyManager->GetVideoMemorySegmentInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
-
-        ReturnIfFailed(residencyManager->QueryVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL,
-                                                              queryVideoMemoryInfo));
-        if (!isUMA) {
-            queryVideoMemoryInfo =
-                residencyManager->GetVideoMemorySegmentInfo(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL);
+        ReturnIfFailed(residencyManager->UpdateVideoMemorySegments());
+
+        // Paging for submissions is enqueued, when supported, so the submitting thread never
+        // blocks on it. Instead, the queue waits on the GPU for paging to complete.
+        if (SUCCEEDED(residencyManager->mDevice.As(&residencyManager->mDevice3))) {
+            Fence* residencyFence = nullptr;
+            ReturnIfFailed(Fence::CreateFence(residencyManager->mDevice, 0, &residencyFence));
+            residencyManager->mResidencyFence.reset(residencyFence);
+        }
 
-            ReturnIfFailed(residencyManager->QueryVideoMemoryInfo(
-                DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, queryVideoMemoryInfo));
+        // Without budget notifications, the video memory info must be queried every time it is
+        // needed instead.
+        if (FAILED(residencyManager->StartBudgetNotificationThread())) {
+            gpgmm::DebugLog() << "Video memory budget change notifications are not supported.";
         }
 
         *residencyManagerOut = residencyManager.release();
@@ -75,40 +140,237 @@ namespace gpgmm { namespace d3d12 {
 
     ResidencyManager::ResidencyManager(ComPtr<ID3D12Device> device,
                                        ComPtr<IDXGIAdapter3> adapter3,
-                                       std::unique_ptr<Fence> fence,
                                        bool isUMA,
                                        float maxVideoMemoryBudget,
                                        uint64_t totalResourceBudgetLimit,
-                                       uint64_t videoMemoryEvictSize)
+                                       uint64_t videoMemoryEvictSize,
+                                       bool evictInBackground,
+                                       bool offerPooledHeaps,
+                                       EVICTION_POLICY evictionPolicy,
+                                       uint32_t predictionSubmissionCount,
+                                       uint32_t reservationSubmissionCount)
         : mDevice(device),
           mAdapter(adapter3),
-          mFence(std::move(fence)),
+          mIsUMA(isUMA),
           mMaxVideoMemoryBudget(maxVideoMemoryBudget == 0 ? kDefaultMaxVideoMemoryBudget
                                                           : maxVideoMemoryBudget),
           mTotalResourceBudgetLimit(totalResourceBudgetLimit),
           mVideoMemoryEvictSize(videoMemoryEvictSize == 0 ? kDefaultVideoMemoryEvictSize
-                                                          : videoMemoryEvictSize) {
+                                                          : videoMemoryEvictSize),
+          mEvictInBackground(evictInBackground),
+          mOfferPooledHeaps(offerPooledHeaps),
+          mEvictionPolicy(evictionPolicy),
+          mPredictionSubmissionCount(predictionSubmissionCount),
+          mReservationSubmissionCount(reservationSubmissionCount),
+          mPagingTimer(CreatePlatformTime(PlatformTimeSource::kCycleCounter)),
+          mThreadPool(ThreadPool::Create(/*maxWorkerCount*/ 1)) {
         GPGMM_TRACE_EVENT_OBJECT_NEW(this);
 
         ASSERT(mDevice != nullptr);
         ASSERT(mAdapter != nullptr);
-        ASSERT(mFence != nullptr);
 
         // There is a non-zero memory usage even before any resources have been created, and this
         // value can vary by enviroment. By adding this in addition to the artificial budget limit,
         // we can create a predictable and reproducible budget.
         if (mTotalResourceBudgetLimit > 0) {
-            mLocalVideoMemorySegment.Info.Budget =
+            mLocalVideoMemorySegment.LimitedBudget =
                 mLocalVideoMemorySegment.Info.CurrentUsage + mTotalResourceBudgetLimit;
+            mLocalVideoMemorySegment.Info.Budget = mLocalVideoMemorySegment.LimitedBudget;
             if (!isUMA) {
-                mNonLocalVideoMemorySegment.Info.Budget =
+                mNonLocalVideoMemorySegment.LimitedBudget =
                     mNonLocalVideoMemorySegment.Info.CurrentUsage + mTotalResourceBudgetLimit;
+                mNonLocalVideoMemorySegment.Info.Budget = mNonLocalVideoMemorySegment.LimitedBudget;
             }
         }
     }
 
     ResidencyManager::~ResidencyManager() {
         GPGMM_TRACE_EVENT_OBJECT_DESTROY(this);
+
+        // Heaps may outlive the residency manager.
+        for (auto& queueHistory : mSubmissionHistory) {
+            for (const std::vector<Heap*>& usedHeaps : queueHistory.second) {
+                for (Heap* heap : usedHeaps) {
+                    heap->mSubmissionHistoryOwner = nullptr;
+                    heap->mSubmissionHistoryRefs = 0;
+                }
+            }
+        }
+
+        for (Heap* heap : mLocalVideoMemorySegment.OfferedHeaps) {
+            heap->mOfferedBy = nullptr;
+        }
+
+        for (Heap* heap : mNonLocalVideoMemorySegment.OfferedHeaps) {
+            heap->mOfferedBy = nullptr;
+        }
+
+        // Give back the video memory reserved on behalf of the application.
+        if (mLocalVideoMemorySegment.AutoReservation > 0) {
+            mAdapter->SetVideoMemoryReservation(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, 0);
+        }
+
+        if (mNonLocalVideoMemorySegment.AutoReservation > 0) {
+            mAdapter->SetVideoMemoryReservation(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, 0);
+        }
+
+        if (mBudgetNotificationThread.joinable()) {
+            SetEvent(mShutdownEvent);
+            mBudgetNotificationThread.join();
+            mAdapter->UnregisterVideoMemoryBudgetChangeNotification(mBudgetNotificationCookie);
+        }
+
+        if (mBudgetNotificationEvent != nullptr) {
+            CloseHandle(mBudgetNotificationEvent);
+        }
+
+        if (mShutdownEvent != nullptr) {
+            CloseHandle(mShutdownEvent);
+        }
+    }
+
+    // Re-queries the video memory info whenever the OS changes the budget. Usage is also
+    // re-queried periodically to account for changes made outside of this residency manager (ex.
+    // heaps created or released, or by other processes) which are not notified.
+    HRESULT ResidencyManager::StartBudgetNotificationThread() {
+        mBudgetNotificationEvent = CreateEvent(nullptr, false, false, nullptr);
+        mShutdownEvent = CreateEvent(nullptr, false, false, nullptr);
+        if (mBudgetNotificationEvent == nullptr || mShutdownEvent == nullptr) {
+            return E_FAIL;
+        }
+
+        ReturnIfFailed(mAdapter->RegisterVideoMemoryBudgetChangeNotificationEvent(
+            mBudgetNotificationEvent, &mBudgetNotificationCookie));
+
+        // Set before the thread starts, so the thread can clear it should waiting fail right
+        // away.
+        mIsVideoMemoryInfoCached = true;
+
+        mBudgetNotificationThread = std::thread([this]() {
+            InitializeThreadName("GPGMM_ResidencyBudgetNotificationWorker");
+
+            const HANDLE events[] = {mShutdownEvent, mBudgetNotificationEvent};
+            while (true) {
+                const DWORD result =
+                    WaitForMultipleObjects(2, events, false, kDefaultVideoMemoryInfoRefreshMs);
+                if (result == WAIT_OBJECT_0) {
+                    break;
+                }
+
+                std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+                // Fall back to querying every time should waiting ever fail.
+                if (result != WAIT_OBJECT_0 + 1 && result != WAIT_TIMEOUT) {
+                    mIsVideoMemoryInfoCached = false;
+                    break;
+                }
+
+                UpdateVideoMemorySegments();
+            }
+        });
+
+        return S_OK;
+    }
+
+    HRESULT ResidencyManager::UpdateVideoMemorySegments() {
+        const uint64_t localBudget = mLocalVideoMemorySegment.Info.Budget;
+        const uint64_t nonLocalBudget = mNonLocalVideoMemorySegment.Info.Budget;
+
+        ReturnIfFailed(QueryVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL,
+                                            &mLocalVideoMemorySegment.Info));
+        NotifyMemoryPressure(DXGI_MEMORY_SEGMENT_GROUP_LOCAL, /*sizeOverBudget*/ 0);
+        if (!mIsUMA) {
+            ReturnIfFailed(QueryVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL,
+                                                &mNonLocalVideoMemorySegment.Info));
+            NotifyMemoryPressure(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, /*sizeOverBudget*/ 0);
+        }
+
+        if (localBudget != mLocalVideoMemorySegment.Info.Budget ||
+            nonLocalBudget != mNonLocalVideoMemorySegment.Info.Budget) {
+            mBudgetChangeCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResidencyManager::RegisterMemoryPressureCallback(MEMORY_PRESSURE_CALLBACK callback,
+                                                             void* context,
+                                                             DWORD* cookieOut) {
+        if (callback == nullptr || cookieOut == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        *cookieOut = mNextMemoryPressureCallbackCookie++;
+        mMemoryPressureCallbacks[*cookieOut] = {callback, context};
+
+        return S_OK;
+    }
+
+    HRESULT ResidencyManager::UnregisterMemoryPressureCallback(DWORD cookie) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        if (mMemoryPressureCallbacks.erase(cookie) == 0) {
+            return E_INVALIDARG;
+        }
+
+        return S_OK;
+    }
+
+    void ResidencyManager::NotifyMemoryPressure(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                                uint64_t sizeOverBudget) {
+        VideoMemorySegment* segment = GetVideoMemorySegment(memorySegmentGroup);
+
+        // Evicting to stay within the budget is always reported, since it means heaps are paged.
+        MEMORY_PRESSURE_LEVEL level = MEMORY_PRESSURE_LEVEL_GREEN;
+        if (sizeOverBudget > 0 || segment->Info.CurrentUsage >= segment->Info.Budget) {
+            level = MEMORY_PRESSURE_LEVEL_RED;
+        } else if (segment->Info.CurrentUsage >=
+                   segment->Info.Budget * kDefaultMemoryPressureYellowThreshold) {
+            level = MEMORY_PRESSURE_LEVEL_YELLOW;
+        }
+
+        if (level == segment->PressureLevel && sizeOverBudget == 0) {
+            return;
+        }
+
+        segment->PressureLevel = level;
+
+        MEMORY_PRESSURE_INFO info = {};
+        info.MemorySegmentGroup = memorySegmentGroup;
+        info.Level = level;
+        info.Budget = segment->Info.Budget;
+        info.CurrentUsage = segment->Info.CurrentUsage;
+        info.SizeOverBudget = sizeOverBudget;
+
+        for (const auto& callback : mMemoryPressureCallbacks) {
+            callback.second.first(info, callback.second.second);
+        }
+    }
+
+    void ResidencyManager::NotifyTagQuotaExceeded(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+        uint32_t tag,
+        uint64_t tagUsage,
+        uint64_t tagQuota) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        const VideoMemorySegment* segment = GetVideoMemorySegment(memorySegmentGroup);
+
+        MEMORY_PRESSURE_INFO info = {};
+        info.MemorySegmentGroup = memorySegmentGroup;
+        info.Level = segment->PressureLevel;
+        info.Budget = segment->Info.Budget;
+        info.CurrentUsage = segment->Info.CurrentUsage;
+        info.IsTagQuotaExceeded = true;
+        info.Tag = tag;
+        info.TagUsage = tagUsage;
+        info.TagQuota = tagQuota;
+
+        for (const auto& callback : mMemoryPressureCallbacks) {
+            callback.second.first(info, callback.second.second);
+        }
     }
 
     const char* ResidencyManager::GetTypename() const {
@@ -117,12 +379,18 @@ namespace gpgmm { namespace d3d12 {
 
     // Increments number of locks on a heap to ensure the heap remains resident.
     HRESULT ResidencyManager::LockHeap(Heap* heap) {
-        std::lock_guard<std::recursive_mutex> lock(mMutex);
-
         if (heap == nullptr) {
             return E_INVALIDARG;
         }
 
+        // A heap which is already locked is resident and not in the LRU cache, so only its lock
+        // count changes, which does not need the residency manager to be locked.
+        if (heap->TryAddResidencyLockRef()) {
+            return S_OK;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
         if (!heap->IsResident()) {
             ReturnIfFailed(MakeResident(heap->GetMemorySegmentGroup(), heap->GetSize(), 1,
                                         heap->GetPageable().GetAddressOf()));
@@ -134,6 +402,8 @@ namespace gpgmm { namespace d3d12 {
         }
 
         heap->AddResidencyLockRef();
+        heap->SetEvicted(false);
+        ReclaimOfferedHeap(heap);
 
         return S_OK;
     }
@@ -141,12 +411,17 @@ namespace gpgmm { namespace d3d12 {
     // Decrements number of locks on a heap. When the number of locks becomes zero, the heap is
     // inserted into the LRU cache and becomes eligible for eviction.
     HRESULT ResidencyManager::UnlockHeap(Heap* heap) {
-        std::lock_guard<std::recursive_mutex> lock(mMutex);
-
         if (heap == nullptr) {
             return E_INVALIDARG;
         }
 
+        // If another lock still exists on the heap, nothing further should be done.
+        if (heap->TryReleaseResidencyLock()) {
+            return S_OK;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
         if (!heap->IsResidencyLocked()) {
             return E_FAIL;
         }
@@ -155,10 +430,8 @@ namespace gpgmm { namespace d3d12 {
             return E_FAIL;
         }
 
-        heap->ReleaseResidencyLock();
-
-        // If another lock still exists on the heap, nothing further should be done.
-        if (heap->IsResidencyLocked()) {
+        // Another lock could have been added since, without the residency manager locked.
+        if (!heap->ReleaseResidencyLock()) {
             return S_OK;
         }
 
@@ -189,13 +462,30 @@ namespace gpgmm { namespace d3d12 {
         LRUCache* cache = GetVideoMemorySegmentCache(heap->GetMemorySegmentGroup());
         ASSERT(cache != nullptr);
 
+        // Being last in the cache already counts as the most recent use.
         cache->Append(heap);
+        heap->mIsReferenced = false;
+        heap->SetEvicted(false);
+        ReclaimOfferedHeap(heap);
 
         ASSERT(heap->IsInList());
 
         return S_OK;
     }
 
+    ResidencyManager::VideoMemorySegment* ResidencyManager::GetVideoMemorySegment(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
+        switch (memorySegmentGroup) {
+            case DXGI_MEMORY_SEGMENT_GROUP_LOCAL:
+                return &mLocalVideoMemorySegment;
+            case DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL:
+                return &mNonLocalVideoMemorySegment;
+            default:
+                UNREACHABLE();
+                return nullptr;
+        }
+    }
+
     DXGI_QUERY_VIDEO_MEMORY_INFO* ResidencyManager::GetVideoMemorySegmentInfo(
         const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
         switch (memorySegmentGroup) {
@@ -229,7 +519,7 @@ namespace gpgmm { namespace d3d12 {
         const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
         uint64_t reservation,
         uint64_t* reservationOut) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResidencyManager.SetVideoMemoryReservation");
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.SetVideoMemoryReservation");
 
         std::lock_guard<std::recursive_mutex> lock(mMutex);
 
@@ -253,6 +543,18 @@ namespace gpgmm { namespace d3d12 {
         ReturnIfFailed(
             mAdapter->QueryVideoMemoryInfo(0, memorySegmentGroup, &queryVideoMemoryInfo));
 
+        const uint64_t budgetOverride =
+            mVideoMemoryBudgetOverride[memorySegmentGroup].load(std::memory_order_relaxed);
+        if (budgetOverride > 0) {
+            queryVideoMemoryInfo.Budget = budgetOverride;
+        }
+
+        // Recorded so a replay of the capture can follow the same budget, see
+        // SetVideoMemoryBudgetOverride.
+        GPGMM_TRACE_EVENT_OBJECT_CALL(
+            "ResidencyManager.QueryVideoMemoryInfo",
+            (QUERY_VIDEO_MEMORY_INFO_DESC{memorySegmentGroup, queryVideoMemoryInfo}));
+
         // The video memory budget provided by QueryVideoMemoryInfo is defined by the operating
         // system, and may be lower than expected in certain scenarios. Under memory pressure, we
         // cap the external reservation to half the available budget, which prevents the external
@@ -265,8 +567,16 @@ namespace gpgmm { namespace d3d12 {
         videoMemoryInfo->CurrentUsage =
             queryVideoMemoryInfo.CurrentUsage - videoMemoryInfo->CurrentReservation;
 
-        // If we're restricting the budget, leave the budget as is.
+        // If we're restricting the budget, leave the budget as is, unless overridden by a lower
+        // one.
         if (mTotalResourceBudgetLimit > 0) {
+            const VideoMemorySegment& segment =
+                (memorySegmentGroup == DXGI_MEMORY_SEGMENT_GROUP_LOCAL)
+                    ? mLocalVideoMemorySegment
+                    : mNonLocalVideoMemorySegment;
+            videoMemoryInfo->Budget = (budgetOverride > 0)
+                                          ? std::min(budgetOverride, segment.LimitedBudget)
+                                          : segment.LimitedBudget;
             return S_OK;
         }
 
@@ -283,19 +593,106 @@ namespace gpgmm { namespace d3d12 {
     HRESULT ResidencyManager::Evict(uint64_t sizeToMakeResident,
                                     const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
                                     uint64_t* sizeEvictedOut) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResidencyManager.Evict");
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.Evict");
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        if (!mEvictInBackground) {
+            return EvictInternal(sizeToMakeResident, memorySegmentGroup, /*waitForGPU*/ true,
+                                 sizeEvictedOut, nullptr, nullptr);
+        }
+
+        Fence* fenceToWaitFor = nullptr;
+        uint64_t fenceValueToWaitFor = 0;
+        ReturnIfFailed(EvictInternal(sizeToMakeResident, memorySegmentGroup,
+                                     /*waitForGPU*/ false, sizeEvictedOut, &fenceToWaitFor,
+                                     &fenceValueToWaitFor));
+
+        // Evict the remainder once the GPU is done with it, rather than stalling now.
+        if (fenceToWaitFor != nullptr) {
+            EvictAsync(sizeToMakeResident, memorySegmentGroup);
+        }
 
+        return S_OK;
+    }
+
+    bool ResidencyManager::IsWithinBudget(uint64_t sizeToMakeResident,
+                                          const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
         std::lock_guard<std::recursive_mutex> lock(mMutex);
 
         DXGI_QUERY_VIDEO_MEMORY_INFO* videoMemorySegmentInfo =
             GetVideoMemorySegmentInfo(memorySegmentGroup);
-        ReturnIfFailed(QueryVideoMemoryInfo(memorySegmentGroup, videoMemorySegmentInfo));
+        if (!mIsVideoMemoryInfoCached &&
+            FAILED(QueryVideoMemoryInfo(memorySegmentGroup, videoMemorySegmentInfo))) {
+            return false;
+        }
+
+        return sizeToMakeResident + videoMemorySegmentInfo->CurrentUsage <
+               videoMemorySegmentInfo->Budget;
+    }
+
+    std::shared_ptr<Event> ResidencyManager::EvictAsync(
+        uint64_t sizeToMakeResident,
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.EvictAsync");
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        // Only one background eviction per segment is needed since each evicts in LRU order.
+        VideoMemorySegment* segment = GetVideoMemorySegment(memorySegmentGroup);
+        if (segment->EvictionEvent != nullptr && !segment->EvictionEvent->IsSignaled()) {
+            return segment->EvictionEvent;
+        }
+
+        segment->EvictionEvent = ThreadPool::PostTask(
+            mThreadPool,
+            std::make_shared<EvictTask>(this, sizeToMakeResident, memorySegmentGroup),
+            TaskClass::kEviction);
+        return segment->EvictionEvent;
+    }
+
+    HRESULT ResidencyManager::EvictInternal(uint64_t sizeToMakeResident,
+                                            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                            bool waitForGPU,
+                                            uint64_t* sizeEvictedOut,
+                                            Fence** fenceToWaitForOut,
+                                            uint64_t* fenceValueToWaitForOut) {
+        ASSERT(waitForGPU || (fenceToWaitForOut != nullptr && fenceValueToWaitForOut != nullptr));
+
+        DXGI_QUERY_VIDEO_MEMORY_INFO* videoMemorySegmentInfo =
+            GetVideoMemorySegmentInfo(memorySegmentGroup);
+        if (!mIsVideoMemoryInfoCached) {
+            ReturnIfFailed(QueryVideoMemoryInfo(memorySegmentGroup, videoMemorySegmentInfo));
+        }
 
         const uint64_t currentUsageAfterMakeResident =
             sizeToMakeResident + videoMemorySegmentInfo->CurrentUsage;
 
-        // Return when we can call MakeResident and remain under budget.
+        // Return when we can call MakeResident and remain under budget. Under pressure, pooled
+        // heaps are offered ahead of being over budget, so heaps in use are less likely to be
+        // evicted later.
         if (currentUsageAfterMakeResident < videoMemorySegmentInfo->Budget) {
+            const uint64_t pressureUsage = static_cast<uint64_t>(
+                videoMemorySegmentInfo->Budget * kDefaultMemoryPressureYellowThreshold);
+            if (mOfferPooledHeaps && currentUsageAfterMakeResident >= pressureUsage) {
+                std::vector<ID3D12Pageable*> heapsToOffer;
+                const uint64_t sizeOffered =
+                    OfferPooledHeaps(memorySegmentGroup,
+                                     currentUsageAfterMakeResident - pressureUsage, &heapsToOffer);
+                if (!heapsToOffer.empty()) {
+                    const uint64_t evictStartTicks = mPagingTimer->GetTicks();
+                    ReturnIfFailed(mDevice->Evict(static_cast<uint32_t>(heapsToOffer.size()),
+                                                  heapsToOffer.data()));
+                    RecordPagingLatency(&PagingCounters::EvictTicks, &mEvictLatency,
+                                        "GPU evict latency (us)", evictStartTicks);
+                    RecordPaging(&PagingCounters::EvictedCount, heapsToOffer.size());
+                    RecordPaging(&PagingCounters::EvictedUsage, sizeOffered);
+                    videoMemorySegmentInfo->CurrentUsage -=
+                        std::min(sizeOffered, videoMemorySegmentInfo->CurrentUsage);
+                }
+            }
+
+            NotifyMemoryPressure(memorySegmentGroup, /*sizeOverBudget*/ 0);
             return S_OK;
         }
 
@@ -303,34 +700,70 @@ namespace gpgmm { namespace d3d12 {
         uint64_t sizeNeededToBeUnderBudget =
             currentUsageAfterMakeResident - videoMemorySegmentInfo->Budget;
         uint64_t sizeEvicted = 0;
+        uint64_t heapCountWaitedFor = 0;
+        uint64_t sizeWaitedFor = 0;
+
+        std::vector<Fence::FenceValue> fenceValuesToWaitFor;
+        Fence::FenceValue skippedFenceValueToWaitFor = {nullptr, 0};
+
+        // Shrink the pools first by offering their heaps, before evicting any heap which could
+        // still be used.
+        sizeEvicted +=
+            OfferPooledHeaps(memorySegmentGroup, sizeNeededToBeUnderBudget, &resourcesToEvict);
+
+        LRUCache* cache = GetVideoMemorySegmentCache(memorySegmentGroup);
+        ASSERT(cache != nullptr);
+
+        AgeResidencyCache(cache);
+
         while (sizeEvicted < sizeNeededToBeUnderBudget) {
             // If the cache is empty, allow execution to continue. Note that fully
             // emptying the cache is undesirable, because it can mean either 1) the cache is not
             // accurately accounting for GPU allocations, or 2) an external component is
             // using all of the budget and is starving us, which will cause thrash.
-            LRUCache* cache = GetVideoMemorySegmentCache(memorySegmentGroup);
-            ASSERT(cache != nullptr);
-
             if (cache->empty()) {
                 break;
             }
 
-            Heap* heap = cache->head()->value();
-            const uint64_t lastUsedFenceValue = heap->GetLastUsedFenceValue();
-
             // If the next candidate for eviction was inserted into the cache during the current
             // submission, it is because more memory is being used in a single command list than is
             // available. In this scenario, we cannot make any more resources resident and thrashing
             // must occur.
-            if (lastUsedFenceValue == mFence->GetCurrentFence()) {
+            Heap* heap =
+                GetNextHeapToEvict(cache, (waitForGPU) ? nullptr : &skippedFenceValueToWaitFor);
+            if (heap == nullptr || IsUsedByCurrentSubmission(heap)) {
                 break;
             }
 
-            // We must ensure that any previous use of a resource has completed before the resource
-            // can be evicted.
-            ReturnIfFailed(mFence->WaitFor(lastUsedFenceValue));
+            // We must ensure that any previous use of a resource has completed, on every queue,
+            // before the resource can be evicted. Only the latest value of each fence is waited
+            // for, once, after every heap to evict was found.
+            bool isWaitedFor = false;
+            for (const Heap::FenceValue& lastUsedFenceValue : heap->GetLastUsedFenceValues()) {
+                Fence* fence = lastUsedFenceValue.first;
+                if (fence->IsCompleted(lastUsedFenceValue.second)) {
+                    continue;
+                }
+
+                ASSERT(waitForGPU);
+                isWaitedFor = true;
+                auto it = std::find_if(
+                    fenceValuesToWaitFor.begin(), fenceValuesToWaitFor.end(),
+                    [fence](const Fence::FenceValue& value) { return value.first == fence; });
+                if (it == fenceValuesToWaitFor.end()) {
+                    fenceValuesToWaitFor.push_back(lastUsedFenceValue);
+                } else {
+                    it->second = std::max(it->second, lastUsedFenceValue.second);
+                }
+            }
+
+            if (isWaitedFor) {
+                heapCountWaitedFor++;
+                sizeWaitedFor += heap->GetSize();
+            }
 
             heap->RemoveFromList();
+            heap->SetEvicted(true);
 
             sizeEvicted += heap->GetSize();
             resourcesToEvict.push_back(heap->GetPageable().Get());
@@ -338,17 +771,119 @@ namespace gpgmm { namespace d3d12 {
             GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(heap, heap->GetInfo());
         }
 
+        // Heaps still used by the GPU were skipped, so the caller must wait before evicting more.
+        if (!waitForGPU && sizeEvicted < sizeNeededToBeUnderBudget &&
+            skippedFenceValueToWaitFor.first != nullptr) {
+            *fenceToWaitForOut = skippedFenceValueToWaitFor.first;
+            *fenceValueToWaitForOut = skippedFenceValueToWaitFor.second;
+        }
+
+        if (!fenceValuesToWaitFor.empty()) {
+            const uint64_t waitStartTicks = mPagingTimer->GetTicks();
+            ReturnIfFailed(Fence::WaitForAll(mDevice.Get(), fenceValuesToWaitFor));
+            RecordPagingLatency(&PagingCounters::FenceWaitTicks, &mFenceWaitLatency,
+                                "GPU fence wait latency (us)", waitStartTicks);
+            RecordPaging(&PagingCounters::FenceWaitCount, 1);
+            RecordPaging(&PagingCounters::FenceWaitHeapCount, heapCountWaitedFor);
+            RecordPaging(&PagingCounters::FenceWaitUsage, sizeWaitedFor);
+        }
+
         if (resourcesToEvict.size() > 0) {
             const uint32_t numOfResources = static_cast<uint32_t>(resourcesToEvict.size());
+            const uint64_t evictStartTicks = mPagingTimer->GetTicks();
             ReturnIfFailed(mDevice->Evict(numOfResources, resourcesToEvict.data()));
+            RecordPagingLatency(&PagingCounters::EvictTicks, &mEvictLatency,
+                                "GPU evict latency (us)", evictStartTicks);
+            RecordPaging(&PagingCounters::EvictedCount, numOfResources);
+            RecordPaging(&PagingCounters::EvictedUsage, sizeEvicted);
+
+            // Age the use counts of the heaps which stay resident, so heaps used often long ago
+            // do not stay resident forever.
+            if (mEvictionPolicy == EVICTION_POLICY_LFU) {
+                for (Heap* heap : *cache) {
+                    heap->DecayAccessCount();
+                }
+            }
+
+            videoMemorySegmentInfo->CurrentUsage -=
+                std::min(sizeEvicted, videoMemorySegmentInfo->CurrentUsage);
         }
 
+        NotifyMemoryPressure(memorySegmentGroup, sizeNeededToBeUnderBudget);
+
         if (sizeEvictedOut != nullptr) {
             *sizeEvictedOut = sizeEvicted;
         }
         return S_OK;
     }
 
+    void ResidencyManager::AgeResidencyCache(LRUCache* cache) {
+        // Visit each heap once, since the heaps moved are visited again otherwise.
+        const size_t heapCount = cache->size();
+        LinkNode<Heap>* node = cache->head();
+        for (size_t i = 0; i < heapCount; i++) {
+            LinkNode<Heap>* next = node->next();
+            Heap* heap = node->value();
+            if (heap->mIsReferenced) {
+                heap->mIsReferenced = false;
+                cache->Splice(cache->end(), heap);
+            }
+            node = next;
+        }
+    }
+
+    bool ResidencyManager::IsUsedByCurrentSubmission(Heap* heap) const {
+        for (const Heap::FenceValue& lastUsedFenceValue : heap->GetLastUsedFenceValues()) {
+            if (lastUsedFenceValue.second == lastUsedFenceValue.first->GetCurrentFence()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Heap* ResidencyManager::GetNextHeapToEvict(
+        LRUCache* cache,
+        Fence::FenceValue* skippedFenceValueToWaitForOut) const {
+        // Heaps used by the current submission cannot be evicted, so only the others are
+        // candidates. The cache was aged before evicting, so it is in LRU order, and the first
+        // least used heap is also the least recently used among them. Heaps inserted by the
+        // current submission come before those it only referenced, so heaps after the first one
+        // used by the current submission can still be evicted. Heaps of lower residency priority
+        // are always evicted first.
+        Heap* heapToEvict = nullptr;
+        for (auto node = cache->head(); node != cache->end(); node = node->next()) {
+            Heap* heap = node->value();
+            if (IsUsedByCurrentSubmission(heap)) {
+                continue;
+            }
+
+            if (skippedFenceValueToWaitForOut != nullptr) {
+                const Fence::FenceValue* fenceValue = GetFirstIncompleteFenceValue(heap);
+                if (fenceValue != nullptr) {
+                    if (skippedFenceValueToWaitForOut->first == nullptr) {
+                        *skippedFenceValueToWaitForOut = *fenceValue;
+                    }
+                    continue;
+                }
+            }
+
+            if (heapToEvict == nullptr) {
+                heapToEvict = heap;
+                continue;
+            }
+
+            const uint32_t priority = static_cast<uint32_t>(heap->GetResidencyPriority());
+            const uint32_t priorityToEvict =
+                static_cast<uint32_t>(heapToEvict->GetResidencyPriority());
+            if (priority < priorityToEvict ||
+                (priority == priorityToEvict && mEvictionPolicy == EVICTION_POLICY_LFU &&
+                 heap->GetAccessCount() < heapToEvict->GetAccessCount())) {
+                heapToEvict = heap;
+            }
+        }
+        return heapToEvict;
+    }
+
     // Given a list of heaps that are pending usage, this function will estimate memory needed,
     // evict resources until enough space is available, then make resident any heaps scheduled for
     // usage.
@@ -356,106 +891,489 @@ namespace gpgmm { namespace d3d12 {
                                                   ID3D12CommandList* const* commandLists,
                                                   ResidencySet* const* residencySets,
                                                   uint32_t count) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResidencyManager.ExecuteCommandLists");
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.ExecuteCommandLists");
 
         std::lock_guard<std::recursive_mutex> lock(mMutex);
 
-        // TODO: support multiple command lists.
-        if (count > 1) {
-            return E_NOTIMPL;
+        if (count == 0) {
+            return E_INVALIDARG;
         }
 
-        ID3D12CommandList* commandList = commandLists[0];
-        ResidencySet* residencySet = residencySets[0];
+        Fence* fence = nullptr;
+        ReturnIfFailed(GetOrCreateFence(queue, &fence));
 
+        std::vector<Heap*> usedHeaps;
         std::vector<ID3D12Pageable*> localHeapsToMakeResident;
         std::vector<ID3D12Pageable*> nonLocalHeapsToMakeResident;
         uint64_t localSizeToMakeResident = 0;
         uint64_t nonLocalSizeToMakeResident = 0;
 
-        for (size_t i = 0; i < residencySet->mToMakeResident.size(); i++) {
-            Heap* heap = residencySet->mToMakeResident[i];
-
-            // Heaps that are locked resident are not tracked in the LRU cache.
-            if (heap->IsResidencyLocked()) {
+        // Heaps referenced by more than one residency set are only made resident once since the
+        // first set inserts them into the LRU cache.
+        for (uint32_t setIndex = 0; setIndex < count; setIndex++) {
+            ResidencySet* residencySet = residencySets[setIndex];
+            if (residencySet == nullptr) {
                 continue;
             }
 
-            const bool& heapIsInResidencyCache = heap->IsInResidencyLRUCache();
-            if (heapIsInResidencyCache) {
-                // If the heap is already in the LRU, we must remove it and append again below to
-                // update its position in the LRU.
-                heap->RemoveFromList();
-            } else {
-                if (heap->GetMemorySegmentGroup() == DXGI_MEMORY_SEGMENT_GROUP_LOCAL) {
-                    localSizeToMakeResident += heap->GetSize();
-                    localHeapsToMakeResident.push_back(heap->GetPageable().Get());
-                } else {
-                    nonLocalSizeToMakeResident += heap->GetSize();
-                    nonLocalHeapsToMakeResident.push_back(heap->GetPageable().Get());
+            residencySet->MergeShards();
+
+            for (Heap* heap : residencySet->mToMakeResident) {
+                // Heaps that are locked resident are not tracked in the LRU cache.
+                if (heap->IsResidencyLocked()) {
+                    continue;
                 }
-            }
 
-            // If we submit a command list to the GPU, we must ensure that heaps referenced by that
-            // command list stay resident at least until that command list has finished execution.
-            // Setting this serial unnecessarily can leave the LRU in a state where nothing is
-            // eligible for eviction, even though some evictions may be possible.
-            heap->SetLastUsedFenceValue(mFence->GetCurrentFence());
+                const bool& heapIsInResidencyCache = heap->IsInResidencyLRUCache();
+                if (heapIsInResidencyCache) {
+                    // Rather than moving the heap to the end of the LRU, which writes to the
+                    // neighbours of every heap used, the heap is only marked as referenced. The
+                    // LRU is only put back in order once heaps must be evicted.
+                    heap->mIsReferenced = true;
+                } else {
+                    if (heap->GetMemorySegmentGroup() == DXGI_MEMORY_SEGMENT_GROUP_LOCAL) {
+                        localSizeToMakeResident += heap->GetSize();
+                        localHeapsToMakeResident.push_back(heap->GetPageable().Get());
+                    } else {
+                        nonLocalSizeToMakeResident += heap->GetSize();
+                        nonLocalHeapsToMakeResident.push_back(heap->GetPageable().Get());
+                    }
+                }
 
-            // Insert the heap into the appropriate LRU.
-            InsertHeap(heap);
+                // If we submit a command list to the GPU, we must ensure that heaps referenced by
+                // that command list stay resident at least until that command list has finished
+                // execution. Setting this serial unnecessarily can leave the LRU in a state where
+                // nothing is eligible for eviction, even though some evictions may be possible.
+                // A heap could be in more than one residency set (or the same set more than
+                // once), but each submission only counts as one use.
+                if (!IsUsedByCurrentSubmission(heap)) {
+                    heap->IncrementAccessCount();
+                    if (mPredictionSubmissionCount > 0) {
+                        usedHeaps.push_back(heap);
+                    }
+                }
+                heap->SetLastUsedFenceValue(fence, fence->GetCurrentFence());
 
-            // Do not re-record the heap if only it's position in the cache was updated.
-            if (heapIsInResidencyCache) {
-                GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(heap, heap->GetInfo());
+                // Insert the heap into the appropriate LRU.
+                if (!heapIsInResidencyCache) {
+                    InsertHeap(heap);
+                } else {
+                    GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(heap, heap->GetInfo());
+                }
             }
         }
 
+        // Both segment groups must be under budget before either is made resident.
+        if (localSizeToMakeResident > 0) {
+            ReturnIfFailed(Evict(localSizeToMakeResident, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+        }
+
+        if (nonLocalSizeToMakeResident > 0) {
+            ReturnIfFailed(Evict(nonLocalSizeToMakeResident, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL));
+        }
+
+        Fence* residencyFence = mResidencyFence.get();
         if (localSizeToMakeResident > 0) {
-            const uint32_t numOfresources = static_cast<uint32_t>(localHeapsToMakeResident.size());
-            ReturnIfFailed(MakeResident(DXGI_MEMORY_SEGMENT_GROUP_LOCAL, localSizeToMakeResident,
-                                        numOfresources, localHeapsToMakeResident.data()));
-        } else if (nonLocalSizeToMakeResident > 0) {
+            const uint32_t numOfResources = static_cast<uint32_t>(localHeapsToMakeResident.size());
+            ReturnIfFailed(MakeResidentWithRetry(DXGI_MEMORY_SEGMENT_GROUP_LOCAL,
+                                                 localSizeToMakeResident, numOfResources,
+                                                 localHeapsToMakeResident.data(), residencyFence));
+        }
+
+        if (nonLocalSizeToMakeResident > 0) {
             const uint32_t numOfResources =
                 static_cast<uint32_t>(nonLocalHeapsToMakeResident.size());
-            ReturnIfFailed(MakeResident(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL,
-                                        nonLocalSizeToMakeResident, numOfResources,
-                                        nonLocalHeapsToMakeResident.data()));
+            ReturnIfFailed(MakeResidentWithRetry(
+                DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, nonLocalSizeToMakeResident, numOfResources,
+                nonLocalHeapsToMakeResident.data(), residencyFence));
+        }
+
+        // The command lists must not execute until the heaps they use finished paging in,
+        // including heaps prefetched by an earlier submission.
+        if (residencyFence != nullptr &&
+            !residencyFence->IsCompleted(residencyFence->GetLastSignaledFence())) {
+            ReturnIfFailed(residencyFence->Wait(queue));
+        }
+
+        queue->ExecuteCommandLists(count, commandLists);
+        ReturnIfFailed(fence->Signal(queue));
+
+        if (mPredictionSubmissionCount > 0) {
+            ReturnIfFailed(RecordSubmissionAndPrefetch(queue, std::move(usedHeaps)));
         }
 
-        queue->ExecuteCommandLists(count, &commandList);
-        ReturnIfFailed(mFence->Signal(queue));
+        if (mReservationSubmissionCount > 0) {
+            ReturnIfFailed(UpdateAutoVideoMemoryReservation(DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+            if (!mIsUMA) {
+                ReturnIfFailed(
+                    UpdateAutoVideoMemoryReservation(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL));
+            }
+        }
+
+        // Stay ahead of the budget by evicting heaps once the GPU is done with them, so the next
+        // MakeResident is less likely to stall.
+        if (mEvictInBackground) {
+            EvictAsync(mVideoMemoryEvictSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+            if (nonLocalSizeToMakeResident > 0) {
+                EvictAsync(mVideoMemoryEvictSize, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL);
+            }
+        }
 
         return S_OK;
     }
 
+    HRESULT ResidencyManager::UpdateAutoVideoMemoryReservation(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
+        VideoMemorySegment* segment = GetVideoMemorySegment(memorySegmentGroup);
+
+        segment->UsageHistory.push_back(segment->Info.CurrentUsage);
+        if (segment->UsageHistory.size() > mReservationSubmissionCount) {
+            segment->UsageHistory.pop_front();
+        }
+
+        // Rounded up to the evict size so small changes in usage do not re-request the
+        // reservation every submission.
+        const uint64_t peakUsage =
+            *std::max_element(segment->UsageHistory.begin(), segment->UsageHistory.end());
+        uint64_t reservation = AlignTo(peakUsage, mVideoMemoryEvictSize);
+        if (reservation == segment->AutoReservation) {
+            return S_OK;
+        }
+
+        // The OS rejects reservations larger than what is available.
+        DXGI_QUERY_VIDEO_MEMORY_INFO queryVideoMemoryInfo;
+        ReturnIfFailed(
+            mAdapter->QueryVideoMemoryInfo(0, memorySegmentGroup, &queryVideoMemoryInfo));
+        reservation = std::min(reservation, queryVideoMemoryInfo.AvailableForReservation);
+        if (reservation == segment->AutoReservation) {
+            return S_OK;
+        }
+
+        ReturnIfFailed(mAdapter->SetVideoMemoryReservation(0, memorySegmentGroup, reservation));
+        segment->AutoReservation = reservation;
+
+        return S_OK;
+    }
+
+    bool ResidencyManager::IsCompletedOnAllQueues(Heap* heap) const {
+        return GetFirstIncompleteFenceValue(heap) == nullptr;
+    }
+
+    const Fence::FenceValue* ResidencyManager::GetFirstIncompleteFenceValue(Heap* heap) const {
+        for (const Heap::FenceValue& lastUsedFenceValue : heap->GetLastUsedFenceValues()) {
+            if (!lastUsedFenceValue.first->IsCompleted(lastUsedFenceValue.second)) {
+                return &lastUsedFenceValue;
+            }
+        }
+        return nullptr;
+    }
+
+    // Each queue executes independently, so each needs its own fence to know when heaps are no
+    // longer being used by it.
+    HRESULT ResidencyManager::GetOrCreateFence(ID3D12CommandQueue* queue, Fence** fenceOut) {
+        auto it = mQueueFences.find(queue);
+        if (it == mQueueFences.end()) {
+            Fence* fence = nullptr;
+            ReturnIfFailed(Fence::CreateFence(mDevice, 0, &fence));
+            it = mQueueFences.emplace(queue, std::unique_ptr<Fence>(fence)).first;
+        }
+
+        *fenceOut = it->second.get();
+        return S_OK;
+    }
+
     // Note that MakeResident is a synchronous function and can add a significant
     // overhead to command recording. In the future, it may be possible to decrease this
     // overhead by using MakeResident on a secondary thread, or by instead making use of
     // the EnqueueMakeResident function (which is not available on all Windows 10
     // platforms).
+    // Submissions tend to repeat (ex. every frame), so the heaps used by the submission
+    // |mPredictionSubmissionCount| submissions before the next are likely used by it too. Those
+    // which were evicted since are made resident now, rather than when next submitted, but only
+    // within the budget since evicting would make the prediction cost more than it saves.
+    HRESULT ResidencyManager::RecordSubmissionAndPrefetch(ID3D12CommandQueue* queue,
+                                                          std::vector<Heap*> usedHeaps) {
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.RecordSubmissionAndPrefetch");
+
+        std::deque<std::vector<Heap*>>& queueHistory = mSubmissionHistory[queue];
+
+        for (Heap* heap : usedHeaps) {
+            heap->mSubmissionHistoryOwner = this;
+            heap->mSubmissionHistoryRefs++;
+        }
+        queueHistory.push_back(std::move(usedHeaps));
+
+        if (queueHistory.size() > mPredictionSubmissionCount) {
+            for (Heap* heap : queueHistory.front()) {
+                if (--heap->mSubmissionHistoryRefs == 0) {
+                    heap->mSubmissionHistoryOwner = nullptr;
+                }
+            }
+            queueHistory.pop_front();
+        }
+
+        if (queueHistory.size() < mPredictionSubmissionCount) {
+            return S_OK;
+        }
+
+        for (const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup :
+             {DXGI_MEMORY_SEGMENT_GROUP_LOCAL, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL}) {
+            DXGI_QUERY_VIDEO_MEMORY_INFO* videoMemorySegmentInfo =
+                GetVideoMemorySegmentInfo(memorySegmentGroup);
+            if (!mIsVideoMemoryInfoCached) {
+                ReturnIfFailed(QueryVideoMemoryInfo(memorySegmentGroup, videoMemorySegmentInfo));
+            }
+
+            std::vector<Heap*> heapsToPrefetch;
+            std::vector<ID3D12Pageable*> pageablesToPrefetch;
+            uint64_t sizeToPrefetch = 0;
+            for (Heap* heap : queueHistory.front()) {
+                if (heap->GetMemorySegmentGroup() != memorySegmentGroup || heap->IsResident()) {
+                    continue;
+                }
+
+                if (videoMemorySegmentInfo->CurrentUsage + sizeToPrefetch + heap->GetSize() >
+                    videoMemorySegmentInfo->Budget) {
+                    continue;
+                }
+
+                sizeToPrefetch += heap->GetSize();
+                heapsToPrefetch.push_back(heap);
+                pageablesToPrefetch.push_back(heap->GetPageable().Get());
+            }
+
+            if (heapsToPrefetch.empty()) {
+                continue;
+            }
+
+            const uint32_t numOfPageables = static_cast<uint32_t>(pageablesToPrefetch.size());
+            const uint64_t makeResidentStartTicks = mPagingTimer->GetTicks();
+            if (mResidencyFence != nullptr) {
+                ReturnIfFailed(mResidencyFence->EnqueueMakeResident(
+                    mDevice3.Get(), numOfPageables, pageablesToPrefetch.data()));
+            } else {
+                ReturnIfFailed(mDevice->MakeResident(numOfPageables, pageablesToPrefetch.data()));
+            }
+            RecordPagingLatency(&PagingCounters::MakeResidentTicks, &mMakeResidentLatency,
+                                "GPU make resident latency (us)", makeResidentStartTicks);
+            RecordPaging(&PagingCounters::MadeResidentCount, numOfPageables);
+            RecordPaging(&PagingCounters::MadeResidentUsage, sizeToPrefetch);
+
+            videoMemorySegmentInfo->CurrentUsage += sizeToPrefetch;
+
+            for (Heap* heap : heapsToPrefetch) {
+                ReturnIfFailed(InsertHeap(heap));
+            }
+        }
+
+        return S_OK;
+    }
+
+    void ResidencyManager::RemoveFromSubmissionHistory(Heap* heap) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        for (auto& queueHistory : mSubmissionHistory) {
+            for (std::vector<Heap*>& usedHeaps : queueHistory.second) {
+                usedHeaps.erase(std::remove(usedHeaps.begin(), usedHeaps.end(), heap),
+                                usedHeaps.end());
+            }
+        }
+        heap->mSubmissionHistoryOwner = nullptr;
+        heap->mSubmissionHistoryRefs = 0;
+    }
+
+    uint64_t ResidencyManager::OfferPooledHeaps(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                                uint64_t sizeToOffer,
+                                                std::vector<ID3D12Pageable*>* heapsToEvictOut) {
+        VideoMemorySegment* segment = GetVideoMemorySegment(memorySegmentGroup);
+
+        uint64_t sizeOffered = 0;
+        for (auto node = segment->cache.head(); node != segment->cache.end();) {
+            if (sizeOffered >= sizeToOffer) {
+                break;
+            }
+
+            Heap* heap = node->value();
+            node = node->next();
+
+            if (!IsPooledAndUnused(heap) || !IsCompletedOnAllQueues(heap)) {
+                continue;
+            }
+
+            heap->RemoveFromList();
+            heap->SetEvicted(true);
+
+            heap->mOfferedBy = this;
+            segment->OfferedHeaps.insert(heap);
+            segment->OfferedUsage += heap->GetSize();
+
+            sizeOffered += heap->GetSize();
+            heapsToEvictOut->push_back(heap->GetPageable().Get());
+
+            GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(heap, heap->GetInfo());
+        }
+
+        return sizeOffered;
+    }
+
+    void ResidencyManager::ReclaimOfferedHeap(Heap* heap) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        if (heap->mOfferedBy != this) {
+            return;
+        }
+
+        VideoMemorySegment* segment = GetVideoMemorySegment(heap->GetMemorySegmentGroup());
+        segment->OfferedHeaps.erase(heap);
+        segment->OfferedUsage -= heap->GetSize();
+        heap->mOfferedBy = nullptr;
+    }
+
+    uint64_t ResidencyManager::GetOfferedUsage(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        return GetVideoMemorySegment(memorySegmentGroup)->OfferedUsage;
+    }
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO ResidencyManager::GetVideoMemoryInfo(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+        return *GetVideoMemorySegmentInfo(memorySegmentGroup);
+    }
+
+    HRESULT ResidencyManager::SetVideoMemoryBudgetOverride(
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+        uint64_t budget) {
+        TRACE_EVENT0(TraceEventCategory::Residency,
+                     "ResidencyManager.SetVideoMemoryBudgetOverride");
+
+        if (memorySegmentGroup != DXGI_MEMORY_SEGMENT_GROUP_LOCAL &&
+            memorySegmentGroup != DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(mMutex);
+
+        mVideoMemoryBudgetOverride[memorySegmentGroup].store(budget, std::memory_order_relaxed);
+
+        // Applied right away, even when the budget is cached until the OS notifies a change.
+        return UpdateVideoMemorySegments();
+    }
+
     HRESULT ResidencyManager::MakeResident(const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
                                            uint64_t sizeToMakeResident,
                                            uint32_t numberOfObjectsToMakeResident,
                                            ID3D12Pageable** allocations) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResidencyManager.MakeResident");
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.MakeResident");
 
         ReturnIfFailed(Evict(sizeToMakeResident, memorySegmentGroup, nullptr));
 
+        return MakeResidentWithRetry(memorySegmentGroup, sizeToMakeResident,
+                                     numberOfObjectsToMakeResident, allocations,
+                                     /*residencyFence*/ nullptr);
+    }
+
+    HRESULT ResidencyManager::MakeResidentWithRetry(
+        const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
+        uint64_t sizeToMakeResident,
+        uint32_t numberOfObjectsToMakeResident,
+        ID3D12Pageable** allocations,
+        Fence* residencyFence) {
         // A MakeResident call can fail if there's not enough available memory. This
         // could occur when there's significant fragmentation or if the allocation size
         // estimates are incorrect. We may be able to continue execution by evicting some
         // more memory and calling MakeResident again.
-        while (FAILED(mDevice->MakeResident(numberOfObjectsToMakeResident, allocations))) {
+        while (true) {
+            const uint64_t makeResidentStartTicks = mPagingTimer->GetTicks();
+            const HRESULT hr = (residencyFence != nullptr)
+                                   ? residencyFence->EnqueueMakeResident(
+                                         mDevice3.Get(), numberOfObjectsToMakeResident, allocations)
+                                   : mDevice->MakeResident(numberOfObjectsToMakeResident,
+                                                           allocations);
+            RecordPagingLatency(&PagingCounters::MakeResidentTicks, &mMakeResidentLatency,
+                                "GPU make resident latency (us)", makeResidentStartTicks);
+            if (SUCCEEDED(hr)) {
+                break;
+            }
+
             // If nothing can be evicted after MakeResident has failed, we cannot continue
             // execution and must throw a fatal error.
             uint64_t sizeEvicted = 0;
-            ReturnIfFailed(Evict(mVideoMemoryEvictSize, memorySegmentGroup, &sizeEvicted));
+            ReturnIfFailed(EvictInternal(mVideoMemoryEvictSize, memorySegmentGroup,
+                                         /*waitForGPU*/ true, &sizeEvicted, nullptr, nullptr));
             if (sizeEvicted == 0) {
                 return E_OUTOFMEMORY;
             }
         }
 
+        RecordPaging(&PagingCounters::MadeResidentCount, numberOfObjectsToMakeResident);
+        RecordPaging(&PagingCounters::MadeResidentUsage, sizeToMakeResident);
+
+        // Account for the usage until the video memory info is next updated.
+        GetVideoMemorySegmentInfo(memorySegmentGroup)->CurrentUsage += sizeToMakeResident;
+        NotifyMemoryPressure(memorySegmentGroup, /*sizeOverBudget*/ 0);
+
         return S_OK;
     }
+
+    RESIDENCY_MANAGER_STATS ResidencyManager::QueryStats() const {
+        RESIDENCY_MANAGER_STATS stats = {};
+        stats.Total = GetPagingStats(mTotalPagingCounters);
+        stats.Frame = GetPagingStats(mFramePagingCounters);
+        stats.MakeResidentLatency = mMakeResidentLatency.QueryInfo();
+        stats.EvictLatency = mEvictLatency.QueryInfo();
+        stats.FenceWaitLatency = mFenceWaitLatency.QueryInfo();
+        return stats;
+    }
+
+    void ResidencyManager::ResetFrameStats() {
+        mFramePagingCounters.MadeResidentCount.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.MadeResidentUsage.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.EvictedCount.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.EvictedUsage.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.FenceWaitHeapCount.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.FenceWaitUsage.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.FenceWaitCount.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.MakeResidentTicks.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.EvictTicks.store(0, std::memory_order_relaxed);
+        mFramePagingCounters.FenceWaitTicks.store(0, std::memory_order_relaxed);
+    }
+
+    void ResidencyManager::RecordPaging(std::atomic<uint64_t> PagingCounters::*counter,
+                                        uint64_t value) {
+        (mTotalPagingCounters.*counter).fetch_add(value, std::memory_order_relaxed);
+        (mFramePagingCounters.*counter).fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void ResidencyManager::RecordPagingLatency(std::atomic<uint64_t> PagingCounters::*ticksCounter,
+                                               LatencyHistogram* latency,
+                                               const char* traceCounterName,
+                                               uint64_t startTicks) {
+        const uint64_t ticks = mPagingTimer->GetTicks() - startTicks;
+        RecordPaging(ticksCounter, ticks);
+
+        const uint64_t latencyInNanoseconds = mPagingTimer->TicksToNanoseconds(ticks);
+        latency->Record(latencyInNanoseconds);
+        TRACE_COUNTER1(TraceEventCategory::Residency, traceCounterName,
+                       latencyInNanoseconds / 1000);
+    }
+
+    RESIDENCY_PAGING_STATS ResidencyManager::GetPagingStats(const PagingCounters& counters) const {
+        const auto ticksToSeconds = [this](const std::atomic<uint64_t>& ticks) {
+            return static_cast<double>(
+                       mPagingTimer->TicksToNanoseconds(ticks.load(std::memory_order_relaxed))) /
+                   1e9;
+        };
+
+        RESIDENCY_PAGING_STATS stats = {};
+        stats.MadeResidentCount = counters.MadeResidentCount.load(std::memory_order_relaxed);
+        stats.MadeResidentSizeInBytes = counters.MadeResidentUsage.load(std::memory_order_relaxed);
+        stats.EvictedCount = counters.EvictedCount.load(std::memory_order_relaxed);
+        stats.EvictedSizeInBytes = counters.EvictedUsage.load(std::memory_order_relaxed);
+        stats.FenceWaitHeapCount = counters.FenceWaitHeapCount.load(std::memory_order_relaxed);
+        stats.FenceWaitSizeInBytes = counters.FenceWaitUsage.load(std::memory_order_relaxed);
+        stats.FenceWaitCount = counters.FenceWaitCount.load(std::memory_order_relaxed);
+        stats.MakeResidentTimeInSeconds = ticksToSeconds(counters.MakeResidentTicks);
+        stats.EvictTimeInSeconds = ticksToSeconds(counters.EvictTicks);
+        stats.FenceWaitTimeInSeconds = ticksToSeconds(counters.FenceWaitTicks);
+        return stats;
+    }
 }}  // namespace gpgmm::d3d12
@@ -16,12 +16,26 @@
 #ifndef GPGMM_D3D12_RESIDENCYMANAGERD3D12_H_
 #define GPGMM_D3D12_RESIDENCYMANAGERD3D12_H_
 
+#include "gpgmm/LatencyHistogram.h"
+#include "gpgmm/WorkerThread.h"
 #include "gpgmm/common/LinkedList.h"
 #include "gpgmm/d3d12/IUnknownImplD3D12.h"
 #include "include/gpgmm_export.h"
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace gpgmm {
+    class PlatformTime;
+}  // namespace gpgmm
 
 namespace gpgmm { namespace d3d12 {
 
@@ -29,6 +43,102 @@ namespace gpgmm { namespace d3d12 {
     class Heap;
     class ResidencySet;
 
+    // Decides which resident heap is evicted first when over budget.
+    enum EVICTION_POLICY {
+
+        // Evicts the least recently used heap. Enabled by default.
+        EVICTION_POLICY_LRU = 0x0,
+
+        // Evicts the least frequently used heap, with the least recently used first among equally
+        // used heaps. Use counts decay over time so heaps which are no longer used are eventually
+        // evicted. Avoids thrashing when alternating between working sets which do not fit in
+        // the budget together, at the cost of scanning every resident heap to evict one.
+        EVICTION_POLICY_LFU = 0x1,
+    };
+
+    // How close the usage of a memory segment is to its budget.
+    enum MEMORY_PRESSURE_LEVEL {
+
+        // Usage is well within the budget.
+        MEMORY_PRESSURE_LEVEL_GREEN = 0x0,
+
+        // Usage is nearing the budget. Applications should start using less memory, for example,
+        // by streaming in lower resolution textures, before heaps need to be evicted.
+        MEMORY_PRESSURE_LEVEL_YELLOW = 0x1,
+
+        // Usage reached the budget, so heaps are being evicted to make others resident.
+        MEMORY_PRESSURE_LEVEL_RED = 0x2,
+    };
+
+    struct MEMORY_PRESSURE_INFO {
+        // Memory segment whose pressure level is reported.
+        DXGI_MEMORY_SEGMENT_GROUP MemorySegmentGroup;
+
+        // Pressure level of the memory segment.
+        MEMORY_PRESSURE_LEVEL Level;
+
+        // Budget of the memory segment, in bytes.
+        uint64_t Budget;
+
+        // Usage of the memory segment, in bytes.
+        uint64_t CurrentUsage;
+
+        // Size which did not fit within the budget and had to be evicted, in bytes. Only non-zero
+        // when |Level| is MEMORY_PRESSURE_LEVEL_RED.
+        uint64_t SizeOverBudget;
+
+        // True when called because the resource allocations of |Tag| exceeded the soft quota set
+        // by ResourceAllocator::SetTagQuota, in which case |Level| could be unchanged.
+        bool IsTagQuotaExceeded;
+
+        // Tag whose quota was exceeded, along with the size of its resource allocations and its
+        // quota, in bytes. Only valid when |IsTagQuotaExceeded| is true.
+        uint32_t Tag;
+        uint64_t TagUsage;
+        uint64_t TagQuota;
+    };
+
+    // Called with the memory pressure of a memory segment and the context given upon
+    // registration.
+    typedef void (*MEMORY_PRESSURE_CALLBACK)(const MEMORY_PRESSURE_INFO& info, void* context);
+
+    // Paging done by the residency manager, in both memory segments.
+    struct RESIDENCY_PAGING_STATS {
+        // Heaps made resident, including those prefetched, and their size.
+        uint64_t MadeResidentCount;
+        uint64_t MadeResidentSizeInBytes;
+
+        // Heaps evicted, including pooled heaps offered, and their size.
+        uint64_t EvictedCount;
+        uint64_t EvictedSizeInBytes;
+
+        // Heaps which could only be evicted once the GPU finished using them, their size, and
+        // the number of times the calling thread blocked on a fence for them.
+        uint64_t FenceWaitHeapCount;
+        uint64_t FenceWaitSizeInBytes;
+        uint64_t FenceWaitCount;
+
+        // Time spent in MakeResident (or EnqueueMakeResident), in Evict, and blocked on fences.
+        double MakeResidentTimeInSeconds;
+        double EvictTimeInSeconds;
+        double FenceWaitTimeInSeconds;
+    };
+
+    struct RESIDENCY_MANAGER_STATS {
+        // Paging since the residency manager was created.
+        RESIDENCY_PAGING_STATS Total;
+
+        // Paging since the current frame began, see ResourceAllocator::BeginFrame, or since the
+        // residency manager was created if no frame was begun.
+        RESIDENCY_PAGING_STATS Frame;
+
+        // Latency of each call to MakeResident (or EnqueueMakeResident) and Evict, and of each
+        // wait on fences, since the residency manager was created.
+        LATENCY_HISTOGRAM_INFO MakeResidentLatency;
+        LATENCY_HISTOGRAM_INFO EvictLatency;
+        LATENCY_HISTOGRAM_INFO FenceWaitLatency;
+    };
+
     class GPGMM_EXPORT ResidencyManager final : public IUnknownImpl {
       public:
         static HRESULT CreateResidencyManager(ComPtr<ID3D12Device> device,
@@ -37,6 +147,11 @@ namespace gpgmm { namespace d3d12 {
                                               float videoMemoryBudget,
                                               uint64_t availableForResourceBudget,
                                               uint64_t videoMemoryEvictSize,
+                                              bool evictInBackground,
+                                              bool offerPooledHeaps,
+                                              EVICTION_POLICY evictionPolicy,
+                                              uint32_t predictionSubmissionCount,
+                                              uint32_t reservationSubmissionCount,
                                               ResidencyManager** residencyManagerOut);
 
         ~ResidencyManager();
@@ -45,10 +160,26 @@ namespace gpgmm { namespace d3d12 {
         HRESULT UnlockHeap(Heap* heap);
         HRESULT InsertHeap(Heap* heap);
 
+        // Evicts heaps until |sizeToMakeResident| fits within the budget. When evicting in the
+        // background, only heaps no longer used by the GPU are evicted before returning and the
+        // remaining size is evicted by EvictAsync.
         HRESULT Evict(uint64_t sizeToMakeResident,
                       const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
                       uint64_t* sizeEvictedOut = nullptr);
 
+        // Evicts heaps on a background thread, waiting for the GPU to no longer use them without
+        // blocking the calling thread. Returns an event which is signaled once |sizeToMakeResident|
+        // fits within the budget, or nothing more can be evicted.
+        std::shared_ptr<Event> EvictAsync(uint64_t sizeToMakeResident,
+                                          const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Checks if |sizeToMakeResident| fits within the budget of |memorySegmentGroup| without
+        // evicting any heap.
+        bool IsWithinBudget(uint64_t sizeToMakeResident,
+                            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Makes every heap in |residencySets| resident then submits all |count| command lists to
+        // |queue| at once. Each residency set corresponds to the command list of the same index.
         HRESULT ExecuteCommandLists(ID3D12CommandQueue* queue,
                                     ID3D12CommandList* const* commandLists,
                                     ResidencySet* const* residencySets,
@@ -58,14 +189,58 @@ namespace gpgmm { namespace d3d12 {
                                           uint64_t reservation,
                                           uint64_t* reservationOut = nullptr);
 
+        // Registers |callback| to be called whenever the pressure level of a memory segment
+        // changes, whenever heaps must be evicted to stay within the budget, and whenever the
+        // soft quota of a tag is exceeded (see ResourceAllocator::SetTagQuota). Returns a
+        // |cookieOut| used to unregister it.
+        // Callbacks are called with the residency manager locked, from any thread using it. They
+        // must not wait on another thread which uses the allocator, so they are best used to
+        // record the pressure level then act upon it later.
+        HRESULT RegisterMemoryPressureCallback(MEMORY_PRESSURE_CALLBACK callback,
+                                               void* context,
+                                               DWORD* cookieOut);
+        HRESULT UnregisterMemoryPressureCallback(DWORD cookie);
+
+        // Returns the size of the pooled heaps of |memorySegmentGroup| which were offered back to
+        // the OS, in bytes. Offered heaps are evicted but kept by their pool for re-use, so they
+        // are not counted by the current usage.
+        uint64_t GetOfferedUsage(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Returns the budget and usage of |memorySegmentGroup|, in bytes, as last updated by the
+        // residency manager, without querying the OS.
+        DXGI_QUERY_VIDEO_MEMORY_INFO GetVideoMemoryInfo(
+            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Replaces the budget of |memorySegmentGroup| reported by the OS with |budget|, in bytes,
+        // such as to replay the budget recorded by a capture. The budget is then applied like
+        // the OS budget: scaled by ALLOCATOR_DESC::MaxVideoMemoryBudget, or clamped to
+        // ALLOCATOR_DESC::TotalResourceBudgetLimit when specified. Zero restores the OS budget.
+        HRESULT SetVideoMemoryBudgetOverride(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                             uint64_t budget);
+
+        // Returns the paging done so far. Can be called from any thread without waiting for the
+        // residency manager to be unlocked.
+        RESIDENCY_MANAGER_STATS QueryStats() const;
+
+        // Starts counting the paging of a new frame. Called by ResourceAllocator::BeginFrame.
+        void ResetFrameStats();
+
       private:
         ResidencyManager(ComPtr<ID3D12Device> device,
                          ComPtr<IDXGIAdapter3> adapter3,
-                         std::unique_ptr<Fence> fence,
                          bool isUMA,
                          float memorySegmentBudgetLimit,
                          uint64_t totalResourceBudgetLimit,
-                         uint64_t videoMemoryEvictSize);
+                         uint64_t videoMemoryEvictSize,
+                         bool evictInBackground,
+                         bool offerPooledHeaps,
+                         EVICTION_POLICY evictionPolicy,
+                         uint32_t predictionSubmissionCount,
+                         uint32_t reservationSubmissionCount);
+
+        friend class EvictTask;
+        friend Heap;
+        friend ResourceAllocator;
 
         const char* GetTypename() const;
 
@@ -74,34 +249,210 @@ namespace gpgmm { namespace d3d12 {
         struct VideoMemorySegment {
             LRUCache cache = {};
             DXGI_QUERY_VIDEO_MEMORY_INFO Info = {};
+
+            // Budget restricted by the total resource budget limit, if specified.
+            uint64_t LimitedBudget = 0;
+
+            // Signaled once the last background eviction of this segment completes.
+            std::shared_ptr<Event> EvictionEvent;
+
+            // Usage after each of the last |mReservationSubmissionCount| submissions, oldest
+            // first, and the reservation last requested from the OS for it.
+            std::deque<uint64_t> UsageHistory;
+            uint64_t AutoReservation = 0;
+
+            // Pressure level last reported to the memory pressure callbacks.
+            MEMORY_PRESSURE_LEVEL PressureLevel = MEMORY_PRESSURE_LEVEL_GREEN;
+
+            // Pooled heaps which were offered, and their total size.
+            std::unordered_set<Heap*> OfferedHeaps;
+            uint64_t OfferedUsage = 0;
         };
 
+        // Evicts every heap needed to be under budget with a single call to Evict. If |waitForGPU|
+        // is true, the GPU is waited for once, for the latest use of those heaps. Otherwise, heaps
+        // still in use by the GPU are skipped and, if more are needed, |fenceToWaitForOut| is set
+        // to the fence, and value, to wait for before evicting again.
+        HRESULT EvictInternal(uint64_t sizeToMakeResident,
+                              const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                              bool waitForGPU,
+                              uint64_t* sizeEvictedOut,
+                              Fence** fenceToWaitForOut,
+                              uint64_t* fenceValueToWaitForOut);
+
+        HRESULT GetOrCreateFence(ID3D12CommandQueue* queue, Fence** fenceOut);
+
+        // Records the heaps used by a submission to |queue|, then makes resident the heaps used by
+        // the submission predicted to be like the next one, without exceeding the budget.
+        HRESULT RecordSubmissionAndPrefetch(ID3D12CommandQueue* queue,
+                                            std::vector<Heap*> usedHeaps);
+
+        // Forgets a released heap which was recorded as used by past submissions.
+        void RemoveFromSubmissionHistory(Heap* heap);
+
+        // Evicts the oldest pooled heaps which the GPU has finished using, until |sizeToOffer| is
+        // reached, and counts them as offered. Pooled heaps contain no resource, so evicting them
+        // does not affect the application. Returns the size offered.
+        uint64_t OfferPooledHeaps(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                  uint64_t sizeToOffer,
+                                  std::vector<ID3D12Pageable*>* heapsToEvictOut);
+
+        // Stops counting |heap| as offered, once made resident again or released.
+        void ReclaimOfferedHeap(Heap* heap);
+
+        // Records the usage of the segment after a submission, then reserves the peak usage of
+        // the recorded submissions from the OS, so the budget is less likely to be reduced below
+        // the working set under pressure from other processes.
+        HRESULT UpdateAutoVideoMemoryReservation(
+            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Checks if the GPU has finished using |heap| without waiting for it.
+        bool IsCompletedOnAllQueues(Heap* heap) const;
+
+        // Returns the first fence value |heap| was used with that has not completed, or nullptr.
+        const std::pair<Fence*, uint64_t>* GetFirstIncompleteFenceValue(Heap* heap) const;
+
+        // Puts |cache| back in LRU order, as an approximation of CLOCK: heaps referenced by a
+        // submission since the cache was last aged are moved to the end, in the same order, and
+        // are no longer referenced.
+        void AgeResidencyCache(LRUCache* cache);
+
+        // Checks if |heap| is used by a submission which has not been signaled yet.
+        bool IsUsedByCurrentSubmission(Heap* heap) const;
+
+        // Returns the heap to evict next according to the eviction policy, or nullptr if none.
+        // Unless |skippedFenceValueToWaitForOut| is nullptr, heaps still in use by the GPU are
+        // skipped and it is set to the fence value of the first one skipped.
+        Heap* GetNextHeapToEvict(LRUCache* cache,
+                                 std::pair<Fence*, uint64_t>* skippedFenceValueToWaitForOut) const;
+
         HRESULT MakeResident(const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
                              uint64_t sizeToMakeResident,
                              uint32_t numberOfObjectsToMakeResident,
                              ID3D12Pageable** allocations);
 
+        // Makes resident without evicting first, which must already be done by the caller. Unless
+        // |residencyFence| is nullptr, paging is enqueued to signal it instead of blocking.
+        HRESULT MakeResidentWithRetry(const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
+                                      uint64_t sizeToMakeResident,
+                                      uint32_t numberOfObjectsToMakeResident,
+                                      ID3D12Pageable** allocations,
+                                      Fence* residencyFence);
+
+        VideoMemorySegment* GetVideoMemorySegment(
+            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
         DXGI_QUERY_VIDEO_MEMORY_INFO* GetVideoMemorySegmentInfo(
             const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
 
         LRUCache* GetVideoMemorySegmentCache(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
 
+        // Paging counters kept in ticks of |mPagingTimer|, so they are cheap to update.
+        struct PagingCounters {
+            std::atomic<uint64_t> MadeResidentCount = {0};
+            std::atomic<uint64_t> MadeResidentUsage = {0};
+            std::atomic<uint64_t> EvictedCount = {0};
+            std::atomic<uint64_t> EvictedUsage = {0};
+            std::atomic<uint64_t> FenceWaitHeapCount = {0};
+            std::atomic<uint64_t> FenceWaitUsage = {0};
+            std::atomic<uint64_t> FenceWaitCount = {0};
+            std::atomic<uint64_t> MakeResidentTicks = {0};
+            std::atomic<uint64_t> EvictTicks = {0};
+            std::atomic<uint64_t> FenceWaitTicks = {0};
+        };
+
+        // Adds |value| to |counter| of both the total and the frame paging counters.
+        void RecordPaging(std::atomic<uint64_t> PagingCounters::*counter, uint64_t value);
+
+        // Adds the ticks since |startTicks| to |ticksCounter| of both paging counters, then
+        // records the latency into |latency| and the trace counter named |traceCounterName|,
+        // which must be a literal.
+        void RecordPagingLatency(std::atomic<uint64_t> PagingCounters::*ticksCounter,
+                                 LatencyHistogram* latency,
+                                 const char* traceCounterName,
+                                 uint64_t startTicks);
+
+        RESIDENCY_PAGING_STATS GetPagingStats(const PagingCounters& counters) const;
+
         HRESULT QueryVideoMemoryInfo(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
                                      DXGI_QUERY_VIDEO_MEMORY_INFO* videoMemoryInfo) const;
 
+        HRESULT UpdateVideoMemorySegments();
+        HRESULT StartBudgetNotificationThread();
+
+        // Calls the memory pressure callbacks if the pressure level of |memorySegmentGroup|
+        // changed, or if |sizeOverBudget| had to be evicted.
+        void NotifyMemoryPressure(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                  uint64_t sizeOverBudget);
+
+        // Calls the memory pressure callbacks once the resource allocations of |tag|, within
+        // |memorySegmentGroup|, exceeded its quota.
+        void NotifyTagQuotaExceeded(const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup,
+                                    uint32_t tag,
+                                    uint64_t tagUsage,
+                                    uint64_t tagQuota);
+
         ComPtr<ID3D12Device> mDevice;
         ComPtr<IDXGIAdapter3> mAdapter;
 
-        std::unique_ptr<Fence> mFence;
+        // Only set when the device supports ID3D12Device3::EnqueueMakeResident.
+        ComPtr<ID3D12Device3> mDevice3;
+        std::unique_ptr<Fence> mResidencyFence;
+
+        const bool mIsUMA;
+
+        std::unordered_map<ID3D12CommandQueue*, std::unique_ptr<Fence>> mQueueFences;
 
         const float mMaxVideoMemoryBudget;
         const uint64_t mTotalResourceBudgetLimit;
         const uint64_t mVideoMemoryEvictSize;
+        const bool mEvictInBackground;
+        const bool mOfferPooledHeaps;
+        const EVICTION_POLICY mEvictionPolicy;
+        const uint32_t mPredictionSubmissionCount;
+        const uint32_t mReservationSubmissionCount;
+
+        // Heaps used by each of the last |mPredictionSubmissionCount| submissions to each queue,
+        // oldest first.
+        std::unordered_map<ID3D12CommandQueue*, std::deque<std::vector<Heap*>>>
+            mSubmissionHistory;
 
         VideoMemorySegment mLocalVideoMemorySegment;
         VideoMemorySegment mNonLocalVideoMemorySegment;
 
+        // Budget which replaces the budget reported by the OS, indexed by memory segment group,
+        // or zero. See SetVideoMemoryBudgetOverride.
+        std::array<std::atomic<uint64_t>, 2> mVideoMemoryBudgetOverride = {};
+
+        // Incremented whenever the budget of either memory segment changes, so the resource
+        // allocator knows allocations which failed could succeed again.
+        std::atomic<uint64_t> mBudgetChangeCount = {0};
+
+        std::unique_ptr<PlatformTime> mPagingTimer;
+        PagingCounters mTotalPagingCounters;
+        PagingCounters mFramePagingCounters;
+
+        LatencyHistogram mMakeResidentLatency;
+        LatencyHistogram mEvictLatency;
+        LatencyHistogram mFenceWaitLatency;
+
+        std::unordered_map<DWORD, std::pair<MEMORY_PRESSURE_CALLBACK, void*>>
+            mMemoryPressureCallbacks;
+        DWORD mNextMemoryPressureCallbackCookie = 1;
+
         std::recursive_mutex mMutex;
+
+        // Once budget notifications are registered, the video memory info is only updated by
+        // the notification thread and by our own MakeResident and Evict calls. Atomic since the
+        // notification thread clears it should waiting fail.
+        std::atomic<bool> mIsVideoMemoryInfoCached = {false};
+        std::thread mBudgetNotificationThread;
+        HANDLE mBudgetNotificationEvent = nullptr;
+        HANDLE mShutdownEvent = nullptr;
+        DWORD mBudgetNotificationCookie = 0;
+
+        // Declared last so background evictions complete before anything else is destroyed.
+        std::shared_ptr<ThreadPool> mThreadPool;
     };
 
 }}  // namespace gpgmm::d3d12
@@ -14,22 +14,74 @@
 
 #include "gpgmm/d3d12/ResidencySetD3D12.h"
 
+#include "gpgmm/d3d12/HeapD3D12.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
 namespace gpgmm { namespace d3d12 {
+
+    namespace {
+
+        // Generations are unique across every residency set, so a heap last inserted into one
+        // set is never mistaken as inserted into another. Zero is never used, which is the
+        // generation of heaps never inserted.
+        std::atomic<uint64_t> gNextResidencySetGeneration{1};
+
+        uint64_t AcquireResidencySetGeneration() {
+            return gNextResidencySetGeneration.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    }  // namespace
+
+    ResidencySet::ResidencySet(RESIDENCY_SET_FLAGS_TYPE flags)
+        : mAllowConcurrentInsert(flags & RESIDENCY_SET_FLAG_ALLOW_CONCURRENT_INSERT),
+          mGeneration(AcquireResidencySetGeneration()) {
+    }
+
     HRESULT ResidencySet::Insert(Heap* heap) {
         if (heap == nullptr) {
             return E_INVALIDARG;
         }
-        const bool inserted = mSet.insert(heap).second;
-        if (inserted) {
-            mToMakeResident.push_back(heap);
+        if (heap->mResidencySetGeneration.exchange(mGeneration, std::memory_order_relaxed) ==
+            mGeneration) {
+            return E_FAIL;
+        }
+
+        // The generation is exchanged atomically, so only one thread inserts a heap.
+        if (mAllowConcurrentInsert) {
+            Shard& shard =
+                mShards[std::hash<std::thread::id>()(std::this_thread::get_id()) % kNumOfShards];
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Heaps.push_back(heap);
             return S_OK;
         }
-        return E_FAIL;
+
+        mToMakeResident.push_back(heap);
+        return S_OK;
     }
 
     HRESULT ResidencySet::Reset() {
-        mSet.clear();
+        mGeneration = AcquireResidencySetGeneration();
         mToMakeResident.clear();
+        if (mAllowConcurrentInsert) {
+            for (Shard& shard : mShards) {
+                std::lock_guard<std::mutex> lock(shard.Mutex);
+                shard.Heaps.clear();
+            }
+        }
         return S_OK;
     }
+
+    void ResidencySet::MergeShards() {
+        if (!mAllowConcurrentInsert) {
+            return;
+        }
+        for (Shard& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            mToMakeResident.insert(mToMakeResident.end(), shard.Heaps.begin(), shard.Heaps.end());
+            shard.Heaps.clear();
+        }
+    }
 }}  // namespace gpgmm::d3d12
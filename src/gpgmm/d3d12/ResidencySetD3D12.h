@@ -15,10 +15,13 @@
 #ifndef GPGMM_D3D12_RESIDENCYSETD3D12_H_
 #define GPGMM_D3D12_RESIDENCYSETD3D12_H_
 
+#include "gpgmm/common/Flags.h"
 #include "gpgmm/d3d12/d3d12_platform.h"
 #include "include/gpgmm_export.h"
 
-#include <set>
+#include <array>
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
 namespace gpgmm { namespace d3d12 {
@@ -26,20 +29,55 @@ namespace gpgmm { namespace d3d12 {
     class Heap;
     class ResidencyManager;
 
+    enum RESIDENCY_SET_FLAGS {
+
+        // Disables all residency set flags. Enabled by default.
+        RESIDENCY_SET_FLAG_NONE = 0x0,
+
+        // Allows heaps to be inserted by multiple threads at once, such as when a command list is
+        // recorded by several worker threads, without external locking. Each thread inserts into
+        // one of a fixed number of shards, which ResidencyManager::ExecuteCommandLists merges
+        // once per submission. Reset must not be called while heaps are being inserted.
+        RESIDENCY_SET_FLAG_ALLOW_CONCURRENT_INSERT = 0x1,
+    };
+
+    using RESIDENCY_SET_FLAGS_TYPE = Flags<RESIDENCY_SET_FLAGS>;
+    DEFINE_OPERATORS_FOR_FLAGS(RESIDENCY_SET_FLAGS_TYPE)
+
     // Represents a set of heaps which are referenced by a command list.
     // The set must be updated to ensure each heap is made resident for execution.
+    //
+    // Each heap remembers the generation of the set it was last inserted into, so inserting a
+    // heap already in the set is only a comparison and Reset only starts a new generation.
+    // A heap inserted into another set in-between could be inserted twice, which
+    // ResidencyManager::ExecuteCommandLists tolerates.
     class GPGMM_EXPORT ResidencySet {
       public:
-        ResidencySet() = default;
+        explicit ResidencySet(RESIDENCY_SET_FLAGS_TYPE flags = RESIDENCY_SET_FLAG_NONE);
 
+        // Returns E_FAIL if |heap| was already inserted since the last Reset.
         HRESULT Insert(Heap* heap);
         HRESULT Reset();
 
       private:
         friend ResidencyManager;
 
-        std::set<Heap*> mSet;
+        // Moves heaps inserted by other threads into |mToMakeResident|.
+        void MergeShards();
+
+        struct Shard {
+            std::mutex Mutex;
+            std::vector<Heap*> Heaps;
+        };
+
+        constexpr static size_t kNumOfShards = 8;
+
+        const bool mAllowConcurrentInsert;
+        uint64_t mGeneration;
         std::vector<Heap*> mToMakeResident;
+
+        // Only used with RESIDENCY_SET_FLAG_ALLOW_CONCURRENT_INSERT.
+        std::array<Shard, kNumOfShards> mShards;
     };
 
 }}  // namespace gpgmm::d3d12
@@ -17,12 +17,16 @@
 
 #include "gpgmm/Debug.h"
 #include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/Memcpy.h"
 #include "gpgmm/d3d12/BackendD3D12.h"
 #include "gpgmm/d3d12/ErrorD3D12.h"
 #include "gpgmm/d3d12/HeapD3D12.h"
 #include "gpgmm/d3d12/JSONSerializerD3D12.h"
 #include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+#include "gpgmm/d3d12/WarmUpProfileD3D12.h"
 
+#include <cstddef>
 #include <utility>
 
 namespace gpgmm { namespace d3d12 {
@@ -47,11 +51,14 @@ namespace gpgmm { namespace d3d12 {
                                            ComPtr<ID3D12Resource> placedResource,
                                            Heap* resourceHeap)
         : MemoryAllocation(allocator, resourceHeap, offsetFromHeap, method, block),
-          mResidencyManager(residencyManager),
           mResource(std::move(placedResource)),
-          mOffsetFromResource(0) {
+          mOffsetFromResource(0),
+          mResidencyManager(residencyManager),
+          mIsRecorded(IsTraceEventCallSampled()) {
         ASSERT(resourceHeap != nullptr);
-        GPGMM_TRACE_EVENT_OBJECT_NEW(this);
+        if (mIsRecorded) {
+            GPGMM_TRACE_EVENT_OBJECT_NEW(this);
+        }
     }
 
     ResourceAllocation::ResourceAllocation(ResidencyManager* residencyManager,
@@ -65,18 +72,47 @@ namespace gpgmm { namespace d3d12 {
                            kInvalidOffset,
                            AllocationMethod::kSubAllocatedWithin,
                            block),
-          mResidencyManager(residencyManager),
           mResource(std::move(resource)),
-          mOffsetFromResource(offsetFromResource) {
+          mOffsetFromResource(offsetFromResource),
+          mResidencyManager(residencyManager),
+          mIsRecorded(IsTraceEventCallSampled()) {
         ASSERT(resourceHeap != nullptr);
-        GPGMM_TRACE_EVENT_OBJECT_NEW(this);
+        if (mIsRecorded) {
+            GPGMM_TRACE_EVENT_OBJECT_NEW(this);
+        }
     }
 
     ResourceAllocation::~ResourceAllocation() {
-        GPGMM_TRACE_EVENT_OBJECT_DESTROY(this);
+        if (mIsRecorded) {
+            GPGMM_TRACE_EVENT_OBJECT_DESTROY(this);
+        }
+    }
+
+    void* ResourceAllocation::operator new(size_t size, ResourceAllocationPool* pool) {
+        ASSERT(size == sizeof(ResourceAllocation));
+        ASSERT(pool != nullptr);
+        return pool->Acquire();
+    }
+
+    // Only called should the constructor throw.
+    void ResourceAllocation::operator delete(void* ptr, ResourceAllocationPool*) {
+        ResourceAllocationPool::Release(ptr);
+    }
+
+    void ResourceAllocation::operator delete(void* ptr) {
+        ResourceAllocationPool::Release(ptr);
     }
 
     void ResourceAllocation::DeleteThis() {
+        if (GetMappedPointer() != nullptr) {
+            UnmapInternal(0, nullptr);
+        }
+        if (mTaggedBy != nullptr) {
+            mTaggedBy->UntrackTaggedAllocation(this);
+        }
+        if (mWarmUpProfileEntry != nullptr) {
+            WarmUpProfileRecorder::RecordDeallocation(mWarmUpProfileEntry);
+        }
         GetAllocator()->DeallocateMemory(std::unique_ptr<ResourceAllocation>(this));
     }
 
@@ -87,12 +123,119 @@ namespace gpgmm { namespace d3d12 {
     HRESULT ResourceAllocation::Map(uint32_t subresource,
                                     const D3D12_RANGE* readRange,
                                     void** dataOut) {
+        // Persistently mapped allocations were already locked and mapped once.
+        if (GetMappedPointer() != nullptr) {
+            if (subresource > 0) {
+                return E_INVALIDARG;
+            }
+            if (dataOut != nullptr) {
+                *dataOut = GetMappedPointer();
+            }
+            return S_OK;
+        }
+
+        return MapInternal(subresource, readRange, dataOut);
+    }
+
+    void ResourceAllocation::Unmap(uint32_t subresource, const D3D12_RANGE* writtenRange) {
+        if (GetMappedPointer() != nullptr) {
+            return;
+        }
+
+        UnmapInternal(subresource, writtenRange);
+    }
+
+    HRESULT ResourceAllocation::TryExtend(uint64_t newSize) {
+        if (mResource != nullptr && GetMethod() != AllocationMethod::kSubAllocatedWithin) {
+            return E_INVALIDARG;
+        }
+
+        const uint64_t size = GetSize();
+        if (newSize <= size) {
+            return S_OK;
+        }
+
+        if (!GetAllocator()->TryExtendMemory(this, newSize)) {
+            DebugEvent("ResourceAllocation.TryExtend", ALLOCATOR_MESSAGE_ID_ALLOCATOR_FAILED)
+                << "Allocation could not be extended in place (" << size << " to " << newSize
+                << " bytes).";
+            return E_OUTOFMEMORY;
+        }
+
+        if (mTaggedBy != nullptr) {
+            mTaggedBy->TrackTaggedAllocationExtended(this, GetSize() - size);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocation::WriteData(uint64_t offset, const void* src, uint64_t size) {
+        // Only buffers have a linear layout to copy into.
+        if (src == nullptr || mResource == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        const D3D12_RESOURCE_DESC resourceDesc = mResource->GetDesc();
+        if (resourceDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER) {
+            return E_INVALIDARG;
+        }
+
+        // The allocation could be larger than the buffer it was created for.
+        const uint64_t writableSize = (GetMethod() == AllocationMethod::kSubAllocatedWithin)
+                                          ? GetSize()
+                                          : resourceDesc.Width;
+        if (offset > writableSize || size > writableSize - offset) {
+            return E_INVALIDARG;
+        }
+
+        if (size == 0) {
+            return S_OK;
+        }
+
+        uint8_t* mappedData = GetMappedPointer();
+        const bool isMappedPersistently = (mappedData != nullptr);
+        if (!isMappedPersistently) {
+            // Nothing is read back.
+            const D3D12_RANGE readRange = {0, 0};
+            void* data = nullptr;
+            ReturnIfFailed(MapInternal(0, &readRange, &data));
+            mappedData = static_cast<uint8_t*>(data);
+        }
+
+        CopyToWriteCombined(mappedData + offset, src, static_cast<size_t>(size));
+
+        if (!isMappedPersistently) {
+            const D3D12_RANGE writtenRange = {static_cast<SIZE_T>(offset),
+                                              static_cast<SIZE_T>(offset + size)};
+            UnmapInternal(0, &writtenRange);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocation::MapPersistently() {
+        ASSERT(GetMappedPointer() == nullptr);
+
+        void* mappedData = nullptr;
+        ReturnIfFailed(MapInternal(0, nullptr, &mappedData));
+        SetMappedPointer(static_cast<uint8_t*>(mappedData));
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocation::MapInternal(uint32_t subresource,
+                                            const D3D12_RANGE* readRange,
+                                            void** dataOut) {
         // Allocation coordinates relative to the resource cannot be used when specifying
         // subresource-relative coordinates.
         if (subresource > 0 && GetMethod() == AllocationMethod::kSubAllocatedWithin) {
             return E_INVALIDARG;
         }
 
+        // Memory allocated without a resource has nothing to map.
+        if (mResource == nullptr) {
+            return E_FAIL;
+        }
+
         Heap* resourceHeap = ToBackend(GetMemory());
         ASSERT(resourceHeap != nullptr);
 
@@ -121,11 +264,17 @@ namespace gpgmm { namespace d3d12 {
         return S_OK;
     }
 
-    void ResourceAllocation::Unmap(uint32_t subresource, const D3D12_RANGE* writtenRange) {
+    void ResourceAllocation::UnmapInternal(uint32_t subresource,
+                                           const D3D12_RANGE* writtenRange) {
         // Allocation coordinates relative to the resource cannot be used when specifying
         // subresource-relative coordinates.
         ASSERT(subresource == 0 || GetMethod() != AllocationMethod::kSubAllocatedWithin);
 
+        // Never mapped.
+        if (mResource == nullptr) {
+            return;
+        }
+
         Heap* resourceHeap = ToBackend(GetMemory());
         ASSERT(resourceHeap != nullptr);
 
@@ -165,6 +314,18 @@ namespace gpgmm { namespace d3d12 {
         return mOffsetFromResource;
     }
 
+    HRESULT ResourceAllocation::GetSharedHandle(HANDLE* sharedHandleOut) const {
+        if (sharedHandleOut == nullptr) {
+            return E_POINTER;
+        }
+
+        const Heap* resourceHeap = ToBackend(GetMemory());
+        ASSERT(resourceHeap != nullptr);
+
+        *sharedHandleOut = resourceHeap->GetSharedHandle();
+        return (*sharedHandleOut != nullptr) ? S_OK : E_INVALIDARG;
+    }
+
     RESOURCE_ALLOCATION_INFO ResourceAllocation::GetInfo() const {
         Heap* resourceHeap = ToBackend(GetMemory());
         ASSERT(resourceHeap != nullptr);
@@ -177,4 +338,31 @@ namespace gpgmm { namespace d3d12 {
         return "GPUMemoryAllocation";
     }
 
+    // ResourceAllocationPool
+
+    void* ResourceAllocationPool::Acquire() {
+        PooledStorage* pooledStorage = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            pooledStorage = mPool.Acquire();
+        }
+        pooledStorage->pPool = this;
+        return &pooledStorage->Storage;
+    }
+
+    // static
+    void ResourceAllocationPool::Release(void* storage) {
+        if (storage == nullptr) {
+            return;
+        }
+
+        PooledStorage* pooledStorage = reinterpret_cast<PooledStorage*>(
+            static_cast<uint8_t*>(storage) - offsetof(PooledStorage, Storage));
+        ResourceAllocationPool* pool = pooledStorage->pPool;
+        ASSERT(pool != nullptr);
+
+        std::lock_guard<std::mutex> lock(pool->mMutex);
+        pool->mPool.Release(pooledStorage);
+    }
+
 }}  // namespace gpgmm::d3d12
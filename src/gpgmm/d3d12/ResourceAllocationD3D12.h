@@ -18,15 +18,22 @@
 
 #include "gpgmm/MemoryAllocation.h"
 #include "gpgmm/common/NonCopyable.h"
+#include "gpgmm/common/ObjectPool.h"
 #include "gpgmm/d3d12/IUnknownImplD3D12.h"
 #include "gpgmm/d3d12/d3d12_platform.h"
 #include "include/gpgmm_export.h"
 
+#include <mutex>
+#include <type_traits>
+
 namespace gpgmm { namespace d3d12 {
 
     class Heap;
     class ResidencyManager;
     class ResidencySet;
+    class ResourceAllocationPool;
+    class ResourceAllocator;
+    struct WarmUpProfileEntry;
 
     struct RESOURCE_ALLOCATION_INFO {
         uint64_t SizeInBytes;
@@ -60,16 +67,38 @@ namespace gpgmm { namespace d3d12 {
 
         ~ResourceAllocation() override;
 
+        // Resource allocations are always created using the pool of the resource allocator, so
+        // they cannot be created with the global new.
+        static void* operator new(size_t size, ResourceAllocationPool* pool);
+        static void operator delete(void* ptr, ResourceAllocationPool* pool);
+        static void operator delete(void* ptr);
+
         // Gets the CPU pointer to the specificed subresource of the resource allocation.
         // If sub-allocated within the resource, the read or write range and
         // pointer value will start from the allocation instead of the resource.
+        // If created with ALLOCATION_FLAG_ALWAYS_MAPPED, the ranges are ignored.
         HRESULT Map(uint32_t subresource = 0,
                     const D3D12_RANGE* readRange = nullptr,
                     void** dataOut = nullptr);
 
         void Unmap(uint32_t subresource = 0, const D3D12_RANGE* writtenRange = nullptr);
 
-        // Returns the resource owned by this allocation.
+        // Copies |size| bytes from |src| to the buffer allocation starting at |offset|, without
+        // reading back the mapped memory. Upload heaps are write-combined, so this is faster
+        // than a memcpy into the pointer returned by Map. Uses the persistent mapping of
+        // ALLOCATION_FLAG_ALWAYS_MAPPED if one exists, otherwise maps only for the copy.
+        HRESULT WriteData(uint64_t offset, const void* src, uint64_t size);
+
+        // Grows the allocation in place to at-least |newSize| bytes, keeping its offset and
+        // contents, by taking the free memory which follows it. Only allocations created by
+        // ResourceAllocator::AllocateMemory or sub-allocated within a resource can grow, since
+        // the size of any other resource is fixed. Returns E_OUTOFMEMORY if the memory which
+        // follows is not free or large enough, ex. the next block is allocated, in which case
+        // the allocation is unchanged and should be allocated anew and copied instead.
+        HRESULT TryExtend(uint64_t newSize);
+
+        // Returns the resource owned by this allocation, or nullptr if allocated by
+        // ResourceAllocator::AllocateMemory.
         ID3D12Resource* GetResource() const;
 
         // Tracks the resource allocation memory for residency.
@@ -87,17 +116,70 @@ namespace gpgmm { namespace d3d12 {
         // If sub-allocated within the resource, the offset could be greater than zero.
         uint64_t GetOffsetFromResource() const;
 
+        // Gets the NT handle of the resource heap, for a resource allocation of a pool created
+        // with D3D12_HEAP_FLAG_SHARED. Another process opens it with ID3D12Device::OpenSharedHandle
+        // and places the resource at RESOURCE_ALLOCATION_INFO::HeapOffset. The handle is owned by
+        // the heap, and is the same for every resource allocation of the heap, so the other
+        // process only needs to open each heap once. Returns E_INVALIDARG for other resource
+        // allocations.
+        HRESULT GetSharedHandle(HANDLE* sharedHandleOut) const;
+
         RESOURCE_ALLOCATION_INFO GetInfo() const;
 
         const char* GetTypename() const;
 
       private:
+        friend ResourceAllocator;
+
         void DeleteThis() override;
 
-        ResidencyManager* const mResidencyManager;
-        ComPtr<ID3D12Resource> mResource;
+        HRESULT MapInternal(uint32_t subresource, const D3D12_RANGE* readRange, void** dataOut);
+        void UnmapInternal(uint32_t subresource, const D3D12_RANGE* writtenRange);
+
+        // Maps the entire resource until released, for ALLOCATION_FLAG_ALWAYS_MAPPED.
+        HRESULT MapPersistently();
 
+        // Follows the memory and refcount, which are also used per draw, so they could share a
+        // cache line. The residency manager is only used to map.
+        ComPtr<ID3D12Resource> mResource;
         const uint64_t mOffsetFromResource;
+
+        ResidencyManager* const mResidencyManager;
+
+        // False if created by a CreateResource call which was not sampled, so none of its events
+        // are recorded.
+        const bool mIsRecorded;
+
+        // Only set once counted by the tag of ALLOCATION_DESC, to be uncounted when released.
+        ResourceAllocator* mTaggedBy = nullptr;
+        uint32_t mTag = 0;
+
+        // Only set once counted by the warm-up profile, to be uncounted when released.
+        WarmUpProfileEntry* mWarmUpProfileEntry = nullptr;
+    };
+
+    // Recycles the storage of resource allocations created by the same resource allocator, so
+    // live allocations are packed together in fixed-size chunks instead of being scattered across
+    // the heap. Storage is released by whichever thread releases the last reference, so the pool
+    // is locked.
+    class ResourceAllocationPool final : public NonCopyable {
+      public:
+        ResourceAllocationPool() = default;
+
+        void* Acquire();
+
+        // Returns the storage to the pool it was acquired from.
+        static void Release(void* storage);
+
+      private:
+        struct PooledStorage {
+            ResourceAllocationPool* pPool = nullptr;
+            std::aligned_storage<sizeof(ResourceAllocation), alignof(ResourceAllocation)>::type
+                Storage;
+        };
+
+        std::mutex mMutex;
+        ObjectPool<PooledStorage> mPool{/*objectsPerChunk*/ 256};
     };
 
 }}  // namespace gpgmm::d3d12
@@ -15,16 +15,28 @@
 
 #include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
 
+#include "gpgmm/AliasedMemoryAllocator.h"
 #include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/CappedMemoryAllocator.h"
 #include "gpgmm/ConditionalMemoryAllocator.h"
 #include "gpgmm/Debug.h"
+#include "gpgmm/Defaults.h"
+#include "gpgmm/LifetimeMemoryAllocator.h"
+#include "gpgmm/LinearMemoryAllocator.h"
+#include "gpgmm/MagazineMemoryAllocator.h"
 #include "gpgmm/MemorySize.h"
+#include "gpgmm/RingMemoryAllocator.h"
 #include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/ShardedMemoryAllocator.h"
+#include "gpgmm/SharedMemoryAllocator.h"
 #include "gpgmm/SlabMemoryAllocator.h"
 #include "gpgmm/StandaloneMemoryAllocator.h"
+#include "gpgmm/TLSFMemoryAllocator.h"
+#include "gpgmm/common/Compiler.h"
 #include "gpgmm/common/Math.h"
 #include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/common/Utils.h"
+#include "gpgmm/d3d12/AllocatorGroupD3D12.h"
 #include "gpgmm/d3d12/BackendD3D12.h"
 #include "gpgmm/d3d12/BufferAllocatorD3D12.h"
 #include "gpgmm/d3d12/CapsD3D12.h"
@@ -33,12 +45,114 @@
 #include "gpgmm/d3d12/ErrorD3D12.h"
 #include "gpgmm/d3d12/HeapD3D12.h"
 #include "gpgmm/d3d12/JSONSerializerD3D12.h"
+#include "gpgmm/d3d12/PoolD3D12.h"
 #include "gpgmm/d3d12/ResidencyManagerD3D12.h"
 #include "gpgmm/d3d12/ResourceAllocationD3D12.h"
 #include "gpgmm/d3d12/ResourceHeapAllocatorD3D12.h"
+#include "gpgmm/d3d12/SharedStatsD3D12.h"
 #include "gpgmm/d3d12/UtilsD3D12.h"
+#include "gpgmm/d3d12/WarmUpProfileD3D12.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace gpgmm { namespace d3d12 {
+
+    // Upper bound on the number of resource descriptors remembered. Applications tend to create
+    // resources from a small set of descriptors, so the cache is simply cleared once full.
+    constexpr static size_t kMaxResourceAllocationInfoCacheSize = 1024;
+
+    // Caches the allocation info returned by ID3D12Device::GetResourceAllocationInfo, which is
+    // deterministic for the same resource descriptor but costly to compute.
+    class ResourceAllocationInfoCache {
+      public:
+        explicit ResourceAllocationInfoCache(bool isBufferAllocationInfoAnalytic)
+            : mIsBufferAllocationInfoAnalytic(isBufferAllocationInfoAnalytic) {
+        }
+
+        // Whether the allocation info of buffers is computed without asking the device, since it
+        // was found to agree with it.
+        bool IsBufferAllocationInfoAnalytic() const {
+            return mIsBufferAllocationInfoAnalytic;
+        }
+
+        // Returns true and the allocation info of |resourceDescriptor| if it was cached.
+        bool Lookup(const D3D12_RESOURCE_DESC& resourceDescriptor,
+                    D3D12_RESOURCE_ALLOCATION_INFO* resourceInfoOut,
+                    uint64_t* resourceAlignmentOut) const {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mCache.find(resourceDescriptor);
+            if (it == mCache.end()) {
+                return false;
+            }
+            *resourceInfoOut = it->second.ResourceInfo;
+            *resourceAlignmentOut = it->second.ResourceAlignment;
+            return true;
+        }
+
+        // Caches the allocation info of |resourceDescriptor| and the alignment the descriptor was
+        // given to compute it.
+        void Insert(const D3D12_RESOURCE_DESC& resourceDescriptor,
+                    const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
+                    uint64_t resourceAlignment) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mCache.size() >= kMaxResourceAllocationInfoCacheSize) {
+                mCache.clear();
+            }
+            mCache[resourceDescriptor] = {resourceInfo, resourceAlignment};
+        }
+
+      private:
+        struct HashFunc {
+            size_t operator()(const D3D12_RESOURCE_DESC& desc) const {
+                size_t hash = 0;
+                const auto combine = [&](uint64_t value) {
+                    hash ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                };
+                combine(desc.Dimension);
+                combine(desc.Alignment);
+                combine(desc.Width);
+                combine(desc.Height);
+                combine(desc.DepthOrArraySize);
+                combine(desc.MipLevels);
+                combine(desc.Format);
+                combine(desc.SampleDesc.Count);
+                combine(desc.SampleDesc.Quality);
+                combine(desc.Layout);
+                combine(desc.Flags);
+                return hash;
+            }
+        };
+
+        struct EqualityFunc {
+            bool operator()(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b) const {
+                return a.Dimension == b.Dimension && a.Alignment == b.Alignment &&
+                       a.Width == b.Width && a.Height == b.Height &&
+                       a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels &&
+                       a.Format == b.Format && a.SampleDesc.Count == b.SampleDesc.Count &&
+                       a.SampleDesc.Quality == b.SampleDesc.Quality && a.Layout == b.Layout &&
+                       a.Flags == b.Flags;
+            }
+        };
+
+        struct CacheEntry {
+            D3D12_RESOURCE_ALLOCATION_INFO ResourceInfo;
+            uint64_t ResourceAlignment;
+        };
+
+        const bool mIsBufferAllocationInfoAnalytic;
+
+        mutable std::mutex mMutex;
+        std::unordered_map<D3D12_RESOURCE_DESC, CacheEntry, HashFunc, EqualityFunc> mCache;
+    };
+
     namespace {
 
         // Combines heap type and flags used to allocate memory for resources into a single type for
@@ -59,19 +173,104 @@ namespace gpgmm { namespace d3d12 {
             RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_NON_RT_OR_DS_TEXTURES = 0x6,
             RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_RT_OR_DS_TEXTURES = 0x7,
 
+            // GPU upload heaps, by resource heap tier.
+            RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES = 0x8,
+            RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ONLY_BUFFERS = 0x9,
+
             RESOURCE_HEAP_TYPE_INVALID,
         };
 
+        // Buffers are always 64KB size-aligned and resource-aligned. See Remarks.
+        // https://docs.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-id3d12device-getresourceallocationinfo
+        D3D12_RESOURCE_ALLOCATION_INFO GetBufferAllocationInfo(uint64_t width) {
+            return {AlignTo(width, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT};
+        }
+
+        // Only well-formed buffers are sized without the device, so malformed ones still get
+        // validated by it. 64KB is the only alignment a buffer can be given, so it changes
+        // nothing. Widths which would overflow once aligned are left to the device too.
+        bool IsWellFormedBuffer(const D3D12_RESOURCE_DESC& resourceDescriptor) {
+            return resourceDescriptor.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER &&
+                   (resourceDescriptor.Alignment == 0 ||
+                    resourceDescriptor.Alignment == D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) &&
+                   resourceDescriptor.Width > 0 &&
+                   resourceDescriptor.Width <= std::numeric_limits<uint64_t>::max() -
+                                                   D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT &&
+                   resourceDescriptor.Height == 1 && resourceDescriptor.DepthOrArraySize == 1 &&
+                   resourceDescriptor.MipLevels == 1 &&
+                   resourceDescriptor.Format == DXGI_FORMAT_UNKNOWN &&
+                   resourceDescriptor.SampleDesc.Count == 1 &&
+                   resourceDescriptor.SampleDesc.Quality == 0 &&
+                   resourceDescriptor.Layout == D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        }
+
+        // New resource heaps for sub-allocation use at most this fraction of the budget remaining,
+        // so resource heaps shrink well before the budget is reached.
+        static constexpr uint64_t kBudgetRemainingDivisorForResourceHeap = 4;
+
+        // ALLOCATOR_FLAG_ADAPTIVE_COMMITTED times each way this many times before comparing them,
+        // then re-times the way not picked once every period of resources.
+        static constexpr uint32_t kMinCreateResourceCostCount = 4;
+        static constexpr uint64_t kCreateResourceCostRemeasurePeriod = 64;
+
+        // Moving average which weighs the latest latency by 1/8th, so costs follow the driver
+        // should it become slower or faster.
+        uint64_t UpdateAverageLatency(uint64_t averageLatency,
+                                      uint32_t count,
+                                      uint64_t latencyInNanoseconds) {
+            return (count == 0) ? latencyInNanoseconds
+                                : averageLatency - averageLatency / 8 + latencyInNanoseconds / 8;
+        }
+
+        // Zero means the resource heap pool size is unlimited.
+        uint64_t GetMaxPoolSize(uint64_t maxPooledResourceHeapUsage) {
+            return (maxPooledResourceHeapUsage == 0) ? kInvalidSize : maxPooledResourceHeapUsage;
+        }
+
+        // Checks once, against a few buffer sizes, that the device computes the same allocation
+        // info as GetBufferAllocationInfo. Otherwise, every buffer asks the device instead.
+        bool IsBufferAllocationInfoAnalytic(ID3D12Device* device) {
+            constexpr uint64_t kBufferWidths[] = {
+                1, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * 3 + 1};
+            for (uint64_t width : kBufferWidths) {
+                const D3D12_RESOURCE_DESC bufferDescriptor = {
+                    D3D12_RESOURCE_DIMENSION_BUFFER, 0, width, 1, 1, 1, DXGI_FORMAT_UNKNOWN,
+                    {1, 0}, D3D12_TEXTURE_LAYOUT_ROW_MAJOR, D3D12_RESOURCE_FLAG_NONE};
+                const D3D12_RESOURCE_ALLOCATION_INFO deviceInfo =
+                    device->GetResourceAllocationInfo(0, 1, &bufferDescriptor);
+                const D3D12_RESOURCE_ALLOCATION_INFO analyticInfo = GetBufferAllocationInfo(width);
+                if (deviceInfo.SizeInBytes != analyticInfo.SizeInBytes ||
+                    deviceInfo.Alignment != analyticInfo.Alignment) {
+                    gpgmm::WarningLog()
+                        << "Buffer allocation info differs from the device (" << width
+                        << " bytes), so the device is asked for every buffer instead.\n";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Calls into |device| are timed by |timer| and recorded into |latency|, unlike lookups.
         D3D12_RESOURCE_ALLOCATION_INFO GetResourceAllocationInfo(
             ID3D12Device* device,
+            ResourceAllocationInfoCache* cache,
+            PlatformTime* timer,
+            LatencyHistogram* latency,
             D3D12_RESOURCE_DESC& resourceDescriptor) {
-            // Buffers are always 64KB size-aligned and resource-aligned. See Remarks.
-            // https://docs.microsoft.com/en-us/windows/win32/api/d3d12/nf-d3d12-id3d12device-getresourceallocationinfo
-            if (resourceDescriptor.Alignment == 0 &&
-                resourceDescriptor.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
-                return {
-                    AlignTo(resourceDescriptor.Width, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
-                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT};
+            if (IsWellFormedBuffer(resourceDescriptor) &&
+                cache->IsBufferAllocationInfoAnalytic()) {
+                return GetBufferAllocationInfo(resourceDescriptor.Width);
+            }
+
+            const D3D12_RESOURCE_DESC requestedResourceDescriptor = resourceDescriptor;
+
+            D3D12_RESOURCE_ALLOCATION_INFO resourceInfo = {};
+            uint64_t resourceAlignment = 0;
+            if (cache->Lookup(requestedResourceDescriptor, &resourceInfo, &resourceAlignment)) {
+                resourceDescriptor.Alignment = resourceAlignment;
+                return resourceInfo;
             }
 
             // Small textures can take advantage of smaller alignments. For example,
@@ -90,8 +289,20 @@ namespace gpgmm { namespace d3d12 {
                                                    : D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
             }
 
-            D3D12_RESOURCE_ALLOCATION_INFO resourceInfo =
-                device->GetResourceAllocationInfo(0, 1, &resourceDescriptor);
+            const auto getDeviceResourceAllocationInfo = [&]() {
+                const uint64_t startTicks = timer->GetTicks();
+                const D3D12_RESOURCE_ALLOCATION_INFO info =
+                    device->GetResourceAllocationInfo(0, 1, &resourceDescriptor);
+                const uint64_t latencyInNanoseconds =
+                    timer->TicksToNanoseconds(timer->GetTicks() - startTicks);
+                latency->Record(latencyInNanoseconds);
+                TRACE_COUNTER1(TraceEventCategory::Allocation,
+                               "GPU get resource allocation info latency (us)",
+                               latencyInNanoseconds / 1000);
+                return info;
+            };
+
+            resourceInfo = getDeviceResourceAllocationInfo();
 
             // If the requested resource alignment was rejected, let D3D tell us what the
             // required alignment is for this resource.
@@ -99,22 +310,50 @@ namespace gpgmm { namespace d3d12 {
                 resourceDescriptor.Alignment != resourceInfo.Alignment) {
                 DebugEvent("ResourceAllocator.GetResourceAllocationInfo",
                            ALLOCATOR_MESSAGE_ID_RESOURCE_MISALIGNMENT)
-                    << "Resource alignment is much larger due to D3D12 (" +
-                           std::to_string(resourceDescriptor.Alignment) + " vs " +
-                           std::to_string(resourceInfo.Alignment) + " bytes) for resource : " +
-                           JSONSerializer::Serialize(resourceDescriptor).ToString() + ".";
+                    << "Resource alignment is much larger due to D3D12 ("
+                    << resourceDescriptor.Alignment << " vs " << resourceInfo.Alignment
+                    << " bytes) for resource : "
+                    << JSONSerializer::Serialize(resourceDescriptor).ToString() << ".";
 
                 resourceDescriptor.Alignment = 0;
-                resourceInfo = device->GetResourceAllocationInfo(0, 1, &resourceDescriptor);
+                resourceInfo = getDeviceResourceAllocationInfo();
             }
 
             if (resourceInfo.SizeInBytes == 0) {
                 resourceInfo.SizeInBytes = kInvalidSize;
             }
 
+            cache->Insert(requestedResourceDescriptor, resourceInfo,
+                          resourceDescriptor.Alignment);
+
             return resourceInfo;
         }
 
+        // Resources of the same key are expected to be created by the same layer of
+        // CreateResourceInternal. Sizes are rounded down to a power-of-two size class.
+        uint32_t GetCreateResourceLayerCacheKey(RESOURCE_HEAP_TYPE resourceHeapType,
+                                                const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                                const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
+                                                const ALLOCATION_DESC& allocationDescriptor) {
+            ASSERT(resourceInfo.SizeInBytes > 0);
+            uint32_t key = 1u << 31;  // Never zero, which is an empty entry.
+            key |= static_cast<uint32_t>(resourceHeapType);
+            key |= Log2(resourceInfo.SizeInBytes) << 4;
+            key |= (static_cast<uint32_t>(allocationDescriptor.Flags) & 0xFF) << 10;
+            key |= static_cast<uint32_t>(allocationDescriptor.Lifetime) << 18;
+            key |= static_cast<uint32_t>(resourceDescriptor.Dimension) << 21;
+            if (resourceInfo.Alignment < D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) {
+                key |= 1u << 24;
+            }
+            return key;
+        }
+
+        // Keys mostly differ by their low bits, so the index of their entry is taken from the
+        // high bits of a multiplicative hash instead.
+        size_t GetCreateResourceLayerCacheIndex(uint32_t layerCacheKey) {
+            return (layerCacheKey * 2654435761u) >> 24;
+        }
+
         D3D12_HEAP_TYPE GetHeapType(RESOURCE_HEAP_TYPE resourceHeapType) {
             switch (resourceHeapType) {
                 case RESOURCE_HEAP_TYPE_READBACK_ALLOW_ONLY_BUFFERS:
@@ -128,6 +367,9 @@ namespace gpgmm { namespace d3d12 {
                 case RESOURCE_HEAP_TYPE_UPLOAD_ALLOW_ONLY_BUFFERS:
                 case RESOURCE_HEAP_TYPE_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES:
                     return D3D12_HEAP_TYPE_UPLOAD;
+                case RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ONLY_BUFFERS:
+                case RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES:
+                    return kHeapTypeGPUUpload;
                 default:
                     UNREACHABLE();
                     return D3D12_HEAP_TYPE_DEFAULT;
@@ -139,10 +381,12 @@ namespace gpgmm { namespace d3d12 {
                 case RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ALL_BUFFERS_AND_TEXTURES:
                 case RESOURCE_HEAP_TYPE_READBACK_ALLOW_ALL_BUFFERS_AND_TEXTURES:
                 case RESOURCE_HEAP_TYPE_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES:
+                case RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES:
                     return D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
                 case RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_BUFFERS:
                 case RESOURCE_HEAP_TYPE_READBACK_ALLOW_ONLY_BUFFERS:
                 case RESOURCE_HEAP_TYPE_UPLOAD_ALLOW_ONLY_BUFFERS:
+                case RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ONLY_BUFFERS:
                     return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
                 case RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_NON_RT_OR_DS_TEXTURES:
                     return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
@@ -163,8 +407,8 @@ namespace gpgmm { namespace d3d12 {
             }
             // It is preferred to use a size that is a multiple of the alignment.
             // However, MSAA heaps are always aligned to 4MB instead of 64KB. This means
-            // if the heap size is too small, the VMM would fragment.
-            // TODO: Consider having MSAA vs non-MSAA heaps.
+            // if the heap size is too small, the VMM would fragment. MSAA textures are
+            // sub-allocated from heaps of their own, see mMSAATextureAllocatorOfType.
             return D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
         }
 
@@ -172,6 +416,17 @@ namespace gpgmm { namespace d3d12 {
                                                D3D12_HEAP_TYPE heapType,
                                                D3D12_RESOURCE_FLAGS flags,
                                                D3D12_RESOURCE_HEAP_TIER resourceHeapTier) {
+            // Older SDKs do not declare the GPU upload heap type, which would make it a case
+            // value outside of the enumeration below.
+            if (heapType == kHeapTypeGPUUpload) {
+                if (resourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2) {
+                    return RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+                }
+                return (dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+                           ? RESOURCE_HEAP_TYPE_GPU_UPLOAD_ALLOW_ONLY_BUFFERS
+                           : RESOURCE_HEAP_TYPE_INVALID;
+            }
+
             if (resourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2) {
                 switch (heapType) {
                     case D3D12_HEAP_TYPE_UPLOAD:
@@ -222,6 +477,11 @@ namespace gpgmm { namespace d3d12 {
         }
 
         D3D12_RESOURCE_STATES GetInitialResourceState(D3D12_HEAP_TYPE heapType) {
+            // Like upload heaps, so buffers can be sub-allocated within the same resource.
+            if (heapType == kHeapTypeGPUUpload) {
+                return D3D12_RESOURCE_STATE_GENERIC_READ;
+            }
+
             switch (heapType) {
                 case D3D12_HEAP_TYPE_DEFAULT:
                 case D3D12_HEAP_TYPE_UPLOAD:
@@ -235,6 +495,13 @@ namespace gpgmm { namespace d3d12 {
             }
         }
 
+        // Empty slabs keep their memory for the next allocation, unless memory must be
+        // de-allocated once no longer needed.
+        uint64_t GetMaxEmptySlabCount(const ALLOCATOR_DESC& descriptor) {
+            return (descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND) ? 0
+                                                                       : kDefaultMaxEmptySlabCount;
+        }
+
         // RAII wrapper to lock/unlock heap from the residency cache.
         class ScopedHeapLock final : public NonCopyable {
           public:
@@ -257,27 +524,59 @@ namespace gpgmm { namespace d3d12 {
             Heap* const mHeap;
         };
 
+        // Locks |mutex|, unless null. Should another thread hold it, the time spent waiting, in
+        // nanoseconds measured by |timer|, is recorded by |lockWaitLatency|. Uncontended locks are
+        // not recorded, so contention does not hide behind a majority of zero waits.
+        std::unique_lock<std::mutex> LockAndRecordWait(std::mutex* mutex,
+                                                       LatencyHistogram* lockWaitLatency,
+                                                       PlatformTime* timer) {
+            if (mutex == nullptr) {
+                return {};
+            }
+            std::unique_lock<std::mutex> lock(*mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                return lock;
+            }
+            if (lockWaitLatency == nullptr) {
+                lock.lock();
+                return lock;
+            }
+            const uint64_t waitStartTicks = timer->GetTicks();
+            lock.lock();
+            lockWaitLatency->Record(timer->TicksToNanoseconds(timer->GetTicks() - waitStartTicks));
+            return lock;
+        }
+
         // Combines AllocatorMemory and Create*Resource into a single call.
         // If the memory allocation was successful, the resource will be created using it.
         // Else, if the resource creation fails, the memory allocation will be cleaned up.
+        // The |heapTypeMutex| is only held while sub-allocating memory so the (potentially slow)
+        // driver call made by |createResourceFn| does not serialize other threads. It may be
+        // null when the |allocator| can be safely called without it. Time spent waiting for it
+        // is recorded by |lockWaitLatency|, as measured by |timer|.
         template <typename CreateResourceFn>
-        HRESULT TryAllocateResource(MemoryAllocator* allocator,
-                                    uint64_t size,
-                                    uint64_t alignment,
-                                    bool neverAllocate,
-                                    bool cacheSize,
-                                    bool prefetchMemory,
+        HRESULT TryAllocateResource(std::mutex* heapTypeMutex,
+                                    LatencyHistogram* lockWaitLatency,
+                                    PlatformTime* timer,
+                                    MemoryAllocator* allocator,
+                                    const MEMORY_ALLOCATION_REQUEST& request,
                                     CreateResourceFn&& createResourceFn) {
             // Do not attempt to allocate if the requested size already exceeds the fixed
             // memory size allowed by the allocator. Otherwise, both the memory and resource would
             // be created, immediately released, then likely re-allocated all over again once
             // TryAllocateResource returns.
-            if (allocator->GetMemorySize() != kInvalidSize && size > allocator->GetMemorySize()) {
+            if (allocator->GetMemorySize() != kInvalidSize &&
+                request.Size > allocator->GetMemorySize()) {
                 return E_FAIL;
             }
 
-            std::unique_ptr<MemoryAllocation> allocation = allocator->TryAllocateMemory(
-                size, alignment, neverAllocate, cacheSize, prefetchMemory);
+            std::unique_ptr<MemoryAllocation> allocation;
+            {
+                std::unique_lock<std::mutex> lock =
+                    LockAndRecordWait(heapTypeMutex, lockWaitLatency, timer);
+                allocation = allocator->TryAllocateMemory(request);
+            }
+
             if (allocation == nullptr) {
                 DebugEvent("ResourceAllocator.TryAllocateResource",
                            ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_FAILED)
@@ -289,14 +588,176 @@ namespace gpgmm { namespace d3d12 {
             if (FAILED(hr)) {
                 DebugEvent("ResourceAllocator.TryAllocateResource",
                            ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_FAILED)
-                    << "Resource failed to be created: " + GetErrorMessage(hr);
+                    << "Resource failed to be created: " << GetErrorMessage(hr);
+
+                std::unique_lock<std::mutex> lock =
+                    LockAndRecordWait(heapTypeMutex, lockWaitLatency, timer);
                 allocator->DeallocateMemory(std::move(allocation));
             }
             return hr;
         }
 
+        // Args of CreateResource, copied by value so they can be serialized once the trace event
+        // is written instead of while the resource is created.
+        struct CREATE_RESOURCE_TRACE_ARGS {
+            ALLOCATION_DESC AllocationDescriptor;
+            D3D12_RESOURCE_DESC ResourceDescriptor;
+            D3D12_RESOURCE_STATES InitialResourceState;
+            D3D12_CLEAR_VALUE ClearValue;
+            bool HasClearValue;
+
+            static TraceEventDeferredArgs Defer(const ALLOCATION_DESC& allocationDescriptor,
+                                                const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                                D3D12_RESOURCE_STATES initialResourceState,
+                                                const D3D12_CLEAR_VALUE* clearValue) {
+                CREATE_RESOURCE_TRACE_ARGS args = {};
+                args.AllocationDescriptor = allocationDescriptor;
+                args.ResourceDescriptor = resourceDescriptor;
+                args.InitialResourceState = initialResourceState;
+                if (clearValue != nullptr) {
+                    args.ClearValue = *clearValue;
+                    args.HasClearValue = true;
+                }
+                return TraceEventDeferredArgs::Create<CREATE_RESOURCE_TRACE_ARGS, Serialize>(args);
+            }
+
+            static void Serialize(JSONWriter* writer, const CREATE_RESOURCE_TRACE_ARGS& args) {
+                JSONSerializer::Serialize(
+                    writer,
+                    CREATE_RESOURCE_DESC{args.AllocationDescriptor, args.ResourceDescriptor,
+                                         args.InitialResourceState,
+                                         (args.HasClearValue) ? &args.ClearValue : nullptr});
+            }
+        };
+
     }  // namespace
 
+    // Page of memory mapped to a tile of a reserved resource, or unmapped when |Heap| is null.
+    struct TileMapping {
+        D3D12_TILED_RESOURCE_COORDINATE Coordinate;
+        ComPtr<ID3D12Heap> Heap;
+        uint32_t HeapTileOffset;
+    };
+
+    struct ReservedResourceTiles {
+        size_t ResourceHeapTypeIndex;
+        ID3D12Resource* Resource;
+
+        // Keyed by subresource then tile coordinate.
+        std::map<std::tuple<UINT, UINT, UINT, UINT>, std::unique_ptr<MemoryAllocation>>
+            MappedTiles;
+
+        // Changed since UpdateTileMappings was last called.
+        std::vector<TileMapping> PendingMappings;
+    };
+
+    class CreateResourceTask : public VoidCallback {
+      public:
+        CreateResourceTask(ResourceAllocator* resourceAllocator,
+                           const ALLOCATION_DESC& allocationDescriptor,
+                           const D3D12_RESOURCE_DESC& resourceDescriptor,
+                           D3D12_RESOURCE_STATES initialResourceState,
+                           const D3D12_CLEAR_VALUE* clearValue)
+            : mResourceAllocator(resourceAllocator),
+              mAllocationDescriptor(allocationDescriptor),
+              mResourceDescriptor(resourceDescriptor),
+              mInitialResourceState(initialResourceState),
+              mHasClearValue(clearValue != nullptr) {
+            if (mHasClearValue) {
+                mClearValue = *clearValue;
+            }
+        }
+
+        void operator()() override {
+            TRACE_EVENT0(TraceEventCategory::Allocation, "CreateResourceTask");
+            mResult = mResourceAllocator->CreateResource(
+                mAllocationDescriptor, mResourceDescriptor, mInitialResourceState,
+                (mHasClearValue) ? &mClearValue : nullptr, &mResourceAllocation);
+        }
+
+        HRESULT AcquireResourceAllocation(ResourceAllocation** resourceAllocationOut) {
+            *resourceAllocationOut = mResourceAllocation.Detach();
+            return mResult;
+        }
+
+      private:
+        ResourceAllocator* const mResourceAllocator;
+        const ALLOCATION_DESC mAllocationDescriptor;
+        const D3D12_RESOURCE_DESC mResourceDescriptor;
+        const D3D12_RESOURCE_STATES mInitialResourceState;
+        const bool mHasClearValue;
+        D3D12_CLEAR_VALUE mClearValue = {};
+
+        HRESULT mResult = E_PENDING;
+        ComPtr<ResourceAllocation> mResourceAllocation;
+    };
+
+    // ResourceAllocationEvent
+
+    ResourceAllocationEvent::ResourceAllocationEvent(std::shared_ptr<Event> event,
+                                                     std::shared_ptr<CreateResourceTask> task)
+        : mTask(task), mEvent(event) {
+    }
+
+    void ResourceAllocationEvent::Wait() {
+        mEvent->Wait();
+    }
+
+    bool ResourceAllocationEvent::IsSignaled() {
+        return mEvent->IsSignaled();
+    }
+
+    void ResourceAllocationEvent::Signal() {
+        return mEvent->Signal();
+    }
+
+    void ResourceAllocationEvent::AddSignaledCallback(std::shared_ptr<VoidCallback> callback) {
+        mEvent->AddSignaledCallback(callback);
+    }
+
+    HRESULT ResourceAllocationEvent::AcquireResourceAllocation(
+        ResourceAllocation** resourceAllocationOut) {
+        if (!resourceAllocationOut) {
+            return E_POINTER;
+        }
+
+        Wait();
+        return mTask->AcquireResourceAllocation(resourceAllocationOut);
+    }
+
+    class ResourceHeapTypeTask : public VoidCallback {
+      public:
+        ResourceHeapTypeTask(const std::function<void(uint32_t)>& callback,
+                             uint32_t resourceHeapTypeIndex)
+            : mCallback(callback), mResourceHeapTypeIndex(resourceHeapTypeIndex) {
+        }
+
+        void operator()() override {
+            mCallback(mResourceHeapTypeIndex);
+        }
+
+      private:
+        const std::function<void(uint32_t)>& mCallback;
+        const uint32_t mResourceHeapTypeIndex;
+    };
+
+    class WarmUpTask : public VoidCallback {
+      public:
+        WarmUpTask(ResourceAllocator* resourceAllocator,
+                   const std::vector<ALLOCATOR_WARM_UP_DESC>& profile)
+            : mResourceAllocator(resourceAllocator), mProfile(profile) {
+        }
+
+        void operator()() override {
+            TRACE_EVENT0(TraceEventCategory::Allocation, "WarmUpTask");
+            mResourceAllocator->WarmUp(mProfile);
+        }
+
+      private:
+        ResourceAllocator* const mResourceAllocator;
+        const std::vector<ALLOCATOR_WARM_UP_DESC> mProfile;
+    };
+
     // static
     HRESULT ResourceAllocator::CreateAllocator(const ALLOCATOR_DESC& descriptor,
                                                ResourceAllocator** resourceAllocatorOut,
@@ -313,33 +774,116 @@ namespace gpgmm { namespace d3d12 {
             caps.reset(ptr);
         }
 
+        // Unless specified, the preferred resource heap size is picked per heap type once the
+        // max resource heap size is known, so it stays zero.
         ALLOCATOR_DESC newDescriptor = descriptor;
-        newDescriptor.PreferredResourceHeapSize = (descriptor.PreferredResourceHeapSize > 0)
-                                                      ? descriptor.PreferredResourceHeapSize
-                                                      : kDefaultPreferredResourceHeapSize;
 
         newDescriptor.MaxResourceHeapSize =
             (descriptor.MaxResourceHeapSize > 0)
                 ? std::min(descriptor.MaxResourceHeapSize, caps->GetMaxResourceHeapSize())
                 : caps->GetMaxResourceHeapSize();
 
+        // Sub-allocators never allocate more than a power-of-two sized resource heap.
+        newDescriptor.MaxResourceSizeForSubAllocation =
+            (descriptor.MaxResourceSizeForSubAllocation > 0)
+                ? std::min(descriptor.MaxResourceSizeForSubAllocation,
+                           PrevPowerOfTwo(newDescriptor.MaxResourceHeapSize))
+                : PrevPowerOfTwo(newDescriptor.MaxResourceHeapSize);
+
         newDescriptor.ResourceFragmentationLimit = (descriptor.ResourceFragmentationLimit > 0)
                                                        ? descriptor.ResourceFragmentationLimit
-                                                       : kDefaultFragmentationLimit;
+                                                       : caps->GetResourceFragmentationLimit();
+
+        newDescriptor.TransientBufferSize =
+            AlignTo((descriptor.TransientBufferSize > 0) ? descriptor.TransientBufferSize
+                                                         : kDefaultTransientBufferSize,
+                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+        newDescriptor.LargeBufferSize = (descriptor.LargeBufferSize > 0)
+                                            ? NextPowerOfTwo(std::max<uint64_t>(
+                                                  descriptor.LargeBufferSize,
+                                                  D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
+                                            : 0;
+
+        newDescriptor.SharedStatsIntervalInSeconds =
+            (descriptor.SharedStatsIntervalInSeconds > 0) ? descriptor.SharedStatsIntervalInSeconds
+                                                          : kDefaultSharedStatsIntervalInSeconds;
+
+        // The default is capped by the max resource heap size, unlike a specified size.
+        newDescriptor.MaxBufferSlabSize =
+            (descriptor.MaxBufferSlabSize > 0)
+                ? NextPowerOfTwo(std::max<uint64_t>(descriptor.MaxBufferSlabSize,
+                                                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
+                : std::max<uint64_t>(
+                      std::min(kDefaultMaxBufferSlabSize,
+                               PrevPowerOfTwo(newDescriptor.MaxResourceHeapSize)),
+                      D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+        if ((newDescriptor.Flags & ALLOCATOR_FLAG_CREATE_NOT_ZEROED) &&
+            !caps->IsCreateNotZeroedSupported()) {
+            gpgmm::InfoLog() << "ALLOCATOR_FLAG_CREATE_NOT_ZEROED was ignored since the device "
+                                "does not support D3D12_HEAP_FLAG_CREATE_NOT_ZEROED.\n";
+            newDescriptor.Flags ^= ALLOCATOR_FLAG_CREATE_NOT_ZEROED;
+        }
 
         if (newDescriptor.PreferredResourceHeapSize > newDescriptor.MaxResourceHeapSize) {
             return E_INVALIDARG;
         }
 
+        if (newDescriptor.MaxBufferSlabSize > newDescriptor.MaxResourceHeapSize) {
+            return E_INVALIDARG;
+        }
+
+        if (newDescriptor.LargeBufferSize > newDescriptor.MaxResourceHeapSize) {
+            return E_INVALIDARG;
+        }
+
+        for (size_t i = 0; i < newDescriptor.SizeClasses.size(); i++) {
+            const ALLOCATOR_SIZE_CLASS_DESC& sizeClass = newDescriptor.SizeClasses[i];
+            if (sizeClass.Algorithm > ALLOCATOR_ALGORITHM_DEDICATED) {
+                return E_INVALIDARG;
+            }
+
+            // The last size class has no max size.
+            if (i + 1 < newDescriptor.SizeClasses.size() &&
+                (sizeClass.MaxSizeInBytes == 0 ||
+                 (i > 0 &&
+                  sizeClass.MaxSizeInBytes <= newDescriptor.SizeClasses[i - 1].MaxSizeInBytes))) {
+                return E_INVALIDARG;
+            }
+        }
+
+        for (size_t i = 0; i < newDescriptor.HeapTypeBudgets.size(); i++) {
+            const ALLOCATOR_HEAP_TYPE_BUDGET_DESC& heapTypeBudget =
+                newDescriptor.HeapTypeBudgets[i];
+            if ((heapTypeBudget.HeapType != D3D12_HEAP_TYPE_DEFAULT &&
+                 heapTypeBudget.HeapType != D3D12_HEAP_TYPE_UPLOAD &&
+                 heapTypeBudget.HeapType != D3D12_HEAP_TYPE_READBACK &&
+                 heapTypeBudget.HeapType != kHeapTypeGPUUpload) ||
+                heapTypeBudget.MaxUsage == 0) {
+                return E_INVALIDARG;
+            }
+
+            for (size_t j = 0; j < i; j++) {
+                if (newDescriptor.HeapTypeBudgets[j].HeapType == heapTypeBudget.HeapType) {
+                    return E_INVALIDARG;
+                }
+            }
+        }
+
         if (newDescriptor.RecordOptions.Flags != ALLOCATOR_RECORD_FLAG_NONE) {
-            const std::string& traceFile = descriptor.RecordOptions.TraceFile.empty()
-                                               ? std::string(kDefaultTraceFile)
-                                               : descriptor.RecordOptions.TraceFile;
+            const bool useBinaryTraceFormat = newDescriptor.RecordOptions.UseBinaryTraceFormat;
+            const std::string& traceFile =
+                descriptor.RecordOptions.TraceFile.empty()
+                    ? std::string(useBinaryTraceFormat ? kDefaultBinaryTraceFile
+                                                       : kDefaultTraceFile)
+                    : descriptor.RecordOptions.TraceFile;
 
             StartupEventTrace(
                 traceFile, !(newDescriptor.RecordOptions.Flags & ALLOCATOR_RECORD_FLAG_API_TIMINGS),
                 !(newDescriptor.RecordOptions.Flags & ALLOCATOR_RECORD_FLAG_API_OBJECTS),
-                !(newDescriptor.RecordOptions.Flags & ALLOCATOR_RECORD_FLAG_API_CALLS));
+                !(newDescriptor.RecordOptions.Flags & ALLOCATOR_RECORD_FLAG_API_CALLS),
+                useBinaryTraceFormat, newDescriptor.RecordOptions.FlightRecorderDurationInSeconds);
 
             const LogSeverity& recordMessageMinLevel =
                 static_cast<LogSeverity>(newDescriptor.RecordOptions.MinMessageLevel);
@@ -360,17 +904,38 @@ namespace gpgmm { namespace d3d12 {
         }
 #endif
 
+        // Created before the residency manager, so nothing else needs to be undone if the block
+        // already exists.
+        std::unique_ptr<SharedStatsPublisher> sharedStatsPublisher;
+        if (!newDescriptor.SharedStatsName.empty()) {
+            ReturnIfFailed(
+                SharedStatsPublisher::Create(newDescriptor.SharedStatsName, &sharedStatsPublisher));
+        }
+
         ComPtr<ResidencyManager> residencyManager;
         if (residencyManagerOut != nullptr) {
             ReturnIfFailed(ResidencyManager::CreateResidencyManager(
                 newDescriptor.Device, newDescriptor.Adapter, newDescriptor.IsUMA,
                 newDescriptor.MaxVideoMemoryBudget, newDescriptor.TotalResourceBudgetLimit,
-                newDescriptor.VideoMemoryEvictSize, &residencyManager));
+                newDescriptor.VideoMemoryEvictSize,
+                /*evictInBackground*/ newDescriptor.Flags & ALLOCATOR_FLAG_EVICT_IN_BACKGROUND,
+                /*offerPooledHeaps*/ newDescriptor.Flags & ALLOCATOR_FLAG_OFFER_POOLED_HEAPS,
+                newDescriptor.EvictionPolicy, newDescriptor.ResidencyPredictionSubmissionCount,
+                newDescriptor.VideoMemoryReservationSubmissionCount, &residencyManager));
         }
 
         *resourceAllocatorOut =
             new ResourceAllocator(newDescriptor, residencyManager, std::move(caps));
 
+        if (sharedStatsPublisher != nullptr) {
+            ResourceAllocator* resourceAllocator = *resourceAllocatorOut;
+            sharedStatsPublisher->Start(newDescriptor.SharedStatsIntervalInSeconds,
+                                        [resourceAllocator](SHARED_ALLOCATOR_STATS* statsOut) {
+                                            resourceAllocator->CollectSharedStats(statsOut);
+                                        });
+            resourceAllocator->mSharedStatsPublisher = std::move(sharedStatsPublisher);
+        }
+
         GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(*resourceAllocatorOut, newDescriptor);
 
         if (residencyManagerOut != nullptr) {
@@ -390,159 +955,451 @@ namespace gpgmm { namespace d3d12 {
           mResourceHeapTier(descriptor.ResourceHeapTier),
           mIsAlwaysCommitted(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_COMMITED),
           mIsAlwaysInBudget(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_IN_BUDGET),
+          mReleaseInBackground(descriptor.Flags & ALLOCATOR_FLAG_RELEASE_IN_BACKGROUND),
+          mHeapCreationFlags((descriptor.Flags & ALLOCATOR_FLAG_CREATE_NOT_ZEROED)
+                                 ? D3D12_HEAP_FLAG_CREATE_NOT_ZEROED
+                                 : D3D12_HEAP_FLAG_NONE),
           mMaxResourceHeapSize(descriptor.MaxResourceHeapSize),
-          mAllocationTimer(gpgmm::CreatePlatformTime()) {
+          mMaxResourceSizeForSubAllocation(descriptor.MaxResourceSizeForSubAllocation),
+          mDescriptor(descriptor),
+          mResourceAllocationInfoCache(std::make_unique<ResourceAllocationInfoCache>(
+              IsBufferAllocationInfoAnalytic(descriptor.Device.Get()))),
+          mAllocationTimer(gpgmm::CreatePlatformTime(PlatformTimeSource::kCycleCounter)) {
         GPGMM_TRACE_EVENT_OBJECT_NEW(this);
 
 #if defined(GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG)
         mDebugAllocator = std::make_unique<DebugResourceAllocator>();
+#else
+        if (descriptor.Flags & ALLOCATOR_FLAG_TRACK_LIVE_ALLOCATIONS) {
+            mDebugAllocator = std::make_unique<DebugResourceAllocator>();
+        }
 #endif
 
-        for (uint32_t resourceHeapTypeIndex = 0; resourceHeapTypeIndex < kNumOfResourceHeapTypes;
-             resourceHeapTypeIndex++) {
-            const RESOURCE_HEAP_TYPE& resourceHeapType =
-                static_cast<RESOURCE_HEAP_TYPE>(resourceHeapTypeIndex);
+        if (descriptor.Flags & ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE) {
+            mWarmUpProfileRecorder = std::make_unique<WarmUpProfileRecorder>();
+        }
 
-            const D3D12_HEAP_FLAGS& heapFlags = GetHeapFlags(resourceHeapType);
-            const uint64_t& heapAlignment = GetHeapAlignment(heapFlags);
-            const D3D12_HEAP_TYPE& heapType = GetHeapType(resourceHeapType);
+        for (const ALLOCATOR_HEAP_TYPE_BUDGET_DESC& heapTypeBudget : descriptor.HeapTypeBudgets) {
+            mHeapTypeBudgets[static_cast<size_t>(heapTypeBudget.HeapType)] =
+                std::make_unique<HeapUsageBudget>(heapTypeBudget.MaxUsage);
+        }
 
-            // General-purpose allocators.
-            // Used for dynamic resource allocation or when the resource size is not known at
-            // compile-time.
-            {
-                std::unique_ptr<MemoryAllocator> resourceHeapAllocator =
-                    std::make_unique<ResourceHeapAllocator>(mResidencyManager.Get(), mDevice.Get(),
-                                                            heapType, heapFlags, mIsUMA,
-                                                            mIsAlwaysInBudget);
-
-                std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator;
-                if (!(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND)) {
-                    pooledOrNonPooledAllocator = std::make_unique<SegmentedMemoryAllocator>(
-                        std::move(resourceHeapAllocator), heapAlignment);
-                } else {
-                    pooledOrNonPooledAllocator = std::move(resourceHeapAllocator);
+        // Allocators of each resource heap type are only created upon first use, since most are
+        // never used (ex. readback textures). Resource heaps reserved ahead of demand are
+        // created for every resource heap type, so every allocator is created upfront instead.
+        if (descriptor.ReservedResourceHeapCount > 0) {
+            for (uint32_t resourceHeapTypeIndex = 0;
+                 resourceHeapTypeIndex < kNumOfResourceHeapTypes; resourceHeapTypeIndex++) {
+                InitializeAllocatorsOfType(resourceHeapTypeIndex);
+            }
+        }
+
+        // Warm-up has no effect unless resource heaps are pooled.
+        if (!descriptor.WarmUpProfile.empty() && !mIsAlwaysCommitted &&
+            !(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND)) {
+            if (descriptor.Flags & ALLOCATOR_FLAG_WARM_UP_IN_BACKGROUND) {
+                std::shared_ptr<WarmUpTask> task =
+                    std::make_shared<WarmUpTask>(this, descriptor.WarmUpProfile);
+                mWarmUpThreadPool = ThreadPool::Create(/*maxWorkerCount*/ 1);
+                mWarmUpEvent =
+                    ThreadPool::PostTask(mWarmUpThreadPool, task, TaskClass::kPrefetch);
+            } else {
+                WarmUp(descriptor.WarmUpProfile);
+            }
+        }
+    }
+
+    void ResourceAllocator::InitializeAllocatorsOfType(size_t resourceHeapTypeIndex) {
+        if (IsInitializedOfType(resourceHeapTypeIndex)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutexOfType[resourceHeapTypeIndex]);
+        if (mIsInitializedOfType[resourceHeapTypeIndex].load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation,
+                     "ResourceAllocator.InitializeAllocatorsOfType");
+
+        const ALLOCATOR_DESC& descriptor = mDescriptor;
+        const RESOURCE_HEAP_TYPE& resourceHeapType =
+            static_cast<RESOURCE_HEAP_TYPE>(resourceHeapTypeIndex);
+
+        const D3D12_HEAP_FLAGS& heapFlags = GetHeapFlags(resourceHeapType);
+        const uint64_t& heapAlignment = GetHeapAlignment(heapFlags);
+        const D3D12_HEAP_TYPE& heapType = GetHeapType(resourceHeapType);
+        const uint64_t preferredResourceHeapSize =
+            GetPreferredResourceHeapSize(descriptor, heapType);
+
+        // Resource heap tier 2 allows buffers and any textures to share a resource heap, so
+        // every allocator of the heap type allocates from the same pool of resource heaps.
+        // Heaps de-allocated for one kind of resource get re-used by another, instead of each
+        // allocator keeping its own.
+        if (mResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2 &&
+            heapFlags == D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES) {
+            mSharedResourceHeapAllocatorOfType[resourceHeapTypeIndex] =
+                CreateResourceHeapAllocator(
+                    descriptor, heapType, heapFlags, heapAlignment,
+                    (mIsAlwaysCommitted) ? 0 : descriptor.ReservedResourceHeapCount);
+        }
+
+        // General-purpose allocators.
+        // Used for dynamic resource allocation or when the resource size is not known at
+        // compile-time. Each lifetime gets its own allocators, and so its own resource heaps.
+        // Heaps are only created on first use, so a lifetime never requested costs nothing.
+        // Reserved resource heaps are only used by resources of unknown lifetime.
+        {
+            std::vector<std::unique_ptr<MemoryAllocator>> lifetimeAllocators;
+            for (uint32_t lifetime = 0; lifetime < kNumOfMemoryAllocationLifetimes; lifetime++) {
+                ALLOCATOR_DESC lifetimeDescriptor = descriptor;
+                if (static_cast<MemoryAllocationLifetime>(lifetime) !=
+                    MemoryAllocationLifetime::kUnknown) {
+                    lifetimeDescriptor.ReservedResourceHeapCount = 0;
                 }
 
-                std::unique_ptr<MemoryAllocator> buddyAllocator =
-                    std::make_unique<BuddyMemoryAllocator>(
-                        PrevPowerOfTwo(mMaxResourceHeapSize), descriptor.PreferredResourceHeapSize,
-                        heapAlignment, std::move(pooledOrNonPooledAllocator));
+                if (descriptor.SubAllocatorShardCount <= 1) {
+                    lifetimeAllocators.push_back(
+                        CreateGeneralPurposeAllocator(lifetimeDescriptor, heapType, heapFlags,
+                                                      heapAlignment,
+                                                      /*resourceHeapAllocator*/ nullptr));
+                    continue;
+                }
+
+                // Shards only share the pool of resource heaps, so a heap released by one
+                // shard can be re-used by another.
+                std::unique_ptr<MemoryAllocator> shardResourceHeapAllocator =
+                    CreateResourceHeapAllocator(
+                        lifetimeDescriptor, heapType, heapFlags, heapAlignment,
+                        (mIsAlwaysCommitted) ? 0 : lifetimeDescriptor.ReservedResourceHeapCount);
+
+                std::vector<std::unique_ptr<MemoryAllocator>> shards;
+                for (uint32_t i = 0; i < descriptor.SubAllocatorShardCount; i++) {
+                    shards.push_back(CreateGeneralPurposeAllocator(
+                        lifetimeDescriptor, heapType, heapFlags, heapAlignment,
+                        shardResourceHeapAllocator.get()));
+                }
+
+                mShardResourceHeapAllocatorsOfType[resourceHeapTypeIndex].push_back(
+                    std::move(shardResourceHeapAllocator));
+                lifetimeAllocators.push_back(
+                    std::make_unique<ShardedMemoryAllocator>(std::move(shards)));
+            }
+
+            mResourceAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<LifetimeMemoryAllocator>(std::move(lifetimeAllocators));
+        }
 
-                // TODO: Figure out the optimal slab size to heap ratio.
-                mResourceAllocatorOfType[resourceHeapTypeIndex] = std::make_unique<
-                    SlabCacheAllocator>(
+        {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment);
+
+            mResourceHeapAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<StandaloneMemoryAllocator>(std::move(pooledOrNonPooledAllocator));
+        }
+
+        // Small textures are placed in 4KB blocks instead.
+        if (resourceHeapType == RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ALL_BUFFERS_AND_TEXTURES ||
+            resourceHeapType == RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_NON_RT_OR_DS_TEXTURES) {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment);
+
+            mSmallTextureAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<SlabCacheAllocator>(
+                    /*minBlockSize*/ D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT,
+                    /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
+                    /*slabSize*/ preferredResourceHeapSize,
+                    /*slabAlignment*/ heapAlignment,
+                    /*slabFragmentationLimit*/ descriptor.ResourceFragmentationLimit,
+                    /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+        }
+
+        // MSAA textures are placed in 4MB blocks of their own resource heaps instead, sized in
+        // multiples of 4MB.
+        if (resourceHeapType == RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ALL_BUFFERS_AND_TEXTURES ||
+            resourceHeapType == RESOURCE_HEAP_TYPE_DEFAULT_ALLOW_ONLY_RT_OR_DS_TEXTURES) {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment);
+
+            mMSAATextureAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<SlabCacheAllocator>(
+                    /*minBlockSize*/ D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT,
+                    /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
+                    /*slabSize*/
+                    AlignTo(preferredResourceHeapSize,
+                            D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT),
+                    /*slabAlignment*/ heapAlignment,
+                    /*slabFragmentationLimit*/ descriptor.ResourceFragmentationLimit,
+                    /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+        }
+
+        // Cold resources are kept apart, in heaps evicted before any other.
+        if (heapType == D3D12_HEAP_TYPE_DEFAULT) {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment,
+                                            /*reservedResourceHeapCount*/ 0,
+                                            D3D12_RESIDENCY_PRIORITY_MINIMUM);
+
+            mColdAllocatorOfType[resourceHeapTypeIndex] = std::make_unique<SlabCacheAllocator>(
+                /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
+                /*slabSize*/ preferredResourceHeapSize,
+                /*slabAlignment*/ heapAlignment,
+                /*slabFragmentationLimit*/ descriptor.ResourceFragmentationLimit,
+                /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+        }
+
+        // CPU-accessible resources are placed in custom heaps, which map default heaps to
+        // CPU-visible pages. Custom heaps only reside in the same (local) memory as default
+        // heaps on UMA adapters.
+        if (heapType == D3D12_HEAP_TYPE_DEFAULT && mIsUMA) {
+            D3D12_HEAP_PROPERTIES heapProperties = {};
+            heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM;
+            heapProperties.CPUPageProperty = (mCaps->IsCacheCoherentUMA())
+                                                 ? D3D12_CPU_PAGE_PROPERTY_WRITE_BACK
+                                                 : D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE;
+            heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment,
+                                            /*reservedResourceHeapCount*/ 0,
+                                            /*residencyPriority*/ {}, &heapProperties);
+
+            mCPUAccessibleAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<SlabCacheAllocator>(
                     /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
                     /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
-                    /*slabSize*/ descriptor.PreferredResourceHeapSize,
+                    /*slabSize*/ preferredResourceHeapSize,
                     /*slabAlignment*/ heapAlignment,
                     /*slabFragmentationLimit*/ descriptor.ResourceFragmentationLimit,
-                    /*enablePrefetch*/ !(descriptor.Flags & ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH),
-                    std::move(buddyAllocator));
-            }
+                    /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+        }
 
-            {
-                std::unique_ptr<MemoryAllocator> resourceHeapAllocator =
-                    std::make_unique<ResourceHeapAllocator>(mResidencyManager.Get(), mDevice.Get(),
-                                                            heapType, heapFlags, mIsUMA,
-                                                            mIsAlwaysInBudget);
-
-                std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator;
-                if (!(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND)) {
-                    pooledOrNonPooledAllocator = std::make_unique<SegmentedMemoryAllocator>(
-                        std::move(resourceHeapAllocator), heapAlignment);
-                } else {
-                    pooledOrNonPooledAllocator = std::move(resourceHeapAllocator);
-                }
+        // Aliased resources share a resource heap sized to fit them. The same set of aliased
+        // resources tends to be requested every frame, so heaps are pooled like standalone
+        // ones.
+        {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment);
 
-                mResourceHeapAllocatorOfType[resourceHeapTypeIndex] =
-                    std::make_unique<StandaloneMemoryAllocator>(
-                        std::move(pooledOrNonPooledAllocator));
-            }
+            mAliasedAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<AliasedMemoryAllocator>(std::move(pooledOrNonPooledAllocator),
+                                                         heapAlignment);
+        }
 
-            // Dedicated allocators.
-            {
-                // Buffers are always 64KB aligned.
-                // https://docs.microsoft.com/en-us/windows/win32/api/d3d12/ns-d3d12-d3d12_resource_desc
-                std::unique_ptr<MemoryAllocator> bufferOnlyAllocator =
-                    std::make_unique<BufferAllocator>(
-                        this, heapType, D3D12_RESOURCE_FLAG_NONE, GetInitialResourceState(heapType),
-                        /*resourceSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-                        /*resourceAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
-
-                std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator;
-                if (!(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND)) {
-                    pooledOrNonPooledAllocator = std::make_unique<SegmentedMemoryAllocator>(
-                        std::move(bufferOnlyAllocator),
-                        /*heapAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
-                } else {
-                    pooledOrNonPooledAllocator = std::move(bufferOnlyAllocator);
-                }
+        // Tiles of reserved resources are mapped to 64KB pages slab-allocated from pooled
+        // resource heaps, so mapping and unmapping tiles rarely creates or destroys a heap.
+        if (heapType == D3D12_HEAP_TYPE_DEFAULT) {
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator =
+                CreateResourceHeapAllocator(descriptor, heapType, heapFlags, heapAlignment);
+
+            mTilePageAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<SlabCacheAllocator>(
+                    /*minBlockSize*/ D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES,
+                    /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
+                    /*slabSize*/ preferredResourceHeapSize,
+                    /*slabAlignment*/ heapAlignment,
+                    /*slabFragmentationLimit*/ 0,
+                    /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+        }
+
+        // Dedicated allocators.
+        {
+            // Placed buffers use the same pool of resource heaps as standalone resources, so
+            // the heaps are trimmed and re-used like any other.
+            MemoryAllocator* placedBufferHeapAllocator =
+                (descriptor.Flags & ALLOCATOR_FLAG_USE_PLACED_BUFFERS)
+                    ? mResourceHeapAllocatorOfType[resourceHeapTypeIndex].get()
+                    : nullptr;
+
+            // Buffers are always 64KB aligned. Each slab is its own buffer, sized by the
+            // slab allocator.
+            // https://docs.microsoft.com/en-us/windows/win32/api/d3d12/ns-d3d12-d3d12_resource_desc
+            std::unique_ptr<MemoryAllocator> bufferOnlyAllocator =
+                std::make_unique<BufferAllocator>(
+                    this, heapType, D3D12_RESOURCE_FLAG_NONE, GetInitialResourceState(heapType),
+                    /*resourceSize*/ kInvalidSize,
+                    /*resourceAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                    placedBufferHeapAllocator);
+
+            // Placed buffers are not pooled since their resource heaps already are.
+            std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator;
+            if (!(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND) &&
+                placedBufferHeapAllocator == nullptr) {
+                pooledOrNonPooledAllocator = std::make_unique<SegmentedMemoryAllocator>(
+                    std::move(bufferOnlyAllocator),
+                    /*heapAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+            } else {
+                pooledOrNonPooledAllocator = std::move(bufferOnlyAllocator);
+            }
 
-                // Buffers are byte-addressable when sub-allocated within and cannot internally
-                // fragment by definition.
-                mBufferAllocatorOfType[resourceHeapTypeIndex] =
+            // Buffers are byte-addressable when sub-allocated within and cannot internally
+            // fragment by definition.
+            // Small buffers are frequently created and released by many threads at once, so
+            // blocks are cached per-thread to avoid contending on the slab allocator lock.
+            // Slab size adapts to the allocation rate, so frequently created buffers share
+            // fewer, larger committed resources. A buffer created and released every frame
+            // re-uses the same empty slab instead of re-creating its committed resource.
+            mBufferAllocatorOfType[resourceHeapTypeIndex] =
+                std::make_unique<MagazineMemoryAllocator>(
                     std::make_unique<SlabCacheAllocator>(
                         /*minBlockSize*/ 1,
-                        /*maxSlabSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                        /*maxSlabSize*/ descriptor.MaxBufferSlabSize,
                         /*slabSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
                         /*slabAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
                         /*slabFragmentationLimit*/ 0,
-                        /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator));
+                        /*enablePrefetch*/ false, std::move(pooledOrNonPooledAllocator),
+                        /*adaptSlabSize*/ true, GetMaxEmptySlabCount(descriptor)),
+                    /*minBlockSize*/ 1, kDefaultMagazineSize);
+
+            // Transient buffers are linearly allocated within a single upload buffer, which
+            // is only created upon first use.
+            if (heapType == D3D12_HEAP_TYPE_UPLOAD) {
+                mTransientAllocatorOfType[resourceHeapTypeIndex] =
+                    std::make_unique<RingMemoryAllocator>(
+                        std::make_unique<BufferAllocator>(
+                            this, heapType, D3D12_RESOURCE_FLAG_NONE,
+                            GetInitialResourceState(heapType), descriptor.TransientBufferSize,
+                            D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                            placedBufferHeapAllocator),
+                        descriptor.TransientBufferSize,
+                        D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+            }
+
+            // Large buffers are sub-allocated within a few much larger buffers instead of
+            // each being placed in a resource heap. Blocks are 256B aligned so any buffer
+            // sub-allocated within could be bound as a constant buffer.
+            if (descriptor.LargeBufferSize > 0) {
+                std::unique_ptr<MemoryAllocator> largeBufferOnlyAllocator =
+                    std::make_unique<BufferAllocator>(
+                        this, heapType, D3D12_RESOURCE_FLAG_NONE,
+                        GetInitialResourceState(heapType), descriptor.LargeBufferSize,
+                        D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, placedBufferHeapAllocator);
+
+                std::unique_ptr<MemoryAllocator> pooledOrNonPooledLargeBufferAllocator;
+                if (!(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND) &&
+                    placedBufferHeapAllocator == nullptr) {
+                    pooledOrNonPooledLargeBufferAllocator =
+                        std::make_unique<SegmentedMemoryAllocator>(
+                            std::move(largeBufferOnlyAllocator),
+                            D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+                } else {
+                    pooledOrNonPooledLargeBufferAllocator = std::move(largeBufferOnlyAllocator);
+                }
+
+                mLargeBufferAllocatorOfType[resourceHeapTypeIndex] =
+                    std::make_unique<TLSFMemoryAllocator>(
+                        PrevPowerOfTwo(mMaxResourceHeapSize), descriptor.LargeBufferSize,
+                        D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                        std::move(pooledOrNonPooledLargeBufferAllocator),
+                        /*minBlockSize*/ D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
             }
+        }
 
-            // Cache resource sizes commonly requested.
-            // Ensures the next block is always made available upon first request without
-            // increasing the memory footprint. Since resources are always sized-aligned, the
-            // cached size must be requested per alignment {4KB, 64KB, or 4MB}. To avoid unbounded
-            // cache growth, a known set of pre-defined sizes initializes the allocators.
+        // Cache resource sizes commonly requested.
+        // Ensures the next block is always made available upon first request without
+        // increasing the memory footprint. Since resources are always sized-aligned, the
+        // cached size must be requested per alignment {4KB, 64KB, or 4MB}. To avoid unbounded
+        // cache growth, a known set of pre-defined sizes initializes the allocators.
 
 #if defined(GPGMM_ENABLE_SIZE_CACHE)
-            // Temporary suppress log messages emitted from internal cache-miss requests.
-            {
-                ScopedLogLevel scopedLogLevel(LogSeverity::Info);
-                for (uint64_t i = 0; i < MemorySize::kPowerOfTwoClassSize; i++) {
-                    MemoryAllocator* allocator =
-                        mResourceAllocatorOfType[resourceHeapTypeIndex].get();
-                    const uint64_t sizeToCache = MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes;
-                    if (sizeToCache > allocator->GetMemorySize()) {
-                        continue;
-                    }
+        // Temporary suppress log messages emitted from internal cache-miss requests.
+        {
+            ScopedLogLevel scopedLogLevel(LogSeverity::Info);
+            for (uint64_t i = 0; i < MemorySize::kPowerOfTwoClassSize; i++) {
+                MemoryAllocator* allocator = mResourceAllocatorOfType[resourceHeapTypeIndex].get();
+                const uint64_t sizeToCache = MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes;
+                if (sizeToCache > allocator->GetMemorySize()) {
+                    continue;
+                }
 
-                    if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
-                                  D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)) {
-                        allocator->TryAllocateMemory(
-                            sizeToCache, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT,
-                            /*neverAllocate*/ true, /*cacheSize*/ true, /*prefetchMemory*/ false);
-                    }
+                MEMORY_ALLOCATION_REQUEST cacheRequest = {};
+                cacheRequest.Size = sizeToCache;
+                cacheRequest.NeverAllocate = true;
+                cacheRequest.CacheSize = true;
 
-                    if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
-                                  D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)) {
-                        allocator->TryAllocateMemory(
-                            sizeToCache, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-                            /*neverAllocate*/ true, /*cacheSize*/ true, /*prefetchMemory*/ false);
-                    }
+                if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
+                              D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)) {
+                    cacheRequest.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+                    allocator->TryAllocateMemory(cacheRequest);
+                }
 
-                    if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
-                                  D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)) {
-                        allocator->TryAllocateMemory(
-                            sizeToCache, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT,
-                            /*neverAllocate*/ true, /*cacheSize*/ true, /*prefetchMemory*/ false);
+                if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
+                              D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)) {
+                    cacheRequest.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+                    allocator->TryAllocateMemory(cacheRequest);
+                }
+
+                if (IsAligned(MemorySize::kPowerOfTwoCacheSizes[i].SizeInBytes,
+                              D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)) {
+                    cacheRequest.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+                    MemoryAllocator* msaaAllocator = GetSubAllocatorOfType(
+                        resourceHeapTypeIndex, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+                    if (sizeToCache <= msaaAllocator->GetMemorySize()) {
+                        msaaAllocator->TryAllocateMemory(cacheRequest);
                     }
                 }
             }
-#endif
         }
+#endif
+
+        mIsInitializedOfType[resourceHeapTypeIndex].store(true, std::memory_order_release);
+    }
+
+    bool ResourceAllocator::IsInitializedOfType(size_t resourceHeapTypeIndex) const {
+        return mIsInitializedOfType[resourceHeapTypeIndex].load(std::memory_order_acquire);
     }
 
     ResourceAllocator::~ResourceAllocator() {
         GPGMM_TRACE_EVENT_OBJECT_DESTROY(this);
 
+        // Publishing collects counters from the allocators, so it must stop first.
+        mSharedStatsPublisher.reset();
+
+        // The group must stop trimming this allocator before it can be destroyed.
+        if (mGroup != nullptr) {
+            mGroup->RemoveAllocator(this);
+        }
+
+        // Warm-up uses the allocators, so it must finish before they can be destroyed.
+        if (mWarmUpEvent != nullptr) {
+            mWarmUpEvent->Wait();
+        }
+
+        // Same for resources still being created by CreateResourceAsync, whose tasks also use
+        // the thread pool to release memory in the background.
+        std::vector<std::shared_ptr<Event>> createResourceEvents;
+        {
+            std::lock_guard<std::mutex> lock(mCreateResourceEventsMutex);
+            createResourceEvents.swap(mCreateResourceEvents);
+        }
+        for (auto& event : createResourceEvents) {
+            event->Wait();
+        }
+
+        mThreadPool.reset();
+
+        // The GPU is assumed idle once the allocator is destroyed.
+        for (auto& pendingRelease : mPendingReleases) {
+            pendingRelease.second->Release();
+        }
+        mPendingReleases.clear();
+
         // Destroy allocators in the reverse order they were created so we can record delete events
         // before event tracer shutdown.
+        mTransientAllocatorOfType = {};
+        mLargeBufferAllocatorOfType = {};
         mBufferAllocatorOfType = {};
         mResourceAllocatorOfType = {};
+        mSmallTextureAllocatorOfType = {};
+        mMSAATextureAllocatorOfType = {};
+        mCPUAccessibleAllocatorOfType = {};
+        mColdAllocatorOfType = {};
+        mTilePageAllocatorOfType = {};
+        mAliasedAllocatorOfType = {};
         mResourceHeapAllocatorOfType = {};
+        mShardResourceHeapAllocatorsOfType = {};
+        mSharedResourceHeapAllocatorOfType = {};
 
 #if defined(GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG)
         mDebugAllocator->ReportLiveAllocations();
@@ -553,85 +1410,1322 @@ namespace gpgmm { namespace d3d12 {
 #endif
     }
 
+    uint64_t ResourceAllocator::GetResourceHeapUsage() const {
+        // Committed resources are counted by this allocator, instead of a resource heap
+        // allocator.
+        return mResourceHeapUsage.Load() + mInfo.UsedMemoryUsage.Load();
+    }
+
     const char* ResourceAllocator::GetTypename() const {
         return "GPUMemoryAllocator";
     }
 
     void ResourceAllocator::Trim() {
-        for (auto& allocator : mResourceHeapAllocatorOfType) {
-            ASSERT(allocator != nullptr);
-            allocator->ReleaseMemory();
-        }
+        // Released memory could make the layers which failed to create resources succeed again.
+        mTrimCount.fetch_add(1, std::memory_order_relaxed);
+
+        ForEachInitializedTypeInParallel(
+            [this](uint32_t resourceHeapTypeIndex) { TrimOfType(resourceHeapTypeIndex); });
     }
 
-    HRESULT ResourceAllocator::CreateResource(const ALLOCATION_DESC& allocationDescriptor,
-                                              const D3D12_RESOURCE_DESC& resourceDescriptor,
-                                              D3D12_RESOURCE_STATES initialResourceState,
-                                              const D3D12_CLEAR_VALUE* clearValue,
-                                              ResourceAllocation** resourceAllocationOut) {
-        if (!resourceAllocationOut) {
-            return E_POINTER;
-        }
+    void ResourceAllocator::TrimOfType(uint32_t resourceHeapTypeIndex) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.TrimOfType");
 
-        GPGMM_TRACE_EVENT_OBJECT_CALL(
-            "ResourceAllocator.CreateResource",
-            (CREATE_RESOURCE_DESC{allocationDescriptor, resourceDescriptor, initialResourceState,
-                                  clearValue}));
+        std::lock_guard<std::mutex> lock(mMutexOfType[resourceHeapTypeIndex]);
+        MemoryAllocator* allocator = mResourceHeapAllocatorOfType[resourceHeapTypeIndex].get();
+        ASSERT(allocator != nullptr);
+        allocator->ReleaseMemory();
 
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceAllocator.CreateResource");
+        mAliasedAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
 
-        std::lock_guard<std::mutex> lock(mMutex);
+        if (mSmallTextureAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mSmallTextureAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
 
-        mAllocationTimer->StartElapsedTime();
-        ReturnIfFailed(CreateResourceInternal(allocationDescriptor, resourceDescriptor,
-                                              initialResourceState, clearValue,
-                                              resourceAllocationOut));
-        const double allocationLatency = mAllocationTimer->EndElapsedTime() * 1e6;
-        GPGMM_UNUSED(allocationLatency);
+        if (mMSAATextureAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mMSAATextureAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
 
-        TRACE_COUNTER1(TraceEventCategory::Default, "GPU allocation latency (us)",
-                       allocationLatency);
+        if (mCPUAccessibleAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mCPUAccessibleAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
 
-        const QUERY_RESOURCE_ALLOCATOR_INFO& info = QueryInfo();
-        GPGMM_UNUSED(info);
+        if (mColdAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mColdAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
 
-        TRACE_COUNTER1(
-            TraceEventCategory::Default, "GPU memory unused (%)",
-            (1.0 - (info.UsedBlockUsage / static_cast<double>(info.UsedMemoryUsage))) * 100);
+        if (mTilePageAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mTilePageAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
 
-        TRACE_COUNTER1(TraceEventCategory::Default, "GPU memory unused (MBytes)",
-                       (info.UsedMemoryUsage - info.UsedBlockUsage) / 1e6);
+        if (mLargeBufferAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mLargeBufferAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
+
+        for (auto& shardResourceHeapAllocator :
+             mShardResourceHeapAllocatorsOfType[resourceHeapTypeIndex]) {
+            shardResourceHeapAllocator->ReleaseMemory();
+        }
+
+        // Transient buffer is only released once every transient allocation retired.
+        if (mTransientAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            mTransientAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory();
+        }
+    }
+
+    void ResourceAllocator::ForEachInitializedTypeInParallel(
+        const std::function<void(uint32_t resourceHeapTypeIndex)>& callback) {
+        std::vector<uint32_t> resourceHeapTypeIndices;
+        for (uint32_t resourceHeapTypeIndex = 0; resourceHeapTypeIndex < kNumOfResourceHeapTypes;
+             resourceHeapTypeIndex++) {
+            if (IsInitializedOfType(resourceHeapTypeIndex)) {
+                resourceHeapTypeIndices.push_back(resourceHeapTypeIndex);
+            }
+        }
+
+        if (resourceHeapTypeIndices.empty()) {
+            return;
+        }
+
+        // The calling thread runs the first heap type itself rather than only waiting on the
+        // others, which also runs every heap type on it once the thread pool is gone.
+        std::vector<std::shared_ptr<Event>> events;
+        if (mThreadPool != nullptr) {
+            for (size_t i = 1; i < resourceHeapTypeIndices.size(); i++) {
+                // The caller waits on every task, so they must not queue behind background
+                // releases.
+                events.push_back(ThreadPool::PostTask(
+                    mThreadPool,
+                    std::make_shared<ResourceHeapTypeTask>(callback, resourceHeapTypeIndices[i]),
+                    TaskClass::kRequested));
+            }
+        } else {
+            for (size_t i = 1; i < resourceHeapTypeIndices.size(); i++) {
+                callback(resourceHeapTypeIndices[i]);
+            }
+        }
+
+        callback(resourceHeapTypeIndices[0]);
+
+        // |callback| is referenced by the tasks, so every task must complete before returning.
+        for (std::shared_ptr<Event>& event : events) {
+            event->Wait();
+        }
+    }
+
+    void ResourceAllocator::RetireTransientMemory(uint64_t completedFenceValue) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.RetireTransientMemory");
+
+        for (size_t i = 0; i < kNumOfResourceHeapTypes; i++) {
+            if (IsInitializedOfType(i) && mTransientAllocatorOfType[i] != nullptr) {
+                mTransientAllocatorOfType[i]->RetireMemory(completedFenceValue);
+            }
+        }
+
+        // Completed releases are taken at once, then released without holding the lock, since
+        // releasing may deallocate memory from any allocator.
+        std::vector<ResourceAllocation*> completedReleases;
+        {
+            std::lock_guard<std::mutex> lock(mPendingReleasesMutex);
+            auto last = mPendingReleases.upper_bound(completedFenceValue);
+            completedReleases.reserve(std::distance(mPendingReleases.begin(), last));
+            for (auto it = mPendingReleases.begin(); it != last; ++it) {
+                completedReleases.push_back(it->second);
+            }
+            mPendingReleases.erase(mPendingReleases.begin(), last);
+        }
+
+        for (ResourceAllocation* resourceAllocation : completedReleases) {
+            resourceAllocation->Release();
+        }
+    }
+
+    HRESULT ResourceAllocator::BeginFrame(uint64_t completedFenceValue) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.BeginFrame");
+
+        std::lock_guard<std::mutex> lock(mFrameMutex);
+        if (mIsInFrame) {
+            return E_FAIL;
+        }
+
+        const double maintenanceStartTime = mAllocationTimer->GetAbsoluteTime();
+
+        if (mResidencyManager != nullptr) {
+            mResidencyManager->ResetFrameStats();
+        }
+
+        RetireTransientMemory(completedFenceValue);
+
+        // Keeps enough pooled memory for the next frame to create as many resource allocations
+        // as the previous one did.
+        uint64_t bytesTrimmed = 0;
+        if (mDescriptor.FrameTrimTimeInSeconds > 0) {
+            const uint64_t freeMemoryUsage = QueryInfo().FreeMemoryUsage;
+            if (freeMemoryUsage > mLastFrameAllocationUsage) {
+                bytesTrimmed = Trim(freeMemoryUsage - mLastFrameAllocationUsage,
+                                    mDescriptor.FrameTrimTimeInSeconds);
+            }
+        }
+
+        mIsInFrame = true;
+        mFrameIndex++;
+
+        mFrameStats = {};
+        mFrameStats.FrameIndex = mFrameIndex;
+        mFrameStats.TrimmedSizeInBytes = bytesTrimmed;
+        mFrameStats.MaintenanceTimeInSeconds =
+            mAllocationTimer->GetAbsoluteTime() - maintenanceStartTime;
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::EndFrame(FRAME_STATS* frameStatsOut) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.EndFrame");
+
+        std::lock_guard<std::mutex> lock(mFrameMutex);
+        if (!mIsInFrame) {
+            return E_FAIL;
+        }
+
+        mIsInFrame = false;
+
+        mFrameStats.AllocationCount =
+            mFrameCounters.AllocationCount.exchange(0, std::memory_order_relaxed);
+        mFrameStats.AllocationSizeInBytes =
+            mFrameCounters.AllocationUsage.exchange(0, std::memory_order_relaxed);
+        mFrameStats.ReleasedCount =
+            mFrameCounters.ReleasedCount.exchange(0, std::memory_order_relaxed);
+        mFrameStats.ReleasedSizeInBytes =
+            mFrameCounters.ReleasedUsage.exchange(0, std::memory_order_relaxed);
+
+        mLastFrameAllocationUsage = mFrameStats.AllocationSizeInBytes;
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU allocations per frame",
+                       mFrameStats.AllocationCount);
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU allocation size per frame (KBytes)",
+                       mFrameStats.AllocationSizeInBytes / 1024);
+
+        if (frameStatsOut != nullptr) {
+            *frameStatsOut = mFrameStats;
+        }
+
+        return S_OK;
+    }
+
+    void ResourceAllocator::ReleaseAfter(ResourceAllocation* resourceAllocation,
+                                         uint64_t fenceValue) {
+        if (resourceAllocation == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mPendingReleasesMutex);
+        mPendingReleases.emplace(fenceValue, resourceAllocation);
+    }
+
+    void ResourceAllocator::WarmUp(const std::vector<ALLOCATOR_WARM_UP_DESC>& profile) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.WarmUp");
+
+        for (const ALLOCATOR_WARM_UP_DESC& warmUpDesc : profile) {
+            const RESOURCE_HEAP_TYPE resourceHeapType =
+                GetResourceHeapType(warmUpDesc.Dimension, warmUpDesc.HeapType,
+                                    warmUpDesc.ResourceFlags, mResourceHeapTier);
+            if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID ||
+                !IsHeapTypeSupported(warmUpDesc.HeapType)) {
+                gpgmm::WarningLog() << "Warm-up skipped resources of an unsupported heap type.\n";
+                continue;
+            }
+
+            InitializeAllocatorsOfType(static_cast<size_t>(resourceHeapType));
+
+            std::mutex& heapTypeMutex = mMutexOfType[static_cast<size_t>(resourceHeapType)];
+            MemoryAllocator* allocator =
+                GetSubAllocatorOfType(static_cast<size_t>(resourceHeapType), warmUpDesc.Alignment);
+            ASSERT(allocator != nullptr);
+
+            if (warmUpDesc.SizeInBytes == 0 ||
+                warmUpDesc.SizeInBytes > allocator->GetMemorySize()) {
+                continue;
+            }
+
+            // Every allocation must exist at once so each gets its own memory. The lock is only
+            // held per allocation so warm-up does not block resource creation for long.
+            MEMORY_ALLOCATION_REQUEST request = {};
+            request.Size = warmUpDesc.SizeInBytes;
+            request.Alignment = warmUpDesc.Alignment;
+            request.CacheSize = true;
+
+            std::vector<std::unique_ptr<MemoryAllocation>> allocations;
+            for (uint64_t i = 0; i < warmUpDesc.Count; i++) {
+                std::lock_guard<std::mutex> lock(heapTypeMutex);
+                std::unique_ptr<MemoryAllocation> allocation =
+                    allocator->TryAllocateMemory(request);
+                if (allocation == nullptr) {
+                    gpgmm::WarningLog()
+                        << "Warm-up stopped early, resource memory could not be allocated.\n";
+                    break;
+                }
+                allocations.push_back(std::move(allocation));
+            }
+
+            for (auto& allocation : allocations) {
+                std::lock_guard<std::mutex> lock(heapTypeMutex);
+                allocator->DeallocateMemory(std::move(allocation));
+            }
+        }
+    }
+
+    uint64_t ResourceAllocator::Trim(uint64_t bytesToRelease, double maxSeconds) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.Trim");
+
+        mTrimCount.fetch_add(1, std::memory_order_relaxed);
+
+        const double trimStartTime = mAllocationTimer->GetAbsoluteTime();
+
+        // Each round releases a single heap of every heap type in parallel, so the budget is
+        // checked between rounds.
+        uint64_t bytesReleased = 0;
+        while (bytesReleased < bytesToRelease &&
+               mAllocationTimer->GetAbsoluteTime() - trimStartTime < maxSeconds) {
+            std::array<uint64_t, kNumOfResourceHeapTypes> bytesReleasedOfType = {};
+            ForEachInitializedTypeInParallel(
+                [this, &bytesReleasedOfType](uint32_t resourceHeapTypeIndex) {
+                    bytesReleasedOfType[resourceHeapTypeIndex] =
+                        TrimLeastRecentlyUsedOfType(resourceHeapTypeIndex);
+                });
+
+            uint64_t bytesReleasedInRound = 0;
+            for (uint64_t bytes : bytesReleasedOfType) {
+                bytesReleasedInRound += bytes;
+            }
+
+            if (bytesReleasedInRound == 0) {
+                break;
+            }
+
+            bytesReleased += bytesReleasedInRound;
+        }
+
+        return bytesReleased;
+    }
+
+    uint64_t ResourceAllocator::TrimLeastRecentlyUsedOfType(uint32_t resourceHeapTypeIndex) {
+        std::lock_guard<std::mutex> lock(mMutexOfType[resourceHeapTypeIndex]);
+        MemoryAllocator* allocator = mResourceHeapAllocatorOfType[resourceHeapTypeIndex].get();
+        ASSERT(allocator != nullptr);
+
+        // Release the least recently used heap of this type.
+        const uint64_t bytesReleased = allocator->ReleaseMemory(1);
+        if (bytesReleased > 0) {
+            return bytesReleased;
+        }
+
+        return mAliasedAllocatorOfType[resourceHeapTypeIndex]->ReleaseMemory(1);
+    }
+
+    HRESULT ResourceAllocator::CreateResource(const ALLOCATION_DESC& allocationDescriptor,
+                                              const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                              D3D12_RESOURCE_STATES initialResourceState,
+                                              const D3D12_CLEAR_VALUE* clearValue,
+                                              ResourceAllocation** resourceAllocationOut) {
+        if (!resourceAllocationOut) {
+            return E_POINTER;
+        }
+
+        // Unsampled calls skip recording the call and the resource allocation it creates, which
+        // remembers to also skip recording its snapshot and release.
+        const ScopedTraceEventCallSampling callSampling(IsCallSampled());
+        if (IsTraceEventCallSampled()) {
+            GPGMM_TRACE_EVENT_OBJECT_CALL_DEFERRED(
+                "ResourceAllocator.CreateResource",
+                CREATE_RESOURCE_TRACE_ARGS::Defer(allocationDescriptor, resourceDescriptor,
+                                                  initialResourceState, clearValue));
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateResource");
+
+        // No allocator-wide lock is taken here. Instead, each resource heap type is locked
+        // independently by CreateResourceInternal so resources of different heap types can be
+        // created in parallel.
+
+        // Elapsed time is computed from absolute ticks since the same timer could be used by
+        // multiple threads at once.
+        const uint64_t allocationStartTicks = mAllocationTimer->GetTicks();
+
+        // If d3d tells us the resource size is invalid, treat the error as OOM.
+        // Otherwise, creating a very large resource could overflow the allocator.
+        D3D12_RESOURCE_DESC newResourceDesc = resourceDescriptor;
+        const D3D12_RESOURCE_ALLOCATION_INFO resourceInfo = GetResourceAllocationInfo(
+            mDevice.Get(), mResourceAllocationInfoCache.get(), mAllocationTimer.get(),
+            &mGetResourceAllocationInfoLatency, newResourceDesc);
+
+        ComPtr<ID3D12Device1> device1;
+        ReturnIfFailed(ValidateCreateResource(allocationDescriptor, &device1));
+
+        // Must be called before any resource heap type is locked, since the group could trim
+        // this allocator.
+        if (mGroup != nullptr) {
+            mGroup->ReserveBudget(this, resourceInfo.SizeInBytes);
+        }
+
+        ReturnIfFailed(CreateResourceInternal(allocationDescriptor, newResourceDesc, resourceInfo,
+                                              initialResourceState, clearValue,
+                                              resourceAllocationOut));
+
+        ReturnIfFailed(CompleteCreatedResource(device1.Get(), allocationDescriptor,
+                                               allocationStartTicks, resourceAllocationOut));
+
+        ReportCreatedResources(1, resourceAllocationOut, GPGMM_RETURN_ADDRESS());
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CreateResources(uint32_t count,
+                                               const ALLOCATION_DESC* allocationDescriptors,
+                                               const D3D12_RESOURCE_DESC* resourceDescriptors,
+                                               const D3D12_RESOURCE_STATES* initialResourceStates,
+                                               const D3D12_CLEAR_VALUE* const* clearValues,
+                                               ResourceAllocation** resourceAllocationsOut,
+                                               HRESULT* resultsOut) {
+        if (!resourceAllocationsOut) {
+            return E_POINTER;
+        }
+
+        if (count > 0 && (allocationDescriptors == nullptr || resourceDescriptors == nullptr ||
+                          initialResourceStates == nullptr)) {
+            return E_INVALIDARG;
+        }
+
+        // Every request is validated before any resource is created, like CreateResource.
+        std::vector<ComPtr<ID3D12Device1>> residencyPriorityDevices(count);
+        for (uint32_t i = 0; i < count; i++) {
+            ReturnIfFailed(
+                ValidateCreateResource(allocationDescriptors[i], &residencyPriorityDevices[i]));
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateResources");
+
+        // Resource sizes are determined up front, once per request. The batched version of
+        // ID3D12Device::GetResourceAllocationInfo cannot be used here because it returns the
+        // combined size of all the resources instead of the size of each resource.
+        std::vector<D3D12_RESOURCE_DESC> newResourceDescs(count);
+        std::vector<D3D12_RESOURCE_ALLOCATION_INFO> resourceInfos(count);
+        std::vector<RESOURCE_HEAP_TYPE> resourceHeapTypes(count);
+        std::vector<uint32_t> requestOrder(count);
+        std::vector<bool> isSampled(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const D3D12_CLEAR_VALUE* clearValue =
+                (clearValues != nullptr) ? clearValues[i] : nullptr;
+
+            isSampled[i] = IsCallSampled();
+            if (isSampled[i]) {
+                GPGMM_TRACE_EVENT_OBJECT_CALL_DEFERRED(
+                    "ResourceAllocator.CreateResource",
+                    CREATE_RESOURCE_TRACE_ARGS::Defer(allocationDescriptors[i],
+                                                      resourceDescriptors[i],
+                                                      initialResourceStates[i], clearValue));
+            }
+
+            newResourceDescs[i] = resourceDescriptors[i];
+            resourceInfos[i] = GetResourceAllocationInfo(
+                mDevice.Get(), mResourceAllocationInfoCache.get(), mAllocationTimer.get(),
+                &mGetResourceAllocationInfoLatency, newResourceDescs[i]);
+            resourceHeapTypes[i] = GetResourceHeapType(
+                newResourceDescs[i].Dimension, allocationDescriptors[i].HeapType,
+                newResourceDescs[i].Flags, mResourceHeapTier);
+            requestOrder[i] = i;
+            resourceAllocationsOut[i] = nullptr;
+        }
+
+        // The whole batch is reserved at once, before any resource heap type is locked, since
+        // the group could trim this allocator. Invalid sizes fail once created, so they reserve
+        // nothing.
+        if (mGroup != nullptr) {
+            uint64_t batchSize = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                if (resourceInfos[i].SizeInBytes != kInvalidSize) {
+                    batchSize += std::min(resourceInfos[i].SizeInBytes, kInvalidSize - batchSize);
+                }
+            }
+            mGroup->ReserveBudget(this, batchSize);
+        }
+
+        // Requests of the same resource heap type are allocated back-to-back, from largest to
+        // smallest size, so smaller resources can fill the remaining space of the larger ones.
+        std::stable_sort(requestOrder.begin(), requestOrder.end(), [&](uint32_t a, uint32_t b) {
+            if (resourceHeapTypes[a] != resourceHeapTypes[b]) {
+                return resourceHeapTypes[a] < resourceHeapTypes[b];
+            }
+            return resourceInfos[a].SizeInBytes > resourceInfos[b].SizeInBytes;
+        });
+
+        std::vector<HRESULT> results(count, S_OK);
+        for (uint32_t i : requestOrder) {
+            const D3D12_CLEAR_VALUE* clearValue =
+                (clearValues != nullptr) ? clearValues[i] : nullptr;
+            const ScopedTraceEventCallSampling callSampling(isSampled[i]);
+
+            // Each resource is timed by itself so its latency is comparable to one created by
+            // CreateResource.
+            const uint64_t allocationStartTicks = mAllocationTimer->GetTicks();
+            results[i] = CreateResourceInternal(allocationDescriptors[i], newResourceDescs[i],
+                                                resourceInfos[i], initialResourceStates[i],
+                                                clearValue, &resourceAllocationsOut[i]);
+            if (SUCCEEDED(results[i])) {
+                results[i] = CompleteCreatedResource(residencyPriorityDevices[i].Get(),
+                                                     allocationDescriptors[i],
+                                                     allocationStartTicks,
+                                                     &resourceAllocationsOut[i]);
+            }
+            if (FAILED(results[i])) {
+                resourceAllocationsOut[i] = nullptr;
+            }
+        }
+
+        ReportCreatedResources(count, resourceAllocationsOut, GPGMM_RETURN_ADDRESS());
+
+        // The first failure is by the order requested, not the order allocated.
+        HRESULT firstFailure = S_OK;
+        for (uint32_t i = 0; i < count; i++) {
+            if (resultsOut != nullptr) {
+                resultsOut[i] = results[i];
+            }
+            if (FAILED(results[i]) && SUCCEEDED(firstFailure)) {
+                firstFailure = results[i];
+            }
+        }
+
+        return firstFailure;
+    }
+
+    HRESULT ResourceAllocator::CreateAliasedResources(
+        uint32_t count,
+        const ALLOCATION_DESC& allocationDescriptor,
+        const D3D12_RESOURCE_DESC* resourceDescriptors,
+        const D3D12_RESOURCE_STATES* initialResourceStates,
+        const D3D12_CLEAR_VALUE* const* clearValues,
+        const RESOURCE_LIFETIME_DESC* lifetimes,
+        ResourceAllocation** resourceAllocationsOut) {
+        if (!resourceAllocationsOut) {
+            return E_POINTER;
+        }
+
+        if (count > 0 && (resourceDescriptors == nullptr || initialResourceStates == nullptr ||
+                          lifetimes == nullptr)) {
+            return E_INVALIDARG;
+        }
+
+        if (allocationDescriptor.Tag >= kMaxAllocationTagCount) {
+            return E_INVALIDARG;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateAliasedResources");
+
+        const auto releaseResourceAllocationsFn = [&]() {
+            for (uint32_t i = 0; i < count; i++) {
+                if (resourceAllocationsOut[i] != nullptr) {
+                    resourceAllocationsOut[i]->Release();
+                    resourceAllocationsOut[i] = nullptr;
+                }
+            }
+        };
+
+        // Aliasing requires placed resources, so every resource is committed separately instead.
+        if (mIsAlwaysCommitted) {
+            const std::vector<ALLOCATION_DESC> allocationDescriptors(count, allocationDescriptor);
+            const HRESULT hr =
+                CreateResources(count, allocationDescriptors.data(), resourceDescriptors,
+                                initialResourceStates, clearValues, resourceAllocationsOut);
+            if (FAILED(hr)) {
+                releaseResourceAllocationsFn();
+            }
+            return hr;
+        }
+
+        // Resources are grouped by resource heap type since each group needs a separate heap.
+        std::vector<D3D12_RESOURCE_DESC> newResourceDescs(resourceDescriptors,
+                                                          resourceDescriptors + count);
+        std::vector<D3D12_RESOURCE_ALLOCATION_INFO> resourceInfos(count);
+        std::array<std::vector<uint32_t>, kNumOfResourceHeapTypes> requestsOfType;
+        for (uint32_t i = 0; i < count; i++) {
+            resourceAllocationsOut[i] = nullptr;
+
+            resourceInfos[i] = GetResourceAllocationInfo(
+                mDevice.Get(), mResourceAllocationInfoCache.get(), mAllocationTimer.get(),
+                &mGetResourceAllocationInfoLatency, newResourceDescs[i]);
+            if (resourceInfos[i].SizeInBytes == kInvalidSize ||
+                resourceInfos[i].SizeInBytes > mMaxResourceHeapSize ||
+                resourceInfos[i].SizeInBytes > mCaps->GetMaxResourceSize()) {
+                return E_OUTOFMEMORY;
+            }
+
+            const RESOURCE_HEAP_TYPE resourceHeapType =
+                GetResourceHeapType(newResourceDescs[i].Dimension, allocationDescriptor.HeapType,
+                                    newResourceDescs[i].Flags, mResourceHeapTier);
+            if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID ||
+                !IsHeapTypeSupported(allocationDescriptor.HeapType)) {
+                return E_INVALIDARG;
+            }
+
+            if (lifetimes[i].FirstPass > lifetimes[i].LastPass) {
+                return E_INVALIDARG;
+            }
+
+            requestsOfType[static_cast<size_t>(resourceHeapType)].push_back(i);
+        }
+
+        const bool neverAllocate =
+            allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+        HRESULT hr = S_OK;
+        for (uint32_t resourceHeapTypeIndex = 0; resourceHeapTypeIndex < kNumOfResourceHeapTypes;
+             resourceHeapTypeIndex++) {
+            const std::vector<uint32_t>& requestIndices = requestsOfType[resourceHeapTypeIndex];
+            if (requestIndices.empty()) {
+                continue;
+            }
+
+            std::vector<ALIASED_ALLOCATION_REQUEST> requests;
+            requests.reserve(requestIndices.size());
+            for (uint32_t i : requestIndices) {
+                requests.push_back({resourceInfos[i].SizeInBytes, resourceInfos[i].Alignment,
+                                    lifetimes[i].FirstPass, lifetimes[i].LastPass});
+            }
+
+            InitializeAllocatorsOfType(resourceHeapTypeIndex);
+
+            // Aliased allocator locks internally, so the heap type lock is not needed.
+            AliasedMemoryAllocator* allocator =
+                mAliasedAllocatorOfType[resourceHeapTypeIndex].get();
+            std::vector<std::unique_ptr<MemoryAllocation>> allocations =
+                allocator->TryAllocateAliasedMemory(requests, neverAllocate);
+            if (allocations.empty()) {
+                DebugEvent("ResourceAllocator.CreateAliasedResources",
+                           ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_FAILED)
+                    << "Aliased resource memory could not be allocated.";
+                hr = E_OUTOFMEMORY;
+                break;
+            }
+
+            // Each placed resource aliases the memory of any other resource whose lifetime does
+            // not overlap with it.
+            for (size_t j = 0; j < requestIndices.size() && SUCCEEDED(hr); j++) {
+                const uint32_t i = requestIndices[j];
+                const D3D12_CLEAR_VALUE* clearValue =
+                    (clearValues != nullptr) ? clearValues[i] : nullptr;
+
+                const MemoryAllocation& subAllocation = *allocations[j];
+                Heap* resourceHeap = ToBackend(subAllocation.GetMemory());
+                ComPtr<ID3D12Resource> placedResource;
+                hr = CreatePlacedResource(resourceHeap, subAllocation.GetOffset(),
+                                          &newResourceDescs[i], clearValue,
+                                          initialResourceStates[i], &placedResource);
+                if (FAILED(hr)) {
+                    break;
+                }
+
+                resourceAllocationsOut[i] = new (&mResourceAllocationPool) ResourceAllocation{
+                    mResidencyManager.Get(), subAllocation.GetAllocator(),
+                    subAllocation.GetOffset(), subAllocation.GetBlock(), subAllocation.GetMethod(),
+                    std::move(placedResource), resourceHeap};
+                allocations[j] = nullptr;
+            }
+
+            // Deallocate the memory of resources which were never created.
+            for (auto& allocation : allocations) {
+                if (allocation != nullptr) {
+                    allocator->DeallocateMemory(std::move(allocation));
+                }
+            }
+
+            if (FAILED(hr)) {
+                break;
+            }
+        }
+
+        if (FAILED(hr)) {
+            releaseResourceAllocationsFn();
+            return hr;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            TrackTaggedAllocation(resourceAllocationsOut[i], allocationDescriptor.Tag);
+        }
+
+        ReportAllocatorCounters();
+
+        for (uint32_t i = 0; i < count; i++) {
+            TrackLiveAllocation(resourceAllocationsOut[i], GPGMM_RETURN_ADDRESS());
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::AllocateMemory(const ALLOCATION_DESC& allocationDescriptor,
+                                              const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
+                                              ResourceAllocation** resourceAllocationOut) {
+        if (!resourceAllocationOut) {
+            return E_POINTER;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.AllocateMemory");
+
+        if (allocationDescriptor.Flags & ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE ||
+            allocationDescriptor.Flags & ALLOCATION_FLAG_TRANSIENT ||
+            allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_MAPPED ||
+            allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE) {
+            return E_INVALIDARG;
+        }
+
+        if (allocationDescriptor.Tag >= kMaxAllocationTagCount ||
+            allocationDescriptor.Lifetime > ALLOCATION_LIFETIME_PERSISTENT) {
+            return E_INVALIDARG;
+        }
+
+        if (resourceInfo.SizeInBytes == 0) {
+            return E_INVALIDARG;
+        }
+
+        if (resourceInfo.SizeInBytes == kInvalidSize ||
+            resourceInfo.SizeInBytes > mMaxResourceHeapSize ||
+            resourceInfo.SizeInBytes > mCaps->GetMaxResourceSize()) {
+            return E_OUTOFMEMORY;
+        }
+
+        // Without a resource, the resource heap type only depends on the heap type, which is
+        // only the case on resource heap tier 2.
+        const RESOURCE_HEAP_TYPE resourceHeapType =
+            GetResourceHeapType(D3D12_RESOURCE_DIMENSION_UNKNOWN, allocationDescriptor.HeapType,
+                                D3D12_RESOURCE_FLAG_NONE, mResourceHeapTier);
+        if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID ||
+            !IsHeapTypeSupported(allocationDescriptor.HeapType)) {
+            return E_INVALIDARG;
+        }
+
+        ComPtr<ID3D12Device1> device1;
+        ReturnIfFailed(GetResidencyPriorityDevice(allocationDescriptor, &device1));
+
+        if (mGroup != nullptr) {
+            mGroup->ReserveBudget(this, resourceInfo.SizeInBytes);
+        }
+
+        ReleasePooledMemoryOverHeapTypeBudget(allocationDescriptor.HeapType,
+                                              resourceInfo.SizeInBytes);
+
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = resourceInfo.SizeInBytes;
+        request.Alignment = resourceInfo.Alignment;
+        request.NeverAllocate = allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        request.Lifetime = static_cast<MemoryAllocationLifetime>(allocationDescriptor.Lifetime);
+        request.UpperAddress = allocationDescriptor.Flags & ALLOCATION_FLAG_UPPER_ADDRESS;
+
+        const auto createMemoryFn = [&](const auto& allocation) -> HRESULT {
+            *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                mResidencyManager.Get(), allocation.GetAllocator(), allocation.GetOffset(),
+                allocation.GetBlock(), allocation.GetMethod(), /*placedResource*/ nullptr,
+                ToBackend(allocation.GetMemory())};
+            return S_OK;
+        };
+
+        const auto allocateMemoryFn = [&]() -> HRESULT {
+            if (allocationDescriptor.CustomPool != nullptr) {
+                Pool* pool = allocationDescriptor.CustomPool;
+                if (pool->mResourceAllocator.Get() != this ||
+                    allocationDescriptor.HeapType != pool->mDesc.HeapType) {
+                    return E_INVALIDARG;
+                }
+
+                ReturnIfSucceeded(TryAllocateResource(&pool->mMutex, &mLockWaitLatency,
+                                                      mAllocationTimer.get(),
+                                                      pool->mAllocator.get(), request,
+                                                      createMemoryFn));
+                return E_OUTOFMEMORY;
+            }
+
+            InitializeAllocatorsOfType(static_cast<size_t>(resourceHeapType));
+
+            std::mutex& heapTypeMutex = mMutexOfType[static_cast<size_t>(resourceHeapType)];
+
+            // Same as placing a resource in a sub-allocated resource heap.
+            const bool neverSubAllocate =
+                (allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY) ||
+                resourceInfo.SizeInBytes > mMaxResourceSizeForSubAllocation;
+            if (!mIsAlwaysCommitted && !neverSubAllocate) {
+                MEMORY_ALLOCATION_REQUEST subAllocationRequest = request;
+                subAllocationRequest.PrefetchMemory =
+                    allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_PREFETCH_MEMORY;
+                subAllocationRequest.MemorySizeLimit =
+                    GetMaxResourceHeapSizeForBudget(allocationDescriptor.HeapType);
+
+                // Shards lock internally, so threads only contend on their own shard.
+                ReturnIfSucceeded(TryAllocateResource(
+                    (mDescriptor.SubAllocatorShardCount > 1) ? nullptr : &heapTypeMutex,
+                    &mLockWaitLatency, mAllocationTimer.get(),
+                    mResourceAllocatorOfType[static_cast<size_t>(resourceHeapType)].get(),
+                    subAllocationRequest, createMemoryFn));
+            }
+
+            // Otherwise, the memory is in its own resource heap, which also stands in for a
+            // committed resource.
+            MEMORY_ALLOCATION_REQUEST resourceHeapRequest = request;
+            resourceHeapRequest.Alignment = GetHeapAlignment(GetHeapFlags(resourceHeapType));
+
+            ReturnIfSucceeded(TryAllocateResource(
+                &heapTypeMutex, &mLockWaitLatency, mAllocationTimer.get(),
+                mResourceHeapAllocatorOfType[static_cast<size_t>(resourceHeapType)].get(),
+                resourceHeapRequest, createMemoryFn));
+
+            return E_OUTOFMEMORY;
+        };
+
+        ReturnIfFailed(allocateMemoryFn());
+
+        ReturnIfFailed(
+            SetResidencyPriority(device1.Get(), allocationDescriptor, resourceAllocationOut));
+
+        TrackTaggedAllocation(*resourceAllocationOut, allocationDescriptor.Tag);
+
+        ReportCreatedResources(1, resourceAllocationOut, GPGMM_RETURN_ADDRESS());
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CreateDefragmentationPlan(
+        const DEFRAGMENTATION_DESC& descriptor,
+        uint32_t count,
+        ResourceAllocation* const* allocations,
+        std::vector<DEFRAGMENTATION_MOVE>* movesOut) {
+        if (!movesOut) {
+            return E_POINTER;
+        }
+
+        if (count > 0 && allocations == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateDefragmentationPlan");
+
+        std::vector<DEFRAGMENTATION_MOVE> moves;
+        uint64_t bytesToMove = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            ResourceAllocation* srcAllocation = allocations[i];
+            if (srcAllocation == nullptr ||
+                srcAllocation->GetMethod() != AllocationMethod::kSubAllocated) {
+                continue;
+            }
+
+            // Memory allocated without a resource has nothing to copy.
+            ID3D12Resource* srcResource = srcAllocation->GetResource();
+            if (srcResource == nullptr) {
+                continue;
+            }
+
+            D3D12_RESOURCE_DESC newResourceDesc = srcResource->GetDesc();
+
+            D3D12_HEAP_PROPERTIES heapProperties;
+            ReturnIfFailed(srcResource->GetHeapProperties(&heapProperties, nullptr));
+
+            // Upload resources cannot be a copy destination.
+            if (heapProperties.Type != D3D12_HEAP_TYPE_DEFAULT &&
+                heapProperties.Type != D3D12_HEAP_TYPE_READBACK) {
+                continue;
+            }
+
+            const RESOURCE_HEAP_TYPE resourceHeapType =
+                GetResourceHeapType(newResourceDesc.Dimension, heapProperties.Type,
+                                    newResourceDesc.Flags, mResourceHeapTier);
+            if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID) {
+                continue;
+            }
+
+            // Only resource heaps sub-allocated by slabs are relocated. Every other resource
+            // heap contains a single resource or buffers sub-allocated within it. Allocations are
+            // relocated within the resource heaps of their own lifetime.
+            InitializeAllocatorsOfType(static_cast<size_t>(resourceHeapType));
+            const LifetimeMemoryAllocator* lifetimeAllocator =
+                mResourceAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+            // Sharded allocations are relocated within the shard which allocated them.
+            MemoryAllocator* allocator = nullptr;
+            for (uint32_t lifetime = 0; lifetime < kNumOfMemoryAllocationLifetimes; lifetime++) {
+                MemoryAllocator* lifetimeChild = lifetimeAllocator->GetAllocator(
+                    static_cast<MemoryAllocationLifetime>(lifetime));
+                if (srcAllocation->GetAllocator() == lifetimeChild ||
+                    (mDescriptor.SubAllocatorShardCount > 1 &&
+                     static_cast<const ShardedMemoryAllocator*>(lifetimeChild)
+                         ->IsShard(srcAllocation->GetAllocator()))) {
+                    allocator = srcAllocation->GetAllocator();
+                    break;
+                }
+            }
+            if (allocator == nullptr) {
+                continue;
+            }
+
+            if (bytesToMove + srcAllocation->GetSize() > descriptor.MaxBytesToMove) {
+                break;
+            }
+
+            const D3D12_RESOURCE_ALLOCATION_INFO resourceInfo = GetResourceAllocationInfo(
+                mDevice.Get(), mResourceAllocationInfoCache.get(), mAllocationTimer.get(),
+                &mGetResourceAllocationInfoLatency, newResourceDesc);
+
+            std::mutex& heapTypeMutex = mMutexOfType[static_cast<size_t>(resourceHeapType)];
+
+            // Cold resources are moved regardless of how dense their heaps are.
+            MemoryAllocator* dstAllocator = allocator;
+            if (descriptor.MoveToColdHeaps) {
+                dstAllocator =
+                    mColdAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+                if (dstAllocator == nullptr) {
+                    continue;
+                }
+            }
+
+            std::unique_ptr<MemoryAllocation> dstSubAllocation;
+            {
+                std::lock_guard<std::mutex> lock(heapTypeMutex);
+                if (descriptor.MoveToColdHeaps) {
+                    MEMORY_ALLOCATION_REQUEST request = {};
+                    request.Size = resourceInfo.SizeInBytes;
+                    request.Alignment = resourceInfo.Alignment;
+                    dstSubAllocation = dstAllocator->TryAllocateMemory(request);
+                } else {
+                    dstSubAllocation = dstAllocator->TryRelocateMemory(
+                        *srcAllocation, resourceInfo.Alignment, descriptor.MaxUsedPercent);
+                }
+            }
+
+            if (dstSubAllocation == nullptr) {
+                continue;
+            }
+
+            Heap* resourceHeap = ToBackend(dstSubAllocation->GetMemory());
+            ComPtr<ID3D12Resource> placedResource;
+            const HRESULT hr = CreatePlacedResource(
+                resourceHeap, dstSubAllocation->GetOffset(), &newResourceDesc,
+                /*clearValue*/ nullptr, D3D12_RESOURCE_STATE_COPY_DEST, &placedResource);
+            if (FAILED(hr)) {
+                {
+                    std::lock_guard<std::mutex> lock(heapTypeMutex);
+                    dstAllocator->DeallocateMemory(std::move(dstSubAllocation));
+                }
+
+                // Either the whole plan is created or none of it is.
+                for (const DEFRAGMENTATION_MOVE& move : moves) {
+                    move.DstAllocation->Release();
+                }
+                return hr;
+            }
+
+            ResourceAllocation* dstAllocation = new (&mResourceAllocationPool) ResourceAllocation{
+                mResidencyManager.Get(), dstSubAllocation->GetAllocator(),
+                dstSubAllocation->GetOffset(), dstSubAllocation->GetBlock(),
+                dstSubAllocation->GetMethod(), std::move(placedResource), resourceHeap};
+
+            moves.push_back({srcAllocation, dstAllocation});
+            bytesToMove += srcAllocation->GetSize();
+        }
+
+        // Moved resources remain counted by the same tag.
+        for (const DEFRAGMENTATION_MOVE& move : moves) {
+            if (move.SrcAllocation->mTaggedBy == this) {
+                TrackTaggedAllocation(move.DstAllocation, move.SrcAllocation->mTag);
+            }
+        }
+
+        ReportAllocatorCounters();
+
+        for (const DEFRAGMENTATION_MOVE& move : moves) {
+            TrackLiveAllocation(move.DstAllocation, GPGMM_RETURN_ADDRESS());
+        }
+
+        *movesOut = std::move(moves);
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CreateReservedResource(const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                                      D3D12_RESOURCE_STATES initialResourceState,
+                                                      const D3D12_CLEAR_VALUE* clearValue,
+                                                      ResourceAllocation** resourceAllocationOut) {
+        if (!resourceAllocationOut) {
+            return E_POINTER;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateReservedResource");
+
+        const RESOURCE_HEAP_TYPE resourceHeapType =
+            GetResourceHeapType(resourceDescriptor.Dimension, D3D12_HEAP_TYPE_DEFAULT,
+                                resourceDescriptor.Flags, mResourceHeapTier);
+        if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID) {
+            return E_INVALIDARG;
+        }
+
+        // Tiles are mapped using the tile page allocator of the type.
+        InitializeAllocatorsOfType(static_cast<size_t>(resourceHeapType));
+
+        ComPtr<ID3D12Resource> reservedResource;
+        ReturnIfFailed(mDevice->CreateReservedResource(&resourceDescriptor, initialResourceState,
+                                                       clearValue,
+                                                       IID_PPV_ARGS(&reservedResource)));
+
+        // A reserved resource has no memory of its own, so the heap object only exists to wrap
+        // the resource. Memory of the tiles is counted by the tile page allocator instead.
+        Heap* resourceHeap = new Heap(
+            reservedResource,
+            GetPreferredMemorySegmentGroup(mDevice.Get(), mIsUMA, D3D12_HEAP_TYPE_DEFAULT),
+            /*size*/ 0);
+
+        std::unique_ptr<ReservedResourceTiles> tiles = std::make_unique<ReservedResourceTiles>();
+        tiles->ResourceHeapTypeIndex = static_cast<size_t>(resourceHeapType);
+        tiles->Resource = reservedResource.Get();
+
+        ResourceAllocation* resourceAllocation =
+            new (&mResourceAllocationPool) ResourceAllocation{
+                /*residencyManager*/ nullptr, /*allocator*/ this, /*offsetFromHeap*/ kInvalidOffset,
+                /*block*/ nullptr, AllocationMethod::kStandalone, std::move(reservedResource),
+                resourceHeap};
+
+        {
+            std::lock_guard<std::mutex> lock(mReservedResourcesMutex);
+            mReservedResources.emplace(resourceAllocation, std::move(tiles));
+            mReservedResourceCount.fetch_add(1, std::memory_order_release);
+        }
+
+        mInfo.UsedMemoryCount++;
+
+        TrackTaggedAllocation(resourceAllocation, /*tag*/ 0);
+        TrackLiveAllocation(resourceAllocation, GPGMM_RETURN_ADDRESS());
+
+        *resourceAllocationOut = resourceAllocation;
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::MapTiles(ResourceAllocation* reservedResourceAllocation,
+                                        uint32_t count,
+                                        const D3D12_TILED_RESOURCE_COORDINATE* coordinates) {
+        if (count > 0 && coordinates == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.MapTiles");
+
+        std::lock_guard<std::mutex> lock(mReservedResourcesMutex);
+        auto it = mReservedResources.find(reservedResourceAllocation);
+        if (it == mReservedResources.end()) {
+            return E_INVALIDARG;
+        }
+
+        ReservedResourceTiles* tiles = it->second.get();
+        MemoryAllocator* allocator = mTilePageAllocatorOfType[tiles->ResourceHeapTypeIndex].get();
+        ASSERT(allocator != nullptr);
+
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+        request.Alignment = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
+        for (uint32_t i = 0; i < count; i++) {
+            const D3D12_TILED_RESOURCE_COORDINATE& coordinate = coordinates[i];
+            std::unique_ptr<MemoryAllocation>& tilePage =
+                tiles->MappedTiles[{coordinate.Subresource, coordinate.X, coordinate.Y,
+                                    coordinate.Z}];
+            if (tilePage != nullptr) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> heapTypeLock(
+                    mMutexOfType[tiles->ResourceHeapTypeIndex]);
+                tilePage = allocator->TryAllocateMemory(request);
+            }
+
+            if (tilePage == nullptr) {
+                tiles->MappedTiles.erase(
+                    {coordinate.Subresource, coordinate.X, coordinate.Y, coordinate.Z});
+                return E_OUTOFMEMORY;
+            }
+
+            // Tiles are used without a residency set, so the heap must stay resident while mapped.
+            Heap* resourceHeap = ToBackend(tilePage->GetMemory());
+            if (mResidencyManager != nullptr) {
+                const HRESULT hr = mResidencyManager->LockHeap(resourceHeap);
+                if (FAILED(hr)) {
+                    {
+                        std::lock_guard<std::mutex> heapTypeLock(
+                            mMutexOfType[tiles->ResourceHeapTypeIndex]);
+                        allocator->DeallocateMemory(std::move(tilePage));
+                    }
+                    tiles->MappedTiles.erase(
+                        {coordinate.Subresource, coordinate.X, coordinate.Y, coordinate.Z});
+                    return hr;
+                }
+            }
+
+            tiles->PendingMappings.push_back(
+                {coordinate, resourceHeap->GetHeap(),
+                 static_cast<uint32_t>(tilePage->GetOffset() /
+                                       D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES)});
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::UnmapTiles(ResourceAllocation* reservedResourceAllocation,
+                                          uint32_t count,
+                                          const D3D12_TILED_RESOURCE_COORDINATE* coordinates) {
+        if (count > 0 && coordinates == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.UnmapTiles");
+
+        std::lock_guard<std::mutex> lock(mReservedResourcesMutex);
+        auto it = mReservedResources.find(reservedResourceAllocation);
+        if (it == mReservedResources.end()) {
+            return E_INVALIDARG;
+        }
+
+        ReservedResourceTiles* tiles = it->second.get();
+        MemoryAllocator* allocator = mTilePageAllocatorOfType[tiles->ResourceHeapTypeIndex].get();
+        ASSERT(allocator != nullptr);
+
+        for (uint32_t i = 0; i < count; i++) {
+            const D3D12_TILED_RESOURCE_COORDINATE& coordinate = coordinates[i];
+            auto tileIt = tiles->MappedTiles.find(
+                {coordinate.Subresource, coordinate.X, coordinate.Y, coordinate.Z});
+            if (tileIt == tiles->MappedTiles.end()) {
+                continue;
+            }
+
+            std::unique_ptr<MemoryAllocation> tilePage = std::move(tileIt->second);
+            tiles->MappedTiles.erase(tileIt);
+
+            if (mResidencyManager != nullptr) {
+                ReturnIfFailed(mResidencyManager->UnlockHeap(ToBackend(tilePage->GetMemory())));
+            }
+
+            // The page can be re-used right away since the queue updates tile mappings in order.
+            {
+                std::lock_guard<std::mutex> heapTypeLock(
+                    mMutexOfType[tiles->ResourceHeapTypeIndex]);
+                allocator->DeallocateMemory(std::move(tilePage));
+            }
+
+            tiles->PendingMappings.push_back({coordinate, /*Heap*/ nullptr, /*HeapTileOffset*/ 0});
+        }
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::UpdateTileMappings(ID3D12CommandQueue* queue) {
+        if (queue == nullptr) {
+            return E_POINTER;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.UpdateTileMappings");
+
+        std::lock_guard<std::mutex> lock(mReservedResourcesMutex);
+
+        std::vector<D3D12_TILED_RESOURCE_COORDINATE> coordinates;
+        std::vector<D3D12_TILE_RANGE_FLAGS> rangeFlags;
+        std::vector<UINT> heapTileOffsets;
+        std::vector<UINT> rangeTileCounts;
+        for (auto& entry : mReservedResources) {
+            ReservedResourceTiles* tiles = entry.second.get();
+            const std::vector<TileMapping>& mappings = tiles->PendingMappings;
+            for (size_t first = 0; first < mappings.size();) {
+                // Batch every consecutive mapping to the same heap (or unmapped).
+                size_t last = first;
+                while (last < mappings.size() && mappings[last].Heap == mappings[first].Heap) {
+                    last++;
+                }
+
+                coordinates.clear();
+                rangeFlags.clear();
+                heapTileOffsets.clear();
+                for (size_t i = first; i < last; i++) {
+                    coordinates.push_back(mappings[i].Coordinate);
+                    rangeFlags.push_back((mappings[i].Heap == nullptr)
+                                             ? D3D12_TILE_RANGE_FLAG_NULL
+                                             : D3D12_TILE_RANGE_FLAG_NONE);
+                    heapTileOffsets.push_back(mappings[i].HeapTileOffset);
+                }
+                rangeTileCounts.assign(coordinates.size(), 1);
+
+                // Each region and range is a single tile.
+                const UINT numOfTiles = static_cast<UINT>(coordinates.size());
+                queue->UpdateTileMappings(tiles->Resource, numOfTiles, coordinates.data(),
+                                          /*pResourceRegionSizes*/ nullptr,
+                                          mappings[first].Heap.Get(), numOfTiles,
+                                          rangeFlags.data(), heapTileOffsets.data(),
+                                          rangeTileCounts.data(), D3D12_TILE_MAPPING_FLAG_NONE);
+
+                first = last;
+            }
+
+            tiles->PendingMappings.clear();
+        }
+
+        return S_OK;
+    }
+
+    void ResourceAllocator::ReportAllocatorCounters() const {
+        // Avoid querying the allocators when the counters would be discarded.
+        if (!IsEventTraceEnabled()) {
+            return;
+        }
+
+        const QUERY_RESOURCE_ALLOCATOR_INFO& info = QueryInfo();
+        GPGMM_UNUSED(info);
 
-        TRACE_COUNTER1(TraceEventCategory::Default, "GPU memory reserved (%)",
+        TRACE_COUNTER1(
+            TraceEventCategory::Allocation, "GPU memory unused (%)",
+            (1.0 - (info.UsedBlockUsage / static_cast<double>(info.UsedMemoryUsage))) * 100);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory unused (MBytes)",
+                       (info.UsedMemoryUsage - info.UsedBlockUsage) / 1e6);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory reserved (%)",
                        (info.FreeMemoryUsage /
                         static_cast<double>(info.UsedMemoryUsage + info.FreeMemoryUsage) * 100));
 
-        TRACE_COUNTER1(TraceEventCategory::Default, "GPU memory reserved (MBytes)",
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory reserved (MBytes)",
                        info.FreeMemoryUsage / 1e6);
 
+        JSONDict tagUsageArgs;
+        for (uint32_t tag = 0; tag < kMaxAllocationTagCount; tag++) {
+            const AllocationTagCounters& counters = mTagCounters[tag];
+            if (counters.IsUsed.load(std::memory_order_relaxed)) {
+                tagUsageArgs.AddItem(std::to_string(tag).c_str(), counters.UsedUsage.Load() / 1e6);
+            }
+        }
+
+        TRACE_COUNTER(TraceEventCategory::Allocation, "GPU memory by tag (MBytes)", tagUsageArgs);
+    }
+
+    void ResourceAllocator::TrackTaggedAllocation(ResourceAllocation* resourceAllocation,
+                                                  uint32_t tag) {
+        ASSERT(tag < kMaxAllocationTagCount);
+        ASSERT(resourceAllocation->mTaggedBy == nullptr);
+
+        resourceAllocation->mTaggedBy = this;
+        resourceAllocation->mTag = tag;
+
+        const uint64_t size = resourceAllocation->GetSize();
+
+        mFrameCounters.AllocationCount.fetch_add(1, std::memory_order_relaxed);
+        mFrameCounters.AllocationUsage.fetch_add(size, std::memory_order_relaxed);
+
+        AllocationTagCounters& counters = mTagCounters[tag];
+        counters.UsedCount++;
+        counters.UsedUsage += size;
+        counters.IsUsed.store(true, std::memory_order_relaxed);
+
+        // Only the allocation which exceeds the quota is reported, not every one after.
+        const uint64_t usage = counters.UsedUsage.Load();
+        const uint64_t quota = counters.Quota.load(std::memory_order_relaxed);
+        if (usage <= quota || usage - size > quota) {
+            return;
+        }
+
+        gpgmm::DebugLog() << "Resource allocations of tag " << tag << " exceeded the quota ("
+                          << usage << " vs " << quota << " bytes).\n";
+
+        if (mResidencyManager != nullptr) {
+            mResidencyManager->NotifyTagQuotaExceeded(
+                ToBackend(resourceAllocation->GetMemory())->GetMemorySegmentGroup(), tag, usage,
+                quota);
+        }
+    }
+
+    void ResourceAllocator::UntrackTaggedAllocation(const ResourceAllocation* resourceAllocation) {
+        ASSERT(resourceAllocation->mTaggedBy == this);
+
+        mFrameCounters.ReleasedCount.fetch_add(1, std::memory_order_relaxed);
+        mFrameCounters.ReleasedUsage.fetch_add(resourceAllocation->GetSize(),
+                                               std::memory_order_relaxed);
+
+        AllocationTagCounters& counters = mTagCounters[resourceAllocation->mTag];
+        counters.UsedCount--;
+        counters.UsedUsage -= resourceAllocation->GetSize();
+    }
+
+    void ResourceAllocator::TrackTaggedAllocationExtended(
+        const ResourceAllocation* resourceAllocation,
+        uint64_t extendedSize) {
+        ASSERT(resourceAllocation->mTaggedBy == this);
+
+        mFrameCounters.AllocationUsage.fetch_add(extendedSize, std::memory_order_relaxed);
+
+        AllocationTagCounters& counters = mTagCounters[resourceAllocation->mTag];
+        counters.UsedUsage += extendedSize;
+    }
+
+    void ResourceAllocator::TrackLiveAllocation(ResourceAllocation* resourceAllocation,
+                                                const void* callSite) {
         // Insert a new (debug) allocator layer into the allocation so it can report details used
-        // during leak checks. Since we don't want to use it unless we are debugging, we hide it
-        // behind a macro.
-#if defined(GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG)
-        mDebugAllocator->AddLiveAllocation(*resourceAllocationOut);
-#endif
+        // during leak checks or snapshots. Since we don't want to use it unless we are debugging
+        // or tracking live allocations, it only exists when enabled.
+        if (mDebugAllocator != nullptr) {
+            mDebugAllocator->AddLiveAllocation(resourceAllocation, callSite);
+        }
 
-        GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(*resourceAllocationOut,
-                                          (*resourceAllocationOut)->GetInfo());
+        if (resourceAllocation->mIsRecorded) {
+            GPGMM_TRACE_EVENT_OBJECT_SNAPSHOT(resourceAllocation, resourceAllocation->GetInfo());
+        }
+    }
 
-        return S_OK;
+    bool ResourceAllocator::IsCallSampled() {
+        const uint32_t callSampleRate = mDescriptor.RecordOptions.CallSampleRate;
+        if (callSampleRate <= 1 || !IsEventTraceEnabled()) {
+            return true;
+        }
+
+        return mRecordedCallCount.fetch_add(1, std::memory_order_relaxed) % callSampleRate == 0;
     }
 
-    HRESULT ResourceAllocator::CreateResourceInternal(const ALLOCATION_DESC& allocationDescriptor,
-                                                      const D3D12_RESOURCE_DESC& resourceDescriptor,
-                                                      D3D12_RESOURCE_STATES initialResourceState,
-                                                      const D3D12_CLEAR_VALUE* clearValue,
-                                                      ResourceAllocation** resourceAllocationOut) {
-        // If d3d tells us the resource size is invalid, treat the error as OOM.
-        // Otherwise, creating a very large resource could overflow the allocator.
+    HRESULT ResourceAllocator::CreateResourceInternal(
+        const ALLOCATION_DESC& allocationDescriptor,
+        const D3D12_RESOURCE_DESC& resourceDescriptor,
+        const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
+        D3D12_RESOURCE_STATES initialResourceState,
+        const D3D12_CLEAR_VALUE* clearValue,
+        ResourceAllocation** resourceAllocationOut) {
+        if (allocationDescriptor.Tag >= kMaxAllocationTagCount) {
+            return E_INVALIDARG;
+        }
+
+        // Map once created, so every Map after is only a pointer return.
+        const bool isCPUAccessible =
+            allocationDescriptor.HeapType == D3D12_HEAP_TYPE_DEFAULT &&
+            allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE;
+
+        if (allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_MAPPED) {
+            if (allocationDescriptor.HeapType != D3D12_HEAP_TYPE_UPLOAD &&
+                allocationDescriptor.HeapType != D3D12_HEAP_TYPE_READBACK &&
+                allocationDescriptor.HeapType != kHeapTypeGPUUpload && !isCPUAccessible) {
+                return E_INVALIDARG;
+            }
+
+            ALLOCATION_DESC unmappedAllocationDescriptor = allocationDescriptor;
+            unmappedAllocationDescriptor.Flags ^= ALLOCATION_FLAG_ALWAYS_MAPPED;
+
+            ResourceAllocation* resourceAllocation = nullptr;
+            ReturnIfFailed(CreateResourceInternal(unmappedAllocationDescriptor, resourceDescriptor,
+                                                  resourceInfo, initialResourceState, clearValue,
+                                                  &resourceAllocation));
+
+            const HRESULT hr = resourceAllocation->MapPersistently();
+            if (FAILED(hr)) {
+                resourceAllocation->Release();
+                return hr;
+            }
+
+            *resourceAllocationOut = resourceAllocation;
+            return S_OK;
+        }
+
         D3D12_RESOURCE_DESC newResourceDesc = resourceDescriptor;
-        const D3D12_RESOURCE_ALLOCATION_INFO resourceInfo =
-            GetResourceAllocationInfo(mDevice.Get(), newResourceDesc);
         if (resourceInfo.SizeInBytes == kInvalidSize) {
             return E_OUTOFMEMORY;
         }
@@ -644,22 +2738,207 @@ namespace gpgmm { namespace d3d12 {
         const RESOURCE_HEAP_TYPE resourceHeapType =
             GetResourceHeapType(newResourceDesc.Dimension, allocationDescriptor.HeapType,
                                 newResourceDesc.Flags, mResourceHeapTier);
-        if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID) {
+        if (resourceHeapType == RESOURCE_HEAP_TYPE_INVALID ||
+            !IsHeapTypeSupported(allocationDescriptor.HeapType)) {
             return E_INVALIDARG;
         }
 
+        // Pooled resource heaps are released before the heap type budget is exceeded.
+        ReleasePooledMemoryOverHeapTypeBudget(allocationDescriptor.HeapType,
+                                              resourceInfo.SizeInBytes);
+
         const bool neverAllocate =
             allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
 
+        // Huge resources go straight to their own resource heap. Otherwise, every sub-allocator
+        // would lock, compute its sizes and fail before the resource heap allocator is tried.
         const bool neverSubAllocate =
-            allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+            (allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY) ||
+            resourceInfo.SizeInBytes > mMaxResourceSizeForSubAllocation;
 
         const bool prefetchMemory =
             allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_PREFETCH_MEMORY;
 
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = resourceInfo.SizeInBytes;
+        request.Alignment = resourceInfo.Alignment;
+        request.NeverAllocate = neverAllocate;
+        request.Lifetime = static_cast<MemoryAllocationLifetime>(allocationDescriptor.Lifetime);
+        request.UpperAddress = allocationDescriptor.Flags & ALLOCATION_FLAG_UPPER_ADDRESS;
+
+        // Resources of a pool are only placed in its resource heaps. Resource heap types differ
+        // by resource heap tier, so the heap flags of the pool are checked against those a
+        // resource requires on tier 1 instead.
+        if (allocationDescriptor.CustomPool != nullptr) {
+            Pool* pool = allocationDescriptor.CustomPool;
+            if (pool->mResourceAllocator.Get() != this || isCPUAccessible ||
+                allocationDescriptor.HeapType != pool->mDesc.HeapType) {
+                return E_INVALIDARG;
+            }
+
+            const RESOURCE_HEAP_TYPE tier1ResourceHeapType =
+                GetResourceHeapType(newResourceDesc.Dimension, allocationDescriptor.HeapType,
+                                    newResourceDesc.Flags, D3D12_RESOURCE_HEAP_TIER_1);
+            const D3D12_HEAP_FLAGS poolHeapFlags = pool->mDesc.HeapFlags & ~D3D12_HEAP_FLAG_SHARED;
+            if (tier1ResourceHeapType == RESOURCE_HEAP_TYPE_INVALID ||
+                (poolHeapFlags != D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES &&
+                 poolHeapFlags != GetHeapFlags(tier1ResourceHeapType))) {
+                return E_INVALIDARG;
+            }
+
+            ReturnIfSucceeded(TryAllocateResource(
+                &pool->mMutex, &mLockWaitLatency, mAllocationTimer.get(), pool->mAllocator.get(),
+                request,
+                [&](const auto& subAllocation) -> HRESULT {
+                    ComPtr<ID3D12Resource> placedResource;
+                    Heap* resourceHeap = ToBackend(subAllocation.GetMemory());
+                    ReturnIfFailed(CreatePlacedResource(resourceHeap, subAllocation.GetOffset(),
+                                                        &newResourceDesc, clearValue,
+                                                        initialResourceState, &placedResource));
+
+                    *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                        mResidencyManager.Get(), subAllocation.GetAllocator(),
+                        subAllocation.GetOffset(), subAllocation.GetBlock(),
+                        subAllocation.GetMethod(), std::move(placedResource), resourceHeap};
+                    return S_OK;
+                }));
+
+            return E_OUTOFMEMORY;
+        }
+
+        InitializeAllocatorsOfType(static_cast<size_t>(resourceHeapType));
+
+        std::mutex& heapTypeMutex = mMutexOfType[static_cast<size_t>(resourceHeapType)];
+
+        // CPU-accessible resources can only be placed in custom heaps, so no other allocator
+        // can be used.
+        if (isCPUAccessible) {
+            MemoryAllocator* cpuAccessibleAllocator =
+                mCPUAccessibleAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+            if (cpuAccessibleAllocator == nullptr) {
+                gpgmm::WarningLog()
+                    << "CPU-accessible default resources are only supported on UMA adapters.\n";
+                return E_INVALIDARG;
+            }
+
+            ReturnIfSucceeded(TryAllocateResource(
+                &heapTypeMutex, &mLockWaitLatency, mAllocationTimer.get(), cpuAccessibleAllocator,
+                request,
+                [&](const auto& subAllocation) -> HRESULT {
+                    ComPtr<ID3D12Resource> placedResource;
+                    Heap* resourceHeap = ToBackend(subAllocation.GetMemory());
+                    ReturnIfFailed(CreatePlacedResource(resourceHeap, subAllocation.GetOffset(),
+                                                        &newResourceDesc, clearValue,
+                                                        initialResourceState, &placedResource));
+
+                    *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                        mResidencyManager.Get(), subAllocation.GetAllocator(),
+                        subAllocation.GetOffset(), subAllocation.GetBlock(),
+                        subAllocation.GetMethod(), std::move(placedResource), resourceHeap};
+                    return S_OK;
+                }));
+
+            return E_OUTOFMEMORY;
+        }
+
+        // Skip the layers which failed the last resource of the same kind, instead of locking
+        // and failing each of them again. Requests which never allocate fail cheaply and could
+        // succeed once any resource is released, so they are not cached.
+        const uint32_t layerCacheKey = GetCreateResourceLayerCacheKey(
+            resourceHeapType, newResourceDesc, resourceInfo, allocationDescriptor);
+        const CreateResourceLayer firstLayer = (neverAllocate)
+                                                   ? CreateResourceLayer::kSmallTexture
+                                                   : LookupCreateResourceLayer(layerCacheKey);
+
+        // Committing is only considered when padding the resource to the default placement
+        // alignment, as committed resources are, wastes less than the fragmentation limit.
+        const bool isAdaptiveCommitted =
+            (mDescriptor.Flags & ALLOCATOR_FLAG_ADAPTIVE_COMMITTED) && !mIsAlwaysCommitted &&
+            !neverAllocate &&
+            (AlignTo(resourceInfo.SizeInBytes, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) -
+             resourceInfo.SizeInBytes) <=
+                mDescriptor.ResourceFragmentationLimit * resourceInfo.SizeInBytes;
+        const bool isCommittedCheaper =
+            isAdaptiveCommitted && ShouldCreateCommittedResource(
+                                       static_cast<size_t>(resourceHeapType),
+                                       resourceInfo.SizeInBytes);
+
+        // Time spent by the layers which placed, or committed, the resource.
+        uint64_t layerStartTicks = 0;
+
+        bool hasLayerFailed = false;
+        const auto onLayerSucceeded = [&](CreateResourceLayer layer) {
+            if (hasLayerFailed && !neverAllocate) {
+                UpdateCreateResourceLayer(layerCacheKey, layer);
+            }
+            if (isAdaptiveCommitted) {
+                // Counted by the layer which created the resource, since placing can fall back
+                // to committing.
+                const bool isCommitted = (layer == CreateResourceLayer::kCommitted);
+                if (isCommitted) {
+                    mAdaptiveCommittedCount++;
+                } else {
+                    mAdaptivePlacedCount++;
+                }
+                RecordCreateResourceCost(
+                    static_cast<size_t>(resourceHeapType), resourceInfo.SizeInBytes, isCommitted,
+                    mAllocationTimer->TicksToNanoseconds(mAllocationTimer->GetTicks() -
+                                                         layerStartTicks));
+            }
+        };
+
         // Attempt to allocate using the most effective allocator.;
         MemoryAllocator* allocator = nullptr;
 
+        // Creates a resource allocation within the resource of the buffer allocated.
+        const auto createResourceWithinFn = [&](const auto& subAllocation) -> HRESULT {
+            // Committed resource implicitly creates a resource heap which can be
+            // used for sub-allocation. Otherwise, the buffer was placed in the resource heap.
+            Heap* resourceHeap = ToBackend(subAllocation.GetMemory());
+            ComPtr<ID3D12Resource> bufferResource = resourceHeap->GetPlacedBuffer();
+            if (bufferResource == nullptr) {
+                ReturnIfFailed(resourceHeap->GetPageable().As(&bufferResource));
+            }
+
+            *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                mResidencyManager.Get(), subAllocation.GetAllocator(), subAllocation.GetBlock(),
+                subAllocation.GetOffset(), std::move(bufferResource), resourceHeap};
+
+            if (subAllocation.GetSize() > newResourceDesc.Width) {
+                InfoEvent("ResourceAllocator.CreateResource",
+                          ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_MISALIGNMENT)
+                    << "Resource allocation size is larger then the resource size ("
+                    << subAllocation.GetSize() << " vs " << newResourceDesc.Width << " bytes).";
+            }
+
+            return S_OK;
+        };
+
+        // Buffers created within another resource only need to be aligned to the buffer.
+        MEMORY_ALLOCATION_REQUEST bufferRequest = request;
+        bufferRequest.Size = newResourceDesc.Width;
+        bufferRequest.Alignment = (newResourceDesc.Alignment == 0) ? 1 : newResourceDesc.Alignment;
+
+        // Attempt to create a transient resource allocation within the transient buffer.
+        // Allocating only bumps an offset and the memory is re-used all at once when the fence
+        // value completes, so this is tried first.
+        RingMemoryAllocator* transientAllocator =
+            mTransientAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+        if (allocationDescriptor.Flags & ALLOCATION_FLAG_TRANSIENT && transientAllocator &&
+            newResourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER &&
+            GetInitialResourceState(allocationDescriptor.HeapType) == initialResourceState &&
+            !mIsAlwaysCommitted && !neverSubAllocate) {
+            // Racing another thread could assign a larger fence value, which only delays
+            // re-using the memory.
+            transientAllocator->SetPendingSerial(allocationDescriptor.FenceValue);
+
+            // Transient allocator locks internally, so the heap type lock is not needed.
+            ReturnIfSucceeded(TryAllocateResource(/*heapTypeMutex*/ nullptr,
+                                                  /*lockWaitLatency*/ nullptr, /*timer*/ nullptr,
+                                                  transientAllocator, bufferRequest,
+                                                  createResourceWithinFn));
+        }
+
         // Attempt to create a resource allocation within the same resource.
         // This has the same performace as sub-allocating resource heaps without the
         // drawback of requiring resource heaps to be 64KB size-aligned. However, this
@@ -673,46 +2952,89 @@ namespace gpgmm { namespace d3d12 {
             !mIsAlwaysCommitted && !neverSubAllocate) {
             allocator = mBufferAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
 
-            const uint64_t alignment =
-                (newResourceDesc.Alignment == 0) ? 1 : newResourceDesc.Alignment;
+            // Buffer allocators cache blocks per-thread and lock internally, so the heap type
+            // lock is not needed.
+            ReturnIfSucceeded(TryAllocateResource(/*heapTypeMutex*/ nullptr,
+                                                  /*lockWaitLatency*/ nullptr, /*timer*/ nullptr,
+                                                  allocator, bufferRequest,
+                                                  createResourceWithinFn));
+        }
+
+        // Attempt to create a large buffer allocation within a large buffer. Unlike placing the
+        // buffer in a resource heap, no resource is created. The large buffer has no resource
+        // flags, so neither can the buffer sub-allocated within it.
+        MemoryAllocator* largeBufferAllocator =
+            mLargeBufferAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+        if (allocationDescriptor.Flags & ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE &&
+            largeBufferAllocator != nullptr &&
+            newResourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER &&
+            newResourceDesc.Flags == D3D12_RESOURCE_FLAG_NONE &&
+            GetInitialResourceState(allocationDescriptor.HeapType) == initialResourceState &&
+            !mIsAlwaysCommitted && !neverSubAllocate) {
+            // Large buffer allocators lock internally, so the heap type lock is not needed.
+            ReturnIfSucceeded(TryAllocateResource(/*heapTypeMutex*/ nullptr,
+                                                  /*lockWaitLatency*/ nullptr, /*timer*/ nullptr,
+                                                  largeBufferAllocator, bufferRequest,
+                                                  createResourceWithinFn));
+        }
+
+        if (isAdaptiveCommitted) {
+            layerStartTicks = mAllocationTimer->GetTicks();
+        }
 
+        // Attempt to create a small texture allocation by placing the texture in a 4KB block.
+        // Otherwise, small textures would use a 64KB block like any other resource.
+        MemoryAllocator* smallTextureAllocator =
+            mSmallTextureAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+        if (smallTextureAllocator != nullptr &&
+            resourceInfo.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT &&
+            resourceInfo.SizeInBytes < D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT &&
+            newResourceDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && !mIsAlwaysCommitted &&
+            !isCommittedCheaper && !neverSubAllocate &&
+            firstLayer <= CreateResourceLayer::kSmallTexture) {
             ReturnIfSucceeded(TryAllocateResource(
-                allocator, newResourceDesc.Width, alignment, neverAllocate,
-                /*prefetchMemory*/ false,
-                /*cacheSize*/ false, [&](const auto& subAllocation) -> HRESULT {
-                    // Committed resource implicitly creates a resource heap which can be
-                    // used for sub-allocation.
-                    ComPtr<ID3D12Resource> committedResource;
+                &heapTypeMutex, &mLockWaitLatency, mAllocationTimer.get(), smallTextureAllocator,
+                request,
+                [&](const auto& subAllocation) -> HRESULT {
+                    ComPtr<ID3D12Resource> placedResource;
                     Heap* resourceHeap = ToBackend(subAllocation.GetMemory());
-                    ReturnIfFailed(resourceHeap->GetPageable().As(&committedResource));
-
-                    *resourceAllocationOut = new ResourceAllocation{
-                        mResidencyManager.Get(),      subAllocation.GetAllocator(),
-                        subAllocation.GetBlock(),     subAllocation.GetOffset(),
-                        std::move(committedResource), resourceHeap};
+                    ReturnIfFailed(CreatePlacedResource(resourceHeap, subAllocation.GetOffset(),
+                                                        &newResourceDesc, clearValue,
+                                                        initialResourceState, &placedResource));
 
-                    if (subAllocation.GetSize() > newResourceDesc.Width) {
-                        InfoEvent("ResourceAllocator.CreateResource",
-                                  ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_MISALIGNMENT)
-                            << "Resource allocation size is larger then the resource size (" +
-                                   std::to_string(subAllocation.GetSize()) + " vs " +
-                                   std::to_string(newResourceDesc.Width) + " bytes).";
-                    }
+                    *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                        mResidencyManager.Get(), subAllocation.GetAllocator(),
+                        subAllocation.GetOffset(), subAllocation.GetBlock(),
+                        subAllocation.GetMethod(), std::move(placedResource), resourceHeap};
 
+                    onLayerSucceeded(CreateResourceLayer::kSmallTexture);
                     return S_OK;
                 }));
+
+            hasLayerFailed = true;
         }
 
         // Attempt to create a resource allocation by placing a resource in a sub-allocated
         // resource heap.
         // The time and space complexity of is determined by the sub-allocation algorithm used.
-        if (!mIsAlwaysCommitted && !neverSubAllocate) {
-            allocator = mResourceAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
-
+        if (!mIsAlwaysCommitted && !isCommittedCheaper && !neverSubAllocate &&
+            firstLayer <= CreateResourceLayer::kSubAllocated) {
+            allocator = GetSubAllocatorOfType(static_cast<size_t>(resourceHeapType),
+                                              resourceInfo.Alignment);
+
+            MEMORY_ALLOCATION_REQUEST subAllocationRequest = request;
+            subAllocationRequest.PrefetchMemory = prefetchMemory;
+            subAllocationRequest.MemorySizeLimit =
+                GetMaxResourceHeapSizeForBudget(allocationDescriptor.HeapType);
+
+            // Shards lock internally, so threads only contend on their own shard.
+            const bool isSharded =
+                mDescriptor.SubAllocatorShardCount > 1 &&
+                allocator == mResourceAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
             ReturnIfSucceeded(TryAllocateResource(
-                allocator, resourceInfo.SizeInBytes, resourceInfo.Alignment, neverAllocate,
-                prefetchMemory,
-                /*cacheSize*/ false, [&](const auto& subAllocation) -> HRESULT {
+                (isSharded) ? nullptr : &heapTypeMutex, &mLockWaitLatency,
+                mAllocationTimer.get(), allocator, subAllocationRequest,
+                [&](const auto& subAllocation) -> HRESULT {
                     // Resource is placed at an offset corresponding to the allocation offset.
                     // Each allocation maps to a disjoint (physical) address range so no physical
                     // memory is can be aliased or will overlap.
@@ -722,24 +3044,35 @@ namespace gpgmm { namespace d3d12 {
                                                         &newResourceDesc, clearValue,
                                                         initialResourceState, &placedResource));
 
-                    *resourceAllocationOut = new ResourceAllocation{mResidencyManager.Get(),
-                                                                    subAllocation.GetAllocator(),
-                                                                    subAllocation.GetOffset(),
-                                                                    subAllocation.GetBlock(),
-                                                                    subAllocation.GetMethod(),
-                                                                    std::move(placedResource),
-                                                                    resourceHeap};
+                    *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                        mResidencyManager.Get(), subAllocation.GetAllocator(),
+                        subAllocation.GetOffset(), subAllocation.GetBlock(),
+                        subAllocation.GetMethod(), std::move(placedResource), resourceHeap};
+
+                    if (mWarmUpProfileRecorder != nullptr) {
+                        ALLOCATOR_WARM_UP_DESC warmUpDesc = {};
+                        warmUpDesc.HeapType = allocationDescriptor.HeapType;
+                        warmUpDesc.Dimension = newResourceDesc.Dimension;
+                        warmUpDesc.ResourceFlags = newResourceDesc.Flags;
+                        warmUpDesc.SizeInBytes = resourceInfo.SizeInBytes;
+                        warmUpDesc.Alignment = resourceInfo.Alignment;
+                        (*resourceAllocationOut)->mWarmUpProfileEntry =
+                            mWarmUpProfileRecorder->RecordAllocation(warmUpDesc);
+                    }
 
                     if (subAllocation.GetSize() > resourceInfo.SizeInBytes) {
                         InfoEvent("ResourceAllocator.CreateResource",
                                   ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_MISALIGNMENT)
-                            << "Resource allocation size is larger then the resource size (" +
-                                   std::to_string(subAllocation.GetSize()) + " vs " +
-                                   std::to_string(resourceInfo.SizeInBytes) + " bytes).";
+                            << "Resource allocation size is larger then the resource size ("
+                            << subAllocation.GetSize() << " vs " << resourceInfo.SizeInBytes
+                            << " bytes).";
                     }
 
+                    onLayerSucceeded(CreateResourceLayer::kSubAllocated);
                     return S_OK;
                 }));
+
+            hasLayerFailed = true;
         }
 
         const D3D12_HEAP_FLAGS& heapFlags = GetHeapFlags(resourceHeapType);
@@ -749,12 +3082,16 @@ namespace gpgmm { namespace d3d12 {
         // resource because a placed resource's heap will not be reallocated by the OS until Trim()
         // is called.
         // The time and space complexity is determined by the allocator type.
-        if (!mIsAlwaysCommitted) {
+        if (!mIsAlwaysCommitted && !isCommittedCheaper &&
+            firstLayer <= CreateResourceLayer::kResourceHeap) {
             allocator = mResourceHeapAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
 
+            MEMORY_ALLOCATION_REQUEST resourceHeapRequest = request;
+            resourceHeapRequest.Alignment = GetHeapAlignment(heapFlags);
+
             ReturnIfSucceeded(TryAllocateResource(
-                allocator, resourceInfo.SizeInBytes, GetHeapAlignment(heapFlags), neverAllocate,
-                /*cacheSize*/ false, /*prefetchMemory*/ false,
+                &heapTypeMutex, &mLockWaitLatency, mAllocationTimer.get(), allocator,
+                resourceHeapRequest,
                 [&](const auto& allocation) -> HRESULT {
                     Heap* resourceHeap = ToBackend(allocation.GetMemory());
                     ComPtr<ID3D12Resource> placedResource;
@@ -762,24 +3099,24 @@ namespace gpgmm { namespace d3d12 {
                                                         &newResourceDesc, clearValue,
                                                         initialResourceState, &placedResource));
 
-                    *resourceAllocationOut = new ResourceAllocation{mResidencyManager.Get(),
-                                                                    allocation.GetAllocator(),
-                                                                    allocation.GetOffset(),
-                                                                    allocation.GetBlock(),
-                                                                    allocation.GetMethod(),
-                                                                    std::move(placedResource),
-                                                                    resourceHeap};
+                    *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+                        mResidencyManager.Get(), allocation.GetAllocator(), allocation.GetOffset(),
+                        allocation.GetBlock(), allocation.GetMethod(), std::move(placedResource),
+                        resourceHeap};
 
                     if (allocation.GetSize() > resourceInfo.SizeInBytes) {
                         InfoEvent("ResourceAllocator.CreateResource",
                                   ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_MISALIGNMENT)
-                            << "Resource allocation size is larger then the resource size (" +
-                                   std::to_string(allocation.GetSize()) + " vs " +
-                                   std::to_string(resourceInfo.SizeInBytes) + " bytes).";
+                            << "Resource allocation size is larger then the resource size ("
+                            << allocation.GetSize() << " vs " << resourceInfo.SizeInBytes
+                            << " bytes).";
                     }
 
+                    onLayerSucceeded(CreateResourceLayer::kResourceHeap);
                     return S_OK;
                 }));
+
+            hasLayerFailed = true;
         }
 
         // Attempt to create a standalone committed resource. This strategy is the safest but also
@@ -790,29 +3127,235 @@ namespace gpgmm { namespace d3d12 {
             return E_OUTOFMEMORY;
         }
 
-        if (!mIsAlwaysCommitted) {
+        if (!mIsAlwaysCommitted && !isCommittedCheaper) {
             InfoEvent("ResourceAllocator.CreateResource",
                       ALLOCATOR_MESSAGE_ID_RESOURCE_ALLOCATION_NON_POOLED)
                 << "Resource allocation could not be created from memory pool.";
         }
 
-        ComPtr<ID3D12Resource> committedResource;
-        Heap* resourceHeap = nullptr;
-        ReturnIfFailed(CreateCommittedResource(
-            allocationDescriptor.HeapType, heapFlags, resourceInfo.SizeInBytes, &newResourceDesc,
-            clearValue, initialResourceState, &committedResource, &resourceHeap));
+        // Placing could have failed first, which committing on its own would not wait for.
+        if (isAdaptiveCommitted) {
+            layerStartTicks = mAllocationTimer->GetTicks();
+        }
+
+        // Committed resources count against the heap type budget like resource heaps do.
+        HeapUsageBudget* heapTypeBudget = GetHeapTypeBudget(allocationDescriptor.HeapType);
+        if (heapTypeBudget != nullptr && !heapTypeBudget->TryAdd(resourceInfo.SizeInBytes)) {
+            DebugEvent("ResourceAllocator.CreateResource", ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Committed resource exceeds the budget of its heap type ("
+                << heapTypeBudget->GetUsage() << " + " << resourceInfo.SizeInBytes << " vs "
+                << heapTypeBudget->GetMaxUsage() << " bytes).";
+            return E_OUTOFMEMORY;
+        }
+
+        ComPtr<ID3D12Resource> committedResource;
+        Heap* resourceHeap = nullptr;
+        const HRESULT hr = CreateCommittedResource(
+            allocationDescriptor.HeapType, heapFlags, resourceInfo.SizeInBytes, &newResourceDesc,
+            clearValue, initialResourceState, &committedResource, &resourceHeap);
+        if (FAILED(hr)) {
+            if (heapTypeBudget != nullptr) {
+                heapTypeBudget->Subtract(resourceInfo.SizeInBytes);
+            }
+            return hr;
+        }
+
+        mInfo.UsedMemoryUsage += resourceHeap->GetSize();
+        mInfo.UsedMemoryCount++;
+
+        *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+            mResidencyManager.Get(), /*allocator*/ this, /*offsetFromHeap*/ kInvalidOffset,
+            /*block*/ nullptr, AllocationMethod::kStandalone, std::move(committedResource),
+            resourceHeap};
+
+        if (heapTypeBudget != nullptr) {
+            std::lock_guard<std::mutex> lock(mCommittedResourceBudgetsMutex);
+            mCommittedResourceBudgets.emplace(*resourceAllocationOut, heapTypeBudget);
+            mCommittedResourceBudgetCount.fetch_add(1, std::memory_order_release);
+        }
+
+        onLayerSucceeded(CreateResourceLayer::kCommitted);
+
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CreateResourceAsync(
+        const ALLOCATION_DESC& allocationDescriptor,
+        const D3D12_RESOURCE_DESC& resourceDescriptor,
+        D3D12_RESOURCE_STATES initialResourceState,
+        const D3D12_CLEAR_VALUE* clearValue,
+        std::shared_ptr<ResourceAllocationEvent>* resourceAllocationEventOut) {
+        if (!resourceAllocationEventOut) {
+            return E_POINTER;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateResourceAsync");
+
+        std::shared_ptr<CreateResourceTask> task = std::make_shared<CreateResourceTask>(
+            this, allocationDescriptor, resourceDescriptor, initialResourceState, clearValue);
+        std::shared_ptr<Event> event = ThreadPool::PostTask(mThreadPool, task);
+        {
+            std::lock_guard<std::mutex> lock(mCreateResourceEventsMutex);
+            mCreateResourceEvents.erase(
+                std::remove_if(mCreateResourceEvents.begin(), mCreateResourceEvents.end(),
+                               [](const std::shared_ptr<Event>& createResourceEvent) {
+                                   return createResourceEvent->IsSignaled();
+                               }),
+                mCreateResourceEvents.end());
+            mCreateResourceEvents.push_back(event);
+        }
+
+        *resourceAllocationEventOut = std::make_shared<ResourceAllocationEvent>(event, task);
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CreatePool(const POOL_DESC& descriptor, Pool** poolOut) {
+        if (poolOut == nullptr) {
+            return E_POINTER;
+        }
+
+        // Resources of a pool are always placed in its resource heaps.
+        if (mIsAlwaysCommitted) {
+            return E_INVALIDARG;
+        }
+
+        if (descriptor.HeapType != D3D12_HEAP_TYPE_DEFAULT &&
+            descriptor.HeapType != D3D12_HEAP_TYPE_UPLOAD &&
+            descriptor.HeapType != D3D12_HEAP_TYPE_READBACK &&
+            descriptor.HeapType != kHeapTypeGPUUpload) {
+            return E_INVALIDARG;
+        }
+
+        if (!IsHeapTypeSupported(descriptor.HeapType)) {
+            return E_INVALIDARG;
+        }
+
+        // Shared resource heaps are exchanged with other processes, which cannot access memory
+        // of CPU-accessible heaps.
+        const bool isShared = descriptor.HeapFlags & D3D12_HEAP_FLAG_SHARED;
+        if (isShared && descriptor.HeapType != D3D12_HEAP_TYPE_DEFAULT) {
+            return E_INVALIDARG;
+        }
+
+        switch (descriptor.HeapFlags & ~D3D12_HEAP_FLAG_SHARED) {
+            case D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES:
+                if (mResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2) {
+                    return E_INVALIDARG;
+                }
+                break;
+            case D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS:
+                break;
+            case D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES:
+            case D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES:
+                if (descriptor.HeapType != D3D12_HEAP_TYPE_DEFAULT) {
+                    return E_INVALIDARG;
+                }
+                break;
+            default:
+                return E_INVALIDARG;
+        }
+
+        const uint64_t heapAlignment = GetHeapAlignment(descriptor.HeapFlags);
+        const uint64_t heapSize = (descriptor.HeapSizeInBytes > 0)
+                                      ? descriptor.HeapSizeInBytes
+                                      : kDefaultPreferredResourceHeapSize;
+        if (!IsPowerOfTwo(heapSize) || heapSize < heapAlignment ||
+            heapSize > mMaxResourceHeapSize) {
+            return E_INVALIDARG;
+        }
+
+        if (descriptor.MaxHeapCount > 0 && descriptor.MinHeapCount > descriptor.MaxHeapCount) {
+            return E_INVALIDARG;
+        }
+
+        // Resource heaps of the pool are pooled by the pool alone, so they never compete with
+        // other resources, and are never shared with other allocators on resource heap tier 2.
+        std::unique_ptr<ResourceHeapAllocator> poolResourceHeapAllocator =
+            std::make_unique<ResourceHeapAllocator>(
+                mResidencyManager.Get(), mDevice.Get(), descriptor.HeapType,
+                descriptor.HeapFlags | mHeapCreationFlags, mIsUMA, mIsAlwaysInBudget,
+                mReleaseInBackground, &mResourceHeapUsage, GetHeapTypeBudget(descriptor.HeapType),
+                &mCreateHeapLatency);
+
+        // Kept by the pool to import heaps, which are also counted towards the maximum.
+        ResourceHeapAllocator* resourceHeapAllocatorPtr = poolResourceHeapAllocator.get();
+
+        std::unique_ptr<MemoryAllocator> resourceHeapAllocator =
+            std::move(poolResourceHeapAllocator);
+
+        if (descriptor.MaxHeapCount > 0) {
+            resourceHeapAllocator = std::make_unique<CappedMemoryAllocator>(
+                std::move(resourceHeapAllocator), descriptor.MaxHeapCount * heapSize);
+        }
+
+        std::unique_ptr<SegmentedMemoryAllocator> pooledAllocator =
+            std::make_unique<SegmentedMemoryAllocator>(std::move(resourceHeapAllocator),
+                                                       heapAlignment);
+        SegmentedMemoryAllocator* pooledAllocatorPtr = pooledAllocator.get();
+
+        // Pre-allocate the minimum resource heaps by returning them to the pool right away.
+        {
+            MEMORY_ALLOCATION_REQUEST heapRequest = {};
+            heapRequest.Size = heapSize;
+            heapRequest.Alignment = heapAlignment;
+
+            std::vector<std::unique_ptr<MemoryAllocation>> heapAllocations;
+            for (uint32_t i = 0; i < descriptor.MinHeapCount; i++) {
+                std::unique_ptr<MemoryAllocation> heapAllocation =
+                    pooledAllocator->TryAllocateMemory(heapRequest);
+                if (heapAllocation == nullptr) {
+                    break;
+                }
+                heapAllocations.push_back(std::move(heapAllocation));
+            }
+
+            const bool allocatedMinHeapCount = heapAllocations.size() == descriptor.MinHeapCount;
+            for (std::unique_ptr<MemoryAllocation>& heapAllocation : heapAllocations) {
+                pooledAllocator->DeallocateMemory(std::move(heapAllocation));
+            }
 
-        mInfo.UsedMemoryUsage += resourceHeap->GetSize();
-        mInfo.UsedMemoryCount++;
+            if (!allocatedMinHeapCount) {
+                return E_OUTOFMEMORY;
+            }
+        }
 
-        *resourceAllocationOut = new ResourceAllocation{mResidencyManager.Get(),
-                                                        /*allocator*/ this,
-                                                        /*offsetFromHeap*/ kInvalidOffset,
-                                                        /*block*/ nullptr,
-                                                        AllocationMethod::kStandalone,
-                                                        std::move(committedResource),
-                                                        resourceHeap};
+        std::unique_ptr<MemoryAllocator> poolAllocator;
+        switch (descriptor.Algorithm) {
+            case ALLOCATOR_ALGORITHM_SLAB:
+                poolAllocator = std::make_unique<SlabCacheAllocator>(
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                    /*maxSlabSize*/ heapSize,
+                    /*slabSize*/ heapSize,
+                    /*slabAlignment*/ heapAlignment,
+                    /*slabFragmentationLimit*/ kDefaultFragmentationLimit,
+                    /*prefetchSlab*/ false,
+                    std::make_unique<BuddyMemoryAllocator>(
+                        PrevPowerOfTwo(mMaxResourceHeapSize), heapSize, heapAlignment,
+                        std::move(pooledAllocator),
+                        /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+                break;
+            case ALLOCATOR_ALGORITHM_BUDDY_SYSTEM:
+                poolAllocator = std::make_unique<BuddyMemoryAllocator>(
+                    PrevPowerOfTwo(mMaxResourceHeapSize), heapSize, heapAlignment,
+                    std::move(pooledAllocator),
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+                break;
+            case ALLOCATOR_ALGORITHM_TLSF:
+                poolAllocator = std::make_unique<TLSFMemoryAllocator>(
+                    PrevPowerOfTwo(mMaxResourceHeapSize), heapSize, heapAlignment,
+                    std::move(pooledAllocator),
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+                break;
+            case ALLOCATOR_ALGORITHM_LINEAR:
+                poolAllocator = std::make_unique<LinearMemoryAllocator>(
+                    heapSize, heapAlignment, std::move(pooledAllocator));
+                break;
+            default:
+                return E_INVALIDARG;
+        }
 
+        *poolOut = new Pool(this, descriptor, heapSize, std::move(poolAllocator),
+                            pooledAllocatorPtr, resourceHeapAllocatorPtr);
         return S_OK;
     }
 
@@ -828,7 +3371,9 @@ namespace gpgmm { namespace d3d12 {
 
         D3D12_RESOURCE_DESC desc = resource->GetDesc();
         const D3D12_RESOURCE_ALLOCATION_INFO resourceInfo =
-            GetResourceAllocationInfo(mDevice.Get(), desc);
+            GetResourceAllocationInfo(mDevice.Get(), mResourceAllocationInfoCache.get(),
+                                      mAllocationTimer.get(), &mGetResourceAllocationInfoLatency,
+                                      desc);
 
         D3D12_HEAP_PROPERTIES heapProperties;
         ReturnIfFailed(resource->GetHeapProperties(&heapProperties, nullptr));
@@ -837,13 +3382,9 @@ namespace gpgmm { namespace d3d12 {
             resource, GetPreferredMemorySegmentGroup(mDevice.Get(), mIsUMA, heapProperties.Type),
             resourceInfo.SizeInBytes);
 
-        *resourceAllocationOut = new ResourceAllocation{/*residencyManager*/ nullptr,
-                                                        /*allocator*/ this,
-                                                        /*offsetFromHeap*/ kInvalidOffset,
-                                                        /*block*/ nullptr,
-                                                        AllocationMethod::kStandalone,
-                                                        std::move(resource),
-                                                        resourceHeap};
+        *resourceAllocationOut = new (&mResourceAllocationPool) ResourceAllocation{
+            /*residencyManager*/ nullptr, /*allocator*/ this, /*offsetFromHeap*/ kInvalidOffset,
+            /*block*/ nullptr, AllocationMethod::kStandalone, std::move(resource), resourceHeap};
 
         return S_OK;
     }
@@ -854,16 +3395,20 @@ namespace gpgmm { namespace d3d12 {
                                                     const D3D12_CLEAR_VALUE* clearValue,
                                                     D3D12_RESOURCE_STATES initialResourceState,
                                                     ID3D12Resource** placedResourceOut) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceAllocator.CreatePlacedResource");
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreatePlacedResource");
 
         // Before calling CreatePlacedResource, we must ensure the target heap is resident or
         // CreatePlacedResource will fail.
         ComPtr<ID3D12Resource> placedResource;
         {
             ScopedHeapLock scopedHeapLock(mResidencyManager.Get(), resourceHeap);
-            ReturnIfFailed(mDevice->CreatePlacedResource(
+            const uint64_t createStartTicks = mAllocationTimer->GetTicks();
+            const HRESULT hr = mDevice->CreatePlacedResource(
                 resourceHeap->GetHeap(), resourceOffset, resourceDescriptor, initialResourceState,
-                clearValue, IID_PPV_ARGS(&placedResource)));
+                clearValue, IID_PPV_ARGS(&placedResource));
+            RecordDriverLatency(&mCreatePlacedResourceLatency,
+                                "GPU create placed resource latency (us)", createStartTicks);
+            ReturnIfFailed(hr);
         }
 
         *placedResourceOut = placedResource.Detach();
@@ -880,7 +3425,7 @@ namespace gpgmm { namespace d3d12 {
         D3D12_RESOURCE_STATES initialResourceState,
         ID3D12Resource** commitedResourceOut,
         Heap** resourceHeapOut) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceAllocator.CreateCommittedResource");
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateCommittedResource");
 
         // CreateCommittedResource will implicitly make the created resource resident. We must
         // ensure enough free memory exists before allocating to avoid an out-of-memory error when
@@ -899,11 +3444,16 @@ namespace gpgmm { namespace d3d12 {
         // provided to CreateCommittedResource.
         heapFlags &= ~(D3D12_HEAP_FLAG_DENY_NON_RT_DS_TEXTURES |
                        D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES | D3D12_HEAP_FLAG_DENY_BUFFERS);
+        heapFlags |= mHeapCreationFlags;
 
         ComPtr<ID3D12Resource> committedResource;
-        ReturnIfFailed(mDevice->CreateCommittedResource(
+        const uint64_t createStartTicks = mAllocationTimer->GetTicks();
+        const HRESULT hr = mDevice->CreateCommittedResource(
             &heapProperties, heapFlags, resourceDescriptor, initialResourceState, clearValue,
-            IID_PPV_ARGS(&committedResource)));
+            IID_PPV_ARGS(&committedResource));
+        RecordDriverLatency(&mCreateCommittedResourceLatency,
+                            "GPU create committed resource latency (us)", createStartTicks);
+        ReturnIfFailed(hr);
 
         // Since residency is per heap, every committed resource is wrapped in a heap object.
         Heap* resourceHeap = new Heap(committedResource, memorySegmentGroup, resourceSize);
@@ -923,29 +3473,755 @@ namespace gpgmm { namespace d3d12 {
         return S_OK;
     }
 
+    void ResourceAllocator::RecordDriverLatency(LatencyHistogram* latency,
+                                                const char* traceCounterName,
+                                                uint64_t startTicks) {
+        const uint64_t latencyInNanoseconds =
+            mAllocationTimer->TicksToNanoseconds(mAllocationTimer->GetTicks() - startTicks);
+        latency->Record(latencyInNanoseconds);
+        TRACE_COUNTER1(TraceEventCategory::Allocation, traceCounterName,
+                       latencyInNanoseconds / 1000);
+    }
+
     ResidencyManager* ResourceAllocator::GetResidencyManager() const {
         return mResidencyManager.Get();
     }
 
+    void ResourceAllocator::RecordAllocationLatency(const ResourceAllocation* resourceAllocation,
+                                                    uint64_t latencyInNanoseconds) {
+        switch (resourceAllocation->GetMethod()) {
+            case AllocationMethod::kSubAllocated:
+                mSubAllocatedLatency.Record(latencyInNanoseconds);
+                break;
+
+            case AllocationMethod::kSubAllocatedWithin:
+                mSubAllocatedWithinLatency.Record(latencyInNanoseconds);
+                break;
+
+            // Committed resources are the only standalone allocations made by the
+            // ResourceAllocator itself.
+            case AllocationMethod::kStandalone:
+                if (resourceAllocation->GetAllocator() == this) {
+                    mCommittedLatency.Record(latencyInNanoseconds);
+                } else {
+                    mStandaloneLatency.Record(latencyInNanoseconds);
+                }
+                break;
+
+            default:
+                UNREACHABLE();
+                break;
+        }
+    }
+
+    HRESULT ResourceAllocator::GetResidencyPriorityDevice(
+        const ALLOCATION_DESC& allocationDescriptor,
+        ComPtr<ID3D12Device1>* device1Out) const {
+        if (allocationDescriptor.ResidencyPriority != 0 && FAILED(mDevice.As(device1Out))) {
+            return E_INVALIDARG;
+        }
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::SetResidencyPriority(
+        ID3D12Device1* device1,
+        const ALLOCATION_DESC& allocationDescriptor,
+        ResourceAllocation** resourceAllocationInOut) const {
+        if (device1 == nullptr) {
+            return S_OK;
+        }
+
+        Heap* resourceHeap = ToBackend((*resourceAllocationInOut)->GetMemory());
+        const HRESULT hr =
+            resourceHeap->SetResidencyPriority(device1, allocationDescriptor.ResidencyPriority);
+        if (FAILED(hr)) {
+            (*resourceAllocationInOut)->Release();
+            *resourceAllocationInOut = nullptr;
+        }
+        return hr;
+    }
+
+    HRESULT ResourceAllocator::ValidateCreateResource(const ALLOCATION_DESC& allocationDescriptor,
+                                                      ComPtr<ID3D12Device1>* device1Out) const {
+        if (allocationDescriptor.Lifetime > ALLOCATION_LIFETIME_PERSISTENT) {
+            return E_INVALIDARG;
+        }
+        return GetResidencyPriorityDevice(allocationDescriptor, device1Out);
+    }
+
+    HRESULT ResourceAllocator::CompleteCreatedResource(
+        ID3D12Device1* device1,
+        const ALLOCATION_DESC& allocationDescriptor,
+        uint64_t allocationStartTicks,
+        ResourceAllocation** resourceAllocationInOut) {
+        ReturnIfFailed(
+            SetResidencyPriority(device1, allocationDescriptor, resourceAllocationInOut));
+
+        const uint64_t allocationLatencyInNanoseconds =
+            mAllocationTimer->TicksToNanoseconds(mAllocationTimer->GetTicks() -
+                                                 allocationStartTicks);
+        RecordAllocationLatency(*resourceAllocationInOut, allocationLatencyInNanoseconds);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU allocation latency (us)",
+                       allocationLatencyInNanoseconds / 1000);
+
+        TrackTaggedAllocation(*resourceAllocationInOut, allocationDescriptor.Tag);
+
+        return S_OK;
+    }
+
+    void ResourceAllocator::ReportCreatedResources(uint32_t count,
+                                                   ResourceAllocation* const* resourceAllocations,
+                                                   const void* callSite) {
+        ReportAllocatorCounters();
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (resourceAllocations[i] != nullptr) {
+                TrackLiveAllocation(resourceAllocations[i], callSite);
+            }
+        }
+    }
+
+    QUERY_RESOURCE_ALLOCATOR_STATS ResourceAllocator::QueryStats() const {
+        QUERY_RESOURCE_ALLOCATOR_STATS result = {};
+        result.SubAllocatedLatency = mSubAllocatedLatency.QueryInfo();
+        result.SubAllocatedWithinLatency = mSubAllocatedWithinLatency.QueryInfo();
+        result.StandaloneLatency = mStandaloneLatency.QueryInfo();
+        result.CommittedLatency = mCommittedLatency.QueryInfo();
+        result.LockWaitLatency = mLockWaitLatency.QueryInfo();
+        result.CreateHeapLatency = mCreateHeapLatency.QueryInfo();
+        result.CreatePlacedResourceLatency = mCreatePlacedResourceLatency.QueryInfo();
+        result.CreateCommittedResourceLatency = mCreateCommittedResourceLatency.QueryInfo();
+        result.GetResourceAllocationInfoLatency = mGetResourceAllocationInfoLatency.QueryInfo();
+        result.LayerCacheHitCount = mCreateResourceLayerCacheHits.Load();
+        result.LayerCacheMissCount = mCreateResourceLayerCacheMisses.Load();
+        result.AdaptiveCommittedCount = mAdaptiveCommittedCount.Load();
+        result.AdaptivePlacedCount = mAdaptivePlacedCount.Load();
+        return result;
+    }
+
+    ResourceAllocator::CreateResourceLayer ResourceAllocator::LookupCreateResourceLayer(
+        uint32_t layerCacheKey) {
+        const uint64_t entry =
+            mCreateResourceLayerCache[GetCreateResourceLayerCacheIndex(layerCacheKey)].load(
+                std::memory_order_relaxed);
+        if ((entry >> 32) == layerCacheKey &&
+            ((entry >> 8) & 0xFFFFFF) == (GetCreateResourceLayerGeneration() & 0xFFFFFF)) {
+            mCreateResourceLayerCacheHits++;
+            return static_cast<CreateResourceLayer>(entry & 0xFF);
+        }
+
+        mCreateResourceLayerCacheMisses++;
+        return CreateResourceLayer::kSmallTexture;
+    }
+
+    void ResourceAllocator::UpdateCreateResourceLayer(uint32_t layerCacheKey,
+                                                      CreateResourceLayer layer) {
+        const uint64_t entry = (static_cast<uint64_t>(layerCacheKey) << 32) |
+                               ((GetCreateResourceLayerGeneration() & 0xFFFFFF) << 8) |
+                               static_cast<uint64_t>(layer);
+        mCreateResourceLayerCache[GetCreateResourceLayerCacheIndex(layerCacheKey)].store(
+            entry, std::memory_order_relaxed);
+    }
+
+    bool ResourceAllocator::ShouldCreateCommittedResource(size_t resourceHeapTypeIndex,
+                                                          uint64_t sizeInBytes) {
+        CreateResourceCost& cost = mCreateResourceCosts[resourceHeapTypeIndex][Log2(sizeInBytes)];
+        const uint64_t requestCount = cost.RequestCount.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        // Placing is timed first, since it is the default, then committing.
+        if (cost.PlacedCount.load(std::memory_order_relaxed) < kMinCreateResourceCostCount) {
+            return false;
+        }
+        if (cost.CommittedCount.load(std::memory_order_relaxed) < kMinCreateResourceCostCount) {
+            return true;
+        }
+
+        const bool isCommittedCheaper = cost.CommittedLatency.load(std::memory_order_relaxed) <
+                                        cost.PlacedLatency.load(std::memory_order_relaxed);
+        if (requestCount % kCreateResourceCostRemeasurePeriod == 0) {
+            return !isCommittedCheaper;
+        }
+        return isCommittedCheaper;
+    }
+
+    void ResourceAllocator::RecordCreateResourceCost(size_t resourceHeapTypeIndex,
+                                                     uint64_t sizeInBytes,
+                                                     bool isCommitted,
+                                                     uint64_t latencyInNanoseconds) {
+        CreateResourceCost& cost = mCreateResourceCosts[resourceHeapTypeIndex][Log2(sizeInBytes)];
+        std::atomic<uint64_t>& averageLatency =
+            (isCommitted) ? cost.CommittedLatency : cost.PlacedLatency;
+        std::atomic<uint32_t>& count = (isCommitted) ? cost.CommittedCount : cost.PlacedCount;
+
+        const uint32_t previousCount = count.fetch_add(1, std::memory_order_relaxed);
+        averageLatency.store(UpdateAverageLatency(averageLatency.load(std::memory_order_relaxed),
+                                                  previousCount, latencyInNanoseconds),
+                             std::memory_order_relaxed);
+    }
+
+    uint64_t ResourceAllocator::GetCreateResourceLayerGeneration() const {
+        uint64_t generation = mTrimCount.load(std::memory_order_relaxed);
+        if (mResidencyManager != nullptr) {
+            generation += mResidencyManager->mBudgetChangeCount.load(std::memory_order_relaxed);
+        }
+        return generation;
+    }
+
+    QUERY_ALLOCATION_TAG_INFO ResourceAllocator::QueryTagInfo(uint32_t tag) const {
+        QUERY_ALLOCATION_TAG_INFO result = {};
+        if (tag >= kMaxAllocationTagCount) {
+            return result;
+        }
+
+        const AllocationTagCounters& counters = mTagCounters[tag];
+        result.UsedCount = counters.UsedCount.Load();
+        result.UsedSizeInBytes = counters.UsedUsage.Load();
+        result.QuotaInBytes = counters.Quota.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    HRESULT ResourceAllocator::SetTagQuota(uint32_t tag, uint64_t quotaInBytes) {
+        if (tag >= kMaxAllocationTagCount) {
+            return E_INVALIDARG;
+        }
+
+        mTagCounters[tag].Quota.store(quotaInBytes, std::memory_order_relaxed);
+        return S_OK;
+    }
+
+    HRESULT ResourceAllocator::CaptureSnapshot(ALLOCATOR_SNAPSHOT* snapshotOut) const {
+        if (snapshotOut == nullptr) {
+            return E_POINTER;
+        }
+
+        if (mDebugAllocator == nullptr) {
+            return E_FAIL;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CaptureSnapshot");
+
+        // Residency of heaps is updated by the residency manager while locked.
+        std::unique_lock<std::recursive_mutex> residencyLock;
+        if (mResidencyManager != nullptr) {
+            residencyLock = std::unique_lock<std::recursive_mutex>(mResidencyManager->mMutex);
+        }
+
+        ALLOCATOR_SNAPSHOT snapshot = {};
+        mDebugAllocator->ForEachLiveAllocation([&](const ResourceAllocation* allocation) {
+            Heap* resourceHeap = ToBackend(allocation->GetMemory());
+
+            RESOURCE_ALLOCATION_SNAPSHOT allocationSnapshot = {};
+            allocationSnapshot.ResourceHeap = resourceHeap;
+            allocationSnapshot.HeapOffset = allocation->GetOffset();
+            allocationSnapshot.SizeInBytes = allocation->GetSize();
+            allocationSnapshot.Method = allocation->GetMethod();
+            allocationSnapshot.IsResident = resourceHeap->IsResident();
+
+            D3D12_HEAP_PROPERTIES heapProperties = {};
+            ID3D12Resource* resource = allocation->GetResource();
+            if (resource != nullptr &&
+                SUCCEEDED(resource->GetHeapProperties(&heapProperties, nullptr))) {
+                allocationSnapshot.HeapType = heapProperties.Type;
+            }
+
+            for (const Heap::FenceValue& fenceValue : resourceHeap->GetLastUsedFenceValues()) {
+                allocationSnapshot.LastUsedFenceValue =
+                    std::max(allocationSnapshot.LastUsedFenceValue, fenceValue.second);
+            }
+
+            snapshot.SizeInBytes += allocationSnapshot.SizeInBytes;
+            snapshot.Allocations.push_back(allocationSnapshot);
+        });
+
+        std::sort(snapshot.Allocations.begin(), snapshot.Allocations.end(),
+                  [](const RESOURCE_ALLOCATION_SNAPSHOT& a, const RESOURCE_ALLOCATION_SNAPSHOT& b) {
+                      return std::tie(a.ResourceHeap, a.HeapOffset) <
+                             std::tie(b.ResourceHeap, b.HeapOffset);
+                  });
+
+        *snapshotOut = std::move(snapshot);
+        return S_OK;
+    }
+
+    // static
+    ALLOCATOR_SNAPSHOT_DIFF ResourceAllocator::DiffSnapshots(const ALLOCATOR_SNAPSHOT& before,
+                                                             const ALLOCATOR_SNAPSHOT& after) {
+        ALLOCATOR_SNAPSHOT_DIFF diff = {};
+        diff.SizeInBytesDelta =
+            static_cast<int64_t>(after.SizeInBytes) - static_cast<int64_t>(before.SizeInBytes);
+
+        // Both snapshots are ordered the same way, so they are merged in a single pass.
+        auto beforeIt = before.Allocations.begin();
+        auto afterIt = after.Allocations.begin();
+        while (beforeIt != before.Allocations.end() || afterIt != after.Allocations.end()) {
+            if (afterIt == after.Allocations.end() ||
+                (beforeIt != before.Allocations.end() &&
+                 std::tie(beforeIt->ResourceHeap, beforeIt->HeapOffset) <
+                     std::tie(afterIt->ResourceHeap, afterIt->HeapOffset))) {
+                diff.RemovedAllocations.push_back(*beforeIt++);
+            } else if (beforeIt == before.Allocations.end() ||
+                       std::tie(afterIt->ResourceHeap, afterIt->HeapOffset) <
+                           std::tie(beforeIt->ResourceHeap, beforeIt->HeapOffset)) {
+                diff.AddedAllocations.push_back(*afterIt++);
+            } else {
+                // Same allocation, unless re-allocated at the same location with another size.
+                if (beforeIt->SizeInBytes != afterIt->SizeInBytes) {
+                    diff.RemovedAllocations.push_back(*beforeIt);
+                    diff.AddedAllocations.push_back(*afterIt);
+                }
+                beforeIt++;
+                afterIt++;
+            }
+        }
+
+        return diff;
+    }
+
+    HRESULT ResourceAllocator::QueryWarmUpProfile(
+        std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut) const {
+        if (profileOut == nullptr) {
+            return E_POINTER;
+        }
+
+        if (mWarmUpProfileRecorder == nullptr) {
+            return E_FAIL;
+        }
+
+        *profileOut = mWarmUpProfileRecorder->GetProfile();
+        return S_OK;
+    }
+
+    // static
+    HRESULT ResourceAllocator::SaveWarmUpProfile(
+        const std::vector<ALLOCATOR_WARM_UP_DESC>& profile,
+        const std::string& profileFile) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.SaveWarmUpProfile");
+
+        std::ofstream stream(profileFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!stream.is_open()) {
+            gpgmm::WarningLog() << "Unable to open warm-up profile: " << profileFile << "\n";
+            return E_FAIL;
+        }
+
+        return WriteWarmUpProfile(profile, stream) ? S_OK : E_FAIL;
+    }
+
+    // static
+    HRESULT ResourceAllocator::LoadWarmUpProfile(
+        const std::string& profileFile,
+        std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.LoadWarmUpProfile");
+
+        if (profileOut == nullptr) {
+            return E_POINTER;
+        }
+
+        // A missing profile is expected on the first launch.
+        std::ifstream stream(profileFile, std::ios::in | std::ios::binary);
+        if (!stream.is_open()) {
+            gpgmm::DebugLog() << "No warm-up profile to load: " << profileFile << "\n";
+            return E_FAIL;
+        }
+
+        if (!ReadWarmUpProfile(stream, profileOut)) {
+            gpgmm::WarningLog() << "Ignored invalid warm-up profile: " << profileFile << "\n";
+            return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    void ResourceAllocator::ReportLiveAllocationsByCallSite() const {
+#if defined(GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG)
+        mDebugAllocator->ReportLiveAllocationsByCallSite();
+#endif
+    }
+
     QUERY_RESOURCE_ALLOCATOR_INFO ResourceAllocator::QueryInfo() const {
         // ResourceAllocator itself could call CreateCommittedResource directly.
-        QUERY_RESOURCE_ALLOCATOR_INFO result = mInfo;
+        QUERY_RESOURCE_ALLOCATOR_INFO result = MemoryAllocator::QueryInfo();
+
+        for (size_t i = 0; i < kNumOfResourceHeapTypes; i++) {
+            result += QueryInfoOfType(i);
+        }
+
+        return result;
+    }
+
+    QUERY_RESOURCE_ALLOCATOR_INFO ResourceAllocator::QueryInfoOfType(
+        size_t resourceHeapTypeIndex) const {
+        QUERY_RESOURCE_ALLOCATOR_INFO result = {};
+        if (!IsInitializedOfType(resourceHeapTypeIndex)) {
+            return result;
+        }
+
+        const auto AddInfo = [&](const MemoryAllocator* allocator) {
+            if (allocator != nullptr) {
+                result += allocator->QueryInfo();
+            }
+        };
+
+        const size_t i = resourceHeapTypeIndex;
+        AddInfo(mResourceAllocatorOfType[i].get());
+        AddInfo(mBufferAllocatorOfType[i].get());
+        AddInfo(mLargeBufferAllocatorOfType[i].get());
+        AddInfo(mTransientAllocatorOfType[i].get());
+        AddInfo(mAliasedAllocatorOfType[i].get());
+        AddInfo(mSmallTextureAllocatorOfType[i].get());
+        AddInfo(mMSAATextureAllocatorOfType[i].get());
+        AddInfo(mCPUAccessibleAllocatorOfType[i].get());
+        AddInfo(mColdAllocatorOfType[i].get());
+        AddInfo(mTilePageAllocatorOfType[i].get());
+        AddInfo(mResourceHeapAllocatorOfType[i].get());
+
+        // Not a child of the allocators which share it.
+        AddInfo(mSharedResourceHeapAllocatorOfType[i].get());
+        for (const auto& shardResourceHeapAllocator : mShardResourceHeapAllocatorsOfType[i]) {
+            AddInfo(shardResourceHeapAllocator.get());
+        }
+
+        return result;
+    }
+
+    void ResourceAllocator::CollectSharedStats(SHARED_ALLOCATOR_STATS* statsOut) const {
+        const auto AddUsage = [](SHARED_HEAP_TYPE_STATS* stats,
+                                 const QUERY_RESOURCE_ALLOCATOR_INFO& info) {
+            stats->UsedMemoryUsage += info.UsedMemoryUsage;
+            stats->UsedBlockUsage += info.UsedBlockUsage;
+            stats->FreeMemoryUsage += info.FreeMemoryUsage;
+        };
+
+        AddUsage(&statsOut->Committed, MemoryAllocator::QueryInfo());
+
+        for (size_t i = 0; i < kNumOfResourceHeapTypes; i++) {
+            const QUERY_RESOURCE_ALLOCATOR_INFO info = QueryInfoOfType(i);
+            switch (GetHeapType(static_cast<RESOURCE_HEAP_TYPE>(i))) {
+                case D3D12_HEAP_TYPE_DEFAULT:
+                    AddUsage(&statsOut->Default, info);
+                    break;
+                case D3D12_HEAP_TYPE_UPLOAD:
+                    AddUsage(&statsOut->Upload, info);
+                    break;
+                case D3D12_HEAP_TYPE_READBACK:
+                    AddUsage(&statsOut->Readback, info);
+                    break;
+                default:
+                    AddUsage(&statsOut->GPUUpload, info);
+                    break;
+            }
+        }
+
+        if (mResidencyManager != nullptr) {
+            const DXGI_QUERY_VIDEO_MEMORY_INFO localInfo =
+                mResidencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+            statsOut->LocalBudget = localInfo.Budget;
+            statsOut->LocalUsage = localInfo.CurrentUsage;
+
+            const DXGI_QUERY_VIDEO_MEMORY_INFO nonLocalInfo =
+                mResidencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL);
+            statsOut->NonLocalBudget = nonLocalInfo.Budget;
+            statsOut->NonLocalUsage = nonLocalInfo.CurrentUsage;
+
+            const RESIDENCY_PAGING_STATS pagingStats = mResidencyManager->QueryStats().Total;
+            statsOut->MadeResidentCount = pagingStats.MadeResidentCount;
+            statsOut->MadeResidentSizeInBytes = pagingStats.MadeResidentSizeInBytes;
+            statsOut->EvictedCount = pagingStats.EvictedCount;
+            statsOut->EvictedSizeInBytes = pagingStats.EvictedSizeInBytes;
+        }
+
+        const QUERY_RESOURCE_ALLOCATOR_STATS latencyStats = QueryStats();
+        statsOut->SubAllocatedLatency = latencyStats.SubAllocatedLatency;
+        statsOut->SubAllocatedWithinLatency = latencyStats.SubAllocatedWithinLatency;
+        statsOut->StandaloneLatency = latencyStats.StandaloneLatency;
+        statsOut->CommittedLatency = latencyStats.CommittedLatency;
+    }
+
+    // static
+    HRESULT ResourceAllocator::ReadSharedStats(const std::string& name,
+                                               SHARED_ALLOCATOR_STATS* statsOut) {
+        return d3d12::ReadSharedStats(name, statsOut);
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO ResourceAllocator::QueryFragmentationInfo() const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = MemoryAllocator::QueryFragmentationInfo();
+
+        const auto AddFragmentation = [&](const MemoryAllocator* allocator) {
+            if (allocator == nullptr) {
+                return;
+            }
+            for (const MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO& layer :
+                 allocator->QueryFragmentation()) {
+                result += layer.Info;
+            }
+        };
 
-        for (const auto& allocator : mResourceAllocatorOfType) {
-            result += allocator->QueryInfo();
+        for (size_t i = 0; i < kNumOfResourceHeapTypes; i++) {
+            if (!IsInitializedOfType(i)) {
+                continue;
+            }
+
+            AddFragmentation(mResourceAllocatorOfType[i].get());
+            AddFragmentation(mBufferAllocatorOfType[i].get());
+            AddFragmentation(mLargeBufferAllocatorOfType[i].get());
+            AddFragmentation(mTransientAllocatorOfType[i].get());
+            AddFragmentation(mAliasedAllocatorOfType[i].get());
+            AddFragmentation(mSmallTextureAllocatorOfType[i].get());
+            AddFragmentation(mMSAATextureAllocatorOfType[i].get());
+            AddFragmentation(mCPUAccessibleAllocatorOfType[i].get());
+            AddFragmentation(mColdAllocatorOfType[i].get());
+            AddFragmentation(mTilePageAllocatorOfType[i].get());
+            AddFragmentation(mResourceHeapAllocatorOfType[i].get());
+            AddFragmentation(mSharedResourceHeapAllocatorOfType[i].get());
+            for (const auto& shardResourceHeapAllocator : mShardResourceHeapAllocatorsOfType[i]) {
+                AddFragmentation(shardResourceHeapAllocator.get());
+            }
         }
 
-        for (const auto& allocator : mBufferAllocatorOfType) {
-            result += allocator->QueryInfo();
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory wasted by blocks (MBytes)",
+                       result.InternalFragmentationUsage / 1e6);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory free in blocks (MBytes)",
+                       result.FreeBlockUsage / 1e6);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory fragmented (%)",
+                       result.GetExternalFragmentation() * 100);
+
+        TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU memory pooled (MBytes)",
+                       result.PooledMemoryUsage / 1e6);
+
+        return result;
+    }
+
+    MEMORY_ALLOCATOR_FRAGMENTATION_INFO ResourceAllocator::QueryFragmentationInfo(
+        ALLOCATION_LIFETIME lifetime) const {
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO result = {};
+        if (lifetime > ALLOCATION_LIFETIME_PERSISTENT) {
+            return result;
         }
 
-        for (const auto& allocator : mResourceHeapAllocatorOfType) {
-            result += allocator->QueryInfo();
+        for (size_t i = 0; i < kNumOfResourceHeapTypes; i++) {
+            if (IsInitializedOfType(i)) {
+                result += mResourceAllocatorOfType[i]->QueryFragmentationInfo(
+                    static_cast<MemoryAllocationLifetime>(lifetime));
+            }
         }
 
         return result;
     }
 
+    uint64_t ResourceAllocator::GetPreferredResourceHeapSize(const ALLOCATOR_DESC& descriptor,
+                                                             D3D12_HEAP_TYPE heapType) const {
+        if (descriptor.PreferredResourceHeapSize > 0) {
+            return descriptor.PreferredResourceHeapSize;
+        }
+
+        return std::min(mCaps->GetPreferredResourceHeapSize(heapType),
+                        PrevPowerOfTwo(mMaxResourceHeapSize));
+    }
+
+    uint64_t ResourceAllocator::GetMaxResourceHeapSizeForBudget(D3D12_HEAP_TYPE heapType) const {
+        if (!(mDescriptor.Flags & ALLOCATOR_FLAG_BUDGET_ADAPTIVE_HEAP_SIZE) ||
+            mResidencyManager == nullptr) {
+            return 0;
+        }
+
+        // The cached budget is used so allocating never queries the OS.
+        const DXGI_QUERY_VIDEO_MEMORY_INFO videoMemoryInfo =
+            mResidencyManager->GetVideoMemoryInfo(
+                GetPreferredMemorySegmentGroup(mDevice.Get(), mIsUMA, heapType));
+
+        const uint64_t budgetRemaining =
+            (videoMemoryInfo.Budget > videoMemoryInfo.CurrentUsage)
+                ? videoMemoryInfo.Budget - videoMemoryInfo.CurrentUsage
+                : 0;
+
+        // Over budget, every new resource heap exceeds the limit.
+        return std::max(budgetRemaining / kBudgetRemainingDivisorForResourceHeap, uint64_t{1});
+    }
+
+    HeapUsageBudget* ResourceAllocator::GetHeapTypeBudget(D3D12_HEAP_TYPE heapType) const {
+        const size_t heapTypeIndex = static_cast<size_t>(heapType);
+        if (heapTypeIndex >= kNumOfHeapTypes) {
+            return nullptr;
+        }
+        return mHeapTypeBudgets[heapTypeIndex].get();
+    }
+
+    void ResourceAllocator::ReleasePooledMemoryOverHeapTypeBudget(D3D12_HEAP_TYPE heapType,
+                                                                  uint64_t size) {
+        HeapUsageBudget* heapTypeBudget = GetHeapTypeBudget(heapType);
+        if (heapTypeBudget == nullptr ||
+            heapTypeBudget->GetUsage() + size <= heapTypeBudget->GetMaxUsage()) {
+            return;
+        }
+
+        TRACE_EVENT0(TraceEventCategory::Allocation,
+                     "ResourceAllocator.ReleasePooledMemoryOverHeapTypeBudget");
+
+        for (uint32_t resourceHeapTypeIndex = 0; resourceHeapTypeIndex < kNumOfResourceHeapTypes;
+             resourceHeapTypeIndex++) {
+            if (IsInitializedOfType(resourceHeapTypeIndex) &&
+                GetHeapType(static_cast<RESOURCE_HEAP_TYPE>(resourceHeapTypeIndex)) == heapType) {
+                TrimOfType(resourceHeapTypeIndex);
+            }
+        }
+    }
+
+    MemoryAllocator* ResourceAllocator::GetSubAllocatorOfType(size_t resourceHeapTypeIndex,
+                                                              uint64_t alignment) const {
+        if (alignment == D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT &&
+            mMSAATextureAllocatorOfType[resourceHeapTypeIndex] != nullptr) {
+            return mMSAATextureAllocatorOfType[resourceHeapTypeIndex].get();
+        }
+        return mResourceAllocatorOfType[resourceHeapTypeIndex].get();
+    }
+
+    bool ResourceAllocator::IsHeapTypeSupported(D3D12_HEAP_TYPE heapType) const {
+        return heapType != kHeapTypeGPUUpload || mCaps->IsGPUUploadHeapSupported();
+    }
+
+    std::unique_ptr<MemoryAllocator> ResourceAllocator::CreateResourceHeapAllocator(
+        const ALLOCATOR_DESC& descriptor,
+        D3D12_HEAP_TYPE heapType,
+        D3D12_HEAP_FLAGS heapFlags,
+        uint64_t heapAlignment,
+        uint64_t reservedResourceHeapCount,
+        D3D12_RESIDENCY_PRIORITY residencyPriority,
+        const D3D12_HEAP_PROPERTIES* heapProperties) {
+        // Heaps of other properties or residency priority cannot be re-used by the shared pool.
+        if (mResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2 &&
+            heapFlags == D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES &&
+            residencyPriority == 0 && heapProperties == nullptr) {
+            const RESOURCE_HEAP_TYPE resourceHeapType = GetResourceHeapType(
+                D3D12_RESOURCE_DIMENSION_BUFFER, heapType, D3D12_RESOURCE_FLAG_NONE,
+                mResourceHeapTier);
+            MemoryAllocator* sharedResourceHeapAllocator =
+                mSharedResourceHeapAllocatorOfType[static_cast<size_t>(resourceHeapType)].get();
+            if (sharedResourceHeapAllocator != nullptr) {
+                return std::make_unique<SharedMemoryAllocator>(sharedResourceHeapAllocator);
+            }
+        }
+
+        std::unique_ptr<MemoryAllocator> resourceHeapAllocator;
+        if (heapProperties != nullptr) {
+            resourceHeapAllocator = std::make_unique<ResourceHeapAllocator>(
+                mResidencyManager.Get(), mDevice.Get(), *heapProperties,
+                heapFlags | mHeapCreationFlags, mIsUMA, mIsAlwaysInBudget, mReleaseInBackground,
+                &mResourceHeapUsage, GetHeapTypeBudget(heapType), &mCreateHeapLatency,
+                residencyPriority);
+        } else {
+            resourceHeapAllocator = std::make_unique<ResourceHeapAllocator>(
+                mResidencyManager.Get(), mDevice.Get(), heapType, heapFlags | mHeapCreationFlags,
+                mIsUMA, mIsAlwaysInBudget, mReleaseInBackground, &mResourceHeapUsage,
+                GetHeapTypeBudget(heapType), &mCreateHeapLatency, residencyPriority);
+        }
+
+        if (descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND) {
+            return resourceHeapAllocator;
+        }
+
+        return std::make_unique<SegmentedMemoryAllocator>(
+            std::move(resourceHeapAllocator), heapAlignment,
+            GetPreferredResourceHeapSize(descriptor, heapType), reservedResourceHeapCount,
+            descriptor.PooledResourceHeapWasteLimit,
+            GetMaxPoolSize(descriptor.MaxPooledResourceHeapUsagePerSize),
+            GetMaxPoolSize(descriptor.MaxPooledResourceHeapUsage),
+            descriptor.PooledResourceHeapPeakWindow);
+    }
+
+    std::unique_ptr<MemoryAllocator> ResourceAllocator::CreateGeneralPurposeAllocator(
+        const ALLOCATOR_DESC& descriptor,
+        D3D12_HEAP_TYPE heapType,
+        D3D12_HEAP_FLAGS heapFlags,
+        uint64_t heapAlignment,
+        MemoryAllocator* resourceHeapAllocator) {
+        if (descriptor.SizeClasses.empty()) {
+            return CreateSubAllocator(descriptor, ALLOCATOR_ALGORITHM_SLAB, heapType, heapFlags,
+                                      heapAlignment, resourceHeapAllocator);
+        }
+
+        // The last size class has no max size, it allocates every size larger.
+        std::vector<std::unique_ptr<MemoryAllocator>> sizeClassAllocators;
+        std::vector<uint64_t> maxSizeClassSizes;
+        for (const ALLOCATOR_SIZE_CLASS_DESC& sizeClass : descriptor.SizeClasses) {
+            sizeClassAllocators.push_back(CreateSubAllocator(descriptor, sizeClass.Algorithm,
+                                                             heapType, heapFlags, heapAlignment,
+                                                             resourceHeapAllocator));
+            maxSizeClassSizes.push_back(sizeClass.MaxSizeInBytes);
+        }
+        maxSizeClassSizes.pop_back();
+
+        return std::make_unique<ConditionalMemoryAllocator>(std::move(sizeClassAllocators),
+                                                            std::move(maxSizeClassSizes));
+    }
+
+    std::unique_ptr<MemoryAllocator> ResourceAllocator::CreateSubAllocator(
+        const ALLOCATOR_DESC& descriptor,
+        ALLOCATOR_ALGORITHM algorithm,
+        D3D12_HEAP_TYPE heapType,
+        D3D12_HEAP_FLAGS heapFlags,
+        uint64_t heapAlignment,
+        MemoryAllocator* resourceHeapAllocator) {
+        const uint64_t preferredResourceHeapSize =
+            GetPreferredResourceHeapSize(descriptor, heapType);
+
+        // Slabs are sub-allocated from resource heaps by another algorithm.
+        if (algorithm == ALLOCATOR_ALGORITHM_SLAB) {
+            std::unique_ptr<MemoryAllocator> subAllocator = CreateSubAllocator(
+                descriptor,
+                (descriptor.Flags & ALLOCATOR_FLAG_USE_TLSF) ? ALLOCATOR_ALGORITHM_TLSF
+                                                             : ALLOCATOR_ALGORITHM_BUDDY_SYSTEM,
+                heapType, heapFlags, heapAlignment, resourceHeapAllocator);
+
+            // Slab size adapts to the allocation rate, starting from the preferred heap size.
+            return std::make_unique<SlabCacheAllocator>(
+                /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*maxSlabSize*/ PrevPowerOfTwo(mMaxResourceHeapSize),
+                /*slabSize*/ preferredResourceHeapSize,
+                /*slabAlignment*/ heapAlignment,
+                /*slabFragmentationLimit*/ descriptor.ResourceFragmentationLimit,
+                /*enablePrefetch*/ !(descriptor.Flags & ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH),
+                std::move(subAllocator), /*adaptSlabSize*/ true, GetMaxEmptySlabCount(descriptor),
+                /*predictSlab*/ (descriptor.Flags & ALLOCATOR_FLAG_PREFETCH_PREDICTED_MEMORY) &&
+                    !(descriptor.Flags & ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH));
+        }
+
+        // Only sub-allocators use resource heaps of the preferred size, which can be reserved.
+        const uint64_t reservedResourceHeapCount =
+            (algorithm != ALLOCATOR_ALGORITHM_DEDICATED && !mIsAlwaysCommitted)
+                ? descriptor.ReservedResourceHeapCount
+                : 0;
+
+        std::unique_ptr<MemoryAllocator> pooledOrNonPooledAllocator;
+        if (resourceHeapAllocator != nullptr) {
+            pooledOrNonPooledAllocator =
+                std::make_unique<SharedMemoryAllocator>(resourceHeapAllocator);
+        } else {
+            pooledOrNonPooledAllocator = CreateResourceHeapAllocator(
+                descriptor, heapType, heapFlags, heapAlignment, reservedResourceHeapCount);
+        }
+
+        switch (algorithm) {
+            case ALLOCATOR_ALGORITHM_BUDDY_SYSTEM:
+                return std::make_unique<BuddyMemoryAllocator>(
+                    PrevPowerOfTwo(mMaxResourceHeapSize), preferredResourceHeapSize, heapAlignment,
+                    std::move(pooledOrNonPooledAllocator),
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+            case ALLOCATOR_ALGORITHM_TLSF:
+                return std::make_unique<TLSFMemoryAllocator>(
+                    PrevPowerOfTwo(mMaxResourceHeapSize), preferredResourceHeapSize, heapAlignment,
+                    std::move(pooledOrNonPooledAllocator),
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+            case ALLOCATOR_ALGORITHM_DEDICATED:
+                return std::make_unique<StandaloneMemoryAllocator>(
+                    std::move(pooledOrNonPooledAllocator));
+            default:
+                UNREACHABLE();
+                return nullptr;
+        }
+    }
+
     // Returns E_FAIL if a device leak is detected.
     HRESULT ResourceAllocator::ReportLiveDeviceObjects() const {
         // Debug layer was never enabled.
@@ -988,13 +4264,53 @@ namespace gpgmm { namespace d3d12 {
     }
 
     void ResourceAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceAllocator.DeallocateMemory");
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.DeallocateMemory");
+
+        // Reserved resources own the page of every tile still mapped. The counts are checked
+        // first so freeing other allocations does not lock or look them up.
+        if (mReservedResourceCount.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(mReservedResourcesMutex);
+            auto it = mReservedResources.find(allocation.get());
+            if (it != mReservedResources.end()) {
+                ReservedResourceTiles* tiles = it->second.get();
+                MemoryAllocator* allocator =
+                    mTilePageAllocatorOfType[tiles->ResourceHeapTypeIndex].get();
+                for (auto& mappedTile : tiles->MappedTiles) {
+                    if (mResidencyManager != nullptr) {
+                        mResidencyManager->UnlockHeap(ToBackend(mappedTile.second->GetMemory()));
+                    }
+                    std::lock_guard<std::mutex> heapTypeLock(
+                        mMutexOfType[tiles->ResourceHeapTypeIndex]);
+                    allocator->DeallocateMemory(std::move(mappedTile.second));
+                }
+                mReservedResources.erase(it);
+                mReservedResourceCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
 
-        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCommittedResourceBudgetCount.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(mCommittedResourceBudgetsMutex);
+            auto it = mCommittedResourceBudgets.find(allocation.get());
+            if (it != mCommittedResourceBudgets.end()) {
+                it->second->Subtract(allocation->GetSize());
+                mCommittedResourceBudgets.erase(it);
+                mCommittedResourceBudgetCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
 
         mInfo.UsedMemoryUsage -= allocation->GetSize();
         mInfo.UsedMemoryCount--;
+
+        ComPtr<ID3D12Pageable> pageable;
+        if (mReleaseInBackground) {
+            pageable = ToBackend(allocation->GetMemory())->GetPageable();
+        }
+
         SafeRelease(allocation);
+
+        if (pageable != nullptr) {
+            ReleaseInBackground(mThreadPool, std::move(pageable));
+        }
     }
 
 }}  // namespace gpgmm::d3d12
@@ -16,28 +16,49 @@
 #ifndef GPGMM_D3D12_RESOURCEALLOCATORD3D12_H_
 #define GPGMM_D3D12_RESOURCEALLOCATORD3D12_H_
 
+#include "gpgmm/LatencyHistogram.h"
 #include "gpgmm/MemoryAllocator.h"
 #include "gpgmm/common/Flags.h"
 #include "gpgmm/d3d12/IUnknownImplD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocationD3D12.h"
 #include "include/gpgmm_export.h"
 
 #include <array>
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace gpgmm {
+    class AliasedMemoryAllocator;
+    class LifetimeMemoryAllocator;
     class MemoryAllocator;
     class PlatformTime;
+    class RingMemoryAllocator;
 }  // namespace gpgmm
 
 namespace gpgmm { namespace d3d12 {
 
+    class AllocatorGroup;
     class BufferAllocator;
     class Caps;
+    struct ReservedResourceTiles;
+    class CreateResourceTask;
     class Heap;
+    class HeapUsageBudget;
     class DebugResourceAllocator;
+    class Pool;
     class ResidencyManager;
     class ResourceAllocation;
+    class ResourceAllocationInfoCache;
+    class SharedStatsPublisher;
+    class WarmUpProfileRecorder;
+    struct POOL_DESC;
 
     enum ALLOCATOR_FLAGS {
 
@@ -59,6 +80,78 @@ namespace gpgmm { namespace d3d12 {
         // and not recommended for general use but may be useful for running with the minimal
         // possible GPU memory footprint or debugging OOM failures.
         ALLOCATOR_FLAG_ALWAYS_ON_DEMAND = 0x8,
+
+        // Evicts heaps on a background thread once the GPU is done using them, instead of
+        // stalling the calling thread when over budget. Only heaps which are no longer used by the
+        // GPU are evicted inline, so resources could be made resident while briefly over budget.
+        ALLOCATOR_FLAG_EVICT_IN_BACKGROUND = 0x10,
+
+        // Pre-creates the resource heaps given by |ALLOCATOR_DESC::WarmUpProfile| on a background
+        // thread instead of by CreateAllocator. Resources created before warm-up completes
+        // allocate heaps on-demand like usual.
+        ALLOCATOR_FLAG_WARM_UP_IN_BACKGROUND = 0x20,
+
+        // Sub-allocates resource heaps using two-level segregated fit (TLSF) instead of the buddy
+        // system. Resources are not rounded up to a power-of-two size, which wastes less memory
+        // when resource sizes vary, but freed blocks are less likely to be re-used as-is.
+        ALLOCATOR_FLAG_USE_TLSF = 0x40,
+
+        // Places the buffers which other buffers are sub-allocated within in pooled resource
+        // heaps, instead of creating committed resources. Creating a placed resource is faster
+        // and the resource heap of a released buffer is re-used unless trimmed.
+        ALLOCATOR_FLAG_USE_PLACED_BUFFERS = 0x80,
+
+        // Releases resource heaps and committed resources using a background thread once
+        // deallocated, such as by Trim(), instead of the calling thread. Drivers could take
+        // milliseconds to free the memory, which would otherwise stall the app.
+        ALLOCATOR_FLAG_RELEASE_IN_BACKGROUND = 0x100,
+
+        // Tracks every live resource allocation so ResourceAllocator::CaptureSnapshot can report
+        // them. Always enabled when built with GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG.
+        ALLOCATOR_FLAG_TRACK_LIVE_ALLOCATIONS = 0x200,
+
+        // Creates resource heaps and committed resources without zeroing their memory, which makes
+        // creating them faster. Resources must be fully written before being read, such as render
+        // targets or transient data, since their contents are undefined. Ignored unless the device
+        // supports D3D12_HEAP_FLAG_CREATE_NOT_ZEROED, which requires ID3D12Device8.
+        ALLOCATOR_FLAG_CREATE_NOT_ZEROED = 0x400,
+
+        // Offers pooled resource heaps back to the OS once usage nears the budget, instead of
+        // only once over budget. Offered heaps are evicted but stay in their pool, so re-using one
+        // costs making it resident again instead of creating a new heap, and they are counted by
+        // ResidencyManager::GetOfferedUsage. D3D12 has no offer and reclaim of its own, so heaps
+        // are offered with ID3D12Device::Evict and reclaimed when made resident.
+        ALLOCATOR_FLAG_OFFER_POOLED_HEAPS = 0x800,
+
+        // Records the most resources sub-allocated of each size which existed at once, so
+        // ResourceAllocator::QueryWarmUpProfile can return a warm-up profile learned from the
+        // app, to be saved on shutdown and used by the next launch.
+        ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE = 0x1000,
+
+        // Sizes new resource heaps of sub-allocated resources by the budget remaining, as last
+        // updated by the residency manager, instead of always using the preferred resource heap
+        // size. Slabs shrink down to a single resource, and resources which no longer fit a
+        // resource heap of the preferred size get their own resource heap, so nearing the budget
+        // does not create large resource heaps which force evictions. Ignored without a residency
+        // manager.
+        ALLOCATOR_FLAG_BUDGET_ADAPTIVE_HEAP_SIZE = 0x2000,
+
+        // Learns which resource sizes follow which, per resource heap type, and prefetches a
+        // resource heap for the size predicted to come next should it need one. Suited to apps
+        // which repeat the same sequence of allocations, ex. each level load. How often the size
+        // was predicted is counted by PredictedSizeHitCount and PredictedSizeMissCount. Has no
+        // effect with ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH.
+        ALLOCATOR_FLAG_PREFETCH_PREDICTED_MEMORY = 0x4000,
+
+        // Times creating resources by placing them in resource heaps and by committing them, per
+        // resource heap type and power-of-two size class, then creates the next resources the
+        // way measured cheapest. Driver costs of CreatePlacedResource, CreateHeap and
+        // CreateCommittedResource differ by vendor. Committed resources are only picked when
+        // aligning them wastes at most ALLOCATOR_DESC::ResourceFragmentationLimit of the
+        // resource size, and the way not picked is re-measured once in a while. Decisions are
+        // counted by AdaptiveCommittedCount and AdaptivePlacedCount. Has no effect with
+        // ALLOCATOR_FLAG_ALWAYS_COMMITED.
+        ALLOCATOR_FLAG_ADAPTIVE_COMMITTED = 0x8000,
     };
 
     using ALLOCATOR_FLAGS_TYPE = Flags<ALLOCATOR_FLAGS>;
@@ -106,6 +199,94 @@ namespace gpgmm { namespace d3d12 {
 
         // Path to trace file. Default is trace.json.
         std::string TraceFile;
+
+        // Streams the trace to disk, while recording, using a compact binary format instead of
+        // writing JSON once recording ends. Use ConvertBinaryEventTraceFileToJSON to view it.
+        //
+        // Optional parameter. By default, the trace is written as JSON.
+        bool UseBinaryTraceFormat = false;
+
+        // Keeps only the events recorded within this many seconds, in memory, and only writes
+        // them to the trace file once DumpEventTraceToDisk is called (ex. when a frame-time
+        // spike is detected). Allows recording to always be enabled.
+        //
+        // Optional parameter. By default, every event is recorded.
+        double FlightRecorderDurationInSeconds = 0;
+
+        // Records only 1 in this many CreateResource calls, along with the resource allocation
+        // each created and its release. Counters and resource heaps are still recorded for every
+        // call. Keeps the cost of recording API calls low enough to always be enabled, while
+        // replaying the trace still gives representative statistics.
+        //
+        // Optional parameter. By default (0 or 1), every call is recorded.
+        uint32_t CallSampleRate = 0;
+    };
+
+    // Describes the number of resource allocations of the same size expected to exist at once,
+    // so resource heaps for them can be created up front.
+    struct ALLOCATOR_WARM_UP_DESC {
+        // Heap type of the resources.
+        D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+        // Dimension and flags of the resources. Only used to determine which resource heaps
+        // the resources can be placed in when |ALLOCATOR_DESC::ResourceHeapTier| is 1.
+        D3D12_RESOURCE_DIMENSION Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        D3D12_RESOURCE_FLAGS ResourceFlags = D3D12_RESOURCE_FLAG_NONE;
+
+        // Size and alignment of each resource allocation, as given by
+        // ID3D12Device::GetResourceAllocationInfo.
+        uint64_t SizeInBytes = 0;
+        uint64_t Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+        // Number of resource allocations.
+        uint64_t Count = 0;
+    };
+
+    // Algorithm used to allocate the resources of a size class.
+    enum ALLOCATOR_ALGORITHM {
+        // Sub-allocates resources from slabs of same-sized blocks, themselves sub-allocated from
+        // resource heaps. Best suited for many small resources of the same size.
+        ALLOCATOR_ALGORITHM_SLAB = 0x0,
+
+        // Sub-allocates resources from resource heaps using the buddy system, where every
+        // resource is rounded up to a power-of-two size.
+        ALLOCATOR_ALGORITHM_BUDDY_SYSTEM = 0x1,
+
+        // Sub-allocates resources from resource heaps using two-level segregated fit (TLSF),
+        // where resources are not rounded up to a power-of-two size.
+        ALLOCATOR_ALGORITHM_TLSF = 0x2,
+
+        // Places every resource in its own resource heap. Best suited for huge resources, which
+        // would otherwise leave most of a shared resource heap unused.
+        ALLOCATOR_ALGORITHM_DEDICATED = 0x3,
+
+        // Places resources one after another in resource heaps, which are only re-used once
+        // Pool::Reset is called. Best suited for per-frame resources which are all released
+        // together. Only supported by pools.
+        ALLOCATOR_ALGORITHM_LINEAR = 0x4,
+    };
+
+    // Describes which algorithm allocates resources up to a size.
+    struct ALLOCATOR_SIZE_CLASS_DESC {
+        // Largest resource allocation size of the size class, in bytes. Resources larger than
+        // the previous size class, but not larger than this size, belong to this size class.
+        uint64_t MaxSizeInBytes = 0;
+
+        // Algorithm used to allocate the resources of the size class.
+        ALLOCATOR_ALGORITHM Algorithm = ALLOCATOR_ALGORITHM_SLAB;
+    };
+
+    // Limits the memory of resources of a heap type, so bursts of one heap type (ex. upload or
+    // readback staging) cannot take the budget of the others (ex. render targets).
+    struct ALLOCATOR_HEAP_TYPE_BUDGET_DESC {
+        // Heap type of the resources. Resources made CPU-accessible by
+        // ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE count as D3D12_HEAP_TYPE_DEFAULT.
+        D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        // Maximum size (in bytes) of the resource heaps, pooled or not, and committed resources
+        // of the heap type. Pooled resource heaps of the heap type are released before a resource
+        // which would exceed it fails to be created with E_OUTOFMEMORY.
+        uint64_t MaxUsage = 0;
     };
 
     struct ALLOCATOR_DESC {
@@ -168,6 +349,18 @@ namespace gpgmm { namespace d3d12 {
         // Optional parameter. When 0 is specified, the API will automatically disabling pooling.
         uint64_t MaxResourceSizeForPooling;
 
+        // Maximum resource size that can be sub-allocated.
+        //
+        // Larger resources skip every sub-allocator and are placed in their own resource heap,
+        // rather than each sub-allocator failing to allocate them first. Best suited for huge
+        // resources, like large render targets, which would leave most of a shared resource heap
+        // unused.
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the max
+        // resource size for sub-allocation to the largest size a sub-allocator can allocate,
+        // which is the max resource heap size rounded down to a power-of-two.
+        uint64_t MaxResourceSizeForSubAllocation;
+
         // Maximum video memory available to budget by the allocator, expressed as a
         // percentage.
         //
@@ -187,6 +380,27 @@ namespace gpgmm { namespace d3d12 {
         // evict size to 50MB.
         uint64_t VideoMemoryEvictSize;
 
+        // Decides which heaps are evicted first to stay within budget.
+        //
+        // Optional parameter. By default, the least recently used heaps are evicted first.
+        EVICTION_POLICY EvictionPolicy = EVICTION_POLICY_LRU;
+
+        // Number of previous submissions, per queue, used to predict which heaps the next
+        // submission will use. Every heap used by the submission this many submissions before the
+        // next is made resident ahead of time, if it fits within the budget, so paging overlaps
+        // with the GPU work already submitted. For example, the number of submissions per frame.
+        //
+        // Optional parameter. By default, heaps are only made resident once used.
+        uint32_t ResidencyPredictionSubmissionCount = 0;
+
+        // Number of previous submissions whose peak video memory usage is reserved from the OS,
+        // per memory segment, so the OS is less likely to reduce the budget below the working set
+        // when other processes need memory. The reservation follows the peak as older submissions
+        // leave the window.
+        //
+        // Optional parameter. By default, no video memory is reserved from the OS.
+        uint32_t VideoMemoryReservationSubmissionCount = 0;
+
         // Resource fragmentation limit, expressed as a percentage of the resource heap size, that
         // is acceptable to be wasted due to internal fragmentation.
         //
@@ -201,6 +415,129 @@ namespace gpgmm { namespace d3d12 {
         // Optional parameter. When 0 is specified, the API will automatically set the resource
         // fragmentation limit to 1/8th the resource heap size.
         double ResourceFragmentationLimit;
+
+        // Resource allocations to create resource heaps for, ahead of time, so the cost is paid
+        // by CreateAllocator rather than by the first requests. The profile is typically the one
+        // recorded by a previous launch, see ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE, or derived
+        // from the resource sizes seen in a previously captured trace.
+        //
+        // Optional parameter. Has no effect when resource heaps are not pooled, for example with
+        // ALLOCATOR_FLAG_ALWAYS_ON_DEMAND or ALLOCATOR_FLAG_ALWAYS_COMMITED.
+        std::vector<ALLOCATOR_WARM_UP_DESC> WarmUpProfile;
+
+        // Number of empty resource heaps, of |PreferredResourceHeapSize|, kept created ahead of
+        // demand per resource heap type, so sub-allocating a resource rarely waits on creating a
+        // resource heap. Resource heaps are created in the background and only while within
+        // budget. Like any pooled resource heap, they are evicted first under memory pressure and
+        // released by Trim().
+        //
+        // Optional parameter. When 0 is specified, resource heaps are only created on demand. Has
+        // no effect with ALLOCATOR_FLAG_ALWAYS_ON_DEMAND or ALLOCATOR_FLAG_ALWAYS_COMMITED.
+        uint32_t ReservedResourceHeapCount = 0;
+
+        // Fraction of a larger pooled resource heap which may go unused when a resource heap of
+        // the size requested is not pooled, rather than creating a new resource heap. For example,
+        // 0.5 lets a 8MB resource heap request re-use a pooled 16MB resource heap. Trades memory
+        // for fewer resource heap creations; see MEMORY_ALLOCATOR_INFO::BestFitWastedUsage.
+        //
+        // Optional parameter. When 0 is specified, only resource heaps of the same size are
+        // re-used. Has no effect with ALLOCATOR_FLAG_ALWAYS_ON_DEMAND.
+        double PooledResourceHeapWasteLimit = 0;
+
+        // Maximum size (in bytes) of free resource heaps kept pooled, per resource heap type, in
+        // total and per resource heap size. A resource heap freed once the pool is full gets
+        // released instead, in the background with ALLOCATOR_FLAG_RELEASE_IN_BACKGROUND.
+        //
+        // Optional parameters. When 0 is specified, the pools are only limited by the budget and
+        // released by Trim(). Have no effect with ALLOCATOR_FLAG_ALWAYS_ON_DEMAND.
+        uint64_t MaxPooledResourceHeapUsage = 0;
+        uint64_t MaxPooledResourceHeapUsagePerSize = 0;
+
+        // Number of resource heaps freed over which peak demand is tracked, per resource heap
+        // type. Free resource heaps are only kept pooled so long as the peak demand of the last
+        // one to two such windows could re-use them, so the pool shrinks back after a spike
+        // without calling Trim().
+        //
+        // Optional parameter. When 0 is specified, the pool never shrinks by itself. Has no
+        // effect with ALLOCATOR_FLAG_ALWAYS_ON_DEMAND.
+        uint32_t PooledResourceHeapPeakWindow = 0;
+
+        // Memory limits of each heap type, in addition to the budget, which applies to every heap
+        // type of the same memory segment. At most one per heap type, of D3D12_HEAP_TYPE_DEFAULT,
+        // D3D12_HEAP_TYPE_UPLOAD, D3D12_HEAP_TYPE_READBACK or D3D12_HEAP_TYPE_GPU_UPLOAD.
+        //
+        // Optional parameter. When empty, the memory of each heap type is only limited by the
+        // budget.
+        std::vector<ALLOCATOR_HEAP_TYPE_BUDGET_DESC> HeapTypeBudgets;
+
+        // Size of the upload buffer which ALLOCATION_FLAG_TRANSIENT allocations are made from.
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the transient
+        // buffer size to the default value of 4MB.
+        uint64_t TransientBufferSize;
+
+        // Size of the buffer which buffers of 64KB or larger are sub-allocated within, when
+        // created with ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE. Such buffers otherwise
+        // each need their own placed resource. As many buffers of this size are created per heap
+        // type as needed and each is released once no buffer is sub-allocated within it. Rounded
+        // up to the next power-of-two.
+        //
+        // Optional parameter. When 0 is specified, buffers of 64KB or larger are never
+        // sub-allocated within a resource.
+        uint64_t LargeBufferSize;
+
+        // Largest buffer which buffers smaller than 64KB are sub-allocated within, when created
+        // with ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE. Buffers start at 64KB and
+        // double in size, up to this size, while every existing buffer of a size is full. Larger
+        // buffers hold more small buffers per committed resource. Rounded up to the next
+        // power-of-two.
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the max buffer
+        // slab size to the default value of 4MB, or the max resource heap size when smaller.
+        uint64_t MaxBufferSlabSize;
+
+        // Size classes, ordered by ascending |ALLOCATOR_SIZE_CLASS_DESC::MaxSizeInBytes|, used to
+        // choose the algorithm which sub-allocates a resource from its size, so small, medium
+        // and huge resources can each be allocated in the way that suits them. The last size
+        // class also allocates every larger resource, so its |MaxSizeInBytes| is ignored.
+        // Resources allocated by a size class are never moved by CreateDefragmentationPlan.
+        //
+        // Optional parameter. When empty, every resource is allocated using
+        // ALLOCATOR_ALGORITHM_SLAB.
+        std::vector<ALLOCATOR_SIZE_CLASS_DESC> SizeClasses;
+
+        // Number of shards the general-purpose allocators of each resource heap type are split
+        // into. Each shard sub-allocates on its own, without the lock of the resource heap type,
+        // so threads creating resources at once only contend with the threads of the same
+        // shard. Every shard draws resource heaps from the same pool, and uses the same
+        // residency manager and budget. Threads are assigned a shard round-robin, so with fewer
+        // shards than threads, each shard is used by several threads.
+        //
+        // Optional parameter. When 0 or 1 is specified, every thread sub-allocates from the same
+        // allocators.
+        uint32_t SubAllocatorShardCount = 0;
+
+        // Most time BeginFrame spends releasing pooled resource heaps which the previous frame
+        // did not need, least recently used first. Pooled memory is released down to the size of
+        // the resource allocations created by the previous frame, so the next frame can still
+        // create as many without creating resource heaps.
+        //
+        // Optional parameter. When 0 is specified, BeginFrame does not release pooled memory.
+        double FrameTrimTimeInSeconds = 0;
+
+        // Name of a shared memory block, created by the allocator, which its counters are
+        // published to (see SHARED_ALLOCATOR_STATS), so tools running out of process can sample
+        // them, ex. "Local\\GPGMM.MyApp". Creating the allocator fails with E_INVALIDARG if the
+        // block already exists.
+        //
+        // Optional parameter. When empty, counters are not published.
+        std::string SharedStatsName;
+
+        // How often the counters are published to |SharedStatsName|, from a thread of the
+        // allocator.
+        //
+        // Optional parameter. When 0 is specified, counters are published every 100ms.
+        double SharedStatsIntervalInSeconds = 0;
     };
 
     enum ALLOCATION_FLAGS {
@@ -235,21 +572,292 @@ namespace gpgmm { namespace d3d12 {
         // allocating for large contiguous allocations. Should not be used with
         // ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY.
         ALLOCATION_FLAG_ALWAYS_PREFETCH_MEMORY = 0x8,
+
+        // Allocate an upload buffer for data which is only used until the GPU completes
+        // ALLOCATION_DESC::FenceValue, such as per-frame constants or dynamic vertices. Buffers are
+        // linearly allocated within the same resource, like
+        // ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE, but their memory is only re-used once
+        // ResourceAllocator::RetireTransientMemory is called with a completed fence value. The
+        // resource allocation must still be released. Falls back to a regular allocation if the
+        // transient buffer is full or the resource is not an upload buffer.
+        ALLOCATION_FLAG_TRANSIENT = 0x10,
+
+        // Map the resource upon creation and keep it mapped until released. Map then returns the
+        // same CPU pointer without taking a lock or calling into the driver, and Unmap has no
+        // effect. The resource heap is locked resident for the lifetime of the allocation. Only
+        // valid for upload or readback heaps, which can stay mapped while used by the GPU, and
+        // subresource 0.
+        ALLOCATION_FLAG_ALWAYS_MAPPED = 0x20,
+
+        // Allocate a default heap resource in CPU-visible memory, so it can be mapped and written
+        // directly instead of through a staging upload buffer. Resources are placed in custom
+        // heaps which use write-back pages when the adapter is cache-coherent, or write-combined
+        // otherwise. Only valid on UMA adapters, where default heaps already reside in system
+        // memory, and ignored for upload or readback heaps which are always CPU-visible.
+        ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE = 0x40,
+
+        // Place the resource at the end of the first resource heap of the pool instead, growing
+        // down towards the other resources, so the pool can be used as a double-ended stack.
+        // Only used by resources of a pool created with ALLOCATOR_ALGORITHM_LINEAR, and ignored
+        // otherwise.
+        ALLOCATION_FLAG_UPPER_ADDRESS = 0x80,
     };
 
     using ALLOCATION_FLAGS_TYPE = Flags<ALLOCATION_FLAGS>;
     DEFINE_OPERATORS_FOR_FLAGS(ALLOCATION_FLAGS_TYPE)
 
+    // Expected lifetime of a resource. Resources of different lifetimes are never placed in the
+    // same resource heap, so a resource kept for long cannot pin a heap whose other resources
+    // were released. Unrelated to ALLOCATION_FLAG_TRANSIENT, which only applies to upload
+    // buffers.
+    enum ALLOCATION_LIFETIME {
+
+        // Lifetime is unknown. Placed with other resources of unknown lifetime.
+        ALLOCATION_LIFETIME_UNKNOWN = 0,
+
+        // Released soon after being used, often within the same frame.
+        ALLOCATION_LIFETIME_TRANSIENT = 1,
+
+        // Released after a few frames.
+        ALLOCATION_LIFETIME_FRAME = 2,
+
+        // Kept for most of the lifetime of the application (ex. level resources).
+        ALLOCATION_LIFETIME_PERSISTENT = 3,
+    };
+
+    // Number of tags resource allocations can be counted by. See ALLOCATION_DESC::Tag.
+    constexpr uint32_t kMaxAllocationTagCount = 64u;
+
     struct ALLOCATION_DESC {
         // Flags used to control how the resource will be allocated.
         ALLOCATION_FLAGS_TYPE Flags = ALLOCATION_FLAG_NONE;
 
-        // Heap type that the resource to be allocated requires.
+        // Heap type that the resource to be allocated requires. Use kHeapTypeGPUUpload to write
+        // dynamic buffers directly into video memory, on devices which support GPU upload heaps.
+        // Otherwise, resources of that heap type fail to be created with E_INVALIDARG.
         D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+        // Fence value the GPU signals once done with the resource. Only used by
+        // ALLOCATION_FLAG_TRANSIENT.
+        uint64_t FenceValue = 0;
+
+        // Residency priority of the heap containing the resource, which is evicted before heaps
+        // of higher priority. A heap shared by many resources uses the highest priority of them.
+        // Zero uses the default, D3D12_RESIDENCY_PRIORITY_NORMAL. Requires ID3D12Device1.
+        D3D12_RESIDENCY_PRIORITY ResidencyPriority = {};
+
+        // Expected lifetime of the resource. Only used by resources placed in resource heaps
+        // shared with other resources.
+        ALLOCATION_LIFETIME Lifetime = ALLOCATION_LIFETIME_UNKNOWN;
+
+        // Pool whose resource heaps the resource is placed in, created by
+        // ResourceAllocator::CreatePool. The resource is never placed elsewhere, so creating it
+        // fails with E_OUTOFMEMORY once the pool is full. HeapType must match the heap type of the
+        // pool.
+        //
+        // Optional parameter. When nullptr, the resource is allocated by the resource allocator.
+        Pool* CustomPool = nullptr;
+
+        // Identifies the subsystem of the app (ex. textures, geometry, streaming) the resource
+        // belongs to, so memory can be attributed to it by ResourceAllocator::QueryTagInfo. Must
+        // be less than kMaxAllocationTagCount.
+        //
+        // Optional parameter. By default, resources are counted by tag zero.
+        uint32_t Tag = 0;
+    };
+
+    // Lifetime of a resource created by ResourceAllocator::CreateAliasedResources, as the range of
+    // passes (ex. render passes of a frame) which use the resource. Both passes are inclusive.
+    struct RESOURCE_LIFETIME_DESC {
+        uint64_t FirstPass = 0;
+        uint64_t LastPass = 0;
+    };
+
+    struct DEFRAGMENTATION_DESC {
+        // Only resource allocations within memory used less than this fraction of it are moved.
+        double MaxUsedPercent = 0.5;
+
+        // Stops planning once this many bytes would be moved, so defragmentation can be done
+        // incrementally, a few moves at a time.
+        uint64_t MaxBytesToMove = kInvalidSize;
+
+        // Moves the resource allocations, which the app knows are rarely used (or cold), out of
+        // the heaps they share with frequently used ones and into separate heaps of the lowest
+        // residency priority. Cold heaps are then evicted first and evicting them frees memory
+        // no frequently used resource needs. MaxUsedPercent is ignored.
+        bool MoveToColdHeaps = false;
+    };
+
+    // Move of a resource allocation planned by ResourceAllocator::CreateDefragmentationPlan.
+    struct DEFRAGMENTATION_MOVE {
+        // Resource allocation to be moved, which remains owned by the app.
+        ResourceAllocation* SrcAllocation = nullptr;
+
+        // Resource allocation in denser memory, of the same resource descriptor, that the source
+        // resource must be copied to. Created in the D3D12_RESOURCE_STATE_COPY_DEST state and
+        // owned by the app.
+        ResourceAllocation* DstAllocation = nullptr;
     };
 
     using QUERY_RESOURCE_ALLOCATOR_INFO = MEMORY_ALLOCATOR_INFO;
 
+    // Latency of ResourceAllocator::CreateResource, in nanoseconds, by how the resource
+    // allocation was created, and of the locks it waited for.
+    struct QUERY_RESOURCE_ALLOCATOR_STATS {
+        // Placed in a resource heap shared with other resources.
+        LATENCY_HISTOGRAM_INFO SubAllocatedLatency;
+
+        // Sub-allocated within a single resource, ex. a buffer.
+        LATENCY_HISTOGRAM_INFO SubAllocatedWithinLatency;
+
+        // Placed in a resource heap of its own.
+        LATENCY_HISTOGRAM_INFO StandaloneLatency;
+
+        // Created as a committed resource.
+        LATENCY_HISTOGRAM_INFO CommittedLatency;
+
+        // Time CreateResource waited for another thread to unlock the allocators of a resource
+        // heap type (or pool). Only waits are counted; locks acquired right away are not.
+        LATENCY_HISTOGRAM_INFO LockWaitLatency;
+
+        // Time spent in the device calls made by CreateResource, which the latencies above
+        // include, so the driver can be told apart from the allocator.
+        LATENCY_HISTOGRAM_INFO CreateHeapLatency;
+        LATENCY_HISTOGRAM_INFO CreatePlacedResourceLatency;
+        LATENCY_HISTOGRAM_INFO CreateCommittedResourceLatency;
+        LATENCY_HISTOGRAM_INFO GetResourceAllocationInfoLatency;
+
+        // Resources which skipped the allocators that failed the last resource of the same heap
+        // type, size class and flags (hits), and those which found nothing to skip (misses).
+        uint64_t LayerCacheHitCount;
+        uint64_t LayerCacheMissCount;
+
+        // Resources created with ALLOCATOR_FLAG_ADAPTIVE_COMMITTED which ended up committed, and
+        // those which ended up placed.
+        uint64_t AdaptiveCommittedCount;
+        uint64_t AdaptivePlacedCount;
+    };
+
+    // Memory of a heap type, in bytes, as counted by MEMORY_ALLOCATOR_INFO.
+    struct SHARED_HEAP_TYPE_STATS {
+        // Resource heaps, or committed resources, in use.
+        uint64_t UsedMemoryUsage;
+
+        // Resources sub-allocated within them.
+        uint64_t UsedBlockUsage;
+
+        // Resource heaps kept by pools for re-use.
+        uint64_t FreeMemoryUsage;
+    };
+
+    // Version of SHARED_ALLOCATOR_STATS. Incremented whenever its layout changes.
+    constexpr uint32_t kSharedAllocatorStatsVersion = 1;
+
+    // Counters published to ALLOCATOR_DESC::SharedStatsName. The shared memory block holds a
+    // uint64_t sequence number followed by this struct. The sequence number is odd while the
+    // counters are written, so readers copy them between two reads of the same even sequence
+    // number, and retry otherwise, without ever blocking the allocator. See
+    // ResourceAllocator::ReadSharedStats.
+    struct SHARED_ALLOCATOR_STATS {
+        // kSharedAllocatorStatsVersion of the publishing allocator.
+        uint32_t Version;
+
+        // Process of the publishing allocator.
+        uint32_t ProcessID;
+
+        // Number of times the counters were published.
+        uint64_t PublishCount;
+
+        // Placed or sub-allocated resources, by heap type.
+        SHARED_HEAP_TYPE_STATS Default;
+        SHARED_HEAP_TYPE_STATS Upload;
+        SHARED_HEAP_TYPE_STATS Readback;
+        SHARED_HEAP_TYPE_STATS GPUUpload;
+
+        // Committed resources created by the allocator itself, of any heap type.
+        SHARED_HEAP_TYPE_STATS Committed;
+
+        // Budget and usage (resident bytes) of each memory segment, as last updated by the
+        // residency manager. Zero without a residency manager.
+        uint64_t LocalBudget;
+        uint64_t LocalUsage;
+        uint64_t NonLocalBudget;
+        uint64_t NonLocalUsage;
+
+        // Latency of CreateResource, see QUERY_RESOURCE_ALLOCATOR_STATS.
+        LATENCY_HISTOGRAM_INFO SubAllocatedLatency;
+        LATENCY_HISTOGRAM_INFO SubAllocatedWithinLatency;
+        LATENCY_HISTOGRAM_INFO StandaloneLatency;
+        LATENCY_HISTOGRAM_INFO CommittedLatency;
+
+        // Paging since the residency manager was created, see RESIDENCY_PAGING_STATS.
+        uint64_t MadeResidentCount;
+        uint64_t MadeResidentSizeInBytes;
+        uint64_t EvictedCount;
+        uint64_t EvictedSizeInBytes;
+    };
+
+    // Resource allocations of a frame, from ResourceAllocator::BeginFrame to EndFrame.
+    struct FRAME_STATS {
+        // Number of frames begun so far, including this one.
+        uint64_t FrameIndex;
+
+        // Resource allocations created and released during the frame.
+        uint64_t AllocationCount;
+        uint64_t AllocationSizeInBytes;
+        uint64_t ReleasedCount;
+        uint64_t ReleasedSizeInBytes;
+
+        // Pooled memory released by BeginFrame, see ALLOCATOR_DESC::FrameTrimTimeInSeconds.
+        uint64_t TrimmedSizeInBytes;
+
+        // Time spent by BeginFrame on maintenance.
+        double MaintenanceTimeInSeconds;
+    };
+
+    // Live resource allocations created with the same ALLOCATION_DESC::Tag.
+    struct QUERY_ALLOCATION_TAG_INFO {
+        uint64_t UsedCount;
+        uint64_t UsedSizeInBytes;
+
+        // Soft quota set by ResourceAllocator::SetTagQuota, or kInvalidSize if none.
+        uint64_t QuotaInBytes;
+    };
+
+    // State of a live resource allocation, as captured by ResourceAllocator::CaptureSnapshot.
+    struct RESOURCE_ALLOCATION_SNAPSHOT {
+        // Identifies the allocation, along with the heap offset. Only valid to compare against
+        // other snapshots; the heap could be released by the time the snapshot is read.
+        Heap* ResourceHeap;
+        uint64_t HeapOffset;
+        uint64_t SizeInBytes;
+        AllocationMethod Method;
+
+        // Heap type of the resource, or zero if unknown (ex. reserved resources).
+        D3D12_HEAP_TYPE HeapType;
+        bool IsResident;
+
+        // Largest fence value the resource heap was last used with, or zero if never used by a
+        // residency managed queue.
+        uint64_t LastUsedFenceValue;
+    };
+
+    // Live resource allocations of an allocator, ordered by resource heap then heap offset.
+    struct ALLOCATOR_SNAPSHOT {
+        std::vector<RESOURCE_ALLOCATION_SNAPSHOT> Allocations;
+        uint64_t SizeInBytes;
+    };
+
+    // Difference between two snapshots of the same allocator.
+    struct ALLOCATOR_SNAPSHOT_DIFF {
+        // Allocations only in the later or earlier snapshot, respectively.
+        std::vector<RESOURCE_ALLOCATION_SNAPSHOT> AddedAllocations;
+        std::vector<RESOURCE_ALLOCATION_SNAPSHOT> RemovedAllocations;
+
+        // Growth in the size of live allocations, which is negative if they shrank.
+        int64_t SizeInBytesDelta;
+    };
+
     enum ALLOCATOR_MESSAGE_ID {
 
         // Allocator failed to allocate memory for the resource.
@@ -273,6 +881,28 @@ namespace gpgmm { namespace d3d12 {
         ALLOCATOR_MESSAGE_ID_ALLOCATOR_MESSAGES_END,
     };
 
+    // Event returned by ResourceAllocator::CreateResourceAsync which is signaled once the resource
+    // has been created (or failed to be). Must be released before the allocator used to create it.
+    class GPGMM_EXPORT ResourceAllocationEvent final : public Event {
+      public:
+        ResourceAllocationEvent(std::shared_ptr<Event> event,
+                                std::shared_ptr<CreateResourceTask> task);
+
+        // Event overrides
+        void Wait() override;
+        bool IsSignaled() override;
+        void Signal() override;
+        void AddSignaledCallback(std::shared_ptr<VoidCallback> callback) override;
+
+        // Waits for the resource to be created then returns the result of CreateResource. The
+        // resource allocation can only be acquired once, after which nullptr is returned.
+        HRESULT AcquireResourceAllocation(ResourceAllocation** resourceAllocationOut);
+
+      private:
+        std::shared_ptr<CreateResourceTask> mTask;
+        std::shared_ptr<Event> mEvent;
+    };
+
     class GPGMM_EXPORT ResourceAllocator final : public MemoryAllocator, public IUnknownImpl {
       public:
         // Creates the allocator and residency manager instance used to manage video memory for the
@@ -297,6 +927,111 @@ namespace gpgmm { namespace d3d12 {
                                const D3D12_CLEAR_VALUE* clearValue,
                                ResourceAllocation** resourceAllocationOut);
 
+        // Equivalent to CreateResource except memory is allocated and the resource is created on a
+        // background thread. Returns an event which can be polled or waited on to acquire the
+        // resource allocation, so large resources can be created without blocking the caller.
+        HRESULT CreateResourceAsync(
+            const ALLOCATION_DESC& allocationDescriptor,
+            const D3D12_RESOURCE_DESC& resourceDescriptor,
+            D3D12_RESOURCE_STATES initialResourceState,
+            const D3D12_CLEAR_VALUE* clearValue,
+            std::shared_ptr<ResourceAllocationEvent>* resourceAllocationEventOut);
+
+        // Allocates memory and creates multiple D3D12 resources at once.
+        // Equivalent to calling CreateResource |count| times except every resource is sized
+        // before any is allocated, and the allocator counters are reported once per batch. Each
+        // resource still locks its resource heap type (or pool) like CreateResource does.
+        // Requests are grouped by resource heap type and allocated largest first, so smaller
+        // resources can fill the space left by larger ones. Each element of
+        // |resourceAllocationsOut| (and |resultsOut|, if specified) corresponds to the request of
+        // the same index, which is nullptr if the resource could not be created. Returns S_OK if
+        // every resource was created, otherwise, returns the first failure.
+        HRESULT CreateResources(uint32_t count,
+                                const ALLOCATION_DESC* allocationDescriptors,
+                                const D3D12_RESOURCE_DESC* resourceDescriptors,
+                                const D3D12_RESOURCE_STATES* initialResourceStates,
+                                const D3D12_CLEAR_VALUE* const* clearValues,
+                                ResourceAllocation** resourceAllocationsOut,
+                                HRESULT* resultsOut = nullptr);
+
+        // Allocates memory and creates multiple D3D12 resources which alias one another.
+        // Resources whose lifetimes never overlap are placed at the same location in a resource
+        // heap shared by every resource of the same resource heap type, so the heap is only as
+        // large as the resources used at once. Each element of |resourceAllocationsOut|
+        // corresponds to the request of the same index. The heap is released once every resource
+        // allocation within it was. Either every resource is created or none are.
+        //
+        // Like any aliased placed resource, the resource previously using the same memory must
+        // be done before the next one is used: an aliasing barrier is required at the first pass
+        // of each resource, and render targets or depth stencils must be initialized (cleared,
+        // discarded or copied to) before being read.
+        HRESULT CreateAliasedResources(uint32_t count,
+                                       const ALLOCATION_DESC& allocationDescriptor,
+                                       const D3D12_RESOURCE_DESC* resourceDescriptors,
+                                       const D3D12_RESOURCE_STATES* initialResourceStates,
+                                       const D3D12_CLEAR_VALUE* const* clearValues,
+                                       const RESOURCE_LIFETIME_DESC* lifetimes,
+                                       ResourceAllocation** resourceAllocationsOut);
+
+        // Allocates memory, as given by ID3D12Device::GetResourceAllocationInfo, without creating
+        // a resource. The returned resource allocation has a resource heap and offset but no
+        // resource, so the app can place and alias its own resources within it (ex. by a render
+        // graph) without going back through the allocator. Memory is sub-allocated like the
+        // memory of any placed resource, or placed in its own resource heap if too large.
+        //
+        // Resource heaps of resource heap tier 1 only allow a single category of resources, so
+        // allocating memory requires tier 2, otherwise, returns E_INVALIDARG. Flags which need a
+        // resource (ex. ALLOCATION_FLAG_ALWAYS_MAPPED) are also invalid.
+        HRESULT AllocateMemory(const ALLOCATION_DESC& allocationDescriptor,
+                               const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
+                               ResourceAllocation** resourceAllocationOut);
+
+        // Plans to defragment |allocations| by moving the ones within sparsely used resource heaps
+        // into more densely used ones. For each move, the app copies the source resource to the
+        // destination (ex. CopyResource on a copy queue), updates its references (ex. views) to
+        // use the destination, then releases the source once the copy completed. Memory emptied
+        // by the moves is then returned to the pool, to be released by Trim. Only placed
+        // resources within sub-allocated resource heaps of default or readback heap types can be
+        // moved; others are skipped. Optimized clear values are not preserved.
+        HRESULT CreateDefragmentationPlan(const DEFRAGMENTATION_DESC& descriptor,
+                                          uint32_t count,
+                                          ResourceAllocation* const* allocations,
+                                          std::vector<DEFRAGMENTATION_MOVE>* movesOut);
+
+        // Creates a D3D12 reserved (or tiled) resource whose tiles are not backed by memory until
+        // mapped by MapTiles, so resident memory is proportional to the tiles used. The returned
+        // ResourceAllocation owns the memory of every tile mapped, which is released along with
+        // it. Reserved resources are always allocated from default heaps.
+        HRESULT CreateReservedResource(const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                       D3D12_RESOURCE_STATES initialResourceState,
+                                       const D3D12_CLEAR_VALUE* clearValue,
+                                       ResourceAllocation** resourceAllocationOut);
+
+        // Allocates a 64KB page of memory for each tile at |coordinates| of a reserved resource
+        // which is not already mapped. Tiles only use the memory once UpdateTileMappings is
+        // called. Resource heaps containing mapped tiles stay locked resident.
+        HRESULT MapTiles(ResourceAllocation* reservedResourceAllocation,
+                         uint32_t count,
+                         const D3D12_TILED_RESOURCE_COORDINATE* coordinates);
+
+        // Frees the page of memory of each mapped tile at |coordinates| of a reserved resource.
+        // Tiles are only unmapped once UpdateTileMappings is called, which must use the same queue
+        // as any tile the page is mapped to after.
+        HRESULT UnmapTiles(ResourceAllocation* reservedResourceAllocation,
+                           uint32_t count,
+                           const D3D12_TILED_RESOURCE_COORDINATE* coordinates);
+
+        // Updates the tile mappings changed by MapTiles or UnmapTiles since last called, for every
+        // reserved resource, in the order changed. Consecutive changes of the same resource and
+        // resource heap are batched into a single ID3D12CommandQueue::UpdateTileMappings call, so
+        // this should be called once per queue submission, before the tiles are used.
+        HRESULT UpdateTileMappings(ID3D12CommandQueue* queue);
+
+        // Creates a pool of resource heaps dedicated to the resources created with
+        // ALLOCATION_DESC::CustomPool. Resource heaps of the pool are sized, pre-allocated and
+        // capped by |descriptor| and never used by other resources.
+        HRESULT CreatePool(const POOL_DESC& descriptor, Pool** poolOut);
+
         // Imports an existing D3D12 resource. Allows externally created D3D12 resources to be used
         // as ResourceAllocations. Residency is not supported for imported resources.
         HRESULT CreateResource(ComPtr<ID3D12Resource> committedResource,
@@ -314,21 +1049,197 @@ namespace gpgmm { namespace d3d12 {
         // brief performance hit when the internal resource heaps get reallocated by the OS.
         void Trim();
 
+        // Incremental version of Trim() which releases the least recently used resource heaps
+        // first and stops once at-least |bytesToRelease| bytes were released or |maxSeconds|
+        // has elapsed, whichever comes first. Heaps are released one at a time per heap type,
+        // with every heap type released in parallel, so the time spent is bounded by the cost of
+        // releasing a single heap. Could release up to one heap per heap type more than needed.
+        // Returns the number of bytes released.
+        uint64_t Trim(uint64_t bytesToRelease, double maxSeconds);
+
+        // Re-uses the memory of ALLOCATION_FLAG_TRANSIENT allocations, and releases allocations
+        // given to ReleaseAfter, whose fence value is less than or equal to
+        // |completedFenceValue|. Typically called once per frame with the completed value of the
+        // fence signaled by the command queue.
+        void RetireTransientMemory(uint64_t completedFenceValue);
+
+        // Begins a frame by running the maintenance which would otherwise land inside resource
+        // creation, so its cost is paid at a predictable point. Retires transient memory and
+        // pending releases whose fence value is less than or equal to |completedFenceValue|,
+        // like RetireTransientMemory, then incrementally releases pooled memory for at-most
+        // ALLOCATOR_DESC::FrameTrimTimeInSeconds. Also starts counting the paging of the frame,
+        // see ResidencyManager::QueryStats. Returns E_FAIL if the previous frame was not ended.
+        HRESULT BeginFrame(uint64_t completedFenceValue);
+
+        // Ends the frame begun by BeginFrame, returning the resource allocations created and
+        // released since the previous frame ended through |frameStatsOut|, then resets them for
+        // the next frame. Returns E_FAIL if no frame was begun.
+        HRESULT EndFrame(FRAME_STATS* frameStatsOut = nullptr);
+
+        // Releases the caller's reference to |resourceAllocation| once |fenceValue| completes,
+        // instead of immediately, so memory still used by the GPU cannot be re-used. Released
+        // by RetireTransientMemory, in a single batch per call, or once the allocator is
+        // destroyed.
+        void ReleaseAfter(ResourceAllocation* resourceAllocation, uint64_t fenceValue);
+
         // Return the current allocator usage.
         QUERY_RESOURCE_ALLOCATOR_INFO QueryInfo() const override;
 
+        // Return the fragmentation of every allocator used to create resources, summed over all
+        // of them, and report it as trace counters. Use QueryFragmentation on a single allocator
+        // to know the fragmentation of each layer instead.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo() const override;
+
+        // Return the fragmentation of the resource heaps shared by resources of |lifetime|,
+        // summed over every heap type.
+        MEMORY_ALLOCATOR_FRAGMENTATION_INFO QueryFragmentationInfo(
+            ALLOCATION_LIFETIME lifetime) const;
+
+        // Return the latency percentiles of resources created so far. Cheap enough to be polled
+        // by telemetry, since latencies are recorded without locking.
+        QUERY_RESOURCE_ALLOCATOR_STATS QueryStats() const;
+
+        // Return the live resource allocations created with |tag|. Counted as resources are
+        // created and released, so cheap enough to be polled per frame.
+        QUERY_ALLOCATION_TAG_INFO QueryTagInfo(uint32_t tag) const;
+
+        // Sets a soft quota, in bytes, on the size of the resource allocations of |tag|. Resources
+        // are still created past the quota, but the memory pressure callbacks of the residency
+        // manager are called with the tag once exceeded, so the app knows which of its subsystems
+        // to shrink. A quota of kInvalidSize removes it.
+        HRESULT SetTagQuota(uint32_t tag, uint64_t quotaInBytes);
+
+        // Logs the count and size of live resource allocations by the call site (return address)
+        // which created them, largest first. Can be called at any time, without stopping other
+        // threads from allocating. Only reports when built with
+        // GPGMM_ENABLE_PRECISE_ALLOCATOR_DEBUG.
+        void ReportLiveAllocationsByCallSite() const;
+
+        // Captures the state of every live resource allocation in a single pass, without
+        // serializing anything, so it can be taken periodically. Requires
+        // ALLOCATOR_FLAG_TRACK_LIVE_ALLOCATIONS, otherwise, returns E_FAIL.
+        HRESULT CaptureSnapshot(ALLOCATOR_SNAPSHOT* snapshotOut) const;
+
+        // Returns the allocations added or removed between |before| and |after|.
+        static ALLOCATOR_SNAPSHOT_DIFF DiffSnapshots(const ALLOCATOR_SNAPSHOT& before,
+                                                     const ALLOCATOR_SNAPSHOT& after);
+
+        // Returns the warm-up profile learned so far, which is the most resources sub-allocated
+        // of each size which existed at once. Requires ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE,
+        // otherwise, returns E_FAIL.
+        HRESULT QueryWarmUpProfile(std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut) const;
+
+        // Saves |profile| to |profileFile| in a compact binary format, typically on shutdown.
+        static HRESULT SaveWarmUpProfile(const std::vector<ALLOCATOR_WARM_UP_DESC>& profile,
+                                         const std::string& profileFile);
+
+        // Loads a profile saved by SaveWarmUpProfile, to be given to
+        // |ALLOCATOR_DESC::WarmUpProfile|. Returns E_FAIL if the file is missing or invalid.
+        static HRESULT LoadWarmUpProfile(const std::string& profileFile,
+                                         std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut);
+
+        // Reads the counters last published to the shared memory block |name|, see
+        // ALLOCATOR_DESC::SharedStatsName, typically from another process. Returns E_FAIL if the
+        // block does not exist or nothing was published yet.
+        static HRESULT ReadSharedStats(const std::string& name, SHARED_ALLOCATOR_STATS* statsOut);
+
         const char* GetTypename() const;
 
       private:
+        friend AllocatorGroup;
         friend BufferAllocator;
         friend ResourceAllocation;
+        friend class WarmUpTask;
 
         HRESULT CreateResourceInternal(const ALLOCATION_DESC& allocationDescriptor,
                                        const D3D12_RESOURCE_DESC& resourceDescriptor,
+                                       const D3D12_RESOURCE_ALLOCATION_INFO& resourceInfo,
                                        D3D12_RESOURCE_STATES initialResourceState,
                                        const D3D12_CLEAR_VALUE* clearValue,
                                        ResourceAllocation** resourceAllocationOut);
 
+        void ReportAllocatorCounters() const;
+
+        // Usage of the allocators of a single resource heap type, summed.
+        QUERY_RESOURCE_ALLOCATOR_INFO QueryInfoOfType(size_t resourceHeapTypeIndex) const;
+
+        // Collects the counters published to ALLOCATOR_DESC::SharedStatsName.
+        void CollectSharedStats(SHARED_ALLOCATOR_STATS* statsOut) const;
+        void RecordAllocationLatency(const ResourceAllocation* resourceAllocation,
+                                     uint64_t latencyInNanoseconds);
+
+        // Residency priorities require ID3D12Device1::SetResidencyPriority, which is returned by
+        // |device1Out| unless |allocationDescriptor| specifies no priority.
+        HRESULT GetResidencyPriorityDevice(const ALLOCATION_DESC& allocationDescriptor,
+                                           ComPtr<ID3D12Device1>* device1Out) const;
+
+        // Sets the residency priority of the resource heap of |*resourceAllocationInOut|, unless
+        // |device1| is nullptr. Releases the resource allocation should it fail.
+        HRESULT SetResidencyPriority(ID3D12Device1* device1,
+                                     const ALLOCATION_DESC& allocationDescriptor,
+                                     ResourceAllocation** resourceAllocationInOut) const;
+
+        // Steps shared by CreateResource and CreateResources, so both create resources alike.
+        // Checks |allocationDescriptor| before its resource is created, returning the device to
+        // set its residency priority with in |device1Out|.
+        HRESULT ValidateCreateResource(const ALLOCATION_DESC& allocationDescriptor,
+                                       ComPtr<ID3D12Device1>* device1Out) const;
+
+        // Completes |*resourceAllocationInOut| once created: sets its residency priority, then
+        // records its latency since |allocationStartTicks| and its tag. Releases the resource
+        // allocation should it fail.
+        HRESULT CompleteCreatedResource(ID3D12Device1* device1,
+                                        const ALLOCATION_DESC& allocationDescriptor,
+                                        uint64_t allocationStartTicks,
+                                        ResourceAllocation** resourceAllocationInOut);
+
+        // Reports the allocator counters once, then tracks each of the |count| resource
+        // allocations as live, created from |callSite|. Resources which failed to be created are
+        // nullptr and skipped.
+        void ReportCreatedResources(uint32_t count,
+                                    ResourceAllocation* const* resourceAllocations,
+                                    const void* callSite);
+
+        // Records the time since |startTicks| of |mAllocationTimer| into |latency| and the trace
+        // counter named |traceCounterName|, which must be a literal.
+        void RecordDriverLatency(LatencyHistogram* latency,
+                                 const char* traceCounterName,
+                                 uint64_t startTicks);
+        void TrackLiveAllocation(ResourceAllocation* resourceAllocation, const void* callSite);
+
+        // Decides if the next CreateResource call is recorded, see
+        // ALLOCATOR_RECORD_OPTIONS::CallSampleRate.
+        bool IsCallSampled();
+        void TrackTaggedAllocation(ResourceAllocation* resourceAllocation, uint32_t tag);
+        void UntrackTaggedAllocation(const ResourceAllocation* resourceAllocation);
+
+        // Counts |extendedSize| more bytes for the tag of |resourceAllocation|, once it grew in
+        // place.
+        void TrackTaggedAllocationExtended(const ResourceAllocation* resourceAllocation,
+                                           uint64_t extendedSize);
+
+        // Allocators tried by CreateResourceInternal, in order, to place or commit a resource.
+        enum class CreateResourceLayer : uint8_t {
+            kSmallTexture = 0,
+            kSubAllocated = 1,
+            kResourceHeap = 2,
+            kCommitted = 3,
+        };
+
+        // Returns the layer which created the last resource of |layerCacheKey|, after the layers
+        // before it failed, or the first layer if none did since the last Trim or budget change.
+        CreateResourceLayer LookupCreateResourceLayer(uint32_t layerCacheKey);
+        void UpdateCreateResourceLayer(uint32_t layerCacheKey, CreateResourceLayer layer);
+        uint64_t GetCreateResourceLayerGeneration() const;
+
+        // Returns true if a resource of |resourceHeapTypeIndex| and |sizeInBytes| should be
+        // committed instead of placed, since committing was measured cheaper or needs measuring.
+        bool ShouldCreateCommittedResource(size_t resourceHeapTypeIndex, uint64_t sizeInBytes);
+        void RecordCreateResourceCost(size_t resourceHeapTypeIndex,
+                                      uint64_t sizeInBytes,
+                                      bool isCommitted,
+                                      uint64_t latencyInNanoseconds);
+
         ResourceAllocator(const ALLOCATOR_DESC& descriptor,
                           ComPtr<ResidencyManager> residencyManager,
                           std::unique_ptr<Caps> caps);
@@ -351,6 +1262,94 @@ namespace gpgmm { namespace d3d12 {
 
         HRESULT ReportLiveDeviceObjects() const;
 
+        // Returns the size of resource heaps, in bytes, allocated by this allocator, whether
+        // pooled, sub-allocated or committed. Cheap enough to be called per resource, unlike
+        // QueryInfo().
+        uint64_t GetResourceHeapUsage() const;
+
+        // Returns the preferred size of resource heaps of |heapType|. Unless specified by
+        // |descriptor|, the size is picked for the adapter by Caps.
+        uint64_t GetPreferredResourceHeapSize(const ALLOCATOR_DESC& descriptor,
+                                              D3D12_HEAP_TYPE heapType) const;
+
+        // Returns the largest resource heap a sub-allocator should create for |heapType|, or zero
+        // if unlimited. Requires ALLOCATOR_FLAG_BUDGET_ADAPTIVE_HEAP_SIZE.
+        uint64_t GetMaxResourceHeapSizeForBudget(D3D12_HEAP_TYPE heapType) const;
+
+        // Returns the allocator which sub-allocates resources of |alignment| in resource heaps of
+        // the given type: MSAA textures get their own, otherwise the general-purpose allocator.
+        MemoryAllocator* GetSubAllocatorOfType(size_t resourceHeapTypeIndex,
+                                               uint64_t alignment) const;
+
+        // Returns the budget of |heapType|, or nullptr if ALLOCATOR_DESC::HeapTypeBudgets does not
+        // limit it.
+        HeapUsageBudget* GetHeapTypeBudget(D3D12_HEAP_TYPE heapType) const;
+
+        // Releases the pooled resource heaps of |heapType| should allocating |size| more bytes
+        // exceed its budget.
+        void ReleasePooledMemoryOverHeapTypeBudget(D3D12_HEAP_TYPE heapType, uint64_t size);
+
+        // Returns false for kHeapTypeGPUUpload unless the device supports GPU upload heaps.
+        bool IsHeapTypeSupported(D3D12_HEAP_TYPE heapType) const;
+
+        // Creates the allocator of resource heaps of the given type, which are pooled unless
+        // ALLOCATOR_FLAG_ALWAYS_ON_DEMAND is specified. On resource heap tier 2, the pool is
+        // shared by every allocator of the heap type, unless heaps are created of a non-default
+        // |residencyPriority| or of |heapProperties| (such as custom heaps) instead of the type.
+        std::unique_ptr<MemoryAllocator> CreateResourceHeapAllocator(
+            const ALLOCATOR_DESC& descriptor,
+            D3D12_HEAP_TYPE heapType,
+            D3D12_HEAP_FLAGS heapFlags,
+            uint64_t heapAlignment,
+            uint64_t reservedResourceHeapCount = 0,
+            D3D12_RESIDENCY_PRIORITY residencyPriority = {},
+            const D3D12_HEAP_PROPERTIES* heapProperties = nullptr);
+
+        // Creates the allocator which sub-allocates resources using |algorithm| from resource
+        // heaps of the given type. Resource heaps are allocated from |resourceHeapAllocator|,
+        // when specified, instead of a pool of their own.
+        std::unique_ptr<MemoryAllocator> CreateSubAllocator(
+            const ALLOCATOR_DESC& descriptor,
+            ALLOCATOR_ALGORITHM algorithm,
+            D3D12_HEAP_TYPE heapType,
+            D3D12_HEAP_FLAGS heapFlags,
+            uint64_t heapAlignment,
+            MemoryAllocator* resourceHeapAllocator = nullptr);
+
+        // Creates the general-purpose allocator of one lifetime, which sub-allocates resources
+        // by ALLOCATOR_DESC::SizeClasses.
+        std::unique_ptr<MemoryAllocator> CreateGeneralPurposeAllocator(
+            const ALLOCATOR_DESC& descriptor,
+            D3D12_HEAP_TYPE heapType,
+            D3D12_HEAP_FLAGS heapFlags,
+            uint64_t heapAlignment,
+            MemoryAllocator* resourceHeapAllocator);
+
+        // Creates the allocators of the resource heap type, and primes their size cache, upon
+        // first use of the type. Must not be called with the heap type locked.
+        void InitializeAllocatorsOfType(size_t resourceHeapTypeIndex);
+
+        // True once the allocators of the resource heap type exist. Allocators of every type are
+        // only read once initialized, so they can be read without locking.
+        bool IsInitializedOfType(size_t resourceHeapTypeIndex) const;
+
+        // Runs |callback| once per initialized resource heap type, each in parallel on the thread
+        // pool, and waits for every one to complete. Heap types are independent, so releasing
+        // memory of one never waits on another.
+        void ForEachInitializedTypeInParallel(
+            const std::function<void(uint32_t resourceHeapTypeIndex)>& callback);
+
+        // Releases every unused resource heap of the resource heap type.
+        void TrimOfType(uint32_t resourceHeapTypeIndex);
+
+        // Releases the least recently used resource heap of the resource heap type. Returns the
+        // number of bytes released, or zero if none was unused.
+        uint64_t TrimLeastRecentlyUsedOfType(uint32_t resourceHeapTypeIndex);
+
+        // Allocates then frees every resource allocation in |profile| so the resource heaps
+        // remain pooled.
+        void WarmUp(const std::vector<ALLOCATOR_WARM_UP_DESC>& profile);
+
         // MemoryAllocator interface
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
 
@@ -359,23 +1358,205 @@ namespace gpgmm { namespace d3d12 {
 
         std::unique_ptr<Caps> mCaps;
 
+        // Storage of every resource allocation created. Declared before the allocators so it is
+        // destroyed after them.
+        ResourceAllocationPool mResourceAllocationPool;
+
         const bool mIsUMA;
         const D3D12_RESOURCE_HEAP_TIER mResourceHeapTier;
         const bool mIsAlwaysCommitted;
         const bool mIsAlwaysInBudget;
+        const bool mReleaseInBackground;
+
+        // Added to the flags of every resource heap or committed resource created.
+        const D3D12_HEAP_FLAGS mHeapCreationFlags;
+
         const uint64_t mMaxResourceHeapSize;
+        const uint64_t mMaxResourceSizeForSubAllocation;
 
-        static constexpr uint64_t kNumOfResourceHeapTypes = 8u;
+        // Used to create the allocators of each resource heap type upon first use.
+        const ALLOCATOR_DESC mDescriptor;
 
+        // Only exists when created by AllocatorGroup::CreateAllocator.
+        ComPtr<AllocatorGroup> mGroup;
+
+        // Updated by every resource heap allocator. Declared before the allocators so it
+        // outlives them.
+        RelaxedCounter<uint64_t> mResourceHeapUsage;
+
+        // Indexed by D3D12_HEAP_TYPE, up to kHeapTypeGPUUpload. Only exists for heap types
+        // limited by ALLOCATOR_DESC::HeapTypeBudgets. Declared before the allocators so it
+        // outlives them.
+        static constexpr uint64_t kNumOfHeapTypes = 6u;
+        std::array<std::unique_ptr<HeapUsageBudget>, kNumOfHeapTypes> mHeapTypeBudgets;
+
+        static constexpr uint64_t kNumOfResourceHeapTypes = 10u;
+
+        // Only exists for resource heap types which allow all buffers and textures, on resource
+        // heap tier 2. Declared before the allocators which share it so it outlives them.
         std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
-            mResourceHeapAllocatorOfType;
+            mSharedResourceHeapAllocatorOfType;
+
+        // Only exists when ALLOCATOR_DESC::SubAllocatorShardCount is greater than 1. Resource
+        // heaps shared by every shard of the general-purpose allocators, one per lifetime.
+        std::array<std::vector<std::unique_ptr<MemoryAllocator>>, kNumOfResourceHeapTypes>
+            mShardResourceHeapAllocatorsOfType;
+
         std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mResourceHeapAllocatorOfType;
+        std::array<std::unique_ptr<LifetimeMemoryAllocator>, kNumOfResourceHeapTypes>
             mResourceAllocatorOfType;
         std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
             mBufferAllocatorOfType;
 
+        // Only exists when ALLOCATOR_DESC::LargeBufferSize is specified.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mLargeBufferAllocatorOfType;
+
+        // Only exists for default heap types which allow non-RT/DS textures. Small textures
+        // are 4KB aligned, so sub-allocating them in 64KB blocks would waste most of each block.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mSmallTextureAllocatorOfType;
+
+        // Only exists for default heap types which allow RT/DS textures. MSAA textures are 4MB
+        // aligned, so sub-allocating them with other resources would pad them and fragment the
+        // resource heaps of every other resource.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mMSAATextureAllocatorOfType;
+
+        // Only exists for default heap types on UMA adapters. Used by
+        // ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mCPUAccessibleAllocatorOfType;
+
+        // Used by CreateAliasedResources. Heaps are never sub-allocated by the other allocators.
+        std::array<std::unique_ptr<AliasedMemoryAllocator>, kNumOfResourceHeapTypes>
+            mAliasedAllocatorOfType;
+
+        // Allocates the cold heaps of DEFRAGMENTATION_DESC::MoveToColdHeaps. Only exists for
+        // default heap types.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mColdAllocatorOfType;
+
+        // Allocates tile pages of reserved resources. Only exists for default heap types.
+        std::array<std::unique_ptr<MemoryAllocator>, kNumOfResourceHeapTypes>
+            mTilePageAllocatorOfType;
+
+        // Budget each committed resource was counted by, if its heap type has a budget.
+        std::unordered_map<MemoryAllocation*, HeapUsageBudget*> mCommittedResourceBudgets;
+        std::mutex mCommittedResourceBudgetsMutex;
+        std::atomic<uint64_t> mCommittedResourceBudgetCount = {0};
+
+        // Tiles of each reserved resource created.
+        std::unordered_map<MemoryAllocation*, std::unique_ptr<ReservedResourceTiles>>
+            mReservedResources;
+        std::mutex mReservedResourcesMutex;
+        std::atomic<uint64_t> mReservedResourceCount = {0};
+
+        // Allocations given to ReleaseAfter, ordered by fence value.
+        std::multimap<uint64_t, ResourceAllocation*> mPendingReleases;
+        std::mutex mPendingReleasesMutex;
+
+        // Remembers the allocation info of resource descriptors already queried from the device.
+        std::unique_ptr<ResourceAllocationInfoCache> mResourceAllocationInfoCache;
+
+        // Only exists for upload heap types.
+        std::array<std::unique_ptr<RingMemoryAllocator>, kNumOfResourceHeapTypes>
+            mTransientAllocatorOfType;
+
+        // Guards the allocators of each resource heap type, independently of one another.
+        std::array<std::mutex, kNumOfResourceHeapTypes> mMutexOfType;
+        std::array<std::atomic<bool>, kNumOfResourceHeapTypes> mIsInitializedOfType = {};
+
         std::unique_ptr<DebugResourceAllocator> mDebugAllocator;
         std::unique_ptr<PlatformTime> mAllocationTimer;
+
+        // CreateResource calls made while recording, to sample 1 in CallSampleRate of them.
+        std::atomic<uint64_t> mRecordedCallCount{0};
+
+        LatencyHistogram mSubAllocatedLatency;
+        LatencyHistogram mSubAllocatedWithinLatency;
+        LatencyHistogram mStandaloneLatency;
+        LatencyHistogram mCommittedLatency;
+        LatencyHistogram mLockWaitLatency;
+        LatencyHistogram mCreateHeapLatency;
+        LatencyHistogram mCreatePlacedResourceLatency;
+        LatencyHistogram mCreateCommittedResourceLatency;
+        LatencyHistogram mGetResourceAllocationInfoLatency;
+
+        // Updated as tagged resource allocations are created and released, without walking the
+        // allocators.
+        struct AllocationTagCounters {
+            RelaxedCounter<uint64_t> UsedCount;
+            RelaxedCounter<uint64_t> UsedUsage;
+            std::atomic<uint64_t> Quota = {kInvalidSize};
+
+            // Reported by the trace counters once used, even if no longer.
+            std::atomic<bool> IsUsed = {false};
+        };
+
+        std::array<AllocationTagCounters, kMaxAllocationTagCount> mTagCounters;
+
+        // Counted with the tag counters, since every resource allocation is tagged, and reset by
+        // EndFrame.
+        struct FrameCounters {
+            std::atomic<uint64_t> AllocationCount = {0};
+            std::atomic<uint64_t> AllocationUsage = {0};
+            std::atomic<uint64_t> ReleasedCount = {0};
+            std::atomic<uint64_t> ReleasedUsage = {0};
+        };
+
+        FrameCounters mFrameCounters;
+
+        // State of the current frame. Guarded by mFrameMutex.
+        std::mutex mFrameMutex;
+        bool mIsInFrame = false;
+        uint64_t mFrameIndex = 0;
+        uint64_t mLastFrameAllocationUsage = 0;
+        FRAME_STATS mFrameStats = {};
+
+        // Only created with ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE.
+        std::unique_ptr<WarmUpProfileRecorder> mWarmUpProfileRecorder;
+
+        // Direct-mapped by key, each entry packs the key, the generation it was stored in and the
+        // layer, so it is read and written without locking. Entries of an older generation are
+        // stale, since Trim or a budget change could make the layers skipped succeed again.
+        static constexpr size_t kCreateResourceLayerCacheSize = 256;  // Indexed by 8 bits.
+        std::array<std::atomic<uint64_t>, kCreateResourceLayerCacheSize>
+            mCreateResourceLayerCache = {};
+        std::atomic<uint64_t> mTrimCount = {0};
+        RelaxedCounter<uint64_t> mCreateResourceLayerCacheHits;
+        RelaxedCounter<uint64_t> mCreateResourceLayerCacheMisses;
+
+        // Average time to create a resource, in nanoseconds, by placing or committing it. Only
+        // used by ALLOCATOR_FLAG_ADAPTIVE_COMMITTED. Updated without locking, so concurrent
+        // updates of an average can be lost, which only makes it follow the driver slower.
+        struct CreateResourceCost {
+            std::atomic<uint64_t> PlacedLatency = {0};
+            std::atomic<uint64_t> CommittedLatency = {0};
+            std::atomic<uint32_t> PlacedCount = {0};
+            std::atomic<uint32_t> CommittedCount = {0};
+            std::atomic<uint64_t> RequestCount = {0};
+        };
+
+        // By resource heap type then power-of-two size class.
+        std::array<std::array<CreateResourceCost, 64>, kNumOfResourceHeapTypes>
+            mCreateResourceCosts;
+        RelaxedCounter<uint64_t> mAdaptiveCommittedCount;
+        RelaxedCounter<uint64_t> mAdaptivePlacedCount;
+
+        // Only exists when ALLOCATOR_DESC::SharedStatsName is specified. Stopped before the
+        // allocators it collects counters from are destroyed.
+        std::unique_ptr<SharedStatsPublisher> mSharedStatsPublisher;
+
+        // Used to warm-up in the background. Must complete before the allocators are destroyed.
+        std::shared_ptr<ThreadPool> mWarmUpThreadPool;
+        std::shared_ptr<Event> mWarmUpEvent;
+
+        // Resources being created by CreateResourceAsync, which must be created before the
+        // allocators are destroyed. Signaled events are removed as others are added.
+        std::mutex mCreateResourceEventsMutex;
+        std::vector<std::shared_ptr<Event>> mCreateResourceEvents;
     };
 
 }}  // namespace gpgmm::d3d12
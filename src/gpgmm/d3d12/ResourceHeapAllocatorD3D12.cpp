@@ -16,8 +16,10 @@
 #include "gpgmm/d3d12/ResourceHeapAllocatorD3D12.h"
 
 #include "gpgmm/Debug.h"
+#include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Limits.h"
 #include "gpgmm/common/Math.h"
+#include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/d3d12/BackendD3D12.h"
 #include "gpgmm/d3d12/HeapD3D12.h"
 #include "gpgmm/d3d12/ResidencyManagerD3D12.h"
@@ -25,63 +27,216 @@
 
 namespace gpgmm { namespace d3d12 {
 
+    HeapUsageBudget::HeapUsageBudget(uint64_t maxUsage) : mMaxUsage(maxUsage) {
+    }
+
+    bool HeapUsageBudget::TryAdd(uint64_t size) {
+        uint64_t usage = mUsage.load(std::memory_order_relaxed);
+        do {
+            if (size > mMaxUsage || usage > mMaxUsage - size) {
+                return false;
+            }
+        } while (!mUsage.compare_exchange_weak(usage, usage + size, std::memory_order_relaxed));
+        return true;
+    }
+
+    void HeapUsageBudget::Add(uint64_t size) {
+        mUsage.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void HeapUsageBudget::Subtract(uint64_t size) {
+        mUsage.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    uint64_t HeapUsageBudget::GetUsage() const {
+        return mUsage.load(std::memory_order_relaxed);
+    }
+
+    uint64_t HeapUsageBudget::GetMaxUsage() const {
+        return mMaxUsage;
+    }
+
     ResourceHeapAllocator::ResourceHeapAllocator(ResidencyManager* residencyManager,
                                                  ID3D12Device* device,
                                                  D3D12_HEAP_TYPE heapType,
                                                  D3D12_HEAP_FLAGS heapFlags,
                                                  bool isUMA,
-                                                 bool isAlwaysInBudget)
+                                                 bool isAlwaysInBudget,
+                                                 bool releaseInBackground,
+                                                 RelaxedCounter<uint64_t>* heapUsage,
+                                                 HeapUsageBudget* heapBudget,
+                                                 LatencyHistogram* createHeapLatency,
+                                                 D3D12_RESIDENCY_PRIORITY residencyPriority)
+        : ResourceHeapAllocator(residencyManager,
+                                device,
+                                D3D12_HEAP_PROPERTIES{heapType},
+                                heapFlags,
+                                isUMA,
+                                isAlwaysInBudget,
+                                releaseInBackground,
+                                heapUsage,
+                                heapBudget,
+                                createHeapLatency,
+                                residencyPriority) {
+    }
+
+    ResourceHeapAllocator::ResourceHeapAllocator(ResidencyManager* residencyManager,
+                                                 ID3D12Device* device,
+                                                 const D3D12_HEAP_PROPERTIES& heapProperties,
+                                                 D3D12_HEAP_FLAGS heapFlags,
+                                                 bool isUMA,
+                                                 bool isAlwaysInBudget,
+                                                 bool releaseInBackground,
+                                                 RelaxedCounter<uint64_t>* heapUsage,
+                                                 HeapUsageBudget* heapBudget,
+                                                 LatencyHistogram* createHeapLatency,
+                                                 D3D12_RESIDENCY_PRIORITY residencyPriority)
         : mResidencyManager(residencyManager),
           mDevice(device),
-          mHeapType(heapType),
+          mHeapProperties(heapProperties),
           mHeapFlags(heapFlags),
           mIsUMA(isUMA),
-          mIsAlwaysInBudget(isAlwaysInBudget) {
+          mIsAlwaysInBudget(isAlwaysInBudget),
+          mReleaseInBackground(releaseInBackground),
+          mHeapUsage(heapUsage),
+          mHeapBudget(heapBudget),
+          mCreateHeapLatency(createHeapLatency),
+          mCreateHeapTimer(CreatePlatformTime(PlatformTimeSource::kCycleCounter)),
+          mResidencyPriority(residencyPriority) {
+        ASSERT(mHeapProperties.Type != D3D12_HEAP_TYPE_CUSTOM || mIsUMA);
     }
 
+    ResourceHeapAllocator::~ResourceHeapAllocator() = default;
+
     std::unique_ptr<MemoryAllocation> ResourceHeapAllocator::TryAllocateMemory(
-        uint64_t size,
-        uint64_t alignment,
-        bool neverAllocate,
-        bool cacheSize,
-        bool prefetchMemory) {
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceHeapAllocator.TryAllocateMemory");
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceHeapAllocator.TryAllocateMemory");
 
         std::lock_guard<std::mutex> lock(mMutex);
 
-        if (neverAllocate) {
+        if (request.NeverAllocate) {
             return {};
         }
 
         // D3D12 requests (but not requires) the |size| be always a multiple of
         // |alignment| to avoid wasting bytes.
         // https://docs.microsoft.com/en-us/windows/win32/api/d3d12/ns-d3d12-d3d12_HEAP_INFO
-        const uint64_t heapSize = AlignTo(size, alignment);
+        const uint64_t heapSize = AlignTo(request.Size, request.Alignment);
 
         const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup =
-            GetPreferredMemorySegmentGroup(mDevice, mIsUMA, mHeapType);
+            GetPreferredMemorySegmentGroup(mDevice, mIsUMA, mHeapProperties.Type);
+
+        // Prefetched heaps are only created ahead of demand, so they must never cause another
+        // heap to be evicted.
+        if (request.PrefetchMemory && mResidencyManager != nullptr &&
+            !mResidencyManager->IsWithinBudget(heapSize, memorySegmentGroup)) {
+            return {};
+        }
+
+        // Checked before evicting, since a heap over its budget is never created.
+        if (mHeapBudget != nullptr && !mHeapBudget->TryAdd(heapSize)) {
+            DebugEvent("ResourceHeapAllocator.TryAllocateMemory",
+                       ALLOCATOR_MESSAGE_ID_SIZE_EXCEEDED)
+                << "Heap usage exceeded the heap budget (" << mHeapBudget->GetUsage() << " + "
+                << heapSize << " vs " << mHeapBudget->GetMaxUsage() << " bytes).";
+            return {};
+        }
+
+        std::unique_ptr<MemoryAllocation> allocation =
+            CreateHeap(heapSize, request.Alignment, memorySegmentGroup);
+        if (allocation == nullptr && mHeapBudget != nullptr) {
+            mHeapBudget->Subtract(heapSize);
+        }
 
+        return allocation;
+    }
+
+    std::unique_ptr<MemoryAllocation> ResourceHeapAllocator::CreateHeap(
+        uint64_t heapSize,
+        uint64_t alignment,
+        const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup) {
         // CreateHeap will implicitly make the created heap resident. We must ensure enough free
         // memory exists before allocating to avoid an out-of-memory error when overcommitted.
         if (mIsAlwaysInBudget && mResidencyManager != nullptr) {
             mResidencyManager->Evict(heapSize, memorySegmentGroup);
         }
 
-        D3D12_HEAP_PROPERTIES heapProperties = {};
-        heapProperties.Type = mHeapType;
-
         D3D12_HEAP_DESC heapDesc = {};
-        heapDesc.Properties = heapProperties;
+        heapDesc.Properties = mHeapProperties;
         heapDesc.SizeInBytes = heapSize;
         heapDesc.Alignment = alignment;
         heapDesc.Flags = mHeapFlags;
 
         ComPtr<ID3D12Heap> heap;
-        if (FAILED(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)))) {
+        const uint64_t createHeapStartTicks = mCreateHeapTimer->GetTicks();
+        const HRESULT hr = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+        if (mCreateHeapLatency != nullptr) {
+            const uint64_t createHeapLatencyInNanoseconds = mCreateHeapTimer->TicksToNanoseconds(
+                mCreateHeapTimer->GetTicks() - createHeapStartTicks);
+            mCreateHeapLatency->Record(createHeapLatencyInNanoseconds);
+            TRACE_COUNTER1(TraceEventCategory::Allocation, "GPU create heap latency (us)",
+                           createHeapLatencyInNanoseconds / 1000);
+        }
+
+        if (FAILED(hr)) {
+            return {};
+        }
+
+        // Shared heaps are re-used by the other process for as long as they are pooled, so the
+        // handle is only created once, along with the heap.
+        HANDLE sharedHandle = nullptr;
+        if ((mHeapFlags & D3D12_HEAP_FLAG_SHARED) &&
+            FAILED(mDevice->CreateSharedHandle(heap.Get(), nullptr, GENERIC_ALL, nullptr,
+                                               &sharedHandle))) {
             return {};
         }
 
-        Heap* resourceHeap = new Heap(std::move(heap), memorySegmentGroup, heapSize);
+        return AddHeap(std::move(heap), heapSize, sharedHandle);
+    }
+
+    std::unique_ptr<MemoryAllocation> ResourceHeapAllocator::ImportHeap(ComPtr<ID3D12Heap> heap) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceHeapAllocator.ImportHeap");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const uint64_t heapSize = heap->GetDesc().SizeInBytes;
+        std::unique_ptr<MemoryAllocation> allocation =
+            AddHeap(std::move(heap), heapSize, /*sharedHandle*/ nullptr);
+
+        // Imported heaps already exist, so they are counted even over budget.
+        if (allocation != nullptr && mHeapBudget != nullptr) {
+            mHeapBudget->Add(heapSize);
+        }
+
+        return allocation;
+    }
+
+    std::unique_ptr<MemoryAllocation> ResourceHeapAllocator::AddHeap(ComPtr<ID3D12Heap> heap,
+                                                                     uint64_t heapSize,
+                                                                     HANDLE sharedHandle) {
+        D3D12_RESIDENCY_PRIORITY residencyPriority = D3D12_RESIDENCY_PRIORITY_NORMAL;
+        if (mResidencyPriority != 0) {
+            ComPtr<ID3D12Device1> device1;
+            ID3D12Pageable* pageable = heap.Get();
+            if (FAILED(mDevice->QueryInterface(IID_PPV_ARGS(&device1))) ||
+                FAILED(device1->SetResidencyPriority(1, &pageable, &mResidencyPriority))) {
+                if (sharedHandle != nullptr) {
+                    CloseHandle(sharedHandle);
+                }
+                return {};
+            }
+
+            residencyPriority = mResidencyPriority;
+        }
+
+        const DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup =
+            GetPreferredMemorySegmentGroup(mDevice, mIsUMA, mHeapProperties.Type);
+
+        Heap* resourceHeap =
+            new Heap(std::move(heap), memorySegmentGroup, heapSize, residencyPriority);
+        if (sharedHandle != nullptr) {
+            resourceHeap->SetSharedHandle(sharedHandle);
+        }
 
         // Calling CreateHeap implicitly calls MakeResident on the new heap. We must track this to
         // avoid calling MakeResident a second time.
@@ -92,17 +247,41 @@ namespace gpgmm { namespace d3d12 {
         mInfo.UsedMemoryUsage += heapSize;
         mInfo.UsedMemoryCount++;
 
+        if (mHeapUsage != nullptr) {
+            *mHeapUsage += heapSize;
+        }
+
         return std::make_unique<MemoryAllocation>(this, resourceHeap);
     }
 
     void ResourceHeapAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
         std::lock_guard<std::mutex> lock(mMutex);
 
-        TRACE_EVENT0(TraceEventCategory::Default, "ResourceHeapAllocator.DeallocateMemory");
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceHeapAllocator.DeallocateMemory");
 
         mInfo.UsedMemoryUsage -= allocation->GetSize();
         mInfo.UsedMemoryCount--;
+
+        if (mHeapUsage != nullptr) {
+            *mHeapUsage -= allocation->GetSize();
+        }
+
+        if (mHeapBudget != nullptr) {
+            mHeapBudget->Subtract(allocation->GetSize());
+        }
+
+        // The heap must still be destroyed here, since it could be referenced by the residency
+        // manager, but the last reference to its pageable is released by the thread pool.
+        ComPtr<ID3D12Pageable> pageable;
+        if (mReleaseInBackground) {
+            pageable = ToBackend(allocation->GetMemory())->GetPageable();
+        }
+
         SafeRelease(allocation);
+
+        if (pageable != nullptr) {
+            ReleaseInBackground(mThreadPool, std::move(pageable));
+        }
     }
 
 }}  // namespace gpgmm::d3d12
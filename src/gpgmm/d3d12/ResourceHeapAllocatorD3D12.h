@@ -16,14 +16,48 @@
 #ifndef GPGMM_D3D12_RESOURCEHEAPALLOCATORD3D12_H_
 #define GPGMM_D3D12_RESOURCEHEAPALLOCATORD3D12_H_
 
+#include "gpgmm/LatencyHistogram.h"
 #include "gpgmm/MemoryAllocator.h"
 #include "gpgmm/d3d12/d3d12_platform.h"
 
+#include <atomic>
+#include <memory>
+
+namespace gpgmm {
+    class PlatformTime;
+}  // namespace gpgmm
+
 namespace gpgmm { namespace d3d12 {
 
     class ResidencyManager;
 
+    // Size of the heaps allocated by any number of allocators, such as every allocator of a heap
+    // type, which must not exceed |maxUsage|. Can be used from any thread.
+    class HeapUsageBudget {
+      public:
+        explicit HeapUsageBudget(uint64_t maxUsage);
+
+        // Adds |size| to the usage, unless it would exceed the max usage.
+        bool TryAdd(uint64_t size);
+
+        // Adds |size| to the usage, even should it exceed the max usage.
+        void Add(uint64_t size);
+        void Subtract(uint64_t size);
+
+        uint64_t GetUsage() const;
+        uint64_t GetMaxUsage() const;
+
+      private:
+        std::atomic<uint64_t> mUsage = {0};
+        const uint64_t mMaxUsage;
+    };
+
     // Wrapper to allocate a D3D12 heap for resources of any type.
+    // Unless nullptr, |heapUsage| is updated with the size of every heap allocated or
+    // deallocated, so the heaps of several allocators can be counted together. Likewise for
+    // |heapBudget|, except a heap which would exceed it is not allocated. Unless nullptr,
+    // |createHeapLatency| records how long the device takes to create each heap. If
+    // |releaseInBackground|, heaps are released by a worker thread once deallocated.
     class ResourceHeapAllocator final : public MemoryAllocator {
       public:
         ResourceHeapAllocator(ResidencyManager* residencyManager,
@@ -31,24 +65,64 @@ namespace gpgmm { namespace d3d12 {
                               D3D12_HEAP_TYPE heapType,
                               D3D12_HEAP_FLAGS heapFlags,
                               bool isUMA,
-                              bool isAlwaysInBudget);
-        ~ResourceHeapAllocator() override = default;
+                              bool isAlwaysInBudget,
+                              bool releaseInBackground,
+                              RelaxedCounter<uint64_t>* heapUsage,
+                              HeapUsageBudget* heapBudget,
+                              LatencyHistogram* createHeapLatency,
+                              D3D12_RESIDENCY_PRIORITY residencyPriority = {});
+
+        // Allocates heaps of |heapProperties|, such as custom heaps. Custom heaps are only
+        // supported on UMA adapters, where their memory is always local. Unless zero, heaps are
+        // allocated of |residencyPriority| instead of the default priority, which requires
+        // ID3D12Device1.
+        ResourceHeapAllocator(ResidencyManager* residencyManager,
+                              ID3D12Device* device,
+                              const D3D12_HEAP_PROPERTIES& heapProperties,
+                              D3D12_HEAP_FLAGS heapFlags,
+                              bool isUMA,
+                              bool isAlwaysInBudget,
+                              bool releaseInBackground,
+                              RelaxedCounter<uint64_t>* heapUsage,
+                              HeapUsageBudget* heapBudget,
+                              LatencyHistogram* createHeapLatency,
+                              D3D12_RESIDENCY_PRIORITY residencyPriority = {});
+        ~ResourceHeapAllocator() override;
 
         // MemoryAllocator interface
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t size,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override;
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
 
+        // Wraps a heap created outside of the allocator, which must be resident and of the same
+        // properties and flags, as if allocated by it. The heap is released once deallocated.
+        std::unique_ptr<MemoryAllocation> ImportHeap(ComPtr<ID3D12Heap> heap);
+
       private:
+        // Creates a heap of |heapSize| bytes. Called with the allocator locked.
+        std::unique_ptr<MemoryAllocation> CreateHeap(
+            uint64_t heapSize,
+            uint64_t alignment,
+            const DXGI_MEMORY_SEGMENT_GROUP& memorySegmentGroup);
+
+        // Wraps a heap once created or imported, and tracks it for residency. Called with the
+        // allocator locked. Takes ownership of |sharedHandle|, unless null.
+        std::unique_ptr<MemoryAllocation> AddHeap(ComPtr<ID3D12Heap> heap,
+                                                  uint64_t heapSize,
+                                                  HANDLE sharedHandle);
+
         ResidencyManager* const mResidencyManager;
         ID3D12Device* const mDevice;
-        const D3D12_HEAP_TYPE mHeapType;
+        const D3D12_HEAP_PROPERTIES mHeapProperties;
         const D3D12_HEAP_FLAGS mHeapFlags;
         const bool mIsUMA;
         const bool mIsAlwaysInBudget;
+        const bool mReleaseInBackground;
+        RelaxedCounter<uint64_t>* const mHeapUsage;
+        HeapUsageBudget* const mHeapBudget;
+        LatencyHistogram* const mCreateHeapLatency;
+        std::unique_ptr<PlatformTime> mCreateHeapTimer;
+        const D3D12_RESIDENCY_PRIORITY mResidencyPriority;
     };
 
 }}  // namespace gpgmm::d3d12
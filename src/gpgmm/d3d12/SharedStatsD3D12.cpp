@@ -0,0 +1,157 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/SharedStatsD3D12.h"
+
+#include "gpgmm/common/Log.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace gpgmm { namespace d3d12 {
+
+    // Reads which keep overlapping a write are given up on, rather than spinning forever should
+    // the publisher have died mid-write.
+    static constexpr uint32_t kMaxReadAttemptCount = 1000;
+
+    // static
+    HRESULT SharedStatsPublisher::Create(const std::string& name,
+                                         std::unique_ptr<SharedStatsPublisher>* publisherOut) {
+        HANDLE fileMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                                sizeof(SharedStatsBlock), name.c_str());
+        if (fileMapping == nullptr) {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            gpgmm::ErrorLog() << "Shared memory block " << name << " already exists.\n";
+            CloseHandle(fileMapping);
+            return E_INVALIDARG;
+        }
+
+        void* view = MapViewOfFile(fileMapping, FILE_MAP_WRITE, 0, 0, sizeof(SharedStatsBlock));
+        if (view == nullptr) {
+            const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+            CloseHandle(fileMapping);
+            return hr;
+        }
+
+        // Pages of a new mapping are zeroed, so the sequence number starts at zero (nothing
+        // published).
+        publisherOut->reset(
+            new SharedStatsPublisher(fileMapping, static_cast<SharedStatsBlock*>(view)));
+        return S_OK;
+    }
+
+    SharedStatsPublisher::SharedStatsPublisher(HANDLE fileMapping, SharedStatsBlock* block)
+        : mFileMapping(fileMapping), mBlock(block) {
+    }
+
+    SharedStatsPublisher::~SharedStatsPublisher() {
+        Stop();
+        UnmapViewOfFile(mBlock);
+        CloseHandle(mFileMapping);
+    }
+
+    void SharedStatsPublisher::Start(double intervalInSeconds, CollectStatsFn collectStatsFn) {
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(intervalInSeconds));
+
+        // Published once before returning, so readers never find the block empty.
+        SHARED_ALLOCATOR_STATS stats = {};
+        collectStatsFn(&stats);
+        Publish(stats);
+
+        mThread = std::thread([this, interval, collectStatsFn]() {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mStopCondition.wait_for(lock, interval, [this] { return mIsStopped; })) {
+                SHARED_ALLOCATOR_STATS stats = {};
+                collectStatsFn(&stats);
+                Publish(stats);
+            }
+        });
+    }
+
+    void SharedStatsPublisher::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsStopped = true;
+        }
+        mStopCondition.notify_all();
+
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+    }
+
+    void SharedStatsPublisher::Publish(const SHARED_ALLOCATOR_STATS& stats) {
+        SHARED_ALLOCATOR_STATS publishedStats = stats;
+        publishedStats.Version = kSharedAllocatorStatsVersion;
+        publishedStats.ProcessID = GetCurrentProcessId();
+        publishedStats.PublishCount = ++mPublishCount;
+
+        // Only this thread writes, so the sequence number is only made odd for readers.
+        const uint64_t sequence = mBlock->Sequence.load(std::memory_order_relaxed);
+        mBlock->Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&mBlock->Stats, &publishedStats, sizeof(publishedStats));
+        mBlock->Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    HRESULT ReadSharedStats(const std::string& name, SHARED_ALLOCATOR_STATS* statsOut) {
+        if (statsOut == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        HANDLE fileMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+        if (fileMapping == nullptr) {
+            return E_FAIL;
+        }
+
+        const SharedStatsBlock* block = static_cast<const SharedStatsBlock*>(
+            MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, sizeof(SharedStatsBlock)));
+        if (block == nullptr) {
+            CloseHandle(fileMapping);
+            return E_FAIL;
+        }
+
+        HRESULT hr = E_FAIL;
+        for (uint32_t attempt = 0; attempt < kMaxReadAttemptCount; attempt++) {
+            const uint64_t sequenceBefore = block->Sequence.load(std::memory_order_acquire);
+            if (sequenceBefore == 0) {
+                break;  // Nothing published yet.
+            }
+
+            if (sequenceBefore & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            SHARED_ALLOCATOR_STATS stats;
+            std::memcpy(&stats, &block->Stats, sizeof(stats));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (block->Sequence.load(std::memory_order_relaxed) == sequenceBefore) {
+                *statsOut = stats;
+                hr = S_OK;
+                break;
+            }
+        }
+
+        UnmapViewOfFile(block);
+        CloseHandle(fileMapping);
+        return hr;
+    }
+
+}}  // namespace gpgmm::d3d12
@@ -0,0 +1,83 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_SHAREDSTATSD3D12_H_
+#define GPGMM_D3D12_SHAREDSTATSD3D12_H_
+
+#include "gpgmm/common/NonCopyable.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+#include "gpgmm/d3d12/d3d12_platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace gpgmm { namespace d3d12 {
+
+    // Layout of the shared memory block, see SHARED_ALLOCATOR_STATS.
+    struct SharedStatsBlock {
+        std::atomic<uint64_t> Sequence;
+        SHARED_ALLOCATOR_STATS Stats;
+    };
+
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                  "Sequence number must be a plain uint64_t to readers.");
+
+    // Publishes the counters of an allocator to a named shared memory block, from its own thread,
+    // using a seqlock. Allocating threads never wait on readers, and readers never wait on the
+    // publisher; a read which overlapped a write is simply retried.
+    class SharedStatsPublisher final : public NonCopyable {
+      public:
+        using CollectStatsFn = std::function<void(SHARED_ALLOCATOR_STATS*)>;
+
+        // Creates the shared memory block |name|. Returns E_INVALIDARG if it already exists,
+        // since two publishers would corrupt each others counters.
+        static HRESULT Create(const std::string& name,
+                              std::unique_ptr<SharedStatsPublisher>* publisherOut);
+
+        ~SharedStatsPublisher();
+
+        // Publishes what |collectStatsFn| collects, once from the calling thread, then every
+        // |intervalInSeconds| from the thread of the publisher.
+        void Start(double intervalInSeconds, CollectStatsFn collectStatsFn);
+
+        // Stops publishing. Must be called before anything |collectStatsFn| uses is destroyed.
+        void Stop();
+
+      private:
+        SharedStatsPublisher(HANDLE fileMapping, SharedStatsBlock* block);
+
+        void Publish(const SHARED_ALLOCATOR_STATS& stats);
+
+        HANDLE mFileMapping = nullptr;
+        SharedStatsBlock* mBlock = nullptr;
+        uint64_t mPublishCount = 0;
+
+        std::thread mThread;
+        std::mutex mMutex;
+        std::condition_variable mStopCondition;
+        bool mIsStopped = false;
+    };
+
+    // Reads the counters last published to |name|. See ResourceAllocator::ReadSharedStats.
+    HRESULT ReadSharedStats(const std::string& name, SHARED_ALLOCATOR_STATS* statsOut);
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_SHAREDSTATSD3D12_H_
@@ -0,0 +1,327 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/UploadManagerD3D12.h"
+
+#include "gpgmm/RingMemoryAllocator.h"
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/common/Memcpy.h"
+#include "gpgmm/d3d12/BackendD3D12.h"
+#include "gpgmm/d3d12/BufferAllocatorD3D12.h"
+#include "gpgmm/d3d12/DefaultsD3D12.h"
+#include "gpgmm/d3d12/ErrorD3D12.h"
+#include "gpgmm/d3d12/FenceD3D12.h"
+#include "gpgmm/d3d12/HeapD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocationD3D12.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+
+namespace gpgmm { namespace d3d12 {
+
+    namespace {
+
+        // Keeps each upload in whole 16-byte blocks of the staging buffer, so streaming stores
+        // of one upload never share a block with the next.
+        static constexpr uint64_t kUploadAlignment = 16u;
+
+    }  // namespace
+
+    // static
+    HRESULT UploadManager::CreateUploadManager(const UPLOAD_MANAGER_DESC& descriptor,
+                                               UploadManager** uploadManagerOut) {
+        if (descriptor.Allocator == nullptr || descriptor.CommandQueue == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        const uint64_t stagingBufferSize =
+            AlignTo((descriptor.StagingBufferSize > 0) ? descriptor.StagingBufferSize
+                                                       : kDefaultTransientBufferSize,
+                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+        ComPtr<ID3D12Device> device;
+        ReturnIfFailed(descriptor.CommandQueue->GetDevice(IID_PPV_ARGS(&device)));
+
+        Fence* fencePtr = nullptr;
+        ReturnIfFailed(Fence::CreateFence(device, 0, &fencePtr));
+        std::unique_ptr<Fence> fence(fencePtr);
+
+        if (uploadManagerOut != nullptr) {
+            *uploadManagerOut = new UploadManager(descriptor.Allocator, std::move(device),
+                                                  descriptor.CommandQueue, std::move(fence),
+                                                  stagingBufferSize);
+        }
+
+        return S_OK;
+    }
+
+    UploadManager::UploadManager(ComPtr<ResourceAllocator> resourceAllocator,
+                                 ComPtr<ID3D12Device> device,
+                                 ComPtr<ID3D12CommandQueue> commandQueue,
+                                 std::unique_ptr<Fence> fence,
+                                 uint64_t stagingBufferSize)
+        : mResourceAllocator(std::move(resourceAllocator)),
+          mDevice(std::move(device)),
+          mCommandQueue(std::move(commandQueue)),
+          mResidencyManager(mResourceAllocator->GetResidencyManager()),
+          mCommandListType(mCommandQueue->GetDesc().Type),
+          mStagingBufferSize(stagingBufferSize),
+          mFence(std::move(fence)) {
+        ASSERT(mFence != nullptr);
+
+        mStagingAllocator = std::make_unique<RingMemoryAllocator>(
+            std::make_unique<BufferAllocator>(
+                mResourceAllocator.Get(), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE,
+                D3D12_RESOURCE_STATE_GENERIC_READ, mStagingBufferSize,
+                D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+            mStagingBufferSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    }
+
+    UploadManager::~UploadManager() {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Copies recorded but never submitted are dropped.
+        if (mIsCommandListOpen) {
+            mCommandList->Close();
+        }
+
+        // The staging buffer cannot be released while copies still read from it.
+        mFence->WaitFor(mFence->GetLastSignaledFence());
+        mStagingAllocator->RetireMemory(mFence->GetLastSignaledFence());
+
+        if (mStagingData != nullptr) {
+            mStagingBuffer->Unmap(0, nullptr);
+            if (mResidencyManager != nullptr) {
+                mResidencyManager->UnlockHeap(mStagingHeap);
+            }
+        }
+
+        mStagingBuffer = nullptr;
+        mStagingAllocator->ReleaseMemory();
+    }
+
+    HRESULT UploadManager::UploadBuffer(ID3D12Resource* dstResource,
+                                        uint64_t dstOffset,
+                                        const void* src,
+                                        uint64_t size) {
+        if (dstResource == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        return UploadBufferInternal(dstResource, dstOffset, src, size);
+    }
+
+    HRESULT UploadManager::UploadBuffer(ResourceAllocation* dstAllocation,
+                                        uint64_t dstOffset,
+                                        const void* src,
+                                        uint64_t size) {
+        if (dstAllocation == nullptr || dstAllocation->GetResource() == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        ReturnIfFailed(UploadBufferInternal(dstAllocation->GetResource(),
+                                            dstAllocation->GetOffsetFromResource() + dstOffset,
+                                            src, size));
+
+        // Fails if the resource heap was already inserted by another upload, which is fine.
+        if (mResidencyManager != nullptr) {
+            dstAllocation->UpdateResidency(&mResidencySet);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT UploadManager::UploadBufferInternal(ID3D12Resource* dstResource,
+                                                uint64_t dstOffset,
+                                                const void* src,
+                                                uint64_t size) {
+        TRACE_EVENT0(TraceEventCategory::Default, "UploadManager.UploadBuffer");
+
+        if (src == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        if (size == 0) {
+            return S_OK;
+        }
+
+        if (size > mStagingBufferSize) {
+            return E_OUTOFMEMORY;
+        }
+
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = size;
+        request.Alignment = kUploadAlignment;
+
+        // Staging space belongs to the submission which will copy from it.
+        mStagingAllocator->SetPendingSerial(mFence->GetCurrentFence());
+
+        std::unique_ptr<MemoryAllocation> stagingAllocation =
+            mStagingAllocator->TryAllocateMemory(request);
+        if (stagingAllocation == nullptr) {
+            // Every submission must complete for the staging buffer to be empty again.
+            if (mRecordedCopyCount > 0) {
+                ReturnIfFailed(SubmitInternal());
+            }
+            ReturnIfFailed(mFence->WaitFor(mFence->GetLastSignaledFence()));
+            RetireSubmissions();
+
+            mStagingAllocator->SetPendingSerial(mFence->GetCurrentFence());
+            stagingAllocation = mStagingAllocator->TryAllocateMemory(request);
+            if (stagingAllocation == nullptr) {
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        // The staging buffer is only mapped once, then kept mapped until destroyed.
+        if (mStagingData == nullptr) {
+            Heap* stagingHeap = ToBackend(stagingAllocation->GetMemory());
+            ComPtr<ID3D12Resource> stagingBuffer = stagingHeap->GetPlacedBuffer();
+            if (stagingBuffer == nullptr) {
+                ReturnIfFailed(stagingHeap->GetPageable().As(&stagingBuffer));
+            }
+
+            if (mResidencyManager != nullptr) {
+                ReturnIfFailed(mResidencyManager->LockHeap(stagingHeap));
+            }
+
+            // Nothing is read back.
+            const D3D12_RANGE readRange = {0, 0};
+            void* stagingData = nullptr;
+            const HRESULT hr = stagingBuffer->Map(0, &readRange, &stagingData);
+            if (FAILED(hr)) {
+                if (mResidencyManager != nullptr) {
+                    mResidencyManager->UnlockHeap(stagingHeap);
+                }
+                mStagingAllocator->DeallocateMemory(std::move(stagingAllocation));
+                return hr;
+            }
+
+            mStagingHeap = stagingHeap;
+            mStagingBuffer = std::move(stagingBuffer);
+            mStagingData = static_cast<uint8_t*>(stagingData);
+        }
+
+        ASSERT(ToBackend(stagingAllocation->GetMemory()) == mStagingHeap);
+
+        const uint64_t stagingOffset = stagingAllocation->GetOffset();
+        CopyToWriteCombined(mStagingData + stagingOffset, src, static_cast<size_t>(size));
+
+        // Space is only re-used once the submission retires, so the allocation can be released
+        // right away.
+        mStagingAllocator->DeallocateMemory(std::move(stagingAllocation));
+
+        ReturnIfFailed(OpenCommandList());
+        mCommandList->CopyBufferRegion(dstResource, dstOffset, mStagingBuffer.Get(), stagingOffset,
+                                       size);
+        mRecordedCopyCount++;
+
+        return S_OK;
+    }
+
+    HRESULT UploadManager::OpenCommandList() {
+        if (mIsCommandListOpen) {
+            return S_OK;
+        }
+
+        RetireSubmissions();
+
+        // Re-use the command allocator of the oldest submission, once completed.
+        if (!mInflightAllocators.empty() &&
+            mFence->IsCompleted(mInflightAllocators.front().first)) {
+            mCommandAllocator = std::move(mInflightAllocators.front().second);
+            mInflightAllocators.pop_front();
+            ReturnIfFailed(mCommandAllocator->Reset());
+        } else {
+            ReturnIfFailed(mDevice->CreateCommandAllocator(mCommandListType,
+                                                           IID_PPV_ARGS(&mCommandAllocator)));
+        }
+
+        if (mCommandList == nullptr) {
+            ReturnIfFailed(mDevice->CreateCommandList(0, mCommandListType, mCommandAllocator.Get(),
+                                                      nullptr, IID_PPV_ARGS(&mCommandList)));
+        } else {
+            ReturnIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
+        }
+
+        mIsCommandListOpen = true;
+        return S_OK;
+    }
+
+    HRESULT UploadManager::Submit(uint64_t* fenceValueOut) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRecordedCopyCount > 0) {
+            ReturnIfFailed(SubmitInternal());
+        }
+
+        if (fenceValueOut != nullptr) {
+            *fenceValueOut = mFence->GetLastSignaledFence();
+        }
+
+        return S_OK;
+    }
+
+    HRESULT UploadManager::SubmitInternal() {
+        TRACE_EVENT0(TraceEventCategory::Default, "UploadManager.Submit");
+
+        ASSERT(mIsCommandListOpen);
+        ReturnIfFailed(mCommandList->Close());
+        mIsCommandListOpen = false;
+
+        ID3D12CommandList* commandLists[] = {mCommandList.Get()};
+        if (mResidencyManager != nullptr) {
+            ResidencySet* residencySets[] = {&mResidencySet};
+            ReturnIfFailed(mResidencyManager->ExecuteCommandLists(
+                mCommandQueue.Get(), commandLists, residencySets, 1));
+        } else {
+            mCommandQueue->ExecuteCommandLists(1, commandLists);
+        }
+
+        ReturnIfFailed(mFence->Signal(mCommandQueue.Get()));
+
+        mInflightAllocators.emplace_back(mFence->GetLastSignaledFence(),
+                                         std::move(mCommandAllocator));
+        mRecordedCopyCount = 0;
+        return mResidencySet.Reset();
+    }
+
+    HRESULT UploadManager::Wait(ID3D12CommandQueue* queue) {
+        if (queue == nullptr) {
+            return E_INVALIDARG;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFence->Wait(queue);
+    }
+
+    HRESULT UploadManager::WaitFor(uint64_t fenceValue) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ReturnIfFailed(mFence->WaitFor(fenceValue));
+        RetireSubmissions();
+        return S_OK;
+    }
+
+    uint64_t UploadManager::GetCompletedFenceValue() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFence->GetCompletedValue();
+    }
+
+    void UploadManager::RetireSubmissions() {
+        mStagingAllocator->RetireMemory(mFence->GetCompletedValue());
+    }
+
+}}  // namespace gpgmm::d3d12
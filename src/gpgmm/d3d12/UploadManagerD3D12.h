@@ -0,0 +1,151 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_UPLOADMANAGERD3D12_H_
+#define GPGMM_D3D12_UPLOADMANAGERD3D12_H_
+
+#include "gpgmm/d3d12/IUnknownImplD3D12.h"
+#include "gpgmm/d3d12/ResidencySetD3D12.h"
+#include "gpgmm/d3d12/d3d12_platform.h"
+#include "include/gpgmm_export.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace gpgmm {
+    class RingMemoryAllocator;
+}  // namespace gpgmm
+
+namespace gpgmm { namespace d3d12 {
+
+    class Fence;
+    class Heap;
+    class ResidencyManager;
+    class ResourceAllocation;
+    class ResourceAllocator;
+
+    struct UPLOAD_MANAGER_DESC {
+        // Allocator which creates the staging buffer.
+        ResourceAllocator* Allocator = nullptr;
+
+        // Queue which executes the copies, typically of D3D12_COMMAND_LIST_TYPE_COPY. The upload
+        // manager signals its own fence on it.
+        ID3D12CommandQueue* CommandQueue = nullptr;
+
+        // Size of the staging buffer uploads are copied from, in bytes. Bounds the largest
+        // upload and how much can be uploaded before waiting on the GPU.
+        //
+        // Optional parameter. When 0 is specified, the API will automatically set the staging
+        // buffer size to the default value of 4MB.
+        uint64_t StagingBufferSize = 0;
+    };
+
+    // Uploads data into buffers through a single upload buffer, used as a ring and created upon
+    // first use. Uploads are recorded into one copy command list until Submit, which executes
+    // them at once and signals a fence. Staging space is re-used once the fence value of the
+    // submission which copied from it completes, so uploading never creates a resource.
+    //
+    // Destination buffers must be in the D3D12_RESOURCE_STATE_COMMON state, or one which the
+    // copy queue promotes from it, and must not be used by another queue until the fence value
+    // returned by Submit completes, such as by calling Wait on that queue.
+    class GPGMM_EXPORT UploadManager final : public IUnknownImpl {
+      public:
+        static HRESULT CreateUploadManager(const UPLOAD_MANAGER_DESC& descriptor,
+                                           UploadManager** uploadManagerOut);
+
+        // Waits for every submission to complete.
+        ~UploadManager() override;
+
+        // Records a copy of |size| bytes from |src| to |dstResource| at |dstOffset|. |src| can
+        // be re-used once this returns. Should the staging buffer be full, recorded copies are
+        // submitted and the calling thread blocks until they complete. Returns E_OUTOFMEMORY
+        // if |size| is larger than the staging buffer.
+        HRESULT UploadBuffer(ID3D12Resource* dstResource,
+                             uint64_t dstOffset,
+                             const void* src,
+                             uint64_t size);
+
+        // Equivalent to UploadBuffer except |dstOffset| is from the start of the allocation, and
+        // the resource heap of the allocation is made resident for the copy.
+        HRESULT UploadBuffer(ResourceAllocation* dstAllocation,
+                             uint64_t dstOffset,
+                             const void* src,
+                             uint64_t size);
+
+        // Executes every copy recorded since the last submission, then signals the fence.
+        // Returns the fence value which completes once the copies complete, or the last one
+        // signaled if nothing was recorded.
+        HRESULT Submit(uint64_t* fenceValueOut = nullptr);
+
+        // Makes |queue| wait, on the GPU, for the last submission to complete.
+        HRESULT Wait(ID3D12CommandQueue* queue);
+
+        // Blocks the calling thread until |fenceValue| completes.
+        HRESULT WaitFor(uint64_t fenceValue);
+
+        // Returns the last fence value completed, without waiting.
+        uint64_t GetCompletedFenceValue();
+
+      private:
+        UploadManager(ComPtr<ResourceAllocator> resourceAllocator,
+                      ComPtr<ID3D12Device> device,
+                      ComPtr<ID3D12CommandQueue> commandQueue,
+                      std::unique_ptr<Fence> fence,
+                      uint64_t stagingBufferSize);
+
+        HRESULT UploadBufferInternal(ID3D12Resource* dstResource,
+                                     uint64_t dstOffset,
+                                     const void* src,
+                                     uint64_t size);
+        HRESULT OpenCommandList();
+        HRESULT SubmitInternal();
+
+        // Frees staging space and command allocators of completed submissions.
+        void RetireSubmissions();
+
+        // Declared before the staging allocator so the resource allocator, which creates the
+        // staging buffer, outlives it.
+        ComPtr<ResourceAllocator> mResourceAllocator;
+        ComPtr<ID3D12Device> mDevice;
+        ComPtr<ID3D12CommandQueue> mCommandQueue;
+        ResidencyManager* const mResidencyManager;
+
+        const D3D12_COMMAND_LIST_TYPE mCommandListType;
+        const uint64_t mStagingBufferSize;
+
+        std::mutex mMutex;
+
+        // Guarded by mMutex.
+        std::unique_ptr<Fence> mFence;
+        std::unique_ptr<RingMemoryAllocator> mStagingAllocator;
+        Heap* mStagingHeap = nullptr;  // Locked resident while mapped.
+        ComPtr<ID3D12Resource> mStagingBuffer;
+        uint8_t* mStagingData = nullptr;
+
+        ComPtr<ID3D12GraphicsCommandList> mCommandList;
+        ComPtr<ID3D12CommandAllocator> mCommandAllocator;
+        bool mIsCommandListOpen = false;
+        uint64_t mRecordedCopyCount = 0;
+        ResidencySet mResidencySet;
+
+        // Command allocators of submissions, by the fence value which completes them.
+        std::deque<std::pair<uint64_t, ComPtr<ID3D12CommandAllocator>>> mInflightAllocators;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_UPLOADMANAGERD3D12_H_
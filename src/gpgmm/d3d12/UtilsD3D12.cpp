@@ -14,14 +14,34 @@
 
 #include "gpgmm/d3d12/UtilsD3D12.h"
 
+#include "gpgmm/WorkerThread.h"
 #include "gpgmm/common/Math.h"
 
 namespace gpgmm { namespace d3d12 {
 
+    namespace {
+
+        class ReleasePageableTask : public VoidCallback {
+          public:
+            explicit ReleasePageableTask(ComPtr<ID3D12Pageable> pageable)
+                : mPageable(std::move(pageable)) {
+            }
+
+            void operator()() override {
+                mPageable = nullptr;
+            }
+
+          private:
+            ComPtr<ID3D12Pageable> mPageable;
+        };
+
+    }  // namespace
+
     DXGI_MEMORY_SEGMENT_GROUP GetPreferredMemorySegmentGroup(ID3D12Device* device,
                                                              bool isUMA,
                                                              D3D12_HEAP_TYPE heapType) {
-        if (isUMA) {
+        // GPU upload heaps are only known by newer runtimes, and are always in video memory.
+        if (isUMA || heapType == kHeapTypeGPUUpload) {
             return DXGI_MEMORY_SEGMENT_GROUP_LOCAL;
         }
 
@@ -425,4 +445,17 @@ namespace gpgmm { namespace d3d12 {
         return GetTileCount(resourceDescriptor, tile) <= 16;
     }
 
+    void ReleaseInBackground(const std::shared_ptr<ThreadPool>& threadPool,
+                             ComPtr<ID3D12Pageable> pageable) {
+        // Released immediately once the thread pool is gone, such as while the allocator is
+        // being destroyed.
+        if (threadPool == nullptr) {
+            return;
+        }
+
+        ThreadPool::PostTask(threadPool,
+                             std::make_shared<ReleasePageableTask>(std::move(pageable)),
+                             TaskClass::kRelease);
+    }
+
 }}  // namespace gpgmm::d3d12
@@ -16,6 +16,12 @@
 
 #include "gpgmm/d3d12/d3d12_platform.h"
 
+#include <memory>
+
+namespace gpgmm {
+    class ThreadPool;
+}  // namespace gpgmm
+
 namespace gpgmm { namespace d3d12 {
 
     DXGI_MEMORY_SEGMENT_GROUP GetPreferredMemorySegmentGroup(ID3D12Device* device,
@@ -24,6 +30,11 @@ namespace gpgmm { namespace d3d12 {
     bool IsDepthFormat(DXGI_FORMAT format);
     bool IsAllowedToUseSmallAlignment(const D3D12_RESOURCE_DESC& Desc);
 
+    // Releases |pageable| on |threadPool| instead of the calling thread, since the driver could
+    // spend milliseconds freeing its pages once the last reference is released.
+    void ReleaseInBackground(const std::shared_ptr<ThreadPool>& threadPool,
+                             ComPtr<ID3D12Pageable> pageable);
+
 }}  // namespace gpgmm::d3d12
 
 #endif  // GPGMM_D3D12_UTILSD3D12_H_
@@ -0,0 +1,159 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/d3d12/WarmUpProfileD3D12.h"
+
+#include "gpgmm/common/Assert.h"
+
+#include <cstring>
+#include <utility>
+
+namespace gpgmm { namespace d3d12 {
+
+    namespace {
+
+        // Bounds the size of the profile when resource sizes vary a lot, such as render targets
+        // sized by the window.
+        static constexpr size_t kMaxWarmUpProfileEntryCount = 1024u;
+
+        // Only the flags which determine the resource heap type are kept, so resources placed
+        // in the same resource heaps share an entry.
+        static const D3D12_RESOURCE_FLAGS kWarmUpProfileResourceFlagsMask =
+            D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+        template <typename T>
+        void WriteValue(std::ostream& stream, const T& value) {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        bool ReadValue(std::istream& stream, T* value) {
+            stream.read(reinterpret_cast<char*>(value), sizeof(T));
+            return static_cast<size_t>(stream.gcount()) == sizeof(T);
+        }
+
+    }  // namespace
+
+    // WarmUpProfileRecorder
+
+    WarmUpProfileEntry* WarmUpProfileRecorder::RecordAllocation(
+        const ALLOCATOR_WARM_UP_DESC& desc) {
+        const D3D12_RESOURCE_FLAGS resourceFlags =
+            desc.ResourceFlags & kWarmUpProfileResourceFlagsMask;
+        const EntryKey key = {desc.HeapType, desc.Dimension, resourceFlags, desc.SizeInBytes,
+                              desc.Alignment};
+
+        WarmUpProfileEntry* entry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(key);
+            if (it == mEntries.end()) {
+                if (mEntries.size() >= kMaxWarmUpProfileEntryCount) {
+                    return nullptr;
+                }
+                std::unique_ptr<WarmUpProfileEntry> newEntry =
+                    std::make_unique<WarmUpProfileEntry>();
+                newEntry->Desc = desc;
+                newEntry->Desc.ResourceFlags = resourceFlags;
+                newEntry->Desc.Count = 0;
+                it = mEntries.emplace(key, std::move(newEntry)).first;
+            }
+            entry = it->second.get();
+        }
+
+        const uint64_t liveCount = entry->LiveCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t peakCount = entry->PeakCount.load(std::memory_order_relaxed);
+        while (liveCount > peakCount &&
+               !entry->PeakCount.compare_exchange_weak(peakCount, liveCount,
+                                                       std::memory_order_relaxed)) {
+        }
+
+        return entry;
+    }
+
+    // static
+    void WarmUpProfileRecorder::RecordDeallocation(WarmUpProfileEntry* entry) {
+        ASSERT(entry != nullptr);
+        ASSERT(entry->LiveCount.load(std::memory_order_relaxed) > 0);
+        entry->LiveCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::vector<ALLOCATOR_WARM_UP_DESC> WarmUpProfileRecorder::GetProfile() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<ALLOCATOR_WARM_UP_DESC> profile;
+        profile.reserve(mEntries.size());
+        for (const auto& it : mEntries) {
+            ALLOCATOR_WARM_UP_DESC desc = it.second->Desc;
+            desc.Count = it.second->PeakCount.load(std::memory_order_relaxed);
+            profile.push_back(desc);
+        }
+        return profile;
+    }
+
+    bool WriteWarmUpProfile(const std::vector<ALLOCATOR_WARM_UP_DESC>& profile,
+                            std::ostream& stream) {
+        WARM_UP_PROFILE_HEADER header = {};
+        std::memcpy(header.Magic, kWarmUpProfileMagic, sizeof(header.Magic));
+        header.Version = kWarmUpProfileVersion;
+        header.Count = static_cast<uint32_t>(profile.size());
+        WriteValue(stream, header);
+
+        for (const ALLOCATOR_WARM_UP_DESC& desc : profile) {
+            WARM_UP_PROFILE_RECORD record = {};
+            record.SizeInBytes = desc.SizeInBytes;
+            record.Alignment = desc.Alignment;
+            record.Count = desc.Count;
+            record.HeapType = static_cast<uint32_t>(desc.HeapType);
+            record.Dimension = static_cast<uint32_t>(desc.Dimension);
+            record.ResourceFlags = static_cast<uint32_t>(desc.ResourceFlags);
+            WriteValue(stream, record);
+        }
+
+        stream.flush();
+        return stream.good();
+    }
+
+    bool ReadWarmUpProfile(std::istream& stream, std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut) {
+        WARM_UP_PROFILE_HEADER header = {};
+        if (!ReadValue(stream, &header) ||
+            std::memcmp(header.Magic, kWarmUpProfileMagic, sizeof(header.Magic)) != 0 ||
+            header.Version != kWarmUpProfileVersion) {
+            return false;
+        }
+
+        std::vector<ALLOCATOR_WARM_UP_DESC> profile;
+        for (uint32_t i = 0; i < header.Count; i++) {
+            WARM_UP_PROFILE_RECORD record = {};
+            if (!ReadValue(stream, &record)) {
+                return false;
+            }
+
+            ALLOCATOR_WARM_UP_DESC desc = {};
+            desc.HeapType = static_cast<D3D12_HEAP_TYPE>(record.HeapType);
+            desc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(record.Dimension);
+            desc.ResourceFlags = static_cast<D3D12_RESOURCE_FLAGS>(record.ResourceFlags);
+            desc.SizeInBytes = record.SizeInBytes;
+            desc.Alignment = record.Alignment;
+            desc.Count = record.Count;
+            profile.push_back(desc);
+        }
+
+        if (profileOut != nullptr) {
+            *profileOut = std::move(profile);
+        }
+
+        return true;
+    }
+
+}}  // namespace gpgmm::d3d12
@@ -0,0 +1,100 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_D3D12_WARMUPPROFILED3D12_H_
+#define GPGMM_D3D12_WARMUPPROFILED3D12_H_
+
+#include "gpgmm/common/NonCopyable.h"
+#include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+namespace gpgmm { namespace d3d12 {
+
+    static constexpr char kWarmUpProfileMagic[8] = {'G', 'P', 'G', 'M', 'M', 'W', 'U', 'P'};
+    static constexpr uint32_t kWarmUpProfileVersion = 1;
+
+    struct WARM_UP_PROFILE_HEADER {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t Count;  // Number of records which follow.
+    };
+
+    static_assert(sizeof(WARM_UP_PROFILE_HEADER) == 16, "Header layout must not change.");
+
+    // Fixed-size record of a ALLOCATOR_WARM_UP_DESC.
+    struct WARM_UP_PROFILE_RECORD {
+        uint64_t SizeInBytes;
+        uint64_t Alignment;
+        uint64_t Count;
+        uint32_t HeapType;
+        uint32_t Dimension;
+        uint32_t ResourceFlags;
+        uint32_t Reserved;
+    };
+
+    static_assert(sizeof(WARM_UP_PROFILE_RECORD) == 40, "Record layout must not change.");
+
+    // Counts the resource allocations of the same ALLOCATOR_WARM_UP_DESC.
+    struct WarmUpProfileEntry {
+        ALLOCATOR_WARM_UP_DESC Desc = {};
+
+        std::atomic<uint64_t> LiveCount = {0};
+
+        // Most resource allocations which existed at once.
+        std::atomic<uint64_t> PeakCount = {0};
+    };
+
+    // Learns the warm-up profile of a resource allocator, from the resources it sub-allocates.
+    // Each resource allocation remembers its entry, so only creating a resource allocation of a
+    // new size locks.
+    class WarmUpProfileRecorder final : public NonCopyable {
+      public:
+        // Counts a resource allocation of |desc| and returns the entry to uncount it with, or
+        // nullptr if too many sizes were recorded already.
+        WarmUpProfileEntry* RecordAllocation(const ALLOCATOR_WARM_UP_DESC& desc);
+
+        static void RecordDeallocation(WarmUpProfileEntry* entry);
+
+        // Returns the peak count of every size recorded so far.
+        std::vector<ALLOCATOR_WARM_UP_DESC> GetProfile() const;
+
+      private:
+        using EntryKey = std::tuple<D3D12_HEAP_TYPE,
+                                    D3D12_RESOURCE_DIMENSION,
+                                    D3D12_RESOURCE_FLAGS,
+                                    uint64_t,
+                                    uint64_t>;
+
+        mutable std::mutex mMutex;
+
+        // Entries are never removed, so pointers to them stay valid.
+        std::map<EntryKey, std::unique_ptr<WarmUpProfileEntry>> mEntries;
+    };
+
+    bool WriteWarmUpProfile(const std::vector<ALLOCATOR_WARM_UP_DESC>& profile,
+                            std::ostream& stream);
+    bool ReadWarmUpProfile(std::istream& stream, std::vector<ALLOCATOR_WARM_UP_DESC>* profileOut);
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // GPGMM_D3D12_WARMUPPROFILED3D12_H_
@@ -22,4 +22,20 @@
 
 using Microsoft::WRL::ComPtr;
 
+namespace gpgmm { namespace d3d12 {
+
+    // D3D12_HEAP_TYPE_GPU_UPLOAD, CPU-visible video memory through resizable BAR. Declared here
+    // since only newer SDKs declare it, but any runtime can be asked whether it is supported.
+    static constexpr D3D12_HEAP_TYPE kHeapTypeGPUUpload = static_cast<D3D12_HEAP_TYPE>(5);
+
+    // D3D12_FEATURE_D3D12_OPTIONS16 and D3D12_FEATURE_DATA_D3D12_OPTIONS16, for the same reason.
+    static constexpr D3D12_FEATURE kFeatureD3D12Options16 = static_cast<D3D12_FEATURE>(45);
+
+    struct FEATURE_DATA_D3D12_OPTIONS16 {
+        BOOL DynamicDepthBiasSupported;
+        BOOL GPUUploadHeapSupported;
+    };
+
+}}  // namespace gpgmm::d3d12
+
 #endif  // GPGMM_D3D12_D3D12PLATFORM_H_
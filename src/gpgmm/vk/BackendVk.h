@@ -12,30 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "RefCount.h"
+#ifndef GPGMM_VK_BACKENDVK_H_
+#define GPGMM_VK_BACKENDVK_H_
 
-namespace gpgmm {
+#include "gpgmm/Backend.h"
 
-    RefCounted::RefCounted(int_fast32_t initialCount) : mRef(initialCount) {
-    }
+namespace gpgmm { namespace vk {
 
-    void RefCounted::Ref() {
-        mRef.fetch_add(1, std::memory_order_relaxed);
-    }
+    class DeviceMemory;
+    class ResourceAllocation;
 
-    bool RefCounted::Unref() {
-        if (mRef.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-            return true;
-        }
-        return false;
-    }
+    struct BackendTrait {
+        using MemoryType = DeviceMemory;
+        using AllocationType = ResourceAllocation;
+    };
 
-    int_fast32_t RefCounted::GetRefCount() const {
-        return mRef.load(std::memory_order_acquire);
+    template <typename T>
+    auto ToBackend(T&& common) -> decltype(gpgmm::ToBackend<BackendTrait>(common)) {
+        return gpgmm::ToBackend<BackendTrait>(common);
     }
 
-    bool RefCounted::HasOneRef() const {
-        return GetRefCount() == 1;
-    }
+}}  // namespace gpgmm::vk
 
-}  // namespace gpgmm
+#endif  // GPGMM_VK_BACKENDVK_H_
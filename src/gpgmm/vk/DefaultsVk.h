@@ -0,0 +1,28 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_DEFAULTSVK_H_
+#define GPGMM_VK_DEFAULTSVK_H_
+
+#include "gpgmm/Defaults.h"
+
+namespace gpgmm { namespace vk {
+
+    static constexpr uint64_t kDefaultPreferredDeviceMemorySize = 4ll * 1024ll * 1024ll;  // 4MB
+    static constexpr uint64_t kDefaultMinBlockSize = 256;                                // 256B
+    static constexpr float kDefaultMaxMemoryBudget = 0.95f;                              // 95%
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_DEFAULTSVK_H_
@@ -0,0 +1,87 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/vk/DeviceMemoryAllocatorVk.h"
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/common/Utils.h"
+#include "gpgmm/vk/DeviceMemoryVk.h"
+#include "gpgmm/vk/ResidencyManagerVk.h"
+
+namespace gpgmm { namespace vk {
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator(ResidencyManager* residencyManager,
+                                                 VkDevice device,
+                                                 uint32_t memoryTypeIndex,
+                                                 uint32_t memoryHeapIndex,
+                                                 bool isAlwaysInBudget)
+        : mResidencyManager(residencyManager),
+          mDevice(device),
+          mMemoryTypeIndex(memoryTypeIndex),
+          mMemoryHeapIndex(memoryHeapIndex),
+          mIsAlwaysInBudget(isAlwaysInBudget) {
+    }
+
+    std::unique_ptr<MemoryAllocation> DeviceMemoryAllocator::TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "DeviceMemoryAllocator.TryAllocateMemory");
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (request.NeverAllocate) {
+            return {};
+        }
+
+        // Device memory is always aligned to the largest alignment a resource could require, so
+        // only the size must be a multiple of |alignment| to be fully used.
+        const uint64_t memorySize = AlignTo(request.Size, request.Alignment);
+
+        // Prefetched memory is only allocated ahead of demand, so it must never cause the memory
+        // heap to exceed its budget.
+        if ((request.PrefetchMemory || mIsAlwaysInBudget) && mResidencyManager != nullptr &&
+            !mResidencyManager->IsWithinBudget(memorySize, mMemoryHeapIndex)) {
+            return {};
+        }
+
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = memorySize;
+        allocateInfo.memoryTypeIndex = mMemoryTypeIndex;
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (vkAllocateMemory(mDevice, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+            return {};
+        }
+
+        mInfo.UsedMemoryUsage += memorySize;
+        mInfo.UsedMemoryCount++;
+
+        return std::make_unique<MemoryAllocation>(
+            this,
+            new DeviceMemory(mDevice, memory, mMemoryTypeIndex, mMemoryHeapIndex, memorySize));
+    }
+
+    void DeviceMemoryAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        TRACE_EVENT0(TraceEventCategory::Allocation, "DeviceMemoryAllocator.DeallocateMemory");
+
+        mInfo.UsedMemoryUsage -= allocation->GetSize();
+        mInfo.UsedMemoryCount--;
+
+        SafeRelease(allocation);
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,52 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_DEVICEMEMORYALLOCATORVK_H_
+#define GPGMM_VK_DEVICEMEMORYALLOCATORVK_H_
+
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/vk/vk_platform.h"
+
+namespace gpgmm { namespace vk {
+
+    class ResidencyManager;
+
+    // Wrapper to allocate device memory of a single memory type.
+    // Unless |residencyManager| is nullptr, prefetched memory is only allocated within the budget
+    // of its memory heap, and so is all memory if |isAlwaysInBudget|.
+    class DeviceMemoryAllocator final : public MemoryAllocator {
+      public:
+        DeviceMemoryAllocator(ResidencyManager* residencyManager,
+                              VkDevice device,
+                              uint32_t memoryTypeIndex,
+                              uint32_t memoryHeapIndex,
+                              bool isAlwaysInBudget);
+        ~DeviceMemoryAllocator() override = default;
+
+        // MemoryAllocator interface
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override;
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+
+      private:
+        ResidencyManager* const mResidencyManager;
+        const VkDevice mDevice;
+        const uint32_t mMemoryTypeIndex;
+        const uint32_t mMemoryHeapIndex;
+        const bool mIsAlwaysInBudget;
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_DEVICEMEMORYALLOCATORVK_H_
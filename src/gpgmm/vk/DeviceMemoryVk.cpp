@@ -0,0 +1,75 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/vk/DeviceMemoryVk.h"
+
+#include "gpgmm/common/Assert.h"
+
+namespace gpgmm { namespace vk {
+
+    DeviceMemory::DeviceMemory(VkDevice device,
+                               VkDeviceMemory memory,
+                               uint32_t memoryTypeIndex,
+                               uint32_t memoryHeapIndex,
+                               uint64_t size)
+        : MemoryBase(size),
+          mDevice(device),
+          mMemory(memory),
+          mMemoryTypeIndex(memoryTypeIndex),
+          mMemoryHeapIndex(memoryHeapIndex) {
+        ASSERT(mMemory != VK_NULL_HANDLE);
+    }
+
+    DeviceMemory::~DeviceMemory() {
+        ASSERT(mMapRefCount == 0);
+        vkFreeMemory(mDevice, mMemory, nullptr);
+    }
+
+    VkDeviceMemory DeviceMemory::GetDeviceMemory() const {
+        return mMemory;
+    }
+
+    uint32_t DeviceMemory::GetMemoryTypeIndex() const {
+        return mMemoryTypeIndex;
+    }
+
+    uint32_t DeviceMemory::GetMemoryHeapIndex() const {
+        return mMemoryHeapIndex;
+    }
+
+    VkResult DeviceMemory::Map(void** dataOut) {
+        std::lock_guard<std::mutex> lock(mMapMutex);
+        if (mMapRefCount == 0) {
+            const VkResult result =
+                vkMapMemory(mDevice, mMemory, 0, VK_WHOLE_SIZE, 0, &mMappedPointer);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+        }
+
+        mMapRefCount++;
+        *dataOut = mMappedPointer;
+        return VK_SUCCESS;
+    }
+
+    void DeviceMemory::Unmap() {
+        std::lock_guard<std::mutex> lock(mMapMutex);
+        ASSERT(mMapRefCount > 0);
+        if (--mMapRefCount == 0) {
+            vkUnmapMemory(mDevice, mMemory);
+            mMappedPointer = nullptr;
+        }
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,62 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_DEVICEMEMORYVK_H_
+#define GPGMM_VK_DEVICEMEMORYVK_H_
+
+#include "gpgmm/Memory.h"
+#include "gpgmm/vk/vk_platform.h"
+#include "include/gpgmm_export.h"
+
+#include <mutex>
+
+namespace gpgmm { namespace vk {
+
+    class ResourceAllocation;
+
+    // Represents a VkDeviceMemory of a single memory type, which resources are bound within.
+    class GPGMM_EXPORT DeviceMemory final : public MemoryBase {
+      public:
+        DeviceMemory(VkDevice device,
+                     VkDeviceMemory memory,
+                     uint32_t memoryTypeIndex,
+                     uint32_t memoryHeapIndex,
+                     uint64_t size);
+        ~DeviceMemory() override;
+
+        VkDeviceMemory GetDeviceMemory() const;
+        uint32_t GetMemoryTypeIndex() const;
+        uint32_t GetMemoryHeapIndex() const;
+
+      private:
+        friend ResourceAllocation;
+
+        // Device memory cannot be mapped more than once, so allocations within the same memory
+        // share a single mapping of the whole memory, which is unmapped once unused.
+        VkResult Map(void** dataOut);
+        void Unmap();
+
+        const VkDevice mDevice;
+        const VkDeviceMemory mMemory;
+        const uint32_t mMemoryTypeIndex;
+        const uint32_t mMemoryHeapIndex;
+
+        std::mutex mMapMutex;
+        uint32_t mMapRefCount = 0;
+        void* mMappedPointer = nullptr;
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_DEVICEMEMORYVK_H_
@@ -0,0 +1,116 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/vk/ResidencyManagerVk.h"
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
+
+#include <memory>
+
+namespace gpgmm { namespace vk {
+
+    // static
+    VkResult ResidencyManager::CreateResidencyManager(VkPhysicalDevice physicalDevice,
+                                                      float maxMemoryBudget,
+                                                      ResidencyManager** residencyManagerOut) {
+        if (physicalDevice == VK_NULL_HANDLE || residencyManagerOut == nullptr) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        if (maxMemoryBudget <= 0.0f || maxMemoryBudget > 1.0f) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        VkPhysicalDeviceMemoryProperties memoryProperties = {};
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        std::unique_ptr<ResidencyManager> residencyManager(new ResidencyManager(
+            physicalDevice, maxMemoryBudget, memoryProperties.memoryHeapCount));
+
+        const VkResult result = residencyManager->UpdateMemoryBudget();
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        *residencyManagerOut = residencyManager.release();
+        return VK_SUCCESS;
+    }
+
+    ResidencyManager::ResidencyManager(VkPhysicalDevice physicalDevice,
+                                       float maxMemoryBudget,
+                                       uint32_t memoryHeapCount)
+        : mPhysicalDevice(physicalDevice),
+          mMaxMemoryBudget(maxMemoryBudget),
+          mMemoryHeapCount(memoryHeapCount) {
+        ASSERT(mMemoryHeapCount <= VK_MAX_MEMORY_HEAPS);
+    }
+
+    ResidencyManager::~ResidencyManager() = default;
+
+    VkResult ResidencyManager::UpdateMemoryBudget() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return UpdateMemoryBudgetInternal();
+    }
+
+    VkResult ResidencyManager::UpdateMemoryBudgetInternal() {
+        TRACE_EVENT0(TraceEventCategory::Residency, "ResidencyManager.UpdateMemoryBudget");
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudgetProperties = {};
+        memoryBudgetProperties.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = &memoryBudgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memoryProperties);
+
+        for (uint32_t heapIndex = 0; heapIndex < mMemoryHeapCount; heapIndex++) {
+            MEMORY_BUDGET_INFO& memoryBudget = mMemoryBudgetOfHeap[heapIndex];
+            memoryBudget.Budget = static_cast<uint64_t>(
+                memoryBudgetProperties.heapBudget[heapIndex] * mMaxMemoryBudget);
+            memoryBudget.Usage = memoryBudgetProperties.heapUsage[heapIndex];
+        }
+
+        return VK_SUCCESS;
+    }
+
+    VkResult ResidencyManager::QueryMemoryBudget(uint32_t memoryHeapIndex,
+                                                 MEMORY_BUDGET_INFO* budgetOut) {
+        if (memoryHeapIndex >= mMemoryHeapCount || budgetOut == nullptr) {
+            return VK_ERROR_UNKNOWN;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        *budgetOut = mMemoryBudgetOfHeap[memoryHeapIndex];
+        return VK_SUCCESS;
+    }
+
+    bool ResidencyManager::IsWithinBudget(uint64_t sizeToMakeResident, uint32_t memoryHeapIndex) {
+        ASSERT(memoryHeapIndex < mMemoryHeapCount);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Device memory is rarely allocated since it is pooled, so the budget is always queried
+        // to account for memory allocated or freed by the rest of the process.
+        if (UpdateMemoryBudgetInternal() != VK_SUCCESS) {
+            return false;
+        }
+
+        const MEMORY_BUDGET_INFO& memoryBudget = mMemoryBudgetOfHeap[memoryHeapIndex];
+        return memoryBudget.Usage + sizeToMakeResident <= memoryBudget.Budget;
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,75 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_RESIDENCYMANAGERVK_H_
+#define GPGMM_VK_RESIDENCYMANAGERVK_H_
+
+#include "gpgmm/vk/vk_platform.h"
+#include "include/gpgmm_export.h"
+
+#include <array>
+#include <mutex>
+
+namespace gpgmm { namespace vk {
+
+    struct MEMORY_BUDGET_INFO {
+        // Memory the process may use of the heap before the driver starts to evict or fail,
+        // scaled by the maximum budget given to the residency manager.
+        uint64_t Budget;
+
+        // Memory of the heap used by the process, which includes memory not allocated by GPGMM.
+        uint64_t Usage;
+    };
+
+    // Keeps device memory within the budget reported by VK_EXT_memory_budget. Vulkan has no
+    // explicit residency, the driver pages out memory of the process once over budget. Instead,
+    // device memory is only allocated ahead of demand while within budget and, once over budget,
+    // the resource allocator returns pooled device memory of the heap to the driver.
+    class GPGMM_EXPORT ResidencyManager final {
+      public:
+        // |physicalDevice| must support VK_EXT_memory_budget, which the device must also be
+        // created with. |maxMemoryBudget| is the fraction of the budget of each heap to use.
+        static VkResult CreateResidencyManager(VkPhysicalDevice physicalDevice,
+                                               float maxMemoryBudget,
+                                               ResidencyManager** residencyManagerOut);
+
+        ~ResidencyManager();
+
+        // Queries the budget and usage of every memory heap from the driver.
+        VkResult UpdateMemoryBudget();
+
+        VkResult QueryMemoryBudget(uint32_t memoryHeapIndex, MEMORY_BUDGET_INFO* budgetOut);
+
+        // Checks if |sizeToMakeResident| more bytes can be allocated from the memory heap without
+        // exceeding its budget, using the most recent budget reported by the driver.
+        bool IsWithinBudget(uint64_t sizeToMakeResident, uint32_t memoryHeapIndex);
+
+      private:
+        ResidencyManager(VkPhysicalDevice physicalDevice,
+                         float maxMemoryBudget,
+                         uint32_t memoryHeapCount);
+
+        VkResult UpdateMemoryBudgetInternal();
+
+        const VkPhysicalDevice mPhysicalDevice;
+        const float mMaxMemoryBudget;
+        const uint32_t mMemoryHeapCount;
+
+        std::mutex mMutex;
+        std::array<MEMORY_BUDGET_INFO, VK_MAX_MEMORY_HEAPS> mMemoryBudgetOfHeap = {};
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_RESIDENCYMANAGERVK_H_
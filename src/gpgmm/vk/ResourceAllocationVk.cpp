@@ -0,0 +1,76 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/vk/ResourceAllocationVk.h"
+
+#include "gpgmm/common/Assert.h"
+#include "gpgmm/vk/BackendVk.h"
+#include "gpgmm/vk/DeviceMemoryVk.h"
+
+namespace gpgmm { namespace vk {
+
+    ResourceAllocation::ResourceAllocation(MemoryAllocator* allocator,
+                                           DeviceMemory* memory,
+                                           uint64_t offset,
+                                           AllocationMethod method,
+                                           MemoryBlock* block)
+        : MemoryAllocation(allocator, memory, offset, method, block) {
+    }
+
+    ResourceAllocation::ResourceAllocation(MemoryAllocator* allocator, DeviceMemory* memory)
+        : MemoryAllocation(allocator, memory) {
+    }
+
+    ResourceAllocation::~ResourceAllocation() {
+        ASSERT(mMapCount == 0);
+    }
+
+    VkResult ResourceAllocation::Map(void** dataOut) {
+        if (dataOut == nullptr) {
+            return VK_ERROR_UNKNOWN;
+        }
+
+        void* memoryData = nullptr;
+        const VkResult result = GetDeviceMemoryBase()->Map(&memoryData);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        mMapCount++;
+        *dataOut = static_cast<uint8_t*>(memoryData) + GetOffset();
+        return VK_SUCCESS;
+    }
+
+    void ResourceAllocation::Unmap() {
+        if (mMapCount == 0) {
+            return;
+        }
+
+        mMapCount--;
+        GetDeviceMemoryBase()->Unmap();
+    }
+
+    VkDeviceMemory ResourceAllocation::GetDeviceMemory() const {
+        return GetDeviceMemoryBase()->GetDeviceMemory();
+    }
+
+    uint32_t ResourceAllocation::GetMemoryTypeIndex() const {
+        return GetDeviceMemoryBase()->GetMemoryTypeIndex();
+    }
+
+    DeviceMemory* ResourceAllocation::GetDeviceMemoryBase() const {
+        return ToBackend(GetMemory());
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,63 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_RESOURCEALLOCATIONVK_H_
+#define GPGMM_VK_RESOURCEALLOCATIONVK_H_
+
+#include "gpgmm/MemoryAllocation.h"
+#include "gpgmm/vk/vk_platform.h"
+#include "include/gpgmm_export.h"
+
+namespace gpgmm { namespace vk {
+
+    class DeviceMemory;
+    class ResourceAllocator;
+
+    // Represents a range of device memory which a buffer or image is bound to. Allocations are
+    // freed by the resource allocator which created them.
+    class GPGMM_EXPORT ResourceAllocation final : public MemoryAllocation {
+      public:
+        // Constructs an allocation sub-allocated within |memory|.
+        ResourceAllocation(MemoryAllocator* allocator,
+                           DeviceMemory* memory,
+                           uint64_t offset,
+                           AllocationMethod method,
+                           MemoryBlock* block);
+
+        // Constructs an allocation which uses all of |memory|.
+        ResourceAllocation(MemoryAllocator* allocator, DeviceMemory* memory);
+
+        ~ResourceAllocation() override;
+
+        // Maps the allocation to a CPU pointer, which requires host-visible memory. Non-coherent
+        // memory must still be flushed or invalidated by the app.
+        VkResult Map(void** dataOut);
+        void Unmap();
+
+        VkDeviceMemory GetDeviceMemory() const;
+        uint32_t GetMemoryTypeIndex() const;
+
+      private:
+        friend ResourceAllocator;
+
+        DeviceMemory* GetDeviceMemoryBase() const;
+
+        // Number of times the allocation is mapped, which must all be unmapped before the
+        // allocation is freed.
+        uint32_t mMapCount = 0;
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_RESOURCEALLOCATIONVK_H_
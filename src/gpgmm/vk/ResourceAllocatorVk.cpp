@@ -0,0 +1,431 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/vk/ResourceAllocatorVk.h"
+
+#include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/Debug.h"
+#include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/SlabMemoryAllocator.h"
+#include "gpgmm/StandaloneMemoryAllocator.h"
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/vk/BackendVk.h"
+#include "gpgmm/vk/DefaultsVk.h"
+#include "gpgmm/vk/DeviceMemoryAllocatorVk.h"
+#include "gpgmm/vk/DeviceMemoryVk.h"
+
+namespace gpgmm { namespace vk {
+
+    namespace {
+
+        constexpr uint32_t kInvalidMemoryTypeIndex = VK_MAX_MEMORY_TYPES;
+
+        // Number of memory property flags of |preferredFlags| which |flags| lacks.
+        uint32_t GetMissingPropertyFlagCount(VkMemoryPropertyFlags flags,
+                                             VkMemoryPropertyFlags preferredFlags) {
+            uint32_t count = 0;
+            for (VkMemoryPropertyFlags missingFlags = preferredFlags & ~flags; missingFlags != 0;
+                 missingFlags &= missingFlags - 1) {
+                count++;
+            }
+            return count;
+        }
+
+    }  // namespace
+
+    // static
+    VkResult ResourceAllocator::CreateAllocator(const ALLOCATOR_DESC& descriptor,
+                                                ResourceAllocator** resourceAllocatorOut) {
+        if (descriptor.PhysicalDevice == VK_NULL_HANDLE || descriptor.Device == VK_NULL_HANDLE) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        if (resourceAllocatorOut == nullptr) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        std::unique_ptr<ResidencyManager> residencyManager;
+        if (descriptor.IsBudgetEnabled) {
+            ResidencyManager* residencyManagerPtr = nullptr;
+            const VkResult result = ResidencyManager::CreateResidencyManager(
+                descriptor.PhysicalDevice,
+                (descriptor.MaxMemoryBudget > 0) ? descriptor.MaxMemoryBudget
+                                                 : kDefaultMaxMemoryBudget,
+                &residencyManagerPtr);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            residencyManager.reset(residencyManagerPtr);
+        } else if (descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_IN_BUDGET) {
+            gpgmm::WarningLog() << "ALLOCATOR_FLAG_ALWAYS_IN_BUDGET has no effect unless the "
+                                   "budget is enabled.\n";
+        }
+
+        *resourceAllocatorOut = new ResourceAllocator(descriptor, std::move(residencyManager));
+        return VK_SUCCESS;
+    }
+
+    ResourceAllocator::ResourceAllocator(const ALLOCATOR_DESC& descriptor,
+                                         std::unique_ptr<ResidencyManager> residencyManager)
+        : mDevice(descriptor.Device),
+          mFlags(descriptor.Flags),
+          mPreferredDeviceMemorySize((descriptor.PreferredDeviceMemorySize > 0)
+                                         ? descriptor.PreferredDeviceMemorySize
+                                         : kDefaultPreferredDeviceMemorySize),
+          mResidencyManager(std::move(residencyManager)) {
+        vkGetPhysicalDeviceMemoryProperties(descriptor.PhysicalDevice, &mMemoryProperties);
+
+        VkPhysicalDeviceProperties deviceProperties = {};
+        vkGetPhysicalDeviceProperties(descriptor.PhysicalDevice, &deviceProperties);
+        mBufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+
+        for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount;
+             memoryTypeIndex++) {
+            mResourceAllocatorOfType[memoryTypeIndex] =
+                CreateSubAllocator(descriptor, memoryTypeIndex);
+            mImageAllocatorOfType[memoryTypeIndex] =
+                CreateSubAllocator(descriptor, memoryTypeIndex);
+            mDeviceMemoryAllocatorOfType[memoryTypeIndex] =
+                std::make_unique<StandaloneMemoryAllocator>(
+                    CreateDeviceMemoryAllocator(descriptor, memoryTypeIndex));
+        }
+    }
+
+    ResourceAllocator::~ResourceAllocator() = default;
+
+    std::unique_ptr<MemoryAllocator> ResourceAllocator::CreateDeviceMemoryAllocator(
+        const ALLOCATOR_DESC& descriptor,
+        uint32_t memoryTypeIndex) {
+        std::unique_ptr<MemoryAllocator> deviceMemoryAllocator =
+            std::make_unique<DeviceMemoryAllocator>(
+                mResidencyManager.get(), mDevice, memoryTypeIndex,
+                mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex,
+                static_cast<bool>(descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_IN_BUDGET));
+
+        if (descriptor.Flags & ALLOCATOR_FLAG_ALWAYS_ON_DEMAND) {
+            return deviceMemoryAllocator;
+        }
+
+        return std::make_unique<SegmentedMemoryAllocator>(std::move(deviceMemoryAllocator),
+                                                          kDefaultMinBlockSize);
+    }
+
+    std::unique_ptr<MemoryAllocator> ResourceAllocator::CreateSubAllocator(
+        const ALLOCATOR_DESC& descriptor,
+        uint32_t memoryTypeIndex) {
+        const uint32_t memoryHeapIndex = mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        const uint64_t maxDeviceMemorySize =
+            PrevPowerOfTwo(mMemoryProperties.memoryHeaps[memoryHeapIndex].size);
+
+        // Device memory is sub-allocated in buddies of the preferred size, which small resources
+        // are slab-allocated from.
+        std::unique_ptr<MemoryAllocator> buddyAllocator = std::make_unique<BuddyMemoryAllocator>(
+            maxDeviceMemorySize, mPreferredDeviceMemorySize, kDefaultMinBlockSize,
+            CreateDeviceMemoryAllocator(descriptor, memoryTypeIndex),
+            /*minBlockSize*/ kDefaultMinBlockSize);
+
+        return std::make_unique<SlabCacheAllocator>(
+            /*minBlockSize*/ kDefaultMinBlockSize,
+            /*maxSlabSize*/ maxDeviceMemorySize,
+            /*slabSize*/ mPreferredDeviceMemorySize,
+            /*slabAlignment*/ kDefaultMinBlockSize,
+            /*slabFragmentationLimit*/ (descriptor.MemoryFragmentationLimit > 0)
+                ? descriptor.MemoryFragmentationLimit
+                : kDefaultFragmentationLimit,
+            /*enablePrefetch*/ !(descriptor.Flags & ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH),
+            std::move(buddyAllocator), /*adaptSlabSize*/ true);
+    }
+
+    VkResult ResourceAllocator::FindMemoryTypeIndex(const ALLOCATION_DESC& allocationDescriptor,
+                                                    uint32_t memoryTypeBits,
+                                                    uint32_t* memoryTypeIndexOut) const {
+        // Picks the memory type with the required properties which lacks the fewest preferred
+        // properties. Memory types are ordered by performance, so ties keep the first.
+        uint32_t bestMemoryTypeIndex = kInvalidMemoryTypeIndex;
+        uint32_t bestMissingFlagCount = 0;
+        for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount;
+             memoryTypeIndex++) {
+            if (!(memoryTypeBits & (1u << memoryTypeIndex))) {
+                continue;
+            }
+
+            const VkMemoryPropertyFlags flags =
+                mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+            if ((flags & allocationDescriptor.RequiredPropertyFlags) !=
+                allocationDescriptor.RequiredPropertyFlags) {
+                continue;
+            }
+
+            const uint32_t missingFlagCount =
+                GetMissingPropertyFlagCount(flags, allocationDescriptor.PreferredPropertyFlags);
+            if (bestMemoryTypeIndex == kInvalidMemoryTypeIndex ||
+                missingFlagCount < bestMissingFlagCount) {
+                bestMemoryTypeIndex = memoryTypeIndex;
+                bestMissingFlagCount = missingFlagCount;
+            }
+        }
+
+        if (bestMemoryTypeIndex == kInvalidMemoryTypeIndex) {
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+
+        *memoryTypeIndexOut = bestMemoryTypeIndex;
+        return VK_SUCCESS;
+    }
+
+    VkResult ResourceAllocator::AllocateMemory(const ALLOCATION_DESC& allocationDescriptor,
+                                               const VkMemoryRequirements& memoryRequirements,
+                                               bool isLinear,
+                                               ResourceAllocation** resourceAllocationOut) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.AllocateMemory");
+
+        if (resourceAllocationOut == nullptr) {
+            return VK_ERROR_UNKNOWN;
+        }
+
+        uint32_t memoryTypeIndex = 0;
+        const VkResult result = FindMemoryTypeIndex(
+            allocationDescriptor, memoryRequirements.memoryTypeBits, &memoryTypeIndex);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = memoryRequirements.size;
+        request.Alignment = memoryRequirements.alignment;
+        request.NeverAllocate = allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        request.PrefetchMemory =
+            allocationDescriptor.Flags & ALLOCATION_FLAG_ALWAYS_PREFETCH_MEMORY;
+
+        // Resources larger than the preferred size would waste most of a buddy, so they are
+        // always given their own device memory.
+        const bool neverSubAllocate =
+            (allocationDescriptor.Flags & ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY) ||
+            (mFlags & ALLOCATOR_FLAG_ALWAYS_DEDICATED) ||
+            memoryRequirements.size > mPreferredDeviceMemorySize;
+
+        MemoryAllocator* allocator = nullptr;
+        if (neverSubAllocate) {
+            allocator = mDeviceMemoryAllocatorOfType[memoryTypeIndex].get();
+        } else if (isLinear) {
+            allocator = mResourceAllocatorOfType[memoryTypeIndex].get();
+        } else {
+            allocator = mImageAllocatorOfType[memoryTypeIndex].get();
+        }
+
+        std::unique_ptr<MemoryAllocation> allocation = allocator->TryAllocateMemory(request);
+
+        // Once over budget, memory pooled for other resources of the same memory heap is freed
+        // so the driver can allocate the resource within budget.
+        if (allocation == nullptr && !request.NeverAllocate && mResidencyManager != nullptr) {
+            const uint32_t memoryHeapIndex =
+                mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+            if (ReleaseMemoryOfHeap(memoryHeapIndex, memoryRequirements.size) > 0) {
+                allocation = allocator->TryAllocateMemory(request);
+            }
+        }
+
+        if (allocation == nullptr) {
+            DebugEvent("ResourceAllocator.AllocateMemory")
+                << "Device memory could not be allocated.";
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+
+        *resourceAllocationOut = new ResourceAllocation(
+            allocation->GetAllocator(), ToBackend(allocation->GetMemory()),
+            allocation->GetOffset(), allocation->GetMethod(), allocation->GetBlock());
+        return VK_SUCCESS;
+    }
+
+    void ResourceAllocator::FreeMemory(ResourceAllocation* resourceAllocation) {
+        if (resourceAllocation == nullptr) {
+            return;
+        }
+
+        DeallocateMemory(std::unique_ptr<MemoryAllocation>(resourceAllocation));
+    }
+
+    void ResourceAllocator::DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.DeallocateMemory");
+
+        ResourceAllocation* resourceAllocation = ToBackend(allocation.get());
+        while (resourceAllocation->mMapCount > 0) {
+            resourceAllocation->Unmap();
+        }
+
+        MemoryAllocator* allocator = allocation->GetAllocator();
+        ASSERT(allocator != nullptr);
+        allocator->DeallocateMemory(std::move(allocation));
+    }
+
+    VkResult ResourceAllocator::CreateBuffer(const ALLOCATION_DESC& allocationDescriptor,
+                                             const VkBufferCreateInfo& bufferCreateInfo,
+                                             VkBuffer* bufferOut,
+                                             ResourceAllocation** resourceAllocationOut) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateBuffer");
+
+        if (bufferOut == nullptr || resourceAllocationOut == nullptr) {
+            return VK_ERROR_UNKNOWN;
+        }
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkResult result = vkCreateBuffer(mDevice, &bufferCreateInfo, nullptr, &buffer);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        VkMemoryRequirements memoryRequirements = {};
+        vkGetBufferMemoryRequirements(mDevice, buffer, &memoryRequirements);
+
+        ResourceAllocation* resourceAllocation = nullptr;
+        result = AllocateMemory(allocationDescriptor, memoryRequirements, /*isLinear*/ true,
+                                &resourceAllocation);
+        if (result != VK_SUCCESS) {
+            vkDestroyBuffer(mDevice, buffer, nullptr);
+            return result;
+        }
+
+        result = vkBindBufferMemory(mDevice, buffer, resourceAllocation->GetDeviceMemory(),
+                                    resourceAllocation->GetOffset());
+        if (result != VK_SUCCESS) {
+            FreeMemory(resourceAllocation);
+            vkDestroyBuffer(mDevice, buffer, nullptr);
+            return result;
+        }
+
+        *bufferOut = buffer;
+        *resourceAllocationOut = resourceAllocation;
+        return VK_SUCCESS;
+    }
+
+    void ResourceAllocator::DestroyBuffer(VkBuffer buffer, ResourceAllocation* resourceAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.DestroyBuffer");
+
+        // The buffer must be destroyed before its memory could be re-used by another resource.
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(mDevice, buffer, nullptr);
+        }
+
+        FreeMemory(resourceAllocation);
+    }
+
+    VkResult ResourceAllocator::CreateImage(const ALLOCATION_DESC& allocationDescriptor,
+                                            const VkImageCreateInfo& imageCreateInfo,
+                                            VkImage* imageOut,
+                                            ResourceAllocation** resourceAllocationOut) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.CreateImage");
+
+        if (imageOut == nullptr || resourceAllocationOut == nullptr) {
+            return VK_ERROR_UNKNOWN;
+        }
+
+        VkImage image = VK_NULL_HANDLE;
+        VkResult result = vkCreateImage(mDevice, &imageCreateInfo, nullptr, &image);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        VkMemoryRequirements memoryRequirements = {};
+        vkGetImageMemoryRequirements(mDevice, image, &memoryRequirements);
+
+        ResourceAllocation* resourceAllocation = nullptr;
+        result = AllocateMemory(allocationDescriptor, memoryRequirements,
+                                /*isLinear*/ imageCreateInfo.tiling == VK_IMAGE_TILING_LINEAR,
+                                &resourceAllocation);
+        if (result != VK_SUCCESS) {
+            vkDestroyImage(mDevice, image, nullptr);
+            return result;
+        }
+
+        result = vkBindImageMemory(mDevice, image, resourceAllocation->GetDeviceMemory(),
+                                   resourceAllocation->GetOffset());
+        if (result != VK_SUCCESS) {
+            FreeMemory(resourceAllocation);
+            vkDestroyImage(mDevice, image, nullptr);
+            return result;
+        }
+
+        *imageOut = image;
+        *resourceAllocationOut = resourceAllocation;
+        return VK_SUCCESS;
+    }
+
+    void ResourceAllocator::DestroyImage(VkImage image, ResourceAllocation* resourceAllocation) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.DestroyImage");
+
+        // The image must be destroyed before its memory could be re-used by another resource.
+        if (image != VK_NULL_HANDLE) {
+            vkDestroyImage(mDevice, image, nullptr);
+        }
+
+        FreeMemory(resourceAllocation);
+    }
+
+    uint64_t ResourceAllocator::ReleaseMemory(uint64_t bytesToRelease) {
+        uint64_t bytesReleased = 0;
+        for (uint32_t memoryHeapIndex = 0; memoryHeapIndex < mMemoryProperties.memoryHeapCount;
+             memoryHeapIndex++) {
+            if (bytesReleased >= bytesToRelease) {
+                break;
+            }
+            bytesReleased += ReleaseMemoryOfHeap(memoryHeapIndex, bytesToRelease - bytesReleased);
+        }
+        return bytesReleased;
+    }
+
+    uint64_t ResourceAllocator::ReleaseMemoryOfHeap(uint32_t memoryHeapIndex,
+                                                    uint64_t bytesToRelease) {
+        TRACE_EVENT0(TraceEventCategory::Allocation, "ResourceAllocator.ReleaseMemory");
+
+        uint64_t bytesReleased = 0;
+        for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount;
+             memoryTypeIndex++) {
+            if (mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex != memoryHeapIndex) {
+                continue;
+            }
+
+            const std::array<MemoryAllocator*, 3> allocators = {
+                mResourceAllocatorOfType[memoryTypeIndex].get(),
+                mImageAllocatorOfType[memoryTypeIndex].get(),
+                mDeviceMemoryAllocatorOfType[memoryTypeIndex].get()};
+            for (MemoryAllocator* allocator : allocators) {
+                if (bytesReleased >= bytesToRelease) {
+                    return bytesReleased;
+                }
+                bytesReleased += allocator->ReleaseMemory(bytesToRelease - bytesReleased);
+            }
+        }
+
+        return bytesReleased;
+    }
+
+    MEMORY_ALLOCATOR_INFO ResourceAllocator::QueryInfo() const {
+        MEMORY_ALLOCATOR_INFO result = MemoryAllocator::QueryInfo();
+
+        for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount;
+             memoryTypeIndex++) {
+            result += mResourceAllocatorOfType[memoryTypeIndex]->QueryInfo();
+            result += mImageAllocatorOfType[memoryTypeIndex]->QueryInfo();
+            result += mDeviceMemoryAllocatorOfType[memoryTypeIndex]->QueryInfo();
+        }
+
+        return result;
+    }
+
+    ResidencyManager* ResourceAllocator::GetResidencyManager() const {
+        return mResidencyManager.get();
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,195 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_VK_RESOURCEALLOCATORVK_H_
+#define GPGMM_VK_RESOURCEALLOCATORVK_H_
+
+#include "gpgmm/MemoryAllocator.h"
+#include "gpgmm/common/Flags.h"
+#include "gpgmm/vk/ResidencyManagerVk.h"
+#include "gpgmm/vk/ResourceAllocationVk.h"
+#include "gpgmm/vk/vk_platform.h"
+#include "include/gpgmm_export.h"
+
+#include <array>
+#include <memory>
+
+namespace gpgmm { namespace vk {
+
+    enum ALLOCATOR_FLAGS {
+
+        // Disables all allocator flags. Enabled by default.
+        ALLOCATOR_FLAG_NONE = 0x0,
+
+        // Disable reuse of device memory for debugging and testing purposes.
+        ALLOCATOR_FLAG_ALWAYS_DEDICATED = 0x1,
+
+        // Ensures device memory is always within the budget of its memory heap at allocation
+        // time. Requires a residency manager.
+        ALLOCATOR_FLAG_ALWAYS_IN_BUDGET = 0x2,
+
+        // Disables pre-fetching of device memory for debugging and testing purposes.
+        ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH = 0x4,
+
+        // Makes GPGMM allocate exactly what is needed on-demand, and to free device memory that
+        // is no longer needed (instead of re-using it).
+        ALLOCATOR_FLAG_ALWAYS_ON_DEMAND = 0x8,
+    };
+
+    using ALLOCATOR_FLAGS_TYPE = Flags<ALLOCATOR_FLAGS>;
+    DEFINE_OPERATORS_FOR_FLAGS(ALLOCATOR_FLAGS_TYPE)
+
+    struct ALLOCATOR_DESC {
+        // Physical device which |Device| was created from.
+        VkPhysicalDevice PhysicalDevice;
+
+        // Device used by the allocator. Required.
+        VkDevice Device;
+
+        // Specifies allocator options.
+        ALLOCATOR_FLAGS_TYPE Flags = ALLOCATOR_FLAG_NONE;
+
+        // Keeps device memory within the budget reported by VK_EXT_memory_budget, which both
+        // |PhysicalDevice| and |Device| must support. Otherwise, the budget is ignored.
+        bool IsBudgetEnabled;
+
+        // Fraction of the budget of each memory heap to use. Zero uses the default of 95%.
+        float MaxMemoryBudget;
+
+        // Size of device memory which resources are sub-allocated within. Zero uses the default
+        // of 4MB. Resources larger than this size are always allocated their own device memory.
+        uint64_t PreferredDeviceMemorySize;
+
+        // Maximum fraction of device memory wasted by internal fragmentation. Zero uses the
+        // default of 12.5%.
+        double MemoryFragmentationLimit;
+    };
+
+    enum ALLOCATION_FLAGS {
+
+        // Disables all allocation flags. Enabled by default.
+        ALLOCATION_FLAG_NONE = 0x0,
+
+        // Forbids allocating new device memory, only existing device memory is re-used. Allocations
+        // fail with VK_ERROR_OUT_OF_DEVICE_MEMORY if no device memory can be re-used.
+        ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY = 0x1,
+
+        // Allocates the resource its own device memory, such as resources which are often
+        // re-created or must not share memory.
+        ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY = 0x2,
+
+        // Prefetches device memory for the next allocation of the same size, while within budget.
+        ALLOCATION_FLAG_ALWAYS_PREFETCH_MEMORY = 0x4,
+    };
+
+    using ALLOCATION_FLAGS_TYPE = Flags<ALLOCATION_FLAGS>;
+    DEFINE_OPERATORS_FOR_FLAGS(ALLOCATION_FLAGS_TYPE)
+
+    struct ALLOCATION_DESC {
+        // Specifies allocation options.
+        ALLOCATION_FLAGS_TYPE Flags = ALLOCATION_FLAG_NONE;
+
+        // Properties the memory type must have, ex. VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT for
+        // resources written by the CPU.
+        VkMemoryPropertyFlags RequiredPropertyFlags;
+
+        // Properties the memory type should have, when a memory type with the required properties
+        // also has them.
+        VkMemoryPropertyFlags PreferredPropertyFlags;
+    };
+
+    // Allocates device memory for buffers and images using the same allocators as the D3D12
+    // backend, with one set of allocators per memory type.
+    class GPGMM_EXPORT ResourceAllocator final : public MemoryAllocator {
+      public:
+        static VkResult CreateAllocator(const ALLOCATOR_DESC& descriptor,
+                                        ResourceAllocator** resourceAllocatorOut);
+
+        ~ResourceAllocator() override;
+
+        // Creates a buffer bound to device memory. The buffer and allocation must be destroyed
+        // together by DestroyBuffer.
+        VkResult CreateBuffer(const ALLOCATION_DESC& allocationDescriptor,
+                              const VkBufferCreateInfo& bufferCreateInfo,
+                              VkBuffer* bufferOut,
+                              ResourceAllocation** resourceAllocationOut);
+        void DestroyBuffer(VkBuffer buffer, ResourceAllocation* resourceAllocation);
+
+        // Creates an image bound to device memory. The image and allocation must be destroyed
+        // together by DestroyImage.
+        VkResult CreateImage(const ALLOCATION_DESC& allocationDescriptor,
+                             const VkImageCreateInfo& imageCreateInfo,
+                             VkImage* imageOut,
+                             ResourceAllocation** resourceAllocationOut);
+        void DestroyImage(VkImage image, ResourceAllocation* resourceAllocation);
+
+        // Allocates device memory which satisfies |memoryRequirements|, for resources the app
+        // binds itself. |isLinear| is false for images of optimal tiling, which are never placed
+        // next to linear resources to respect bufferImageGranularity.
+        VkResult AllocateMemory(const ALLOCATION_DESC& allocationDescriptor,
+                                const VkMemoryRequirements& memoryRequirements,
+                                bool isLinear,
+                                ResourceAllocation** resourceAllocationOut);
+        void FreeMemory(ResourceAllocation* resourceAllocation);
+
+        // Frees device memory kept for re-use. Returns the amount of memory freed, in bytes.
+        uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override;
+
+        // Return the current allocator usage.
+        MEMORY_ALLOCATOR_INFO QueryInfo() const override;
+
+        // Returns the residency manager, or nullptr when the budget is not enabled.
+        ResidencyManager* GetResidencyManager() const;
+
+      private:
+        ResourceAllocator(const ALLOCATOR_DESC& descriptor,
+                          std::unique_ptr<ResidencyManager> residencyManager);
+
+        VkResult FindMemoryTypeIndex(const ALLOCATION_DESC& allocationDescriptor,
+                                     uint32_t memoryTypeBits,
+                                     uint32_t* memoryTypeIndexOut) const;
+
+        std::unique_ptr<MemoryAllocator> CreateSubAllocator(const ALLOCATOR_DESC& descriptor,
+                                                            uint32_t memoryTypeIndex);
+
+        std::unique_ptr<MemoryAllocator> CreateDeviceMemoryAllocator(
+            const ALLOCATOR_DESC& descriptor,
+            uint32_t memoryTypeIndex);
+
+        // Frees pooled device memory of every memory type within the memory heap, so the
+        // driver can allocate new device memory of the heap within its budget.
+        uint64_t ReleaseMemoryOfHeap(uint32_t memoryHeapIndex, uint64_t bytesToRelease);
+
+        // MemoryAllocator interface
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override;
+
+        const VkDevice mDevice;
+        const ALLOCATOR_FLAGS_TYPE mFlags;
+        const uint64_t mPreferredDeviceMemorySize;
+        std::unique_ptr<ResidencyManager> mResidencyManager;
+
+        VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+        uint64_t mBufferImageGranularity = 1;
+
+        // Linear resources, which includes buffers, and optimal images are sub-allocated
+        // by different allocators so neither ever shares a page of bufferImageGranularity.
+        std::array<std::unique_ptr<MemoryAllocator>, VK_MAX_MEMORY_TYPES> mResourceAllocatorOfType;
+        std::array<std::unique_ptr<MemoryAllocator>, VK_MAX_MEMORY_TYPES> mImageAllocatorOfType;
+        std::array<std::unique_ptr<MemoryAllocator>, VK_MAX_MEMORY_TYPES>
+            mDeviceMemoryAllocatorOfType;
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // GPGMM_VK_RESOURCEALLOCATORVK_H_
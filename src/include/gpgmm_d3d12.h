@@ -19,11 +19,15 @@
 
 // clang-format off
 
+#include "gpgmm/d3d12/AllocatorGroupD3D12.h"
 #include "gpgmm/d3d12/HeapD3D12.h"
+#include "gpgmm/d3d12/PoolD3D12.h"
+#include "gpgmm/d3d12/ReadbackManagerD3D12.h"
 #include "gpgmm/d3d12/ResidencySetD3D12.h"
 #include "gpgmm/d3d12/ResidencyManagerD3D12.h"
 #include "gpgmm/d3d12/ResourceAllocationD3D12.h"
 #include "gpgmm/d3d12/ResourceAllocatorD3D12.h"
+#include "gpgmm/d3d12/UploadManagerD3D12.h"
 
 // clang-format on
 
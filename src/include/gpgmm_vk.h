@@ -0,0 +1,29 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GPGMM_INCLUDE_GPGMM_VK_H_
+#define GPGMM_INCLUDE_GPGMM_VK_H_
+
+#include <gpgmm_export.h>
+
+// clang-format off
+
+#include "gpgmm/vk/DeviceMemoryVk.h"
+#include "gpgmm/vk/ResidencyManagerVk.h"
+#include "gpgmm/vk/ResourceAllocationVk.h"
+#include "gpgmm/vk/ResourceAllocatorVk.h"
+
+// clang-format on
+
+#endif  // GPGMM_INCLUDE_GPGMM_VK_H_
@@ -0,0 +1,904 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_D3D12MOCKDEVICE_H_
+#define TESTS_D3D12MOCKDEVICE_H_
+
+#include "gpgmm/d3d12/d3d12_platform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Fake D3D12 device, queue and DXGI adapter which only simulate paging, so the residency manager
+// can be measured and tested reproducibly without a GPU. Memory is never allocated: pageables
+// only have a size, MakeResident and Evict only count the usage of each memory segment against
+// its budget, and fences complete once waited on.
+
+namespace gpgmm { namespace d3d12 {
+
+    struct MOCK_DEVICE_DESC {
+        // Budget of each memory segment, in bytes. Changed with MockD3D12Device::SetBudget.
+        uint64_t LocalBudget = 0;
+        uint64_t NonLocalBudget = 0;
+
+        // Speed MakeResident pages in at, in bytes per second. When 0 is specified,
+        // MakeResident completes immediately.
+        double MakeResidentBytesPerSecond = 0;
+
+        // Time each call to Evict takes.
+        double EvictTimeInSeconds = 0;
+
+        // Time for the GPU to reach a fence value which has yet to complete once waited on.
+        double FenceWaitTimeInSeconds = 0;
+
+        // Fail MakeResident with E_OUTOFMEMORY, like the OS can, when the usage would exceed the
+        // budget.
+        bool FailMakeResidentOverBudget = false;
+    };
+
+    // Blocks the calling thread for |seconds| by spinning, which is far more precise than
+    // sleeping for the short times paging takes.
+    inline void SimulateMockLatency(double seconds) {
+        if (seconds <= 0) {
+            return;
+        }
+        const auto endTime = std::chrono::steady_clock::now() +
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(seconds));
+        while (std::chrono::steady_clock::now() < endTime) {
+        }
+    }
+
+    // Implements IUnknown for a mock of |Interface|. Starts with a single reference, which
+    // Create adopts.
+    template <typename Interface>
+    class MockUnknownImpl : public Interface {
+      public:
+        virtual ~MockUnknownImpl() = default;
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+            if (ppvObject == nullptr) {
+                return E_POINTER;
+            }
+            if (!SupportsInterface(riid)) {
+                *ppvObject = nullptr;
+                return E_NOINTERFACE;
+            }
+            *ppvObject = static_cast<Interface*>(this);
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override {
+            return mRefCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override {
+            const ULONG refCount = mRefCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+            if (refCount == 0) {
+                delete this;
+            }
+            return refCount;
+        }
+
+      protected:
+        virtual bool SupportsInterface(REFIID riid) const {
+            return riid == __uuidof(IUnknown) || riid == __uuidof(Interface);
+        }
+
+      private:
+        std::atomic<ULONG> mRefCount{1};
+    };
+
+    template <typename T, typename... Args>
+    ComPtr<T> CreateMock(Args&&... args) {
+        ComPtr<T> mock;
+        mock.Attach(new T(std::forward<Args>(args)...));
+        return mock;
+    }
+
+    // Implements ID3D12Object and ID3D12DeviceChild, without private data.
+    template <typename Interface>
+    class MockD3D12DeviceChildImpl : public MockUnknownImpl<Interface> {
+      public:
+        explicit MockD3D12DeviceChildImpl(ID3D12Device* device) : mDevice(device) {
+        }
+
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid,
+                                                 UINT* pDataSize,
+                                                 void* pData) override {
+            return DXGI_ERROR_NOT_FOUND;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid,
+                                                 UINT dataSize,
+                                                 const void* pData) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid,
+                                                          const IUnknown* pData) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetName(LPCWSTR name) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, void** ppvDevice) override {
+            return mDevice->QueryInterface(riid, ppvDevice);
+        }
+
+      protected:
+        bool SupportsInterface(REFIID riid) const override {
+            return MockUnknownImpl<Interface>::SupportsInterface(riid) ||
+                   riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild);
+        }
+
+      private:
+        ComPtr<ID3D12Device> mDevice;
+    };
+
+    // Pageable of |size| bytes, which is resident once created. Its residency is guarded by the
+    // device.
+    class MockD3D12Pageable final : public MockD3D12DeviceChildImpl<ID3D12Pageable> {
+      public:
+        MockD3D12Pageable(ID3D12Device* device,
+                          uint64_t size,
+                          DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup)
+            : MockD3D12DeviceChildImpl(device),
+              mSize(size),
+              mMemorySegmentGroup(memorySegmentGroup) {
+        }
+
+        uint64_t GetSize() const {
+            return mSize;
+        }
+
+        DXGI_MEMORY_SEGMENT_GROUP GetMemorySegmentGroup() const {
+            return mMemorySegmentGroup;
+        }
+
+        bool IsResident() const {
+            return mIsResident;
+        }
+
+        void SetResident(bool isResident) {
+            mIsResident = isResident;
+        }
+
+      private:
+        const uint64_t mSize;
+        const DXGI_MEMORY_SEGMENT_GROUP mMemorySegmentGroup;
+        bool mIsResident = true;
+    };
+
+    // Fence whose value completes once signaled by a queue, or once waited on, after
+    // MOCK_DEVICE_DESC::FenceWaitTimeInSeconds, as if the GPU caught up.
+    class MockD3D12Fence final : public MockD3D12DeviceChildImpl<ID3D12Fence> {
+      public:
+        MockD3D12Fence(ID3D12Device* device, uint64_t initialValue, double waitTimeInSeconds)
+            : MockD3D12DeviceChildImpl(device),
+              mWaitTimeInSeconds(waitTimeInSeconds),
+              mCompletedValue(initialValue) {
+        }
+
+        UINT64 STDMETHODCALLTYPE GetCompletedValue() override {
+            return mCompletedValue.load(std::memory_order_acquire);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetEventOnCompletion(UINT64 value, HANDLE hEvent) override {
+            if (value > GetCompletedValue()) {
+                mWaitCount.fetch_add(1, std::memory_order_relaxed);
+                SimulateMockLatency(mWaitTimeInSeconds);
+                Signal(value);
+            }
+            if (hEvent != nullptr) {
+                SetEvent(hEvent);
+            }
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Signal(UINT64 value) override {
+            uint64_t completedValue = GetCompletedValue();
+            while (value > completedValue &&
+                   !mCompletedValue.compare_exchange_weak(completedValue, value,
+                                                          std::memory_order_acq_rel)) {
+            }
+            return S_OK;
+        }
+
+        // Number of times a value was waited on before it completed.
+        uint64_t GetWaitCount() const {
+            return mWaitCount.load(std::memory_order_relaxed);
+        }
+
+      protected:
+        bool SupportsInterface(REFIID riid) const override {
+            return MockD3D12DeviceChildImpl::SupportsInterface(riid) ||
+                   riid == __uuidof(ID3D12Pageable);
+        }
+
+      private:
+        const double mWaitTimeInSeconds;
+        std::atomic<uint64_t> mCompletedValue;
+        std::atomic<uint64_t> mWaitCount{0};
+    };
+
+    // Queue which executes nothing. Signals complete once |gpuLagSubmissionCount| more are
+    // signaled, so heaps used by the last submissions are still in use by the "GPU".
+    class MockD3D12CommandQueue final : public MockD3D12DeviceChildImpl<ID3D12CommandQueue> {
+      public:
+        MockD3D12CommandQueue(ID3D12Device* device, uint32_t gpuLagSubmissionCount = 0)
+            : MockD3D12DeviceChildImpl(device), mGPULagSubmissionCount(gpuLagSubmissionCount) {
+        }
+
+        void STDMETHODCALLTYPE UpdateTileMappings(ID3D12Resource* pResource,
+                                                  UINT numResourceRegions,
+                                                  const D3D12_TILED_RESOURCE_COORDINATE* pCoords,
+                                                  const D3D12_TILE_REGION_SIZE* pSizes,
+                                                  ID3D12Heap* pHeap,
+                                                  UINT numRanges,
+                                                  const D3D12_TILE_RANGE_FLAGS* pRangeFlags,
+                                                  const UINT* pHeapRangeStartOffsets,
+                                                  const UINT* pRangeTileCounts,
+                                                  D3D12_TILE_MAPPING_FLAGS flags) override {
+        }
+
+        void STDMETHODCALLTYPE CopyTileMappings(ID3D12Resource* pDstResource,
+                                                const D3D12_TILED_RESOURCE_COORDINATE* pDstCoord,
+                                                ID3D12Resource* pSrcResource,
+                                                const D3D12_TILED_RESOURCE_COORDINATE* pSrcCoord,
+                                                const D3D12_TILE_REGION_SIZE* pRegionSize,
+                                                D3D12_TILE_MAPPING_FLAGS flags) override {
+        }
+
+        void STDMETHODCALLTYPE
+        ExecuteCommandLists(UINT numCommandLists,
+                            ID3D12CommandList* const* ppCommandLists) override {
+            mExecuteCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void STDMETHODCALLTYPE SetMarker(UINT metadata, const void* pData, UINT size) override {
+        }
+
+        void STDMETHODCALLTYPE BeginEvent(UINT metadata, const void* pData, UINT size) override {
+        }
+
+        void STDMETHODCALLTYPE EndEvent() override {
+        }
+
+        HRESULT STDMETHODCALLTYPE Signal(ID3D12Fence* pFence, UINT64 value) override {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPendingSignals.emplace_back(pFence, value);
+            while (mPendingSignals.size() > mGPULagSubmissionCount) {
+                const HRESULT hr =
+                    mPendingSignals.front().first->Signal(mPendingSignals.front().second);
+                if (FAILED(hr)) {
+                    return hr;
+                }
+                mPendingSignals.pop_front();
+            }
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Wait(ID3D12Fence* pFence, UINT64 value) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetTimestampFrequency(UINT64* pFrequency) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetClockCalibration(UINT64* pGpuTimestamp,
+                                                      UINT64* pCpuTimestamp) override {
+            return E_NOTIMPL;
+        }
+
+        D3D12_COMMAND_QUEUE_DESC STDMETHODCALLTYPE GetDesc() override {
+            return {};
+        }
+
+        // Completes every signal, as if the GPU became idle.
+        HRESULT Flush() {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const auto& signal : mPendingSignals) {
+                const HRESULT hr = signal.first->Signal(signal.second);
+                if (FAILED(hr)) {
+                    return hr;
+                }
+            }
+            mPendingSignals.clear();
+            return S_OK;
+        }
+
+        uint64_t GetExecuteCount() const {
+            return mExecuteCount.load(std::memory_order_relaxed);
+        }
+
+      protected:
+        bool SupportsInterface(REFIID riid) const override {
+            return MockD3D12DeviceChildImpl::SupportsInterface(riid) ||
+                   riid == __uuidof(ID3D12Pageable);
+        }
+
+      private:
+        const uint32_t mGPULagSubmissionCount;
+
+        std::mutex mMutex;
+        std::deque<std::pair<ComPtr<ID3D12Fence>, uint64_t>> mPendingSignals;
+        std::atomic<uint64_t> mExecuteCount{0};
+    };
+
+    // Device which only implements paging. Only ID3D12Device is supported, so the residency
+    // manager neither enqueues paging nor waits on multiple fences at once.
+    class MockD3D12Device final : public MockUnknownImpl<ID3D12Device> {
+      public:
+        explicit MockD3D12Device(const MOCK_DEVICE_DESC& descriptor) : mDescriptor(descriptor) {
+            mSegments[DXGI_MEMORY_SEGMENT_GROUP_LOCAL].Budget = descriptor.LocalBudget;
+            mSegments[DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL].Budget = descriptor.NonLocalBudget;
+        }
+
+        // Creates a pageable which is resident and counted by the usage of its segment, like a
+        // heap once created.
+        ComPtr<MockD3D12Pageable> CreatePageable(uint64_t size,
+                                                 DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSegments[memorySegmentGroup].Usage += size;
+            return CreateMock<MockD3D12Pageable>(this, size, memorySegmentGroup);
+        }
+
+        // Stops counting |pageable|, like a heap once released.
+        void ReleasePageable(MockD3D12Pageable* pageable) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (pageable->IsResident()) {
+                mSegments[pageable->GetMemorySegmentGroup()].Usage -= pageable->GetSize();
+                pageable->SetResident(false);
+            }
+        }
+
+        // Changes the budget of |memorySegmentGroup| then notifies the events registered through
+        // the adapter, like the OS does.
+        void SetBudget(DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup, uint64_t budget) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSegments[memorySegmentGroup].Budget = budget;
+            for (const auto& event : mBudgetChangeEvents) {
+                SetEvent(event.second);
+            }
+        }
+
+        DXGI_QUERY_VIDEO_MEMORY_INFO GetVideoMemoryInfo(
+            DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const MemorySegment& segment = mSegments[memorySegmentGroup];
+            DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+            info.Budget = segment.Budget;
+            info.CurrentUsage = segment.Usage;
+            info.AvailableForReservation = segment.Budget / 2;
+            info.CurrentReservation = segment.Reservation;
+            return info;
+        }
+
+        void SetReservation(DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup, uint64_t reservation) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSegments[memorySegmentGroup].Reservation = reservation;
+        }
+
+        DWORD RegisterBudgetChangeEvent(HANDLE event) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const DWORD cookie = mNextBudgetChangeCookie++;
+            mBudgetChangeEvents.emplace_back(cookie, event);
+            return cookie;
+        }
+
+        void UnregisterBudgetChangeEvent(DWORD cookie) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBudgetChangeEvents.erase(
+                std::remove_if(mBudgetChangeEvents.begin(), mBudgetChangeEvents.end(),
+                               [cookie](const std::pair<DWORD, HANDLE>& event) {
+                                   return event.first == cookie;
+                               }),
+                mBudgetChangeEvents.end());
+        }
+
+        // Pageables made resident and evicted, and their size.
+        uint64_t GetMadeResidentCount() const {
+            return mMadeResidentCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t GetMadeResidentSize() const {
+            return mMadeResidentSize.load(std::memory_order_relaxed);
+        }
+
+        uint64_t GetEvictedCount() const {
+            return mEvictedCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t GetEvictedSize() const {
+            return mEvictedSize.load(std::memory_order_relaxed);
+        }
+
+        // ID3D12Object interface
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid,
+                                                 UINT* pDataSize,
+                                                 void* pData) override {
+            return DXGI_ERROR_NOT_FOUND;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid,
+                                                 UINT dataSize,
+                                                 const void* pData) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid,
+                                                          const IUnknown* pData) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetName(LPCWSTR name) override {
+            return S_OK;
+        }
+
+        // ID3D12Device interface
+        UINT STDMETHODCALLTYPE GetNodeCount() override {
+            return 1;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* pDesc,
+                                                     REFIID riid,
+                                                     void** ppCommandQueue) override {
+            ComPtr<MockD3D12CommandQueue> queue = CreateMock<MockD3D12CommandQueue>(this);
+            return queue->QueryInterface(riid, ppCommandQueue);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type,
+                                                         REFIID riid,
+                                                         void** ppCommandAllocator) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc,
+                                    REFIID riid,
+                                    void** ppPipelineState) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC* pDesc,
+                                   REFIID riid,
+                                   void** ppPipelineState) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandList(UINT nodeMask,
+                                                    D3D12_COMMAND_LIST_TYPE type,
+                                                    ID3D12CommandAllocator* pCommandAllocator,
+                                                    ID3D12PipelineState* pInitialState,
+                                                    REFIID riid,
+                                                    void** ppCommandList) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D12_FEATURE feature,
+                                                      void* pFeatureSupportData,
+                                                      UINT featureSupportDataSize) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(
+            const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc,
+            REFIID riid,
+            void** ppvHeap) override {
+            return E_NOTIMPL;
+        }
+
+        UINT STDMETHODCALLTYPE
+        GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) override {
+            return 0;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateRootSignature(UINT nodeMask,
+                                                      const void* pBlobWithRootSignature,
+                                                      SIZE_T blobLengthInBytes,
+                                                      REFIID riid,
+                                                      void** ppvRootSignature) override {
+            return E_NOTIMPL;
+        }
+
+        void STDMETHODCALLTYPE
+        CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC* pDesc,
+                                 D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CreateShaderResourceView(ID3D12Resource* pResource,
+                                 const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc,
+                                 D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CreateUnorderedAccessView(ID3D12Resource* pResource,
+                                  ID3D12Resource* pCounterResource,
+                                  const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc,
+                                  D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CreateRenderTargetView(ID3D12Resource* pResource,
+                               const D3D12_RENDER_TARGET_VIEW_DESC* pDesc,
+                               D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CreateDepthStencilView(ID3D12Resource* pResource,
+                               const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc,
+                               D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE CreateSampler(const D3D12_SAMPLER_DESC* pDesc,
+                                             D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CopyDescriptors(UINT numDestDescriptorRanges,
+                        const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts,
+                        const UINT* pDestDescriptorRangeSizes,
+                        UINT numSrcDescriptorRanges,
+                        const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts,
+                        const UINT* pSrcDescriptorRangeSizes,
+                        D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapsType) override {
+        }
+
+        void STDMETHODCALLTYPE
+        CopyDescriptorsSimple(UINT numDescriptors,
+                              D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart,
+                              D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptorRangeStart,
+                              D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapsType) override {
+        }
+
+        D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE
+        GetResourceAllocationInfo(UINT visibleMask,
+                                  UINT numResourceDescs,
+                                  const D3D12_RESOURCE_DESC* pResourceDescs) override {
+            return {};
+        }
+
+        D3D12_HEAP_PROPERTIES STDMETHODCALLTYPE GetCustomHeapProperties(UINT nodeMask,
+                                                                        D3D12_HEAP_TYPE heapType)
+            override {
+            return {};
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreateCommittedResource(const D3D12_HEAP_PROPERTIES* pHeapProperties,
+                                D3D12_HEAP_FLAGS heapFlags,
+                                const D3D12_RESOURCE_DESC* pDesc,
+                                D3D12_RESOURCE_STATES initialResourceState,
+                                const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+                                REFIID riidResource,
+                                void** ppvResource) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateHeap(const D3D12_HEAP_DESC* pDesc,
+                                             REFIID riid,
+                                             void** ppvHeap) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreatePlacedResource(ID3D12Heap* pHeap,
+                             UINT64 heapOffset,
+                             const D3D12_RESOURCE_DESC* pDesc,
+                             D3D12_RESOURCE_STATES initialState,
+                             const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+                             REFIID riid,
+                             void** ppvResource) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreateReservedResource(const D3D12_RESOURCE_DESC* pDesc,
+                               D3D12_RESOURCE_STATES initialState,
+                               const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+                               REFIID riid,
+                               void** ppvResource) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateSharedHandle(ID3D12DeviceChild* pObject,
+                                                     const SECURITY_ATTRIBUTES* pAttributes,
+                                                     DWORD access,
+                                                     LPCWSTR name,
+                                                     HANDLE* pHandle) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE OpenSharedHandle(HANDLE ntHandle,
+                                                   REFIID riid,
+                                                   void** ppvObj) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE OpenSharedHandleByName(LPCWSTR name,
+                                                         DWORD access,
+                                                         HANDLE* pNTHandle) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE MakeResident(UINT numObjects,
+                                               ID3D12Pageable* const* ppObjects) override {
+            uint64_t sizeToMakeResident = 0;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                uint64_t localSize = 0;
+                uint64_t nonLocalSize = 0;
+                for (UINT i = 0; i < numObjects; i++) {
+                    MockD3D12Pageable* pageable = static_cast<MockD3D12Pageable*>(ppObjects[i]);
+                    if (pageable->IsResident()) {
+                        continue;
+                    }
+                    if (pageable->GetMemorySegmentGroup() == DXGI_MEMORY_SEGMENT_GROUP_LOCAL) {
+                        localSize += pageable->GetSize();
+                    } else {
+                        nonLocalSize += pageable->GetSize();
+                    }
+                }
+
+                MemorySegment& local = mSegments[DXGI_MEMORY_SEGMENT_GROUP_LOCAL];
+                MemorySegment& nonLocal = mSegments[DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL];
+                if (mDescriptor.FailMakeResidentOverBudget &&
+                    (local.Usage + localSize > local.Budget ||
+                     nonLocal.Usage + nonLocalSize > nonLocal.Budget)) {
+                    return E_OUTOFMEMORY;
+                }
+
+                for (UINT i = 0; i < numObjects; i++) {
+                    static_cast<MockD3D12Pageable*>(ppObjects[i])->SetResident(true);
+                }
+
+                local.Usage += localSize;
+                nonLocal.Usage += nonLocalSize;
+                sizeToMakeResident = localSize + nonLocalSize;
+            }
+
+            mMadeResidentCount.fetch_add(numObjects, std::memory_order_relaxed);
+            mMadeResidentSize.fetch_add(sizeToMakeResident, std::memory_order_relaxed);
+
+            if (mDescriptor.MakeResidentBytesPerSecond > 0) {
+                SimulateMockLatency(sizeToMakeResident / mDescriptor.MakeResidentBytesPerSecond);
+            }
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Evict(UINT numObjects,
+                                        ID3D12Pageable* const* ppObjects) override {
+            uint64_t sizeEvicted = 0;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (UINT i = 0; i < numObjects; i++) {
+                    MockD3D12Pageable* pageable = static_cast<MockD3D12Pageable*>(ppObjects[i]);
+                    if (!pageable->IsResident()) {
+                        continue;
+                    }
+                    pageable->SetResident(false);
+                    mSegments[pageable->GetMemorySegmentGroup()].Usage -= pageable->GetSize();
+                    sizeEvicted += pageable->GetSize();
+                }
+            }
+
+            mEvictedCount.fetch_add(numObjects, std::memory_order_relaxed);
+            mEvictedSize.fetch_add(sizeEvicted, std::memory_order_relaxed);
+
+            SimulateMockLatency(mDescriptor.EvictTimeInSeconds);
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateFence(UINT64 initialValue,
+                                              D3D12_FENCE_FLAGS flags,
+                                              REFIID riid,
+                                              void** ppFence) override {
+            ComPtr<MockD3D12Fence> fence =
+                CreateMock<MockD3D12Fence>(this, initialValue, mDescriptor.FenceWaitTimeInSeconds);
+            return fence->QueryInterface(riid, ppFence);
+        }
+
+        HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override {
+            return S_OK;
+        }
+
+        void STDMETHODCALLTYPE
+        GetCopyableFootprints(const D3D12_RESOURCE_DESC* pResourceDesc,
+                              UINT firstSubresource,
+                              UINT numSubresources,
+                              UINT64 baseOffset,
+                              D3D12_PLACED_SUBRESOURCE_FOOTPRINT* pLayouts,
+                              UINT* pNumRows,
+                              UINT64* pRowSizeInBytes,
+                              UINT64* pTotalBytes) override {
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateQueryHeap(const D3D12_QUERY_HEAP_DESC* pDesc,
+                                                  REFIID riid,
+                                                  void** ppvHeap) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetStablePowerState(BOOL enable) override {
+            return E_NOTIMPL;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        CreateCommandSignature(const D3D12_COMMAND_SIGNATURE_DESC* pDesc,
+                               ID3D12RootSignature* pRootSignature,
+                               REFIID riid,
+                               void** ppvCommandSignature) override {
+            return E_NOTIMPL;
+        }
+
+        void STDMETHODCALLTYPE
+        GetResourceTiling(ID3D12Resource* pTiledResource,
+                          UINT* pNumTilesForEntireResource,
+                          D3D12_PACKED_MIP_INFO* pPackedMipDesc,
+                          D3D12_TILE_SHAPE* pStandardTileShapeForNonPackedMips,
+                          UINT* pNumSubresourceTilings,
+                          UINT firstSubresourceTilingToGet,
+                          D3D12_SUBRESOURCE_TILING* pSubresourceTilingsForNonPackedMips) override {
+        }
+
+        LUID STDMETHODCALLTYPE GetAdapterLuid() override {
+            return {};
+        }
+
+      protected:
+        bool SupportsInterface(REFIID riid) const override {
+            return MockUnknownImpl::SupportsInterface(riid) || riid == __uuidof(ID3D12Object);
+        }
+
+      private:
+        struct MemorySegment {
+            uint64_t Budget = 0;
+            uint64_t Usage = 0;
+            uint64_t Reservation = 0;
+        };
+
+        const MOCK_DEVICE_DESC mDescriptor;
+
+        std::mutex mMutex;
+        MemorySegment mSegments[2];
+        std::vector<std::pair<DWORD, HANDLE>> mBudgetChangeEvents;
+        DWORD mNextBudgetChangeCookie = 1;
+
+        std::atomic<uint64_t> mMadeResidentCount{0};
+        std::atomic<uint64_t> mMadeResidentSize{0};
+        std::atomic<uint64_t> mEvictedCount{0};
+        std::atomic<uint64_t> mEvictedSize{0};
+    };
+
+    // Adapter which reports the budget and usage simulated by |device|.
+    class MockDXGIAdapter3 final : public MockUnknownImpl<IDXGIAdapter3> {
+      public:
+        explicit MockDXGIAdapter3(MockD3D12Device* device) : mDevice(device) {
+        }
+
+        // IDXGIObject interface
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID name,
+                                                 UINT dataSize,
+                                                 const void* pData) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID name,
+                                                          const IUnknown* pUnknown) override {
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID name,
+                                                 UINT* pDataSize,
+                                                 void* pData) override {
+            return DXGI_ERROR_NOT_FOUND;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetParent(REFIID riid, void** ppParent) override {
+            return E_NOINTERFACE;
+        }
+
+        // IDXGIAdapter interface
+        HRESULT STDMETHODCALLTYPE EnumOutputs(UINT output, IDXGIOutput** ppOutput) override {
+            return DXGI_ERROR_NOT_FOUND;
+        }
+
+        HRESULT STDMETHODCALLTYPE GetDesc(DXGI_ADAPTER_DESC* pDesc) override {
+            *pDesc = {};
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE CheckInterfaceSupport(REFGUID interfaceName,
+                                                        LARGE_INTEGER* pUMDVersion) override {
+            return DXGI_ERROR_UNSUPPORTED;
+        }
+
+        // IDXGIAdapter1 interface
+        HRESULT STDMETHODCALLTYPE GetDesc1(DXGI_ADAPTER_DESC1* pDesc) override {
+            *pDesc = {};
+            return S_OK;
+        }
+
+        // IDXGIAdapter2 interface
+        HRESULT STDMETHODCALLTYPE GetDesc2(DXGI_ADAPTER_DESC2* pDesc) override {
+            *pDesc = {};
+            return S_OK;
+        }
+
+        // IDXGIAdapter3 interface
+        HRESULT STDMETHODCALLTYPE
+        RegisterHardwareContentProtectionTeardownStatusEvent(HANDLE hEvent,
+                                                             DWORD* pdwCookie) override {
+            return E_NOTIMPL;
+        }
+
+        void STDMETHODCALLTYPE UnregisterHardwareContentProtectionTeardownStatus(
+            DWORD dwCookie) override {
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        QueryVideoMemoryInfo(UINT nodeIndex,
+                             DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
+                             DXGI_QUERY_VIDEO_MEMORY_INFO* pVideoMemoryInfo) override {
+            *pVideoMemoryInfo = mDevice->GetVideoMemoryInfo(memorySegmentGroup);
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetVideoMemoryReservation(
+            UINT nodeIndex,
+            DXGI_MEMORY_SEGMENT_GROUP memorySegmentGroup,
+            UINT64 reservation) override {
+            mDevice->SetReservation(memorySegmentGroup, reservation);
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE
+        RegisterVideoMemoryBudgetChangeNotificationEvent(HANDLE hEvent,
+                                                         DWORD* pdwCookie) override {
+            *pdwCookie = mDevice->RegisterBudgetChangeEvent(hEvent);
+            return S_OK;
+        }
+
+        void STDMETHODCALLTYPE UnregisterVideoMemoryBudgetChangeNotification(
+            DWORD dwCookie) override {
+            mDevice->UnregisterBudgetChangeEvent(dwCookie);
+        }
+
+      protected:
+        bool SupportsInterface(REFIID riid) const override {
+            return MockUnknownImpl::SupportsInterface(riid) || riid == __uuidof(IDXGIObject) ||
+                   riid == __uuidof(IDXGIAdapter) || riid == __uuidof(IDXGIAdapter1) ||
+                   riid == __uuidof(IDXGIAdapter2);
+        }
+
+      private:
+        ComPtr<MockD3D12Device> mDevice;
+    };
+
+}}  // namespace gpgmm::d3d12
+
+#endif  // TESTS_D3D12MOCKDEVICE_H_
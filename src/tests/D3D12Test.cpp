@@ -14,6 +14,8 @@
 
 #include "src/tests/D3D12Test.h"
 
+#include "gpgmm/d3d12/DefaultsD3D12.h"
+
 #include <gpgmm_d3d12.h>
 
 namespace gpgmm { namespace d3d12 {
@@ -63,6 +65,11 @@ namespace gpgmm { namespace d3d12 {
         desc.IsUMA = mIsUMA;
         desc.ResourceHeapTier = mResourceHeapTier;
 
+        // Resource heaps are sized by the adapter by default. However for testing purposes,
+        // expectations which check GPU memory usage assume the same size on every adapter.
+        desc.PreferredResourceHeapSize = kDefaultPreferredResourceHeapSize;
+        desc.ResourceFragmentationLimit = kDefaultFragmentationLimit;
+
         // Pre-fetching is enabled by default. However for testing purposes, pre-fetching changes
         // expectations that check GPU memory usage and needs to be tested in isolation.
         if (!enablePrefetch) {
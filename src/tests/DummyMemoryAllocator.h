@@ -21,24 +21,54 @@
 
 namespace gpgmm {
 
+    // Memory whose residency can be changed to simulate memory being evicted.
+    class DummyMemory : public MemoryBase {
+      public:
+        explicit DummyMemory(uint64_t size) : MemoryBase(size) {
+        }
+
+        bool IsEvicted() const override {
+            return mIsEvicted;
+        }
+
+        void SetEvicted(bool isEvicted) {
+            mIsEvicted = isEvicted;
+        }
+
+      private:
+        bool mIsEvicted = false;
+    };
+
+    // Creates a request for |size| bytes which does not specify any hints.
+    inline MEMORY_ALLOCATION_REQUEST CreateBasicRequest(uint64_t size,
+                                                        uint64_t alignment,
+                                                        bool neverAllocate = false,
+                                                        bool cacheSize = false,
+                                                        bool prefetchMemory = false) {
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = size;
+        request.Alignment = alignment;
+        request.NeverAllocate = neverAllocate;
+        request.CacheSize = cacheSize;
+        request.PrefetchMemory = prefetchMemory;
+        return request;
+    }
+
     class DummyMemoryAllocator : public MemoryAllocator {
       public:
-        std::unique_ptr<MemoryAllocation> TryAllocateMemory(uint64_t allocationSize,
-                                                            uint64_t alignment,
-                                                            bool neverAllocate,
-                                                            bool cacheSize,
-                                                            bool prefetchMemory) override {
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override {
             TRACE_EVENT0(TraceEventCategory::Default, "DummyMemoryAllocator.TryAllocateMemory");
 
             std::lock_guard<std::mutex> lock(mMutex);
 
-            if (neverAllocate) {
+            if (request.NeverAllocate) {
                 return {};
             }
 
             mInfo.UsedMemoryCount++;
-            mInfo.UsedMemoryUsage += allocationSize;
-            return std::make_unique<MemoryAllocation>(this, new MemoryBase(allocationSize));
+            mInfo.UsedMemoryUsage += request.Size;
+            return std::make_unique<MemoryAllocation>(this, new DummyMemory(request.Size));
         }
 
         void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override {
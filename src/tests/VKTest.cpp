@@ -0,0 +1,97 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/tests/VKTest.h"
+
+#include <gpgmm_vk.h>
+
+#include <cstring>
+
+namespace gpgmm { namespace vk {
+
+    void VKTestBase::SetUp() {
+        GPGMMTestBase::SetUp();
+
+        VkApplicationInfo applicationInfo = {};
+        applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+        VkInstanceCreateInfo instanceInfo = {};
+        instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &applicationInfo;
+        ASSERT_VK_SUCCESS(vkCreateInstance(&instanceInfo, nullptr, &mInstance));
+
+        uint32_t physicalDeviceCount = 1;
+        VkResult result = vkEnumeratePhysicalDevices(mInstance, &physicalDeviceCount,
+                                                     &mPhysicalDevice);
+        ASSERT_TRUE(result == VK_SUCCESS || result == VK_INCOMPLETE);
+        ASSERT_NE(mPhysicalDevice, VK_NULL_HANDLE);
+
+        uint32_t extensionCount = 0;
+        ASSERT_VK_SUCCESS(vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr,
+                                                               &extensionCount, nullptr));
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        ASSERT_VK_SUCCESS(vkEnumerateDeviceExtensionProperties(
+            mPhysicalDevice, nullptr, &extensionCount, extensions.data()));
+
+        std::vector<const char*> enabledExtensions;
+        for (const VkExtensionProperties& extension : extensions) {
+            if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+                enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                mIsBudgetSupported = true;
+            }
+        }
+
+        // Resources are never submitted, so any queue family will do.
+        const float queuePriority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo = {};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = 0;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &queuePriority;
+
+        VkDeviceCreateInfo deviceInfo = {};
+        deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        deviceInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        deviceInfo.ppEnabledExtensionNames = enabledExtensions.data();
+        ASSERT_VK_SUCCESS(vkCreateDevice(mPhysicalDevice, &deviceInfo, nullptr, &mDevice));
+    }
+
+    void VKTestBase::TearDown() {
+        if (mDevice != VK_NULL_HANDLE) {
+            vkDestroyDevice(mDevice, nullptr);
+        }
+        if (mInstance != VK_NULL_HANDLE) {
+            vkDestroyInstance(mInstance, nullptr);
+        }
+
+        GPGMMTestBase::TearDown();
+    }
+
+    ALLOCATOR_DESC VKTestBase::CreateBasicAllocatorDesc() const {
+        ALLOCATOR_DESC desc = {};
+        desc.PhysicalDevice = mPhysicalDevice;
+        desc.Device = mDevice;
+        desc.IsBudgetEnabled = mIsBudgetSupported;
+
+        // Pre-fetching changes expectations that check GPU memory usage and needs to be tested in
+        // isolation.
+        desc.Flags |= ALLOCATOR_FLAG_DISABLE_MEMORY_PREFETCH;
+
+        return desc;
+    }
+
+}}  // namespace gpgmm::vk
@@ -0,0 +1,47 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_VKTEST_H_
+#define TESTS_VKTEST_H_
+
+#include "tests/GPGMMTest.h"
+
+#include "gpgmm/vk/vk_platform.h"
+
+#include <vector>
+
+#define ASSERT_VK_SUCCESS(expr) ASSERT_EQ(expr, VK_SUCCESS)
+
+namespace gpgmm { namespace vk {
+
+    struct ALLOCATOR_DESC;
+
+    class VKTestBase : public GPGMMTestBase {
+      public:
+        void SetUp();
+        void TearDown();
+
+        ALLOCATOR_DESC CreateBasicAllocatorDesc() const;
+
+      protected:
+        VkInstance mInstance = VK_NULL_HANDLE;
+        VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+        VkDevice mDevice = VK_NULL_HANDLE;
+
+        bool mIsBudgetSupported = false;
+    };
+
+}}  // namespace gpgmm::vk
+
+#endif  // TESTS_VKTEST_H_
@@ -16,14 +16,24 @@
 #include "tests/capture_replay_tests/GPGMMCaptureReplayTests.h"
 
 #include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Assert.h"
 #include "gpgmm/common/Log.h"
 #include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/d3d12/UtilsD3D12.h"
 #include "tests/D3D12Test.h"
+#include "tests/capture_replay_tests/JSONTraceEventReader.h"
 
+#include <atomic>
+#include <chrono>
+#include <ctime>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <gpgmm_d3d12.h>
 #include <json/json.h>
@@ -38,6 +48,12 @@ namespace {
             static_cast<ALLOCATION_FLAGS>(allocationDescriptorJsonValue["Flags"].asInt());
         allocationDescriptor.HeapType =
             static_cast<D3D12_HEAP_TYPE>(allocationDescriptorJsonValue["HeapType"].asInt());
+        allocationDescriptor.FenceValue = allocationDescriptorJsonValue["FenceValue"].asUInt64();
+        allocationDescriptor.ResidencyPriority = static_cast<D3D12_RESIDENCY_PRIORITY>(
+            allocationDescriptorJsonValue["ResidencyPriority"].asUInt());
+        allocationDescriptor.Lifetime =
+            static_cast<ALLOCATION_LIFETIME>(allocationDescriptorJsonValue["Lifetime"].asInt());
+        allocationDescriptor.Tag = allocationDescriptorJsonValue["Tag"].asUInt();
         return allocationDescriptor;
     }
 
@@ -91,6 +107,105 @@ namespace {
         return (args.isMember("Description") && args.isMember("ID"));
     }
 
+    enum class ReplayCommandType {
+        CreateResource,
+        SnapshotAllocation,
+        CreateAllocation,
+        DestroyAllocation,
+        SnapshotAllocator,
+        DestroyAllocator,
+        SnapshotHeap,
+        DestroyHeap,
+        SetVideoMemoryBudget,
+    };
+
+    // Trace event converted from JSON ahead of replay, so parsing is never timed. Only the
+    // fields used by the command type are set.
+    struct ReplayCommand {
+        ReplayCommandType Type;
+        std::string ID;
+        uint32_t ThreadID = 0;  // Thread which recorded the event.
+        double Timestamp = 0;   // Time the event was recorded, in seconds.
+
+        // CreateResource
+        std::string AllocatorID;
+        ALLOCATION_DESC AllocationDescriptor = {};
+        D3D12_RESOURCE_DESC ResourceDescriptor = {};
+        D3D12_RESOURCE_STATES InitialResourceState = {};
+        D3D12_CLEAR_VALUE ClearValue = {};
+        bool HasClearValue = false;
+
+        // SnapshotAllocation
+        RESOURCE_ALLOCATION_INFO AllocationInfo = {};
+
+        // SnapshotHeap
+        HEAP_INFO HeapInfo = {};
+
+        // SetVideoMemoryBudget
+        DXGI_MEMORY_SEGMENT_GROUP MemorySegmentGroup = {};
+        uint64_t VideoMemoryBudget = 0;
+
+        // CreateResource args (for logging) or SnapshotAllocator snapshot.
+        Json::Value Args;
+    };
+
+    // Allocators are only created or destroyed once every thread stopped replaying.
+    bool IsAllocatorCommand(const ReplayCommand& command) {
+        return command.Type == ReplayCommandType::SnapshotAllocator ||
+               command.Type == ReplayCommandType::DestroyAllocator;
+    }
+
+    bool IsHeapCommand(const ReplayCommand& command) {
+        return command.Type == ReplayCommandType::SnapshotHeap ||
+               command.Type == ReplayCommandType::DestroyHeap;
+    }
+
+    // Counts where a CreateResource got its memory from, by comparing the counters of the
+    // allocator before and after. Only approximate once other threads allocate concurrently, or
+    // should a prefetch complete during the call.
+    void CountMemorySource(const QUERY_RESOURCE_ALLOCATOR_INFO& before,
+                           const QUERY_RESOURCE_ALLOCATOR_INFO& after,
+                           CaptureReplayMemorySourceStats* stats) {
+        if (after.PrefetchedMemoryWaitCount > before.PrefetchedMemoryWaitCount) {
+            stats->PrefetchWaitCount++;
+        } else if (after.PrefetchedMemoryReuseCount > before.PrefetchedMemoryReuseCount) {
+            stats->PrefetchedCount++;
+        } else if (after.UsedMemoryUsage + after.FreeMemoryUsage >
+                   before.UsedMemoryUsage + before.FreeMemoryUsage) {
+            stats->CreatedCount++;
+        } else if (after.RetainedMemoryReuseCount > before.RetainedMemoryReuseCount ||
+                   after.FreeMemoryUsage < before.FreeMemoryUsage) {
+            stats->PooledCount++;
+        } else {
+            stats->ExistingCount++;
+        }
+    }
+
+    // State of a replay shared by every thread.
+    struct ReplayState {
+        std::mutex Mutex;
+
+        // Paced replays wait until the time since the first command was recorded, scaled, has
+        // passed since the replay started.
+        bool HasPaceStarted = false;
+        double FirstTimestamp = 0;
+        std::chrono::steady_clock::time_point PaceStartTime;
+
+        std::unordered_map<std::string, RESOURCE_ALLOCATION_INFO> AllocationInfoToID;
+        std::unordered_map<std::string, HEAP_INFO> HeapInfoToID;
+        std::unordered_map<std::string, ComPtr<ResourceAllocator>> AllocatorToID;
+        std::unordered_map<std::string, ComPtr<ResourceAllocation>> AllocationToID;
+    };
+
+    // State of a replay owned by a single thread.
+    struct ReplayThreadState {
+        gpgmm::PlatformTime* PlatformTime = nullptr;
+
+        // Created but not yet assigned the ID of its trace event, which follows on the same
+        // thread.
+        ComPtr<ResourceAllocation> AllocationWithoutID;
+    };
+
 }  // namespace
 
 class D3D12EventTraceReplay : public D3D12TestBase, public CaptureReplayTestWithParams {
@@ -103,343 +218,748 @@ class D3D12EventTraceReplay : public D3D12TestBase, public CaptureReplayTestWith
         D3D12TestBase::TearDown();
     }
 
-    void RunTest(const TraceFile& traceFile,
-                 const TestEnviromentParams& envParams,
-                 const uint64_t iterationIndex) override {
+    // Converts each event of the trace into a command, one event at a time, and passes it to
+    // |commandCallback|. Stops early if the callback failed or skipped the test.
+    void ParseTraceFile(const TraceFile& traceFile,
+                        const std::function<void(ReplayCommand&&)>& commandCallback) {
         std::ifstream traceFileStream(traceFile.path, std::ifstream::binary);
+        ASSERT_TRUE(traceFileStream.is_open());
 
-        Json::Value root;
-        Json::Reader reader;
-        ASSERT_TRUE(reader.parse(traceFileStream, root, false));
+        JSONTraceEventReader reader(traceFileStream);
 
-        std::unordered_map<std::string, RESOURCE_ALLOCATION_INFO> allocationInfoToID;
-        std::unordered_map<std::string, HEAP_INFO> heapInfoToID;
+        std::string currentAllocatorID;
+        uint64_t eventCount = 0;
 
-        ComPtr<ResourceAllocation> allocationWithoutID;
+        Json::Value event;
+        while (reader.ReadNextEvent(&event)) {
+            eventCount++;
 
-        std::unordered_map<std::string, ComPtr<ResourceAllocator>> allocatorToID;
-        std::unordered_map<std::string, ComPtr<ResourceAllocation>> allocationToID;
+            const std::string& name = event["name"].asString();
+            const char phase = event["ph"].asString()[0];
 
-        std::string currentAllocatorID;
+            ReplayCommand command = {};
+            command.ID = event["id"].asString();
+            command.ThreadID = event["tid"].asUInt();
+            command.Timestamp = event["ts"].asDouble() / 1e6;
 
-        const Json::Value& traceEvents = root["traceEvents"];
-        ASSERT_TRUE(!traceEvents.empty());
-
-        for (Json::Value::ArrayIndex eventIndex = 0; eventIndex < traceEvents.size();
-             eventIndex++) {
-            const Json::Value& event = traceEvents[eventIndex];
-            if (event["name"].asString() == "ResourceAllocator.CreateResource") {
-                switch (*event["ph"].asCString()) {
-                    case TRACE_EVENT_PHASE_INSTANT: {
-                        const Json::Value& args = event["args"];
-                        ASSERT_FALSE(args.empty());
-
-                        // TODO: Consider encoding type instead of checking fields.
-                        if (IsErrorEvent(args)) {
-                            continue;
-                        }
+            if (name == "ResourceAllocator.CreateResource") {
+                if (phase != TRACE_EVENT_PHASE_INSTANT) {
+                    continue;
+                }
 
-                        // Imported resources cannot be used for playback.
-                        if (args["allocationDescriptor"].empty()) {
-                            continue;
-                        }
+                const Json::Value& args = event["args"];
+                ASSERT_FALSE(args.empty());
 
-                        ALLOCATION_DESC allocationDescriptor =
-                            ConvertToAllocationDesc(args["allocationDescriptor"]);
+                // TODO: Consider encoding type instead of checking fields.
+                if (IsErrorEvent(args)) {
+                    continue;
+                }
 
-                        const D3D12_RESOURCE_STATES initialResourceState =
-                            static_cast<D3D12_RESOURCE_STATES>(
-                                args["initialResourceState"].asInt());
+                // Imported resources cannot be used for playback.
+                if (args["allocationDescriptor"].empty()) {
+                    continue;
+                }
 
-                        const D3D12_CLEAR_VALUE* clearValuePtr = nullptr;
-                        D3D12_CLEAR_VALUE clearValue = {};
-                        const Json::Value& clearValueJsonValue = args["clearValue"];
-                        if (!clearValueJsonValue.empty()) {
-                            clearValue = ConvertToD3D12ClearValue(clearValueJsonValue);
-                            clearValuePtr = &clearValue;
-                        }
+                command.Type = ReplayCommandType::CreateResource;
+                command.AllocatorID = currentAllocatorID;
+                command.AllocationDescriptor =
+                    ConvertToAllocationDesc(args["allocationDescriptor"]);
+                command.InitialResourceState =
+                    static_cast<D3D12_RESOURCE_STATES>(args["initialResourceState"].asInt());
+
+                const Json::Value& clearValueJsonValue = args["clearValue"];
+                if (!clearValueJsonValue.empty()) {
+                    command.ClearValue = ConvertToD3D12ClearValue(clearValueJsonValue);
+                    command.HasClearValue = true;
+                }
 
-                        const D3D12_RESOURCE_DESC resourceDescriptor =
-                            ConvertToD3D12ResourceDesc(args["resourceDescriptor"]);
+                command.ResourceDescriptor =
+                    ConvertToD3D12ResourceDesc(args["resourceDescriptor"]);
+                command.Args = args;
 
-                        auto it = allocatorToID.find(currentAllocatorID);
-                        ASSERT_TRUE(it != allocatorToID.end());
+            } else if (name == "GPUMemoryAllocation") {
+                switch (phase) {
+                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
+                        const Json::Value& snapshot = event["args"]["snapshot"];
 
-                        ResourceAllocator* resourceAllocator =
-                            allocatorToID[currentAllocatorID].Get();
-                        ASSERT_NE(resourceAllocator, nullptr);
+                        command.Type = ReplayCommandType::SnapshotAllocation;
+                        command.AllocationInfo.SizeInBytes = snapshot["SizeInBytes"].asUInt64();
+                        command.AllocationInfo.HeapOffset = snapshot["HeapOffset"].asUInt64();
+                        command.AllocationInfo.OffsetFromResource =
+                            snapshot["OffsetFromResource"].asUInt64();
+                        command.AllocationInfo.Method =
+                            static_cast<gpgmm::AllocationMethod>(snapshot["Method"].asInt());
+                    } break;
 
-                        if (envParams.IsNeverAllocate) {
-                            allocationDescriptor.Flags |= ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
-                        }
+                    case TRACE_EVENT_PHASE_CREATE_OBJECT: {
+                        command.Type = ReplayCommandType::CreateAllocation;
+                    } break;
 
-                        mPlatformTime->StartElapsedTime();
+                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
+                        command.Type = ReplayCommandType::DestroyAllocation;
+                    } break;
 
-                        HRESULT hr = resourceAllocator->CreateResource(
-                            allocationDescriptor, resourceDescriptor, initialResourceState,
-                            clearValuePtr, &allocationWithoutID);
+                    default:
+                        continue;
+                }
+            } else if (name == "GPUMemoryAllocator") {
+                switch (phase) {
+                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
+                        const Json::Value& snapshot = event["args"]["snapshot"];
+                        ASSERT_FALSE(snapshot.empty());
 
-                        const double elapsedTime = mPlatformTime->EndElapsedTime();
+                        command.Type = ReplayCommandType::SnapshotAllocator;
+                        command.Args = snapshot;
+                    } break;
 
-                        if (!envParams.IsNeverAllocate && FAILED(hr)) {
-                            gpgmm::ErrorLog() << "CreateResource failed with :" << args << ".\n";
-                        }
+                    case TRACE_EVENT_PHASE_CREATE_OBJECT: {
+                        // Assume subsequent events are always against this allocator instance.
+                        // This is because call trace events have no ID associated with them.
+                        currentAllocatorID = command.ID;
+                        continue;
+                    }
 
-                        ASSERT_SUCCEEDED(hr);
+                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
+                        command.Type = ReplayCommandType::DestroyAllocator;
+                    } break;
 
-                        mReplayedAllocationStats.CurrentUsage += allocationWithoutID->GetSize();
-                        mReplayedAllocationStats.PeakUsage =
-                            std::max(mReplayedAllocationStats.CurrentUsage,
-                                     mReplayedAllocationStats.PeakUsage);
-                        mReplayedAllocationStats.TotalCount++;
-                        mReplayedAllocationStats.TotalSize += allocationWithoutID->GetSize();
+                    default:
+                        continue;
+                }
+            } else if (name == "ResidencyManager.QueryVideoMemoryInfo") {
+                if (phase != TRACE_EVENT_PHASE_INSTANT) {
+                    continue;
+                }
+
+                const Json::Value& args = event["args"];
+                ASSERT_FALSE(args.empty());
+
+                command.Type = ReplayCommandType::SetVideoMemoryBudget;
+                command.AllocatorID = currentAllocatorID;
+                command.MemorySegmentGroup =
+                    static_cast<DXGI_MEMORY_SEGMENT_GROUP>(args["MemorySegmentGroup"].asInt());
+                command.VideoMemoryBudget = args["Budget"].asUInt64();
+
+            } else if (name == "GPUMemoryBlock") {
+                switch (phase) {
+                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
+                        const Json::Value& snapshot = event["args"]["snapshot"];
 
-                        mReplayedAllocateStats.TotalCpuTime += elapsedTime;
-                        mReplayedAllocateStats.PeakCpuTime =
-                            std::max(elapsedTime, mReplayedAllocateStats.PeakCpuTime);
-                        mReplayedAllocateStats.TotalNumOfCalls++;
+                        command.Type = ReplayCommandType::SnapshotHeap;
+                        command.HeapInfo.IsResident = snapshot["IsResident"].asBool();
+                        command.HeapInfo.MemorySegmentGroup =
+                            static_cast<DXGI_MEMORY_SEGMENT_GROUP>(
+                                snapshot["MemorySegmentGroup"].asInt());
+                        command.HeapInfo.SizeInBytes = snapshot["SizeInBytes"].asUInt64();
+                    } break;
 
+                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
+                        command.Type = ReplayCommandType::DestroyHeap;
                     } break;
 
                     default:
-                        break;
+                        continue;
                 }
-            } else if (event["name"].asString() == "GPUMemoryAllocation") {
-                switch (*event["ph"].asCString()) {
-                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
-                        const std::string& allocationID = event["id"].asString();
-                        if (allocationInfoToID.find(allocationID) != allocationInfoToID.end()) {
-                            continue;
-                        }
+            } else {
+                continue;
+            }
 
-                        const Json::Value& snapshot = event["args"]["snapshot"];
+            commandCallback(std::move(command));
+            if (HasFatalFailure() || IsSkipped()) {
+                return;
+            }
+        }
 
-                        RESOURCE_ALLOCATION_INFO allocationDesc = {};
-                        allocationDesc.SizeInBytes = snapshot["SizeInBytes"].asUInt64();
-                        allocationDesc.HeapOffset = snapshot["HeapOffset"].asUInt64();
-                        allocationDesc.OffsetFromResource =
-                            snapshot["OffsetFromResource"].asUInt64();
-                        allocationDesc.Method =
-                            static_cast<gpgmm::AllocationMethod>(snapshot["Method"].asInt());
+        ASSERT_FALSE(reader.HasError());
+        ASSERT_TRUE(eventCount > 0);
+    }
 
-                        mCapturedAllocationStats.TotalSize += allocationDesc.SizeInBytes;
-                        mCapturedAllocationStats.TotalCount++;
-                        mCapturedAllocationStats.CurrentUsage += allocationDesc.SizeInBytes;
-                        mCapturedAllocationStats.PeakUsage =
-                            std::max(mCapturedAllocationStats.PeakUsage,
-                                     mCapturedAllocationStats.CurrentUsage);
+    void RunTest(const TraceFile& traceFile,
+                 const TestEnviromentParams& envParams,
+                 const uint64_t iterationIndex) override {
+        // The trace is only parsed once per loop since regenerating overwrites it. When streaming,
+        // commands are instead replayed once parsed so only one event is kept in memory.
+        if (!envParams.IsStreaming && iterationIndex == 0) {
+            mReplayCommands.clear();
+            ASSERT_NO_FATAL_FAILURE(ParseTraceFile(traceFile, [&](ReplayCommand&& command) {
+                mReplayCommands.push_back(std::move(command));
+            }));
+        }
 
-                        ASSERT_TRUE(
-                            allocationInfoToID.insert({allocationID, allocationDesc}).second);
-                    } break;
+        const std::clock_t replayStartTime = std::clock();
 
-                    case TRACE_EVENT_PHASE_CREATE_OBJECT: {
-                        if (allocationWithoutID == nullptr) {
-                            continue;
-                        }
+        ReplayState state;
+        ReplayThreadState threadState = {};
+        threadState.PlatformTime = mPlatformTime.get();
 
-                        ASSERT_TRUE(allocationWithoutID != nullptr);
-                        const std::string& allocationID = event["id"].asString();
-                        ASSERT_TRUE(
-                            allocationToID.insert({allocationID, allocationWithoutID}).second);
+        if (envParams.IsStreaming) {
+            ParseTraceFile(traceFile, [&](ReplayCommand&& command) {
+                ReplayTraceCommand(command, traceFile, envParams, iterationIndex, &state,
+                                   &threadState);
+            });
+        } else if (envParams.IsMultiThreaded) {
+            ReplayConcurrently(traceFile, envParams, iterationIndex, &state);
+        } else {
+            for (const ReplayCommand& command : mReplayCommands) {
+                ReplayTraceCommand(command, traceFile, envParams, iterationIndex, &state,
+                                   &threadState);
+                if (HasFatalFailure() || IsSkipped()) {
+                    return;
+                }
+            }
+        }
 
-                        ASSERT_TRUE(allocationWithoutID.Reset() == 1);
-                    } break;
+        if (HasFatalFailure() || IsSkipped()) {
+            return;
+        }
 
-                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
-                        const std::string& allocationID = event["id"].asString();
+        ASSERT_TRUE(state.AllocationInfoToID.empty());
+        ASSERT_TRUE(state.AllocatorToID.empty());
+        ASSERT_TRUE(state.HeapInfoToID.empty());
 
-                        auto it = allocationInfoToID.find(allocationID);
-                        if (it == allocationInfoToID.end()) {
-                            continue;
-                        }
+        mReplayCpuTime += static_cast<double>(std::clock() - replayStartTime) / CLOCKS_PER_SEC;
+    }
+
+    // Replays the commands recorded by each thread on a thread of its own. Commands of the same
+    // object (ie. an allocation created on one thread and released on another) are still
+    // replayed in the recorded order, but are otherwise free to interleave differently.
+    void ReplayConcurrently(const TraceFile& traceFile,
+                            const TestEnviromentParams& envParams,
+                            uint64_t iterationIndex,
+                            ReplayState* state) {
+        size_t commandIndex = 0;
+        while (commandIndex < mReplayCommands.size()) {
+            if (IsAllocatorCommand(mReplayCommands[commandIndex])) {
+                ReplayThreadState threadState = {};
+                threadState.PlatformTime = mPlatformTime.get();
+                ReplayTraceCommand(mReplayCommands[commandIndex], traceFile, envParams,
+                                   iterationIndex, state, &threadState);
+                if (HasFatalFailure() || IsSkipped()) {
+                    return;
+                }
+                commandIndex++;
+                continue;
+            }
 
-                        const RESOURCE_ALLOCATION_INFO& allocationDesc = it->second;
-                        mCapturedAllocationStats.CurrentUsage -= allocationDesc.SizeInBytes;
+            size_t endCommandIndex = commandIndex;
+            while (endCommandIndex < mReplayCommands.size() &&
+                   !IsAllocatorCommand(mReplayCommands[endCommandIndex])) {
+                endCommandIndex++;
+            }
+
+            ReplayOnThreads(commandIndex, endCommandIndex, traceFile, envParams, iterationIndex,
+                            state);
+            if (HasFatalFailure()) {
+                return;
+            }
+
+            commandIndex = endCommandIndex;
+        }
+    }
 
-                        ASSERT_EQ(allocationInfoToID.erase(allocationID), 1u);
+    void ReplayOnThreads(size_t beginCommandIndex,
+                         size_t endCommandIndex,
+                         const TraceFile& traceFile,
+                         const TestEnviromentParams& envParams,
+                         uint64_t iterationIndex,
+                         ReplayState* state) {
+        // Position of a command in the commands replayed by a thread.
+        struct CommandPosition {
+            size_t ThreadIndex;
+            size_t CommandIndex;
+        };
+
+        struct ThreadCommand {
+            const ReplayCommand* Command;
+            bool HasDependency;
+            CommandPosition Dependency;  // Command to wait for, replayed by another thread.
+        };
+
+        struct ReplayThread {
+            std::vector<ThreadCommand> Commands;
+            std::atomic<size_t> ReplayedCommandCount{0};
+        };
+
+        std::vector<std::unique_ptr<ReplayThread>> threads;
+        std::unordered_map<uint32_t, size_t> threadIndexToID;
+
+        // Last command of each object, so the next command of it waits if on another thread.
+        std::unordered_map<std::string, CommandPosition> lastAllocationCommandToID;
+        std::unordered_map<std::string, CommandPosition> lastHeapCommandToID;
+
+        for (size_t i = beginCommandIndex; i < endCommandIndex; i++) {
+            const ReplayCommand& command = mReplayCommands[i];
+
+            auto threadIt = threadIndexToID.find(command.ThreadID);
+            if (threadIt == threadIndexToID.end()) {
+                threadIt = threadIndexToID.insert({command.ThreadID, threads.size()}).first;
+                threads.push_back(std::make_unique<ReplayThread>());
+            }
+
+            const size_t threadIndex = threadIt->second;
+            ReplayThread* thread = threads[threadIndex].get();
+
+            ThreadCommand threadCommand = {&command, false, {}};
+            if (!command.ID.empty()) {
+                auto& lastCommandToID =
+                    (IsHeapCommand(command)) ? lastHeapCommandToID : lastAllocationCommandToID;
+                auto lastCommandIt = lastCommandToID.find(command.ID);
+                if (lastCommandIt != lastCommandToID.end() &&
+                    lastCommandIt->second.ThreadIndex != threadIndex) {
+                    threadCommand.HasDependency = true;
+                    threadCommand.Dependency = lastCommandIt->second;
+                }
+                lastCommandToID[command.ID] = {threadIndex, thread->Commands.size()};
+            }
+
+            thread->Commands.push_back(threadCommand);
+        }
 
-                        if (allocationToID.find(allocationID) == allocationToID.end()) {
-                            continue;
+        std::atomic<bool> hasFailed{false};
+        std::vector<std::thread> workers;
+        for (std::unique_ptr<ReplayThread>& thread : threads) {
+            workers.emplace_back([&, thread = thread.get()]() {
+                std::unique_ptr<gpgmm::PlatformTime> platformTime(gpgmm::CreatePlatformTime());
+                ReplayThreadState threadState = {};
+                threadState.PlatformTime = platformTime.get();
+
+                for (size_t i = 0; i < thread->Commands.size(); i++) {
+                    const ThreadCommand& threadCommand = thread->Commands[i];
+                    if (threadCommand.HasDependency) {
+                        const ReplayThread* otherThread =
+                            threads[threadCommand.Dependency.ThreadIndex].get();
+                        while (otherThread->ReplayedCommandCount.load(
+                                   std::memory_order_acquire) <=
+                               threadCommand.Dependency.CommandIndex) {
+                            if (hasFailed.load(std::memory_order_relaxed)) {
+                                return;
+                            }
+                            std::this_thread::yield();
                         }
+                    }
 
-                        mReplayedAllocationStats.CurrentUsage -=
-                            allocationToID[allocationID]->GetSize();
+                    ReplayTraceCommand(*threadCommand.Command, traceFile, envParams,
+                                       iterationIndex, state, &threadState);
+                    if (HasFatalFailure()) {
+                        hasFailed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
 
-                        mPlatformTime->StartElapsedTime();
+                    thread->ReplayedCommandCount.store(i + 1, std::memory_order_release);
+                }
 
-                        const bool didDeallocate = allocationToID.erase(allocationID);
+                // Allocations are always assigned an ID by the thread which created it.
+                ASSERT_TRUE(threadState.AllocationWithoutID == nullptr);
+            });
+        }
 
-                        const double elapsedTime = mPlatformTime->EndElapsedTime();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
 
-                        ASSERT_TRUE(didDeallocate || envParams.IsNeverAllocate);
+    // Replays a single command. Shared state is locked, except when calling the allocator so
+    // contention within the allocator is measured.
+    void ReplayTraceCommand(const ReplayCommand& command,
+                            const TraceFile& traceFile,
+                            const TestEnviromentParams& envParams,
+                            uint64_t iterationIndex,
+                            ReplayState* state,
+                            ReplayThreadState* threadState) {
+        WaitForRecordedTime(command, envParams, state);
+
+        switch (command.Type) {
+            case ReplayCommandType::CreateResource: {
+                ALLOCATION_DESC allocationDescriptor = command.AllocationDescriptor;
+
+                ResourceAllocator* resourceAllocator = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
+                    auto it = state->AllocatorToID.find(command.AllocatorID);
+                    ASSERT_TRUE(it != state->AllocatorToID.end());
+                    resourceAllocator = it->second.Get();
+                }
 
-                        mReplayedDeallocateStats.TotalCpuTime += elapsedTime;
-                        mReplayedDeallocateStats.PeakCpuTime =
-                            std::max(elapsedTime, mReplayedDeallocateStats.PeakCpuTime);
-                        mReplayedDeallocateStats.TotalNumOfCalls++;
+                ASSERT_NE(resourceAllocator, nullptr);
 
-                    } break;
+                if (envParams.IsNeverAllocate) {
+                    allocationDescriptor.Flags |= ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+                }
 
-                    default:
-                        break;
+                ComPtr<ResourceAllocation>& allocationWithoutID = threadState->AllocationWithoutID;
+
+                const QUERY_RESOURCE_ALLOCATOR_INFO allocatorInfoBefore =
+                    resourceAllocator->QueryInfo();
+
+                threadState->PlatformTime->StartElapsedTime();
+
+                HRESULT hr = resourceAllocator->CreateResource(
+                    allocationDescriptor, command.ResourceDescriptor, command.InitialResourceState,
+                    (command.HasClearValue) ? &command.ClearValue : nullptr, &allocationWithoutID);
+
+                const double elapsedTime = threadState->PlatformTime->EndElapsedTime();
+
+                if (!envParams.IsNeverAllocate && FAILED(hr)) {
+                    gpgmm::ErrorLog() << "CreateResource failed with :" << command.Args << ".\n";
                 }
-            } else if (event["name"].asString() == "GPUMemoryAllocator") {
-                switch (*event["ph"].asCString()) {
-                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
-                        const std::string& allocatorID = event["id"].asString();
-                        if (allocatorToID.find(allocatorID) != allocatorToID.end()) {
-                            continue;
-                        }
 
-                        const Json::Value& snapshot = event["args"]["snapshot"];
-                        ASSERT_FALSE(snapshot.empty());
+                ASSERT_SUCCEEDED(hr);
 
-                        // Apply profile (if specified).
-                        ALLOCATOR_DESC allocatorDesc =
-                            CreateBasicAllocatorDesc(/*enablePrefetch*/ envParams.PrefetchMemory);
-                        if (envParams.AllocatorProfile ==
-                            AllocatorProfile::ALLOCATOR_PROFILE_CAPTURED) {
-                            allocatorDesc.Flags |=
-                                static_cast<ALLOCATOR_FLAGS>(snapshot["Flags"].asInt());
-                            allocatorDesc.PreferredResourceHeapSize =
-                                snapshot["PreferredResourceHeapSize"].asUInt64();
-                            allocatorDesc.MaxResourceHeapSize =
-                                snapshot["MaxResourceHeapSize"].asUInt64();
-                            allocatorDesc.MaxResourceSizeForPooling =
-                                snapshot["MaxResourceSizeForPooling"].asUInt64();
-                            allocatorDesc.MaxVideoMemoryBudget =
-                                snapshot["MaxVideoMemoryBudget"].asFloat();
-                            allocatorDesc.TotalResourceBudgetLimit =
-                                snapshot["TotalResourceBudgetLimit"].asUInt64();
-                            allocatorDesc.VideoMemoryEvictSize =
-                                snapshot["VideoMemoryEvictSize"].asUInt64();
-                            allocatorDesc.ResourceFragmentationLimit =
-                                snapshot["ResourceFragmentationLimit"].asDouble();
-                        } else if (envParams.AllocatorProfile ==
-                                   AllocatorProfile::ALLOCATOR_PROFILE_MAX_PERFORMANCE) {
-                            // Any amount of (internal) fragmentation is acceptable.
-                            allocatorDesc.ResourceFragmentationLimit = 1.0f;
-                        } else if (envParams.AllocatorProfile ==
-                                   AllocatorProfile::ALLOCATOR_PROFILE_LOW_MEMORY) {
-                            allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_ON_DEMAND;
-                            allocatorDesc.ResourceFragmentationLimit = 0.125;  // 1/8th of 4MB
-                        }
+                // Memory held by the allocator, used or not, can only grow by allocating.
+                const QUERY_RESOURCE_ALLOCATOR_INFO allocatorInfo = resourceAllocator->QueryInfo();
 
-                        if (envParams.IsStandaloneOnly) {
-                            allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_COMMITED;
-                        }
+                std::lock_guard<std::mutex> lock(state->Mutex);
 
-                        if (envParams.IsRegenerate) {
-                            allocatorDesc.RecordOptions.Flags = ALLOCATOR_RECORD_FLAG_CAPTURE;
-                            allocatorDesc.RecordOptions.TraceFile = traceFile.path;
-                            allocatorDesc.RecordOptions.MinMessageLevel =
-                                static_cast<ALLOCATOR_MESSAGE_SEVERITY>(envParams.RecordLevel);
-                        }
+                mReplayedAllocationStats.CurrentUsage += allocationWithoutID->GetSize();
+                mReplayedAllocationStats.PeakUsage = std::max(
+                    mReplayedAllocationStats.CurrentUsage, mReplayedAllocationStats.PeakUsage);
+                mReplayedAllocationStats.TotalCount++;
+                mReplayedAllocationStats.TotalSize += allocationWithoutID->GetSize();
 
-                        allocatorDesc.MinLogLevel =
-                            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(envParams.LogLevel);
-
-                        if (envParams.LogLevel <= gpgmm::LogSeverity::Warning &&
-                            allocatorDesc.IsUMA != snapshot["IsUMA"].asBool() &&
-                            iterationIndex == 0) {
-                            gpgmm::WarningLog()
-                                << "Capture device does not match playback device (IsUMA: " +
-                                       std::to_string(snapshot["IsUMA"].asBool()) + " vs " +
-                                       std::to_string(allocatorDesc.IsUMA) + ").";
-                            GPGMM_SKIP_TEST_IF(envParams.IsCapturedCapsCompat);
-                        }
+                mReplayedAllocateStats.TotalCpuTime += elapsedTime;
+                mReplayedAllocateStats.PeakCpuTime =
+                    std::max(elapsedTime, mReplayedAllocateStats.PeakCpuTime);
+                mReplayedAllocateStats.TotalNumOfCalls++;
+                mReplayedAllocateStats.CpuTimes.push_back(elapsedTime);
 
-                        if (envParams.LogLevel <= gpgmm::LogSeverity::Warning &&
-                            allocatorDesc.ResourceHeapTier !=
-                                snapshot["ResourceHeapTier"].asInt() &&
-                            iterationIndex == 0) {
-                            gpgmm::WarningLog()
-                                << "Capture device does not match playback device "
-                                   "(ResourceHeapTier: " +
-                                       std::to_string(snapshot["ResourceHeapTier"].asInt()) +
-                                       " vs " + std::to_string(allocatorDesc.ResourceHeapTier) +
-                                       ").";
-                            GPGMM_SKIP_TEST_IF(envParams.IsCapturedCapsCompat);
-                        }
+                CountMemorySource(allocatorInfoBefore, allocatorInfo,
+                                  &mReplayedMemorySourceStats);
 
-                        ComPtr<ResourceAllocator> resourceAllocator;
-                        ASSERT_SUCCEEDED(
-                            ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
+                mReplayedMemoryStats.PeakCount =
+                    std::max(mReplayedMemoryStats.PeakCount, allocatorInfo.UsedMemoryCount);
 
-                        ASSERT_TRUE(
-                            allocatorToID.insert({allocatorID, std::move(resourceAllocator)})
-                                .second);
-                    } break;
+                const uint64_t memoryUsage =
+                    allocatorInfo.UsedMemoryUsage + allocatorInfo.FreeMemoryUsage;
+                if (memoryUsage > mReplayedMemoryStats.PeakUsage) {
+                    mReplayedMemoryStats.PeakUsage = memoryUsage;
 
-                    case TRACE_EVENT_PHASE_CREATE_OBJECT: {
-                        // Assume subsequent events are always against this allocator instance.
-                        // This is because call trace events have no ID associated with them.
-                        currentAllocatorID = event["id"].asString();
-                    } break;
+                    // Only measured at a new peak, since it visits every heap.
+                    const MEMORY_ALLOCATOR_FRAGMENTATION_INFO fragmentationInfo =
+                        resourceAllocator->QueryFragmentationInfo();
+                    mReplayedPeakFragmentation =
+                        (fragmentationInfo.InternalFragmentationUsage +
+                         fragmentationInfo.FreeBlockUsage) /
+                        static_cast<double>(memoryUsage);
+                }
+            } break;
 
-                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
-                        const std::string& allocatorID = event["id"].asString();
+            case ReplayCommandType::SnapshotAllocation: {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                if (state->AllocationInfoToID.find(command.ID) != state->AllocationInfoToID.end()) {
+                    return;
+                }
 
-                        auto it = allocatorToID.find(allocatorID);
-                        ASSERT_TRUE(it != allocatorToID.end());
-                        ASSERT_EQ(allocatorToID.erase(allocatorID), 1u);
-                    } break;
+                const RESOURCE_ALLOCATION_INFO& allocationDesc = command.AllocationInfo;
 
-                    default:
-                        break;
+                mCapturedAllocationStats.TotalSize += allocationDesc.SizeInBytes;
+                mCapturedAllocationStats.TotalCount++;
+                mCapturedAllocationStats.CurrentUsage += allocationDesc.SizeInBytes;
+                mCapturedAllocationStats.PeakUsage = std::max(
+                    mCapturedAllocationStats.PeakUsage, mCapturedAllocationStats.CurrentUsage);
+
+                ASSERT_TRUE(state->AllocationInfoToID.insert({command.ID, allocationDesc}).second);
+            } break;
+
+            case ReplayCommandType::CreateAllocation: {
+                ComPtr<ResourceAllocation>& allocationWithoutID = threadState->AllocationWithoutID;
+                if (allocationWithoutID == nullptr) {
+                    return;
                 }
-            } else if (event["name"].asString() == "GPUMemoryBlock") {
-                switch (*event["ph"].asCString()) {
-                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
-                        const std::string& heapID = event["id"].asString();
-                        if (heapInfoToID.find(heapID) != heapInfoToID.end()) {
-                            continue;
-                        }
 
-                        const Json::Value& snapshot = event["args"]["snapshot"];
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
+                    ASSERT_TRUE(
+                        state->AllocationToID.insert({command.ID, allocationWithoutID}).second);
+                }
 
-                        HEAP_INFO heapInfo = {};
-                        heapInfo.IsResident = snapshot["IsResident"].asBool();
-                        heapInfo.MemorySegmentGroup = static_cast<DXGI_MEMORY_SEGMENT_GROUP>(
-                            snapshot["MemorySegmentGroup"].asInt());
-                        heapInfo.SizeInBytes = snapshot["SizeInBytes"].asUInt64();
+                ASSERT_TRUE(allocationWithoutID.Reset() == 1);
+            } break;
 
-                        mCapturedMemoryStats.TotalSize += heapInfo.SizeInBytes;
-                        mCapturedMemoryStats.TotalCount++;
-                        mCapturedMemoryStats.CurrentUsage += heapInfo.SizeInBytes;
-                        mCapturedMemoryStats.PeakUsage = std::max(
-                            mCapturedMemoryStats.PeakUsage, mCapturedMemoryStats.CurrentUsage);
+            case ReplayCommandType::DestroyAllocation: {
+                ComPtr<ResourceAllocation> allocation;
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
 
-                        ASSERT_TRUE(heapInfoToID.insert({heapID, heapInfo}).second);
-                    } break;
+                    auto it = state->AllocationInfoToID.find(command.ID);
+                    if (it == state->AllocationInfoToID.end()) {
+                        return;
+                    }
 
-                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
-                        const std::string& traceEventID = event["id"].asString();
-                        auto it = heapInfoToID.find(traceEventID);
-                        ASSERT_TRUE(it != heapInfoToID.end());
+                    const RESOURCE_ALLOCATION_INFO& allocationDesc = it->second;
+                    mCapturedAllocationStats.CurrentUsage -= allocationDesc.SizeInBytes;
 
-                        HEAP_INFO heapInfo = it->second;
-                        mCapturedMemoryStats.CurrentUsage -= heapInfo.SizeInBytes;
+                    ASSERT_EQ(state->AllocationInfoToID.erase(command.ID), 1u);
 
-                        ASSERT_EQ(heapInfoToID.erase(traceEventID), 1u);
+                    auto allocationIt = state->AllocationToID.find(command.ID);
+                    if (allocationIt == state->AllocationToID.end()) {
+                        return;
+                    }
 
-                    } break;
+                    allocation = std::move(allocationIt->second);
+                    state->AllocationToID.erase(allocationIt);
 
-                    default:
-                        break;
+                    mReplayedAllocationStats.CurrentUsage -= allocation->GetSize();
+                }
+
+                threadState->PlatformTime->StartElapsedTime();
+
+                const bool didDeallocate = (allocation.Reset() == 0);
+
+                const double elapsedTime = threadState->PlatformTime->EndElapsedTime();
+
+                ASSERT_TRUE(didDeallocate || envParams.IsNeverAllocate);
+
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                mReplayedDeallocateStats.TotalCpuTime += elapsedTime;
+                mReplayedDeallocateStats.PeakCpuTime =
+                    std::max(elapsedTime, mReplayedDeallocateStats.PeakCpuTime);
+                mReplayedDeallocateStats.TotalNumOfCalls++;
+                mReplayedDeallocateStats.CpuTimes.push_back(elapsedTime);
+            } break;
+
+            case ReplayCommandType::SnapshotAllocator: {
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
+                    if (state->AllocatorToID.find(command.ID) != state->AllocatorToID.end()) {
+                        return;
+                    }
+                }
+
+                const Json::Value& snapshot = command.Args;
+
+                // Apply profile (if specified).
+                ALLOCATOR_DESC allocatorDesc =
+                    CreateBasicAllocatorDesc(/*enablePrefetch*/ envParams.PrefetchMemory);
+                if (envParams.AllocatorProfile == AllocatorProfile::ALLOCATOR_PROFILE_CAPTURED) {
+                    allocatorDesc.Flags |= static_cast<ALLOCATOR_FLAGS>(snapshot["Flags"].asInt());
+                    allocatorDesc.PreferredResourceHeapSize =
+                        snapshot["PreferredResourceHeapSize"].asUInt64();
+                    allocatorDesc.MaxResourceHeapSize = snapshot["MaxResourceHeapSize"].asUInt64();
+                    allocatorDesc.MaxResourceSizeForPooling =
+                        snapshot["MaxResourceSizeForPooling"].asUInt64();
+                    allocatorDesc.MaxResourceSizeForSubAllocation =
+                        snapshot["MaxResourceSizeForSubAllocation"].asUInt64();
+                    allocatorDesc.MaxVideoMemoryBudget = snapshot["MaxVideoMemoryBudget"].asFloat();
+                    allocatorDesc.TotalResourceBudgetLimit =
+                        snapshot["TotalResourceBudgetLimit"].asUInt64();
+                    allocatorDesc.VideoMemoryEvictSize =
+                        snapshot["VideoMemoryEvictSize"].asUInt64();
+                    allocatorDesc.EvictionPolicy =
+                        static_cast<EVICTION_POLICY>(snapshot["EvictionPolicy"].asInt());
+                    allocatorDesc.ResidencyPredictionSubmissionCount =
+                        snapshot["ResidencyPredictionSubmissionCount"].asUInt();
+                    allocatorDesc.VideoMemoryReservationSubmissionCount =
+                        snapshot["VideoMemoryReservationSubmissionCount"].asUInt();
+                    allocatorDesc.ResourceFragmentationLimit =
+                        snapshot["ResourceFragmentationLimit"].asDouble();
+                    allocatorDesc.ReservedResourceHeapCount =
+                        snapshot["ReservedResourceHeapCount"].asUInt();
+                    allocatorDesc.PooledResourceHeapWasteLimit =
+                        snapshot["PooledResourceHeapWasteLimit"].asDouble();
+                    allocatorDesc.MaxPooledResourceHeapUsage =
+                        snapshot["MaxPooledResourceHeapUsage"].asUInt64();
+                    allocatorDesc.MaxPooledResourceHeapUsagePerSize =
+                        snapshot["MaxPooledResourceHeapUsagePerSize"].asUInt64();
+                    allocatorDesc.PooledResourceHeapPeakWindow =
+                        snapshot["PooledResourceHeapPeakWindow"].asUInt();
+                    allocatorDesc.TransientBufferSize = snapshot["TransientBufferSize"].asUInt64();
+                    allocatorDesc.LargeBufferSize = snapshot["LargeBufferSize"].asUInt64();
+                    allocatorDesc.MaxBufferSlabSize = snapshot["MaxBufferSlabSize"].asUInt64();
+                } else if (envParams.AllocatorProfile ==
+                           AllocatorProfile::ALLOCATOR_PROFILE_MAX_PERFORMANCE) {
+                    // Any amount of (internal) fragmentation is acceptable.
+                    allocatorDesc.ResourceFragmentationLimit = 1.0f;
+                } else if (envParams.AllocatorProfile ==
+                           AllocatorProfile::ALLOCATOR_PROFILE_LOW_MEMORY) {
+                    allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_ON_DEMAND;
+                    allocatorDesc.ResourceFragmentationLimit = 0.125;  // 1/8th of 4MB
+                }
+
+                if (envParams.IsStandaloneOnly) {
+                    allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_COMMITED;
+                }
+
+                if (envParams.IsRegenerate) {
+                    allocatorDesc.RecordOptions.Flags = ALLOCATOR_RECORD_FLAG_CAPTURE;
+                    allocatorDesc.RecordOptions.TraceFile = traceFile.path;
+                    allocatorDesc.RecordOptions.MinMessageLevel =
+                        static_cast<ALLOCATOR_MESSAGE_SEVERITY>(envParams.RecordLevel);
+                }
+
+                allocatorDesc.MinLogLevel =
+                    static_cast<ALLOCATOR_MESSAGE_SEVERITY>(envParams.LogLevel);
+
+                if (envParams.LogLevel <= gpgmm::LogSeverity::Warning &&
+                    allocatorDesc.IsUMA != snapshot["IsUMA"].asBool() && iterationIndex == 0) {
+                    gpgmm::WarningLog()
+                        << "Capture device does not match playback device (IsUMA: " +
+                               std::to_string(snapshot["IsUMA"].asBool()) + " vs " +
+                               std::to_string(allocatorDesc.IsUMA) + ").";
+                    GPGMM_SKIP_TEST_IF(envParams.IsCapturedCapsCompat);
+                }
+
+                if (envParams.LogLevel <= gpgmm::LogSeverity::Warning &&
+                    allocatorDesc.ResourceHeapTier != snapshot["ResourceHeapTier"].asInt() &&
+                    iterationIndex == 0) {
+                    gpgmm::WarningLog()
+                        << "Capture device does not match playback device "
+                           "(ResourceHeapTier: " +
+                               std::to_string(snapshot["ResourceHeapTier"].asInt()) + " vs " +
+                               std::to_string(allocatorDesc.ResourceHeapTier) + ").";
+                    GPGMM_SKIP_TEST_IF(envParams.IsCapturedCapsCompat);
+                }
+
+
+                ComPtr<ResourceAllocator> resourceAllocator;
+                ASSERT_SUCCEEDED(
+                    ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
+
+                std::lock_guard<std::mutex> lock(state->Mutex);
+
+                // Only 1 in CallSampleRate allocations were recorded by a sampled trace, so the
+                // captured allocation stats only describe those.
+                mCapturedAllocationStats.SampleRate =
+                    std::max(snapshot["RecordOptions"]["CallSampleRate"].asUInt(), 1u);
+
+                ASSERT_TRUE(
+                    state->AllocatorToID.insert({command.ID, std::move(resourceAllocator)}).second);
+            } break;
+
+            case ReplayCommandType::SetVideoMemoryBudget: {
+                if (!envParams.IsReplayBudget) {
+                    return;
+                }
+
+                ResourceAllocator* resourceAllocator = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
+                    auto it = state->AllocatorToID.find(command.AllocatorID);
+                    if (it == state->AllocatorToID.end()) {
+                        return;
+                    }
+                    resourceAllocator = it->second.Get();
+                }
+
+                // The recorded budget replaces the budget of the replaying device, which is
+                // then limited the same way, so eviction follows the captured pressure.
+                ResidencyManager* residencyManager = resourceAllocator->GetResidencyManager();
+                if (residencyManager == nullptr) {
+                    return;
+                }
+
+                ASSERT_SUCCEEDED(residencyManager->SetVideoMemoryBudgetOverride(
+                    command.MemorySegmentGroup, command.VideoMemoryBudget));
+            } break;
+
+            case ReplayCommandType::DestroyAllocator: {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                auto it = state->AllocatorToID.find(command.ID);
+                ASSERT_TRUE(it != state->AllocatorToID.end());
+                ASSERT_EQ(state->AllocatorToID.erase(command.ID), 1u);
+            } break;
+
+            case ReplayCommandType::SnapshotHeap: {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                if (state->HeapInfoToID.find(command.ID) != state->HeapInfoToID.end()) {
+                    return;
                 }
+
+                const HEAP_INFO& heapInfo = command.HeapInfo;
+
+                mCapturedMemoryStats.TotalSize += heapInfo.SizeInBytes;
+                mCapturedMemoryStats.TotalCount++;
+                mCapturedMemoryStats.CurrentUsage += heapInfo.SizeInBytes;
+                mCapturedMemoryStats.PeakUsage =
+                    std::max(mCapturedMemoryStats.PeakUsage, mCapturedMemoryStats.CurrentUsage);
+
+                ASSERT_TRUE(state->HeapInfoToID.insert({command.ID, heapInfo}).second);
+            } break;
+
+            case ReplayCommandType::DestroyHeap: {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                auto it = state->HeapInfoToID.find(command.ID);
+                ASSERT_TRUE(it != state->HeapInfoToID.end());
+
+                HEAP_INFO heapInfo = it->second;
+                mCapturedMemoryStats.CurrentUsage -= heapInfo.SizeInBytes;
+
+                ASSERT_EQ(state->HeapInfoToID.erase(command.ID), 1u);
+            } break;
+
+            default:
+                UNREACHABLE();
+                break;
+        }
+    }
+
+    // Waits until the time the command was recorded, relative to the first command, has passed
+    // since the replay started. Replays which fell behind are not waited on.
+    void WaitForRecordedTime(const ReplayCommand& command,
+                             const TestEnviromentParams& envParams,
+                             ReplayState* state) {
+        if (envParams.PacedTimeScale <= 0) {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point replayTime;
+        {
+            std::lock_guard<std::mutex> lock(state->Mutex);
+            if (!state->HasPaceStarted) {
+                state->HasPaceStarted = true;
+                state->FirstTimestamp = command.Timestamp;
+                state->PaceStartTime = std::chrono::steady_clock::now();
             }
+
+            const std::chrono::duration<double> delay(
+                (command.Timestamp - state->FirstTimestamp) * envParams.PacedTimeScale);
+            replayTime = state->PaceStartTime +
+                         std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
         }
 
-        ASSERT_TRUE(allocationInfoToID.empty());
-        ASSERT_TRUE(allocatorToID.empty());
-        ASSERT_TRUE(heapInfoToID.empty());
+        std::this_thread::sleep_until(replayTime);
+    }
+
+    void ResetStats() {
+        mReplayedAllocateStats = {};
+        mReplayedDeallocateStats = {};
+        mReplayedAllocationStats = {};
+        mReplayedMemoryStats = {};
+        mReplayedMemorySourceStats = {};
+        mCapturedAllocationStats = {};
+        mCapturedMemoryStats = {};
+        mReplayCpuTime = 0;
+        mReplayedPeakFragmentation = 0;
+    }
+
+    // Replays the trace using |profile| and returns how it performed.
+    CaptureReplayPerfResult RunPerfTest(AllocatorProfile profile) {
+        ResetStats();
+        RunPerfTestLoop(profile);
+
+        LogCallStats("Allocation(s)", mReplayedAllocateStats);
+        LogCallStats("Deallocation(s)", mReplayedDeallocateStats);
+        LogMemorySourceStats("Allocation(s)", mReplayedMemorySourceStats);
+
+        CaptureReplayPerfResult result = {};
+        result.Profile = profile;
+        result.AllocateStats = mReplayedAllocateStats;
+        result.DeallocateStats = mReplayedDeallocateStats;
+        result.ReplayCpuTime = mReplayCpuTime;
+        result.PeakResidentMemory = mReplayedMemoryStats.PeakUsage;
+        result.PeakHeapCount = mReplayedMemoryStats.PeakCount;
+        result.PeakFragmentation = mReplayedPeakFragmentation;
+        return result;
     }
 
+    std::vector<ReplayCommand> mReplayCommands;
+
     CaptureReplayCallStats mReplayedAllocateStats;
     CaptureReplayCallStats mReplayedDeallocateStats;
     CaptureReplayMemoryStats mReplayedAllocationStats;
+    CaptureReplayMemoryStats mReplayedMemoryStats;
+    CaptureReplayMemorySourceStats mReplayedMemorySourceStats;
+    double mReplayCpuTime = 0;
+    double mReplayedPeakFragmentation = 0;  // Fraction of memory wasted, at peak usage.
 
     CaptureReplayMemoryStats mCapturedAllocationStats;
     CaptureReplayMemoryStats mCapturedMemoryStats;
@@ -451,6 +971,7 @@ TEST_P(D3D12EventTraceReplay, AllocationPerf) {
 
     LogCallStats("Allocation(s)", mReplayedAllocateStats);
     LogCallStats("Deallocation(s)", mReplayedDeallocateStats);
+    LogMemorySourceStats("Allocation(s)", mReplayedMemorySourceStats);
 }
 
 // Verify captured does not regress (ie. consume more memory) upon playback.
@@ -476,11 +997,7 @@ TEST_P(D3D12EventTraceReplay, Regenerate) {
     const CaptureReplayMemoryStats beforeCapturedAllocationStats = mCapturedAllocationStats;
     const CaptureReplayMemoryStats beforeCapturedMemoryStats = mCapturedMemoryStats;
 
-    // Reset stats
-    mReplayedAllocateStats = {};
-    mReplayedDeallocateStats = {};
-    mCapturedAllocationStats = {};
-    mCapturedMemoryStats = {};
+    ResetStats();
 
     RunSingleTest(/*forceRegenerate*/ false, /*forceIsCapturedCapsCompat*/ false,
                   /*forcePrefetchMemory*/ false);
@@ -493,4 +1010,25 @@ TEST_P(D3D12EventTraceReplay, Regenerate) {
     EXPECT_EQ(beforeCapturedMemoryStats.TotalCount, mCapturedMemoryStats.TotalCount);
 }
 
+// Replay the trace using every allocator profile to compare their performance. Results are also
+// written to --perf-results-file, for tracking regressions.
+TEST_P(D3D12EventTraceReplay, ProfilePerf) {
+    for (AllocatorProfile profile : {AllocatorProfile::ALLOCATOR_PROFILE_MAX_PERFORMANCE,
+                                     AllocatorProfile::ALLOCATOR_PROFILE_LOW_MEMORY,
+                                     AllocatorProfile::ALLOCATOR_PROFILE_CAPTURED,
+                                     AllocatorProfile::ALLOCATOR_PROFILE_DEFAULT}) {
+        const CaptureReplayPerfResult result = RunPerfTest(profile);
+        ASSERT_FALSE(HasFatalFailure());
+        ReportPerfResult(result);
+    }
+}
+
+// Replay the trace using --profile and compare it against a baseline, either the trace replayed
+// using --compare-profile or the results of another build given by --baseline-results-file. Fails
+// once peak memory, heap count, fragmentation or allocation latency regressed beyond the
+// regression thresholds.
+TEST_P(D3D12EventTraceReplay, ProfileCompare) {
+    RunPerfCompareTest([this](AllocatorProfile profile) { return RunPerfTest(profile); });
+}
+
 GPGMM_INSTANTIATE_CAPTURE_REPLAY_TEST(D3D12EventTraceReplay);
@@ -0,0 +1,464 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tests/capture_replay_tests/GPGMMCaptureReplayTests.h"
+
+#include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/SlabMemoryAllocator.h"
+#include "gpgmm/StandaloneMemoryAllocator.h"
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Log.h"
+#include "gpgmm/common/Math.h"
+#include "gpgmm/common/PlatformTime.h"
+#include "gpgmm/d3d12/DefaultsD3D12.h"
+#include "tests/DummyMemoryAllocator.h"
+#include "tests/capture_replay_tests/JSONTraceEventReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gpgmm_d3d12.h>
+#include <json/json.h>
+
+using namespace gpgmm;
+using namespace gpgmm::d3d12;
+
+namespace {
+
+    // Largest heap size allowed by the allocator when the captured device is unknown.
+    constexpr static uint64_t kSimulatedMaxResourceHeapSize = 32ll * 1024ll * 1024ll * 1024ll;
+
+    enum class SimulationCommandType { Allocate, Deallocate };
+
+    // Allocation made or released by the captured trace, in the order it happened.
+    struct SimulationCommand {
+        SimulationCommandType Type = SimulationCommandType::Allocate;
+        uint64_t AllocationIndex = 0;
+        uint64_t SizeInBytes = 0;
+        uint64_t Alignment = 0;
+        D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+        bool IsSubAllocatedWithinResource = false;
+    };
+
+    // Allocator settings to simulate. Mirrors the ALLOCATOR_DESC members which change how the
+    // resource heaps are sub-allocated.
+    struct SimulatedAllocatorDesc {
+        uint64_t PreferredResourceHeapSize = 0;
+        double ResourceFragmentationLimit = 0;
+        bool IsAlwaysOnDemand = false;
+    };
+
+    // Result of simulating a trace with one SimulatedAllocatorDesc.
+    struct SimulationResult {
+        uint64_t PeakHeapCount = 0;
+        uint64_t PeakHeapUsage = 0;
+        uint64_t TotalHeapCount = 0;
+
+        // Fraction of heap memory not used by resources, when the most heap memory was used.
+        double PeakFragmentation = 0;
+
+        double AllocationCpuTime = 0;
+        uint64_t AllocationCount = 0;
+    };
+
+    // Counts heaps created and released by the simulated allocators, in place of a device.
+    struct SimulatedDevice {
+        uint64_t HeapCount = 0;
+        uint64_t HeapUsage = 0;
+        uint64_t TotalHeapCount = 0;
+    };
+
+    // Creates heaps which only exist on the SimulatedDevice, so the allocators above it behave
+    // the same as they would over a ResourceHeapAllocator or BufferAllocator.
+    class SimulatedHeapAllocator final : public DummyMemoryAllocator {
+      public:
+        explicit SimulatedHeapAllocator(SimulatedDevice* device) : mDevice(device) {
+        }
+
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override {
+            std::unique_ptr<MemoryAllocation> allocation =
+                DummyMemoryAllocator::TryAllocateMemory(request);
+            if (allocation != nullptr) {
+                mDevice->HeapCount++;
+                mDevice->HeapUsage += allocation->GetSize();
+                mDevice->TotalHeapCount++;
+            }
+            return allocation;
+        }
+
+        void DeallocateMemory(std::unique_ptr<MemoryAllocation> allocation) override {
+            mDevice->HeapCount--;
+            mDevice->HeapUsage -= allocation->GetSize();
+            DummyMemoryAllocator::DeallocateMemory(std::move(allocation));
+        }
+
+      private:
+        SimulatedDevice* const mDevice;
+    };
+
+    // Builds the same allocators, per heap type, as ResourceAllocator does but over the
+    // SimulatedDevice. Resource heap tier 2 is assumed, so buffers and textures share heaps.
+    class SimulatedResourceAllocator {
+      public:
+        SimulatedResourceAllocator(const SimulatedAllocatorDesc& descriptor,
+                                   SimulatedDevice* device)
+            : mDescriptor(descriptor), mDevice(device) {
+        }
+
+        std::unique_ptr<MemoryAllocation> TryAllocate(const SimulationCommand& command) {
+            HeapTypeAllocators& allocators = GetOrCreateAllocators(command.HeapType);
+
+            MEMORY_ALLOCATION_REQUEST request = {};
+            request.Size = command.SizeInBytes;
+            request.Alignment = command.Alignment;
+
+            std::unique_ptr<MemoryAllocation> allocation;
+            if (command.IsSubAllocatedWithinResource) {
+                allocation = allocators.BufferAllocator->TryAllocateMemory(request);
+                if (allocation != nullptr) {
+                    return allocation;
+                }
+            }
+
+            if (command.SizeInBytes <= kSimulatedMaxResourceHeapSize) {
+                MEMORY_ALLOCATION_REQUEST cachedRequest = request;
+                cachedRequest.CacheSize = true;
+                allocation = allocators.ResourceAllocator->TryAllocateMemory(cachedRequest);
+                if (allocation != nullptr) {
+                    return allocation;
+                }
+            }
+
+            // Committed resources are counted as standalone heaps.
+            return allocators.ResourceHeapAllocator->TryAllocateMemory(request);
+        }
+
+      private:
+        struct HeapTypeAllocators {
+            std::unique_ptr<MemoryAllocator> ResourceAllocator;
+            std::unique_ptr<MemoryAllocator> ResourceHeapAllocator;
+            std::unique_ptr<MemoryAllocator> BufferAllocator;
+        };
+
+        std::unique_ptr<MemoryAllocator> CreatePooledOrNonPooledAllocator() {
+            std::unique_ptr<MemoryAllocator> heapAllocator =
+                std::make_unique<SimulatedHeapAllocator>(mDevice);
+            if (mDescriptor.IsAlwaysOnDemand) {
+                return heapAllocator;
+            }
+            return std::make_unique<SegmentedMemoryAllocator>(
+                std::move(heapAllocator), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        }
+
+        HeapTypeAllocators& GetOrCreateAllocators(D3D12_HEAP_TYPE heapType) {
+            auto it = mAllocatorsOfType.find(heapType);
+            if (it != mAllocatorsOfType.end()) {
+                return it->second;
+            }
+
+            HeapTypeAllocators& allocators = mAllocatorsOfType[heapType];
+
+            std::unique_ptr<MemoryAllocator> buddyAllocator =
+                std::make_unique<BuddyMemoryAllocator>(
+                    PrevPowerOfTwo(kSimulatedMaxResourceHeapSize),
+                    mDescriptor.PreferredResourceHeapSize,
+                    D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, CreatePooledOrNonPooledAllocator(),
+                    /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+            allocators.ResourceAllocator = std::make_unique<SlabCacheAllocator>(
+                /*minBlockSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*maxSlabSize*/ PrevPowerOfTwo(kSimulatedMaxResourceHeapSize),
+                /*slabSize*/ mDescriptor.PreferredResourceHeapSize,
+                /*slabAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*slabFragmentationLimit*/ mDescriptor.ResourceFragmentationLimit,
+                /*enablePrefetch*/ false, std::move(buddyAllocator), /*adaptSlabSize*/ true);
+
+            allocators.ResourceHeapAllocator =
+                std::make_unique<StandaloneMemoryAllocator>(CreatePooledOrNonPooledAllocator());
+
+            allocators.BufferAllocator = std::make_unique<SlabCacheAllocator>(
+                /*minBlockSize*/ 1,
+                /*maxSlabSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*slabSize*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*slabAlignment*/ D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                /*slabFragmentationLimit*/ 0,
+                /*enablePrefetch*/ false, CreatePooledOrNonPooledAllocator());
+
+            return allocators;
+        }
+
+        const SimulatedAllocatorDesc mDescriptor;
+        SimulatedDevice* const mDevice;
+
+        std::unordered_map<D3D12_HEAP_TYPE, HeapTypeAllocators> mAllocatorsOfType;
+    };
+
+}  // namespace
+
+// Replays captured allocations through the allocators alone, without a device, to compare how
+// different allocator settings would have fragmented memory. Since a texture's size cannot be
+// known without a device, the captured allocation size is used for it instead.
+class D3D12EventTraceSimulation : public CaptureReplayTestWithParams {
+  protected:
+    // Converts the allocations made by the trace into commands, in the order they were made.
+    void ParseTraceFile(const TraceFile& traceFile) {
+        std::ifstream traceFileStream(traceFile.path, std::ifstream::binary);
+        ASSERT_TRUE(traceFileStream.is_open());
+
+        JSONTraceEventReader reader(traceFileStream);
+
+        // Resources created but whose allocation is not yet known, by thread then by ID.
+        std::unordered_map<uint32_t, SimulationCommand> resourceOfThread;
+        std::unordered_map<std::string, SimulationCommand> resourceOfAllocationID;
+
+        std::unordered_map<std::string, SimulationCommand> allocationOfID;
+
+        uint64_t eventCount = 0;
+
+        Json::Value event;
+        while (reader.ReadNextEvent(&event)) {
+            eventCount++;
+
+            const std::string& name = event["name"].asString();
+            const char phase = event["ph"].asString()[0];
+            const uint32_t threadID = event["tid"].asUInt();
+
+            if (name == "ResourceAllocator.CreateResource") {
+                const Json::Value& args = event["args"];
+                if (phase != TRACE_EVENT_PHASE_INSTANT || args["allocationDescriptor"].empty() ||
+                    args["resourceDescriptor"].empty()) {
+                    continue;
+                }
+
+                const Json::Value& allocationDescriptor = args["allocationDescriptor"];
+                const Json::Value& resourceDescriptor = args["resourceDescriptor"];
+
+                SimulationCommand command = {};
+                command.Type = SimulationCommandType::Allocate;
+                command.HeapType =
+                    static_cast<D3D12_HEAP_TYPE>(allocationDescriptor["HeapType"].asInt());
+
+                // Buffer sizes are known up front. Otherwise, wait for the allocation snapshot.
+                if (resourceDescriptor["Dimension"].asInt() == D3D12_RESOURCE_DIMENSION_BUFFER) {
+                    command.SizeInBytes = resourceDescriptor["Width"].asUInt64();
+                    command.IsSubAllocatedWithinResource =
+                        (allocationDescriptor["Flags"].asInt() &
+                         ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE) &&
+                        command.SizeInBytes < D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+                }
+
+                command.Alignment = (command.IsSubAllocatedWithinResource)
+                                        ? std::max<uint64_t>(
+                                              resourceDescriptor["Alignment"].asUInt64(), 1)
+                                        : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+                resourceOfThread[threadID] = command;
+
+            } else if (name == "GPUMemoryAllocation") {
+                const std::string& allocationID = event["id"].asString();
+                switch (phase) {
+                    case TRACE_EVENT_PHASE_CREATE_OBJECT: {
+                        auto it = resourceOfThread.find(threadID);
+                        if (it == resourceOfThread.end()) {
+                            break;
+                        }
+                        resourceOfAllocationID[allocationID] = it->second;
+                        resourceOfThread.erase(it);
+                    } break;
+
+                    case TRACE_EVENT_PHASE_SNAPSHOT_OBJECT: {
+                        auto it = resourceOfAllocationID.find(allocationID);
+                        if (it == resourceOfAllocationID.end()) {
+                            break;
+                        }
+
+                        SimulationCommand& command = it->second;
+                        if (command.SizeInBytes == 0) {
+                            command.SizeInBytes =
+                                event["args"]["snapshot"]["SizeInBytes"].asUInt64();
+                        }
+
+                        command.AllocationIndex = mAllocationCount++;
+                        allocationOfID[allocationID] = command;
+                        mCommands.push_back(command);
+                        resourceOfAllocationID.erase(it);
+                    } break;
+
+                    case TRACE_EVENT_PHASE_DELETE_OBJECT: {
+                        resourceOfAllocationID.erase(allocationID);
+
+                        auto it = allocationOfID.find(allocationID);
+                        if (it == allocationOfID.end()) {
+                            break;
+                        }
+
+                        SimulationCommand command = it->second;
+                        command.Type = SimulationCommandType::Deallocate;
+                        mCommands.push_back(command);
+                        allocationOfID.erase(it);
+                    } break;
+
+                    default:
+                        break;
+                }
+            }
+        }
+
+        ASSERT_FALSE(reader.HasError()) << "Failed to parse trace: " << traceFile.path;
+        ASSERT_GT(eventCount, 0u) << "Trace has no events: " << traceFile.path;
+    }
+
+    SimulationResult Simulate(const SimulatedAllocatorDesc& descriptor) const {
+        SimulatedDevice device = {};
+        SimulationResult result = {};
+
+        // Allocators must outlive the allocations made by them.
+        SimulatedResourceAllocator allocator(descriptor, &device);
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations(mAllocationCount);
+
+        uint64_t resourceUsage = 0;
+        std::chrono::steady_clock::duration cpuTime = {};
+        for (const SimulationCommand& command : mCommands) {
+            std::unique_ptr<MemoryAllocation>& allocation = allocations[command.AllocationIndex];
+            switch (command.Type) {
+                case SimulationCommandType::Allocate: {
+                    const auto start = std::chrono::steady_clock::now();
+                    allocation = allocator.TryAllocate(command);
+                    cpuTime += std::chrono::steady_clock::now() - start;
+
+                    if (allocation == nullptr) {
+                        break;
+                    }
+
+                    resourceUsage += command.SizeInBytes;
+                    result.AllocationCount++;
+
+                    result.PeakHeapCount = std::max(result.PeakHeapCount, device.HeapCount);
+                    if (device.HeapUsage > result.PeakHeapUsage) {
+                        result.PeakHeapUsage = device.HeapUsage;
+                        result.PeakFragmentation =
+                            1.0 - static_cast<double>(resourceUsage) / device.HeapUsage;
+                    }
+                } break;
+
+                case SimulationCommandType::Deallocate: {
+                    if (allocation == nullptr) {
+                        break;
+                    }
+
+                    resourceUsage -= command.SizeInBytes;
+
+                    const auto start = std::chrono::steady_clock::now();
+                    allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+                    cpuTime += std::chrono::steady_clock::now() - start;
+                } break;
+            }
+        }
+
+        // Release what the trace did not, before the allocators are destroyed.
+        for (std::unique_ptr<MemoryAllocation>& allocation : allocations) {
+            if (allocation != nullptr) {
+                allocation->GetAllocator()->DeallocateMemory(std::move(allocation));
+            }
+        }
+
+        result.TotalHeapCount = device.TotalHeapCount;
+        result.AllocationCpuTime = std::chrono::duration<double>(cpuTime).count();
+        return result;
+    }
+
+    void LogSimulationResult(const SimulatedAllocatorDesc& descriptor,
+                             const SimulationResult& result) const {
+        gpgmm::InfoLog() << "Preferred resource heap size (bytes): "
+                         << descriptor.PreferredResourceHeapSize
+                         << ", fragmentation limit: " << descriptor.ResourceFragmentationLimit
+                         << ", always on-demand: " << descriptor.IsAlwaysOnDemand;
+        gpgmm::InfoLog() << "Heaps peak " << result.PeakHeapCount << " (total created: "
+                         << result.TotalHeapCount << "), peak usage (bytes) "
+                         << result.PeakHeapUsage << ", fragmentation at peak "
+                         << result.PeakFragmentation * 100 << "%";
+        gpgmm::InfoLog() << "Allocation CPU time (ms): " << result.AllocationCpuTime * 1e3
+                         << " for " << result.AllocationCount << " allocation(s)";
+    }
+
+    // Simulates the trace with every setting of the grid. CPU time is accumulated over each
+    // iteration but the trace is only parsed once.
+    void RunTest(const TraceFile& traceFile,
+                 const TestEnviromentParams& envParams,
+                 uint64_t iterationIndex) override {
+        if (iterationIndex == 0) {
+            ASSERT_NO_FATAL_FAILURE(ParseTraceFile(traceFile));
+            mResults.clear();
+        }
+
+        if (mAllocationCount == 0) {
+            GTEST_SKIP() << "Trace has no allocations to simulate.";
+        }
+
+        constexpr static uint64_t kPreferredResourceHeapSizes[] = {
+            1ll * 1024ll * 1024ll, kDefaultPreferredResourceHeapSize, 16ll * 1024ll * 1024ll};
+        constexpr static double kResourceFragmentationLimits[] = {
+            0.0625, kDefaultFragmentationLimit, 0.25, 1.0};
+
+        uint64_t resultIndex = 0;
+        for (bool isAlwaysOnDemand : {false, true}) {
+            for (uint64_t preferredResourceHeapSize : kPreferredResourceHeapSizes) {
+                for (double resourceFragmentationLimit : kResourceFragmentationLimits) {
+                    SimulatedAllocatorDesc descriptor = {};
+                    descriptor.PreferredResourceHeapSize = preferredResourceHeapSize;
+                    descriptor.ResourceFragmentationLimit = resourceFragmentationLimit;
+                    descriptor.IsAlwaysOnDemand = isAlwaysOnDemand;
+
+                    const SimulationResult result = Simulate(descriptor);
+                    if (iterationIndex == 0) {
+                        mResults.push_back({descriptor, result});
+                    } else {
+                        mResults[resultIndex].second.AllocationCpuTime += result.AllocationCpuTime;
+                    }
+                    resultIndex++;
+                }
+            }
+        }
+    }
+
+    std::vector<SimulationCommand> mCommands;
+    uint64_t mAllocationCount = 0;
+
+    std::vector<std::pair<SimulatedAllocatorDesc, SimulationResult>> mResults;
+};
+
+// Simulate the trace over a grid of allocator settings to find which of them fragments the least
+// without creating too many heaps.
+TEST_P(D3D12EventTraceSimulation, AllocatorSettings) {
+    RunTestLoop(/*forceRegenerate*/ false, /*forceIsCapturedCapsCompat*/ false,
+                /*forceSingleIteration*/ false, /*forcePrefetchMemory*/ false);
+
+    for (const auto& descriptorAndResult : mResults) {
+        LogSimulationResult(descriptorAndResult.first, descriptorAndResult.second);
+
+        // Every allocation of the trace must still succeed.
+        EXPECT_EQ(descriptorAndResult.second.AllocationCount, mAllocationCount);
+    }
+}
+
+GPGMM_INSTANTIATE_CAPTURE_REPLAY_TEST(D3D12EventTraceSimulation);
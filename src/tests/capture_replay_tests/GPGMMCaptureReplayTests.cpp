@@ -17,14 +17,18 @@
 #include "gpgmm/common/Assert.h"
 #include "gpgmm/common/PlatformTime.h"
 #include "gpgmm/common/PlatformUtils.h"
+#include "tests/capture_replay_tests/SyntheticTraceGenerator.h"
 
 #include <json/json.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <vector>
 
 static const std::string kTraceIndex = GPGMM_CAPTURE_REPLAY_TESTS_TRACE_INDEX;
 
 static std::string gSingleTraceFilePath = "";  // Always empty unless set by command-line option.
+static std::string gSyntheticWorkloadFilePath = "";  // Same as above.
 
 namespace {
 
@@ -74,8 +78,96 @@ namespace {
         }
     }
 
+    // Call times are written in milliseconds, so they read the same as the logged stats.
+    Json::Value CallStatsToJson(const CaptureReplayCallStats& stats) {
+        Json::Value callStats;
+        callStats["TotalNumOfCalls"] = Json::UInt64(stats.TotalNumOfCalls);
+        callStats["TotalCpuTimeInMs"] = stats.TotalCpuTime * 1e3;
+        callStats["PeakCpuTimeInMs"] = stats.PeakCpuTime * 1e3;
+        callStats["P50CpuTimeInMs"] = GetCallStatsPercentile(stats, 0.5) * 1e3;
+        callStats["P99CpuTimeInMs"] = GetCallStatsPercentile(stats, 0.99) * 1e3;
+        callStats["P999CpuTimeInMs"] = GetCallStatsPercentile(stats, 0.999) * 1e3;
+        return callStats;
+    }
+
+    // Key of a result in the baseline results file.
+    std::string GetBaselinePerfResultKey(const std::string& traceName, AllocatorProfile profile) {
+        return traceName + "/" + AllocatorProfileToString(profile);
+    }
+
+    // Logs the change of a metric and fails if it increased over |baseline| by more than
+    // |threshold|, a fraction of |baseline|.
+    void CompareMetric(const std::string& name, double baseline, double metric, double threshold) {
+        const double delta = (baseline > 0) ? (metric - baseline) / baseline : 0;
+        gpgmm::InfoLog() << name << ": " << baseline << " -> " << metric << " ("
+                         << (delta >= 0 ? "+" : "") << (delta * 1e2) << "%)";
+        EXPECT_LE(metric, baseline * (1 + threshold))
+            << name << " regressed by more than " << (threshold * 1e2) << "%.";
+    }
+
+    // Generates a trace for each workload described by the file, either a single workload or a
+    // "workloads" array of them, next to the file. See SyntheticWorkloadDesc for the members.
+    std::vector<TraceFile> GenerateSyntheticTraceFiles(const std::string& workloadFilePath) {
+        Json::Value root;
+        Json::Reader reader;
+        std::ifstream workloadFile(workloadFilePath, std::ifstream::binary);
+        if (!reader.parse(workloadFile, root, false)) {
+            gpgmm::ErrorLog() << "Unable to parse: " << workloadFilePath << ".\n";
+            return {};
+        }
+
+        Json::Value workloadsJson = root["workloads"];
+        if (workloadsJson.isNull()) {
+            workloadsJson.append(root);
+        }
+
+        std::vector<TraceFile> traceFiles;
+        for (const Json::Value& workloadJson : workloadsJson) {
+            SyntheticWorkloadDesc workload = {};
+            if (!ParseSyntheticWorkloadDesc(workloadJson, &workload)) {
+                gpgmm::ErrorLog() << "Invalid synthetic workload in: " << workloadFilePath
+                                  << ".\n";
+                continue;
+            }
+
+            const std::string traceFilePath =
+                workloadFilePath + "." + workload.Name + ".trace.json";
+            std::ofstream traceFile(traceFilePath, std::ofstream::binary);
+            if (!GenerateSyntheticTrace(workload, traceFile)) {
+                gpgmm::ErrorLog() << "Unable to write: " << traceFilePath << ".\n";
+                continue;
+            }
+
+            traceFiles.push_back({workload.Name, traceFilePath});
+        }
+
+        return traceFiles;
+    }
+
 }  // namespace
 
+double GetCallStatsPercentile(const CaptureReplayCallStats& stats, double percentile) {
+    if (stats.CpuTimes.empty()) {
+        return 0;
+    }
+
+    std::vector<double> cpuTimes = stats.CpuTimes;
+    const size_t rank = std::max<size_t>(
+        1, static_cast<size_t>(std::ceil(cpuTimes.size() * percentile)));
+    std::nth_element(cpuTimes.begin(), cpuTimes.begin() + (rank - 1), cpuTimes.end());
+    return cpuTimes[rank - 1];
+}
+
+CaptureReplayPerfMetrics GetPerfMetrics(const CaptureReplayPerfResult& result) {
+    CaptureReplayPerfMetrics metrics = {};
+    metrics.PeakResidentMemory = result.PeakResidentMemory;
+    metrics.PeakHeapCount = result.PeakHeapCount;
+    metrics.PeakFragmentation = result.PeakFragmentation;
+    metrics.AllocateP50CpuTime = GetCallStatsPercentile(result.AllocateStats, 0.5);
+    metrics.AllocateP99CpuTime = GetCallStatsPercentile(result.AllocateStats, 0.99);
+    return metrics;
+}
+
 void InitGPGMMCaptureReplayTestEnvironment(int argc, char** argv) {
     gTestEnv = new GPGMMCaptureReplayTestEnvironment(argc, argv);
     GPGMMTestEnvironment::SetEnvironment(gTestEnv);
@@ -102,6 +194,38 @@ GPGMMCaptureReplayTestEnvironment::GPGMMCaptureReplayTestEnvironment(int argc, c
             continue;
         }
 
+        if (strcmp("--threaded", argv[i]) == 0) {
+            mParams.IsMultiThreaded = true;
+            continue;
+        }
+
+        if (strcmp("--stream", argv[i]) == 0) {
+            mParams.IsStreaming = true;
+            continue;
+        }
+
+        if (strcmp("--ignore-budget", argv[i]) == 0) {
+            mParams.IsReplayBudget = false;
+            continue;
+        }
+
+        if (strcmp("--paced", argv[i]) == 0) {
+            mParams.PacedTimeScale = 1;
+            continue;
+        }
+
+        constexpr const char kPaced[] = "--paced=";
+        arglen = sizeof(kPaced) - 1;
+        if (strncmp(argv[i], kPaced, arglen) == 0) {
+            const char* timeScale = argv[i] + arglen;
+            mParams.PacedTimeScale = strtod(timeScale, nullptr);
+            if (mParams.PacedTimeScale <= 0) {
+                gpgmm::ErrorLog() << "Invalid paced time scale " << timeScale << ".\n";
+                UNREACHABLE();
+            }
+            continue;
+        }
+
         if (strcmp("--regenerate", argv[i]) == 0) {
             mParams.IsRegenerate = true;
             continue;
@@ -171,6 +295,19 @@ GPGMMCaptureReplayTestEnvironment::GPGMMCaptureReplayTestEnvironment(int argc, c
             continue;
         }
 
+        constexpr const char kSyntheticWorkload[] = "--synthetic-workload=";
+        arglen = sizeof(kSyntheticWorkload) - 1;
+        if (strncmp(argv[i], kSyntheticWorkload, arglen) == 0) {
+            const char* path = argv[i] + arglen;
+            if (path[0] != '\0') {
+                gSyntheticWorkloadFilePath = std::string(path);
+            } else {
+                gpgmm::ErrorLog() << "Invalid synthetic workload file " << path << ".\n";
+                UNREACHABLE();
+            }
+            continue;
+        }
+
         constexpr const char kProfile[] = "--profile=";
         arglen = sizeof(kProfile) - 1;
         if (strncmp(argv[i], kProfile, arglen) == 0) {
@@ -184,6 +321,62 @@ GPGMMCaptureReplayTestEnvironment::GPGMMCaptureReplayTestEnvironment(int argc, c
             continue;
         }
 
+        constexpr const char kPerfResultsFile[] = "--perf-results-file=";
+        arglen = sizeof(kPerfResultsFile) - 1;
+        if (strncmp(argv[i], kPerfResultsFile, arglen) == 0) {
+            const char* path = argv[i] + arglen;
+            if (path[0] != '\0') {
+                mParams.PerfResultsFile = std::string(path);
+            } else {
+                gpgmm::ErrorLog() << "Invalid perf results file " << path << ".\n";
+                UNREACHABLE();
+            }
+            continue;
+        }
+
+        constexpr const char kCompareProfile[] = "--compare-profile=";
+        arglen = sizeof(kCompareProfile) - 1;
+        if (strncmp(argv[i], kCompareProfile, arglen) == 0) {
+            const char* profile = argv[i] + arglen;
+            if (profile[0] != '\0') {
+                mParams.BaselineProfile = StringToAllocatorProfile(std::string(profile));
+                mParams.IsComparingProfiles = true;
+            } else {
+                gpgmm::ErrorLog() << "Invalid compare profile " << profile << ".\n";
+                UNREACHABLE();
+            }
+            continue;
+        }
+
+        constexpr const char kBaselineResultsFile[] = "--baseline-results-file=";
+        arglen = sizeof(kBaselineResultsFile) - 1;
+        if (strncmp(argv[i], kBaselineResultsFile, arglen) == 0) {
+            const char* path = argv[i] + arglen;
+            if (path[0] != '\0') {
+                mParams.BaselineResultsFile = std::string(path);
+            } else {
+                gpgmm::ErrorLog() << "Invalid baseline results file " << path << ".\n";
+                UNREACHABLE();
+            }
+            continue;
+        }
+
+        constexpr const char kMemoryRegressionThreshold[] = "--memory-regression-threshold=";
+        arglen = sizeof(kMemoryRegressionThreshold) - 1;
+        if (strncmp(argv[i], kMemoryRegressionThreshold, arglen) == 0) {
+            const char* percent = argv[i] + arglen;
+            mParams.MemoryRegressionThreshold = strtod(percent, nullptr) / 1e2;
+            continue;
+        }
+
+        constexpr const char kLatencyRegressionThreshold[] = "--latency-regression-threshold=";
+        arglen = sizeof(kLatencyRegressionThreshold) - 1;
+        if (strncmp(argv[i], kLatencyRegressionThreshold, arglen) == 0) {
+            const char* percent = argv[i] + arglen;
+            mParams.LatencyRegressionThreshold = strtod(percent, nullptr) / 1e2;
+            continue;
+        }
+
         if (strcmp("-h", argv[i]) == 0 || strcmp("--help", argv[i]) == 0) {
             gpgmm::InfoLog()
                 << "Playback options:"
@@ -195,13 +388,32 @@ GPGMMCaptureReplayTestEnvironment::GPGMMCaptureReplayTestEnvironment(int argc, c
                    "level for log messages.\n"
                 << " --regenerate: Capture again upon playback.\n"
                 << " --playback-file: Path to captured file to playback.\n"
-                << " --caps-compatible: Captured caps must be compatible with playback device.\n";
+                << " --synthetic-workload: Path to a JSON file describing workloads to "
+                   "generate traces from, instead of playing back captured files.\n"
+                << " --caps-compatible: Captured caps must be compatible with playback device.\n"
+                << " --perf-results-file: Path to write results of the ProfilePerf test as "
+                   "JSON.\n"
+                << " --baseline-results-file: Path to perf results, such as written by another "
+                   "build, which the ProfileCompare test compares --profile against.\n"
+                << " --memory-regression-threshold=X: Percent peak memory, heap count or "
+                   "fragmentation may regress before ProfileCompare fails (default: 0).\n"
+                << " --latency-regression-threshold=X: Percent allocation latency may regress "
+                   "before ProfileCompare fails (default: 10).\n";
 
             gpgmm::InfoLog()
                 << "Experiment options:"
                 << " --force-standalone: Disable memory reuse by sub-allocation.\n"
                 << " --never-allocate: Disable creating backend memory.\n"
-                << " --profile=[MAXPERF|LOWMEM|CAPTURED|DEFAULT]: Allocator profile.\n";
+                << " --threaded: Replay events of each recorded thread concurrently.\n"
+                << " --stream: Replay events as the trace is read, for traces too large to "
+                   "fit in memory.\n"
+                << " --ignore-budget: Use the budget of the playback device instead of the "
+                   "recorded budget.\n"
+                << " --paced[=X]: Replay events at their recorded times, with the time between "
+                   "them scaled by X (default: 1), instead of back-to-back.\n"
+                << " --profile=[MAXPERF|LOWMEM|CAPTURED|DEFAULT]: Allocator profile.\n"
+                << " --compare-profile=[MAXPERF|LOWMEM|CAPTURED|DEFAULT]: Allocator profile "
+                   "the ProfileCompare test compares --profile against.\n";
             continue;
         }
     }
@@ -211,6 +423,18 @@ GPGMMCaptureReplayTestEnvironment::GPGMMCaptureReplayTestEnvironment(int argc, c
         mParams.Iterations = 1;
     }
 
+    if (mParams.IsStreaming && mParams.IsMultiThreaded) {
+        gpgmm::WarningLog() << "--stream ignored when using --threaded.\n";
+        mParams.IsStreaming = false;
+    }
+
+    if (mParams.IsComparingProfiles && !mParams.BaselineResultsFile.empty()) {
+        gpgmm::WarningLog() << "--compare-profile ignored when using --baseline-results-file.\n";
+        mParams.IsComparingProfiles = false;
+    }
+
+    LoadBaselinePerfResults();
+
     PrintCaptureReplaySettings();
 }
 
@@ -222,10 +446,87 @@ void GPGMMCaptureReplayTestEnvironment::SetUp() {
 }
 
 void GPGMMCaptureReplayTestEnvironment::TearDown() {
-    // TODO
+    WritePerfResults();
     GPGMMTestEnvironment::TearDown();
 }
 
+void GPGMMCaptureReplayTestEnvironment::AddPerfResult(const CaptureReplayPerfResult& result) {
+    mPerfResults.push_back(result);
+}
+
+void GPGMMCaptureReplayTestEnvironment::WritePerfResults() const {
+    if (mParams.PerfResultsFile.empty()) {
+        return;
+    }
+
+    Json::Value perfResultsJson(Json::arrayValue);
+    for (const CaptureReplayPerfResult& result : mPerfResults) {
+        Json::Value resultJson;
+        resultJson["TraceName"] = result.TraceName;
+        resultJson["Profile"] = AllocatorProfileToString(result.Profile);
+        resultJson["Iterations"] = Json::UInt64(result.Iterations);
+        resultJson["Allocate"] = CallStatsToJson(result.AllocateStats);
+        resultJson["Deallocate"] = CallStatsToJson(result.DeallocateStats);
+        resultJson["ReplayCpuTimeInMs"] = result.ReplayCpuTime * 1e3;
+        resultJson["PeakResidentMemoryInBytes"] = Json::UInt64(result.PeakResidentMemory);
+        resultJson["PeakHeapCount"] = Json::UInt64(result.PeakHeapCount);
+        resultJson["PeakFragmentation"] = result.PeakFragmentation;
+        perfResultsJson.append(resultJson);
+    }
+
+    Json::Value root;
+    root["perfResults"] = perfResultsJson;
+
+    std::ofstream perfResultsFile(mParams.PerfResultsFile);
+    if (!perfResultsFile.is_open()) {
+        gpgmm::ErrorLog() << "Unable to write: " << mParams.PerfResultsFile << ".\n";
+        return;
+    }
+
+    perfResultsFile << Json::writeString(Json::StreamWriterBuilder(), root);
+}
+
+void GPGMMCaptureReplayTestEnvironment::LoadBaselinePerfResults() {
+    if (mParams.BaselineResultsFile.empty()) {
+        return;
+    }
+
+    Json::Value root;
+    Json::Reader reader;
+    std::ifstream baselineResultsFile(mParams.BaselineResultsFile, std::ifstream::binary);
+    if (!reader.parse(baselineResultsFile, root, false)) {
+        gpgmm::ErrorLog() << "Unable to parse: " << mParams.BaselineResultsFile << ".\n";
+        return;
+    }
+
+    // Read back what WritePerfResults wrote, where call times are in milliseconds.
+    for (const Json::Value& resultJson : root["perfResults"]) {
+        CaptureReplayPerfMetrics metrics = {};
+        metrics.PeakResidentMemory = resultJson["PeakResidentMemoryInBytes"].asUInt64();
+        metrics.PeakHeapCount = resultJson["PeakHeapCount"].asUInt64();
+        metrics.PeakFragmentation = resultJson["PeakFragmentation"].asDouble();
+        metrics.AllocateP50CpuTime = resultJson["Allocate"]["P50CpuTimeInMs"].asDouble() / 1e3;
+        metrics.AllocateP99CpuTime = resultJson["Allocate"]["P99CpuTimeInMs"].asDouble() / 1e3;
+
+        const std::string key =
+            resultJson["TraceName"].asString() + "/" + resultJson["Profile"].asString();
+        mBaselinePerfMetrics[key] = metrics;
+    }
+}
+
+bool GPGMMCaptureReplayTestEnvironment::GetBaselinePerfMetrics(
+    const std::string& traceName,
+    AllocatorProfile profile,
+    CaptureReplayPerfMetrics* metricsOut) const {
+    auto it = mBaselinePerfMetrics.find(GetBaselinePerfResultKey(traceName, profile));
+    if (it == mBaselinePerfMetrics.end()) {
+        return false;
+    }
+
+    *metricsOut = it->second;
+    return true;
+}
+
 void GPGMMCaptureReplayTestEnvironment::PrintCaptureReplaySettings() const {
     gpgmm::InfoLog() << "Playback settings\n"
                         "-----------------\n"
@@ -234,14 +535,37 @@ void GPGMMCaptureReplayTestEnvironment::PrintCaptureReplaySettings() const {
                      << "\n"
                      << "Record level: " << LogSeverityToString(mParams.RecordLevel) << "\n"
                      << "Log level: " << LogSeverityToString(mParams.LogLevel) << "\n"
-                     << "Check caps: " << (mParams.IsCapturedCapsCompat ? "true" : "false") << "\n";
+                     << "Check caps: " << (mParams.IsCapturedCapsCompat ? "true" : "false") << "\n"
+                     << "Perf results file: "
+                     << (mParams.PerfResultsFile.empty() ? "none" : mParams.PerfResultsFile)
+                     << "\n"
+                     << "Baseline results file: "
+                     << (mParams.BaselineResultsFile.empty() ? "none"
+                                                             : mParams.BaselineResultsFile)
+                     << "\n";
 
     gpgmm::InfoLog() << "Experiment settings\n"
                         "-------------------\n"
                      << "Force standalone: " << (mParams.IsStandaloneOnly ? "true" : "false")
                      << "\n"
                      << "Never allocate: " << (mParams.IsNeverAllocate ? "true" : "false") << "\n"
-                     << "Profile: " << AllocatorProfileToString(mParams.AllocatorProfile) << "\n";
+                     << "Threaded: " << (mParams.IsMultiThreaded ? "true" : "false") << "\n"
+                     << "Streaming: " << (mParams.IsStreaming ? "true" : "false") << "\n"
+                     << "Replay budget: " << (mParams.IsReplayBudget ? "true" : "false") << "\n"
+                     << "Paced time scale: "
+                     << ((mParams.PacedTimeScale > 0) ? std::to_string(mParams.PacedTimeScale)
+                                                      : "none")
+                     << "\n"
+                     << "Profile: " << AllocatorProfileToString(mParams.AllocatorProfile) << "\n"
+                     << "Compare profile: "
+                     << (mParams.IsComparingProfiles
+                             ? AllocatorProfileToString(mParams.BaselineProfile)
+                             : "none")
+                     << "\n"
+                     << "Memory regression threshold: "
+                     << (mParams.MemoryRegressionThreshold * 1e2) << "%\n"
+                     << "Latency regression threshold: "
+                     << (mParams.LatencyRegressionThreshold * 1e2) << "%\n";
 }
 
 // static
@@ -251,6 +575,11 @@ std::vector<TraceFile> GPGMMCaptureReplayTestEnvironment::GenerateTraceFileParam
         return {TraceFile{"SingleTrace", gSingleTraceFilePath}};
     }
 
+    // Playback only the traces generated from the synthetic workloads.
+    if (!gSyntheticWorkloadFilePath.empty()) {
+        return GenerateSyntheticTraceFiles(gSyntheticWorkloadFilePath);
+    }
+
     // Playback all files contained in traces folder.
     Json::Value root;
     Json::Reader reader;
@@ -315,23 +644,125 @@ void CaptureReplayTestWithParams::RunTestLoop(bool forceRegenerate,
     }
 }
 
+void CaptureReplayTestWithParams::RunPerfTestLoop(AllocatorProfile profile) {
+    TestEnviromentParams envParams = gTestEnv->GetParams();
+    envParams.IsRegenerate = false;
+    envParams.PrefetchMemory = true;
+    envParams.AllocatorProfile = profile;
+
+    for (uint32_t i = 0; i < envParams.Iterations; i++) {
+        RunTest(GetParam(), envParams, i);
+    }
+}
+
+void CaptureReplayTestWithParams::ReportPerfResult(CaptureReplayPerfResult result) const {
+    result.TraceName = GetParam().name;
+    result.Iterations = gTestEnv->GetParams().Iterations;
+    gTestEnv->AddPerfResult(result);
+}
+
+void CaptureReplayTestWithParams::RunPerfCompareTest(
+    const std::function<CaptureReplayPerfResult(AllocatorProfile)>& runPerfTest) {
+    const TestEnviromentParams& envParams = gTestEnv->GetParams();
+
+    CaptureReplayPerfMetrics baseline = {};
+    std::string baselineName;
+    if (!envParams.BaselineResultsFile.empty()) {
+        if (!gTestEnv->GetBaselinePerfMetrics(GetParam().name, envParams.AllocatorProfile,
+                                              &baseline)) {
+            GTEST_SKIP() << "No baseline result of " << GetParam().name << " using "
+                         << AllocatorProfileToString(envParams.AllocatorProfile) << ".";
+        }
+        baselineName = envParams.BaselineResultsFile;
+    } else if (envParams.IsComparingProfiles) {
+        baseline = GetPerfMetrics(runPerfTest(envParams.BaselineProfile));
+        if (HasFatalFailure()) {
+            return;
+        }
+        baselineName = AllocatorProfileToString(envParams.BaselineProfile);
+    } else {
+        GTEST_SKIP() << "Nothing to compare, see --compare-profile or --baseline-results-file.";
+    }
+
+    const CaptureReplayPerfMetrics metrics =
+        GetPerfMetrics(runPerfTest(envParams.AllocatorProfile));
+    if (HasFatalFailure()) {
+        return;
+    }
+
+    gpgmm::InfoLog() << AllocatorProfileToString(envParams.AllocatorProfile) << " compared to "
+                     << baselineName << ":";
+    ComparePerfMetrics(baselineName, baseline, metrics);
+}
+
+void CaptureReplayTestWithParams::ComparePerfMetrics(
+    const std::string& baselineName,
+    const CaptureReplayPerfMetrics& baseline,
+    const CaptureReplayPerfMetrics& metrics) const {
+    const TestEnviromentParams& envParams = gTestEnv->GetParams();
+    SCOPED_TRACE("Baseline: " + baselineName);
+
+    CompareMetric("Peak resident memory (bytes)", static_cast<double>(baseline.PeakResidentMemory),
+                  static_cast<double>(metrics.PeakResidentMemory),
+                  envParams.MemoryRegressionThreshold);
+    CompareMetric("Peak heap count", static_cast<double>(baseline.PeakHeapCount),
+                  static_cast<double>(metrics.PeakHeapCount), envParams.MemoryRegressionThreshold);
+    CompareMetric("Peak fragmentation", baseline.PeakFragmentation, metrics.PeakFragmentation,
+                  envParams.MemoryRegressionThreshold);
+    CompareMetric("Allocate p50 latency (ms)", baseline.AllocateP50CpuTime * 1e3,
+                  metrics.AllocateP50CpuTime * 1e3, envParams.LatencyRegressionThreshold);
+    CompareMetric("Allocate p99 latency (ms)", baseline.AllocateP99CpuTime * 1e3,
+                  metrics.AllocateP99CpuTime * 1e3, envParams.LatencyRegressionThreshold);
+}
+
 void CaptureReplayTestWithParams::LogCallStats(const std::string& name,
                                                const CaptureReplayCallStats& stats) const {
     const double avgCpuTimePerCallInMs =
         (stats.TotalCpuTime * 1e3) / ((stats.TotalNumOfCalls == 0) ? 1 : stats.TotalNumOfCalls);
     gpgmm::InfoLog() << name << " per second: " << (1e3 / avgCpuTimePerCallInMs)
                      << " (peak: " << (stats.PeakCpuTime * 1e3) << " ms)";
+    gpgmm::InfoLog() << name << " latency (ms): p50 " << (GetCallStatsPercentile(stats, 0.5) * 1e3)
+                     << ", p99 " << (GetCallStatsPercentile(stats, 0.99) * 1e3) << ", p99.9 "
+                     << (GetCallStatsPercentile(stats, 0.999) * 1e3);
 }
 
 void CaptureReplayTestWithParams::LogMemoryStats(const std::string& name,
                                                  const CaptureReplayMemoryStats& stats) const {
+    // Totals of a sampled trace are estimated from the calls which were recorded.
+    const uint64_t iterations = gTestEnv->GetParams().Iterations;
+    const std::string estimated =
+        (stats.SampleRate > 1) ? " (estimated, 1 in " + std::to_string(stats.SampleRate) +
+                                     " sampled)"
+                               : "";
+
     gpgmm::InfoLog() << name << " total "
-                     << "size (bytes): " << stats.TotalSize / gTestEnv->GetParams().Iterations;
+                     << "size (bytes): " << stats.TotalSize * stats.SampleRate / iterations
+                     << estimated;
 
     if (stats.PeakUsage > 0) {
         gpgmm::InfoLog() << name << " peak usage (bytes): " << stats.PeakUsage;
     }
 
     gpgmm::InfoLog() << name << " total "
-                     << "count: " << stats.TotalCount / gTestEnv->GetParams().Iterations;
+                     << "count: " << stats.TotalCount * stats.SampleRate / iterations << estimated;
+}
+
+void CaptureReplayTestWithParams::LogMemorySourceStats(
+    const std::string& name,
+    const CaptureReplayMemorySourceStats& stats) const {
+    const uint64_t totalCount = stats.CreatedCount + stats.PrefetchWaitCount +
+                                stats.PrefetchedCount + stats.PooledCount + stats.ExistingCount;
+    if (totalCount == 0) {
+        return;
+    }
+
+    const auto toPercent = [totalCount](uint64_t count) {
+        return count * 1e2 / totalCount;
+    };
+
+    gpgmm::InfoLog() << name << " memory source (%): created " << toPercent(stats.CreatedCount)
+                     << ", prefetch wait " << toPercent(stats.PrefetchWaitCount)
+                     << ", prefetched " << toPercent(stats.PrefetchedCount) << ", pooled "
+                     << toPercent(stats.PooledCount) << ", existing "
+                     << toPercent(stats.ExistingCount);
 }
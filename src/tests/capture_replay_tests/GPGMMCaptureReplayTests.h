@@ -19,8 +19,11 @@
 
 #include "gpgmm/common/Log.h"
 
+#include <functional>
 #include <regex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace gpgmm {
     class PlatformTime;
@@ -35,13 +38,28 @@ struct CaptureReplayCallStats {
     double TotalCpuTime = 0;
     double PeakCpuTime = 0;
     uint64_t TotalNumOfCalls = 0;
+    std::vector<double> CpuTimes;  // Elapsed time of every call, in seconds.
 };
 
+// Returns the elapsed time of the |percentile| (between 0 and 1) slowest call, in seconds.
+double GetCallStatsPercentile(const CaptureReplayCallStats& stats, double percentile);
+
 struct CaptureReplayMemoryStats {
     uint64_t TotalSize = 0;
     uint64_t TotalCount = 0;
     uint64_t PeakUsage = 0;
+    uint64_t PeakCount = 0;  // Most allocations which existed at once.
     uint64_t CurrentUsage = 0;
+    uint32_t SampleRate = 1;  // Recorded 1 in this many allocations, see CallSampleRate.
+};
+
+// Where replayed allocations got their memory from, counted per allocation.
+struct CaptureReplayMemorySourceStats {
+    uint64_t CreatedCount = 0;       // Waited on memory (ie. a heap) to be created.
+    uint64_t PrefetchWaitCount = 0;  // Waited on prefetched memory which was not yet created.
+    uint64_t PrefetchedCount = 0;    // Used prefetched memory, without waiting.
+    uint64_t PooledCount = 0;        // Re-used memory kept by a pool or an empty slab.
+    uint64_t ExistingCount = 0;      // Sub-allocated from memory already in use.
 };
 
 enum class AllocatorProfile {
@@ -61,11 +79,57 @@ struct TestEnviromentParams {
     bool IsStandaloneOnly = false;
     bool IsNeverAllocate = false;
     bool PrefetchMemory = false;
+    bool IsMultiThreaded = false;  // Replay events of each recorded thread concurrently.
+    bool IsStreaming = false;      // Replay events as the trace is read.
+    bool IsReplayBudget = true;    // Replay the recorded video memory budget.
+
+    // Replay events at their recorded times, with the time between them scaled by this, instead
+    // of back-to-back when zero.
+    double PacedTimeScale = 0;
 
     AllocatorProfile AllocatorProfile =
         AllocatorProfile::ALLOCATOR_PROFILE_CAPTURED;  // Playback uses captured settings.
+
+    std::string PerfResultsFile;  // Path to write perf results as JSON, if any.
+
+    // Baseline the ProfileCompare test compares the replay against: either the trace replayed
+    // using another profile, or the results of another build written to a perf results file.
+    bool IsComparingProfiles = false;
+    AllocatorProfile BaselineProfile = AllocatorProfile::ALLOCATOR_PROFILE_DEFAULT;
+    std::string BaselineResultsFile;
+
+    // Largest increase of a metric over the baseline before failing, as a fraction.
+    double MemoryRegressionThreshold = 0;
+    double LatencyRegressionThreshold = 0.1;
+};
+
+// Replay performance of a trace using a single allocator profile.
+struct CaptureReplayPerfResult {
+    std::string TraceName;
+    AllocatorProfile Profile = AllocatorProfile::ALLOCATOR_PROFILE_CAPTURED;
+    uint64_t Iterations = 0;
+
+    CaptureReplayCallStats AllocateStats;
+    CaptureReplayCallStats DeallocateStats;
+
+    double ReplayCpuTime = 0;         // Process CPU time spent replaying, in seconds.
+    uint64_t PeakResidentMemory = 0;  // Most memory held by the allocator, in bytes.
+    uint64_t PeakHeapCount = 0;       // Most memory allocations made by the allocator at once.
+    double PeakFragmentation = 0;     // Fraction of memory wasted, at peak resident memory.
 };
 
+// Metrics compared between two replays of the same trace, such as using two allocator profiles
+// or two builds of the library. Larger is worse for all of them.
+struct CaptureReplayPerfMetrics {
+    uint64_t PeakResidentMemory = 0;
+    uint64_t PeakHeapCount = 0;
+    double PeakFragmentation = 0;
+    double AllocateP50CpuTime = 0;  // In seconds.
+    double AllocateP99CpuTime = 0;  // In seconds.
+};
+
+CaptureReplayPerfMetrics GetPerfMetrics(const CaptureReplayPerfResult& result);
+
 void InitGPGMMCaptureReplayTestEnvironment(int argc, char** argv);
 
 class GPGMMCaptureReplayTestEnvironment : public GPGMMTestEnvironment {
@@ -80,10 +144,25 @@ class GPGMMCaptureReplayTestEnvironment : public GPGMMTestEnvironment {
 
     const TestEnviromentParams& GetParams() const;
 
+    // Results are written to the perf results file once every test ran.
+    void AddPerfResult(const CaptureReplayPerfResult& result);
+
+    // Returns false unless the baseline results file has a result of |traceName| replayed
+    // using |profile|.
+    bool GetBaselinePerfMetrics(const std::string& traceName,
+                                AllocatorProfile profile,
+                                CaptureReplayPerfMetrics* metricsOut) const;
+
   private:
     void PrintCaptureReplaySettings() const;
+    void WritePerfResults() const;
+    void LoadBaselinePerfResults();
 
     TestEnviromentParams mParams = {};
+    std::vector<CaptureReplayPerfResult> mPerfResults;
+
+    // Metrics of the baseline results file, by trace name then profile.
+    std::unordered_map<std::string, CaptureReplayPerfMetrics> mBaselinePerfMetrics;
 };
 
 class CaptureReplayTestWithParams : public testing::TestWithParam<TraceFile> {
@@ -92,6 +171,8 @@ class CaptureReplayTestWithParams : public testing::TestWithParam<TraceFile> {
 
     void LogCallStats(const std::string& name, const CaptureReplayCallStats& stats) const;
     void LogMemoryStats(const std::string& name, const CaptureReplayMemoryStats& stats) const;
+    void LogMemorySourceStats(const std::string& name,
+                              const CaptureReplayMemorySourceStats& stats) const;
 
     template <class ParamType>
     static std::string CustomPrintToStringParamName(
@@ -110,6 +191,22 @@ class CaptureReplayTestWithParams : public testing::TestWithParam<TraceFile> {
                        bool forceIsCapturedCapsCompat,
                        bool forcePrefetchMemory);
 
+    // Replays the trace for every iteration using |profile|, like the AllocationPerf test.
+    void RunPerfTestLoop(AllocatorProfile profile);
+
+    void ReportPerfResult(CaptureReplayPerfResult result) const;
+
+    // Replays the trace using --profile, by calling |runPerfTest|, then compares it against the
+    // baseline given by --compare-profile or --baseline-results-file. Skipped if neither.
+    void RunPerfCompareTest(
+        const std::function<CaptureReplayPerfResult(AllocatorProfile)>& runPerfTest);
+
+    // Logs the change of every metric from |baseline|, then fails the test if any increased by
+    // more than the regression threshold of the metric.
+    void ComparePerfMetrics(const std::string& baselineName,
+                            const CaptureReplayPerfMetrics& baseline,
+                            const CaptureReplayPerfMetrics& metrics) const;
+
   protected:
     virtual void RunTest(const TraceFile& traceFile,
                          const TestEnviromentParams& envParams,
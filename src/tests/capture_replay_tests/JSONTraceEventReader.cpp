@@ -0,0 +1,180 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/capture_replay_tests/JSONTraceEventReader.h"
+
+#include <cctype>
+
+JSONTraceEventReader::JSONTraceEventReader(std::istream& stream)
+    : mStream(stream), mReader(Json::CharReaderBuilder().newCharReader()) {
+}
+
+bool JSONTraceEventReader::ReadNextEvent(Json::Value* event) {
+    if (mHasError) {
+        return false;
+    }
+
+    if (!mIsInTraceEvents) {
+        if (!FindTraceEvents()) {
+            mHasError = true;
+            return false;
+        }
+        mIsInTraceEvents = true;
+    }
+
+    // Traces which stopped being written before the end are still read up to the last event.
+    if (!SkipWhitespace()) {
+        return false;
+    }
+
+    char c = static_cast<char>(mStream.peek());
+    if (c == ']') {
+        mStream.get();
+        return false;
+    }
+
+    if (!mIsFirstEvent) {
+        if (c != ',') {
+            mHasError = true;
+            return false;
+        }
+        mStream.get();
+        if (!SkipWhitespace()) {
+            return false;
+        }
+    }
+
+    mIsFirstEvent = false;
+
+    if (!ReadValue(&mEventText)) {
+        mHasError = true;
+        return false;
+    }
+
+    std::string errors;
+    if (!mReader->parse(mEventText.data(), mEventText.data() + mEventText.size(), event,
+                        &errors)) {
+        mHasError = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool JSONTraceEventReader::HasError() const {
+    return mHasError;
+}
+
+// Scans the top-level object for the "traceEvents" key and moves past the opening bracket of its
+// array. Values of other keys are skipped without being parsed.
+bool JSONTraceEventReader::FindTraceEvents() {
+    if (!SkipWhitespace() || mStream.get() != '{') {
+        return false;
+    }
+
+    std::string key;
+    std::string value;
+    while (SkipWhitespace()) {
+        if (mStream.peek() == ',') {
+            mStream.get();
+            continue;
+        }
+
+        if (mStream.get() != '"' || !ReadString(&key)) {
+            return false;
+        }
+
+        if (!SkipWhitespace() || mStream.get() != ':' || !SkipWhitespace()) {
+            return false;
+        }
+
+        if (key == "traceEvents") {
+            return mStream.get() == '[';
+        }
+
+        if (!ReadValue(&value)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+// Reads a string whose opening quote was already read, without decoding escapes.
+bool JSONTraceEventReader::ReadString(std::string* str) {
+    str->clear();
+    char c;
+    while (mStream.get(c)) {
+        if (c == '"') {
+            return true;
+        }
+        str->push_back(c);
+        if (c == '\\') {
+            if (!mStream.get(c)) {
+                return false;
+            }
+            str->push_back(c);
+        }
+    }
+    return false;
+}
+
+// Reads the text of the value at the current position. Objects and arrays are read up to their
+// matching closing bracket, other values up to the next delimiter.
+bool JSONTraceEventReader::ReadValue(std::string* value) {
+    value->clear();
+
+    std::string str;
+    uint64_t depth = 0;
+    char c;
+    while (mStream.get(c)) {
+        if (c == '"') {
+            if (!ReadString(&str)) {
+                return false;
+            }
+            value->push_back('"');
+            value->append(str);
+            value->push_back('"');
+        } else if (c == '{' || c == '[') {
+            depth++;
+            value->push_back(c);
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                mStream.unget();
+                return !value->empty();
+            }
+            depth--;
+            value->push_back(c);
+        } else if (c == ',' && depth == 0) {
+            mStream.unget();
+            return !value->empty();
+        } else {
+            value->push_back(c);
+        }
+
+        if (depth == 0 && (c == '}' || c == ']' || c == '"')) {
+            return true;
+        }
+    }
+
+    return depth == 0 && !value->empty();
+}
+
+// Returns false once the end of the stream was reached.
+bool JSONTraceEventReader::SkipWhitespace() {
+    while (std::isspace(mStream.peek())) {
+        mStream.get();
+    }
+    return mStream.peek() != std::char_traits<char>::eof();
+}
@@ -0,0 +1,53 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_CAPTUREREPLAYTESTS_JSONTRACEEVENTREADER_H_
+#define TESTS_CAPTUREREPLAYTESTS_JSONTRACEEVENTREADER_H_
+
+#include <json/json.h>
+
+#include <istream>
+#include <memory>
+#include <string>
+
+// Reads the events of a JSON trace one at a time, instead of parsing the whole trace at once, so
+// the memory used does not grow with the size of the trace. Only the "traceEvents" array is read.
+class JSONTraceEventReader {
+  public:
+    explicit JSONTraceEventReader(std::istream& stream);
+
+    // Parses the next event into |event|. Returns false once every event was read or the trace
+    // could not be read, which HasError tells apart.
+    bool ReadNextEvent(Json::Value* event);
+
+    bool HasError() const;
+
+  private:
+    bool FindTraceEvents();
+    bool ReadString(std::string* str);
+    bool ReadValue(std::string* value);
+    bool SkipWhitespace();
+
+    std::istream& mStream;
+    std::unique_ptr<Json::CharReader> mReader;
+
+    // Text of the event being parsed. Kept to re-use its memory between events.
+    std::string mEventText;
+
+    bool mIsInTraceEvents = false;
+    bool mIsFirstEvent = true;
+    bool mHasError = false;
+};
+
+#endif  // TESTS_CAPTUREREPLAYTESTS_JSONTRACEEVENTREADER_H_
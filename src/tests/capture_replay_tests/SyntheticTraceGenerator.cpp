@@ -0,0 +1,415 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/capture_replay_tests/SyntheticTraceGenerator.h"
+
+#include "gpgmm/MemoryAllocation.h"
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/Math.h"
+
+#include <gpgmm_d3d12.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <tuple>
+
+namespace {
+
+    // Largest width and height of a generated texture.
+    constexpr uint64_t kMaxTextureDimension = 16384;
+
+    // Every event is written by the same (fake) process.
+    constexpr uint32_t kProcessID = 0;
+
+    // ID of the only allocator. Allocation IDs follow it.
+    constexpr uint64_t kAllocatorID = 1;
+
+    // Release time of persistent allocations, which are released after every other.
+    constexpr uint64_t kPersistentReleaseTimestamp = UINT64_MAX;
+
+    bool ReadDouble(const Json::Value& json, const char* name, double* valueOut) {
+        if (!json.isMember(name)) {
+            return true;
+        }
+        if (!json[name].isNumeric()) {
+            return false;
+        }
+        *valueOut = json[name].asDouble();
+        return true;
+    }
+
+    bool ReadUInt64(const Json::Value& json, const char* name, uint64_t* valueOut) {
+        if (!json.isMember(name)) {
+            return true;
+        }
+        if (!json[name].isUInt64()) {
+            return false;
+        }
+        *valueOut = json[name].asUInt64();
+        return true;
+    }
+
+    bool ReadUInt(const Json::Value& json, const char* name, uint32_t* valueOut) {
+        if (!json.isMember(name)) {
+            return true;
+        }
+        if (!json[name].isUInt()) {
+            return false;
+        }
+        *valueOut = json[name].asUInt();
+        return true;
+    }
+
+    bool IsFraction(double value) {
+        return value >= 0 && value <= 1;
+    }
+
+    bool IsValidWorkload(const SyntheticWorkloadDesc& workload) {
+        if (workload.ThreadCount == 0 || workload.ArrivalRatePerSecond <= 0 ||
+            workload.MedianSizeInBytes <= 0 || workload.SizeSigma < 0 ||
+            workload.MinSizeInBytes == 0 || workload.MinSizeInBytes > workload.MaxSizeInBytes ||
+            !IsFraction(workload.TextureFraction) || !IsFraction(workload.UploadBufferFraction)) {
+            return false;
+        }
+
+        double totalWeight = 0;
+        for (const SyntheticLifetimeClass& lifetimeClass : workload.LifetimeClasses) {
+            if (lifetimeClass.Weight < 0 || lifetimeClass.MeanLifetimeInSeconds < 0) {
+                return false;
+            }
+            totalWeight += lifetimeClass.Weight;
+        }
+        return totalWeight > 0;
+    }
+
+    std::string ToTraceEventID(uint64_t id) {
+        char traceEventID[24];
+        std::snprintf(traceEventID, sizeof(traceEventID), "0x%llx",
+                      static_cast<unsigned long long>(id));
+        return traceEventID;
+    }
+
+    // Writes events into the "traceEvents" array, one at a time, so the trace is never held in
+    // memory at once.
+    class TraceEventWriter {
+      public:
+        explicit TraceEventWriter(std::ostream& stream) : mStream(stream) {
+            Json::StreamWriterBuilder builder;
+            builder["indentation"] = "";
+            mWriter.reset(builder.newStreamWriter());
+            mStream << "{\"traceEvents\":[";
+        }
+
+        void WriteEvent(const char* name,
+                        char phase,
+                        uint64_t id,
+                        uint32_t tid,
+                        uint64_t timestampInMicroseconds,
+                        const Json::Value& args = Json::Value()) {
+            Json::Value event;
+            event["name"] = name;
+            event["cat"] = "default";
+            event["ph"] = std::string(1, phase);
+            if (id != 0) {
+                event["id"] = ToTraceEventID(id);
+            }
+            event["tid"] = tid;
+            event["ts"] = Json::UInt64(timestampInMicroseconds);
+            event["pid"] = kProcessID;
+            if (!args.isNull()) {
+                event["args"] = args;
+            }
+
+            if (!mIsFirstEvent) {
+                mStream << ",\n";
+            }
+            mIsFirstEvent = false;
+            mWriter->write(event, &mStream);
+        }
+
+        bool End() {
+            mStream << "]}\n";
+            return mStream.good();
+        }
+
+      private:
+        std::ostream& mStream;
+        std::unique_ptr<Json::StreamWriter> mWriter;
+        bool mIsFirstEvent = true;
+    };
+
+    // Default settings of the allocator, like a snapshot of ALLOCATOR_DESC created without any.
+    Json::Value CreateAllocatorSnapshot(const SyntheticWorkloadDesc& workload) {
+        Json::Value snapshot;
+        snapshot["Flags"] = 0;
+        snapshot["IsUMA"] = workload.IsUMA;
+        snapshot["ResourceHeapTier"] = workload.ResourceHeapTier;
+        for (const char* name :
+             {"PreferredResourceHeapSize", "MaxResourceHeapSize", "MaxResourceSizeForPooling",
+              "MaxResourceSizeForSubAllocation", "MaxVideoMemoryBudget",
+              "TotalResourceBudgetLimit", "VideoMemoryEvictSize", "EvictionPolicy",
+              "ResidencyPredictionSubmissionCount", "VideoMemoryReservationSubmissionCount",
+              "ResourceFragmentationLimit", "ReservedResourceHeapCount",
+              "PooledResourceHeapWasteLimit", "MaxPooledResourceHeapUsage",
+              "MaxPooledResourceHeapUsagePerSize", "PooledResourceHeapPeakWindow",
+              "TransientBufferSize", "LargeBufferSize", "MaxBufferSlabSize"}) {
+            snapshot[name] = 0;
+        }
+
+        Json::Value args;
+        args["snapshot"] = snapshot;
+        return args;
+    }
+
+    // Resource created by the workload, in the form of the args of CreateResource.
+    struct SyntheticResource {
+        Json::Value CreateResourceArgs;
+        uint64_t SizeInBytes = 0;  // Size of the resource allocation.
+    };
+
+    SyntheticResource CreateSyntheticResource(uint64_t sizeInBytes,
+                                              bool isTexture,
+                                              bool isUploadBuffer) {
+        Json::Value allocationDescriptor;
+        allocationDescriptor["Flags"] = 0;
+        allocationDescriptor["HeapType"] =
+            (isUploadBuffer) ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+        allocationDescriptor["FenceValue"] = 0;
+        allocationDescriptor["ResidencyPriority"] = 0;
+        allocationDescriptor["Lifetime"] = 0;
+        allocationDescriptor["Tag"] = 0;
+
+        Json::Value resourceDescriptor;
+        resourceDescriptor["Alignment"] = 0;
+        resourceDescriptor["DepthOrArraySize"] = 1;
+        resourceDescriptor["MipLevels"] = 1;
+        resourceDescriptor["SampleDesc"]["Count"] = 1;
+        resourceDescriptor["SampleDesc"]["Quality"] = 0;
+        resourceDescriptor["Flags"] = D3D12_RESOURCE_FLAG_NONE;
+
+        uint64_t resourceSize = sizeInBytes;
+        if (isTexture) {
+            // Square RGBA8 textures of a power-of-two size, closest to the size drawn.
+            const uint64_t dimension = std::min(
+                kMaxTextureDimension,
+                gpgmm::NextPowerOfTwo(static_cast<uint64_t>(
+                    std::ceil(std::sqrt(std::max<uint64_t>(sizeInBytes / 4, 1))))));
+            resourceDescriptor["Dimension"] = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+            resourceDescriptor["Width"] = Json::UInt64(dimension);
+            resourceDescriptor["Height"] = Json::UInt(dimension);
+            resourceDescriptor["Format"] = DXGI_FORMAT_R8G8B8A8_UNORM;
+            resourceDescriptor["Layout"] = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+            resourceSize = dimension * dimension * 4;
+        } else {
+            resourceDescriptor["Dimension"] = D3D12_RESOURCE_DIMENSION_BUFFER;
+            resourceDescriptor["Width"] = Json::UInt64(sizeInBytes);
+            resourceDescriptor["Height"] = 1;
+            resourceDescriptor["Format"] = DXGI_FORMAT_UNKNOWN;
+            resourceDescriptor["Layout"] = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        }
+
+        SyntheticResource resource;
+        resource.CreateResourceArgs["allocationDescriptor"] = allocationDescriptor;
+        resource.CreateResourceArgs["resourceDescriptor"] = resourceDescriptor;
+        resource.CreateResourceArgs["initialResourceState"] =
+            (isUploadBuffer) ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON;
+
+        // Placed resources are at least aligned to the default placement alignment, so the
+        // allocation is never reported smaller than the allocator would make it.
+        resource.SizeInBytes =
+            gpgmm::AlignTo(resourceSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        return resource;
+    }
+
+    Json::Value CreateAllocationSnapshot(uint64_t sizeInBytes) {
+        Json::Value snapshot;
+        snapshot["SizeInBytes"] = Json::UInt64(sizeInBytes);
+        snapshot["HeapOffset"] = 0;
+        snapshot["OffsetFromResource"] = 0;
+        snapshot["Method"] = static_cast<int>(gpgmm::AllocationMethod::kSubAllocated);
+
+        Json::Value args;
+        args["snapshot"] = snapshot;
+        return args;
+    }
+
+}  // namespace
+
+bool ParseSyntheticWorkloadDesc(const Json::Value& workloadJson,
+                                SyntheticWorkloadDesc* workloadOut) {
+    if (!workloadJson.isObject()) {
+        return false;
+    }
+
+    SyntheticWorkloadDesc workload = *workloadOut;
+    if (workloadJson.isMember("Name")) {
+        if (!workloadJson["Name"].isString()) {
+            return false;
+        }
+        workload.Name = workloadJson["Name"].asString();
+    }
+
+    if (workloadJson.isMember("IsUMA")) {
+        if (!workloadJson["IsUMA"].isBool()) {
+            return false;
+        }
+        workload.IsUMA = workloadJson["IsUMA"].asBool();
+    }
+
+    uint32_t resourceHeapTier = workload.ResourceHeapTier;
+    if (!ReadUInt64(workloadJson, "AllocationCount", &workload.AllocationCount) ||
+        !ReadUInt(workloadJson, "Seed", &workload.Seed) ||
+        !ReadUInt(workloadJson, "ThreadCount", &workload.ThreadCount) ||
+        !ReadDouble(workloadJson, "ArrivalRatePerSecond", &workload.ArrivalRatePerSecond) ||
+        !ReadDouble(workloadJson, "MedianSizeInBytes", &workload.MedianSizeInBytes) ||
+        !ReadDouble(workloadJson, "SizeSigma", &workload.SizeSigma) ||
+        !ReadUInt64(workloadJson, "MinSizeInBytes", &workload.MinSizeInBytes) ||
+        !ReadUInt64(workloadJson, "MaxSizeInBytes", &workload.MaxSizeInBytes) ||
+        !ReadDouble(workloadJson, "TextureFraction", &workload.TextureFraction) ||
+        !ReadDouble(workloadJson, "UploadBufferFraction", &workload.UploadBufferFraction) ||
+        !ReadUInt(workloadJson, "ResourceHeapTier", &resourceHeapTier)) {
+        return false;
+    }
+    workload.ResourceHeapTier = static_cast<int>(resourceHeapTier);
+
+    if (workloadJson.isMember("LifetimeClasses")) {
+        const Json::Value& lifetimeClassesJson = workloadJson["LifetimeClasses"];
+        if (!lifetimeClassesJson.isArray()) {
+            return false;
+        }
+
+        workload.LifetimeClasses.clear();
+        for (const Json::Value& lifetimeClassJson : lifetimeClassesJson) {
+            SyntheticLifetimeClass lifetimeClass = {};
+            if (!lifetimeClassJson.isObject() ||
+                !ReadDouble(lifetimeClassJson, "Weight", &lifetimeClass.Weight) ||
+                !ReadDouble(lifetimeClassJson, "MeanLifetimeInSeconds",
+                            &lifetimeClass.MeanLifetimeInSeconds)) {
+                return false;
+            }
+            workload.LifetimeClasses.push_back(lifetimeClass);
+        }
+    }
+
+    if (!IsValidWorkload(workload)) {
+        return false;
+    }
+
+    *workloadOut = workload;
+    return true;
+}
+
+bool GenerateSyntheticTrace(const SyntheticWorkloadDesc& workload, std::ostream& stream) {
+    if (!IsValidWorkload(workload)) {
+        return false;
+    }
+
+    std::mt19937_64 generator(workload.Seed);
+    std::exponential_distribution<double> interArrivalTime(workload.ArrivalRatePerSecond);
+    std::lognormal_distribution<double> size(std::log(workload.MedianSizeInBytes),
+                                             workload.SizeSigma);
+    std::uniform_int_distribution<uint32_t> thread(0, workload.ThreadCount - 1);
+    std::uniform_real_distribution<double> fraction(0.0, 1.0);
+
+    std::vector<double> lifetimeClassWeights;
+    for (const SyntheticLifetimeClass& lifetimeClass : workload.LifetimeClasses) {
+        lifetimeClassWeights.push_back(lifetimeClass.Weight);
+    }
+    std::discrete_distribution<size_t> lifetimeClassIndex(lifetimeClassWeights.begin(),
+                                                          lifetimeClassWeights.end());
+
+    TraceEventWriter writer(stream);
+    writer.WriteEvent("GPUMemoryAllocator", TRACE_EVENT_PHASE_CREATE_OBJECT, kAllocatorID,
+                      /*tid*/ 0, /*timestampInMicroseconds*/ 0);
+    writer.WriteEvent("GPUMemoryAllocator", TRACE_EVENT_PHASE_SNAPSHOT_OBJECT, kAllocatorID,
+                      /*tid*/ 0, /*timestampInMicroseconds*/ 0, CreateAllocatorSnapshot(workload));
+
+    // Allocations to release, by the time (in microseconds) they are released, then by ID.
+    using Release = std::tuple<uint64_t, uint64_t, uint32_t>;
+    std::priority_queue<Release, std::vector<Release>, std::greater<Release>> releases;
+
+    auto writeReleasesUntil = [&](uint64_t timestampInMicroseconds) {
+        while (!releases.empty() && std::get<0>(releases.top()) <= timestampInMicroseconds) {
+            const Release& release = releases.top();
+            writer.WriteEvent("GPUMemoryAllocation", TRACE_EVENT_PHASE_DELETE_OBJECT,
+                              std::get<1>(release), std::get<2>(release), std::get<0>(release));
+            releases.pop();
+        }
+    };
+
+    double timeInSeconds = 0;
+    uint64_t lastTimestampInMicroseconds = 0;
+    for (uint64_t i = 0; i < workload.AllocationCount; i++) {
+        timeInSeconds += interArrivalTime(generator);
+        const uint64_t timestampInMicroseconds = static_cast<uint64_t>(timeInSeconds * 1e6);
+        writeReleasesUntil(timestampInMicroseconds);
+
+        const uint64_t sizeInBytes = static_cast<uint64_t>(
+            std::min<double>(workload.MaxSizeInBytes,
+                             std::max<double>(workload.MinSizeInBytes, size(generator))));
+        const bool isTexture = fraction(generator) < workload.TextureFraction;
+        const bool isUploadBuffer =
+            !isTexture && fraction(generator) < workload.UploadBufferFraction;
+        const SyntheticResource resource =
+            CreateSyntheticResource(sizeInBytes, isTexture, isUploadBuffer);
+
+        const uint64_t allocationID = kAllocatorID + 1 + i;
+        const uint32_t tid = thread(generator);
+
+        writer.WriteEvent("ResourceAllocator.CreateResource", TRACE_EVENT_PHASE_INSTANT,
+                          /*id*/ 0, tid, timestampInMicroseconds, resource.CreateResourceArgs);
+        writer.WriteEvent("GPUMemoryAllocation", TRACE_EVENT_PHASE_CREATE_OBJECT, allocationID,
+                          tid, timestampInMicroseconds);
+        writer.WriteEvent("GPUMemoryAllocation", TRACE_EVENT_PHASE_SNAPSHOT_OBJECT,
+                          allocationID, tid, timestampInMicroseconds,
+                          CreateAllocationSnapshot(resource.SizeInBytes));
+
+        // Persistent resources are released once every resource was created.
+        const SyntheticLifetimeClass& lifetimeClass =
+            workload.LifetimeClasses[lifetimeClassIndex(generator)];
+        uint64_t releaseTimestampInMicroseconds = kPersistentReleaseTimestamp;
+        if (lifetimeClass.MeanLifetimeInSeconds > 0) {
+            std::exponential_distribution<double> lifetime(1.0 /
+                                                           lifetimeClass.MeanLifetimeInSeconds);
+            releaseTimestampInMicroseconds =
+                timestampInMicroseconds + static_cast<uint64_t>(lifetime(generator) * 1e6);
+        }
+        releases.emplace(releaseTimestampInMicroseconds, allocationID, tid);
+
+        lastTimestampInMicroseconds = timestampInMicroseconds;
+    }
+
+    // Release what remains, in order, then the allocator, which must outlive its allocations.
+    while (!releases.empty()) {
+        const Release& release = releases.top();
+        if (std::get<0>(release) != kPersistentReleaseTimestamp) {
+            lastTimestampInMicroseconds = std::get<0>(release);
+        }
+        writer.WriteEvent("GPUMemoryAllocation", TRACE_EVENT_PHASE_DELETE_OBJECT,
+                          std::get<1>(release), std::get<2>(release),
+                          lastTimestampInMicroseconds);
+        releases.pop();
+    }
+
+    writer.WriteEvent("GPUMemoryAllocator", TRACE_EVENT_PHASE_DELETE_OBJECT, kAllocatorID,
+                      /*tid*/ 0, lastTimestampInMicroseconds);
+
+    return writer.End();
+}
@@ -0,0 +1,85 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_CAPTUREREPLAYTESTS_SYNTHETICTRACEGENERATOR_H_
+#define TESTS_CAPTUREREPLAYTESTS_SYNTHETICTRACEGENERATOR_H_
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// How long resources of a class live, ex. per-frame constants versus level geometry.
+struct SyntheticLifetimeClass {
+    // Probability of a resource being of this class, relative to the other classes.
+    double Weight = 1.0;
+
+    // Lifetimes are exponentially distributed around this mean. When 0 is specified, resources
+    // of the class live until the end of the workload.
+    double MeanLifetimeInSeconds = 0;
+};
+
+// Statistical model of a workload, from which a trace of allocations is generated. Workloads
+// which cannot be shared as captured traces can instead be described by their distributions.
+struct SyntheticWorkloadDesc {
+    std::string Name = "SyntheticWorkload";
+
+    // Number of resources created by the workload.
+    uint64_t AllocationCount = 10000;
+
+    // Seeds the generator. The same seed generates the same trace with the same standard
+    // library.
+    uint32_t Seed = 0;
+
+    // Resources are created by this many threads, each picked uniformly at random, and released
+    // by the thread which created them.
+    uint32_t ThreadCount = 1;
+
+    // Resources are created as a Poisson process of this rate.
+    double ArrivalRatePerSecond = 1000;
+
+    // Resource sizes are log-normally distributed: the log of the size is normally distributed
+    // around the log of the median, with this standard deviation. Sizes are then clamped.
+    double MedianSizeInBytes = 64 * 1024;
+    double SizeSigma = 1.5;
+    uint64_t MinSizeInBytes = 256;
+    uint64_t MaxSizeInBytes = 256ll * 1024ll * 1024ll;
+
+    // Fraction of resources which are 2D textures, rather than buffers, and of buffers which are
+    // created in an upload heap, rather than a default heap.
+    double TextureFraction = 0.25;
+    double UploadBufferFraction = 0.1;
+
+    // Caps of the device the trace claims to have been captured on.
+    bool IsUMA = false;
+    int ResourceHeapTier = 2;
+
+    // Defaults to mostly short-lived resources, some living a few frames and a few persistent.
+    std::vector<SyntheticLifetimeClass> LifetimeClasses = {
+        {0.6, 0.016}, {0.3, 0.5}, {0.1, 0}};
+};
+
+// Reads the members of |workloadJson| into |workloadOut|. Members not specified keep their
+// default. Returns false if a member has the wrong type or value.
+bool ParseSyntheticWorkloadDesc(const Json::Value& workloadJson,
+                                SyntheticWorkloadDesc* workloadOut);
+
+// Writes the trace of the workload to |stream|, in the same format as a trace captured by
+// ResourceAllocator, so it can be replayed or simulated like one. Only the events read upon
+// playback are written. Returns false if the workload is invalid or the stream failed.
+bool GenerateSyntheticTrace(const SyntheticWorkloadDesc& workload, std::ostream& stream);
+
+#endif  // TESTS_CAPTUREREPLAYTESTS_SYNTHETICTRACEGENERATOR_H_
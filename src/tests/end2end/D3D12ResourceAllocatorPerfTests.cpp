@@ -0,0 +1,191 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gpgmm/LatencyHistogram.h"
+#include "tests/D3D12Test.h"
+
+#include <gpgmm_d3d12.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm::d3d12;
+
+static constexpr uint32_t kAllocationCountPerThread = 256;
+
+// Resource created by the workload, along with the heap it is created in.
+struct PERF_RESOURCE_DESC {
+    D3D12_HEAP_TYPE HeapType;
+    D3D12_RESOURCE_STATES InitialResourceState;
+    D3D12_RESOURCE_DESC ResourceDesc;
+};
+
+class D3D12ResourceAllocatorPerfTests : public D3D12TestBase, public ::testing::Test {
+  protected:
+    void SetUp() override {
+        D3D12TestBase::SetUp();
+    }
+
+    void TearDown() override {
+        D3D12TestBase::TearDown();
+    }
+
+    static D3D12_RESOURCE_DESC CreateBufferDesc(uint64_t width) {
+        D3D12_RESOURCE_DESC resourceDesc = {};
+        resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        resourceDesc.Width = width;
+        resourceDesc.Height = 1;
+        resourceDesc.DepthOrArraySize = 1;
+        resourceDesc.MipLevels = 1;
+        resourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+        resourceDesc.SampleDesc.Count = 1;
+        resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        return resourceDesc;
+    }
+
+    static D3D12_RESOURCE_DESC CreateTextureDesc(DXGI_FORMAT format,
+                                                 uint64_t size,
+                                                 D3D12_RESOURCE_FLAGS flags,
+                                                 uint32_t sampleCount = 1) {
+        D3D12_RESOURCE_DESC resourceDesc = {};
+        resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        resourceDesc.Width = size;
+        resourceDesc.Height = static_cast<uint32_t>(size);
+        resourceDesc.DepthOrArraySize = 1;
+        resourceDesc.MipLevels = 1;
+        resourceDesc.Format = format;
+        resourceDesc.SampleDesc.Count = sampleCount;
+        resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        resourceDesc.Flags = flags;
+        return resourceDesc;
+    }
+
+    // Mix of resources an app typically creates: mostly small buffers and textures, some
+    // staging buffers, and a few render targets, depth buffers and multisampled textures, so
+    // every RESOURCE_HEAP_TYPE is allocated from.
+    static std::vector<PERF_RESOURCE_DESC> CreateResourceMix() {
+        const D3D12_RESOURCE_STATES common = D3D12_RESOURCE_STATE_COMMON;
+        return {
+            {D3D12_HEAP_TYPE_DEFAULT, common, CreateBufferDesc(256)},
+            {D3D12_HEAP_TYPE_DEFAULT, common, CreateBufferDesc(4 * 1024)},
+            {D3D12_HEAP_TYPE_DEFAULT, common, CreateBufferDesc(64 * 1024)},
+            {D3D12_HEAP_TYPE_DEFAULT, common, CreateBufferDesc(1024 * 1024)},
+            {D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, CreateBufferDesc(1024)},
+            {D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ,
+             CreateBufferDesc(256 * 1024)},
+            {D3D12_HEAP_TYPE_READBACK, D3D12_RESOURCE_STATE_COPY_DEST,
+             CreateBufferDesc(64 * 1024)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 64, D3D12_RESOURCE_FLAG_NONE)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 256, D3D12_RESOURCE_FLAG_NONE)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_BC1_UNORM, 1024, D3D12_RESOURCE_FLAG_NONE)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 512,
+                               D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_D32_FLOAT, 512,
+                               D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)},
+            {D3D12_HEAP_TYPE_DEFAULT, common,
+             CreateTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 256,
+                               D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, /*sampleCount*/ 4)},
+        };
+    }
+
+    // Creates then releases resources of the mix from |threadCount| threads at once, each
+    // keeping a few alive so memory is re-used, and reports the throughput and latencies.
+    void CreateAndReleaseManyThreaded(uint32_t threadCount) {
+        ComPtr<ResourceAllocator> resourceAllocator;
+        ASSERT_SUCCEEDED(
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+        ASSERT_NE(resourceAllocator, nullptr);
+
+        const std::vector<PERF_RESOURCE_DESC> resourceMix = CreateResourceMix();
+
+        gpgmm::LatencyHistogram createResourceLatency;
+        std::atomic<uint64_t> failedCount{0};
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads(threadCount);
+        for (uint32_t threadIdx = 0; threadIdx < threadCount; threadIdx++) {
+            threads[threadIdx] = std::thread([&, threadIdx]() {
+                constexpr size_t kLiveAllocationCount = 8;
+                std::vector<ComPtr<ResourceAllocation>> liveAllocations(kLiveAllocationCount);
+                for (uint32_t i = 0; i < kAllocationCountPerThread; i++) {
+                    const PERF_RESOURCE_DESC& desc =
+                        resourceMix[(threadIdx + i * 7) % resourceMix.size()];
+
+                    ALLOCATION_DESC allocationDesc = {};
+                    allocationDesc.HeapType = desc.HeapType;
+
+                    const auto createStartTime = std::chrono::steady_clock::now();
+                    ComPtr<ResourceAllocation> allocation;
+                    if (FAILED(resourceAllocator->CreateResource(
+                            allocationDesc, desc.ResourceDesc, desc.InitialResourceState,
+                            nullptr, &allocation))) {
+                        failedCount++;
+                        continue;
+                    }
+                    createResourceLatency.Record(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - createStartTime)
+                            .count());
+
+                    // Releases the oldest live allocation.
+                    liveAllocations[i % kLiveAllocationCount] = std::move(allocation);
+                }
+            });
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        const double elapsedSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        EXPECT_EQ(failedCount.load(), 0u);
+
+        const gpgmm::LATENCY_HISTOGRAM_INFO latencyInfo = createResourceLatency.QueryInfo();
+        const gpgmm::LATENCY_HISTOGRAM_INFO lockWaitInfo =
+            resourceAllocator->QueryStats().LockWaitLatency;
+        const double allocationsPerSecond = latencyInfo.Count / elapsedSeconds;
+
+        gpgmm::InfoLog() << threadCount << " thread(s): " << allocationsPerSecond
+                         << " allocations/s, p50 " << latencyInfo.P50 << " ns, p99 "
+                         << latencyInfo.P99 << " ns, " << lockWaitInfo.Count
+                         << " lock waits, p99 lock wait " << lockWaitInfo.P99 << " ns.";
+
+        const std::string prefix = "Threads" + std::to_string(threadCount);
+        RecordProperty(prefix + "AllocationsPerSecond", static_cast<int>(allocationsPerSecond));
+        RecordProperty(prefix + "P99LatencyNs", static_cast<int>(latencyInfo.P99));
+        RecordProperty(prefix + "LockWaitCount", static_cast<int>(lockWaitInfo.Count));
+        RecordProperty(prefix + "P99LockWaitNs", static_cast<int>(lockWaitInfo.P99));
+    }
+};
+
+// Measures CreateResource and release throughput from one thread up to the number of cores,
+// doubling each time, so the scaling of the allocator locks can be compared.
+TEST_F(D3D12ResourceAllocatorPerfTests, CreateResourceManyThreaded) {
+    const uint32_t maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2) {
+        CreateAndReleaseManyThreaded(threadCount);
+    }
+}
@@ -20,8 +20,14 @@
 
 #include <gpgmm_d3d12.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
 #include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
 using namespace gpgmm::d3d12;
 
@@ -132,6 +138,19 @@ TEST_F(D3D12ResourceAllocatorTests, CreateAllocator) {
         EXPECT_EQ(allocator, nullptr);
     }
 
+    // Creating a new allocator with a max buffer slab size larger then the max resource heap
+    // size should always fail.
+    {
+        ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+        desc.MaxBufferSlabSize = kDefaultPreferredResourceHeapSize;
+        desc.MaxResourceHeapSize = kDefaultPreferredResourceHeapSize / 2;
+        desc.PreferredResourceHeapSize = kDefaultPreferredResourceHeapSize / 2;
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_FAILED(ResourceAllocator::CreateAllocator(desc, &allocator));
+        EXPECT_EQ(allocator, nullptr);
+    }
+
     // Creating a new allocator with residency management should always succeed.
     {
         ComPtr<ResidencyManager> residencyManager;
@@ -143,775 +162,3372 @@ TEST_F(D3D12ResourceAllocatorTests, CreateAllocator) {
     }
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorRecord) {
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorEvictInBackground) {
     ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
-    desc.RecordOptions.Flags =
-        static_cast<ALLOCATOR_RECORD_FLAGS>(ALLOCATOR_RECORD_FLAG_ALL_EVENTS);
+    desc.Flags |= ALLOCATOR_FLAG_EVICT_IN_BACKGROUND;
 
-    // Creating a new allocator that uses default record options should always succeed.
-    {
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator, &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
 
-    // Creating a new allocator that specifies a trace name should always succeed.
-    {
-        ALLOCATOR_DESC newDesc = desc;
-        newDesc.RecordOptions.TraceFile = "test.json";
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
 
-    // Creating a new allocator using various recording levels should always succeed.
-    {
-        ALLOCATOR_DESC newDesc = desc;
-        newDesc.RecordOptions.MinMessageLevel =
-            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_MESSAGE);
+    // Background eviction must always complete, even when nothing needs to be evicted.
+    std::shared_ptr<gpgmm::Event> event =
+        residencyManager->EvictAsync(kBufferSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+    ASSERT_NE(event, nullptr);
+    event->Wait();
+    EXPECT_TRUE(event->IsSignaled());
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ASSERT_SUCCEEDED(residencyManager->Evict(kBufferSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+}
 
-    {
-        ALLOCATOR_DESC newDesc = desc;
-        newDesc.RecordOptions.MinMessageLevel =
-            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_INFO);
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorEvictLeastFrequentlyUsed) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.EvictionPolicy = EVICTION_POLICY_LFU;
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator, &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
 
-    {
-        ALLOCATOR_DESC newDesc = desc;
-        newDesc.RecordOptions.MinMessageLevel =
-            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_WARNING);
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
 
-    {
-        ALLOCATOR_DESC newDesc = desc;
-        newDesc.RecordOptions.MinMessageLevel =
-            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_ERROR);
+    // Heaps are only counted once used by a submission.
+    Heap* resourceHeap = ToBackend(allocation->GetMemory());
+    ASSERT_NE(resourceHeap, nullptr);
+    EXPECT_EQ(resourceHeap->GetInfo().AccessCount, 0u);
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
-        EXPECT_NE(allocator, nullptr);
-    }
+    ASSERT_SUCCEEDED(residencyManager->Evict(kBufferSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
 }
 
-// Exceeding the max resource heap size should always fail.
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferOversized) {
-    constexpr uint64_t kOversizedBuffer = 32ll * 1024ll * 1024ll * 1024ll;  // 32GB
-    ComPtr<ResourceAllocation> allocation;
-    ASSERT_FAILED(mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kOversizedBuffer + 1),
-                                                    D3D12_RESOURCE_STATE_COMMON, nullptr,
-                                                    &allocation));
-    ASSERT_EQ(allocation, nullptr);
-}
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorReleaseInBackground) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_RELEASE_IN_BACKGROUND;
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBuffer) {
-    // Creating a resource without allocation should always fail.
-    {
-        ASSERT_FAILED(mDefaultAllocator->CreateResource(
-            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_COMMON, nullptr, nullptr));
-    }
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    // Using the min resource heap size should always succeed.
-    {
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-        ASSERT_NE(allocation->GetResource(), nullptr);
-    }
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
 
-    // Mapping the entire buffer should always succeed.
+    // Pooled resource heap is released by Trim().
     {
         ComPtr<ResourceAllocation> allocation;
-        ALLOCATION_DESC allocationDesc = {};
-        allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
         ASSERT_NE(allocation, nullptr);
-        ASSERT_NE(allocation->GetResource(), nullptr);
-
-        ASSERT_SUCCEEDED(allocation->Map());
     }
 
-    // Resource per heap type should always succeed if the heap type is allowed.
-    {
-        ALLOCATION_DESC allocationDesc = {};
-        allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-    }
-    {
-        ALLOCATION_DESC allocationDesc = {};
-        allocationDesc.HeapType = D3D12_HEAP_TYPE_READBACK;
+    allocator->Trim();
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryUsage, 0u);
+    EXPECT_EQ(allocator->QueryInfo().FreeMemoryUsage, 0u);
 
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-    }
+    // Committed resource is released once the allocation is released.
     {
         ALLOCATION_DESC allocationDesc = {};
-        allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
 
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc,
+                                                   CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
         ASSERT_NE(allocation, nullptr);
     }
-    {
-        ALLOCATION_DESC allocationDesc = {};
-        allocationDesc.HeapType = D3D12_HEAP_TYPE_CUSTOM;
 
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(mDefaultAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-    }
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryUsage, 0u);
 
-    // Creating a zero sized buffer is not allowed.
+    // Resources still being released must not outlive the allocator.
     {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(mDefaultAllocator->CreateResource(
-            {}, CreateBasicBufferDesc(0), D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-        ASSERT_EQ(allocation, nullptr);
+        ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
     }
+    allocator->Trim();
+    allocator = nullptr;
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateSmallTexture) {
-    // DXGI_FORMAT_R8G8B8A8_UNORM
-    {
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-        EXPECT_TRUE(
-            gpgmm::IsAligned(allocation->GetSize(),
-                             static_cast<uint32_t>(D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)));
-    }
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorMemoryPressureCallback) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.TotalResourceBudgetLimit = kDefaultPreferredResourceHeapSize;
+
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator, &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
+
+    std::vector<MEMORY_PRESSURE_INFO> infos;
+    DWORD cookie = 0;
+    ASSERT_SUCCEEDED(residencyManager->RegisterMemoryPressureCallback(
+        [](const MEMORY_PRESSURE_INFO& info, void* context) {
+            static_cast<std::vector<MEMORY_PRESSURE_INFO>*>(context)->push_back(info);
+        },
+        &infos, &cookie));
+
+    // Making more resident than the budget allows must be reported.
+    ASSERT_SUCCEEDED(residencyManager->Evict(desc.TotalResourceBudgetLimit * 2,
+                                             DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    ASSERT_FALSE(infos.empty());
+    EXPECT_EQ(infos.back().MemorySegmentGroup, DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+    EXPECT_EQ(infos.back().Level, MEMORY_PRESSURE_LEVEL_RED);
+    EXPECT_GT(infos.back().SizeOverBudget, 0u);
+
+    // Unregistered callbacks are no longer called.
+    ASSERT_SUCCEEDED(residencyManager->UnregisterMemoryPressureCallback(cookie));
+    ASSERT_FAILED(residencyManager->UnregisterMemoryPressureCallback(cookie));
+
+    const size_t infoCount = infos.size();
+    ASSERT_SUCCEEDED(residencyManager->Evict(desc.TotalResourceBudgetLimit * 2,
+                                             DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_EQ(infos.size(), infoCount);
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateMultisampledTexture) {
-    // DXGI_FORMAT_R8G8B8A8_UNORM
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorVideoMemoryBudgetOverride) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.TotalResourceBudgetLimit = kDefaultPreferredResourceHeapSize * 4;
+
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator, &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
+
+    const uint64_t limitedBudget =
+        residencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL).Budget;
+
+    // A lower budget replaces the limited budget.
+    ASSERT_SUCCEEDED(residencyManager->SetVideoMemoryBudgetOverride(
+        DXGI_MEMORY_SEGMENT_GROUP_LOCAL, kDefaultPreferredResourceHeapSize));
+    EXPECT_EQ(residencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL).Budget,
+              kDefaultPreferredResourceHeapSize);
+
+    // A higher budget is still clamped by the limit.
+    ASSERT_SUCCEEDED(residencyManager->SetVideoMemoryBudgetOverride(
+        DXGI_MEMORY_SEGMENT_GROUP_LOCAL, limitedBudget * 2));
+    EXPECT_EQ(residencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL).Budget,
+              limitedBudget);
+
+    // Zero restores the limited budget.
+    ASSERT_SUCCEEDED(residencyManager->SetVideoMemoryBudgetOverride(
+        DXGI_MEMORY_SEGMENT_GROUP_LOCAL, kDefaultPreferredResourceHeapSize));
+    ASSERT_SUCCEEDED(
+        residencyManager->SetVideoMemoryBudgetOverride(DXGI_MEMORY_SEGMENT_GROUP_LOCAL, 0));
+    EXPECT_EQ(residencyManager->GetVideoMemoryInfo(DXGI_MEMORY_SEGMENT_GROUP_LOCAL).Budget,
+              limitedBudget);
+
+    ASSERT_FAILED(residencyManager->SetVideoMemoryBudgetOverride(
+        static_cast<DXGI_MEMORY_SEGMENT_GROUP>(2), kDefaultPreferredResourceHeapSize));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorOfferPooledHeaps) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_OFFER_POOLED_HEAPS;
+    desc.TotalResourceBudgetLimit = kDefaultPreferredResourceHeapSize * 2;
+
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator, &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
+
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
+
+    // Resource heap is pooled once the resource is released.
     {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 4),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
         ASSERT_NE(allocation, nullptr);
-        EXPECT_TRUE(gpgmm::IsAligned(
-            allocation->GetSize(),
-            static_cast<uint32_t>(D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)));
     }
-}
 
-TEST_F(D3D12ResourceAllocatorTests, ImportBuffer) {
-    // Importing a non-existent buffer should always fail.
-    ComPtr<ResourceAllocation> externalAllocation;
-    ASSERT_FAILED(mDefaultAllocator->CreateResource(nullptr, &externalAllocation));
-    ASSERT_EQ(externalAllocation, nullptr);
+    EXPECT_EQ(residencyManager->GetOfferedUsage(DXGI_MEMORY_SEGMENT_GROUP_LOCAL), 0u);
 
-    // Importing a buffer without returning the allocation should always fail.
-    ASSERT_FAILED(mDefaultAllocator->CreateResource(
-        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
-        nullptr, nullptr));
+    // Pooled resource heap is offered instead of released once over budget.
+    ASSERT_SUCCEEDED(residencyManager->Evict(desc.TotalResourceBudgetLimit * 2,
+                                             DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_EQ(residencyManager->GetOfferedUsage(DXGI_MEMORY_SEGMENT_GROUP_LOCAL), kBufferSize);
+    EXPECT_EQ(allocator->QueryInfo().FreeMemoryUsage, kBufferSize);
 
-    // Importing a buffer should always succeed.
-    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
-        nullptr, &externalAllocation));
-    ASSERT_NE(externalAllocation, nullptr);
+    // Re-using the offered resource heap reclaims it once made resident again.
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &allocation));
+    EXPECT_EQ(allocator->QueryInfo().FreeMemoryUsage, 0u);
 
-    ComPtr<ResourceAllocation> internalAllocation;
-    ASSERT_SUCCEEDED(
-        mDefaultAllocator->CreateResource(externalAllocation->GetResource(), &internalAllocation));
-    ASSERT_NE(internalAllocation, nullptr);
+    Heap* resourceHeap = ToBackend(allocation->GetMemory());
+    ASSERT_NE(resourceHeap, nullptr);
+    EXPECT_TRUE(resourceHeap->IsEvicted());
 
-    // Underlying resource must stay the same.
-    ASSERT_EQ(internalAllocation->GetResource(), externalAllocation->GetResource());
+    ASSERT_SUCCEEDED(residencyManager->LockHeap(resourceHeap));
+    EXPECT_EQ(residencyManager->GetOfferedUsage(DXGI_MEMORY_SEGMENT_GROUP_LOCAL), 0u);
+    ASSERT_SUCCEEDED(residencyManager->UnlockHeap(resourceHeap));
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferInvalid) {
-    // Garbage buffer descriptor should always fail.
-    D3D12_RESOURCE_DESC badBufferDesc = CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize);
-    badBufferDesc.Flags = static_cast<D3D12_RESOURCE_FLAGS>(0xFF);
+TEST_F(D3D12ResourceAllocatorTests, QueryResidencyStats) {
+    ComPtr<ResidencyManager> residencyManager;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator,
+                                                        &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
+
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
 
     ComPtr<ResourceAllocation> allocation;
-    ASSERT_FAILED(mDefaultAllocator->CreateResource({}, badBufferDesc, D3D12_RESOURCE_STATE_COMMON,
-                                                    nullptr, &allocation));
-    ASSERT_EQ(allocation, nullptr);
-}
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    Heap* resourceHeap = ToBackend(allocation->GetMemory());
+    ASSERT_NE(resourceHeap, nullptr);
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferAlwaysCommitted) {
-    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
-    desc.Flags = ALLOCATOR_FLAG_ALWAYS_COMMITED;
+    ASSERT_SUCCEEDED(allocator->BeginFrame(0));
+
+    // Evicting every resident heap counts the resource heap as evicted.
+    ASSERT_SUCCEEDED(residencyManager->Evict(std::numeric_limits<uint64_t>::max() / 2,
+                                             DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    ASSERT_TRUE(resourceHeap->IsEvicted());
+
+    RESIDENCY_MANAGER_STATS stats = residencyManager->QueryStats();
+    EXPECT_GE(stats.Frame.EvictedCount, 1u);
+    EXPECT_GE(stats.Frame.EvictedSizeInBytes, kBufferSize);
+    EXPECT_GE(stats.Frame.EvictTimeInSeconds, 0.0);
+    EXPECT_EQ(stats.Frame.FenceWaitCount, 0u);
+    EXPECT_GE(stats.EvictLatency.Count, 1u);
+
+    // Locking it again counts it as made resident.
+    ASSERT_SUCCEEDED(residencyManager->LockHeap(resourceHeap));
+    ASSERT_SUCCEEDED(residencyManager->UnlockHeap(resourceHeap));
+
+    stats = residencyManager->QueryStats();
+    EXPECT_GE(stats.Frame.MadeResidentCount, 1u);
+    EXPECT_GE(stats.Frame.MadeResidentSizeInBytes, kBufferSize);
+    EXPECT_GE(stats.Total.EvictedCount, stats.Frame.EvictedCount);
+    EXPECT_GE(stats.Total.MadeResidentCount, stats.Frame.MadeResidentCount);
+    EXPECT_GE(stats.MakeResidentLatency.Count, 1u);
+
+    // The next frame starts counting over, unlike the total.
+    ASSERT_SUCCEEDED(allocator->EndFrame());
+    ASSERT_SUCCEEDED(allocator->BeginFrame(0));
+
+    const RESIDENCY_MANAGER_STATS nextFrameStats = residencyManager->QueryStats();
+    EXPECT_EQ(nextFrameStats.Frame.EvictedCount, 0u);
+    EXPECT_EQ(nextFrameStats.Frame.MadeResidentCount, 0u);
+    EXPECT_EQ(nextFrameStats.Total.EvictedCount, stats.Total.EvictedCount);
+    EXPECT_EQ(nextFrameStats.Total.MadeResidentCount, stats.Total.MadeResidentCount);
+
+    ASSERT_SUCCEEDED(allocator->EndFrame());
+}
 
+TEST_F(D3D12ResourceAllocatorTests, LockHeapManyThreaded) {
+    ComPtr<ResidencyManager> residencyManager;
     ComPtr<ResourceAllocator> allocator;
-    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
-    ASSERT_NE(allocator, nullptr);
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator,
+                                                        &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
 
     ComPtr<ResourceAllocation> allocation;
-    ASSERT_SUCCEEDED(
-        allocator->CreateResource({}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-                                  D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-    ASSERT_NE(allocation, nullptr);
-    EXPECT_EQ(allocation->GetSize(), kDefaultPreferredResourceHeapSize);
-
-    // Commmitted resources cannot be backed by a D3D12 heap.
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, &allocation));
     Heap* resourceHeap = ToBackend(allocation->GetMemory());
     ASSERT_NE(resourceHeap, nullptr);
-    ASSERT_EQ(resourceHeap->GetHeap(), nullptr);
-}
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverAllocate) {
-    // Enabling pooling to recycle memory since sub-allocation could fail.
-    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
-    allocatorDesc.MaxResourceSizeForPooling = kDefaultPreferredResourceHeapSize;
+    // Every thread locks and unlocks the heap while it stays locked by this one.
+    ASSERT_SUCCEEDED(residencyManager->LockHeap(resourceHeap));
+
+    constexpr uint32_t kNumOfThreads = 4;
+    constexpr uint32_t kNumOfLocks = 1000;
+    std::vector<std::thread> threads(kNumOfThreads);
+    for (std::thread& thread : threads) {
+        thread = std::thread([&]() {
+            for (uint32_t i = 0; i < kNumOfLocks; i++) {
+                ASSERT_SUCCEEDED(residencyManager->LockHeap(resourceHeap));
+                ASSERT_SUCCEEDED(residencyManager->UnlockHeap(resourceHeap));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_TRUE(resourceHeap->IsResidencyLocked());
+    EXPECT_FALSE(resourceHeap->IsInResidencyLRUCache());
 
+    // Once the last lock is released, the heap is tracked by the LRU cache again.
+    ASSERT_SUCCEEDED(residencyManager->UnlockHeap(resourceHeap));
+    EXPECT_FALSE(resourceHeap->IsResidencyLocked());
+    EXPECT_TRUE(resourceHeap->IsInResidencyLRUCache());
+    ASSERT_FAILED(residencyManager->UnlockHeap(resourceHeap));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferWithTag) {
+    ComPtr<ResidencyManager> residencyManager;
     ComPtr<ResourceAllocator> allocator;
-    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
-    ASSERT_NE(allocator, nullptr);
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator,
+                                                        &residencyManager));
+    ASSERT_NE(residencyManager, nullptr);
+
+    std::vector<MEMORY_PRESSURE_INFO> infos;
+    DWORD cookie = 0;
+    ASSERT_SUCCEEDED(residencyManager->RegisterMemoryPressureCallback(
+        [](const MEMORY_PRESSURE_INFO& info, void* context) {
+            if (info.IsTagQuotaExceeded) {
+                static_cast<std::vector<MEMORY_PRESSURE_INFO>*>(context)->push_back(info);
+            }
+        },
+        &infos, &cookie));
+
+    constexpr uint32_t kTextureTag = 1u;
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize;
 
-    // Check we can't reuse memory if CreateResource was never called previously.
     ALLOCATION_DESC allocationDesc = {};
-    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    allocationDesc.Tag = kMaxAllocationTagCount;
+
     ComPtr<ResourceAllocation> allocation;
-    ASSERT_FAILED(allocator->CreateResource(
-        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize + 1),
-        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-    ASSERT_EQ(allocation, nullptr);
+    ASSERT_FAILED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_FAILED(allocator->SetTagQuota(kMaxAllocationTagCount, kBufferSize));
+
+    // Resources are counted by their tag only.
+    allocationDesc.Tag = kTextureTag;
+    ASSERT_SUCCEEDED(allocator->SetTagQuota(kTextureTag, kBufferSize));
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &allocation));
+    EXPECT_EQ(allocator->QueryTagInfo(kTextureTag).UsedCount, 1u);
+    EXPECT_EQ(allocator->QueryTagInfo(kTextureTag).UsedSizeInBytes, kBufferSize);
+    EXPECT_EQ(allocator->QueryTagInfo(kTextureTag).QuotaInBytes, kBufferSize);
+    EXPECT_EQ(allocator->QueryTagInfo(0).UsedCount, 0u);
+    EXPECT_TRUE(infos.empty());
+
+    // Exceeding the quota is reported, once, but the resource is still created.
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &secondAllocation));
+    ASSERT_EQ(infos.size(), 1u);
+    EXPECT_EQ(infos.back().Tag, kTextureTag);
+    EXPECT_EQ(infos.back().TagUsage, kBufferSize * 2);
+    EXPECT_EQ(infos.back().TagQuota, kBufferSize);
+
+    ComPtr<ResourceAllocation> thirdAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &thirdAllocation));
+    EXPECT_EQ(infos.size(), 1u);
+
+    // Released resources are no longer counted.
+    allocation = nullptr;
+    secondAllocation = nullptr;
+    thirdAllocation = nullptr;
+    EXPECT_EQ(allocator->QueryTagInfo(kTextureTag).UsedCount, 0u);
+    EXPECT_EQ(allocator->QueryTagInfo(kTextureTag).UsedSizeInBytes, 0u);
+
+    ASSERT_SUCCEEDED(residencyManager->UnregisterMemoryPressureCallback(cookie));
+}
 
-    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize / 8;
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorGroup) {
+    ALLOCATOR_GROUP_DESC groupDesc = {};
+    groupDesc.TotalResourceBudgetLimit = kDefaultPreferredResourceHeapSize;
 
-    allocationDesc.Flags = ALLOCATION_FLAG_NONE;
-    ComPtr<ResourceAllocation> allocationA;
-    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(bufferSize),
-                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocationA));
-    ASSERT_NE(allocationA, nullptr);
+    ComPtr<AllocatorGroup> group;
+    ASSERT_SUCCEEDED(AllocatorGroup::CreateAllocatorGroup(groupDesc, &group));
 
-    // Allow the memory from |allocationA| to be recycled.
-    allocationA.Reset();
+    ComPtr<ResourceAllocator> firstAllocator;
+    ASSERT_SUCCEEDED(group->CreateAllocator(CreateBasicAllocatorDesc(), &firstAllocator));
 
-    // Re-check that the same resource heap is used once CreateResource gets called.
-    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
-    ComPtr<ResourceAllocation> allocationB;
-    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(bufferSize),
-                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocationB));
-    ASSERT_NE(allocationB, nullptr);
-}
+    ComPtr<ResourceAllocator> secondAllocator;
+    ASSERT_SUCCEEDED(group->CreateAllocator(CreateBasicAllocatorDesc(), &secondAllocator));
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferSuballocatedWithin) {
-    ALLOCATION_DESC desc = {};
-    desc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
-    desc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    // Resource heap freed by the first allocator remains pooled.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(firstAllocator->CreateResource(
+            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
 
-    constexpr uint32_t kSubAllocationSize = 4u;
+    EXPECT_GT(firstAllocator->QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(group->GetResourceHeapUsage(), kDefaultPreferredResourceHeapSize);
 
-    // Create two tiny buffers that will be byte-aligned.
-    ComPtr<ResourceAllocation> tinyBufferAllocA;
-    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        &tinyBufferAllocA));
-    ASSERT_NE(tinyBufferAllocA, nullptr);
-    EXPECT_EQ(tinyBufferAllocA->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
-    EXPECT_EQ(tinyBufferAllocA->GetSize(), kSubAllocationSize);
+    // The pooled resource heap must be released to stay within the group budget.
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(secondAllocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
 
-    ComPtr<ResourceAllocation> tinyBufferAllocB;
-    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        &tinyBufferAllocB));
-    ASSERT_NE(tinyBufferAllocB, nullptr);
-    EXPECT_EQ(tinyBufferAllocB->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
-    EXPECT_EQ(tinyBufferAllocB->GetSize(), kSubAllocationSize);
+    EXPECT_EQ(firstAllocator->QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(group->GetResourceHeapUsage(), kDefaultPreferredResourceHeapSize);
 
-    // Both buffers should be allocated in sequence, back-to-back.
-    EXPECT_EQ(tinyBufferAllocA->GetOffsetFromResource() + kSubAllocationSize,
-              tinyBufferAllocB->GetOffsetFromResource());
+    // The group outlives its allocators.
+    group = nullptr;
+    allocation = nullptr;
+    firstAllocator = nullptr;
+    secondAllocator = nullptr;
+}
 
-    EXPECT_EQ(tinyBufferAllocA->GetResource(), tinyBufferAllocB->GetResource());
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorUseTLSF) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_USE_TLSF;
 
-    EXPECT_EQ(tinyBufferAllocA->GetGPUVirtualAddress() + kSubAllocationSize,
-              tinyBufferAllocB->GetGPUVirtualAddress());
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    // Mapping a resource allocation allocated within itself must use the entire resource.
-    ASSERT_FAILED(tinyBufferAllocA->Map(1));
-    ASSERT_FAILED(tinyBufferAllocB->Map(1));
+    // Use a size which the buddy system would otherwise round up to a power-of-two.
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT * 3;
 
-    // Create another using a new heap type, it must be given it's own resource.
-    desc.HeapType = D3D12_HEAP_TYPE_READBACK;
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &firstAllocation));
+    ASSERT_NE(firstAllocation, nullptr);
 
-    ComPtr<ResourceAllocation> tinyBufferAllocC;
-    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-        &tinyBufferAllocC));
-    ASSERT_NE(tinyBufferAllocC, nullptr);
-    EXPECT_EQ(tinyBufferAllocC->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
-    EXPECT_EQ(tinyBufferAllocC->GetSize(), kSubAllocationSize);
-    EXPECT_EQ(tinyBufferAllocC->GetOffsetFromResource(), 0u);
-    EXPECT_NE(tinyBufferAllocC->GetResource(), tinyBufferAllocA->GetResource());
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &secondAllocation));
+    ASSERT_NE(secondAllocation, nullptr);
+}
 
-    // Write kSubAllocationSize worth of bytes with value 0xAA in mapped subAllocation A.
-    std::vector<uint8_t> dataAA(kSubAllocationSize, 0xAA);
-    void* mappedBufferA = nullptr;
-    ASSERT_SUCCEEDED(tinyBufferAllocA->Map(0, nullptr, &mappedBufferA));
-    memcpy(mappedBufferA, dataAA.data(), dataAA.size());
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorAdapterPreferredResourceHeapSize) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.PreferredResourceHeapSize = 0;
 
-    // Write kSubAllocationSize worth of bytes with value 0xBB in mapped subAllocation B.
-    std::vector<uint8_t> dataBB(kSubAllocationSize, 0xBB);
-    void* mappedBufferB = nullptr;
-    ASSERT_SUCCEEDED(tinyBufferAllocB->Map(0, nullptr, &mappedBufferB));
-    memcpy(mappedBufferB, dataBB.data(), dataBB.size());
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    EXPECT_NE(mappedBufferA, mappedBufferB);
+    // Adapters never prefer resource heaps smaller than the default size.
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 512, 512),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_GE(allocation->GetMemory()->GetSize(), kDefaultPreferredResourceHeapSize);
+}
 
-    // Map the entire buffer and check both allocated ranges.
-    void* mappedBuffer = nullptr;
-    ASSERT_SUCCEEDED(tinyBufferAllocB->GetResource()->Map(0, nullptr, &mappedBuffer));
+// Heaps created without being zeroed, or the flag being ignored, must still be usable.
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorCreateNotZeroed) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_CREATE_NOT_ZEROED;
 
-    const uint8_t* mappedByte = static_cast<uint8_t*>(mappedBuffer);
-    for (uint32_t i = 0; i < kSubAllocationSize; i++, mappedByte++) {
-        EXPECT_EQ(*mappedByte, 0xAA);
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 512, 512),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
     }
 
-    for (uint32_t i = 0; i < kSubAllocationSize; i++, mappedByte++) {
-        EXPECT_EQ(*mappedByte, 0xBB);
+    {
+        ALLOCATION_DESC standaloneAllocationDesc = {};
+        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
     }
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverSubAllocated) {
-    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize / 2;
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorUsePlacedBuffers) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_USE_PLACED_BUFFERS;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
     ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
     allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
 
-    ComPtr<ResourceAllocation> subAllocation;
-    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
-        allocationDesc, CreateBasicBufferDesc(bufferSize), D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr, &subAllocation));
-    ASSERT_NE(subAllocation, nullptr);
-    EXPECT_NE(subAllocation->GetResource(), nullptr);
-    EXPECT_NE(subAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+    constexpr uint64_t kBufferSize = 256u;
+
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                               &firstAllocation));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                               &secondAllocation));
+    ASSERT_NE(secondAllocation, nullptr);
+
+    // Both buffers are sub-allocated within the same placed buffer.
+    EXPECT_EQ(firstAllocation->GetResource(), secondAllocation->GetResource());
+    EXPECT_EQ(firstAllocation->GetMemory(), secondAllocation->GetMemory());
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverPooled) {
-    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
-    allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_ON_DEMAND;
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorSizeClasses) {
+    constexpr ALLOCATOR_SIZE_CLASS_DESC kSizeClasses[] = {
+        {D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, ALLOCATOR_ALGORITHM_SLAB},
+        {kDefaultPreferredResourceHeapSize / 4, ALLOCATOR_ALGORITHM_TLSF},
+        {kDefaultPreferredResourceHeapSize, ALLOCATOR_ALGORITHM_BUDDY_SYSTEM},
+        {0, ALLOCATOR_ALGORITHM_DEDICATED},
+    };
 
-    ComPtr<ResourceAllocator> resourceAllocator;
-    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
-    ASSERT_NE(resourceAllocator, nullptr);
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.SizeClasses = {std::begin(kSizeClasses), std::end(kSizeClasses)};
 
-    ALLOCATION_DESC baseAllocationDesc = {};
-    baseAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+    // Every size class sub-allocates, except the last, which places each resource in its own
+    // resource heap.
+    for (const ALLOCATOR_SIZE_CLASS_DESC& sizeClass : kSizeClasses) {
+        const uint64_t bufferSize = (sizeClass.MaxSizeInBytes > 0)
+                                        ? sizeClass.MaxSizeInBytes
+                                        : kDefaultPreferredResourceHeapSize * 2;
 
-    // Create the first buffer.
-    {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            baseAllocationDesc, CreateBasicBufferDesc(bufferSize * 2),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(bufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
         ASSERT_NE(allocation, nullptr);
-        EXPECT_NE(allocation->GetResource(), nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+        EXPECT_EQ(allocation->GetMethod(), (sizeClass.Algorithm == ALLOCATOR_ALGORITHM_DEDICATED)
+                                               ? gpgmm::AllocationMethod::kStandalone
+                                               : gpgmm::AllocationMethod::kSubAllocated);
     }
 
-    // Check the first buffer was not pool-allocated by creating it again.
+    // Size classes must be in ascending order.
     {
-        ALLOCATION_DESC allocationDesc = baseAllocationDesc;
-        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ALLOCATOR_DESC newAllocatorDesc = desc;
+        std::swap(newAllocatorDesc.SizeClasses[0], newAllocatorDesc.SizeClasses[1]);
 
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(resourceAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(bufferSize * 2),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ComPtr<ResourceAllocator> invalidAllocator;
+        ASSERT_FAILED(ResourceAllocator::CreateAllocator(newAllocatorDesc, &invalidAllocator));
     }
+}
 
-    // Create another buffer.
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorHeapTypeBudgets) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.HeapTypeBudgets = {{D3D12_HEAP_TYPE_UPLOAD, kDefaultPreferredResourceHeapSize}};
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    ALLOCATION_DESC uploadAllocationDesc = {};
+    uploadAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    const D3D12_RESOURCE_DESC bufferDesc =
+        CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize);
+
+    // Only one upload buffer fits within the budget.
+    {
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(uploadAllocationDesc, bufferDesc,
+                                                   D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                   &firstAllocation));
+
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_FAILED(allocator->CreateResource(uploadAllocationDesc, bufferDesc,
+                                                D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                &secondAllocation));
+
+        // Other heap types are not limited.
+        ComPtr<ResourceAllocation> defaultAllocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource({}, bufferDesc, D3D12_RESOURCE_STATE_COMMON,
+                                                   nullptr, &defaultAllocation));
+    }
+
+    // Resource heaps pooled by the first upload buffer are released to make room for another.
     {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            baseAllocationDesc, CreateBasicBufferDesc(bufferSize * 3),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-        EXPECT_NE(allocation->GetResource(), nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+        ASSERT_SUCCEEDED(allocator->CreateResource(uploadAllocationDesc, bufferDesc,
+                                                   D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                   &allocation));
     }
 
-    // Check the second buffer was not pool-allocated by creating it again.
+    // Budgets must be non-zero.
     {
-        ALLOCATION_DESC allocationDesc = baseAllocationDesc;
-        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ALLOCATOR_DESC newAllocatorDesc = desc;
+        newAllocatorDesc.HeapTypeBudgets = {{D3D12_HEAP_TYPE_UPLOAD, 0}};
 
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(resourceAllocator->CreateResource(
-            allocationDesc, CreateBasicBufferDesc(bufferSize * 3),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ComPtr<ResourceAllocator> invalidAllocator;
+        ASSERT_FAILED(ResourceAllocator::CreateAllocator(newAllocatorDesc, &invalidAllocator));
     }
-}
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferPooled) {
-    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+    // Heap types can only be budgeted once.
+    {
+        ALLOCATOR_DESC newAllocatorDesc = desc;
+        newAllocatorDesc.HeapTypeBudgets.push_back(desc.HeapTypeBudgets[0]);
 
-    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
-    allocatorDesc.MaxResourceSizeForPooling = bufferSize;
+        ComPtr<ResourceAllocator> invalidAllocator;
+        ASSERT_FAILED(ResourceAllocator::CreateAllocator(newAllocatorDesc, &invalidAllocator));
+    }
+}
 
-    ComPtr<ResourceAllocator> poolAllocator;
-    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
-    ASSERT_NE(poolAllocator, nullptr);
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorMaxResourceSizeForSubAllocation) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.MaxResourceSizeForSubAllocation = kDefaultPreferredResourceHeapSize / 2;
 
-    // Only standalone allocations can be pool-allocated.
-    ALLOCATION_DESC standaloneAllocationDesc = {};
-    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
-    standaloneAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    // Create buffer of size A with it's own resource heap that will be returned to the pool.
+    // Resource no larger than the max resource size for sub-allocation is sub-allocated.
     {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicBufferDesc(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicBufferDesc(desc.MaxResourceSizeForSubAllocation),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
         ASSERT_NE(allocation, nullptr);
-        EXPECT_NE(allocation->GetResource(), nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
     }
 
-    // Create buffer of size B with it's own resource heap that will be returned to the pool.
+    // Larger resource is placed in its own resource heap.
     {
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicBufferDesc(bufferSize / 2),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicBufferDesc(desc.MaxResourceSizeForSubAllocation * 2),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
         ASSERT_NE(allocation, nullptr);
-        EXPECT_NE(allocation->GetResource(), nullptr);
         EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
     }
+}
 
-    // Create buffer of size A again with it's own resource heap from the pool.
-    {
-        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
-        reusePoolOnlyDesc.Flags =
-            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(
-            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize),
-                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorWarmUp) {
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 2;
+
+    ALLOCATOR_WARM_UP_DESC warmUpDesc = {};
+    warmUpDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+    warmUpDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    warmUpDesc.SizeInBytes = kBufferSize;
+    warmUpDesc.Count = 4;
+
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.WarmUpProfile = {warmUpDesc};
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    // Resources in the profile must be created without allocating any more memory.
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+    std::vector<ComPtr<ResourceAllocation>> allocations(warmUpDesc.Count);
+    for (auto& allocation : allocations) {
+        ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc,
+                                                   CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
         ASSERT_NE(allocation, nullptr);
-        EXPECT_NE(allocation->GetResource(), nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
     }
 
-    // Create buffer of size B again with it's own resource heap from the pool.
+    // Warming-up in the background must not prevent the allocator from being created or
+    // destroyed.
+    desc.Flags |= ALLOCATOR_FLAG_WARM_UP_IN_BACKGROUND;
+
+    ComPtr<ResourceAllocator> backgroundAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &backgroundAllocator));
+    ASSERT_NE(backgroundAllocator, nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorRecordWarmUpProfile) {
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 2;
+
+    // Profile cannot be queried unless recorded.
     {
-        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
-        reusePoolOnlyDesc.Flags =
-            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
-        ComPtr<ResourceAllocation> allocation;
+        ComPtr<ResourceAllocator> allocator;
         ASSERT_SUCCEEDED(
-            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize / 2),
-                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+
+        std::vector<ALLOCATOR_WARM_UP_DESC> profile;
+        ASSERT_FAILED(allocator->QueryWarmUpProfile(&profile));
+    }
+
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_RECORD_WARM_UP_PROFILE;
+
+    std::vector<ALLOCATOR_WARM_UP_DESC> profile;
+    {
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+        ASSERT_NE(allocator, nullptr);
+
+        // Only the most resources which existed at once are recorded.
+        for (uint32_t i = 0; i < 2; i++) {
+            std::vector<ComPtr<ResourceAllocation>> allocations(3);
+            for (auto& allocation : allocations) {
+                ASSERT_SUCCEEDED(allocator->CreateResource(
+                    {}, CreateBasicBufferDesc(kBufferSize), D3D12_RESOURCE_STATE_COMMON, nullptr,
+                    &allocation));
+                ASSERT_NE(allocation, nullptr);
+            }
+        }
+
+        ASSERT_SUCCEEDED(allocator->QueryWarmUpProfile(&profile));
+        ASSERT_EQ(profile.size(), 1u);
+        EXPECT_EQ(profile[0].HeapType, D3D12_HEAP_TYPE_DEFAULT);
+        EXPECT_EQ(profile[0].Dimension, D3D12_RESOURCE_DIMENSION_BUFFER);
+        EXPECT_EQ(profile[0].SizeInBytes, kBufferSize);
+        EXPECT_EQ(profile[0].Count, 3u);
+    }
+
+    // Profile is the same once saved and loaded again, by the next launch.
+    const std::string profileFile = "CreateAllocatorRecordWarmUpProfile.bin";
+    ASSERT_SUCCEEDED(ResourceAllocator::SaveWarmUpProfile(profile, profileFile));
+
+    std::vector<ALLOCATOR_WARM_UP_DESC> loadedProfile;
+    ASSERT_SUCCEEDED(ResourceAllocator::LoadWarmUpProfile(profileFile, &loadedProfile));
+    ASSERT_EQ(loadedProfile.size(), profile.size());
+    EXPECT_EQ(loadedProfile[0].SizeInBytes, profile[0].SizeInBytes);
+    EXPECT_EQ(loadedProfile[0].Alignment, profile[0].Alignment);
+    EXPECT_EQ(loadedProfile[0].Count, profile[0].Count);
+
+    ASSERT_FAILED(ResourceAllocator::LoadWarmUpProfile("DoesNotExist.bin", &loadedProfile));
+
+    // Resources in the loaded profile are created without allocating any more memory.
+    desc.WarmUpProfile = loadedProfile;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+    std::vector<ComPtr<ResourceAllocation>> allocations(3);
+    for (auto& allocation : allocations) {
+        ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc,
+                                                   CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateAllocatorRecord) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.RecordOptions.Flags =
+        static_cast<ALLOCATOR_RECORD_FLAGS>(ALLOCATOR_RECORD_FLAG_ALL_EVENTS);
+
+    // Creating a new allocator that uses default record options should always succeed.
+    {
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    // Creating a new allocator that specifies a trace name should always succeed.
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.TraceFile = "test.json";
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    // Creating a new allocator using various recording levels should always succeed.
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.MinMessageLevel =
+            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_MESSAGE);
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.MinMessageLevel =
+            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_INFO);
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.MinMessageLevel =
+            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_WARNING);
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.MinMessageLevel =
+            static_cast<ALLOCATOR_MESSAGE_SEVERITY>(ALLOCATOR_MESSAGE_SEVERITY_ERROR);
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+    }
+
+    // Creating resources while only sampling calls should always succeed, whether or not the
+    // call was sampled.
+    {
+        ALLOCATOR_DESC newDesc = desc;
+        newDesc.RecordOptions.CallSampleRate = 4;
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(newDesc, &allocator));
+        EXPECT_NE(allocator, nullptr);
+
+        std::vector<ComPtr<ResourceAllocation>> allocations(newDesc.RecordOptions.CallSampleRate);
+        for (ComPtr<ResourceAllocation>& allocation : allocations) {
+            ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(256u),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &allocation));
+            ASSERT_NE(allocation, nullptr);
+        }
+    }
+}
+
+// Exceeding the max resource heap size should always fail.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferOversized) {
+    constexpr uint64_t kOversizedBuffer = 32ll * 1024ll * 1024ll * 1024ll;  // 32GB
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_FAILED(mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kOversizedBuffer + 1),
+                                                    D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                    &allocation));
+    ASSERT_EQ(allocation, nullptr);
+}
+
+// Verifies buffers are allocated the same size as the device computes, even though their
+// allocation info is computed without it.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferAllocationInfo) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+    for (uint64_t width : {1ull, 64ull * 1024, 64ull * 1024 + 1, 3ull * 1024 * 1024 + 7}) {
+        for (uint64_t alignment : {0ull, 64ull * 1024}) {
+            D3D12_RESOURCE_DESC bufferDesc = CreateBasicBufferDesc(width);
+            bufferDesc.Alignment = alignment;
+
+            const D3D12_RESOURCE_ALLOCATION_INFO resourceInfo =
+                mDevice->GetResourceAllocationInfo(0, 1, &bufferDesc);
+
+            ComPtr<ResourceAllocation> allocation;
+            ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+                allocationDesc, bufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetSize(), resourceInfo.SizeInBytes);
+        }
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBuffer) {
+    // Creating a resource without allocation should always fail.
+    {
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, nullptr));
+    }
+
+    // Using the min resource heap size should always succeed.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        ASSERT_NE(allocation->GetResource(), nullptr);
+    }
+
+    // Mapping the entire buffer should always succeed.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        ASSERT_NE(allocation->GetResource(), nullptr);
+
+        ASSERT_SUCCEEDED(allocation->Map());
+    }
+
+    // Resource per heap type should always succeed if the heap type is allowed.
+    {
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
+    {
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_READBACK;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
+    {
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
+    {
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_CUSTOM;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    }
+
+    // Creating a zero sized buffer is not allowed.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicBufferDesc(0), D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_EQ(allocation, nullptr);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferAsync) {
+    constexpr uint32_t kNumOfBuffers = 8u;
+
+    std::vector<std::shared_ptr<ResourceAllocationEvent>> events = {};
+    for (uint32_t i = 0; i < kNumOfBuffers; i++) {
+        std::shared_ptr<ResourceAllocationEvent> event;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResourceAsync(
+            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &event));
+        ASSERT_NE(event, nullptr);
+        events.push_back(event);
+    }
+
+    for (auto& event : events) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(event->AcquireResourceAllocation(&allocation));
+        EXPECT_TRUE(event->IsSignaled());
         ASSERT_NE(allocation, nullptr);
         EXPECT_NE(allocation->GetResource(), nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+        // Resource allocation can only be acquired once.
+        ComPtr<ResourceAllocation> sameAllocation;
+        ASSERT_SUCCEEDED(event->AcquireResourceAllocation(&sameAllocation));
+        EXPECT_EQ(sameAllocation, nullptr);
     }
 
-    // Release the pooled resource heaps.
-    poolAllocator->Trim();
+    // Creating a resource without an event should always fail.
+    ASSERT_FAILED(mDefaultAllocator->CreateResourceAsync(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, nullptr));
 
-    // Create buffer of size A again with it's own resource heap from the empty pool.
+    // Creating an invalid resource fails when acquired.
     {
-        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
-        reusePoolOnlyDesc.Flags =
-            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        D3D12_RESOURCE_DESC badBufferDesc =
+            CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize);
+        badBufferDesc.Flags = static_cast<D3D12_RESOURCE_FLAGS>(0xFF);
+
+        std::shared_ptr<ResourceAllocationEvent> event;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResourceAsync(
+            {}, badBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, &event));
+
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(
-            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize),
-                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_FAILED(event->AcquireResourceAllocation(&allocation));
+        EXPECT_EQ(allocation, nullptr);
     }
+}
 
-    // Create buffer of size A again with it's own resource heap from the empty pool.
+TEST_F(D3D12ResourceAllocatorTests, CreateSmallTexture) {
+    // DXGI_FORMAT_R8G8B8A8_UNORM
     {
-        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
-        reusePoolOnlyDesc.Flags =
-            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
         ComPtr<ResourceAllocation> allocation;
-        ASSERT_FAILED(
-            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize / 2),
-                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_TRUE(
+            gpgmm::IsAligned(allocation->GetSize(),
+                             static_cast<uint32_t>(D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)));
     }
 
-    // Creating a new allocator using a misaligned max resource size for pooling should succeed.
+    // Small textures are sub-allocated in 4KB blocks of the same resource heap.
     {
-        ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
-        desc.MaxResourceSizeForPooling = 1023;
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+        EXPECT_EQ(firstAllocation->GetSize(), D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT);
+
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
+        ASSERT_NE(secondAllocation, nullptr);
+        EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+        EXPECT_NE(secondAllocation->GetOffset(), firstAllocation->GetOffset());
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateMultisampledTexture) {
+    // DXGI_FORMAT_R8G8B8A8_UNORM
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 4),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_TRUE(gpgmm::IsAligned(
+            allocation->GetSize(),
+            static_cast<uint32_t>(D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)));
+    }
+
+    // Multisampled textures are sub-allocated from other resource heaps than render targets
+    // which are not.
+    {
+        D3D12_RESOURCE_DESC renderTargetDesc =
+            CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1);
+        renderTargetDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+        ComPtr<ResourceAllocation> renderTargetAllocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource({}, renderTargetDesc,
+                                                           D3D12_RESOURCE_STATE_RENDER_TARGET,
+                                                           nullptr, &renderTargetAllocation));
+        ASSERT_NE(renderTargetAllocation, nullptr);
+        EXPECT_EQ(renderTargetAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+
+        ComPtr<ResourceAllocation> msaaAllocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 4),
+            D3D12_RESOURCE_STATE_RENDER_TARGET, nullptr, &msaaAllocation));
+        ASSERT_NE(msaaAllocation, nullptr);
+        EXPECT_EQ(msaaAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+        EXPECT_NE(msaaAllocation->GetMemory(), renderTargetAllocation->GetMemory());
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, ImportBuffer) {
+    // Importing a non-existent buffer should always fail.
+    ComPtr<ResourceAllocation> externalAllocation;
+    ASSERT_FAILED(mDefaultAllocator->CreateResource(nullptr, &externalAllocation));
+    ASSERT_EQ(externalAllocation, nullptr);
+
+    // Importing a buffer without returning the allocation should always fail.
+    ASSERT_FAILED(mDefaultAllocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, nullptr));
+
+    // Importing a buffer should always succeed.
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, &externalAllocation));
+    ASSERT_NE(externalAllocation, nullptr);
+
+    ComPtr<ResourceAllocation> internalAllocation;
+    ASSERT_SUCCEEDED(
+        mDefaultAllocator->CreateResource(externalAllocation->GetResource(), &internalAllocation));
+    ASSERT_NE(internalAllocation, nullptr);
+
+    // Underlying resource must stay the same.
+    ASSERT_EQ(internalAllocation->GetResource(), externalAllocation->GetResource());
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferInvalid) {
+    // Garbage buffer descriptor should always fail.
+    D3D12_RESOURCE_DESC badBufferDesc = CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize);
+    badBufferDesc.Flags = static_cast<D3D12_RESOURCE_FLAGS>(0xFF);
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_FAILED(mDefaultAllocator->CreateResource({}, badBufferDesc, D3D12_RESOURCE_STATE_COMMON,
+                                                    nullptr, &allocation));
+    ASSERT_EQ(allocation, nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferAlwaysCommitted) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags = ALLOCATOR_FLAG_ALWAYS_COMMITED;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(
+        allocator->CreateResource({}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+                                  D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetSize(), kDefaultPreferredResourceHeapSize);
+
+    // Commmitted resources cannot be backed by a D3D12 heap.
+    Heap* resourceHeap = ToBackend(allocation->GetMemory());
+    ASSERT_NE(resourceHeap, nullptr);
+    ASSERT_EQ(resourceHeap->GetHeap(), nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverAllocate) {
+    // Enabling pooling to recycle memory since sub-allocation could fail.
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.MaxResourceSizeForPooling = kDefaultPreferredResourceHeapSize;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    // Check we can't reuse memory if CreateResource was never called previously.
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_FAILED(allocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize + 1),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_EQ(allocation, nullptr);
+
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize / 8;
+
+    allocationDesc.Flags = ALLOCATION_FLAG_NONE;
+    ComPtr<ResourceAllocation> allocationA;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(bufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocationA));
+    ASSERT_NE(allocationA, nullptr);
+
+    // Allow the memory from |allocationA| to be recycled.
+    allocationA.Reset();
+
+    // Re-check that the same resource heap is used once CreateResource gets called.
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    ComPtr<ResourceAllocation> allocationB;
+    ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc, CreateBasicBufferDesc(bufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr, &allocationB));
+    ASSERT_NE(allocationB, nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferSuballocatedWithin) {
+    ALLOCATION_DESC desc = {};
+    desc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
+    desc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    constexpr uint32_t kSubAllocationSize = 4u;
+
+    // Create two tiny buffers that will be byte-aligned.
+    ComPtr<ResourceAllocation> tinyBufferAllocA;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+        &tinyBufferAllocA));
+    ASSERT_NE(tinyBufferAllocA, nullptr);
+    EXPECT_EQ(tinyBufferAllocA->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    EXPECT_EQ(tinyBufferAllocA->GetSize(), kSubAllocationSize);
+
+    ComPtr<ResourceAllocation> tinyBufferAllocB;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+        &tinyBufferAllocB));
+    ASSERT_NE(tinyBufferAllocB, nullptr);
+    EXPECT_EQ(tinyBufferAllocB->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    EXPECT_EQ(tinyBufferAllocB->GetSize(), kSubAllocationSize);
+
+    // Both buffers should be allocated in sequence, back-to-back.
+    EXPECT_EQ(tinyBufferAllocA->GetOffsetFromResource() + kSubAllocationSize,
+              tinyBufferAllocB->GetOffsetFromResource());
+
+    EXPECT_EQ(tinyBufferAllocA->GetResource(), tinyBufferAllocB->GetResource());
+
+    EXPECT_EQ(tinyBufferAllocA->GetGPUVirtualAddress() + kSubAllocationSize,
+              tinyBufferAllocB->GetGPUVirtualAddress());
+
+    // Mapping a resource allocation allocated within itself must use the entire resource.
+    ASSERT_FAILED(tinyBufferAllocA->Map(1));
+    ASSERT_FAILED(tinyBufferAllocB->Map(1));
+
+    // Create another using a new heap type, it must be given it's own resource.
+    desc.HeapType = D3D12_HEAP_TYPE_READBACK;
+
+    ComPtr<ResourceAllocation> tinyBufferAllocC;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        desc, CreateBasicBufferDesc(kSubAllocationSize), D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+        &tinyBufferAllocC));
+    ASSERT_NE(tinyBufferAllocC, nullptr);
+    EXPECT_EQ(tinyBufferAllocC->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    EXPECT_EQ(tinyBufferAllocC->GetSize(), kSubAllocationSize);
+    EXPECT_EQ(tinyBufferAllocC->GetOffsetFromResource(), 0u);
+    EXPECT_NE(tinyBufferAllocC->GetResource(), tinyBufferAllocA->GetResource());
+
+    // Write kSubAllocationSize worth of bytes with value 0xAA in mapped subAllocation A.
+    std::vector<uint8_t> dataAA(kSubAllocationSize, 0xAA);
+    void* mappedBufferA = nullptr;
+    ASSERT_SUCCEEDED(tinyBufferAllocA->Map(0, nullptr, &mappedBufferA));
+    memcpy(mappedBufferA, dataAA.data(), dataAA.size());
+
+    // Write kSubAllocationSize worth of bytes with value 0xBB in mapped subAllocation B.
+    std::vector<uint8_t> dataBB(kSubAllocationSize, 0xBB);
+    void* mappedBufferB = nullptr;
+    ASSERT_SUCCEEDED(tinyBufferAllocB->Map(0, nullptr, &mappedBufferB));
+    memcpy(mappedBufferB, dataBB.data(), dataBB.size());
+
+    EXPECT_NE(mappedBufferA, mappedBufferB);
+
+    // Map the entire buffer and check both allocated ranges.
+    void* mappedBuffer = nullptr;
+    ASSERT_SUCCEEDED(tinyBufferAllocB->GetResource()->Map(0, nullptr, &mappedBuffer));
+
+    const uint8_t* mappedByte = static_cast<uint8_t*>(mappedBuffer);
+    for (uint32_t i = 0; i < kSubAllocationSize; i++, mappedByte++) {
+        EXPECT_EQ(*mappedByte, 0xAA);
+    }
+
+    for (uint32_t i = 0; i < kSubAllocationSize; i++, mappedByte++) {
+        EXPECT_EQ(*mappedByte, 0xBB);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateLargeBufferSuballocatedWithin) {
+    constexpr uint64_t kLargeBufferSize = kDefaultPreferredResourceHeapSize * 4;
+
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.LargeBufferSize = kLargeBufferSize;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    ALLOCATION_DESC desc = {};
+    desc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
+    desc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    // Not a multiple of 64KB, which a placed resource would otherwise be rounded up to.
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT + 256;
+
+    ComPtr<ResourceAllocation> bufferAllocA;
+    ASSERT_SUCCEEDED(allocator->CreateResource(desc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                               &bufferAllocA));
+    ASSERT_NE(bufferAllocA, nullptr);
+    EXPECT_EQ(bufferAllocA->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    EXPECT_EQ(bufferAllocA->GetSize(), kBufferSize);
+
+    ComPtr<ResourceAllocation> bufferAllocB;
+    ASSERT_SUCCEEDED(allocator->CreateResource(desc, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                               &bufferAllocB));
+    ASSERT_NE(bufferAllocB, nullptr);
+    EXPECT_EQ(bufferAllocB->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+
+    // Both buffers share the same large buffer, back-to-back.
+    EXPECT_EQ(bufferAllocA->GetResource(), bufferAllocB->GetResource());
+    EXPECT_EQ(bufferAllocA->GetOffsetFromResource() + kBufferSize,
+              bufferAllocB->GetOffsetFromResource());
+    EXPECT_EQ(bufferAllocA->GetResource()->GetDesc().Width, kLargeBufferSize);
+
+    // Buffers with resource flags cannot be sub-allocated within the large buffer.
+    D3D12_RESOURCE_DESC uavBufferDesc = CreateBasicBufferDesc(kBufferSize);
+    uavBufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    desc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+    ComPtr<ResourceAllocation> uavBufferAlloc;
+    ASSERT_SUCCEEDED(allocator->CreateResource(desc, uavBufferDesc, D3D12_RESOURCE_STATE_COMMON,
+                                               nullptr, &uavBufferAlloc));
+    ASSERT_NE(uavBufferAlloc, nullptr);
+    EXPECT_NE(uavBufferAlloc->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferAlwaysMapped) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    allocationDesc.Flags = ALLOCATION_FLAG_ALWAYS_MAPPED;
+
+    // Every map returns the same pointer, even when unmapped in-between.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        ASSERT_NE(allocation->GetMappedPointer(), nullptr);
+
+        void* mappedData = nullptr;
+        ASSERT_SUCCEEDED(allocation->Map(0, nullptr, &mappedData));
+        EXPECT_EQ(mappedData, allocation->GetMappedPointer());
+        allocation->Unmap();
+
+        void* remappedData = nullptr;
+        ASSERT_SUCCEEDED(allocation->Map(0, nullptr, &remappedData));
+        EXPECT_EQ(remappedData, mappedData);
+
+        // Only subresource 0 is mapped.
+        ASSERT_FAILED(allocation->Map(1, nullptr, &remappedData));
+    }
+
+    // Mapped pointer of a buffer within a resource starts from the allocation.
+    {
+        allocationDesc.Flags |= ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
+
+        ComPtr<ResourceAllocation> allocationA;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(64), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+            &allocationA));
+        ASSERT_NE(allocationA, nullptr);
+
+        ComPtr<ResourceAllocation> allocationB;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(64), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+            &allocationB));
+        ASSERT_NE(allocationB, nullptr);
+
+        if (allocationA->GetResource() == allocationB->GetResource()) {
+            EXPECT_EQ(allocationB->GetMappedPointer() - allocationA->GetMappedPointer(),
+                      static_cast<ptrdiff_t>(allocationB->GetOffsetFromResource() -
+                                             allocationA->GetOffsetFromResource()));
+        }
+    }
+
+    // Default heaps cannot be mapped.
+    {
+        allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_EQ(allocation, nullptr);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferWriteData) {
+    constexpr uint64_t kBufferSize = 1024u;
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    std::vector<uint8_t> data(kBufferSize);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    // Written data is visible once mapped, whether or not the allocation is persistently mapped.
+    for (ALLOCATION_FLAGS flags : {ALLOCATION_FLAG_NONE, ALLOCATION_FLAG_ALWAYS_MAPPED}) {
+        allocationDesc.Flags = flags;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kBufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+
+        ASSERT_SUCCEEDED(allocation->WriteData(0, data.data(), data.size()));
+        ASSERT_SUCCEEDED(allocation->WriteData(1, data.data(), 3));
+
+        void* mappedData = nullptr;
+        ASSERT_SUCCEEDED(allocation->Map(0, nullptr, &mappedData));
+        const uint8_t* mappedBytes = static_cast<const uint8_t*>(mappedData);
+        EXPECT_EQ(mappedBytes[0], data[0]);
+        EXPECT_EQ(memcmp(mappedBytes + 1, data.data(), 3), 0);
+        EXPECT_EQ(memcmp(mappedBytes + 4, data.data() + 4, data.size() - 4), 0);
+        allocation->Unmap();
+
+        // Writes cannot go past the end of the buffer.
+        ASSERT_FAILED(allocation->WriteData(1, data.data(), data.size()));
+        ASSERT_FAILED(allocation->WriteData(kBufferSize + 1, data.data(), 0));
+        ASSERT_FAILED(allocation->WriteData(0, nullptr, 1));
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, UploadManager) {
+    constexpr uint64_t kStagingBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    constexpr uint64_t kBufferSize = kStagingBufferSize * 4;
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    ComPtr<ID3D12CommandQueue> queue;
+    ASSERT_SUCCEEDED(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+
+    UPLOAD_MANAGER_DESC uploadManagerDesc = {};
+    uploadManagerDesc.Allocator = mDefaultAllocator.Get();
+    uploadManagerDesc.CommandQueue = queue.Get();
+    uploadManagerDesc.StagingBufferSize = kStagingBufferSize;
+
+    ComPtr<UploadManager> uploadManager;
+    ASSERT_SUCCEEDED(UploadManager::CreateUploadManager(uploadManagerDesc, &uploadManager));
+    ASSERT_NE(uploadManager, nullptr);
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &allocation));
+    ASSERT_NE(allocation, nullptr);
+
+    std::vector<uint8_t> data(kStagingBufferSize / 2, 0xAA);
+
+    // Nothing recorded, nothing submitted.
+    uint64_t fenceValue = 0;
+    ASSERT_SUCCEEDED(uploadManager->Submit(&fenceValue));
+    EXPECT_EQ(fenceValue, 0u);
+
+    // Uploading more than the staging buffer waits for earlier uploads to complete.
+    for (uint64_t offset = 0; offset < kBufferSize; offset += data.size()) {
+        ASSERT_SUCCEEDED(
+            uploadManager->UploadBuffer(allocation.Get(), offset, data.data(), data.size()));
+    }
+
+    ASSERT_SUCCEEDED(uploadManager->Submit(&fenceValue));
+    EXPECT_GT(fenceValue, 0u);
+
+    ASSERT_SUCCEEDED(uploadManager->WaitFor(fenceValue));
+    EXPECT_GE(uploadManager->GetCompletedFenceValue(), fenceValue);
+
+    // Uploads cannot be larger than the staging buffer.
+    std::vector<uint8_t> largeData(kStagingBufferSize + 1);
+    ASSERT_FAILED(uploadManager->UploadBuffer(allocation.Get(), 0, largeData.data(),
+                                              largeData.size()));
+    ASSERT_FAILED(uploadManager->UploadBuffer(allocation.Get(), 0, nullptr, data.size()));
+
+    ID3D12Resource* nullResource = nullptr;
+    ASSERT_FAILED(uploadManager->UploadBuffer(nullResource, 0, data.data(), data.size()));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, ReadbackManager) {
+    constexpr uint64_t kStagingBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    constexpr uint64_t kBufferSize = kStagingBufferSize;
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    ComPtr<ID3D12CommandQueue> queue;
+    ASSERT_SUCCEEDED(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+
+    UPLOAD_MANAGER_DESC uploadManagerDesc = {};
+    uploadManagerDesc.Allocator = mDefaultAllocator.Get();
+    uploadManagerDesc.CommandQueue = queue.Get();
+
+    ComPtr<UploadManager> uploadManager;
+    ASSERT_SUCCEEDED(UploadManager::CreateUploadManager(uploadManagerDesc, &uploadManager));
+
+    READBACK_MANAGER_DESC readbackManagerDesc = {};
+    readbackManagerDesc.Allocator = mDefaultAllocator.Get();
+    readbackManagerDesc.CommandQueue = queue.Get();
+    readbackManagerDesc.StagingBufferSize = kStagingBufferSize;
+
+    ComPtr<ReadbackManager> readbackManager;
+    ASSERT_SUCCEEDED(
+        ReadbackManager::CreateReadbackManager(readbackManagerDesc, &readbackManager));
+    ASSERT_NE(readbackManager, nullptr);
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &allocation));
+    ASSERT_NE(allocation, nullptr);
+
+    std::vector<uint8_t> data(kBufferSize / 2, 0xAA);
+    ASSERT_SUCCEEDED(uploadManager->UploadBuffer(allocation.Get(), 0, data.data(), data.size()));
+    ASSERT_SUCCEEDED(uploadManager->Submit());
+
+    // Copies on the same queue execute in order, so the readback sees the upload.
+    std::shared_ptr<ReadbackEvent> readbackEvent;
+    ASSERT_SUCCEEDED(
+        readbackManager->ReadbackBuffer(allocation.Get(), 0, data.size(), &readbackEvent));
+    ASSERT_NE(readbackEvent, nullptr);
+    EXPECT_FALSE(readbackEvent->IsSignaled());
+
+    // Signaled once submitted and copied, without the caller waiting on the fence.
+    uint64_t fenceValue = 0;
+    ASSERT_SUCCEEDED(readbackManager->Submit(&fenceValue));
+    EXPECT_GT(fenceValue, 0u);
+
+    const uint8_t* readbackData = static_cast<const uint8_t*>(readbackEvent->GetData());
+    ASSERT_NE(readbackData, nullptr);
+    EXPECT_TRUE(readbackEvent->IsSignaled());
+    EXPECT_EQ(readbackEvent->GetSize(), data.size());
+    EXPECT_EQ(std::vector<uint8_t>(readbackData, readbackData + data.size()), data);
+    EXPECT_GE(readbackManager->GetCompletedFenceValue(), fenceValue);
+
+    // Staging space is only re-used once the readback was released.
+    std::shared_ptr<ReadbackEvent> otherReadbackEvent;
+    ASSERT_SUCCEEDED(readbackManager->ReadbackBuffer(allocation.Get(), 0, data.size(),
+                                                     &otherReadbackEvent));
+    ASSERT_FAILED(readbackManager->ReadbackBuffer(allocation.Get(), 0, data.size(),
+                                                  &otherReadbackEvent));
+
+    readbackEvent = nullptr;
+    otherReadbackEvent = nullptr;
+    ASSERT_SUCCEEDED(readbackManager->ReadbackBuffer(allocation.Get(), 0, data.size(),
+                                                     &readbackEvent));
+    ASSERT_SUCCEEDED(readbackManager->Submit());
+    ASSERT_NE(readbackEvent->GetData(), nullptr);
+    readbackEvent = nullptr;
+
+    // Readbacks cannot be larger than the staging buffer.
+    ASSERT_FAILED(readbackManager->ReadbackBuffer(allocation.Get(), 0, kStagingBufferSize + 1,
+                                                  &readbackEvent));
+
+    ID3D12Resource* nullResource = nullptr;
+    ASSERT_FAILED(readbackManager->ReadbackBuffer(nullResource, 0, data.size(), &readbackEvent));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferTransient) {
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.TransientBufferSize = kDefaultPreferredResourceHeapSize;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    constexpr uint64_t kBufferSize = 256u;
+    constexpr uint64_t kNumOfFrames = 3u;
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    allocationDesc.Flags = ALLOCATION_FLAG_TRANSIENT;
+
+    // Every transient buffer of a frame is linearly allocated from the same resource.
+    ID3D12Resource* transientResource = nullptr;
+    uint64_t offsetFromResource = 0;
+    for (uint64_t frame = 1; frame <= kNumOfFrames; frame++) {
+        allocationDesc.FenceValue = frame;
+
+        for (uint32_t i = 0; i < 4; i++) {
+            ComPtr<ResourceAllocation> allocation;
+            ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                       &allocation));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+            EXPECT_EQ(allocation->GetOffsetFromResource(), offsetFromResource);
+
+            if (transientResource == nullptr) {
+                transientResource = allocation->GetResource();
+            }
+            EXPECT_EQ(allocation->GetResource(), transientResource);
+
+            ASSERT_SUCCEEDED(allocation->Map());
+            allocation->Unmap();
+
+            offsetFromResource += kBufferSize;
+        }
+
+        allocator->RetireTransientMemory(frame - 1);
+    }
+
+    // Once every frame retired, allocations start again from the front.
+    allocator->RetireTransientMemory(kNumOfFrames);
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(allocationDesc,
+                                                   CreateBasicBufferDesc(kBufferSize),
+                                                   D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                   &allocation));
+        EXPECT_EQ(allocation->GetOffsetFromResource(), 0u);
+    }
+
+    // Larger than the transient buffer falls back to a regular allocation.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize * 2),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        EXPECT_NE(allocation->GetResource(), transientResource);
+    }
+
+    allocator->RetireTransientMemory(kNumOfFrames + 1);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CaptureSnapshot) {
+    // Snapshots require live allocations to be tracked.
+    {
+        ALLOCATOR_SNAPSHOT snapshot = {};
+        ASSERT_FAILED(mDefaultAllocator->CaptureSnapshot(&snapshot));
+    }
+
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.Flags |= ALLOCATOR_FLAG_TRACK_LIVE_ALLOCATIONS;
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+
+    ALLOCATOR_SNAPSHOT emptySnapshot = {};
+    ASSERT_SUCCEEDED(allocator->CaptureSnapshot(&emptySnapshot));
+    EXPECT_TRUE(emptySnapshot.Allocations.empty());
+    EXPECT_EQ(emptySnapshot.SizeInBytes, 0u);
+
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &firstAllocation));
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &secondAllocation));
+
+    ALLOCATOR_SNAPSHOT snapshot = {};
+    ASSERT_SUCCEEDED(allocator->CaptureSnapshot(&snapshot));
+    ASSERT_EQ(snapshot.Allocations.size(), 2u);
+    EXPECT_EQ(snapshot.SizeInBytes, firstAllocation->GetSize() + secondAllocation->GetSize());
+    EXPECT_EQ(snapshot.Allocations[0].HeapType, D3D12_HEAP_TYPE_DEFAULT);
+
+    ALLOCATOR_SNAPSHOT_DIFF diff = ResourceAllocator::DiffSnapshots(emptySnapshot, snapshot);
+    EXPECT_EQ(diff.AddedAllocations.size(), 2u);
+    EXPECT_TRUE(diff.RemovedAllocations.empty());
+    EXPECT_EQ(diff.SizeInBytesDelta, static_cast<int64_t>(snapshot.SizeInBytes));
+
+    const uint64_t secondAllocationSize = secondAllocation->GetSize();
+    secondAllocation = nullptr;
+
+    ALLOCATOR_SNAPSHOT lastSnapshot = {};
+    ASSERT_SUCCEEDED(allocator->CaptureSnapshot(&lastSnapshot));
+    ASSERT_EQ(lastSnapshot.Allocations.size(), 1u);
+
+    diff = ResourceAllocator::DiffSnapshots(snapshot, lastSnapshot);
+    EXPECT_TRUE(diff.AddedAllocations.empty());
+    ASSERT_EQ(diff.RemovedAllocations.size(), 1u);
+    EXPECT_EQ(diff.RemovedAllocations[0].SizeInBytes, secondAllocationSize);
+    EXPECT_EQ(diff.SizeInBytesDelta, -static_cast<int64_t>(secondAllocationSize));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, ReleaseAfterFenceValue) {
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    ResourceAllocation* firstAllocation = nullptr;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &firstAllocation));
+
+    ResourceAllocation* secondAllocation = nullptr;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &secondAllocation));
+
+    const uint64_t usedBlockUsage = allocator->QueryInfo().UsedBlockUsage;
+
+    allocator->ReleaseAfter(secondAllocation, 2);
+    allocator->ReleaseAfter(firstAllocation, 1);
+
+    // Nothing is released before the fence value completes.
+    allocator->RetireTransientMemory(0);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockUsage, usedBlockUsage);
+
+    // Released in fence order, regardless of the order given.
+    allocator->RetireTransientMemory(1);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockUsage, usedBlockUsage - kBufferSize);
+
+    allocator->RetireTransientMemory(2);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockUsage, usedBlockUsage - kBufferSize * 2);
+
+    // Pending releases are released once the allocator is destroyed.
+    ResourceAllocation* thirdAllocation = nullptr;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &thirdAllocation));
+    allocator->ReleaseAfter(thirdAllocation, 3);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, BeginAndEndFrame) {
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    // Frames must be begun before being ended, and ended before the next is begun.
+    ASSERT_FAILED(allocator->EndFrame());
+    ASSERT_SUCCEEDED(allocator->BeginFrame(0));
+    ASSERT_FAILED(allocator->BeginFrame(0));
+
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &allocation));
+    allocator->ReleaseAfter(allocation, 1);
+
+    FRAME_STATS frameStats = {};
+    ASSERT_SUCCEEDED(allocator->EndFrame(&frameStats));
+    EXPECT_EQ(frameStats.FrameIndex, 1u);
+    EXPECT_EQ(frameStats.AllocationCount, 1u);
+    EXPECT_EQ(frameStats.AllocationSizeInBytes, kBufferSize);
+    EXPECT_EQ(frameStats.ReleasedCount, 0u);
+
+    // Beginning the next frame releases the allocation once its fence value completed, and
+    // counters start over.
+    ASSERT_SUCCEEDED(allocator->BeginFrame(1));
+    ASSERT_SUCCEEDED(allocator->EndFrame(&frameStats));
+    EXPECT_EQ(frameStats.FrameIndex, 2u);
+    EXPECT_EQ(frameStats.AllocationCount, 0u);
+    EXPECT_EQ(frameStats.ReleasedCount, 1u);
+    EXPECT_EQ(frameStats.ReleasedSizeInBytes, kBufferSize);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, BeginFrameTrim) {
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.MaxResourceSizeForPooling = bufferSize;
+    allocatorDesc.FrameTrimTimeInSeconds = std::numeric_limits<double>::max();
+
+    ComPtr<ResourceAllocator> poolAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
+
+    ALLOCATION_DESC standaloneAllocationDesc = {};
+    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+    standaloneAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    // The first frame creates two resources, one at a time, so a single resource heap is pooled.
+    ASSERT_SUCCEEDED(poolAllocator->BeginFrame(0));
+    for (uint32_t i = 0; i < 2; i++) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(bufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+    ASSERT_SUCCEEDED(poolAllocator->EndFrame());
+
+    // Pooled memory is kept for as many allocations as the previous frame made.
+    FRAME_STATS frameStats = {};
+    ASSERT_SUCCEEDED(poolAllocator->BeginFrame(0));
+    ASSERT_SUCCEEDED(poolAllocator->EndFrame(&frameStats));
+    EXPECT_EQ(frameStats.TrimmedSizeInBytes, 0u);
+
+    // Nothing was allocated by the previous frame, so every pooled resource heap is released.
+    ASSERT_SUCCEEDED(poolAllocator->BeginFrame(0));
+    ASSERT_SUCCEEDED(poolAllocator->EndFrame(&frameStats));
+    EXPECT_GT(frameStats.TrimmedSizeInBytes, 0u);
+    EXPECT_EQ(poolAllocator->QueryInfo().FreeMemoryUsage, 0u);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverSubAllocated) {
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize / 2;
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+    ComPtr<ResourceAllocation> subAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(bufferSize), D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr, &subAllocation));
+    ASSERT_NE(subAllocation, nullptr);
+    EXPECT_NE(subAllocation->GetResource(), nullptr);
+    EXPECT_NE(subAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferNeverPooled) {
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.Flags |= ALLOCATOR_FLAG_ALWAYS_ON_DEMAND;
+
+    ComPtr<ResourceAllocator> resourceAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
+    ASSERT_NE(resourceAllocator, nullptr);
+
+    ALLOCATION_DESC baseAllocationDesc = {};
+    baseAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+
+    // Create the first buffer.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            baseAllocationDesc, CreateBasicBufferDesc(bufferSize * 2),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Check the first buffer was not pool-allocated by creating it again.
+    {
+        ALLOCATION_DESC allocationDesc = baseAllocationDesc;
+        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(resourceAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(bufferSize * 2),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+
+    // Create another buffer.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            baseAllocationDesc, CreateBasicBufferDesc(bufferSize * 3),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Check the second buffer was not pool-allocated by creating it again.
+    {
+        ALLOCATION_DESC allocationDesc = baseAllocationDesc;
+        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(resourceAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(bufferSize * 3),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+}
+
+// Verifies resource heap tier 2 shares a pool of resource heaps between allocators.
+TEST_F(D3D12ResourceAllocatorTests, CreateTexturePooledSharedByHeapType) {
+    if (mResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2) {
+        return;
+    }
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    // Create texture with it's own resource heap that will be returned to the pool.
+    {
+        ALLOCATION_DESC standaloneAllocationDesc = {};
+        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            standaloneAllocationDesc,
+            CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1024, 1024),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+        EXPECT_EQ(allocation->GetMemory()->GetSize(), kDefaultPreferredResourceHeapSize);
+    }
+
+    EXPECT_EQ(allocator->QueryInfo().FreeMemoryUsage, kDefaultPreferredResourceHeapSize);
+
+    // Sub-allocate a texture from the resource heap in the pool.
+    {
+        ALLOCATION_DESC reusePoolOnlyDesc = {};
+        reusePoolOnlyDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            reusePoolOnlyDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 256, 256),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+        EXPECT_EQ(allocator->QueryInfo().FreeMemoryUsage, 0u);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferPooled) {
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.MaxResourceSizeForPooling = bufferSize;
+
+    ComPtr<ResourceAllocator> poolAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
+    ASSERT_NE(poolAllocator, nullptr);
+
+    // Only standalone allocations can be pool-allocated.
+    ALLOCATION_DESC standaloneAllocationDesc = {};
+    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+    standaloneAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    // Create buffer of size A with it's own resource heap that will be returned to the pool.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(bufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Create buffer of size B with it's own resource heap that will be returned to the pool.
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(bufferSize / 2),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Create buffer of size A again with it's own resource heap from the pool.
+    {
+        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+        reusePoolOnlyDesc.Flags =
+            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Create buffer of size B again with it's own resource heap from the pool.
+    {
+        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+        reusePoolOnlyDesc.Flags =
+            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize / 2),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_NE(allocation->GetResource(), nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Release the pooled resource heaps.
+    poolAllocator->Trim();
+
+    // Create buffer of size A again with it's own resource heap from the empty pool.
+    {
+        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+        reusePoolOnlyDesc.Flags =
+            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+
+    // Create buffer of size A again with it's own resource heap from the empty pool.
+    {
+        ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+        reusePoolOnlyDesc.Flags =
+            standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize / 2),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+
+    // Creating a new allocator using a misaligned max resource size for pooling should succeed.
+    {
+        ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+        desc.MaxResourceSizeForPooling = 1023;
+
+        ComPtr<ResourceAllocator> allocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+        ASSERT_NE(allocator, nullptr);
+
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(
+            allocator->CreateResource(standaloneAllocationDesc, CreateBasicBufferDesc(1024),
+                                      D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferPooledTrimIncremental) {
+    constexpr uint64_t bufferSize = kDefaultPreferredResourceHeapSize;
+
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.MaxResourceSizeForPooling = bufferSize;
+
+    ComPtr<ResourceAllocator> poolAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
+    ASSERT_NE(poolAllocator, nullptr);
+
+    ALLOCATION_DESC standaloneAllocationDesc = {};
+    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+    standaloneAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    // Return a resource heap of size A, then of size B, to the pool.
+    for (uint64_t size : {bufferSize, bufferSize / 2}) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(size),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+    }
+
+    // Nothing can be released without any time to do so.
+    EXPECT_EQ(poolAllocator->Trim(std::numeric_limits<uint64_t>::max(), 0), 0u);
+
+    // Releasing a single byte only releases the least recently used resource heap, A.
+    EXPECT_EQ(poolAllocator->Trim(1, std::numeric_limits<double>::max()), bufferSize);
+
+    ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+    reusePoolOnlyDesc.Flags =
+        standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+    {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(
+            poolAllocator->CreateResource(reusePoolOnlyDesc, CreateBasicBufferDesc(bufferSize / 2),
+                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
+    }
+
+    // Release what remains in the pool.
+    EXPECT_EQ(poolAllocator->Trim(std::numeric_limits<uint64_t>::max(),
+                                  std::numeric_limits<double>::max()),
+              bufferSize / 2);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferQueryInfo) {
+    // Calculate info for a single standalone allocation.
+    {
+        ComPtr<ResourceAllocator> resourceAllocator;
+        ASSERT_SUCCEEDED(
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+        ASSERT_NE(resourceAllocator, nullptr);
+
+        ALLOCATION_DESC standaloneAllocationDesc = {};
+        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 1u);
+        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+    }
+
+    // Calculate info for two pooled standalone allocations.
+    {
+        ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+        allocatorDesc.MaxResourceSizeForPooling = kDefaultPreferredResourceHeapSize;
+
+        ComPtr<ResourceAllocator> resourceAllocator;
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
+        ASSERT_NE(resourceAllocator, nullptr);
+
+        ALLOCATION_DESC standaloneAllocationDesc = {};
+        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 1u);
+        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
+        ASSERT_NE(secondAllocation, nullptr);
+        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+        info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 2u);
+        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize * 2);
+    }
+
+    // Calculate info for two sub-allocations.
+    {
+        ComPtr<ResourceAllocator> resourceAllocator;
+        ASSERT_SUCCEEDED(
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+        ASSERT_NE(resourceAllocator, nullptr);
+
+        constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 8;
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                           D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                           nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+
+        // Depending on the device, sub-allocation could fail. Since this test relies on a
+        // sub-allocator's info counts, it must be skipped.
+        // TODO: Consider testing counts by allocator type.
+        GPGMM_SKIP_TEST_IF(firstAllocation->GetMethod() != gpgmm::AllocationMethod::kSubAllocated);
+
+        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 1u);
+        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+        EXPECT_EQ(info.UsedBlockCount, 1u);
+        EXPECT_GE(info.UsedBlockUsage, kBufferSize);
+
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                                           D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                           nullptr, &secondAllocation));
+        ASSERT_NE(secondAllocation, nullptr);
+        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+
+        info = resourceAllocator->QueryInfo();
+        EXPECT_GE(info.UsedMemoryCount, 1u);
+        EXPECT_GE(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+        EXPECT_EQ(info.UsedBlockCount, 2u);
+        EXPECT_GE(info.UsedBlockUsage, kBufferSize * 2);
+    }
+
+    // Calculate info for two sub-allocations within the same resource.
+    {
+        ComPtr<ResourceAllocator> resourceAllocator;
+        ASSERT_SUCCEEDED(
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+        ASSERT_NE(resourceAllocator, nullptr);
+
+        ALLOCATION_DESC allocationWithinDesc = {};
+        allocationWithinDesc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
+        allocationWithinDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        constexpr uint32_t kBufferSize = 4u;  // Must less than 64KB
+
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            allocationWithinDesc, CreateBasicBufferDesc(kBufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+
+        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 1u);
+        EXPECT_EQ(info.UsedMemoryUsage, 64u * 1024u);
+        EXPECT_EQ(info.UsedBlockCount, 1u);
+        EXPECT_EQ(info.UsedBlockUsage, kBufferSize);
+
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+            allocationWithinDesc, CreateBasicBufferDesc(kBufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
+        ASSERT_NE(secondAllocation, nullptr);
+        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+
+        info = resourceAllocator->QueryInfo();
+        EXPECT_EQ(info.UsedMemoryCount, 1u);
+        EXPECT_EQ(info.UsedMemoryUsage, 64u * 1024u);
+        EXPECT_EQ(info.UsedBlockCount, 2u);
+        EXPECT_EQ(info.UsedBlockUsage, kBufferSize * 2);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateTexturePooled) {
+    ComPtr<ResourceAllocator> poolAllocator;
+    {
+        ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+        allocatorDesc.MaxResourceSizeForPooling = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+
+        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
+        ASSERT_NE(poolAllocator, nullptr);
+    }
+
+    // Only standalone allocations can be pool-allocated.
+    ALLOCATION_DESC standaloneAllocationDesc = {};
+    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+    // Create a small texture of size A with it's own resource heap that will be returned to the
+    // pool.
+    {
+        ComPtr<ResourceAllocation> firstAllocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            standaloneAllocationDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
+        ASSERT_NE(firstAllocation, nullptr);
+        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
+    reusePoolOnlyDesc.Flags =
+        standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+    // Check the first small texture of size A was pool-allocated by creating it again.
+    {
+        ComPtr<ResourceAllocation> secondAllocation;
+        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
+            reusePoolOnlyDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
+        ASSERT_NE(secondAllocation, nullptr);
+        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    }
+
+    // Check the first small texture of size A cannot be reused when creating a larger texture of
+    // size B.
+    {
+        ComPtr<ResourceAllocation> thirdAllocation;
+        ASSERT_FAILED(poolAllocator->CreateResource(
+            reusePoolOnlyDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 128, 128),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &thirdAllocation));
+        ASSERT_EQ(thirdAllocation, nullptr);
+    }
+}
+
+// Creates a bunch of small buffers using the smallest size allowed so GPU memory is pre-fetched.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferPrefetch) {
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(
+        CreateBasicAllocatorDesc(/*enablePrefetch*/ true), &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    constexpr uint64_t kNumOfBuffers = 1000u;
+
+    std::set<ComPtr<ResourceAllocation>> allocs = {};
+    for (uint64_t i = 0; i < kNumOfBuffers; i++) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicBufferDesc(1), D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_NE(allocation, nullptr);
+        allocs.insert(allocation);
+    }
+
+    allocs.clear();
+}
+
+// Creates a bunch of buffers concurrently.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferManyThreaded) {
+    ComPtr<ResourceAllocator> resourceAllocator;
+    ASSERT_SUCCEEDED(
+        ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+    ASSERT_NE(resourceAllocator, nullptr);
+
+    constexpr uint32_t kThreadCount = 64u;
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
+        threads[threadIdx] = std::thread([&]() {
+            ComPtr<ResourceAllocation> allocation;
+            ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+                {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+                D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+            ASSERT_NE(allocation, nullptr);
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// Creates buffers concurrently, each thread sub-allocating from its own shard.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferManyThreadedSharded) {
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.SubAllocatorShardCount = 4;
+
+    ComPtr<ResourceAllocator> resourceAllocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &resourceAllocator));
+    ASSERT_NE(resourceAllocator, nullptr);
+
+    constexpr uint32_t kThreadCount = 16u;
+    constexpr uint32_t kAllocationCountPerThread = 8u;
+    std::vector<std::vector<ComPtr<ResourceAllocation>>> allocationsPerThread(kThreadCount);
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
+        threads[threadIdx] = std::thread([&, threadIdx]() {
+            for (uint32_t i = 0; i < kAllocationCountPerThread; i++) {
+                ComPtr<ResourceAllocation> allocation;
+                ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
+                    {}, CreateBasicBufferDesc(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+                    D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+                ASSERT_NE(allocation, nullptr);
+                EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+                allocationsPerThread[threadIdx].push_back(std::move(allocation));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Blocks of every shard are counted.
+    EXPECT_EQ(resourceAllocator->QueryInfo().UsedBlockCount,
+              kThreadCount * kAllocationCountPerThread);
+
+    // Released by a thread other than the one which created them.
+    allocationsPerThread.clear();
+}
+
+// Creates buffers and textures of various sizes in a single batch.
+TEST_F(D3D12ResourceAllocatorTests, CreateResources) {
+    const ALLOCATION_DESC allocationDescs[] = {{}, {}, {}, {}};
+    const D3D12_RESOURCE_DESC resourceDescs[] = {
+        CreateBasicBufferDesc(1),
+        CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 128, 128),
+        CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        CreateBasicBufferDesc(0),  // Invalid
+    };
+    const D3D12_RESOURCE_STATES initialResourceStates[] = {
+        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_COMMON};
+
+    constexpr uint32_t kNumOfResources = 4u;
+
+    ResourceAllocation* allocations[kNumOfResources] = {};
+    HRESULT results[kNumOfResources] = {};
+    const HRESULT hr = mDefaultAllocator->CreateResources(kNumOfResources, allocationDescs,
+                                                          resourceDescs, initialResourceStates,
+                                                          /*clearValues*/ nullptr, allocations,
+                                                          results);
+    ASSERT_FAILED(hr);
+
+    // Partial failures should still return the resources that could be created.
+    for (uint32_t i = 0; i < kNumOfResources - 1; i++) {
+        EXPECT_TRUE(SUCCEEDED(results[i]));
+        ASSERT_NE(allocations[i], nullptr);
+        EXPECT_GE(allocations[i]->GetSize(), resourceDescs[i].Width);
+    }
+
+    EXPECT_TRUE(FAILED(results[kNumOfResources - 1]));
+    EXPECT_EQ(allocations[kNumOfResources - 1], nullptr);
+
+    // The failure returned is the first by the order requested.
+    EXPECT_EQ(hr, results[kNumOfResources - 1]);
+
+    for (ResourceAllocation* allocation : allocations) {
+        if (allocation != nullptr) {
+            allocation->Release();
+        }
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateAliasedResources) {
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 4;
+    constexpr uint32_t kNumOfResources = 3u;
+
+    const D3D12_RESOURCE_DESC resourceDescs[] = {
+        CreateBasicBufferDesc(kBufferSize),
+        CreateBasicBufferDesc(kBufferSize),
+        CreateBasicBufferDesc(kBufferSize),
+    };
+    const D3D12_RESOURCE_STATES initialResourceStates[] = {
+        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON};
+
+    // First and second buffer are never used at the same time, unlike the third.
+    const RESOURCE_LIFETIME_DESC lifetimes[] = {{0, 1}, {2, 3}, {0, 3}};
+
+    ResourceAllocation* allocations[kNumOfResources] = {};
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateAliasedResources(
+        kNumOfResources, {}, resourceDescs, initialResourceStates, /*clearValues*/ nullptr,
+        lifetimes, allocations));
+
+    for (ResourceAllocation* allocation : allocations) {
+        ASSERT_NE(allocation, nullptr);
+        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+        EXPECT_EQ(allocation->GetMemory(), allocations[0]->GetMemory());
+    }
+
+    EXPECT_EQ(allocations[0]->GetOffset(), allocations[1]->GetOffset());
+    EXPECT_NE(allocations[0]->GetOffset(), allocations[2]->GetOffset());
+
+    // Only two of the buffers need memory at once.
+    EXPECT_EQ(allocations[0]->GetMemory()->GetSize(), kBufferSize * 2);
+
+    for (ResourceAllocation* allocation : allocations) {
+        allocation->Release();
+    }
+
+    // Lifetime must begin before it ends. Resources are all created or none are.
+    const RESOURCE_LIFETIME_DESC invalidLifetimes[] = {{0, 1}, {3, 2}, {0, 3}};
+    ASSERT_FAILED(mDefaultAllocator->CreateAliasedResources(
+        kNumOfResources, {}, resourceDescs, initialResourceStates, /*clearValues*/ nullptr,
+        invalidLifetimes, allocations));
+
+    for (ResourceAllocation* allocation : allocations) {
+        EXPECT_EQ(allocation, nullptr);
+    }
+}
+
+TEST_F(D3D12ResourceAllocatorTests, AllocateMemory) {
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 4;
+
+    D3D12_RESOURCE_ALLOCATION_INFO resourceInfo = {};
+    resourceInfo.SizeInBytes = kBufferSize;
+    resourceInfo.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    // Memory cannot be allocated without knowing the resource on resource heap tier 1.
+    if (mResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->AllocateMemory({}, resourceInfo, &allocation));
+        return;
+    }
+
+    // Memory is sub-allocated like any placed resource, but without one.
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->AllocateMemory({}, resourceInfo, &firstAllocation));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+    EXPECT_EQ(firstAllocation->GetResource(), nullptr);
+    EXPECT_NE(firstAllocation->GetMemory(), nullptr);
+    EXPECT_GE(firstAllocation->GetSize(), kBufferSize);
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->AllocateMemory({}, resourceInfo, &secondAllocation));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+    EXPECT_NE(secondAllocation->GetOffset(), firstAllocation->GetOffset());
+
+    // Nothing to map.
+    ASSERT_FAILED(firstAllocation->Map());
+
+    // App places its own resources in the memory, as many times as needed.
+    ComPtr<ID3D12Heap> heap;
+    ASSERT_SUCCEEDED(ToBackend(firstAllocation->GetMemory())->GetPageable().As(&heap));
+
+    const D3D12_RESOURCE_DESC bufferDesc = CreateBasicBufferDesc(kBufferSize);
+    for (uint32_t i = 0; i < 2; i++) {
+        ComPtr<ID3D12Resource> placedResource;
+        ASSERT_SUCCEEDED(mDevice->CreatePlacedResource(
+            heap.Get(), firstAllocation->GetOffset(), &bufferDesc, D3D12_RESOURCE_STATE_COMMON,
+            nullptr, IID_PPV_ARGS(&placedResource)));
+    }
+
+    // Flags which need a resource are invalid.
+    ALLOCATION_DESC mappedAllocationDesc = {};
+    mappedAllocationDesc.Flags = ALLOCATION_FLAG_ALWAYS_MAPPED;
+    mappedAllocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    ComPtr<ResourceAllocation> invalidAllocation;
+    ASSERT_FAILED(
+        mDefaultAllocator->AllocateMemory(mappedAllocationDesc, resourceInfo, &invalidAllocation));
+
+    // Too large to be sub-allocated, so the memory is in its own resource heap.
+    ALLOCATION_DESC standaloneAllocationDesc = {};
+    standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+
+    ComPtr<ResourceAllocation> standaloneAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->AllocateMemory(standaloneAllocationDesc, resourceInfo,
+                                                       &standaloneAllocation));
+    ASSERT_NE(standaloneAllocation, nullptr);
+    EXPECT_EQ(standaloneAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    EXPECT_EQ(standaloneAllocation->GetResource(), nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, AllocateMemoryTryExtend) {
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 4;
+
+    // Memory cannot be allocated without knowing the resource on resource heap tier 1.
+    if (mResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2) {
+        return;
+    }
+
+    // Sized to fit, so the rest of the resource heap is left free.
+    constexpr ALLOCATOR_SIZE_CLASS_DESC kSizeClasses[] = {
+        {kDefaultPreferredResourceHeapSize, ALLOCATOR_ALGORITHM_TLSF},
+        {0, ALLOCATOR_ALGORITHM_DEDICATED},
+    };
+
+    ALLOCATOR_DESC desc = CreateBasicAllocatorDesc();
+    desc.SizeClasses = {std::begin(kSizeClasses), std::end(kSizeClasses)};
+
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
+    ASSERT_NE(allocator, nullptr);
+
+    D3D12_RESOURCE_ALLOCATION_INFO resourceInfo = {};
+    resourceInfo.SizeInBytes = kBufferSize;
+    resourceInfo.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(allocator->AllocateMemory({}, resourceInfo, &firstAllocation));
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(allocator->AllocateMemory({}, resourceInfo, &secondAllocation));
+    ASSERT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+    ASSERT_EQ(secondAllocation->GetOffset(), firstAllocation->GetOffset() + kBufferSize);
+
+    // Already large enough.
+    EXPECT_TRUE(SUCCEEDED(firstAllocation->TryExtend(kBufferSize)));
+
+    // The memory which follows is allocated.
+    EXPECT_TRUE(FAILED(firstAllocation->TryExtend(kBufferSize * 2)));
+    EXPECT_EQ(firstAllocation->GetSize(), kBufferSize);
+
+    // Grows into the rest of the resource heap, without moving.
+    const uint64_t offset = secondAllocation->GetOffset();
+    EXPECT_TRUE(SUCCEEDED(secondAllocation->TryExtend(kBufferSize * 2)));
+    EXPECT_EQ(secondAllocation->GetOffset(), offset);
+    EXPECT_EQ(secondAllocation->GetSize(), kBufferSize * 2);
+
+    // Resources cannot grow.
+    ComPtr<ResourceAllocation> bufferAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                               D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                               &bufferAllocation));
+    EXPECT_TRUE(FAILED(bufferAllocation->TryExtend(kBufferSize * 2)));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateDefragmentationPlan) {
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    constexpr uint64_t kNumOfBuffers = kDefaultPreferredResourceHeapSize / kBufferSize;
+
+    // Fill a slab then create another buffer, which needs another slab.
+    std::vector<ComPtr<ResourceAllocation>> allocations(kNumOfBuffers + 1);
+    for (auto& allocation : allocations) {
+        ASSERT_SUCCEEDED(
+            mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                              D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+    }
+
+    allocations.front() = nullptr;
+
+    // Only the buffer within the sparse slab should move, into the space freed in the full slab.
+    ResourceAllocation* allocationsToMove[] = {allocations[1].Get(), allocations.back().Get()};
+
+    DEFRAGMENTATION_DESC defragDesc = {};
+    defragDesc.MaxUsedPercent = 0.5;
+
+    std::vector<DEFRAGMENTATION_MOVE> moves;
+    ASSERT_SUCCEEDED(
+        mDefaultAllocator->CreateDefragmentationPlan(defragDesc, 2, allocationsToMove, &moves));
+    ASSERT_EQ(moves.size(), 1u);
+    EXPECT_EQ(moves[0].SrcAllocation, allocations.back().Get());
+    ASSERT_NE(moves[0].DstAllocation, nullptr);
+    EXPECT_EQ(moves[0].DstAllocation->GetSize(), moves[0].SrcAllocation->GetSize());
+    EXPECT_EQ(moves[0].DstAllocation->GetMemory(), allocations[1]->GetMemory());
+
+    // Moves are bounded by the budget.
+    defragDesc.MaxBytesToMove = 0;
+    std::vector<DEFRAGMENTATION_MOVE> noMoves;
+    ASSERT_SUCCEEDED(
+        mDefaultAllocator->CreateDefragmentationPlan(defragDesc, 2, allocationsToMove, &noMoves));
+    EXPECT_TRUE(noMoves.empty());
+
+    allocations.back() = nullptr;
+    moves[0].DstAllocation->Release();
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateReservedResource) {
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ASSERT_SUCCEEDED(
+        mDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    if (options.TiledResourcesTier == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED) {
+        return;
+    }
+
+    constexpr uint32_t kNumOfTiles = 4;
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateReservedResource(
+        CreateBasicBufferDesc(kNumOfTiles * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+    // No memory is used until tiles are mapped.
+    const uint64_t usedBlockCount = mDefaultAllocator->QueryInfo().UsedBlockCount;
+
+    D3D12_TILED_RESOURCE_COORDINATE coordinates[kNumOfTiles] = {};
+    for (uint32_t i = 0; i < kNumOfTiles; i++) {
+        coordinates[i].X = i;
+    }
+
+    // Mapping the same tile twice only allocates it once.
+    ASSERT_SUCCEEDED(mDefaultAllocator->MapTiles(allocation.Get(), 2, coordinates));
+    ASSERT_SUCCEEDED(mDefaultAllocator->MapTiles(allocation.Get(), 2, coordinates));
+    EXPECT_EQ(mDefaultAllocator->QueryInfo().UsedBlockCount, usedBlockCount + 2);
+
+    ASSERT_SUCCEEDED(mDefaultAllocator->UnmapTiles(allocation.Get(), 1, coordinates));
+    EXPECT_EQ(mDefaultAllocator->QueryInfo().UsedBlockCount, usedBlockCount + 1);
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    ComPtr<ID3D12CommandQueue> queue;
+    ASSERT_SUCCEEDED(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+    ASSERT_SUCCEEDED(mDefaultAllocator->UpdateTileMappings(queue.Get()));
+
+    // Only reserved resources have tiles.
+    ComPtr<ResourceAllocation> placedAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        {}, CreateBasicBufferDesc(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &placedAllocation));
+    ASSERT_FAILED(mDefaultAllocator->MapTiles(placedAllocation.Get(), 1, coordinates));
+
+    // Tiles still mapped are released along with the resource.
+    allocation = nullptr;
+    placedAllocation = nullptr;
+    EXPECT_EQ(mDefaultAllocator->QueryInfo().UsedBlockCount, usedBlockCount);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateCPUAccessibleBuffer) {
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+    allocationDesc.Flags = ALLOCATION_FLAG_ALWAYS_CPU_ACCESSIBLE;
+
+    // Default heaps are only CPU-accessible on UMA adapters.
+    if (!mIsUMA) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                        CreateBasicBufferDesc(kBufferSize),
+                                                        D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                        &allocation));
+        return;
+    }
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &allocation));
+    ASSERT_NE(allocation, nullptr);
+
+    D3D12_HEAP_PROPERTIES heapProperties = {};
+    ASSERT_SUCCEEDED(allocation->GetResource()->GetHeapProperties(&heapProperties, nullptr));
+    EXPECT_EQ(heapProperties.Type, D3D12_HEAP_TYPE_CUSTOM);
+    EXPECT_NE(heapProperties.CPUPageProperty, D3D12_CPU_PAGE_PROPERTY_NOT_AVAILABLE);
+
+    // Written directly, without a staging copy.
+    void* mappedPointer = nullptr;
+    ASSERT_SUCCEEDED(allocation->Map(0, nullptr, &mappedPointer));
+    ASSERT_NE(mappedPointer, nullptr);
+    memset(mappedPointer, 0xAA, kBufferSize);
+    allocation->Unmap(0, nullptr);
+
+    // Can stay mapped too.
+    allocationDesc.Flags |= ALLOCATION_FLAG_ALWAYS_MAPPED;
+    ComPtr<ResourceAllocation> mappedAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &mappedAllocation));
+    EXPECT_NE(mappedAllocation->GetMappedPointer(), nullptr);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateGPUUploadBuffer) {
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.HeapType = kHeapTypeGPUUpload;
+    allocationDesc.Flags = ALLOCATION_FLAG_ALWAYS_MAPPED;
+
+    FEATURE_DATA_D3D12_OPTIONS16 options16 = {};
+    if (FAILED(mDevice->CheckFeatureSupport(kFeatureD3D12Options16, &options16,
+                                            sizeof(options16))) ||
+        !options16.GPUUploadHeapSupported) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_FAILED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                        CreateBasicBufferDesc(kBufferSize),
+                                                        D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                        nullptr, &allocation));
+        return;
+    }
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                       nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
+    ASSERT_NE(allocation->GetMappedPointer(), nullptr);
+
+    D3D12_HEAP_PROPERTIES heapProperties = {};
+    ASSERT_SUCCEEDED(allocation->GetResource()->GetHeapProperties(&heapProperties, nullptr));
+    EXPECT_EQ(heapProperties.Type, kHeapTypeGPUUpload);
+
+    // Written directly into video memory, without a staging copy.
+    std::vector<uint8_t> data(kBufferSize, 0xAA);
+    ASSERT_SUCCEEDED(allocation->WriteData(0, data.data(), data.size()));
+    EXPECT_EQ(memcmp(allocation->GetMappedPointer(), data.data(), data.size()), 0);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, ResidencySetInsert) {
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize), D3D12_RESOURCE_STATE_COMMON,
+        nullptr, &allocation));
+    ASSERT_NE(allocation, nullptr);
+
+    // Heaps are only inserted once per set until reset.
+    ResidencySet firstSet;
+    ASSERT_SUCCEEDED(allocation->UpdateResidency(&firstSet));
+    ASSERT_FAILED(allocation->UpdateResidency(&firstSet));
+
+    // Other sets are unaffected.
+    ResidencySet secondSet;
+    ASSERT_SUCCEEDED(allocation->UpdateResidency(&secondSet));
+
+    ASSERT_SUCCEEDED(firstSet.Reset());
+    ASSERT_SUCCEEDED(allocation->UpdateResidency(&firstSet));
+}
+
+TEST_F(D3D12ResourceAllocatorTests, ResidencySetConcurrentInsert) {
+    constexpr uint32_t kNumOfAllocations = 8;
+    constexpr uint32_t kNumOfThreads = 4;
+
+    std::vector<ComPtr<ResourceAllocation>> allocations(kNumOfAllocations);
+    for (auto& allocation : allocations) {
+        ALLOCATION_DESC allocationDesc = {};
+        allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+        ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+            allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    }
+
+    // Every thread inserts every heap but each heap is only inserted once.
+    ResidencySet residencySet(RESIDENCY_SET_FLAG_ALLOW_CONCURRENT_INSERT);
+    std::atomic<uint32_t> insertedCount{0};
+    std::vector<std::thread> threads(kNumOfThreads);
+    for (std::thread& thread : threads) {
+        thread = std::thread([&]() {
+            for (const auto& allocation : allocations) {
+                if (SUCCEEDED(allocation->UpdateResidency(&residencySet))) {
+                    insertedCount++;
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(insertedCount.load(), kNumOfAllocations);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferInPool) {
+    POOL_DESC poolDesc = {};
+    poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    poolDesc.HeapSizeInBytes = kDefaultPreferredResourceHeapSize;
+    poolDesc.MinHeapCount = 1;
+    poolDesc.MaxHeapCount = 2;
+    poolDesc.Algorithm = ALLOCATOR_ALGORITHM_BUDDY_SYSTEM;
+
+    ComPtr<Pool> pool;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreatePool(poolDesc, &pool));
+
+    // The minimum resource heaps are created along with the pool.
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, kDefaultPreferredResourceHeapSize);
+    EXPECT_EQ(pool->QueryInfo().UsedMemoryUsage, 0u);
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.CustomPool = pool.Get();
+
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &firstAllocation));
+    EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(pool->QueryInfo().UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &secondAllocation));
+    EXPECT_NE(firstAllocation->GetMemory(), secondAllocation->GetMemory());
+
+    // The pool is full, even though the allocator itself could create the resource.
+    ComPtr<ResourceAllocation> thirdAllocation;
+    ASSERT_EQ(mDefaultAllocator->CreateResource(
+                  allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+                  D3D12_RESOURCE_STATE_COMMON, nullptr, &thirdAllocation),
+              E_OUTOFMEMORY);
+
+    // Resources of the pool are not counted by the allocator.
+    EXPECT_EQ(mDefaultAllocator->QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(pool->QueryInfo().UsedBlockCount, 2u);
+
+    // Heap type must match the pool.
+    allocationDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+    ComPtr<ResourceAllocation> uploadAllocation;
+    ASSERT_EQ(mDefaultAllocator->CreateResource(
+                  allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+                  D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &uploadAllocation),
+              E_INVALIDARG);
+
+    firstAllocation = nullptr;
+    secondAllocation = nullptr;
+
+    // Unused resource heaps of the pool are only released by the pool.
+    mDefaultAllocator->Trim();
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, kDefaultPreferredResourceHeapSize * 2);
+
+    pool->Trim();
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, 0u);
+}
+
+// Verifies resources of a shared pool are placed in heaps whose NT handle is re-used, as long as
+// the heap stays pooled.
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferInSharedPool) {
+    POOL_DESC poolDesc = {};
+    poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS | D3D12_HEAP_FLAG_SHARED;
+    poolDesc.HeapSizeInBytes = kDefaultPreferredResourceHeapSize;
+    poolDesc.MinHeapCount = 1;
+    poolDesc.MaxHeapCount = 1;
+    poolDesc.Algorithm = ALLOCATOR_ALGORITHM_BUDDY_SYSTEM;
+
+    ComPtr<Pool> pool;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreatePool(poolDesc, &pool));
+
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.CustomPool = pool.Get();
+
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 2),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &firstAllocation));
+
+    HANDLE firstSharedHandle = nullptr;
+    ASSERT_SUCCEEDED(firstAllocation->GetSharedHandle(&firstSharedHandle));
+    EXPECT_NE(firstSharedHandle, nullptr);
+
+    // Resources placed in the same heap share its handle.
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 2),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &secondAllocation));
+    EXPECT_EQ(firstAllocation->GetMemory(), secondAllocation->GetMemory());
+
+    HANDLE secondSharedHandle = nullptr;
+    ASSERT_SUCCEEDED(secondAllocation->GetSharedHandle(&secondSharedHandle));
+    EXPECT_EQ(firstSharedHandle, secondSharedHandle);
+
+    // The heap can be opened by another process (or device) through the handle.
+    ComPtr<ID3D12Heap> openedHeap;
+    ASSERT_SUCCEEDED(mDevice->OpenSharedHandle(firstSharedHandle, IID_PPV_ARGS(&openedHeap)));
+    EXPECT_EQ(openedHeap->GetDesc().SizeInBytes, kDefaultPreferredResourceHeapSize);
+
+    // Once released, the pooled heap and its handle are re-used by the next resource.
+    firstAllocation = nullptr;
+    secondAllocation = nullptr;
+
+    ComPtr<ResourceAllocation> thirdAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &thirdAllocation));
+
+    HANDLE thirdSharedHandle = nullptr;
+    ASSERT_SUCCEEDED(thirdAllocation->GetSharedHandle(&thirdSharedHandle));
+    EXPECT_EQ(firstSharedHandle, thirdSharedHandle);
+
+    // Resource heaps which are not shared have no handle.
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(256u),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &allocation));
+
+    HANDLE sharedHandle = nullptr;
+    ASSERT_EQ(allocation->GetSharedHandle(&sharedHandle), E_INVALIDARG);
+}
+
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferInImportedHeap) {
+    POOL_DESC poolDesc = {};
+    poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    poolDesc.HeapSizeInBytes = kDefaultPreferredResourceHeapSize;
+    poolDesc.MaxHeapCount = 1;
+
+    ComPtr<Pool> pool;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreatePool(poolDesc, &pool));
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, 0u);
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heapDesc.SizeInBytes = kDefaultPreferredResourceHeapSize;
+    heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+    ComPtr<ID3D12Heap> heap;
+    ASSERT_SUCCEEDED(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+
+    ASSERT_SUCCEEDED(pool->ImportHeap(heap));
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, kDefaultPreferredResourceHeapSize);
+
+    // The imported heap counts towards the maximum heap count of the pool.
+    {
+        ComPtr<ID3D12Heap> otherHeap;
+        ASSERT_SUCCEEDED(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&otherHeap)));
+        ASSERT_EQ(pool->ImportHeap(otherHeap), E_OUTOFMEMORY);
+    }
+
+    // Resources of the pool are placed in the imported heap.
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.CustomPool = pool.Get();
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 2),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    EXPECT_EQ(ToBackend(allocation->GetMemory())->GetHeap(), heap.Get());
+
+    allocation = nullptr;
+
+    // Trim releases the imported heap like any other resource heap of the pool.
+    pool->Trim();
+    EXPECT_EQ(pool->QueryInfo().FreeMemoryUsage, 0u);
+
+    // Heaps which differ from the pool cannot be imported.
+    ASSERT_EQ(pool->ImportHeap(nullptr), E_INVALIDARG);
+
+    {
+        D3D12_HEAP_DESC otherHeapDesc = heapDesc;
+        otherHeapDesc.SizeInBytes = kDefaultPreferredResourceHeapSize * 2;
+
+        ComPtr<ID3D12Heap> otherHeap;
+        ASSERT_SUCCEEDED(mDevice->CreateHeap(&otherHeapDesc, IID_PPV_ARGS(&otherHeap)));
+        ASSERT_EQ(pool->ImportHeap(otherHeap), E_INVALIDARG);
+    }
+
+    {
+        D3D12_HEAP_DESC otherHeapDesc = heapDesc;
+        otherHeapDesc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+        ComPtr<ID3D12Heap> otherHeap;
+        ASSERT_SUCCEEDED(mDevice->CreateHeap(&otherHeapDesc, IID_PPV_ARGS(&otherHeap)));
+        ASSERT_EQ(pool->ImportHeap(otherHeap), E_INVALIDARG);
+    }
 
-        ComPtr<ResourceAllocator> allocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(desc, &allocator));
-        ASSERT_NE(allocator, nullptr);
+    {
+        D3D12_HEAP_DESC otherHeapDesc = heapDesc;
+        otherHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
 
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(
-            allocator->CreateResource(standaloneAllocationDesc, CreateBasicBufferDesc(1024),
-                                      D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-        EXPECT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+        ComPtr<ID3D12Heap> otherHeap;
+        ASSERT_SUCCEEDED(mDevice->CreateHeap(&otherHeapDesc, IID_PPV_ARGS(&otherHeap)));
+        ASSERT_EQ(pool->ImportHeap(otherHeap), E_INVALIDARG);
     }
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferQueryInfo) {
-    // Calculate info for a single standalone allocation.
+TEST_F(D3D12ResourceAllocatorTests, CreatePoolInvalid) {
+    ComPtr<Pool> pool;
+
+    // Resource heaps of a pool are of a fixed size.
     {
-        ComPtr<ResourceAllocator> resourceAllocator;
-        ASSERT_SUCCEEDED(
-            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
-        ASSERT_NE(resourceAllocator, nullptr);
+        POOL_DESC poolDesc = {};
+        poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        poolDesc.Algorithm = ALLOCATOR_ALGORITHM_DEDICATED;
+        ASSERT_EQ(mDefaultAllocator->CreatePool(poolDesc, &pool), E_INVALIDARG);
+    }
 
-        ALLOCATION_DESC standaloneAllocationDesc = {};
-        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+    // Heap size must be a power-of-two.
+    {
+        POOL_DESC poolDesc = {};
+        poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        poolDesc.HeapSizeInBytes = kDefaultPreferredResourceHeapSize + 1;
+        ASSERT_EQ(mDefaultAllocator->CreatePool(poolDesc, &pool), E_INVALIDARG);
+    }
 
-        ComPtr<ResourceAllocation> firstAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
-        ASSERT_NE(firstAllocation, nullptr);
-        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    // Cannot pre-allocate more resource heaps than the maximum.
+    {
+        POOL_DESC poolDesc = {};
+        poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        poolDesc.MinHeapCount = 2;
+        poolDesc.MaxHeapCount = 1;
+        ASSERT_EQ(mDefaultAllocator->CreatePool(poolDesc, &pool), E_INVALIDARG);
+    }
 
-        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 1u);
-        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+    // Textures are only allowed in default heaps.
+    {
+        POOL_DESC poolDesc = {};
+        poolDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+        poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        ASSERT_EQ(mDefaultAllocator->CreatePool(poolDesc, &pool), E_INVALIDARG);
     }
 
-    // Calculate info for two pooled standalone allocations.
+    // Only default heaps can be shared.
     {
-        ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
-        allocatorDesc.MaxResourceSizeForPooling = kDefaultPreferredResourceHeapSize;
+        POOL_DESC poolDesc = {};
+        poolDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+        poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS | D3D12_HEAP_FLAG_SHARED;
+        ASSERT_EQ(mDefaultAllocator->CreatePool(poolDesc, &pool), E_INVALIDARG);
+    }
 
-        ComPtr<ResourceAllocator> resourceAllocator;
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &resourceAllocator));
-        ASSERT_NE(resourceAllocator, nullptr);
+    ASSERT_EQ(mDefaultAllocator->CreatePool({}, nullptr), E_POINTER);
+}
 
-        ALLOCATION_DESC standaloneAllocationDesc = {};
-        standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferInLinearPool) {
+    POOL_DESC poolDesc = {};
+    poolDesc.HeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    poolDesc.HeapSizeInBytes = kDefaultPreferredResourceHeapSize;
+    poolDesc.Algorithm = ALLOCATOR_ALGORITHM_LINEAR;
 
-        ComPtr<ResourceAllocation> firstAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
-        ASSERT_NE(firstAllocation, nullptr);
-        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    ComPtr<Pool> pool;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreatePool(poolDesc, &pool));
 
-        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 1u);
-        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
+    constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 4;
 
-        ComPtr<ResourceAllocation> secondAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
-        ASSERT_NE(secondAllocation, nullptr);
-        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.CustomPool = pool.Get();
+
+    // Resources are placed one after another.
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &firstAllocation));
+    EXPECT_EQ(firstAllocation->GetOffset(), 0u);
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &secondAllocation));
+    EXPECT_EQ(secondAllocation->GetOffset(), kBufferSize);
+    EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+
+    // Upper address resources are placed from the end of the resource heap.
+    ALLOCATION_DESC upperAllocationDesc = allocationDesc;
+    upperAllocationDesc.Flags |= ALLOCATION_FLAG_UPPER_ADDRESS;
+
+    ComPtr<ResourceAllocation> upperAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(upperAllocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &upperAllocation));
+    EXPECT_EQ(upperAllocation->GetOffset(), kDefaultPreferredResourceHeapSize - kBufferSize);
+    EXPECT_EQ(upperAllocation->GetMemory(), firstAllocation->GetMemory());
+
+    // Cannot reset while resources remain.
+    EXPECT_EQ(pool->Reset(), E_FAIL);
+
+    firstAllocation = nullptr;
+    secondAllocation = nullptr;
+    upperAllocation = nullptr;
+
+    // Resetting re-uses the resource heap from the start.
+    ASSERT_SUCCEEDED(pool->Reset());
+    EXPECT_EQ(pool->QueryInfo().UsedMemoryCount, 1u);
+
+    ComPtr<ResourceAllocation> thirdAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(allocationDesc,
+                                                       CreateBasicBufferDesc(kBufferSize),
+                                                       D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                       &thirdAllocation));
+    EXPECT_EQ(thirdAllocation->GetOffset(), 0u);
+    EXPECT_EQ(pool->QueryInfo().UsedMemoryCount, 1u);
+
+    // Only pools of the linear algorithm can be reset.
+    poolDesc.Algorithm = ALLOCATOR_ALGORITHM_BUDDY_SYSTEM;
+
+    ComPtr<Pool> buddyPool;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreatePool(poolDesc, &buddyPool));
+    EXPECT_EQ(buddyPool->Reset(), E_INVALIDARG);
+}
 
-        info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 2u);
-        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize * 2);
-    }
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferWithLifetime) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Lifetime = ALLOCATION_LIFETIME_PERSISTENT;
 
-    // Calculate info for two sub-allocations.
-    {
-        ComPtr<ResourceAllocator> resourceAllocator;
-        ASSERT_SUCCEEDED(
-            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
-        ASSERT_NE(resourceAllocator, nullptr);
+    ComPtr<ResourceAllocation> persistentAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &persistentAllocation));
+    EXPECT_EQ(persistentAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
 
-        constexpr uint64_t kBufferSize = kDefaultPreferredResourceHeapSize / 8;
-        ComPtr<ResourceAllocation> firstAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
-                                                           D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                           nullptr, &firstAllocation));
-        ASSERT_NE(firstAllocation, nullptr);
+    // Resources of the same lifetime share a resource heap.
+    ComPtr<ResourceAllocation> otherPersistentAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &otherPersistentAllocation));
+    EXPECT_EQ(otherPersistentAllocation->GetMemory(), persistentAllocation->GetMemory());
 
-        // Depending on the device, sub-allocation could fail. Since this test relies on a
-        // sub-allocator's info counts, it must be skipped.
-        // TODO: Consider testing counts by allocator type.
-        GPGMM_SKIP_TEST_IF(firstAllocation->GetMethod() != gpgmm::AllocationMethod::kSubAllocated);
+    // Resources of another lifetime never share it.
+    allocationDesc.Lifetime = ALLOCATION_LIFETIME_TRANSIENT;
 
-        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 1u);
-        EXPECT_EQ(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
-        EXPECT_EQ(info.UsedBlockCount, 1u);
-        EXPECT_GE(info.UsedBlockUsage, kBufferSize);
+    ComPtr<ResourceAllocation> transientAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &transientAllocation));
+    EXPECT_EQ(transientAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+    EXPECT_NE(transientAllocation->GetMemory(), persistentAllocation->GetMemory());
 
-        ComPtr<ResourceAllocation> secondAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
-                                                           D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                           nullptr, &secondAllocation));
-        ASSERT_NE(secondAllocation, nullptr);
-        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+    // Resources of unknown lifetime are kept apart from both.
+    allocationDesc.Lifetime = ALLOCATION_LIFETIME_UNKNOWN;
 
-        info = resourceAllocator->QueryInfo();
-        EXPECT_GE(info.UsedMemoryCount, 1u);
-        EXPECT_GE(info.UsedMemoryUsage, kDefaultPreferredResourceHeapSize);
-        EXPECT_EQ(info.UsedBlockCount, 2u);
-        EXPECT_GE(info.UsedBlockUsage, kBufferSize * 2);
-    }
+    ComPtr<ResourceAllocation> unknownAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &unknownAllocation));
+    EXPECT_NE(unknownAllocation->GetMemory(), persistentAllocation->GetMemory());
+    EXPECT_NE(unknownAllocation->GetMemory(), transientAllocation->GetMemory());
+
+    // Fragmentation is reported by lifetime. No frame resource was created.
+    EXPECT_EQ(mDefaultAllocator->QueryFragmentationInfo(ALLOCATION_LIFETIME_FRAME).FreeBlockUsage,
+              0u);
+    EXPECT_GT(
+        mDefaultAllocator->QueryFragmentationInfo(ALLOCATION_LIFETIME_PERSISTENT).FreeBlockUsage,
+        0u);
+
+    // Lifetime must be valid.
+    allocationDesc.Lifetime = static_cast<ALLOCATION_LIFETIME>(ALLOCATION_LIFETIME_PERSISTENT + 1);
+
+    ComPtr<ResourceAllocation> invalidAllocation;
+    ASSERT_EQ(mDefaultAllocator->CreateResource(
+                  allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+                  D3D12_RESOURCE_STATE_COMMON, nullptr, &invalidAllocation),
+              E_INVALIDARG);
+}
 
-    // Calculate info for two sub-allocations within the same resource.
-    {
-        ComPtr<ResourceAllocator> resourceAllocator;
-        ASSERT_SUCCEEDED(
-            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
-        ASSERT_NE(resourceAllocator, nullptr);
+TEST_F(D3D12ResourceAllocatorTests, CreateBufferWithResidencyPriority) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
 
-        ALLOCATION_DESC allocationWithinDesc = {};
-        allocationWithinDesc.Flags = ALLOCATION_FLAG_ALLOW_SUBALLOCATE_WITHIN_RESOURCE;
-        allocationWithinDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    // Heaps use the default priority unless one is specified.
+    ComPtr<ResourceAllocation> normalAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &normalAllocation));
+    EXPECT_EQ(ToBackend(normalAllocation->GetMemory())->GetResidencyPriority(),
+              D3D12_RESIDENCY_PRIORITY_NORMAL);
 
-        constexpr uint32_t kBufferSize = 4u;  // Must less than 64KB
+    allocationDesc.ResidencyPriority = D3D12_RESIDENCY_PRIORITY_HIGH;
 
-        ComPtr<ResourceAllocation> firstAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            allocationWithinDesc, CreateBasicBufferDesc(kBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
-        ASSERT_NE(firstAllocation, nullptr);
-        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    ComPtr<ResourceAllocation> highAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &highAllocation));
+    EXPECT_EQ(ToBackend(highAllocation->GetMemory())->GetResidencyPriority(),
+              D3D12_RESIDENCY_PRIORITY_HIGH);
 
-        QUERY_RESOURCE_ALLOCATOR_INFO info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 1u);
-        EXPECT_EQ(info.UsedMemoryUsage, 64u * 1024u);
-        EXPECT_EQ(info.UsedBlockCount, 1u);
-        EXPECT_EQ(info.UsedBlockUsage, kBufferSize);
+    // A shared heap keeps the highest priority of the resources within it.
+    allocationDesc.Flags = ALLOCATION_FLAG_NONE;
+    allocationDesc.ResidencyPriority = D3D12_RESIDENCY_PRIORITY_HIGH;
 
-        ComPtr<ResourceAllocation> secondAllocation;
-        ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-            allocationWithinDesc, CreateBasicBufferDesc(kBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
-        ASSERT_NE(secondAllocation, nullptr);
-        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocatedWithin);
+    ComPtr<ResourceAllocation> firstAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &firstAllocation));
 
-        info = resourceAllocator->QueryInfo();
-        EXPECT_EQ(info.UsedMemoryCount, 1u);
-        EXPECT_EQ(info.UsedMemoryUsage, 64u * 1024u);
-        EXPECT_EQ(info.UsedBlockCount, 2u);
-        EXPECT_EQ(info.UsedBlockUsage, kBufferSize * 2);
+    allocationDesc.ResidencyPriority = D3D12_RESIDENCY_PRIORITY_LOW;
+
+    ComPtr<ResourceAllocation> secondAllocation;
+    ASSERT_SUCCEEDED(mDefaultAllocator->CreateResource(
+        allocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize / 4),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &secondAllocation));
+
+    if (firstAllocation->GetMemory() == secondAllocation->GetMemory()) {
+        EXPECT_EQ(ToBackend(secondAllocation->GetMemory())->GetResidencyPriority(),
+                  D3D12_RESIDENCY_PRIORITY_HIGH);
     }
 }
 
-TEST_F(D3D12ResourceAllocatorTests, CreateTexturePooled) {
-    ComPtr<ResourceAllocator> poolAllocator;
-    {
-        ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
-        allocatorDesc.MaxResourceSizeForPooling = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+TEST_F(D3D12ResourceAllocatorTests, CreateDefragmentationPlanMoveToColdHeaps) {
+    constexpr uint64_t kBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 
-        ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &poolAllocator));
-        ASSERT_NE(poolAllocator, nullptr);
+    std::vector<ComPtr<ResourceAllocation>> allocations(2);
+    for (auto& allocation : allocations) {
+        ASSERT_SUCCEEDED(
+            mDefaultAllocator->CreateResource({}, CreateBasicBufferDesc(kBufferSize),
+                                              D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        ASSERT_EQ(allocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
     }
 
-    // Only standalone allocations can be pool-allocated.
+    // Cold resources are moved even though their heap is dense enough to be kept.
+    ResourceAllocation* allocationsToMove[] = {allocations[0].Get()};
+
+    DEFRAGMENTATION_DESC defragDesc = {};
+    defragDesc.MaxUsedPercent = 0;
+    defragDesc.MoveToColdHeaps = true;
+
+    std::vector<DEFRAGMENTATION_MOVE> moves;
+    ASSERT_SUCCEEDED(
+        mDefaultAllocator->CreateDefragmentationPlan(defragDesc, 1, allocationsToMove, &moves));
+    ASSERT_EQ(moves.size(), 1u);
+    ASSERT_NE(moves[0].DstAllocation, nullptr);
+    EXPECT_NE(moves[0].DstAllocation->GetMemory(), allocations[1]->GetMemory());
+    EXPECT_EQ(ToBackend(moves[0].DstAllocation->GetMemory())->GetResidencyPriority(),
+              D3D12_RESIDENCY_PRIORITY_MINIMUM);
+
+    // Cold resources are not moved again.
+    ResourceAllocation* coldAllocations[] = {moves[0].DstAllocation};
+    std::vector<DEFRAGMENTATION_MOVE> noMoves;
+    ASSERT_SUCCEEDED(
+        mDefaultAllocator->CreateDefragmentationPlan(defragDesc, 1, coldAllocations, &noMoves));
+    EXPECT_TRUE(noMoves.empty());
+
+    moves[0].DstAllocation->Release();
+}
+
+// Verify the latency of each resource created is counted by how it was allocated.
+TEST_F(D3D12ResourceAllocatorTests, QueryStats) {
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+
+    EXPECT_EQ(allocator->QueryStats().SubAllocatedLatency.Count, 0u);
+
+    ComPtr<ResourceAllocation> subAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicBufferDesc(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &subAllocation));
+    ASSERT_EQ(subAllocation->GetMethod(), gpgmm::AllocationMethod::kSubAllocated);
+
     ALLOCATION_DESC standaloneAllocationDesc = {};
     standaloneAllocationDesc.Flags = ALLOCATION_FLAG_NEVER_SUBALLOCATE_MEMORY;
 
-    // Create a small texture of size A with it's own resource heap that will be returned to the
-    // pool.
-    {
-        ComPtr<ResourceAllocation> firstAllocation;
-        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
-            standaloneAllocationDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &firstAllocation));
-        ASSERT_NE(firstAllocation, nullptr);
-        EXPECT_EQ(firstAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
-    }
+    ComPtr<ResourceAllocation> standaloneAllocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        standaloneAllocationDesc, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &standaloneAllocation));
+    ASSERT_EQ(standaloneAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
+
+    const QUERY_RESOURCE_ALLOCATOR_STATS stats = allocator->QueryStats();
+    EXPECT_EQ(stats.SubAllocatedLatency.Count, 1u);
+    EXPECT_GT(stats.SubAllocatedLatency.P50, 0u);
+    EXPECT_GE(stats.SubAllocatedLatency.P999, stats.SubAllocatedLatency.P50);
+    EXPECT_EQ(stats.SubAllocatedWithinLatency.Count, 0u);
+    EXPECT_EQ(stats.StandaloneLatency.Count + stats.CommittedLatency.Count, 1u);
+
+    // The driver calls made to create them are timed on their own.
+    EXPECT_GE(stats.CreateHeapLatency.Count, 1u);
+    EXPECT_GE(stats.CreatePlacedResourceLatency.Count, 1u);
+    EXPECT_GE(stats.CreatePlacedResourceLatency.Count + stats.CreateCommittedResourceLatency.Count,
+              2u);
+}
 
-    ALLOCATION_DESC reusePoolOnlyDesc = standaloneAllocationDesc;
-    reusePoolOnlyDesc.Flags =
-        standaloneAllocationDesc.Flags | ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+// Verify resources are both placed and committed to time each, then created the way measured
+// cheapest.
+TEST_F(D3D12ResourceAllocatorTests, CreateResourceAdaptiveCommitted) {
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.Flags |= ALLOCATOR_FLAG_ADAPTIVE_COMMITTED;
 
-    // Check the first small texture of size A was pool-allocated by creating it again.
-    {
-        ComPtr<ResourceAllocation> secondAllocation;
-        ASSERT_SUCCEEDED(poolAllocator->CreateResource(
-            reusePoolOnlyDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &secondAllocation));
-        ASSERT_NE(secondAllocation, nullptr);
-        EXPECT_EQ(secondAllocation->GetMethod(), gpgmm::AllocationMethod::kStandalone);
-    }
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
 
-    // Check the first small texture of size A cannot be reused when creating a larger texture of
-    // size B.
-    {
-        ComPtr<ResourceAllocation> thirdAllocation;
-        ASSERT_FAILED(poolAllocator->CreateResource(
-            reusePoolOnlyDesc, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 128, 128),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, &thirdAllocation));
-        ASSERT_EQ(thirdAllocation, nullptr);
+    constexpr uint64_t kNumOfResources = 32u;
+    uint64_t committedCount = 0;
+    for (uint64_t i = 0; i < kNumOfResources; i++) {
+        ComPtr<ResourceAllocation> allocation;
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicBufferDesc(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+        if (allocation->GetMethod() == gpgmm::AllocationMethod::kStandalone) {
+            committedCount++;
+        }
     }
+
+    const QUERY_RESOURCE_ALLOCATOR_STATS stats = allocator->QueryStats();
+    EXPECT_EQ(stats.AdaptiveCommittedCount + stats.AdaptivePlacedCount, kNumOfResources);
+    EXPECT_GT(stats.AdaptiveCommittedCount, 0u);
+    EXPECT_GT(stats.AdaptivePlacedCount, 0u);
+    EXPECT_EQ(committedCount, stats.AdaptiveCommittedCount);
+
+    // Small textures would waste too much memory once committed, so they are always placed.
+    ComPtr<ResourceAllocation> smallTexture;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &smallTexture));
+    EXPECT_EQ(allocator->QueryStats().AdaptivePlacedCount, stats.AdaptivePlacedCount);
 }
 
-// Creates a bunch of small buffers using the smallest size allowed so GPU memory is pre-fetched.
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferPrefetch) {
+// Verify the counters published to shared memory can be read back, and are re-published.
+TEST_F(D3D12ResourceAllocatorTests, SharedStats) {
+    const std::string sharedStatsName = "Local\\GPGMM.D3D12ResourceAllocatorTests.SharedStats";
+
+    ALLOCATOR_DESC allocatorDesc = CreateBasicAllocatorDesc();
+    allocatorDesc.SharedStatsName = sharedStatsName;
+    allocatorDesc.SharedStatsIntervalInSeconds = 0.001;
+
     ComPtr<ResourceAllocator> allocator;
-    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(
-        CreateBasicAllocatorDesc(/*enablePrefetch*/ true), &allocator));
-    ASSERT_NE(allocator, nullptr);
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(allocatorDesc, &allocator));
 
-    constexpr uint64_t kNumOfBuffers = 1000u;
+    // Only one allocator can publish to the same name.
+    ComPtr<ResourceAllocator> otherAllocator;
+    ASSERT_FAILED(ResourceAllocator::CreateAllocator(allocatorDesc, &otherAllocator));
 
-    std::set<ComPtr<ResourceAllocation>> allocs = {};
-    for (uint64_t i = 0; i < kNumOfBuffers; i++) {
-        ComPtr<ResourceAllocation> allocation;
-        ASSERT_SUCCEEDED(allocator->CreateResource(
-            {}, CreateBasicBufferDesc(1), D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-        ASSERT_NE(allocation, nullptr);
-        allocs.insert(allocation);
+    SHARED_ALLOCATOR_STATS stats = {};
+    ASSERT_SUCCEEDED(ResourceAllocator::ReadSharedStats(sharedStatsName, &stats));
+    EXPECT_EQ(stats.Version, kSharedAllocatorStatsVersion);
+    EXPECT_EQ(stats.ProcessID, GetCurrentProcessId());
+    EXPECT_EQ(stats.Default.UsedBlockUsage, 0u);
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicBufferDesc(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+
+    // Counters are published by another thread. The second publish after creating the resource
+    // is the first sure to have collected counters after.
+    ASSERT_SUCCEEDED(ResourceAllocator::ReadSharedStats(sharedStatsName, &stats));
+    const uint64_t publishCount = stats.PublishCount;
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (stats.PublishCount < publishCount + 2 && std::chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_SUCCEEDED(ResourceAllocator::ReadSharedStats(sharedStatsName, &stats));
     }
 
-    allocs.clear();
+    const QUERY_RESOURCE_ALLOCATOR_INFO info = allocator->QueryInfo();
+    EXPECT_GT(stats.Default.UsedBlockUsage, 0u);
+    EXPECT_EQ(stats.Default.UsedBlockUsage + stats.Committed.UsedBlockUsage, info.UsedBlockUsage);
+    EXPECT_EQ(stats.Default.UsedMemoryUsage + stats.Committed.UsedMemoryUsage,
+              info.UsedMemoryUsage);
+    EXPECT_EQ(stats.Upload.UsedBlockUsage, 0u);
+
+    // Nothing is published once the allocator is destroyed.
+    allocation = nullptr;
+    allocator = nullptr;
+    ASSERT_FAILED(ResourceAllocator::ReadSharedStats(sharedStatsName, &stats));
 }
 
-// Creates a bunch of buffers concurrently.
-TEST_F(D3D12ResourceAllocatorTests, CreateBufferManyThreaded) {
-    ComPtr<ResourceAllocator> resourceAllocator;
-    ASSERT_SUCCEEDED(
-        ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
-    ASSERT_NE(resourceAllocator, nullptr);
+// Verifies every resource looks up the layer to create it with, and Trim makes the layers skipped
+// before worth trying again.
+TEST_F(D3D12ResourceAllocatorTests, QueryStatsLayerCache) {
+    ComPtr<ResourceAllocator> allocator;
+    ASSERT_SUCCEEDED(ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &allocator));
+    ASSERT_NE(allocator, nullptr);
 
-    constexpr uint32_t kThreadCount = 64u;
-    std::vector<std::thread> threads(kThreadCount);
-    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
-        threads[threadIdx] = std::thread([&]() {
-            ComPtr<ResourceAllocation> allocation;
-            ASSERT_SUCCEEDED(resourceAllocator->CreateResource(
-                {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize),
-                D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
-            ASSERT_NE(allocation, nullptr);
-        });
+    constexpr uint32_t kNumOfResources = 4u;
+    std::vector<ComPtr<ResourceAllocation>> allocations(kNumOfResources);
+    for (auto& allocation : allocations) {
+        ASSERT_SUCCEEDED(allocator->CreateResource(
+            {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize * 2),
+            D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
     }
 
-    for (std::thread& thread : threads) {
-        thread.join();
-    }
+    QUERY_RESOURCE_ALLOCATOR_STATS stats = allocator->QueryStats();
+    EXPECT_EQ(stats.LayerCacheHitCount + stats.LayerCacheMissCount, kNumOfResources);
+
+    // Resources which never allocate are not cached.
+    ALLOCATION_DESC neverAllocateDesc = {};
+    neverAllocateDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+
+    ComPtr<ResourceAllocation> neverAllocateAllocation;
+    allocator->CreateResource(neverAllocateDesc,
+                              CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize * 2),
+                              D3D12_RESOURCE_STATE_COMMON, nullptr, &neverAllocateAllocation);
+    EXPECT_EQ(allocator->QueryStats().LayerCacheHitCount, stats.LayerCacheHitCount);
+    EXPECT_EQ(allocator->QueryStats().LayerCacheMissCount, stats.LayerCacheMissCount);
+
+    // Nothing is skipped right after Trim.
+    allocator->Trim();
+
+    ComPtr<ResourceAllocation> allocation;
+    ASSERT_SUCCEEDED(allocator->CreateResource(
+        {}, CreateBasicBufferDesc(kDefaultPreferredResourceHeapSize * 2),
+        D3D12_RESOURCE_STATE_COMMON, nullptr, &allocation));
+    EXPECT_EQ(allocator->QueryStats().LayerCacheHitCount, stats.LayerCacheHitCount);
+    EXPECT_EQ(allocator->QueryStats().LayerCacheMissCount, stats.LayerCacheMissCount + 1);
 }
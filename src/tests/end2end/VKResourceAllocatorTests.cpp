@@ -0,0 +1,179 @@
+// Copyright 2021 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/VKTest.h"
+
+#include <gpgmm_vk.h>
+
+#include <memory>
+
+using namespace gpgmm::vk;
+
+static constexpr uint64_t kDefaultBufferSize = 4ll * 1024ll * 1024ll;  // 4MB
+
+class VKResourceAllocatorTests : public VKTestBase, public ::testing::Test {
+  protected:
+    void SetUp() override {
+        VKTestBase::SetUp();
+
+        ResourceAllocator* resourceAllocator = nullptr;
+        ASSERT_VK_SUCCESS(
+            ResourceAllocator::CreateAllocator(CreateBasicAllocatorDesc(), &resourceAllocator));
+        mDefaultAllocator.reset(resourceAllocator);
+        ASSERT_NE(mDefaultAllocator, nullptr);
+    }
+
+    void TearDown() override {
+        mDefaultAllocator = nullptr;
+        VKTestBase::TearDown();
+    }
+
+    static VkBufferCreateInfo CreateBasicBufferInfo(uint64_t size) {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        return bufferInfo;
+    }
+
+    static VkImageCreateInfo CreateBasicImageInfo(uint32_t width, uint32_t height) {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return imageInfo;
+    }
+
+    std::unique_ptr<ResourceAllocator> mDefaultAllocator;
+};
+
+TEST_F(VKResourceAllocatorTests, CreateBuffer) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.RequiredPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateBuffer(
+        allocationDesc, CreateBasicBufferInfo(kDefaultBufferSize), &buffer, &allocation));
+    ASSERT_NE(buffer, VK_NULL_HANDLE);
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_GE(allocation->GetSize(), kDefaultBufferSize);
+    EXPECT_NE(allocation->GetDeviceMemory(), VK_NULL_HANDLE);
+
+    mDefaultAllocator->DestroyBuffer(buffer, allocation);
+    EXPECT_EQ(mDefaultAllocator->QueryInfo().UsedBlockUsage, 0u);
+}
+
+TEST_F(VKResourceAllocatorTests, CreateBufferSubAllocated) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.RequiredPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    // Both buffers fit within the same device memory.
+    VkBuffer bufferA = VK_NULL_HANDLE;
+    ResourceAllocation* allocationA = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateBuffer(
+        allocationDesc, CreateBasicBufferInfo(kDefaultBufferSize / 4), &bufferA, &allocationA));
+
+    VkBuffer bufferB = VK_NULL_HANDLE;
+    ResourceAllocation* allocationB = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateBuffer(
+        allocationDesc, CreateBasicBufferInfo(kDefaultBufferSize / 4), &bufferB, &allocationB));
+
+    EXPECT_EQ(allocationA->GetDeviceMemory(), allocationB->GetDeviceMemory());
+    EXPECT_NE(allocationA->GetOffset(), allocationB->GetOffset());
+
+    mDefaultAllocator->DestroyBuffer(bufferA, allocationA);
+    mDefaultAllocator->DestroyBuffer(bufferB, allocationB);
+}
+
+TEST_F(VKResourceAllocatorTests, CreateBufferNeverAllocate) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.Flags = ALLOCATION_FLAG_NEVER_ALLOCATE_MEMORY;
+    allocationDesc.RequiredPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_EQ(mDefaultAllocator->CreateBuffer(allocationDesc,
+                                              CreateBasicBufferInfo(kDefaultBufferSize), &buffer,
+                                              &allocation),
+              VK_ERROR_OUT_OF_DEVICE_MEMORY);
+}
+
+TEST_F(VKResourceAllocatorTests, CreateBufferMapped) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.RequiredPropertyFlags =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateBuffer(
+        allocationDesc, CreateBasicBufferInfo(kDefaultBufferSize), &buffer, &allocation));
+
+    void* data = nullptr;
+    ASSERT_VK_SUCCESS(allocation->Map(&data));
+    ASSERT_NE(data, nullptr);
+    static_cast<uint8_t*>(data)[0] = 0xFF;
+    allocation->Unmap();
+
+    mDefaultAllocator->DestroyBuffer(buffer, allocation);
+}
+
+TEST_F(VKResourceAllocatorTests, CreateImage) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.RequiredPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VkImage image = VK_NULL_HANDLE;
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateImage(allocationDesc, CreateBasicImageInfo(64, 64),
+                                                     &image, &allocation));
+    ASSERT_NE(image, VK_NULL_HANDLE);
+
+    mDefaultAllocator->DestroyImage(image, allocation);
+}
+
+TEST_F(VKResourceAllocatorTests, ReleaseMemory) {
+    ALLOCATION_DESC allocationDesc = {};
+    allocationDesc.RequiredPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ResourceAllocation* allocation = nullptr;
+    ASSERT_VK_SUCCESS(mDefaultAllocator->CreateBuffer(
+        allocationDesc, CreateBasicBufferInfo(kDefaultBufferSize), &buffer, &allocation));
+    mDefaultAllocator->DestroyBuffer(buffer, allocation);
+
+    // The device memory remains pooled until released.
+    EXPECT_GT(mDefaultAllocator->QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_GT(mDefaultAllocator->ReleaseMemory(), 0u);
+}
+
+TEST_F(VKResourceAllocatorTests, QueryMemoryBudget) {
+    GPGMM_SKIP_TEST_IF(!mIsBudgetSupported);
+
+    ResidencyManager* residencyManager = mDefaultAllocator->GetResidencyManager();
+    ASSERT_NE(residencyManager, nullptr);
+
+    MEMORY_BUDGET_INFO budget = {};
+    ASSERT_VK_SUCCESS(residencyManager->QueryMemoryBudget(0, &budget));
+    EXPECT_GT(budget.Budget, 0u);
+    EXPECT_TRUE(residencyManager->IsWithinBudget(0, 0));
+}
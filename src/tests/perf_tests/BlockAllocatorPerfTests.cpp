@@ -0,0 +1,86 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/perf_tests/GPGMMPerfTests.h"
+
+#include "gpgmm/BuddyBlockAllocator.h"
+#include "gpgmm/SlabBlockAllocator.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kSlabBlockSize = 64;
+static constexpr uint64_t kSlabBlockCount = 4096;
+static constexpr uint64_t kBuddyMaxBlockSize = 1ull << 26;
+
+// Allocates then deallocates a single block, so the same block is re-used every time.
+static void SlabBlockAllocator_AllocateDeallocate(benchmark::State& state) {
+    SlabBlockAllocator allocator(kSlabBlockCount, kSlabBlockSize);
+    ScopedAllocationCounters counters(state, /*operationsPerIteration*/ 1);
+    for (auto _ : state) {
+        MemoryBlock* block = allocator.TryAllocateBlock(kSlabBlockSize);
+        benchmark::DoNotOptimize(block);
+        allocator.DeallocateBlock(block);
+    }
+}
+BENCHMARK(SlabBlockAllocator_AllocateDeallocate);
+
+// Allocates as many blocks as the arg before deallocating any of them.
+static void SlabBlockAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    const uint64_t blockCount = state.range(0);
+    SlabBlockAllocator allocator(kSlabBlockCount, kSlabBlockSize);
+    std::vector<MemoryBlock*> blocks(blockCount);
+    ScopedAllocationCounters counters(state, blockCount);
+    for (auto _ : state) {
+        for (MemoryBlock*& block : blocks) {
+            block = allocator.TryAllocateBlock(kSlabBlockSize);
+        }
+        benchmark::DoNotOptimize(blocks.data());
+        for (MemoryBlock* block : blocks) {
+            allocator.DeallocateBlock(block);
+        }
+    }
+}
+BENCHMARK(SlabBlockAllocator_AllocateDeallocateMany)->Arg(64)->Arg(kSlabBlockCount);
+
+static void BuddyBlockAllocator_AllocateDeallocate(benchmark::State& state) {
+    const uint64_t blockSize = state.range(0);
+    BuddyBlockAllocator allocator(kBuddyMaxBlockSize);
+    ScopedAllocationCounters counters(state, /*operationsPerIteration*/ 1);
+    for (auto _ : state) {
+        MemoryBlock* block = allocator.TryAllocateBlock(blockSize, /*alignment*/ 1);
+        benchmark::DoNotOptimize(block);
+        allocator.DeallocateBlock(block);
+    }
+}
+BENCHMARK(BuddyBlockAllocator_AllocateDeallocate)->Arg(256)->Arg(kBuddyMaxBlockSize / 2);
+
+// Allocates blocks of mixed power-of-two sizes, so blocks are split and merged at every level.
+static void BuddyBlockAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    const uint64_t blockCount = state.range(0);
+    BuddyBlockAllocator allocator(kBuddyMaxBlockSize);
+    std::vector<MemoryBlock*> blocks(blockCount);
+    ScopedAllocationCounters counters(state, blockCount);
+    for (auto _ : state) {
+        for (uint64_t i = 0; i < blockCount; i++) {
+            blocks[i] = allocator.TryAllocateBlock(256ull << (i % 8), /*alignment*/ 1);
+        }
+        benchmark::DoNotOptimize(blocks.data());
+        for (MemoryBlock* block : blocks) {
+            allocator.DeallocateBlock(block);
+        }
+    }
+}
+BENCHMARK(BuddyBlockAllocator_AllocateDeallocateMany)->Arg(64)->Arg(1024);
@@ -0,0 +1,196 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/perf_tests/GPGMMPerfTests.h"
+
+#include "gpgmm/d3d12/HeapD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResidencySetD3D12.h"
+#include "tests/D3D12MockDevice.h"
+
+#include <memory>
+#include <vector>
+
+using namespace gpgmm;
+using namespace gpgmm::d3d12;
+
+static constexpr uint64_t kHeapSize = 64 * 1024;
+
+// Heaps and the residency manager tracking them, on a mock device with a budget for
+// |residentHeapCount| heaps.
+class ResidencyManagerPerfFixture {
+  public:
+    ResidencyManagerPerfFixture(uint64_t heapCount,
+                                uint64_t residentHeapCount,
+                                EVICTION_POLICY evictionPolicy = EVICTION_POLICY_LRU) {
+        MOCK_DEVICE_DESC deviceDesc = {};
+        deviceDesc.LocalBudget = residentHeapCount * kHeapSize + kHeapSize / 2;
+        deviceDesc.NonLocalBudget = deviceDesc.LocalBudget;
+        mDevice = CreateMock<MockD3D12Device>(deviceDesc);
+        mAdapter = CreateMock<MockDXGIAdapter3>(mDevice.Get());
+        mQueue = CreateMock<MockD3D12CommandQueue>(mDevice.Get());
+
+        // Heaps are created resident, like the residency manager expects, before it queries the
+        // usage. Should they be over budget, the first submissions evict the excess.
+        for (uint64_t i = 0; i < heapCount; i++) {
+            ComPtr<MockD3D12Pageable> pageable =
+                mDevice->CreatePageable(kHeapSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+            mHeaps.push_back(
+                std::make_unique<Heap>(pageable, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, kHeapSize));
+        }
+
+        if (FAILED(ResidencyManager::CreateResidencyManager(
+                mDevice, mAdapter, /*isUMA*/ true, /*videoMemoryBudget*/ 1.0f,
+                /*availableForResourceBudget*/ 0, /*videoMemoryEvictSize*/ kHeapSize,
+                /*evictInBackground*/ false, /*offerPooledHeaps*/ false, evictionPolicy,
+                /*predictionSubmissionCount*/ 0, /*reservationSubmissionCount*/ 0,
+                &mResidencyManager))) {
+            mHeaps.clear();
+            return;
+        }
+
+        for (const auto& heap : mHeaps) {
+            if (FAILED(mResidencyManager->InsertHeap(heap.get()))) {
+                mHeaps.clear();
+                mResidencyManager = nullptr;
+                return;
+            }
+        }
+    }
+
+    ~ResidencyManagerPerfFixture() {
+        // Heaps are unlinked from the LRU cache of the residency manager, so they go first.
+        mHeaps.clear();
+        mResidencyManager = nullptr;
+    }
+
+    bool IsValid() const {
+        return mResidencyManager != nullptr;
+    }
+
+    // Submits |heapCount| heaps starting |heapOffset| heaps after |firstHeap|, wrapping back to
+    // |firstHeap| past the last heap.
+    HRESULT Submit(uint64_t firstHeap, uint64_t heapCount, uint64_t heapOffset = 0) {
+        mResidencySet.Reset();
+        const uint64_t rangeSize = mHeaps.size() - firstHeap;
+        for (uint64_t i = 0; i < heapCount; i++) {
+            mResidencySet.Insert(mHeaps[firstHeap + (heapOffset + i) % rangeSize].get());
+        }
+        ID3D12CommandList* commandList = nullptr;
+        ResidencySet* residencySet = &mResidencySet;
+        return mResidencyManager->ExecuteCommandLists(mQueue.Get(), &commandList, &residencySet,
+                                                      1);
+    }
+
+    ResidencyManager* GetResidencyManager() const {
+        return mResidencyManager.Get();
+    }
+
+  private:
+    ComPtr<MockD3D12Device> mDevice;
+    ComPtr<MockDXGIAdapter3> mAdapter;
+    ComPtr<MockD3D12CommandQueue> mQueue;
+    ComPtr<ResidencyManager> mResidencyManager;
+    std::vector<std::unique_ptr<Heap>> mHeaps;
+    ResidencySet mResidencySet;
+};
+
+// Submits the same heaps every iteration, all of them already resident, which is the overhead
+// each submission pays when under budget.
+static void D3D12ResidencyManager_ExecuteCommandLists(benchmark::State& state) {
+    const uint64_t heapCount = state.range(0);
+    ResidencyManagerPerfFixture fixture(heapCount, /*residentHeapCount*/ heapCount);
+    if (!fixture.IsValid() || FAILED(fixture.Submit(0, heapCount))) {
+        state.SkipWithError("Failed to create the residency manager.");
+        return;
+    }
+
+    ScopedAllocationCounters counters(state, heapCount);
+    for (auto _ : state) {
+        if (FAILED(fixture.Submit(0, heapCount))) {
+            state.SkipWithError("ExecuteCommandLists failed.");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * heapCount);
+}
+BENCHMARK(D3D12ResidencyManager_ExecuteCommandLists)->Arg(1024)->Arg(4096);
+
+// Evicts every resident heap at once, such as when the budget suddenly shrinks.
+static void D3D12ResidencyManager_EvictionStorm(benchmark::State& state) {
+    const uint64_t heapCount = state.range(0);
+    ResidencyManagerPerfFixture fixture(heapCount, /*residentHeapCount*/ heapCount);
+    if (!fixture.IsValid()) {
+        state.SkipWithError("Failed to create the residency manager.");
+        return;
+    }
+
+    ScopedAllocationCounters counters(state, heapCount);
+    for (auto _ : state) {
+        state.PauseTiming();
+        const HRESULT hr = fixture.Submit(0, heapCount);
+        state.ResumeTiming();
+        if (FAILED(hr) || FAILED(fixture.GetResidencyManager()->Evict(
+                              heapCount * kHeapSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL))) {
+            state.SkipWithError("Evict failed.");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * heapCount);
+}
+BENCHMARK(D3D12ResidencyManager_EvictionStorm)->Arg(1024)->Arg(4096);
+
+// Submits a hot set of heaps every frame along with a window of cold heaps, which cycles
+// through the rest, over a budget for three quarters of the heaps. Reports the hit rate, the
+// ratio of heaps submitted which were already resident, so eviction policies can be compared.
+static void D3D12ResidencyManager_WorkingSetHitRate(benchmark::State& state) {
+    const EVICTION_POLICY evictionPolicy = static_cast<EVICTION_POLICY>(state.range(0));
+    const uint64_t heapCount = state.range(1);
+    const uint64_t hotHeapCount = heapCount / 4;
+    const uint64_t coldHeapCount = heapCount - hotHeapCount;
+    const uint64_t coldWindowSize = heapCount / 4;
+
+    ResidencyManagerPerfFixture fixture(heapCount, /*residentHeapCount*/ heapCount * 3 / 4,
+                                        evictionPolicy);
+    if (!fixture.IsValid()) {
+        state.SkipWithError("Failed to create the residency manager.");
+        return;
+    }
+
+    const uint64_t madeResidentCountBefore =
+        fixture.GetResidencyManager()->QueryStats().Total.MadeResidentCount;
+
+    uint64_t coldWindowOffset = 0;
+    uint64_t submittedHeapCount = 0;
+    for (auto _ : state) {
+        if (FAILED(fixture.Submit(0, hotHeapCount)) ||
+            FAILED(fixture.Submit(hotHeapCount, coldWindowSize, coldWindowOffset))) {
+            state.SkipWithError("ExecuteCommandLists failed.");
+            break;
+        }
+        coldWindowOffset = (coldWindowOffset + coldWindowSize / 2) % coldHeapCount;
+        submittedHeapCount += hotHeapCount + coldWindowSize;
+    }
+
+    const uint64_t madeResidentCount =
+        fixture.GetResidencyManager()->QueryStats().Total.MadeResidentCount -
+        madeResidentCountBefore;
+    if (submittedHeapCount > 0) {
+        state.counters["HitRate"] =
+            1.0 - static_cast<double>(madeResidentCount) / submittedHeapCount;
+    }
+    state.SetItemsProcessed(submittedHeapCount);
+}
+BENCHMARK(D3D12ResidencyManager_WorkingSetHitRate)
+    ->ArgsProduct({{EVICTION_POLICY_LRU, EVICTION_POLICY_LFU}, {1024, 4096}});
@@ -0,0 +1,80 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/perf_tests/GPGMMPerfTests.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<uint64_t> gHeapAllocationCount{0};
+
+}  // namespace
+
+// Replaces the global operator new so heap allocations can be counted. The array and sized
+// forms call these by default.
+void* operator new(size_t size) {
+    gHeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc((size > 0) ? size : 1);
+    if (ptr == nullptr) {
+        std::abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+namespace gpgmm {
+
+    uint64_t GetHeapAllocationCount() {
+        return gHeapAllocationCount.load(std::memory_order_relaxed);
+    }
+
+    ScopedAllocationCounters::ScopedAllocationCounters(
+        benchmark::State& state,
+        uint64_t operationsPerIteration,
+        const CountingMemoryAllocator* memoryAllocator)
+        : mState(state),
+          mOperationsPerIteration(operationsPerIteration),
+          mMemoryAllocator(memoryAllocator),
+          mHeapAllocationCountBefore(GetHeapAllocationCount()),
+          mMemoryAllocationCountBefore(
+              (memoryAllocator != nullptr) ? memoryAllocator->GetAllocationCount() : 0) {
+    }
+
+    ScopedAllocationCounters::~ScopedAllocationCounters() {
+        mState.SetItemsProcessed(mState.iterations() * mOperationsPerIteration);
+
+        if (mState.thread_index() != 0) {
+            return;
+        }
+
+        // Counters are summed over threads, then divided by the iterations of every thread.
+        const double operationsPerIteration = static_cast<double>(mOperationsPerIteration);
+        mState.counters["HeapAllocsPerOp"] = benchmark::Counter(
+            (GetHeapAllocationCount() - mHeapAllocationCountBefore) / operationsPerIteration,
+            benchmark::Counter::kAvgIterations);
+
+        if (mMemoryAllocator != nullptr) {
+            mState.counters["MemoryAllocsPerOp"] = benchmark::Counter(
+                (mMemoryAllocator->GetAllocationCount() - mMemoryAllocationCountBefore) /
+                    operationsPerIteration,
+                benchmark::Counter::kAvgIterations);
+        }
+    }
+
+}  // namespace gpgmm
@@ -0,0 +1,69 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TESTS_PERF_TESTS_GPGMMPERFTESTS_H_
+#define TESTS_PERF_TESTS_GPGMMPERFTESTS_H_
+
+#include <benchmark/benchmark.h>
+
+#include "tests/DummyMemoryAllocator.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace gpgmm {
+
+    // Number of times the process called operator new so far.
+    uint64_t GetHeapAllocationCount();
+
+    // DummyMemoryAllocator which counts every memory it allocates.
+    class CountingMemoryAllocator final : public DummyMemoryAllocator {
+      public:
+        std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+            const MEMORY_ALLOCATION_REQUEST& request) override {
+            mAllocationCount.fetch_add(1, std::memory_order_relaxed);
+            return DummyMemoryAllocator::TryAllocateMemory(request);
+        }
+
+        uint64_t GetAllocationCount() const {
+            return mAllocationCount.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<uint64_t> mAllocationCount{0};
+    };
+
+    // Reports, per operation, the heap allocations made by the process and the memory allocated
+    // from |memoryAllocator| (if any) while the benchmark ran. With multiple threads, only the
+    // first thread reports, and the counts of every thread are divided by the operations of all
+    // threads.
+    class ScopedAllocationCounters {
+      public:
+        ScopedAllocationCounters(benchmark::State& state,
+                                 uint64_t operationsPerIteration,
+                                 const CountingMemoryAllocator* memoryAllocator = nullptr);
+        ~ScopedAllocationCounters();
+
+      private:
+        benchmark::State& mState;
+        const uint64_t mOperationsPerIteration;
+        const CountingMemoryAllocator* mMemoryAllocator;
+
+        const uint64_t mHeapAllocationCountBefore;
+        const uint64_t mMemoryAllocationCountBefore;
+    };
+
+}  // namespace gpgmm
+
+#endif  // TESTS_PERF_TESTS_GPGMMPERFTESTS_H_
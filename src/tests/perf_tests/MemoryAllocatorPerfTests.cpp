@@ -0,0 +1,233 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/perf_tests/GPGMMPerfTests.h"
+
+#include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/LinearMemoryAllocator.h"
+#include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/SlabMemoryAllocator.h"
+#include "gpgmm/common/Utils.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kBlockSize = 256;
+static constexpr uint64_t kMemorySize = 4ull * 1024 * 1024;
+static constexpr uint64_t kMemoryAlignment = 1;
+
+// Memory allocators are shared by every thread of a benchmark. The first thread creates them
+// before the others start and destroys them once all of them stopped.
+static std::unique_ptr<MemoryAllocator> gMemoryAllocator;
+static std::unique_ptr<CountingMemoryAllocator> gSlabMemoryAllocatorChild;
+static CountingMemoryAllocator* gCountingAllocator = nullptr;
+
+static int GetMaxThreadCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+static void CreateSlabMemoryAllocator() {
+    gSlabMemoryAllocatorChild = std::make_unique<CountingMemoryAllocator>();
+    gCountingAllocator = gSlabMemoryAllocatorChild.get();
+    gMemoryAllocator = std::make_unique<SlabMemoryAllocator>(
+        kBlockSize, /*maxSlabSize*/ kMemorySize, /*slabSize*/ 64 * 1024, kMemoryAlignment,
+        /*slabFragmentationLimit*/ 0.125, /*prefetchSlab*/ false, gCountingAllocator);
+}
+
+static void CreateBuddyMemoryAllocator() {
+    std::unique_ptr<CountingMemoryAllocator> countingAllocator =
+        std::make_unique<CountingMemoryAllocator>();
+    gCountingAllocator = countingAllocator.get();
+    gMemoryAllocator =
+        std::make_unique<BuddyMemoryAllocator>(/*systemSize*/ kMemorySize * 64, kMemorySize,
+                                               kMemoryAlignment, std::move(countingAllocator));
+}
+
+static void CreateSegmentedMemoryAllocator() {
+    std::unique_ptr<CountingMemoryAllocator> countingAllocator =
+        std::make_unique<CountingMemoryAllocator>();
+    gCountingAllocator = countingAllocator.get();
+    gMemoryAllocator =
+        std::make_unique<SegmentedMemoryAllocator>(std::move(countingAllocator), kMemoryAlignment);
+}
+
+// Composes the same chain the resource allocator uses for sub-allocated resources, so the cost
+// of calling through every layer can be compared against each layer alone.
+static void CreateMemoryAllocatorChain() {
+    std::unique_ptr<CountingMemoryAllocator> countingAllocator =
+        std::make_unique<CountingMemoryAllocator>();
+    gCountingAllocator = countingAllocator.get();
+    gMemoryAllocator = std::make_unique<SlabCacheAllocator>(
+        kBlockSize, /*maxSlabSize*/ kMemorySize, /*slabSize*/ 64 * 1024, kMemoryAlignment,
+        /*slabFragmentationLimit*/ 0.125, /*prefetchSlab*/ false,
+        std::make_unique<BuddyMemoryAllocator>(
+            /*systemSize*/ kMemorySize * 64, kMemorySize, kMemoryAlignment,
+            std::make_unique<SegmentedMemoryAllocator>(std::move(countingAllocator),
+                                                       kMemoryAlignment)));
+}
+
+// Memory is pooled like the resource heaps of a pool, so none is created once the first
+// iteration is done.
+static void CreateLinearMemoryAllocator() {
+    std::unique_ptr<CountingMemoryAllocator> countingAllocator =
+        std::make_unique<CountingMemoryAllocator>();
+    gCountingAllocator = countingAllocator.get();
+    gMemoryAllocator = std::make_unique<LinearMemoryAllocator>(
+        kMemorySize, kMemoryAlignment,
+        std::make_unique<SegmentedMemoryAllocator>(std::move(countingAllocator),
+                                                   kMemoryAlignment));
+}
+
+static void DestroyMemoryAllocator() {
+    gMemoryAllocator.reset();
+    gSlabMemoryAllocatorChild.reset();
+    gCountingAllocator = nullptr;
+}
+
+// Allocates then deallocates one allocation per iteration, from each thread at once.
+template <void (*CreateMemoryAllocator)()>
+static void AllocateDeallocate(benchmark::State& state, uint64_t allocationSize) {
+    if (state.thread_index() == 0) {
+        CreateMemoryAllocator();
+    }
+
+    {
+        ScopedAllocationCounters counters(state, /*operationsPerIteration*/ 1,
+                                          gCountingAllocator);
+        for (auto _ : state) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                gMemoryAllocator->TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
+            benchmark::DoNotOptimize(allocation.get());
+            gMemoryAllocator->DeallocateMemory(std::move(allocation));
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        DestroyMemoryAllocator();
+    }
+}
+
+// Allocates as many allocations as the arg before deallocating any of them, so the allocator
+// must grow then shrink every iteration.
+template <void (*CreateMemoryAllocator)()>
+static void AllocateDeallocateMany(benchmark::State& state, uint64_t allocationSize) {
+    CreateMemoryAllocator();
+
+    const uint64_t allocationCount = state.range(0);
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations(allocationCount);
+    {
+        ScopedAllocationCounters counters(state, allocationCount, gCountingAllocator);
+        for (auto _ : state) {
+            for (auto& allocation : allocations) {
+                allocation =
+                    gMemoryAllocator->TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
+            }
+            benchmark::DoNotOptimize(allocations.data());
+            for (auto& allocation : allocations) {
+                gMemoryAllocator->DeallocateMemory(std::move(allocation));
+            }
+        }
+    }
+
+    DestroyMemoryAllocator();
+}
+
+static void SlabMemoryAllocator_AllocateDeallocate(benchmark::State& state) {
+    AllocateDeallocate<CreateSlabMemoryAllocator>(state, kBlockSize);
+}
+BENCHMARK(SlabMemoryAllocator_AllocateDeallocate)
+    ->ThreadRange(1, GetMaxThreadCount())
+    ->UseRealTime();
+
+static void SlabMemoryAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    AllocateDeallocateMany<CreateSlabMemoryAllocator>(state, kBlockSize);
+}
+BENCHMARK(SlabMemoryAllocator_AllocateDeallocateMany)->Arg(64)->Arg(1024);
+
+static void BuddyMemoryAllocator_AllocateDeallocate(benchmark::State& state) {
+    AllocateDeallocate<CreateBuddyMemoryAllocator>(state, kBlockSize);
+}
+BENCHMARK(BuddyMemoryAllocator_AllocateDeallocate)
+    ->ThreadRange(1, GetMaxThreadCount())
+    ->UseRealTime();
+
+static void BuddyMemoryAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    AllocateDeallocateMany<CreateBuddyMemoryAllocator>(state, kBlockSize);
+}
+BENCHMARK(BuddyMemoryAllocator_AllocateDeallocateMany)->Arg(64)->Arg(1024);
+
+// Every allocation is a whole segment, so it is always served by the pool.
+static void SegmentedMemoryAllocator_AllocateDeallocate(benchmark::State& state) {
+    AllocateDeallocate<CreateSegmentedMemoryAllocator>(state, kMemorySize);
+}
+BENCHMARK(SegmentedMemoryAllocator_AllocateDeallocate)
+    ->ThreadRange(1, GetMaxThreadCount())
+    ->UseRealTime();
+
+static void SegmentedMemoryAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    AllocateDeallocateMany<CreateSegmentedMemoryAllocator>(state, kMemorySize);
+}
+BENCHMARK(SegmentedMemoryAllocator_AllocateDeallocateMany)->Arg(64)->Arg(1024);
+
+static void MemoryAllocatorChain_AllocateDeallocate(benchmark::State& state) {
+    AllocateDeallocate<CreateMemoryAllocatorChain>(state, kBlockSize);
+}
+BENCHMARK(MemoryAllocatorChain_AllocateDeallocate)
+    ->ThreadRange(1, GetMaxThreadCount())
+    ->UseRealTime();
+
+static void MemoryAllocatorChain_AllocateDeallocateMany(benchmark::State& state) {
+    AllocateDeallocateMany<CreateMemoryAllocatorChain>(state, kBlockSize);
+}
+BENCHMARK(MemoryAllocatorChain_AllocateDeallocateMany)->Arg(64)->Arg(1024);
+
+// Allocations are freed the way a linear allocator is meant to be used: deallocated in any order
+// then reset all at once. Compare against MemoryAllocatorChain_AllocateDeallocateMany, which uses
+// a SlabCacheAllocator.
+static void LinearMemoryAllocator_AllocateDeallocateMany(benchmark::State& state) {
+    CreateLinearMemoryAllocator();
+    LinearMemoryAllocator* linearMemoryAllocator =
+        static_cast<LinearMemoryAllocator*>(gMemoryAllocator.get());
+
+    const uint64_t allocationCount = state.range(0);
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations(allocationCount);
+    {
+        ScopedAllocationCounters counters(state, allocationCount, gCountingAllocator);
+        for (auto _ : state) {
+            for (auto& allocation : allocations) {
+                allocation =
+                    gMemoryAllocator->TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+            }
+            benchmark::DoNotOptimize(allocations.data());
+            for (auto& allocation : allocations) {
+                gMemoryAllocator->DeallocateMemory(std::move(allocation));
+            }
+            linearMemoryAllocator->Reset();
+        }
+    }
+
+    DestroyMemoryAllocator();
+}
+BENCHMARK(LinearMemoryAllocator_AllocateDeallocateMany)->Arg(64)->Arg(1024);
+
+// Deallocating the only allocation pops it, so no reset is needed. Single-threaded, since
+// allocations of other threads would be deallocated out of order.
+static void LinearMemoryAllocator_AllocateDeallocate(benchmark::State& state) {
+    AllocateDeallocate<CreateLinearMemoryAllocator>(state, kBlockSize);
+}
+BENCHMARK(LinearMemoryAllocator_AllocateDeallocate);
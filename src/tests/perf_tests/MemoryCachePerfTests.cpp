@@ -0,0 +1,76 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tests/perf_tests/GPGMMPerfTests.h"
+
+#include "gpgmm/MemoryCache.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+namespace {
+
+    struct FakeObject {
+        FakeObject(size_t key = 0) : mKey(key) {
+        }
+        size_t GetKey() const {
+            return mKey;
+        }
+        size_t mKey;
+    };
+
+}  // namespace
+
+// Looks up an entry already in the cache.
+static void MemoryCache_GetOrCreateHit(benchmark::State& state) {
+    MemoryCache<FakeObject> cache;
+    auto entry = cache.GetOrCreate(FakeObject{0}, /*keepAlive*/ false);
+    ScopedAllocationCounters counters(state, /*operationsPerIteration*/ 1);
+    for (auto _ : state) {
+        auto sameEntry = cache.GetOrCreate(FakeObject{0}, /*keepAlive*/ false);
+        benchmark::DoNotOptimize(sameEntry.Get());
+    }
+}
+BENCHMARK(MemoryCache_GetOrCreateHit);
+
+// Inserts an entry then removes it once it goes out of scope.
+static void MemoryCache_GetOrCreateMiss(benchmark::State& state) {
+    MemoryCache<FakeObject> cache;
+    ScopedAllocationCounters counters(state, /*operationsPerIteration*/ 1);
+    for (auto _ : state) {
+        auto entry = cache.GetOrCreate(FakeObject{0}, /*keepAlive*/ false);
+        benchmark::DoNotOptimize(entry.Get());
+    }
+}
+BENCHMARK(MemoryCache_GetOrCreateMiss);
+
+// Looks up entries in a cache holding as many entries as the arg.
+static void MemoryCache_GetOrCreateHitMany(benchmark::State& state) {
+    const size_t entryCount = state.range(0);
+    MemoryCache<FakeObject> cache;
+    std::vector<ScopedRef<CacheEntry<FakeObject>>> entries;
+    for (size_t i = 0; i < entryCount; i++) {
+        entries.push_back(cache.GetOrCreate(FakeObject{i}, /*keepAlive*/ false));
+    }
+
+    ScopedAllocationCounters counters(state, entryCount);
+    for (auto _ : state) {
+        for (size_t i = 0; i < entryCount; i++) {
+            auto entry = cache.GetOrCreate(FakeObject{i}, /*keepAlive*/ false);
+            benchmark::DoNotOptimize(entry.Get());
+        }
+    }
+}
+BENCHMARK(MemoryCache_GetOrCreateHitMany)->Arg(64)->Arg(4096);
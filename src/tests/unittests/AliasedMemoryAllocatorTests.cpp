@@ -0,0 +1,127 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/AliasedMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemoryAlignment = 1u;
+
+// Verify requests used at the same time never overlap while the others alias.
+TEST(AliasedMemoryAllocatorTests, PackRequests) {
+    std::vector<uint64_t> offsets;
+
+    // Every request used at once.
+    EXPECT_EQ(AliasedMemoryAllocator::PackRequests(
+                  {{64, 1, 0, 2}, {32, 1, 0, 2}, {16, 1, 0, 2}}, &offsets),
+              112u);
+    EXPECT_EQ(offsets, (std::vector<uint64_t>{0, 64, 96}));
+
+    // No request used at the same time.
+    EXPECT_EQ(AliasedMemoryAllocator::PackRequests(
+                  {{64, 1, 0, 0}, {32, 1, 1, 1}, {16, 1, 2, 2}}, &offsets),
+              64u);
+    EXPECT_EQ(offsets, (std::vector<uint64_t>{0, 0, 0}));
+
+    // Lifetimes are inclusive, so requests which share a pass conflict.
+    EXPECT_EQ(AliasedMemoryAllocator::PackRequests({{64, 1, 0, 1}, {64, 1, 1, 2}}, &offsets),
+              128u);
+    EXPECT_EQ(offsets, (std::vector<uint64_t>{0, 64}));
+
+    // Smaller requests fill the gap left by one which is no longer used.
+    // A: [0, 64) for passes 0-3, B: [64, 128) for passes 0-1, C and D re-use B after pass 1.
+    EXPECT_EQ(AliasedMemoryAllocator::PackRequests(
+                  {{64, 1, 0, 3}, {64, 1, 0, 1}, {32, 1, 2, 3}, {32, 1, 2, 3}}, &offsets),
+              128u);
+    EXPECT_EQ(offsets, (std::vector<uint64_t>{0, 64, 64, 96}));
+
+    // Gaps too small after alignment are skipped.
+    EXPECT_EQ(AliasedMemoryAllocator::PackRequests({{48, 1, 0, 0}, {16, 64, 0, 0}}, &offsets),
+              80u);
+    EXPECT_EQ(offsets, (std::vector<uint64_t>{0, 64}));
+}
+
+TEST(AliasedMemoryAllocatorTests, SingleMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    AliasedMemoryAllocator allocator(std::move(dummyMemoryAllocator), kDefaultMemoryAlignment);
+
+    // Invalid requests are not allocated.
+    EXPECT_TRUE(allocator.TryAllocateAliasedMemory({}, false).empty());
+    EXPECT_TRUE(allocator.TryAllocateAliasedMemory({{0, 1, 0, 0}}, false).empty());
+    EXPECT_TRUE(allocator.TryAllocateAliasedMemory({{32, 1, 1, 0}}, false).empty());
+    EXPECT_TRUE(allocator.TryAllocateAliasedMemory({{32, 1, 0, 0}}, true).empty());
+
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations =
+        allocator.TryAllocateAliasedMemory({{64, 1, 0, 0}, {32, 1, 1, 1}, {32, 1, 1, 1}}, false);
+    ASSERT_EQ(allocations.size(), 3u);
+
+    EXPECT_EQ(allocations[0]->GetOffset(), 0u);
+    EXPECT_EQ(allocations[0]->GetSize(), 64u);
+    EXPECT_EQ(allocations[1]->GetOffset(), 0u);
+    EXPECT_EQ(allocations[2]->GetOffset(), 32u);
+
+    for (const auto& allocation : allocations) {
+        EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
+        EXPECT_EQ(allocation->GetMemory(), allocations[0]->GetMemory());
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 3u);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 128u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryUsage, 64u);
+
+    // Memory is only released once every allocation within it was.
+    allocator.DeallocateMemory(std::move(allocations[0]));
+    allocator.DeallocateMemory(std::move(allocations[1]));
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    allocator.DeallocateMemory(std::move(allocations[2]));
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+}
+
+// Verify each group of requests is allocated from separate memory.
+TEST(AliasedMemoryAllocatorTests, MultipleMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    AliasedMemoryAllocator allocator(std::move(dummyMemoryAllocator), kDefaultMemoryAlignment);
+
+    std::vector<std::unique_ptr<MemoryAllocation>> firstAllocations =
+        allocator.TryAllocateAliasedMemory({{64, 1, 0, 0}, {64, 1, 1, 1}}, false);
+    ASSERT_EQ(firstAllocations.size(), 2u);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_NE(secondAllocation->GetMemory(), firstAllocations[0]->GetMemory());
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 2u);
+
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    for (auto& allocation : firstAllocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 0u);
+}
@@ -0,0 +1,97 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/AllocationPredictor.h"
+
+using namespace gpgmm;
+
+// Verify nothing is predicted until a size followed another at-least twice.
+TEST(AllocationPredictorTests, Empty) {
+    AllocationPredictor predictor;
+    EXPECT_EQ(predictor.Predict(), kInvalidSize);
+
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), kInvalidSize);
+
+    predictor.Record(128);
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), kInvalidSize);
+
+    predictor.Record(128);
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), 128u);
+}
+
+// Verify a repeated sequence of sizes gets predicted.
+TEST(AllocationPredictorTests, RepeatedSequence) {
+    AllocationPredictor predictor;
+    const uint64_t sequence[] = {64, 256, 1024, 512};
+
+    for (size_t i = 0; i < 2; i++) {
+        for (uint64_t size : sequence) {
+            predictor.Record(size);
+        }
+    }
+
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), 256u);
+    predictor.Record(256);
+    EXPECT_EQ(predictor.Predict(), 1024u);
+    predictor.Record(1024);
+    EXPECT_EQ(predictor.Predict(), 512u);
+    predictor.Record(512);
+    EXPECT_EQ(predictor.Predict(), 64u);
+
+    EXPECT_EQ(predictor.GetSizeCountForTesting(), 4u);
+}
+
+// Verify the size which most often followed is predicted, and a new size can take over.
+TEST(AllocationPredictorTests, MostFrequent) {
+    AllocationPredictor predictor;
+    for (size_t i = 0; i < 4; i++) {
+        predictor.Record(64);
+        predictor.Record(128);
+    }
+
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), 128u);
+
+    // Counts are halved once saturated, which the size following more often takes over.
+    for (size_t i = 0; i < 100; i++) {
+        predictor.Record(64);
+        predictor.Record(256);
+    }
+
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), 256u);
+}
+
+// Verify sizes seen once only replace the least frequent successor.
+TEST(AllocationPredictorTests, ManySuccessors) {
+    AllocationPredictor predictor;
+    for (size_t i = 0; i < 3; i++) {
+        predictor.Record(64);
+        predictor.Record(128);
+    }
+
+    for (uint64_t size = 1; size <= 16; size++) {
+        predictor.Record(64);
+        predictor.Record(size * 1024);
+    }
+
+    predictor.Record(64);
+    EXPECT_EQ(predictor.Predict(), 128u);
+}
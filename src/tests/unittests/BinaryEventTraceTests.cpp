@@ -0,0 +1,108 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/BinaryEventTrace.h"
+#include "gpgmm/EventTraceWriter.h"
+#include "gpgmm/common/PlatformUtils.h"
+
+#include <sstream>
+#include <string>
+
+using namespace gpgmm;
+
+// Verify events converted from a binary trace match those written as JSON.
+TEST(BinaryEventTraceTests, ConvertToJSON) {
+    JSONDict args;
+    args.AddItem("Size", 64u);
+
+    std::stringstream binaryTrace;
+    BinaryEventTraceEncoder encoder(&binaryTrace);
+
+    // Events are split across chunks, and the second refers to strings of the first.
+    encoder.AddEvent(TRACE_EVENT_PHASE_BEGIN, TraceEventCategory::Default, "Allocate", 0, 1, 10,
+                     TRACE_EVENT_FLAG_NONE, "");
+    encoder.Flush();
+    encoder.AddEvent(TRACE_EVENT_PHASE_SNAPSHOT_OBJECT, TraceEventCategory::Default, "Allocate",
+                     0xff, 2, 20, TRACE_EVENT_FLAG_HAS_ID, args.ToString());
+    encoder.AddEvent(TRACE_EVENT_PHASE_END, TraceEventCategory::Default, "Allocate", 0, 1, 30,
+                     TRACE_EVENT_FLAG_NONE, "");
+    encoder.Flush();
+
+    std::stringstream jsonTrace;
+    ASSERT_TRUE(ConvertBinaryEventTraceToJSON(binaryTrace, jsonTrace));
+
+    const uint32_t pid = GetPID();
+    JSONArray traceEvents;
+    traceEvents.AddItem(EventTraceWriter::SerializeEvent(TRACE_EVENT_PHASE_BEGIN,
+                                                         TraceEventCategory::Default, "Allocate",
+                                                         0, 1, 10, TRACE_EVENT_FLAG_NONE, pid, ""));
+    traceEvents.AddItem(EventTraceWriter::SerializeEvent(
+        TRACE_EVENT_PHASE_SNAPSHOT_OBJECT, TraceEventCategory::Default, "Allocate", 0xff, 2, 20,
+        TRACE_EVENT_FLAG_HAS_ID, pid, args.ToString()));
+    traceEvents.AddItem(EventTraceWriter::SerializeEvent(TRACE_EVENT_PHASE_END,
+                                                         TraceEventCategory::Default, "Allocate",
+                                                         0, 1, 30, TRACE_EVENT_FLAG_NONE, pid, ""));
+    JSONDict traceData;
+    traceData.AddItem("traceEvents", traceEvents);
+
+    EXPECT_EQ(jsonTrace.str(), traceData.ToString());
+}
+
+// Verify strings are only written once per trace.
+TEST(BinaryEventTraceTests, InternStrings) {
+    std::stringstream binaryTrace;
+    BinaryEventTraceEncoder encoder(&binaryTrace);
+    const size_t headerSize = binaryTrace.str().size();
+
+    encoder.AddEvent(TRACE_EVENT_PHASE_INSTANT, TraceEventCategory::Default, "Event", 0, 1, 0,
+                     TRACE_EVENT_FLAG_NONE, "");
+    encoder.Flush();
+    const size_t firstChunkSize = binaryTrace.str().size() - headerSize;
+
+    encoder.AddEvent(TRACE_EVENT_PHASE_INSTANT, TraceEventCategory::Default, "Event", 0, 1, 0,
+                     TRACE_EVENT_FLAG_NONE, "");
+    encoder.Flush();
+    const size_t secondChunkSize = binaryTrace.str().size() - headerSize - firstChunkSize;
+
+    EXPECT_EQ(secondChunkSize,
+              sizeof(BINARY_EVENT_TRACE_CHUNK_HEADER) + sizeof(BINARY_EVENT_TRACE_RECORD));
+    EXPECT_GT(firstChunkSize, secondChunkSize);
+}
+
+TEST(BinaryEventTraceTests, Malformed) {
+    std::stringstream jsonTrace;
+
+    std::stringstream emptyTrace;
+    EXPECT_FALSE(ConvertBinaryEventTraceToJSON(emptyTrace, jsonTrace));
+
+    std::stringstream notATrace("{ \"traceEvents\": [ ] }");
+    EXPECT_FALSE(ConvertBinaryEventTraceToJSON(notATrace, jsonTrace));
+
+    // Events cannot refer to strings which were never written.
+    std::stringstream binaryTrace;
+    BinaryEventTraceEncoder encoder(&binaryTrace);
+    encoder.AddEvent(TRACE_EVENT_PHASE_INSTANT, TraceEventCategory::Default, "Event", 0, 1, 0,
+                     TRACE_EVENT_FLAG_NONE, "");
+    encoder.Flush();
+
+    std::string truncatedTrace = binaryTrace.str();
+    const size_t stringsChunkSize = sizeof(BINARY_EVENT_TRACE_CHUNK_HEADER) + sizeof(uint32_t) +
+                                    std::string("Event").size();
+    truncatedTrace.erase(sizeof(BINARY_EVENT_TRACE_HEADER), stringsChunkSize);
+
+    std::stringstream missingStringsTrace(truncatedTrace);
+    EXPECT_FALSE(ConvertBinaryEventTraceToJSON(missingStringsTrace, jsonTrace));
+}
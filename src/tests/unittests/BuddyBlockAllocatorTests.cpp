@@ -16,6 +16,10 @@
 #include <gtest/gtest.h>
 
 #include "gpgmm/BuddyBlockAllocator.h"
+#include "gpgmm/FlatBuddyBlockAllocator.h"
+
+#include <string>
+#include <vector>
 
 using namespace gpgmm;
 
@@ -345,3 +349,303 @@ TEST(BuddyBlockAllocatorTests, VariousSizeSameAlignment) {
 
     ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
 }
+
+// Verify the flat buddy allocator splits and merges blocks like the buddy allocator.
+TEST(FlatBuddyBlockAllocatorTests, SingleSplitBlock) {
+    constexpr uint64_t maxBlockSize = 32;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    // Check that we cannot allocate a oversized or zero sized block.
+    ASSERT_EQ(allocator.TryAllocateBlock(maxBlockSize * 2, 1), nullptr);
+    ASSERT_EQ(allocator.TryAllocateBlock(0u, 1), nullptr);
+
+    // Allocate block (splits two blocks).
+    MemoryBlock* block = allocator.TryAllocateBlock(8, 1);
+    ASSERT_EQ(block->Offset, 0u);
+    ASSERT_EQ(block->Size, 8u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+
+    // Allocate its buddy then the remaining half.
+    MemoryBlock* buddyBlock = allocator.TryAllocateBlock(8, 1);
+    ASSERT_EQ(buddyBlock->Offset, 8u);
+    MemoryBlock* halfBlock = allocator.TryAllocateBlock(16, 1);
+    ASSERT_EQ(halfBlock->Offset, 16u);
+
+    // Check that we are full.
+    ASSERT_EQ(allocator.TryAllocateBlock(1, 1), nullptr);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+
+    // Deallocate blocks (merges back into the root).
+    allocator.DeallocateBlock(block);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+    allocator.DeallocateBlock(halfBlock);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+    allocator.DeallocateBlock(buddyBlock);
+
+    // Re-allocate the largest block allowed after merging.
+    block = allocator.TryAllocateBlock(maxBlockSize, 1);
+    ASSERT_EQ(block->Offset, 0u);
+    allocator.DeallocateBlock(block);
+}
+
+// Verify the flat buddy allocator never allocates blocks smaller than the minimum block size.
+TEST(FlatBuddyBlockAllocatorTests, MinBlockSize) {
+    constexpr uint64_t maxBlockSize = 64;
+    constexpr uint64_t minBlockSize = 16;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, maxBlockSize, minBlockSize);
+
+    for (uint64_t blocki = 0; blocki < maxBlockSize / minBlockSize; blocki++) {
+        MemoryBlock* block = allocator.TryAllocateBlock(1, 1);
+        ASSERT_EQ(block->Offset, blocki * minBlockSize);
+        ASSERT_EQ(block->Size, minBlockSize);
+    }
+
+    ASSERT_EQ(allocator.TryAllocateBlock(1, 1), nullptr);
+}
+
+// Verify the flat buddy allocator respects alignments larger than the block size.
+TEST(FlatBuddyBlockAllocatorTests, VariousAlignment) {
+    constexpr uint64_t maxBlockSize = 32;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    ASSERT_EQ(allocator.TryAllocateBlock(8, 8)->Offset, 0u);
+    ASSERT_EQ(allocator.TryAllocateBlock(8, 16)->Offset, 16u);
+
+    // Check that we cannot fit another 16 byte aligned block.
+    ASSERT_EQ(allocator.TryAllocateBlock(8, 16), nullptr);
+
+    // Remaining blocks are only 8 byte aligned.
+    ASSERT_EQ(allocator.TryAllocateBlock(8, 8)->Offset, 8u);
+    ASSERT_EQ(allocator.TryAllocateBlock(8, 8)->Offset, 24u);
+
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+}
+
+// Verify the flat buddy allocator only creates trees for roots in use.
+TEST(FlatBuddyBlockAllocatorTests, MultipleRoots) {
+    constexpr uint64_t maxBlockSize = 1ull << 40;
+    constexpr uint64_t rootBlockSize = 64;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, rootBlockSize, /*minBlockSize*/ 16);
+
+    // Check that we cannot allocate blocks larger than the root.
+    ASSERT_EQ(allocator.TryAllocateBlock(rootBlockSize * 2, 1), nullptr);
+
+    MemoryBlock* blockA = allocator.TryAllocateBlock(rootBlockSize, 1);
+    ASSERT_EQ(blockA->Offset, 0u);
+
+    MemoryBlock* blockB = allocator.TryAllocateBlock(16, 1);
+    ASSERT_EQ(blockB->Offset, rootBlockSize);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+
+    // Roots larger than the alignment are skipped.
+    MemoryBlock* blockC = allocator.TryAllocateBlock(16, rootBlockSize * 4);
+    ASSERT_EQ(blockC->Offset, rootBlockSize * 4);
+
+    // Freeing the first root makes it available again.
+    allocator.DeallocateBlock(blockA);
+    MemoryBlock* blockD = allocator.TryAllocateBlock(rootBlockSize, 1);
+    ASSERT_EQ(blockD->Offset, 0u);
+
+    allocator.DeallocateBlock(blockB);
+    allocator.DeallocateBlock(blockC);
+    allocator.DeallocateBlock(blockD);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+}
+
+// Verify the largest free block shrinks as blocks get split and grows back once merged.
+TEST(BuddyBlockAllocatorTests, LargestFreeBlockSize) {
+    constexpr uint64_t maxBlockSize = 64;
+    BuddyBlockAllocator allocator(maxBlockSize);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), maxBlockSize);
+
+    MemoryBlock* blockA = allocator.TryAllocateBlock(16, 1);
+    ASSERT_NE(blockA, nullptr);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 32u);
+
+    MemoryBlock* blockB = allocator.TryAllocateBlock(32, 1);
+    ASSERT_NE(blockB, nullptr);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 16u);
+
+    allocator.DeallocateBlock(blockA);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 32u);
+
+    allocator.DeallocateBlock(blockB);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), maxBlockSize);
+}
+
+// Verify de-allocated blocks are kept unmerged until a request needs them merged.
+TEST(BuddyBlockAllocatorTests, DeferredMerge) {
+    constexpr uint64_t maxBlockSize = 64;
+    BuddyBlockAllocator allocator(maxBlockSize, /*maxFreeBlockCountPerLevel*/ 4);
+
+    MemoryBlock* blockA = allocator.TryAllocateBlock(8, 1);
+    ASSERT_NE(blockA, nullptr);
+    EXPECT_EQ(allocator.GetSplitCountForTesting(), 3u);
+
+    // Free blocks of 8, 8, 16 and 32 bytes are left unmerged, but count as merged.
+    allocator.DeallocateBlock(blockA);
+    EXPECT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 4u);
+    EXPECT_EQ(allocator.GetMergeCountForTesting(), 0u);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), maxBlockSize);
+
+    // Same size re-uses the free block without splitting.
+    MemoryBlock* blockB = allocator.TryAllocateBlock(8, 1);
+    ASSERT_NE(blockB, nullptr);
+    EXPECT_EQ(blockB->Offset, 0u);
+    EXPECT_EQ(allocator.GetSplitCountForTesting(), 3u);
+    allocator.DeallocateBlock(blockB);
+
+    // Larger size merges every free block first.
+    MemoryBlock* blockC = allocator.TryAllocateBlock(maxBlockSize, 1);
+    ASSERT_NE(blockC, nullptr);
+    EXPECT_EQ(blockC->Offset, 0u);
+    EXPECT_EQ(allocator.GetMergeCountForTesting(), 3u);
+    EXPECT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+
+    allocator.DeallocateBlock(blockC);
+    EXPECT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+}
+
+// Verify a level with enough free blocks merges de-allocated blocks right away.
+TEST(BuddyBlockAllocatorTests, DeferredMergeMaxFreeBlockCount) {
+    constexpr uint64_t maxBlockSize = 64;
+    BuddyBlockAllocator allocator(maxBlockSize, /*maxFreeBlockCountPerLevel*/ 1);
+
+    MemoryBlock* blockA = allocator.TryAllocateBlock(8, 1);
+    ASSERT_NE(blockA, nullptr);
+
+    // Level of 8 byte blocks already has the buddy of blockA free.
+    allocator.DeallocateBlock(blockA);
+    EXPECT_EQ(allocator.GetMergeCountForTesting(), 3u);
+    EXPECT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+}
+
+// Compare the number of splits and merges of allocating then de-allocating the same blocks
+// repeatedly, with and without deferred merging.
+TEST(BuddyBlockAllocatorTests, DeferredMergeOperations) {
+    constexpr uint64_t maxBlockSize = 1u << 20;
+    constexpr uint64_t blockCount = 16;
+    constexpr uint32_t iterationCount = 64;
+
+    auto runWorkload = [&](BuddyBlockAllocator* allocator) -> uint64_t {
+        std::vector<MemoryBlock*> blocks(blockCount);
+        for (uint32_t iteration = 0; iteration < iterationCount; iteration++) {
+            for (uint64_t blockIdx = 0; blockIdx < blockCount; blockIdx++) {
+                blocks[blockIdx] = allocator->TryAllocateBlock(256u << (blockIdx % 4), 1);
+                EXPECT_NE(blocks[blockIdx], nullptr);
+            }
+
+            for (MemoryBlock* block : blocks) {
+                allocator->DeallocateBlock(block);
+            }
+        }
+
+        // Every block is merged back into the root once needed.
+        MemoryBlock* rootBlock = allocator->TryAllocateBlock(maxBlockSize, 1);
+        EXPECT_NE(rootBlock, nullptr);
+        allocator->DeallocateBlock(rootBlock);
+
+        return allocator->GetSplitCountForTesting() + allocator->GetMergeCountForTesting();
+    };
+
+    BuddyBlockAllocator eagerAllocator(maxBlockSize);
+    BuddyBlockAllocator deferredAllocator(maxBlockSize, /*maxFreeBlockCountPerLevel*/ 4);
+
+    const uint64_t eagerOperationCount = runWorkload(&eagerAllocator);
+    const uint64_t deferredOperationCount = runWorkload(&deferredAllocator);
+    EXPECT_LT(deferredOperationCount, eagerOperationCount);
+
+    RecordProperty("EagerSplitMergeCount", std::to_string(eagerOperationCount));
+    RecordProperty("DeferredSplitMergeCount", std::to_string(deferredOperationCount));
+}
+
+// Verify the largest free block is found across roots which contain an allocation.
+TEST(FlatBuddyBlockAllocatorTests, LargestFreeBlockSize) {
+    constexpr uint64_t maxBlockSize = 256;
+    constexpr uint64_t rootBlockSize = 64;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, rootBlockSize, /*minBlockSize*/ 8);
+
+    MemoryBlock* blockA = allocator.TryAllocateBlock(rootBlockSize, 1);
+    ASSERT_NE(blockA, nullptr);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 0u);
+
+    MemoryBlock* blockB = allocator.TryAllocateBlock(16, 1);
+    ASSERT_NE(blockB, nullptr);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 32u);
+
+    MemoryBlock* blockC = allocator.TryAllocateBlock(32, 1);
+    ASSERT_NE(blockC, nullptr);
+    EXPECT_EQ(allocator.GetLargestFreeBlockSize(), 16u);
+
+    allocator.DeallocateBlock(blockA);
+    allocator.DeallocateBlock(blockB);
+    allocator.DeallocateBlock(blockC);
+}
+
+// Verify a block grows in place by merging with its free buddies, level by level.
+TEST(BuddyBlockAllocatorTests, ExtendBlock) {
+    constexpr uint64_t maxBlockSize = 32;
+    BuddyBlockAllocator allocator(maxBlockSize);
+
+    MemoryBlock* block = allocator.TryAllocateBlock(4, 1);
+    ASSERT_EQ(block->Offset, 0u);
+
+    MemoryBlock* rightBlock = allocator.TryAllocateBlock(16, 1);
+    ASSERT_EQ(rightBlock->Offset, 16u);
+
+    // Right children cannot grow without moving.
+    ASSERT_EQ(allocator.TryExtendBlock(rightBlock, 32), nullptr);
+
+    // Merges twice, into the left half.
+    block = allocator.TryExtendBlock(block, 10);
+    ASSERT_NE(block, nullptr);
+    ASSERT_EQ(block->Offset, 0u);
+    ASSERT_EQ(block->Size, 16u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+
+    // The buddy is allocated.
+    ASSERT_EQ(allocator.TryExtendBlock(block, 32), nullptr);
+    ASSERT_EQ(block->Size, 16u);
+
+    allocator.DeallocateBlock(rightBlock);
+    block = allocator.TryExtendBlock(block, 32);
+    ASSERT_NE(block, nullptr);
+    ASSERT_EQ(block->Size, maxBlockSize);
+
+    allocator.DeallocateBlock(block);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+}
+
+// Verify a flat buddy block grows in place like a linked one.
+TEST(FlatBuddyBlockAllocatorTests, ExtendBlock) {
+    constexpr uint64_t maxBlockSize = 32;
+    FlatBuddyBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    MemoryBlock* block = allocator.TryAllocateBlock(4, 1);
+    MemoryBlock* buddyBlock = allocator.TryAllocateBlock(4, 1);
+    ASSERT_EQ(buddyBlock->Offset, 4u);
+
+    // The buddy is allocated.
+    ASSERT_EQ(allocator.TryExtendBlock(block, 8), nullptr);
+    ASSERT_EQ(block->Size, 4u);
+
+    allocator.DeallocateBlock(buddyBlock);
+    ASSERT_EQ(allocator.TryExtendBlock(block, 16), block);
+    ASSERT_EQ(block->Offset, 0u);
+    ASSERT_EQ(block->Size, 16u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+
+    // The merged block is allocated, so only the other half is left.
+    MemoryBlock* halfBlock = allocator.TryAllocateBlock(16, 1);
+    ASSERT_NE(halfBlock, nullptr);
+    ASSERT_EQ(halfBlock->Offset, 16u);
+    ASSERT_EQ(allocator.TryAllocateBlock(1, 1), nullptr);
+
+    allocator.DeallocateBlock(halfBlock);
+    allocator.DeallocateBlock(block);
+
+    // Entirely free again.
+    block = allocator.TryAllocateBlock(maxBlockSize, 1);
+    ASSERT_NE(block, nullptr);
+    allocator.DeallocateBlock(block);
+}
@@ -21,6 +21,7 @@
 #include "tests/DummyMemoryAllocator.h"
 
 #include <set>
+#include <thread>
 #include <vector>
 
 using namespace gpgmm;
@@ -43,13 +44,13 @@ TEST(BuddyMemoryAllocatorTests, SingleHeap) {
     // Cannot allocate greater than heap size.
     {
         std::unique_ptr<MemoryAllocation> invalidAllocation = allocator.TryAllocateMemory(
-            kDefaultMemorySize * 2, kDefaultMemoryAlignment, false, false, false);
+            CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
         ASSERT_EQ(invalidAllocation, nullptr);
     }
 
     // Allocate one 128 byte allocation (same size as heap).
     std::unique_ptr<MemoryAllocation> allocation1 =
-        allocator.TryAllocateMemory(128, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(128, kDefaultMemoryAlignment));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
     ASSERT_EQ(allocation1->GetMethod(), AllocationMethod::kSubAllocated);
@@ -60,7 +61,7 @@ TEST(BuddyMemoryAllocatorTests, SingleHeap) {
     // Cannot allocate when allocator is full.
     {
         std::unique_ptr<MemoryAllocation> invalidAllocation =
-            allocator.TryAllocateMemory(128, kDefaultMemoryAlignment, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(128, kDefaultMemoryAlignment));
         ASSERT_EQ(invalidAllocation, nullptr);
     }
 
@@ -85,20 +86,20 @@ TEST(BuddyMemoryAllocatorTests, MultipleHeaps) {
     // Cannot allocate greater than heap size.
     {
         std::unique_ptr<MemoryAllocation> invalidAllocation = allocator.TryAllocateMemory(
-            kDefaultMemorySize * 2, kDefaultMemoryAlignment, false, false, false);
+            CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
         ASSERT_EQ(invalidAllocation, nullptr);
     }
 
     // Cannot allocate greater than max block size.
     {
         std::unique_ptr<MemoryAllocation> invalidAllocation = allocator.TryAllocateMemory(
-            maxBlockSize * 2, kDefaultMemoryAlignment, false, false, false);
+            CreateBasicRequest(maxBlockSize * 2, kDefaultMemoryAlignment));
         ASSERT_EQ(invalidAllocation, nullptr);
     }
 
     // Allocate two 128 byte allocations.
     std::unique_ptr<MemoryAllocation> allocation1 = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetSize(), kDefaultMemorySize);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
@@ -108,7 +109,7 @@ TEST(BuddyMemoryAllocatorTests, MultipleHeaps) {
     ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
 
     std::unique_ptr<MemoryAllocation> allocation2 = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(allocation2, nullptr);
     ASSERT_EQ(allocation2->GetSize(), kDefaultMemorySize);
     ASSERT_EQ(allocation2->GetBlock()->Offset, kDefaultMemorySize);
@@ -144,7 +145,7 @@ TEST(BuddyMemoryAllocatorTests, MultipleSplitHeaps) {
 
     // Allocate two 64 byte sub-allocations.
     std::unique_ptr<MemoryAllocation> allocation1 = allocator.TryAllocateMemory(
-        kDefaultMemorySize / 2, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize / 2, kDefaultMemoryAlignment));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetSize(), kDefaultMemorySize / 2);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
@@ -154,7 +155,7 @@ TEST(BuddyMemoryAllocatorTests, MultipleSplitHeaps) {
     ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
 
     std::unique_ptr<MemoryAllocation> allocation2 = allocator.TryAllocateMemory(
-        kDefaultMemorySize / 2, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize / 2, kDefaultMemoryAlignment));
     ASSERT_NE(allocation2, nullptr);
     ASSERT_EQ(allocation2->GetSize(), kDefaultMemorySize / 2);
     ASSERT_EQ(allocation2->GetBlock()->Offset, kDefaultMemorySize / 2);
@@ -165,7 +166,7 @@ TEST(BuddyMemoryAllocatorTests, MultipleSplitHeaps) {
     ASSERT_EQ(allocation1->GetMemory(), allocation2->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation3 = allocator.TryAllocateMemory(
-        kDefaultMemorySize / 2, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize / 2, kDefaultMemoryAlignment));
     ASSERT_NE(allocation3, nullptr);
     ASSERT_EQ(allocation3->GetSize(), kDefaultMemorySize / 2);
     ASSERT_EQ(allocation3->GetBlock()->Offset, kDefaultMemorySize);
@@ -207,7 +208,7 @@ TEST(BuddyMemoryAllocatorTests, MultiplSplitHeapsVariableSizes) {
 
     // Allocate two 64-byte allocations.
     std::unique_ptr<MemoryAllocation> allocation1 =
-        allocator.TryAllocateMemory(64, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, kDefaultMemoryAlignment));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetSize(), 64u);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
@@ -215,7 +216,7 @@ TEST(BuddyMemoryAllocatorTests, MultiplSplitHeapsVariableSizes) {
     ASSERT_EQ(allocation1->GetMethod(), AllocationMethod::kSubAllocated);
 
     std::unique_ptr<MemoryAllocation> allocation2 =
-        allocator.TryAllocateMemory(64, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, kDefaultMemoryAlignment));
     ASSERT_NE(allocation2, nullptr);
     ASSERT_EQ(allocation2->GetSize(), 64u);
     ASSERT_EQ(allocation2->GetBlock()->Offset, 64u);
@@ -227,7 +228,7 @@ TEST(BuddyMemoryAllocatorTests, MultiplSplitHeapsVariableSizes) {
     ASSERT_EQ(allocation1->GetMemory(), allocation2->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation3 =
-        allocator.TryAllocateMemory(128, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(128, kDefaultMemoryAlignment));
     ASSERT_NE(allocation3, nullptr);
     ASSERT_EQ(allocation3->GetSize(), 128u);
     ASSERT_EQ(allocation3->GetBlock()->Offset, 128u);
@@ -239,7 +240,7 @@ TEST(BuddyMemoryAllocatorTests, MultiplSplitHeapsVariableSizes) {
     ASSERT_NE(allocation2->GetMemory(), allocation3->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation4 =
-        allocator.TryAllocateMemory(64, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, kDefaultMemoryAlignment));
     ASSERT_NE(allocation4, nullptr);
     ASSERT_EQ(allocation4->GetSize(), 64u);
     ASSERT_EQ(allocation4->GetBlock()->Offset, 256u);
@@ -251,7 +252,7 @@ TEST(BuddyMemoryAllocatorTests, MultiplSplitHeapsVariableSizes) {
 
     // R5 size forms 64 byte hole after R4.
     std::unique_ptr<MemoryAllocation> allocation5 =
-        allocator.TryAllocateMemory(128, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(128, kDefaultMemoryAlignment));
     ASSERT_NE(allocation5, nullptr);
     ASSERT_EQ(allocation5->GetSize(), 128u);
     ASSERT_EQ(allocation5->GetBlock()->Offset, 384u);
@@ -297,7 +298,7 @@ TEST(BuddyMemoryAllocatorTests, SameSizeVariousAlignment) {
                                    std::make_unique<DummyMemoryAllocator>());
 
     std::unique_ptr<MemoryAllocation> allocation1 =
-        allocator.TryAllocateMemory(64, 128, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 128));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetSize(), 64u);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
@@ -307,7 +308,7 @@ TEST(BuddyMemoryAllocatorTests, SameSizeVariousAlignment) {
     ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
 
     std::unique_ptr<MemoryAllocation> allocation2 =
-        allocator.TryAllocateMemory(64, 128, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 128));
     ASSERT_NE(allocation2, nullptr);
     ASSERT_EQ(allocation2->GetSize(), 64u);
     ASSERT_EQ(allocation2->GetBlock()->Offset, 128u);
@@ -318,7 +319,7 @@ TEST(BuddyMemoryAllocatorTests, SameSizeVariousAlignment) {
     ASSERT_NE(allocation1->GetMemory(), allocation2->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation3 =
-        allocator.TryAllocateMemory(64, 128, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 128));
     ASSERT_NE(allocation3, nullptr);
     ASSERT_EQ(allocation3->GetSize(), 64u);
     ASSERT_EQ(allocation3->GetBlock()->Offset, 256u);
@@ -329,7 +330,7 @@ TEST(BuddyMemoryAllocatorTests, SameSizeVariousAlignment) {
     ASSERT_NE(allocation2->GetMemory(), allocation3->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation4 =
-        allocator.TryAllocateMemory(64, 64, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 64));
     ASSERT_NE(allocation4, nullptr);
     ASSERT_EQ(allocation4->GetSize(), 64u);
     ASSERT_EQ(allocation4->GetBlock()->Offset, 320u);
@@ -373,7 +374,7 @@ TEST(BuddyMemoryAllocatorTests, VariousSizeSameAlignment) {
     constexpr uint64_t alignment = 64;
 
     std::unique_ptr<MemoryAllocation> allocation1 =
-        allocator.TryAllocateMemory(64, alignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, alignment));
     ASSERT_NE(allocation1, nullptr);
     ASSERT_EQ(allocation1->GetSize(), 64u);
     ASSERT_EQ(allocation1->GetBlock()->Offset, 0u);
@@ -382,7 +383,7 @@ TEST(BuddyMemoryAllocatorTests, VariousSizeSameAlignment) {
     ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
 
     std::unique_ptr<MemoryAllocation> allocation2 =
-        allocator.TryAllocateMemory(64, alignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(64, alignment));
     ASSERT_NE(allocation2, nullptr);
     ASSERT_EQ(allocation2->GetSize(), 64u);
     ASSERT_EQ(allocation2->GetBlock()->Offset, 64u);
@@ -393,7 +394,7 @@ TEST(BuddyMemoryAllocatorTests, VariousSizeSameAlignment) {
     ASSERT_EQ(allocation1->GetMemory(), allocation2->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation3 =
-        allocator.TryAllocateMemory(128, alignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(128, alignment));
     ASSERT_NE(allocation3, nullptr);
     ASSERT_EQ(allocation3->GetSize(), 128u);
     ASSERT_EQ(allocation3->GetBlock()->Offset, 128u);
@@ -404,7 +405,7 @@ TEST(BuddyMemoryAllocatorTests, VariousSizeSameAlignment) {
     ASSERT_NE(allocation2->GetMemory(), allocation3->GetMemory());
 
     std::unique_ptr<MemoryAllocation> allocation4 =
-        allocator.TryAllocateMemory(128, alignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(128, alignment));
     ASSERT_NE(allocation4, nullptr);
     ASSERT_EQ(allocation4->GetSize(), 128u);
     ASSERT_EQ(allocation4->GetBlock()->Offset, 256u);
@@ -435,7 +436,7 @@ TEST(BuddyMemoryAllocatorTests, AllocationOverflow) {
 
     constexpr uint64_t largeBlock = (1ull << 63) + 1;
     std::unique_ptr<MemoryAllocation> invalidAllocation =
-        allocator.TryAllocateMemory(largeBlock, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(largeBlock, kDefaultMemoryAlignment));
     ASSERT_EQ(invalidAllocation, nullptr);
 }
 
@@ -458,7 +459,7 @@ TEST(BuddyMemoryAllocatorTests, ReuseFreedHeaps) {
     // Allocate |kNumOfAllocations|.
     for (uint32_t i = 0; i < kNumOfAllocations; i++) {
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(4, kDefaultMemoryAlignment, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
         ASSERT_NE(allocation, nullptr);
         ASSERT_EQ(allocation->GetSize(), 4u);
         ASSERT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -481,7 +482,7 @@ TEST(BuddyMemoryAllocatorTests, ReuseFreedHeaps) {
     // Allocate again reusing the same heaps.
     for (uint32_t i = 0; i < kNumOfAllocations; i++) {
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(4, kDefaultMemoryAlignment, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
         ASSERT_NE(allocation, nullptr);
         ASSERT_EQ(allocation->GetSize(), 4u);
         ASSERT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -521,7 +522,7 @@ TEST(BuddyMemoryAllocatorTests, DestroyHeaps) {
     // Allocate |kNumOfHeaps| worth.
     while (heaps.size() < kNumOfHeaps) {
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(4, kDefaultMemoryAlignment, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
         ASSERT_NE(allocation, nullptr);
         ASSERT_EQ(allocation->GetSize(), 4u);
         ASSERT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -541,3 +542,242 @@ TEST(BuddyMemoryAllocatorTests, DestroyHeaps) {
 
     pool.ReleasePool();
 }
+
+// Verify allocations are rounded up to the minimum block size and fill each heap before the next.
+TEST(BuddyMemoryAllocatorTests, MinBlockSize) {
+    constexpr uint64_t kMaxBlockSize = 4096;
+    constexpr uint64_t kMinBlockSize = 32;
+    BuddyMemoryAllocator allocator(kMaxBlockSize, kDefaultMemorySize, kDefaultMemoryAlignment,
+                                   std::make_unique<DummyMemoryAllocator>(), kMinBlockSize);
+
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (uint64_t blocki = 0; blocki < 2 * kDefaultMemorySize / kMinBlockSize; blocki++) {
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
+        ASSERT_NE(allocation, nullptr);
+        ASSERT_EQ(allocation->GetBlock()->Offset, blocki * kMinBlockSize);
+        ASSERT_EQ(allocation->GetSize(), kMinBlockSize);
+        allocations.push_back(std::move(allocation));
+    }
+
+    ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 2u);
+
+    for (auto& allocation : allocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+
+    ASSERT_EQ(allocator.GetBuddyMemorySizeForTesting(), 0u);
+}
+
+// Verify blocks within resident memory are used before blocks within evicted memory.
+TEST(BuddyMemoryAllocatorTests, ReuseResidentHeapsFirst) {
+    constexpr uint64_t maxBlockSize = kDefaultMemorySize * 2;
+    BuddyMemoryAllocator allocator(maxBlockSize, kDefaultMemorySize, kDefaultMemoryAlignment,
+                                   std::make_unique<DummyMemoryAllocator>());
+
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize / 2, 1));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetBlock()->Offset, 0u);
+
+    MemoryBase* evictedMemory = firstAllocation->GetMemory();
+    static_cast<DummyMemory*>(evictedMemory)->SetEvicted(true);
+
+    // The free block in H0 is skipped for a block in new memory, H1.
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize / 2, 1));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetBlock()->Offset, kDefaultMemorySize);
+    EXPECT_NE(secondAllocation->GetMemory(), evictedMemory);
+    EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 2u);
+    EXPECT_EQ(allocator.QueryInfo().EvictedMemoryReuseCount, 0u);
+
+    std::unique_ptr<MemoryAllocation> thirdAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize / 2, 1));
+    ASSERT_NE(thirdAllocation, nullptr);
+    EXPECT_EQ(thirdAllocation->GetBlock()->Offset, kDefaultMemorySize + kDefaultMemorySize / 2);
+
+    // Only the block in H0 remains, so evicted memory gets used.
+    std::unique_ptr<MemoryAllocation> fourthAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize / 2, 1));
+    ASSERT_NE(fourthAllocation, nullptr);
+    EXPECT_EQ(fourthAllocation->GetBlock()->Offset, kDefaultMemorySize / 2);
+    EXPECT_EQ(fourthAllocation->GetMemory(), evictedMemory);
+    EXPECT_EQ(allocator.QueryInfo().EvictedMemoryReuseCount, 1u);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+    allocator.DeallocateMemory(std::move(fourthAllocation));
+
+    EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 0u);
+}
+
+// Verify sub-allocating from many threads at once never returns the same block twice.
+TEST(BuddyMemoryAllocatorTests, MultipleThreads) {
+    constexpr uint64_t kThreadCount = 8;
+    constexpr uint64_t kAllocationCount = 64;
+    constexpr uint64_t kMaxBlockSize = kDefaultMemorySize * kThreadCount * kAllocationCount;
+    BuddyMemoryAllocator allocator(kMaxBlockSize, kDefaultMemorySize, kDefaultMemoryAlignment,
+                                   std::make_unique<DummyMemoryAllocator>());
+
+    std::vector<std::vector<std::unique_ptr<MemoryAllocation>>> allocationsOfThread(kThreadCount);
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
+        threads[threadIdx] = std::thread([&, threadIdx]() {
+            for (uint64_t i = 0; i < kAllocationCount; i++) {
+                std::unique_ptr<MemoryAllocation> allocation =
+                    allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize / 4, 1));
+                ASSERT_NE(allocation, nullptr);
+                allocationsOfThread[threadIdx].push_back(std::move(allocation));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::set<uint64_t> offsets;
+    for (auto& allocations : allocationsOfThread) {
+        for (auto& allocation : allocations) {
+            EXPECT_TRUE(offsets.insert(allocation->GetBlock()->Offset).second);
+        }
+    }
+
+    for (auto& allocations : allocationsOfThread) {
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+    }
+
+    EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+}
+
+// Verify new memory is not created when larger than the memory size limit.
+TEST(BuddyMemoryAllocatorTests, MemorySizeLimit) {
+    BuddyMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemorySize, kDefaultMemoryAlignment,
+                                   std::make_unique<DummyMemoryAllocator>());
+
+    MEMORY_ALLOCATION_REQUEST request = CreateBasicRequest(32, kDefaultMemoryAlignment);
+    request.MemorySizeLimit = kDefaultMemorySize / 2;
+    EXPECT_EQ(allocator.TryAllocateMemory(request), nullptr);
+    EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 0u);
+
+    std::unique_ptr<MemoryAllocation> allocation1 =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation1, nullptr);
+
+    // Existing memory is sub-allocated regardless of the limit.
+    std::unique_ptr<MemoryAllocation> allocation2 = allocator.TryAllocateMemory(request);
+    ASSERT_NE(allocation2, nullptr);
+    EXPECT_EQ(allocation2->GetMemory(), allocation1->GetMemory());
+    EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
+
+    allocator.DeallocateMemory(std::move(allocation1));
+    allocator.DeallocateMemory(std::move(allocation2));
+}
+
+// Verify an allocation grows in place by merging with its free buddies, with either kind of
+// buddy block allocator.
+TEST(BuddyMemoryAllocatorTests, ExtendMemory) {
+    for (uint64_t minBlockSize : {uint64_t{0}, uint64_t{16}}) {
+        BuddyMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemorySize,
+                                       kDefaultMemoryAlignment,
+                                       std::make_unique<DummyMemoryAllocator>(), minBlockSize);
+
+        std::unique_ptr<MemoryAllocation> allocation1 =
+            allocator.TryAllocateMemory(CreateBasicRequest(24, kDefaultMemoryAlignment));
+        ASSERT_NE(allocation1, nullptr);
+        ASSERT_EQ(allocation1->GetSize(), 32u);
+
+        std::unique_ptr<MemoryAllocation> allocation2 =
+            allocator.TryAllocateMemory(CreateBasicRequest(32, kDefaultMemoryAlignment));
+        ASSERT_NE(allocation2, nullptr);
+        ASSERT_EQ(allocation2->GetOffset(), 32u);
+
+        // Already large enough.
+        EXPECT_TRUE(allocator.TryExtendMemory(allocation1.get(), 32));
+        EXPECT_EQ(allocation1->GetSize(), 32u);
+
+        // The buddy is allocated.
+        EXPECT_FALSE(allocator.TryExtendMemory(allocation1.get(), 64));
+        EXPECT_EQ(allocation1->GetSize(), 32u);
+
+        // Cannot grow beyond the memory.
+        EXPECT_FALSE(allocator.TryExtendMemory(allocation1.get(), kDefaultMemorySize * 2));
+
+        allocator.DeallocateMemory(std::move(allocation2));
+
+        EXPECT_TRUE(allocator.TryExtendMemory(allocation1.get(), 100));
+        EXPECT_EQ(allocation1->GetOffset(), 0u);
+        EXPECT_EQ(allocation1->GetSize(), kDefaultMemorySize);
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, kDefaultMemorySize);
+
+        // The memory is entirely used.
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(16, kDefaultMemoryAlignment)),
+                  nullptr);
+        EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 1u);
+
+        allocator.DeallocateMemory(std::move(allocation1));
+        EXPECT_EQ(allocator.GetBuddyMemorySizeForTesting(), 0u);
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 0u);
+    }
+}
+
+// Verify the fragmentation of each allocator, from the buddy allocator to the memory allocator.
+TEST(BuddyMemoryAllocatorTests, QueryFragmentation) {
+    LIFOMemoryPool pool(kDefaultMemorySize);
+    BuddyMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemorySize, kDefaultMemoryAlignment,
+                                   std::make_unique<PooledMemoryAllocator>(
+                                       std::make_unique<DummyMemoryAllocator>(), &pool));
+
+    // After a 20 and a 64 byte allocation:
+    //
+    //   ---------------------------
+    //   | A1 |    |      A2      |       A1 - 20 byte allocation in a 32 byte block
+    //   ---------------------------       A2 - 64 byte allocation
+    //
+    std::unique_ptr<MemoryAllocation> allocation1 =
+        allocator.TryAllocateMemory(CreateBasicRequest(20, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation1, nullptr);
+
+    std::unique_ptr<MemoryAllocation> allocation2 =
+        allocator.TryAllocateMemory(CreateBasicRequest(64, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation2, nullptr);
+
+    {
+        const std::vector<MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO> layers =
+            allocator.QueryFragmentation();
+        ASSERT_EQ(layers.size(), 3u);
+
+        EXPECT_EQ(layers[0].Depth, 0u);
+        EXPECT_EQ(layers[0].Info.InternalFragmentationUsage, 12u);
+        EXPECT_EQ(layers[0].Info.FreeBlockUsage, 32u);
+        EXPECT_EQ(layers[0].Info.LargestFreeBlockSize, 32u);
+        EXPECT_EQ(layers[0].Info.GetExternalFragmentation(), 0);
+        EXPECT_EQ(layers[0].Info.PooledMemoryUsage, 0u);
+
+        EXPECT_EQ(layers[1].Depth, 1u);
+        EXPECT_EQ(layers[1].Info.PooledMemoryUsage, 0u);
+
+        EXPECT_EQ(layers[2].Depth, 2u);
+    }
+
+    allocator.DeallocateMemory(std::move(allocation1));
+    allocator.DeallocateMemory(std::move(allocation2));
+
+    // Memory is returned to the pool instead of being released.
+    {
+        const std::vector<MEMORY_ALLOCATOR_LAYER_FRAGMENTATION_INFO> layers =
+            allocator.QueryFragmentation();
+        ASSERT_EQ(layers.size(), 3u);
+
+        EXPECT_EQ(layers[0].Info.InternalFragmentationUsage, 0u);
+        EXPECT_EQ(layers[0].Info.FreeBlockUsage, 0u);
+        EXPECT_EQ(layers[1].Info.PooledMemoryUsage, kDefaultMemorySize);
+    }
+
+    pool.ReleasePool();
+}
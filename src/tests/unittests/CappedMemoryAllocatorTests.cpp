@@ -0,0 +1,62 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/CappedMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+static constexpr uint64_t kDefaultMemoryAlignment = 1u;
+
+TEST(CappedMemoryAllocatorTests, Basic) {
+    CappedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                    kDefaultMemorySize * 2);
+
+    // Cannot allocate more than the cap at once.
+    EXPECT_EQ(allocator.TryAllocateMemory(
+                  CreateBasicRequest(kDefaultMemorySize * 3, kDefaultMemoryAlignment)),
+              nullptr);
+
+    std::unique_ptr<MemoryAllocation> firstAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(firstAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(secondAllocation, nullptr);
+
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, kDefaultMemorySize * 2);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryCount, 2u);
+
+    // Memory is capped.
+    EXPECT_EQ(allocator.TryAllocateMemory(
+                  CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment)),
+              nullptr);
+
+    // Deallocating makes room again.
+    allocator.DeallocateMemory(std::move(firstAllocation));
+
+    std::unique_ptr<MemoryAllocation> thirdAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(thirdAllocation, nullptr);
+
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryCount, 0u);
+}
@@ -27,35 +27,74 @@ TEST(ConditionalMemoryAllocatorTests, Basic) {
     // Smaller allocation uses firstAllocator.
     {
         std::unique_ptr<MemoryAllocation> allocation =
-            alloc.TryAllocateMemory(4, 1, false, false, false);
+            alloc.TryAllocateMemory(CreateBasicRequest(4, 1));
         ASSERT_EQ(alloc.GetFirstAllocatorForTesting()->QueryInfo().UsedMemoryUsage, 4u);
     }
 
     // Equal size allocation uses firstAllocator.
     {
         std::unique_ptr<MemoryAllocation> allocation =
-            alloc.TryAllocateMemory(16, 1, false, false, false);
+            alloc.TryAllocateMemory(CreateBasicRequest(16, 1));
         ASSERT_EQ(alloc.GetFirstAllocatorForTesting()->QueryInfo().UsedMemoryUsage, 20u);
     }
 
     // Larger allocation uses secondAllocator.
     {
         std::unique_ptr<MemoryAllocation> allocation =
-            alloc.TryAllocateMemory(24, 1, false, false, false);
+            alloc.TryAllocateMemory(CreateBasicRequest(24, 1));
         ASSERT_EQ(alloc.GetSecondAllocatorForTesting()->QueryInfo().UsedMemoryUsage, 24u);
     }
 
     // Smaller allocation again uses firstAllocator.
     {
         std::unique_ptr<MemoryAllocation> allocation =
-            alloc.TryAllocateMemory(4, 1, false, false, false);
+            alloc.TryAllocateMemory(CreateBasicRequest(4, 1));
         ASSERT_EQ(alloc.GetFirstAllocatorForTesting()->QueryInfo().UsedMemoryUsage, 24u);
     }
 
     // Larger allocation again uses secondAllocator.
     {
         std::unique_ptr<MemoryAllocation> allocation =
-            alloc.TryAllocateMemory(24, 1, false, false, false);
+            alloc.TryAllocateMemory(CreateBasicRequest(24, 1));
         ASSERT_EQ(alloc.GetSecondAllocatorForTesting()->QueryInfo().UsedMemoryUsage, 48u);
     }
 }
+
+TEST(ConditionalMemoryAllocatorTests, MultipleSizeClasses) {
+    std::vector<std::unique_ptr<MemoryAllocator>> allocators;
+    allocators.push_back(std::make_unique<DummyMemoryAllocator>());
+    allocators.push_back(std::make_unique<DummyMemoryAllocator>());
+    allocators.push_back(std::make_unique<DummyMemoryAllocator>());
+
+    ConditionalMemoryAllocator alloc(std::move(allocators), {16u, 64u});
+
+    // Smallest size class uses the first allocator.
+    {
+        std::unique_ptr<MemoryAllocation> allocation =
+            alloc.TryAllocateMemory(CreateBasicRequest(16, 1));
+        ASSERT_EQ(alloc.GetAllocatorForTesting(0)->QueryInfo().UsedMemoryUsage, 16u);
+    }
+
+    // Middle size class uses the second allocator.
+    {
+        std::unique_ptr<MemoryAllocation> allocation =
+            alloc.TryAllocateMemory(CreateBasicRequest(24, 1));
+        ASSERT_EQ(alloc.GetAllocatorForTesting(1)->QueryInfo().UsedMemoryUsage, 24u);
+    }
+
+    {
+        std::unique_ptr<MemoryAllocation> allocation =
+            alloc.TryAllocateMemory(CreateBasicRequest(64, 1));
+        ASSERT_EQ(alloc.GetAllocatorForTesting(1)->QueryInfo().UsedMemoryUsage, 88u);
+    }
+
+    // Larger than every size class uses the last allocator.
+    {
+        std::unique_ptr<MemoryAllocation> allocation =
+            alloc.TryAllocateMemory(CreateBasicRequest(128, 1));
+        ASSERT_EQ(alloc.GetAllocatorForTesting(2)->QueryInfo().UsedMemoryUsage, 128u);
+    }
+
+    // Every size class is included.
+    ASSERT_EQ(alloc.QueryInfo().UsedMemoryUsage, 232u);
+}
@@ -0,0 +1,173 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/d3d12/HeapD3D12.h"
+#include "gpgmm/d3d12/ResidencyManagerD3D12.h"
+#include "gpgmm/d3d12/ResidencySetD3D12.h"
+#include "tests/D3D12MockDevice.h"
+#include "tests/D3D12Test.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm::d3d12;
+
+static constexpr uint64_t kHeapSize = 1024 * 1024;
+static constexpr uint32_t kHeapCount = 4;
+
+class D3D12ResidencyManagerTests : public testing::Test {
+  protected:
+    // Creates |kHeapCount| resident heaps, with a budget for one less, then the residency
+    // manager which tracks them, so the first eviction evicts a single heap.
+    void CreateResidencyManager(EVICTION_POLICY evictionPolicy = EVICTION_POLICY_LRU) {
+        MOCK_DEVICE_DESC deviceDesc = {};
+        deviceDesc.LocalBudget = kHeapSize * kHeapCount - kHeapSize / 2;
+        deviceDesc.NonLocalBudget = deviceDesc.LocalBudget;
+        mDevice = CreateMock<MockD3D12Device>(deviceDesc);
+        mAdapter = CreateMock<MockDXGIAdapter3>(mDevice.Get());
+
+        for (uint32_t i = 0; i < kHeapCount; i++) {
+            ComPtr<MockD3D12Pageable> pageable =
+                mDevice->CreatePageable(kHeapSize, DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+            mHeaps.push_back(
+                std::make_unique<Heap>(pageable, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, kHeapSize));
+        }
+
+        ASSERT_SUCCEEDED(ResidencyManager::CreateResidencyManager(
+            mDevice, mAdapter, /*isUMA*/ true, /*videoMemoryBudget*/ 1.0f,
+            /*availableForResourceBudget*/ 0, /*videoMemoryEvictSize*/ kHeapSize,
+            /*evictInBackground*/ false, /*offerPooledHeaps*/ false, evictionPolicy,
+            /*predictionSubmissionCount*/ 0, /*reservationSubmissionCount*/ 0,
+            &mResidencyManager));
+
+        for (const auto& heap : mHeaps) {
+            ASSERT_SUCCEEDED(mResidencyManager->InsertHeap(heap.get()));
+        }
+    }
+
+    HRESULT Submit(ID3D12CommandQueue* queue, const std::vector<Heap*>& heaps) {
+        ResidencySet residencySet;
+        for (Heap* heap : heaps) {
+            const HRESULT hr = residencySet.Insert(heap);
+            if (FAILED(hr)) {
+                return hr;
+            }
+        }
+        ID3D12CommandList* commandList = nullptr;
+        ResidencySet* residencySetPtr = &residencySet;
+        return mResidencyManager->ExecuteCommandLists(queue, &commandList, &residencySetPtr, 1);
+    }
+
+    void TearDown() override {
+        // Heaps are unlinked from the LRU cache of the residency manager, so they go first.
+        mHeaps.clear();
+        mResidencyManager = nullptr;
+    }
+
+    ComPtr<MockD3D12Device> mDevice;
+    ComPtr<MockDXGIAdapter3> mAdapter;
+    ComPtr<ResidencyManager> mResidencyManager;
+    std::vector<std::unique_ptr<Heap>> mHeaps;
+};
+
+// Evicting to stay within the budget evicts the least recently used heap.
+TEST_F(D3D12ResidencyManagerTests, EvictLeastRecentlyUsed) {
+    CreateResidencyManager();
+
+    ComPtr<MockD3D12CommandQueue> queue = CreateMock<MockD3D12CommandQueue>(mDevice.Get());
+
+    // Heaps used by a submission are the most recently used, even if inserted first.
+    ASSERT_SUCCEEDED(Submit(queue.Get(), {mHeaps[0].get()}));
+
+    ASSERT_SUCCEEDED(mResidencyManager->Evict(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_EQ(mDevice->GetEvictedCount(), 1u);
+    EXPECT_FALSE(mHeaps[0]->IsEvicted());
+    EXPECT_TRUE(mHeaps[1]->IsEvicted());
+
+    // Using the evicted heap again makes it resident, which evicts the next one.
+    ASSERT_SUCCEEDED(Submit(queue.Get(), {mHeaps[1].get()}));
+    EXPECT_EQ(mDevice->GetMadeResidentCount(), 1u);
+    EXPECT_FALSE(mHeaps[1]->IsEvicted());
+    EXPECT_TRUE(mHeaps[2]->IsEvicted());
+
+    const RESIDENCY_MANAGER_STATS stats = mResidencyManager->QueryStats();
+    EXPECT_EQ(stats.Total.MadeResidentCount, mDevice->GetMadeResidentCount());
+    EXPECT_EQ(stats.Total.MadeResidentSizeInBytes, mDevice->GetMadeResidentSize());
+    EXPECT_EQ(stats.Total.EvictedCount, mDevice->GetEvictedCount());
+    EXPECT_EQ(stats.Total.EvictedSizeInBytes, mDevice->GetEvictedSize());
+}
+
+// Heaps still used by the GPU can only be evicted once the GPU is done with them.
+TEST_F(D3D12ResidencyManagerTests, EvictWaitsForGPU) {
+    CreateResidencyManager();
+
+    ComPtr<MockD3D12CommandQueue> queue =
+        CreateMock<MockD3D12CommandQueue>(mDevice.Get(), /*gpuLagSubmissionCount*/ 1);
+
+    std::vector<Heap*> heaps;
+    for (const auto& heap : mHeaps) {
+        heaps.push_back(heap.get());
+    }
+    ASSERT_SUCCEEDED(Submit(queue.Get(), heaps));
+
+    ASSERT_SUCCEEDED(mResidencyManager->Evict(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_EQ(mDevice->GetEvictedCount(), 1u);
+    EXPECT_TRUE(mHeaps[0]->IsEvicted());
+
+    const RESIDENCY_MANAGER_STATS stats = mResidencyManager->QueryStats();
+    EXPECT_EQ(stats.Total.FenceWaitCount, 1u);
+    EXPECT_EQ(stats.Total.FenceWaitHeapCount, 1u);
+    EXPECT_EQ(stats.Total.FenceWaitSizeInBytes, kHeapSize);
+}
+
+// Locking an evicted heap makes it resident, which evicts another, and takes it out of the LRU
+// cache until unlocked.
+TEST_F(D3D12ResidencyManagerTests, LockHeapEvicted) {
+    CreateResidencyManager();
+
+    ASSERT_SUCCEEDED(mResidencyManager->Evict(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    ASSERT_TRUE(mHeaps[0]->IsEvicted());
+
+    ASSERT_SUCCEEDED(mResidencyManager->LockHeap(mHeaps[0].get()));
+    EXPECT_FALSE(mHeaps[0]->IsEvicted());
+    EXPECT_TRUE(mHeaps[1]->IsEvicted());
+    EXPECT_FALSE(mHeaps[0]->IsInResidencyLRUCache());
+
+    ASSERT_SUCCEEDED(mResidencyManager->UnlockHeap(mHeaps[0].get()));
+    EXPECT_TRUE(mHeaps[0]->IsInResidencyLRUCache());
+}
+
+// Lowering the budget is noticed once the OS notifies the residency manager.
+TEST_F(D3D12ResidencyManagerTests, BudgetChange) {
+    CreateResidencyManager();
+
+    ASSERT_SUCCEEDED(mResidencyManager->Evict(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_TRUE(mResidencyManager->IsWithinBudget(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+
+    mDevice->SetBudget(DXGI_MEMORY_SEGMENT_GROUP_LOCAL, kHeapSize);
+
+    // Budget changes are handled by another thread.
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (mResidencyManager->IsWithinBudget(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL) &&
+           std::chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_SUCCEEDED(mResidencyManager->Evict(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL));
+    EXPECT_EQ(mDevice->GetEvictedCount(), kHeapCount - 1);
+}
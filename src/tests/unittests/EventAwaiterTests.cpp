@@ -0,0 +1,131 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/EventAwaiter.h"
+
+#if defined(GPGMM_HAS_COROUTINES)
+
+#    include "tests/DummyMemoryAllocator.h"
+
+#    include <atomic>
+#    include <mutex>
+#    include <thread>
+#    include <vector>
+
+using namespace gpgmm;
+
+// Coroutine which starts immediately and is never awaited.
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+// Runs each task scheduled on its own thread. Tasks can be scheduled from any thread.
+class ResumingTaskScheduler : public TaskScheduler {
+  public:
+    ~ResumingTaskScheduler() override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (std::thread& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    void ScheduleTask(std::shared_ptr<VoidCallback> task, TaskClass taskClass) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreads.emplace_back([task]() { (*task)(); });
+        mScheduledTaskCount++;
+    }
+
+    uint32_t GetScheduledTaskCount() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mScheduledTaskCount;
+    }
+
+  private:
+    mutable std::mutex mMutex;
+    std::vector<std::thread> mThreads;
+    uint32_t mScheduledTaskCount = 0;
+};
+
+static MEMORY_ALLOCATION_REQUEST CreateBasicRequest(uint64_t size) {
+    MEMORY_ALLOCATION_REQUEST request = {};
+    request.Size = size;
+    request.Alignment = 1;
+    return request;
+}
+
+static DetachedCoroutine AllocateAndDeallocate(MemoryAllocator* allocator,
+                                               TaskScheduler* scheduler,
+                                               std::atomic<uint32_t>* completedCount) {
+    std::unique_ptr<MemoryAllocation> allocation = co_await TryAllocateMemoryAwaitable(
+        allocator, CreateBasicRequest(64), scheduler);
+    EXPECT_NE(allocation, nullptr);
+    allocator->DeallocateMemory(std::move(allocation));
+    (*completedCount)++;
+}
+
+// Verify awaiting many allocations resumes every coroutine once allocated.
+TEST(EventAwaiterTests, AwaitAllocation) {
+    DummyMemoryAllocator allocator;
+
+    std::atomic<uint32_t> completedCount = {0};
+    for (uint32_t i = 0; i < 100; i++) {
+        AllocateAndDeallocate(&allocator, /*scheduler*/ nullptr, &completedCount);
+    }
+
+    allocator.WaitForPendingAllocations();
+    while (completedCount < 100u) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+}
+
+// Verify coroutines are resumed by the scheduler when one is specified.
+TEST(EventAwaiterTests, AwaitAllocationWithScheduler) {
+    DummyMemoryAllocator allocator;
+    std::atomic<uint32_t> completedCount = {0};
+    {
+        ResumingTaskScheduler scheduler;
+        for (uint32_t i = 0; i < 10; i++) {
+            AllocateAndDeallocate(&allocator, &scheduler, &completedCount);
+        }
+
+        allocator.WaitForPendingAllocations();
+        while (scheduler.GetScheduledTaskCount() < 10u) {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_EQ(completedCount, 10u);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+}
+
+#endif  // defined(GPGMM_HAS_COROUTINES)
@@ -53,6 +53,29 @@ namespace gpgmm {
         EXPECT_EQ(a, 0);
     }
 
+    constexpr CountFlags AccumulateFlags() {
+        CountFlags flags;
+        flags |= kOne;
+        flags |= kTwo;
+        flags &= kTwo;
+        flags ^= kOne;
+        return flags;
+    }
+
+    // Verify fixed flags are evaluated at compile-time.
+    TEST(FlagsTests, Constexpr) {
+        static_assert((kOne | kTwo) == kThree, "");
+        static_assert((CountFlags(kThree) & kOne) == kOne, "");
+        static_assert((kThree ^ kOne) == kTwo, "");
+        static_assert(!CountFlags(kZero), "");
+        static_assert(AccumulateFlags() == kThree, "");
+        static_assert(noexcept(CountFlags(kOne) | kTwo), "");
+
+        constexpr CountFlags flags = kOne | kTwo;
+        static_assert(flags & kTwo, "");
+        EXPECT_EQ(flags, 3);
+    }
+
     struct Desc {
         enum Option {
             kNone,
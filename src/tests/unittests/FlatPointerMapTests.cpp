@@ -0,0 +1,82 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/FlatPointerMap.h"
+
+#include <unordered_map>
+#include <vector>
+
+using namespace gpgmm;
+
+TEST(FlatPointerMapTests, InsertFindRemove) {
+    int a = 0;
+    int b = 0;
+
+    FlatPointerMap<int> map;
+    EXPECT_EQ(map.Find(&a), nullptr);
+    EXPECT_FALSE(map.Remove(&a));
+
+    EXPECT_TRUE(map.Insert(&a, 1));
+    EXPECT_TRUE(map.Insert(&b, 2));
+    EXPECT_FALSE(map.Insert(&a, 3));
+    EXPECT_EQ(map.GetSize(), 2u);
+
+    ASSERT_NE(map.Find(&a), nullptr);
+    EXPECT_EQ(*map.Find(&a), 1);
+    ASSERT_NE(map.Find(&b), nullptr);
+    EXPECT_EQ(*map.Find(&b), 2);
+
+    int value = 0;
+    EXPECT_TRUE(map.Remove(&a, &value));
+    EXPECT_EQ(value, 1);
+    EXPECT_EQ(map.Find(&a), nullptr);
+    EXPECT_EQ(map.GetSize(), 1u);
+}
+
+// Verify entries remain reachable as the map grows and entries are removed in any order.
+TEST(FlatPointerMapTests, ManyEntries) {
+    constexpr static size_t kCount = 1000;
+    std::vector<char> objects(kCount);
+
+    FlatPointerMap<size_t> map;
+    for (size_t i = 0; i < kCount; i++) {
+        EXPECT_TRUE(map.Insert(&objects[i], i));
+    }
+    EXPECT_EQ(map.GetSize(), kCount);
+
+    // Removing every other entry must not break the probe sequences of the remaining ones.
+    for (size_t i = 0; i < kCount; i += 2) {
+        EXPECT_TRUE(map.Remove(&objects[i]));
+    }
+    EXPECT_EQ(map.GetSize(), kCount / 2);
+
+    for (size_t i = 0; i < kCount; i++) {
+        size_t* value = map.Find(&objects[i]);
+        if (i % 2 == 0) {
+            EXPECT_EQ(value, nullptr);
+        } else {
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, i);
+        }
+    }
+
+    std::unordered_map<const void*, size_t> visited;
+    map.ForEach([&](const void* key, size_t value) { visited[key] = value; });
+    EXPECT_EQ(visited.size(), kCount / 2);
+    for (size_t i = 1; i < kCount; i += 2) {
+        EXPECT_EQ(visited[&objects[i]], i);
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/IndexedMemoryPool.h"
+#include "tests/DummyMemoryAllocator.h"
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+
+class IndexedMemoryPoolTests : public testing::Test {
+  public:
+    std::unique_ptr<MemoryAllocation> CreateMemory() {
+        MEMORY_ALLOCATION_REQUEST request = {};
+        request.Size = kDefaultMemorySize;
+        request.Alignment = 1;
+        return mMemoryAllocator.TryAllocateMemory(request);
+    }
+
+    DummyMemoryAllocator mMemoryAllocator;
+};
+
+// Verify memory is acquired by the index it was returned to.
+TEST_F(IndexedMemoryPoolTests, SingleIndex) {
+    IndexedMemoryPool pool(kDefaultMemorySize);
+
+    EXPECT_EQ(pool.AcquireFromPool(0), nullptr);
+
+    std::unique_ptr<MemoryAllocation> memory = CreateMemory();
+    const MemoryAllocation* memoryPtr = memory.get();
+    pool.ReturnToPool(std::move(memory), 0);
+    EXPECT_EQ(pool.GetPoolSize(), 1u);
+
+    EXPECT_EQ(pool.AcquireFromPool(1), nullptr);
+
+    memory = pool.AcquireFromPool(0);
+    EXPECT_EQ(memory.get(), memoryPtr);
+    EXPECT_EQ(pool.GetPoolSize(), 0u);
+    EXPECT_EQ(pool.AcquireFromPool(0), nullptr);
+
+    mMemoryAllocator.DeallocateMemory(std::move(memory));
+}
+
+// Verify indices far apart, like those of a large system, are pooled and released.
+TEST_F(IndexedMemoryPoolTests, SparseIndices) {
+    IndexedMemoryPool pool(kDefaultMemorySize);
+
+    const uint64_t kIndices[] = {0, 1, 63, 64, 1ull << 32, (1ull << 48) + 7};
+    for (uint64_t memoryIndex : kIndices) {
+        pool.ReturnToPool(CreateMemory(), memoryIndex);
+    }
+    EXPECT_EQ(pool.GetPoolSize(), 6u);
+
+    std::unique_ptr<MemoryAllocation> memory = pool.AcquireFromPool(1ull << 32);
+    ASSERT_NE(memory, nullptr);
+    EXPECT_EQ(pool.AcquireFromPool(1ull << 32), nullptr);
+    EXPECT_EQ(pool.GetPoolSize(), 5u);
+
+    pool.ReturnToPool(std::move(memory), 1ull << 32);
+
+    EXPECT_EQ(pool.ReleasePool(), kDefaultMemorySize * 6);
+    EXPECT_EQ(pool.GetPoolSize(), 0u);
+    EXPECT_EQ(mMemoryAllocator.QueryInfo().UsedMemoryCount, 0u);
+}
@@ -0,0 +1,105 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/JSONEncoder.h"
+
+using namespace gpgmm;
+
+TEST(JSONEncoderTests, EmptyDictAndArray) {
+    JSONDict dict;
+    EXPECT_TRUE(dict.IsEmpty());
+    EXPECT_EQ(dict.ToString(), "{  }");
+
+    EXPECT_EQ(JSONArray().ToString(), "[  ]");
+}
+
+TEST(JSONEncoderTests, DictItems) {
+    JSONDict dict;
+    dict.AddItem("string", std::string("value"));
+    dict.AddItem("char", 'X');
+    dict.AddItem("uint64", uint64_t(18446744073709551615ull));
+    dict.AddItem("uint32", uint32_t(42));
+    dict.AddItem("int", -1);
+    dict.AddItem("bool", true);
+    dict.AddItem("double", 0.5);
+    EXPECT_FALSE(dict.IsEmpty());
+    EXPECT_EQ(dict.ToString(),
+              "{ \"string\": \"value\", \"char\": \"X\", \"uint64\": 18446744073709551615, "
+              "\"uint32\": 42, \"int\": -1, \"bool\": 1, \"double\": 0.500000 }");
+}
+
+// Verify nested dicts and arrays are encoded the same whether written in place or added.
+TEST(JSONEncoderTests, Nested) {
+    JSONDict inner;
+    inner.AddItem("a", 1);
+
+    JSONArray array;
+    array.AddItem(inner);
+    array.AddItem(2);
+
+    JSONDict outer;
+    outer.AddItem("inner", inner);
+    outer.AddItem("array", array);
+
+    const std::string expected = "{ \"inner\": { \"a\": 1 }, \"array\": [ { \"a\": 1 }, 2 ] }";
+    EXPECT_EQ(outer.ToString(), expected);
+
+    JSONWriter writer;
+    writer.BeginDict();
+    writer.AddName("inner");
+    writer.BeginDict();
+    writer.AddItem("a", 1);
+    writer.EndDict();
+    writer.AddName("array");
+    writer.BeginArray();
+    writer.BeginDict();
+    writer.AddItem("a", 1);
+    writer.EndDict();
+    writer.AddValue(2);
+    writer.EndArray();
+    writer.EndDict();
+    EXPECT_EQ(writer.GetBuffer(), expected);
+}
+
+// Verify dicts and arrays left open are closed when converted to a string.
+TEST(JSONEncoderTests, CloseOpenScopes) {
+    JSONWriter writer;
+    writer.BeginDict();
+    writer.AddName("array");
+    writer.BeginArray();
+    writer.AddValue(1);
+    EXPECT_EQ(writer.ToString(), "{ \"array\": [ 1 ] }");
+
+    // Converting does not close them in the writer itself.
+    writer.AddValue(2);
+    EXPECT_EQ(writer.ToString(), "{ \"array\": [ 1, 2 ] }");
+}
+
+// Verify a reset writer can be re-used without the earlier JSON.
+TEST(JSONEncoderTests, Reset) {
+    JSONWriter writer;
+    writer.BeginDict();
+    writer.AddItem("first", 1);
+    writer.EndDict();
+
+    writer.Reset();
+    EXPECT_TRUE(writer.IsEmpty());
+
+    writer.BeginDict();
+    writer.AddItem("second", 2);
+    writer.EndDict();
+    EXPECT_EQ(writer.GetBuffer(), "{ \"second\": 2 }");
+}
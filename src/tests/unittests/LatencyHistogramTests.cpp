@@ -0,0 +1,95 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/LatencyHistogram.h"
+
+#include <limits>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+// Verify every latency falls within its bucket, and the error of each bucket is bounded.
+TEST(LatencyHistogramTests, Buckets) {
+    // Small latencies are counted exactly.
+    for (uint64_t latency = 0; latency < 16; latency++) {
+        EXPECT_EQ(LatencyHistogram::GetBucketIndex(latency), latency);
+        EXPECT_EQ(LatencyHistogram::GetBucketMaxLatency(latency), latency);
+    }
+
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(16), 16u);
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(31), 31u);
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(32), 32u);
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(33), 32u);
+    EXPECT_EQ(LatencyHistogram::GetBucketMaxLatency(32), 33u);
+
+    for (uint64_t latency : std::vector<uint64_t>{100, 1000, 12345, 1ull << 40, (1ull << 40) + 1,
+                                                  std::numeric_limits<uint64_t>::max()}) {
+        const uint32_t bucketIndex = LatencyHistogram::GetBucketIndex(latency);
+        const uint64_t maxLatency = LatencyHistogram::GetBucketMaxLatency(bucketIndex);
+        EXPECT_GE(maxLatency, latency);
+        EXPECT_LE(maxLatency - latency, latency / 16);
+        EXPECT_EQ(LatencyHistogram::GetBucketIndex(maxLatency), bucketIndex);
+    }
+}
+
+TEST(LatencyHistogramTests, Percentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.QueryInfo().Count, 0u);
+    EXPECT_EQ(histogram.QueryInfo().P50, 0u);
+
+    // 990 fast latencies, 9 slow ones and a single very slow one.
+    for (uint32_t i = 0; i < 990; i++) {
+        histogram.Record(10);
+    }
+    for (uint32_t i = 0; i < 9; i++) {
+        histogram.Record(1000);
+    }
+    histogram.Record(100000);
+
+    const LATENCY_HISTOGRAM_INFO info = histogram.QueryInfo();
+    EXPECT_EQ(info.Count, 1000u);
+    EXPECT_EQ(info.P50, 10u);
+    EXPECT_EQ(info.P99, 10u);
+    EXPECT_EQ(info.P999, LatencyHistogram::GetBucketMaxLatency(
+                             LatencyHistogram::GetBucketIndex(1000)));
+
+    histogram.Record(100000);
+    EXPECT_EQ(histogram.QueryInfo().P999, LatencyHistogram::GetBucketMaxLatency(
+                                              LatencyHistogram::GetBucketIndex(100000)));
+}
+
+// Verify latencies recorded by many threads at once are all counted.
+TEST(LatencyHistogramTests, RecordConcurrently) {
+    constexpr static uint32_t kThreadCount = 4;
+    constexpr static uint32_t kRecordsPerThread = 1000;
+
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < kThreadCount; i++) {
+        threads.emplace_back([&]() {
+            for (uint32_t j = 0; j < kRecordsPerThread; j++) {
+                histogram.Record(j);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(histogram.QueryInfo().Count, kThreadCount * kRecordsPerThread);
+}
@@ -0,0 +1,126 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/LifetimeMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+static constexpr uint64_t kDefaultMemoryAlignment = 1u;
+
+static MEMORY_ALLOCATION_REQUEST CreateLifetimeRequest(uint64_t size,
+                                                       MemoryAllocationLifetime lifetime) {
+    MEMORY_ALLOCATION_REQUEST request = CreateBasicRequest(size, kDefaultMemoryAlignment);
+    request.Lifetime = lifetime;
+    return request;
+}
+
+static std::vector<std::unique_ptr<MemoryAllocator>> CreateBuddyAllocators() {
+    std::vector<std::unique_ptr<MemoryAllocator>> allocators;
+    for (uint32_t i = 0; i < kNumOfMemoryAllocationLifetimes; i++) {
+        allocators.push_back(std::make_unique<BuddyMemoryAllocator>(
+            kDefaultMemorySize, kDefaultMemorySize, kDefaultMemoryAlignment,
+            std::make_unique<DummyMemoryAllocator>()));
+    }
+    return allocators;
+}
+
+TEST(LifetimeMemoryAllocatorTests, Basic) {
+    std::vector<std::unique_ptr<MemoryAllocator>> allocators;
+    for (uint32_t i = 0; i < kNumOfMemoryAllocationLifetimes; i++) {
+        allocators.push_back(std::make_unique<DummyMemoryAllocator>());
+    }
+
+    LifetimeMemoryAllocator alloc(std::move(allocators));
+
+    // Each lifetime uses its own allocator.
+    std::unique_ptr<MemoryAllocation> transientAllocation =
+        alloc.TryAllocateMemory(CreateLifetimeRequest(4, MemoryAllocationLifetime::kTransient));
+    ASSERT_NE(transientAllocation, nullptr);
+    EXPECT_EQ(transientAllocation->GetAllocator(),
+              alloc.GetAllocator(MemoryAllocationLifetime::kTransient));
+
+    std::unique_ptr<MemoryAllocation> frameAllocation =
+        alloc.TryAllocateMemory(CreateLifetimeRequest(8, MemoryAllocationLifetime::kFrame));
+    ASSERT_NE(frameAllocation, nullptr);
+    EXPECT_EQ(frameAllocation->GetAllocator(),
+              alloc.GetAllocator(MemoryAllocationLifetime::kFrame));
+
+    std::unique_ptr<MemoryAllocation> persistentAllocation =
+        alloc.TryAllocateMemory(CreateLifetimeRequest(16, MemoryAllocationLifetime::kPersistent));
+    ASSERT_NE(persistentAllocation, nullptr);
+    EXPECT_EQ(persistentAllocation->GetAllocator(),
+              alloc.GetAllocator(MemoryAllocationLifetime::kPersistent));
+
+    // Requests without a lifetime use the unknown lifetime allocator.
+    std::unique_ptr<MemoryAllocation> allocation =
+        alloc.TryAllocateMemory(CreateBasicRequest(32, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetAllocator(), alloc.GetAllocator(MemoryAllocationLifetime::kUnknown));
+
+    EXPECT_EQ(alloc.GetAllocator(MemoryAllocationLifetime::kTransient)
+                  ->QueryInfo()
+                  .UsedMemoryUsage,
+              4u);
+    EXPECT_EQ(alloc.GetAllocator(MemoryAllocationLifetime::kFrame)->QueryInfo().UsedMemoryUsage,
+              8u);
+    EXPECT_EQ(alloc.GetAllocator(MemoryAllocationLifetime::kPersistent)
+                  ->QueryInfo()
+                  .UsedMemoryUsage,
+              16u);
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryUsage, 60u);
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryCount, 4u);
+
+    alloc.DeallocateMemory(std::move(transientAllocation));
+    alloc.DeallocateMemory(std::move(frameAllocation));
+    alloc.DeallocateMemory(std::move(persistentAllocation));
+    alloc.DeallocateMemory(std::move(allocation));
+
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryUsage, 0u);
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify memory kept by a persistent allocation is not pinned by transient allocations.
+TEST(LifetimeMemoryAllocatorTests, QueryFragmentationInfo) {
+    LifetimeMemoryAllocator alloc(CreateBuddyAllocators());
+
+    std::unique_ptr<MemoryAllocation> persistentAllocation =
+        alloc.TryAllocateMemory(CreateLifetimeRequest(32, MemoryAllocationLifetime::kPersistent));
+    ASSERT_NE(persistentAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> transientAllocation =
+        alloc.TryAllocateMemory(CreateLifetimeRequest(64, MemoryAllocationLifetime::kTransient));
+    ASSERT_NE(transientAllocation, nullptr);
+
+    // Both were allocated in separate memory.
+    EXPECT_NE(persistentAllocation->GetMemory(), transientAllocation->GetMemory());
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryCount, 2u);
+
+    // Once the transient allocation is released, so is its memory and only the persistent
+    // memory remains.
+    alloc.DeallocateMemory(std::move(transientAllocation));
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryCount, 1u);
+
+    EXPECT_EQ(alloc.QueryFragmentationInfo(MemoryAllocationLifetime::kTransient).FreeBlockUsage,
+              0u);
+    EXPECT_EQ(alloc.QueryFragmentationInfo(MemoryAllocationLifetime::kPersistent).FreeBlockUsage,
+              kDefaultMemorySize - 32u);
+
+    alloc.DeallocateMemory(std::move(persistentAllocation));
+    EXPECT_EQ(alloc.QueryInfo().UsedMemoryCount, 0u);
+}
@@ -0,0 +1,223 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/LinearMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+static constexpr uint64_t kDefaultMemoryAlignment = 1u;
+
+static MEMORY_ALLOCATION_REQUEST CreateUpperAddressRequest(uint64_t size, uint64_t alignment) {
+    MEMORY_ALLOCATION_REQUEST request = CreateBasicRequest(size, alignment);
+    request.UpperAddress = true;
+    return request;
+}
+
+TEST(LinearMemoryAllocatorTests, SingleMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    LinearMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemoryAlignment,
+                                    std::move(dummyMemoryAllocator));
+
+    // Allocation cannot be greater then the memory size.
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize * 2, 1)), nullptr);
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(0, 1)), nullptr);
+
+    // Allocations are made one after another from the same memory.
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetOffset(), 0u);
+    EXPECT_EQ(firstAllocation->GetSize(), 32u);
+    EXPECT_EQ(firstAllocation->GetMethod(), AllocationMethod::kSubAllocated);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 64));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetOffset(), 64u);
+    EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 2u);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 64u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    // Space is not re-used until reset, which cannot be done while allocations remain.
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    EXPECT_FALSE(allocator.Reset());
+
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    EXPECT_TRUE(allocator.Reset());
+
+    // Memory is kept once reset.
+    std::unique_ptr<MemoryAllocation> thirdAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize, 1));
+    ASSERT_NE(thirdAllocation, nullptr);
+    EXPECT_EQ(thirdAllocation->GetOffset(), 0u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+    EXPECT_EQ(allocator.GetMemoryCountForTesting(), 1u);
+
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(allocator.GetMemoryCountForTesting(), 0u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify allocations move on to the next memory once the current one is full.
+TEST(LinearMemoryAllocatorTests, MultipleMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    LinearMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemoryAlignment,
+                                    std::move(dummyMemoryAllocator));
+
+    constexpr uint64_t kAllocationSize = 48u;
+    constexpr uint64_t kNumOfFrames = 4u;
+    constexpr uint64_t kNumOfAllocationsPerFrame = 5u;
+
+    // Two allocations fit per memory, so each frame uses three memories.
+    for (uint64_t frame = 0; frame < kNumOfFrames; frame++) {
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations;
+        for (uint64_t i = 0; i < kNumOfAllocationsPerFrame; i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kAllocationSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetOffset(), (i % 2) * kAllocationSize);
+            allocations.push_back(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocations[0]->GetMemory(), allocations[1]->GetMemory());
+        EXPECT_NE(allocations[1]->GetMemory(), allocations[2]->GetMemory());
+
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_TRUE(allocator.Reset());
+
+        // Memory from previous frames is re-used.
+        EXPECT_EQ(allocator.GetMemoryCountForTesting(), 3u);
+        EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 3u);
+    }
+
+    // Memory which contains no allocation is released.
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kAllocationSize, 1));
+    ASSERT_NE(allocation, nullptr);
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(allocator.GetMemoryCountForTesting(), 1u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    allocator.DeallocateMemory(std::move(allocation));
+}
+
+// Verify deallocating the most recent allocation frees its space right away.
+TEST(LinearMemoryAllocatorTests, Stack) {
+    LinearMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemoryAlignment,
+                                    std::make_unique<DummyMemoryAllocator>());
+
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(firstAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 64));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetOffset(), 64u);
+
+    // Popping the second allocation also frees the padding skipped to align it.
+    allocator.DeallocateMemory(std::move(secondAllocation));
+
+    std::unique_ptr<MemoryAllocation> thirdAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(thirdAllocation, nullptr);
+    EXPECT_EQ(thirdAllocation->GetOffset(), 32u);
+
+    // Deallocating out of order frees nothing.
+    allocator.DeallocateMemory(std::move(firstAllocation));
+
+    std::unique_ptr<MemoryAllocation> fourthAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(fourthAllocation, nullptr);
+    EXPECT_EQ(fourthAllocation->GetOffset(), 64u);
+
+    allocator.DeallocateMemory(std::move(fourthAllocation));
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+}
+
+// Verify upper address allocations grow down from the end of the memory.
+TEST(LinearMemoryAllocatorTests, DoubleEndedStack) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    LinearMemoryAllocator allocator(kDefaultMemorySize, kDefaultMemoryAlignment,
+                                    std::move(dummyMemoryAllocator));
+
+    std::unique_ptr<MemoryAllocation> lowerAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(lowerAllocation, nullptr);
+    EXPECT_EQ(lowerAllocation->GetOffset(), 0u);
+
+    std::unique_ptr<MemoryAllocation> upperAllocation =
+        allocator.TryAllocateMemory(CreateUpperAddressRequest(40, 16));
+    ASSERT_NE(upperAllocation, nullptr);
+    EXPECT_EQ(upperAllocation->GetOffset(), 80u);
+    EXPECT_EQ(upperAllocation->GetMemory(), lowerAllocation->GetMemory());
+
+    EXPECT_EQ(allocator.QueryFragmentationInfo().FreeBlockUsage, 48u);
+
+    // Both ends met.
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateUpperAddressRequest(64, 1)), nullptr);
+
+    // Lower allocations which no longer fit move on to the next memory instead.
+    std::unique_ptr<MemoryAllocation> nextAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 1));
+    ASSERT_NE(nextAllocation, nullptr);
+    EXPECT_EQ(nextAllocation->GetOffset(), 0u);
+    EXPECT_NE(nextAllocation->GetMemory(), lowerAllocation->GetMemory());
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 2u);
+
+    // Upper allocations remain within the first memory.
+    std::unique_ptr<MemoryAllocation> secondUpperAllocation =
+        allocator.TryAllocateMemory(CreateUpperAddressRequest(48, 1));
+    ASSERT_NE(secondUpperAllocation, nullptr);
+    EXPECT_EQ(secondUpperAllocation->GetOffset(), 32u);
+    EXPECT_EQ(secondUpperAllocation->GetMemory(), lowerAllocation->GetMemory());
+
+    // Popping the upper allocations frees their space.
+    allocator.DeallocateMemory(std::move(secondUpperAllocation));
+    allocator.DeallocateMemory(std::move(upperAllocation));
+
+    std::unique_ptr<MemoryAllocation> thirdUpperAllocation =
+        allocator.TryAllocateMemory(CreateUpperAddressRequest(96, 1));
+    ASSERT_NE(thirdUpperAllocation, nullptr);
+    EXPECT_EQ(thirdUpperAllocation->GetOffset(), 32u);
+
+    allocator.DeallocateMemory(std::move(thirdUpperAllocation));
+    allocator.DeallocateMemory(std::move(nextAllocation));
+    allocator.DeallocateMemory(std::move(lowerAllocation));
+
+    EXPECT_TRUE(allocator.Reset());
+}
@@ -16,6 +16,8 @@
 
 #include "gpgmm/common/LinkedList.h"
 
+#include <vector>
+
 using namespace gpgmm;
 
 // Tests functional additions made to LinkedList.h.
@@ -42,3 +44,113 @@ TEST(LinkedListTests, RemoveAndDeleteAll) {
     list.RemoveAndDeleteAll();
     EXPECT_TRUE(list.empty());
 }
+
+TEST(LinkedListTests, Size) {
+    FakeObject first;
+    FakeObject second;
+
+    LinkedList<FakeObject> list;
+    EXPECT_EQ(list.size(), 0u);
+
+    list.Append(&first);
+    list.Prepend(&second);
+    EXPECT_EQ(list.size(), 2u);
+    EXPECT_EQ(list.head(), &second);
+    EXPECT_EQ(list.tail(), &first);
+
+    // Nodes which remove themselves are no longer counted.
+    first.RemoveFromList();
+    EXPECT_EQ(list.size(), 1u);
+
+    second.RemoveFromList();
+    EXPECT_EQ(list.size(), 0u);
+    EXPECT_TRUE(list.empty());
+}
+
+TEST(LinkedListTests, Iterate) {
+    FakeObject objects[3];
+
+    LinkedList<FakeObject> list;
+    for (FakeObject& object : objects) {
+        list.Append(&object);
+    }
+
+    size_t index = 0;
+    for (FakeObject* object : list) {
+        EXPECT_EQ(object, &objects[index++]);
+    }
+    EXPECT_EQ(index, 3u);
+}
+
+// Verify nodes moved to another list are counted by it.
+TEST(LinkedListTests, Splice) {
+    FakeObject objects[4];
+
+    LinkedList<FakeObject> list;
+    LinkedList<FakeObject> otherList;
+    for (FakeObject& object : objects) {
+        list.Append(&object);
+    }
+
+    // Move a single node.
+    otherList.Splice(otherList.end(), &objects[2]);
+    EXPECT_EQ(list.size(), 3u);
+    EXPECT_EQ(otherList.size(), 1u);
+
+    // Move a range of nodes to another list, then within it.
+    otherList.Splice(otherList.begin(), list.begin(), &objects[3]);
+    EXPECT_EQ(list.size(), 1u);
+    EXPECT_EQ(otherList.size(), 3u);
+    EXPECT_EQ(list.head(), &objects[3]);
+
+    otherList.Splice(otherList.end(), otherList.begin(), &objects[2]);
+    EXPECT_EQ(otherList.size(), 3u);
+
+    std::vector<FakeObject*> values;
+    for (FakeObject* object : otherList) {
+        values.push_back(object);
+    }
+    EXPECT_EQ(values, (std::vector<FakeObject*>{&objects[2], &objects[0], &objects[1]}));
+
+    // Moving an empty range does nothing.
+    list.Splice(list.end(), otherList.end(), otherList.end());
+    EXPECT_EQ(list.size(), 1u);
+    EXPECT_EQ(otherList.size(), 3u);
+}
+
+// Verify moving a list takes its nodes, and leaves the other list empty.
+TEST(LinkedListTests, Move) {
+    FakeObject first;
+
+    LinkedList<FakeObject> emptyList;
+    LinkedList<FakeObject> movedEmptyList(std::move(emptyList));
+    EXPECT_TRUE(movedEmptyList.empty());
+    EXPECT_EQ(movedEmptyList.size(), 0u);
+
+    LinkedList<FakeObject> list;
+    list.Append(&first);
+
+    LinkedList<FakeObject> movedList(std::move(list));
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(movedList.size(), 1u);
+    EXPECT_EQ(movedList.head(), &first);
+
+    first.RemoveFromList();
+    EXPECT_TRUE(movedList.empty());
+}
+
+// Verify a node spliced before itself stays in place.
+TEST(LinkedListTests, SpliceInPlace) {
+    FakeObject first;
+    FakeObject second;
+
+    LinkedList<FakeObject> list;
+    list.Append(&first);
+    list.Append(&second);
+
+    list.Splice(list.begin(), &first);
+    list.Splice(&second, &first);
+    EXPECT_EQ(list.size(), 2u);
+    EXPECT_EQ(list.head(), &first);
+    EXPECT_EQ(list.tail(), &second);
+}
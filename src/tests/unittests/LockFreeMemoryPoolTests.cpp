@@ -0,0 +1,98 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/LockFreeMemoryPool.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+
+TEST(LockFreeMemoryPoolTests, SingleThread) {
+    DummyMemoryAllocator allocator;
+    LockFreeMemoryPool pool(kDefaultMemorySize);
+
+    EXPECT_EQ(pool.AcquireFromPool(), nullptr);
+
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize, 1));
+    MemoryBase* firstMemory = firstAllocation->GetMemory();
+    pool.ReturnToPool(std::move(firstAllocation));
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize, 1));
+    MemoryBase* secondMemory = secondAllocation->GetMemory();
+    pool.ReturnToPool(std::move(secondAllocation));
+
+    EXPECT_EQ(pool.GetPoolSize(), 2u);
+
+    // Newest is recycled first.
+    std::unique_ptr<MemoryAllocation> allocation = pool.AcquireFromPool();
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory(), secondMemory);
+    pool.ReturnToPool(std::move(allocation));
+
+    EXPECT_EQ(pool.ReleasePool(1), kDefaultMemorySize);
+    EXPECT_EQ(pool.GetPoolSize(), 1u);
+
+    allocation = pool.AcquireFromPool();
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory(), firstMemory);
+    pool.ReturnToPool(std::move(allocation));
+
+    EXPECT_EQ(pool.ReleasePool(), kDefaultMemorySize);
+    EXPECT_EQ(pool.GetPoolSize(), 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryCount, 0u);
+}
+
+TEST(LockFreeMemoryPoolTests, MultipleThreads) {
+    DummyMemoryAllocator allocator;
+    LockFreeMemoryPool pool(kDefaultMemorySize);
+
+    constexpr uint64_t kNumOfThreads = 8;
+    constexpr uint64_t kNumOfAllocations = 1000;
+
+    // Each thread recycles its own allocations through the shared pool.
+    std::vector<std::thread> threads(kNumOfThreads);
+    for (auto& thread : threads) {
+        thread = std::thread([&]() {
+            for (uint64_t i = 0; i < kNumOfAllocations; i++) {
+                std::unique_ptr<MemoryAllocation> allocation = pool.AcquireFromPool();
+                if (allocation == nullptr) {
+                    allocation =
+                        allocator.TryAllocateMemory(CreateBasicRequest(kDefaultMemorySize, 1));
+                }
+                ASSERT_NE(allocation, nullptr);
+                pool.ReturnToPool(std::move(allocation));
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Every allocated memory must have been returned exactly once.
+    EXPECT_EQ(pool.GetPoolSize(), allocator.QueryInfo().UsedMemoryCount);
+    EXPECT_LE(pool.GetPoolSize(), kNumOfThreads);
+
+    pool.ReleasePool();
+    EXPECT_EQ(pool.GetPoolSize(), 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryCount, 0u);
+}
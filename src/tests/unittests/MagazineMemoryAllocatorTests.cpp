@@ -0,0 +1,166 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/MagazineMemoryAllocator.h"
+#include "gpgmm/SlabMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kMinBlockSize = 4u;
+static constexpr uint64_t kMaxSlabSize = 512u;
+static constexpr uint64_t kSlabSize = 128u;
+static constexpr uint64_t kMagazineSize = 8u;
+
+class MagazineMemoryAllocatorTests : public testing::Test {
+  public:
+    std::unique_ptr<MagazineMemoryAllocator> CreateAllocator() {
+        return std::make_unique<MagazineMemoryAllocator>(
+            std::make_unique<SlabCacheAllocator>(kMinBlockSize, kMaxSlabSize, kSlabSize,
+                                                 /*slabAlignment*/ 1,
+                                                 /*slabFragmentationLimit*/ 0,
+                                                 /*prefetchSlab*/ false,
+                                                 std::make_unique<DummyMemoryAllocator>()),
+            kMinBlockSize, kMagazineSize);
+    }
+};
+
+// Verify the magazine is refilled from memory which already exists.
+TEST_F(MagazineMemoryAllocatorTests, Refill) {
+    constexpr uint64_t kBlockSize = 32;
+    std::unique_ptr<MagazineMemoryAllocator> allocator = CreateAllocator();
+
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator->TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetAllocator(), allocator.get());
+
+    // The remaining blocks of the slab should be cached without creating another slab.
+    EXPECT_EQ(allocator->GetCachedBlockCountForTesting(), (kSlabSize / kBlockSize) - 1);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 1u);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockUsage, kBlockSize);
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryCount, 1u);
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryUsage, kSlabSize);
+
+    // Subsequent requests are satisfied by the magazine.
+    std::unique_ptr<MemoryAllocation> cachedAllocation =
+        allocator->TryAllocateMemory(CreateBasicRequest(kBlockSize, 1, /*neverAllocate*/ true));
+    ASSERT_NE(cachedAllocation, nullptr);
+    EXPECT_NE(cachedAllocation->GetOffset(), allocation->GetOffset());
+    EXPECT_EQ(allocator->GetCachedBlockCountForTesting(), (kSlabSize / kBlockSize) - 2);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 2u);
+
+    allocator->DeallocateMemory(std::move(cachedAllocation));
+    allocator->DeallocateMemory(std::move(allocation));
+
+    // Deallocated blocks are cached, not released.
+    EXPECT_EQ(allocator->GetCachedBlockCountForTesting(), kSlabSize / kBlockSize);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryCount, 1u);
+
+    allocator->ReleaseMemory();
+    EXPECT_EQ(allocator->GetCachedBlockCountForTesting(), 0u);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryCount, 0u);
+    EXPECT_EQ(allocator->QueryInfo().UsedMemoryUsage, 0u);
+}
+
+// Verify a full magazine drains half its blocks back to the memory allocator.
+TEST_F(MagazineMemoryAllocatorTests, Drain) {
+    constexpr uint64_t kBlockSize = 4;
+    std::unique_ptr<MagazineMemoryAllocator> allocator = CreateAllocator();
+
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (uint64_t i = 0; i < kMagazineSize * 2; i++) {
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator->TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+        ASSERT_NE(allocation, nullptr);
+        allocations.push_back(std::move(allocation));
+    }
+
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, kMagazineSize * 2);
+
+    for (auto& allocation : allocations) {
+        allocator->DeallocateMemory(std::move(allocation));
+        EXPECT_LE(allocator->GetCachedBlockCountForTesting(), kMagazineSize);
+    }
+
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 0u);
+    EXPECT_GT(allocator->GetCachedBlockCountForTesting(), 0u);
+}
+
+// Verify blocks of different sizes are cached separately.
+TEST_F(MagazineMemoryAllocatorTests, MultipleSizes) {
+    std::unique_ptr<MagazineMemoryAllocator> allocator = CreateAllocator();
+
+    std::unique_ptr<MemoryAllocation> smallAllocation =
+        allocator->TryAllocateMemory(CreateBasicRequest(16, 1));
+    ASSERT_NE(smallAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> largeAllocation =
+        allocator->TryAllocateMemory(CreateBasicRequest(64, 1));
+    ASSERT_NE(largeAllocation, nullptr);
+    EXPECT_NE(smallAllocation->GetMemory(), largeAllocation->GetMemory());
+
+    const uint64_t smallBlockSize = smallAllocation->GetSize();
+    allocator->DeallocateMemory(std::move(smallAllocation));
+
+    // The cached small block must not be used for a larger request.
+    largeAllocation = allocator->TryAllocateMemory(CreateBasicRequest(64, 1));
+    ASSERT_NE(largeAllocation, nullptr);
+    EXPECT_GE(largeAllocation->GetSize(), 64u);
+    EXPECT_LT(smallBlockSize, largeAllocation->GetSize());
+
+    allocator->DeallocateMemory(std::move(largeAllocation));
+}
+
+// Verify each thread allocates from and deallocates to its own magazines.
+TEST_F(MagazineMemoryAllocatorTests, MultipleThreads) {
+    constexpr uint64_t kThreadCount = 8;
+    constexpr uint64_t kAllocationCount = 64;
+    std::unique_ptr<MagazineMemoryAllocator> allocator = CreateAllocator();
+
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
+        threads[threadIdx] = std::thread([&]() {
+            std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+            for (uint64_t i = 0; i < kAllocationCount; i++) {
+                std::unique_ptr<MemoryAllocation> allocation =
+                    allocator->TryAllocateMemory(CreateBasicRequest(kMinBlockSize, 1));
+                ASSERT_NE(allocation, nullptr);
+                allocations.push_back(std::move(allocation));
+            }
+            for (auto& allocation : allocations) {
+                allocator->DeallocateMemory(std::move(allocation));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(allocator->QueryInfo().UsedBlockUsage, 0u);
+
+    // Magazines of exited threads are returned upon release.
+    EXPECT_GT(allocator->GetCachedBlockCountForTesting(), 0u);
+    allocator->ReleaseMemory();
+    EXPECT_EQ(allocator->GetCachedBlockCountForTesting(), 0u);
+}
@@ -42,6 +42,15 @@ TEST(MathTests, PrevPowerOfTwo) {
     EXPECT_EQ(PrevPowerOfTwo((2ull << 31) + 1), 2ull << 31);
 }
 
+TEST(MathTests, ScanForward) {
+    EXPECT_EQ(ScanForward(1u), 0u);
+    EXPECT_EQ(ScanForward(0x80000000u), 31u);
+    EXPECT_EQ(ScanForward(uint64_t(1)), 0u);
+    EXPECT_EQ(ScanForward(uint64_t(0x100000000)), 32u);
+    EXPECT_EQ(ScanForward(uint64_t(0x8000000000000000)), 63u);
+    EXPECT_EQ(ScanForward(uint64_t(0xF0)), 4u);
+}
+
 TEST(MathTests, IsAligned) {
     // Check if a POT number is NOT aligned with a NPOT multiple.
     EXPECT_FALSE(IsAligned(2u, 3u));
@@ -72,3 +81,15 @@ TEST(MathTests, AlignTo) {
     // Align UINT64_MAX to POT multiple.
     ASSERT_EQ(AlignTo(static_cast<uint64_t>(0xFFFFFFFFFFFFFFFF), 1), 0xFFFFFFFFFFFFFFFFull);
 }
+
+// Verify the math can be evaluated at compile-time, where the compiler supports it.
+TEST(MathTests, ConstantEvaluated) {
+#if !defined(GPGMM_COMPILER_MSVC)
+    static_assert(Log2(uint64_t(4 * 1024 * 1024)) == 22u, "");
+    static_assert(NextPowerOfTwo(uint64_t(3 * 1024 * 1024)) == 4 * 1024 * 1024, "");
+    static_assert(PrevPowerOfTwo(uint64_t(3 * 1024 * 1024)) == 2 * 1024 * 1024, "");
+    static_assert(IsPowerOfTwo(uint64_t(4 * 1024 * 1024)), "");
+    static_assert(AlignTo(uint64_t(10), 16) == 16u, "");
+    static_assert(ScanForward(uint64_t(1) << 40) == 40u, "");
+#endif
+}
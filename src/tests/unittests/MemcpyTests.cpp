@@ -0,0 +1,55 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/Memcpy.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace gpgmm;
+
+// Verify every byte is copied regardless of size or alignment, and nothing around it is written.
+TEST(MemcpyTests, CopyToWriteCombined) {
+    constexpr size_t kGuardSize = 16u;
+    constexpr size_t kMaxSize = 300u;
+    constexpr uint8_t kGuardByte = 0xCD;
+
+    std::vector<uint8_t> src(kMaxSize + 16u);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = static_cast<uint8_t>(i * 7 + 1);
+    }
+
+    for (size_t dstOffset = 0; dstOffset < 16u; dstOffset += 3) {
+        for (size_t srcOffset = 0; srcOffset < 16u; srcOffset += 5) {
+            for (size_t size : {0u, 1u, 15u, 16u, 63u, 64u, 65u, 128u, 255u, 300u}) {
+                std::vector<uint8_t> dst(kMaxSize + 16u + kGuardSize * 2, kGuardByte);
+                uint8_t* dstBytes = dst.data() + kGuardSize + dstOffset;
+
+                CopyToWriteCombined(dstBytes, src.data() + srcOffset, size);
+
+                for (size_t i = 0; i < size; i++) {
+                    ASSERT_EQ(dstBytes[i], src[srcOffset + i]);
+                }
+                for (uint8_t* it = dst.data(); it < dstBytes; it++) {
+                    ASSERT_EQ(*it, kGuardByte);
+                }
+                for (uint8_t* it = dstBytes + size; it < dst.data() + dst.size(); it++) {
+                    ASSERT_EQ(*it, kGuardByte);
+                }
+            }
+        }
+    }
+}
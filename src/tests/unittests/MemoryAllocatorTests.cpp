@@ -19,6 +19,9 @@
 #include "gpgmm/common/Math.h"
 #include "tests/DummyMemoryAllocator.h"
 
+#include <condition_variable>
+#include <mutex>
+
 using namespace gpgmm;
 
 static uint64_t DestructCount = 0;
@@ -30,9 +33,9 @@ class TestMemoryAllocator final : public DummyMemoryAllocator {
         DestructCount++;
     }
 
-    void ReleaseMemory() override {
-        MemoryAllocator::ReleaseMemory();
+    uint64_t ReleaseMemory(uint64_t bytesToRelease = kInvalidSize) override {
         ReleaseMemoryCount++;
+        return MemoryAllocator::ReleaseMemory(bytesToRelease);
     }
 
     TestMemoryAllocator* AppendChild(std::unique_ptr<TestMemoryAllocator> obj) {
@@ -44,6 +47,38 @@ class TestMemoryAllocator final : public DummyMemoryAllocator {
     }
 };
 
+// Blocks allocations until Release is called.
+class BlockingMemoryAllocator final : public DummyMemoryAllocator {
+  public:
+    std::unique_ptr<MemoryAllocation> TryAllocateMemory(
+        const MEMORY_ALLOCATION_REQUEST& request) override {
+        {
+            std::unique_lock<std::mutex> lock(mBlockingMutex);
+            mIsAllocating = true;
+            mBlockingCondition.notify_all();
+            mBlockingCondition.wait(lock, [this] { return mIsReleased; });
+        }
+        return DummyMemoryAllocator::TryAllocateMemory(request);
+    }
+
+    void WaitUntilAllocating() {
+        std::unique_lock<std::mutex> lock(mBlockingMutex);
+        mBlockingCondition.wait(lock, [this] { return mIsAllocating; });
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(mBlockingMutex);
+        mIsReleased = true;
+        mBlockingCondition.notify_all();
+    }
+
+  private:
+    std::mutex mBlockingMutex;
+    std::condition_variable mBlockingCondition;
+    bool mIsAllocating = false;
+    bool mIsReleased = false;
+};
+
 class MemoryAllocatorTests : public testing::Test {
   public:
     void SetUp() override {
@@ -103,3 +138,29 @@ TEST_F(MemoryAllocatorTests, HieraticalAllocatorNodes) {
     parent.reset();
     EXPECT_EQ(DestructCount, 3u);
 }
+
+// Verify cancelling an asynchronous allocation does not block and returns its memory.
+TEST_F(MemoryAllocatorTests, CancelAllocateMemoryAsync) {
+    BlockingMemoryAllocator allocator;
+
+    MEMORY_ALLOCATION_REQUEST request = {};
+    request.Size = 64;
+    request.Alignment = 1;
+
+    // Cancelled while in-flight.
+    std::shared_ptr<MemoryAllocationEvent> event = allocator.TryAllocateMemoryAsync(request);
+    allocator.WaitUntilAllocating();
+    event->Cancel();
+
+    allocator.Release();
+    allocator.WaitForPendingAllocations();
+    EXPECT_EQ(event->AcquireAllocation(), nullptr);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+
+    // Cancelled once complete.
+    event = allocator.TryAllocateMemoryAsync(request);
+    event->Wait();
+    event->Cancel();
+    EXPECT_EQ(event->AcquireAllocation(), nullptr);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+}
@@ -16,6 +16,9 @@
 
 #include "gpgmm/MemoryCache.h"
 
+#include <thread>
+#include <vector>
+
 using namespace gpgmm;
 
 struct FakeObject {
@@ -88,3 +91,115 @@ TEST(MemoryCacheTests, ShrinkCache) {
     auto entryTwo = cache.GetOrCreate(FakeObject{1}, false);
     EXPECT_EQ(entryOne.Get()->GetRefCount(), 2);
 }
+
+// Verify kept alive entries remain after being released, until removed.
+TEST(MemoryCacheTests, KeepAlive) {
+    MemoryCache<FakeObject> cache;
+    {
+        auto entry = cache.GetOrCreate(FakeObject{1}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 2);
+    }
+    EXPECT_EQ(cache.GetSize(), 1u);
+    EXPECT_EQ(cache.GetKeepAliveCount(), 1u);
+
+    // Looking up an existing entry to keep alive does not add another ref.
+    {
+        auto entry = cache.GetOrCreate(FakeObject{1}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 2);
+    }
+
+    // Unless the entry was not kept alive before.
+    {
+        auto entry = cache.GetOrCreate(FakeObject{2}, false);
+        auto sameEntry = cache.GetOrCreate(FakeObject{2}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 3);
+    }
+    EXPECT_EQ(cache.GetSize(), 2u);
+    EXPECT_EQ(cache.GetKeepAliveCount(), 2u);
+
+    cache.RemoveAndDeleteAll();
+    EXPECT_EQ(cache.GetSize(), 0u);
+    EXPECT_EQ(cache.GetKeepAliveCount(), 0u);
+}
+
+// Verify the least recently used entry is evicted once too many are kept alive.
+TEST(MemoryCacheTests, EvictLeastRecentlyUsed) {
+    MemoryCache<FakeObject> cache(/*maxKeepAliveCount*/ 2);
+    cache.GetOrCreate(FakeObject{1}, true);
+    cache.GetOrCreate(FakeObject{2}, true);
+    EXPECT_EQ(cache.GetSize(), 2u);
+
+    // Using the first entry makes the second the least recently used.
+    cache.GetOrCreate(FakeObject{1}, false);
+    cache.GetOrCreate(FakeObject{3}, true);
+    EXPECT_EQ(cache.GetSize(), 2u);
+    EXPECT_EQ(cache.GetKeepAliveCount(), 2u);
+
+    // The second entry was deleted while the first was kept.
+    {
+        auto entry = cache.GetOrCreate(FakeObject{2}, false);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 1);
+
+        auto firstEntry = cache.GetOrCreate(FakeObject{1}, false);
+        EXPECT_EQ(firstEntry.Get()->GetRefCount(), 2);
+    }
+    EXPECT_EQ(cache.GetSize(), 2u);
+}
+
+// Verify evicted entries still referenced are only deleted once released.
+TEST(MemoryCacheTests, EvictReferenced) {
+    MemoryCache<FakeObject> cache(/*maxKeepAliveCount*/ 1);
+    {
+        auto entry = cache.GetOrCreate(FakeObject{1}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 2);
+
+        cache.GetOrCreate(FakeObject{2}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 1);
+        EXPECT_EQ(cache.GetSize(), 2u);
+        EXPECT_EQ(cache.GetKeepAliveCount(), 1u);
+    }
+    EXPECT_EQ(cache.GetSize(), 1u);
+}
+
+// Verify entries are only kept alive while there is room, even when created.
+TEST(MemoryCacheTests, EvictNone) {
+    MemoryCache<FakeObject> cache(/*maxKeepAliveCount*/ 0);
+    {
+        auto entry = cache.GetOrCreate(FakeObject{1}, true);
+        EXPECT_EQ(entry.Get()->GetRefCount(), 1);
+    }
+    EXPECT_EQ(cache.GetSize(), 0u);
+}
+
+// Verify the same object maps to the same entry across threads.
+TEST(MemoryCacheTests, ShardedEntries) {
+    constexpr static size_t kThreadCount = 4;
+    constexpr static size_t kObjectCount = 256;
+
+    ShardedMemoryCache<FakeObject> cache;
+
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t t = 0; t < kThreadCount; t++) {
+        threads[t] = std::thread([&]() {
+            for (size_t i = 0; i < kObjectCount; i++) {
+                cache.GetOrCreate(FakeObject{i}, true, [](CacheEntry<FakeObject>* entry) {
+                    EXPECT_EQ(entry->GetRefCount(), 2);
+                });
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(cache.GetSize(), kObjectCount);
+
+    size_t keySum = 0;
+    cache.ForEach(
+        [&](const CacheEntry<FakeObject>* entry) { keySum += entry->GetValue().GetKey(); });
+    EXPECT_EQ(keySum, kObjectCount * (kObjectCount - 1) / 2);
+
+    cache.RemoveAndDeleteAll();
+    EXPECT_EQ(cache.GetSize(), 0u);
+}
@@ -0,0 +1,84 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/ObjectPool.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+struct PooledObject {
+    PooledObject(uint64_t value, int* destroyCount) : Value(value), pDestroyCount(destroyCount) {
+    }
+    ~PooledObject() {
+        (*pDestroyCount)++;
+    }
+    uint64_t Value = 0;
+    int* pDestroyCount = nullptr;
+};
+
+TEST(ObjectPoolTests, AcquireRelease) {
+    ObjectPool<PooledObject> pool(/*objectsPerChunk*/ 4);
+    EXPECT_EQ(pool.GetCapacityForTesting(), 0u);
+
+    int destroyCount = 0;
+    PooledObject* object = pool.Acquire(42u, &destroyCount);
+    ASSERT_NE(object, nullptr);
+    EXPECT_EQ(object->Value, 42u);
+    EXPECT_EQ(pool.GetCapacityForTesting(), 4u);
+
+    pool.Release(object);
+    EXPECT_EQ(destroyCount, 1);
+
+    // The most recently released object should be re-used.
+    PooledObject* reusedObject = pool.Acquire(7u, &destroyCount);
+    EXPECT_EQ(reusedObject, object);
+    EXPECT_EQ(reusedObject->Value, 7u);
+
+    pool.Release(reusedObject);
+    EXPECT_EQ(destroyCount, 2);
+}
+
+// Verify the pool grows by chunk and re-uses all released objects before growing again.
+TEST(ObjectPoolTests, Grow) {
+    constexpr size_t kObjectsPerChunk = 4;
+    ObjectPool<PooledObject> pool(kObjectsPerChunk);
+
+    int destroyCount = 0;
+    std::vector<PooledObject*> objects = {};
+    for (size_t i = 0; i < kObjectsPerChunk * 2 + 1; i++) {
+        objects.push_back(pool.Acquire(i, &destroyCount));
+    }
+
+    EXPECT_EQ(pool.GetCapacityForTesting(), kObjectsPerChunk * 3);
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        EXPECT_EQ(objects[i]->Value, i);
+        pool.Release(objects[i]);
+    }
+
+    EXPECT_EQ(destroyCount, static_cast<int>(objects.size()));
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        objects[i] = pool.Acquire(i, &destroyCount);
+    }
+
+    EXPECT_EQ(pool.GetCapacityForTesting(), kObjectsPerChunk * 3);
+
+    for (PooledObject* object : objects) {
+        pool.Release(object);
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/PlatformTime.h"
+
+#include <limits>
+
+using namespace gpgmm;
+
+class DummyPlatformTime final : public PlatformTime {
+  public:
+    explicit DummyPlatformTime(uint64_t ticksPerSecond) : mTicksPerSecond(ticksPerSecond) {
+    }
+
+    double GetAbsoluteTime() override {
+        return 0;
+    }
+
+    uint64_t GetTicks() override {
+        return 0;
+    }
+
+    uint64_t GetTicksPerSecond() const override {
+        return mTicksPerSecond;
+    }
+
+    void StartElapsedTime() override {
+    }
+
+    double EndElapsedTime() override {
+        return 0;
+    }
+
+  private:
+    const uint64_t mTicksPerSecond;
+};
+
+TEST(PlatformTimeTests, TicksToNanoseconds) {
+    // 10MHz, the usual performance counter frequency.
+    DummyPlatformTime counter(10000000);
+    EXPECT_EQ(counter.TicksToNanoseconds(0), 0u);
+    EXPECT_EQ(counter.TicksToNanoseconds(1), 100u);
+    EXPECT_EQ(counter.TicksToNanoseconds(10000000), 1000000000u);
+
+    // 3GHz, a typical cycle counter frequency, truncates partial nanoseconds.
+    DummyPlatformTime cycleCounter(3000000000);
+    EXPECT_EQ(cycleCounter.TicksToNanoseconds(2), 0u);
+    EXPECT_EQ(cycleCounter.TicksToNanoseconds(3), 1u);
+    EXPECT_EQ(cycleCounter.TicksToNanoseconds(3000000000 * 60), 60000000000u);
+}
+
+// Verify large tick counts are converted without overflowing.
+TEST(PlatformTimeTests, TicksToNanosecondsLarge) {
+    DummyPlatformTime cycleCounter(3000000000);
+
+    // A year of cycles.
+    const uint64_t ticksPerYear = 3000000000ull * 60 * 60 * 24 * 365;
+    EXPECT_EQ(cycleCounter.TicksToNanoseconds(ticksPerYear),
+              1000000000ull * 60 * 60 * 24 * 365);
+
+    // Exactly a third of the ticks, as if multiplied before dividing with infinite precision.
+    const uint64_t maxTicks = std::numeric_limits<uint64_t>::max();
+    EXPECT_EQ(cycleCounter.TicksToNanoseconds(maxTicks), 6148914691236517205u);
+}
@@ -0,0 +1,58 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/RateLimiter.h"
+
+using namespace gpgmm;
+
+static constexpr uint64_t kPeriod = 1000;
+static constexpr uint32_t kMaxCountPerPeriod = 3;
+
+// Verify acquires over the limit are rejected until the next period.
+TEST(RateLimiterTests, TryAcquire) {
+    RateLimiter limiter;
+    uint32_t suppressedCount = 0;
+
+    const uint64_t start = 5000;
+    for (uint32_t i = 0; i < kMaxCountPerPeriod; i++) {
+        EXPECT_TRUE(limiter.TryAcquire(start + i, kPeriod, kMaxCountPerPeriod, &suppressedCount));
+        EXPECT_EQ(suppressedCount, 0u);
+    }
+
+    EXPECT_FALSE(limiter.TryAcquire(start + 10, kPeriod, kMaxCountPerPeriod, &suppressedCount));
+    EXPECT_FALSE(limiter.TryAcquire(start + kPeriod - 1, kPeriod, kMaxCountPerPeriod,
+                                    &suppressedCount));
+
+    // The first acquire of the next period reports those rejected.
+    EXPECT_TRUE(limiter.TryAcquire(start + kPeriod, kPeriod, kMaxCountPerPeriod,
+                                   &suppressedCount));
+    EXPECT_EQ(suppressedCount, 2u);
+
+    EXPECT_TRUE(limiter.TryAcquire(start + kPeriod + 1, kPeriod, kMaxCountPerPeriod,
+                                   &suppressedCount));
+    EXPECT_EQ(suppressedCount, 0u);
+}
+
+// Verify a period without any rejected acquires reports none.
+TEST(RateLimiterTests, NoneSuppressed) {
+    RateLimiter limiter;
+    uint32_t suppressedCount = 0;
+
+    EXPECT_TRUE(limiter.TryAcquire(5000, kPeriod, kMaxCountPerPeriod, &suppressedCount));
+    EXPECT_TRUE(limiter.TryAcquire(5000 + kPeriod, kPeriod, kMaxCountPerPeriod,
+                                   &suppressedCount));
+    EXPECT_EQ(suppressedCount, 0u);
+}
@@ -92,3 +92,18 @@ TEST(RefCountTests, ScopedRefMove) {
     EXPECT_EQ(secondRef->GetRefCount(), 2);
     EXPECT_EQ(secondRef.Get(), obj);
 }
+
+TEST(RefCountTests, NonAtomicIncrementDecrement) {
+    NonAtomicRefCounted refcount(2);
+    EXPECT_FALSE(refcount.Unref());
+    EXPECT_EQ(refcount.GetRefCount(), 1);
+
+    EXPECT_TRUE(refcount.HasOneRef());
+
+    refcount.Ref();
+    EXPECT_EQ(refcount.GetRefCount(), 2);
+
+    EXPECT_FALSE(refcount.Unref());
+    EXPECT_TRUE(refcount.Unref());
+    EXPECT_EQ(refcount.GetRefCount(), 0);
+}
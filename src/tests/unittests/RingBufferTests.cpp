@@ -0,0 +1,97 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/common/RingBuffer.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+TEST(RingBufferTests, Capacity) {
+    EXPECT_EQ(SPSCRingBuffer<int>(1).GetCapacity(), 1u);
+    EXPECT_EQ(SPSCRingBuffer<int>(4).GetCapacity(), 4u);
+    EXPECT_EQ(SPSCRingBuffer<int>(5).GetCapacity(), 8u);
+}
+
+// Verify items are popped in the order they were pushed, and pushes fail once full.
+TEST(RingBufferTests, PushPop) {
+    SPSCRingBuffer<int> buffer(4);
+    std::vector<int> items;
+    EXPECT_EQ(buffer.PopAll(&items), 0u);
+
+    EXPECT_TRUE(buffer.TryEmplace(1));
+    EXPECT_TRUE(buffer.TryEmplace(2));
+    EXPECT_TRUE(buffer.TryEmplace(3));
+    EXPECT_TRUE(buffer.TryEmplace(4));
+    EXPECT_FALSE(buffer.TryEmplace(5));
+
+    EXPECT_EQ(buffer.PopAll(&items), 4u);
+    EXPECT_EQ(items, (std::vector<int>{1, 2, 3, 4}));
+
+    // Popping frees every slot, even once the indices wrap around.
+    items.clear();
+    EXPECT_TRUE(buffer.TryEmplace(5));
+    EXPECT_TRUE(buffer.TryEmplace(6));
+    EXPECT_EQ(buffer.PopAll(&items), 2u);
+    EXPECT_EQ(items, (std::vector<int>{5, 6}));
+}
+
+// Verify items left in the buffer are destroyed with it.
+TEST(RingBufferTests, DestroyItems) {
+    std::shared_ptr<int> item = std::make_shared<int>(0);
+    {
+        SPSCRingBuffer<std::shared_ptr<int>> buffer(4);
+        EXPECT_TRUE(buffer.TryEmplace(item));
+        EXPECT_TRUE(buffer.TryEmplace(item));
+        EXPECT_EQ(item.use_count(), 3);
+
+        std::vector<std::shared_ptr<int>> items;
+        EXPECT_EQ(buffer.PopAll(&items), 2u);
+        EXPECT_EQ(item.use_count(), 3);
+
+        EXPECT_TRUE(buffer.TryEmplace(item));
+        EXPECT_EQ(item.use_count(), 4);
+    }
+    EXPECT_EQ(item.use_count(), 1);
+}
+
+// Verify every item pushed by one thread is popped, in order, by another.
+TEST(RingBufferTests, ProducerConsumer) {
+    constexpr static uint64_t kItemCount = 10000;
+    SPSCRingBuffer<uint64_t> buffer(64);
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < kItemCount; i++) {
+            while (!buffer.TryEmplace(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<uint64_t> items;
+    while (items.size() < kItemCount) {
+        if (buffer.PopAll(&items) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    for (uint64_t i = 0; i < kItemCount; i++) {
+        ASSERT_EQ(items[i], i);
+    }
+}
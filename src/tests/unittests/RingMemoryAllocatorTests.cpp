@@ -0,0 +1,154 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/RingMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultRingSize = 128u;
+static constexpr uint64_t kDefaultRingAlignment = 1u;
+
+TEST(RingMemoryAllocatorTests, SingleRing) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    RingMemoryAllocator allocator(std::move(dummyMemoryAllocator), kDefaultRingSize,
+                                  kDefaultRingAlignment);
+
+    // Allocation cannot be greater then the ring size.
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kDefaultRingSize * 2, 1)), nullptr);
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(0, 1)), nullptr);
+
+    // Allocations are made one after another from the same memory.
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 1));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetOffset(), 0u);
+    EXPECT_EQ(firstAllocation->GetSize(), 32u);
+    EXPECT_EQ(firstAllocation->GetMethod(), AllocationMethod::kSubAllocated);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(32, 64));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetOffset(), 64u);
+    EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 96u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    // Ring is full.
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(64, 1)), nullptr);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+
+    // Space is not re-used until retired.
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 96u);
+
+    allocator.RetireMemory(0);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 0u);
+
+    // Nothing is released unless asked for.
+    EXPECT_EQ(allocator.ReleaseMemory(0), 0u);
+
+    EXPECT_EQ(allocator.ReleaseMemory(), kDefaultRingSize);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify allocations retire by serial and the ring wraps around once the end is reached.
+TEST(RingMemoryAllocatorTests, RetireBySerial) {
+    RingMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(), kDefaultRingSize,
+                                  kDefaultRingAlignment);
+
+    constexpr uint64_t kAllocationSize = 32u;
+    constexpr uint64_t kNumOfFrames = 16u;
+
+    // Each frame uses half the ring and retires once the next frame is done.
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (uint64_t frame = 1; frame <= kNumOfFrames; frame++) {
+        allocator.SetPendingSerial(frame);
+        for (uint32_t i = 0; i < 2; i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kAllocationSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetOffset(),
+                      ((frame - 1) * 2 + i) * kAllocationSize % kDefaultRingSize);
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.GetUsedSizeForTesting(), (frame == 1) ? 64u : kDefaultRingSize);
+
+        allocator.RetireMemory(frame - 1);
+        EXPECT_EQ(allocator.GetUsedSizeForTesting(), 64u);
+    }
+
+    // Serials can only increase.
+    allocator.SetPendingSerial(1);
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kAllocationSize, 1));
+    ASSERT_NE(allocation, nullptr);
+    allocator.DeallocateMemory(std::move(allocation));
+
+    allocator.RetireMemory(kNumOfFrames - 1);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 96u);
+
+    allocator.RetireMemory(kNumOfFrames);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 0u);
+}
+
+// Verify padding skipped at the end of the ring is used until it retires.
+TEST(RingMemoryAllocatorTests, WrapAround) {
+    RingMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(), kDefaultRingSize,
+                                  kDefaultRingAlignment);
+
+    allocator.SetPendingSerial(1);
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(96, 1));
+    ASSERT_NE(firstAllocation, nullptr);
+
+    allocator.SetPendingSerial(2);
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(16, 1));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetOffset(), 96u);
+
+    allocator.RetireMemory(1);
+
+    // Does not fit in the remaining 16 bytes at the back, so wrap to the front.
+    allocator.SetPendingSerial(3);
+    std::unique_ptr<MemoryAllocation> thirdAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(64, 1));
+    ASSERT_NE(thirdAllocation, nullptr);
+    EXPECT_EQ(thirdAllocation->GetOffset(), 0u);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 16u + 16u + 64u);
+
+    // Only the middle of the ring is free now.
+    EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(64, 1)), nullptr);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+
+    allocator.RetireMemory(2);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 16u + 64u);
+
+    allocator.RetireMemory(3);
+    EXPECT_EQ(allocator.GetUsedSizeForTesting(), 0u);
+}
@@ -27,11 +27,11 @@ TEST(SegmentedMemoryAllocatorTests, SingleHeap) {
                                        kDefaultMemoryAlignment);
 
     std::unique_ptr<MemoryAllocation> invalidAllocation =
-        allocator.TryAllocateMemory(0, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(0, kDefaultMemoryAlignment));
     ASSERT_EQ(invalidAllocation, nullptr);
 
     std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(allocation, nullptr);
     EXPECT_EQ(allocation->GetSize(), kDefaultMemorySize);
     EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kStandalone);
@@ -49,12 +49,12 @@ TEST(SegmentedMemoryAllocatorTests, MultipleHeaps) {
                                        kDefaultMemoryAlignment);
 
     std::unique_ptr<MemoryAllocation> firstAllocation = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(firstAllocation, nullptr);
     EXPECT_EQ(firstAllocation->GetSize(), kDefaultMemorySize);
 
     std::unique_ptr<MemoryAllocation> secondAllocation = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(secondAllocation, nullptr);
     EXPECT_EQ(secondAllocation->GetSize(), kDefaultMemorySize);
 
@@ -76,14 +76,14 @@ TEST(SegmentedMemoryAllocatorTests, MultipleHeapsVariousSizes) {
     // Append the 1st and 3rd segment, in sequence.
     uint64_t firstMemorySize = kDefaultMemorySize / 2;
     std::unique_ptr<MemoryAllocation> firstAllocation =
-        allocator.TryAllocateMemory(firstMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(firstMemorySize, kDefaultMemoryAlignment));
     EXPECT_EQ(firstAllocation->GetMethod(), AllocationMethod::kStandalone);
     ASSERT_NE(firstAllocation, nullptr);
     EXPECT_EQ(firstAllocation->GetSize(), firstMemorySize);
 
     uint64_t secondMemorySize = kDefaultMemorySize / 8;
     std::unique_ptr<MemoryAllocation> secondAllocation =
-        allocator.TryAllocateMemory(secondMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(secondMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(secondAllocation, nullptr);
     EXPECT_EQ(secondAllocation->GetMethod(), AllocationMethod::kStandalone);
     EXPECT_EQ(secondAllocation->GetSize(), secondMemorySize);
@@ -91,7 +91,7 @@ TEST(SegmentedMemoryAllocatorTests, MultipleHeapsVariousSizes) {
     // Insert a 3rd segment in the middle or between the 1st and 2nd segment.
     uint64_t thirdMemorySize = kDefaultMemorySize / 4;
     std::unique_ptr<MemoryAllocation> thirdAllocation =
-        allocator.TryAllocateMemory(thirdMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(thirdMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(thirdAllocation, nullptr);
     EXPECT_EQ(thirdAllocation->GetMethod(), AllocationMethod::kStandalone);
     EXPECT_EQ(thirdAllocation->GetSize(), thirdMemorySize);
@@ -99,28 +99,28 @@ TEST(SegmentedMemoryAllocatorTests, MultipleHeapsVariousSizes) {
     // Insert a 4th segment at the end.
     uint64_t fourthMemorySize = kDefaultMemorySize;
     std::unique_ptr<MemoryAllocation> fourthAllocation =
-        allocator.TryAllocateMemory(fourthMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(fourthMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(fourthAllocation, nullptr);
     EXPECT_EQ(fourthAllocation->GetSize(), fourthMemorySize);
 
     // Insert a 5th segment at the start.
     uint64_t fifthMemorySize = kDefaultMemorySize / 16;
     std::unique_ptr<MemoryAllocation> fifthAllocation =
-        allocator.TryAllocateMemory(fifthMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(fifthMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(fifthAllocation, nullptr);
     EXPECT_EQ(fifthAllocation->GetMethod(), AllocationMethod::kStandalone);
     EXPECT_EQ(fifthAllocation->GetSize(), fifthMemorySize);
 
     // Reuse the 3rd segment.
     std::unique_ptr<MemoryAllocation> sixthAllocation =
-        allocator.TryAllocateMemory(thirdMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(thirdMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(sixthAllocation, nullptr);
     EXPECT_EQ(sixthAllocation->GetMethod(), AllocationMethod::kStandalone);
     EXPECT_EQ(sixthAllocation->GetSize(), thirdMemorySize);
 
     // Reuse the 1st segment.
     std::unique_ptr<MemoryAllocation> seventhAllocation =
-        allocator.TryAllocateMemory(firstMemorySize, kDefaultMemoryAlignment, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(firstMemorySize, kDefaultMemoryAlignment));
     ASSERT_NE(seventhAllocation, nullptr);
     EXPECT_EQ(seventhAllocation->GetMethod(), AllocationMethod::kStandalone);
     EXPECT_EQ(seventhAllocation->GetSize(), firstMemorySize);
@@ -147,7 +147,7 @@ TEST(SegmentedMemoryAllocatorTests, ReuseFreedHeaps) {
                                        kDefaultMemoryAlignment);
     {
         std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
-            kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+            CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetSize(), kDefaultMemorySize);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kStandalone);
@@ -158,7 +158,7 @@ TEST(SegmentedMemoryAllocatorTests, ReuseFreedHeaps) {
 
     {
         std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
-            kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+            CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetSize(), kDefaultMemorySize);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kStandalone);
@@ -173,7 +173,7 @@ TEST(SegmentedMemoryAllocatorTests, QueryInfo) {
                                        kDefaultMemoryAlignment);
 
     std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
-        kDefaultMemorySize, kDefaultMemoryAlignment, false, false, false);
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
     EXPECT_NE(allocation, nullptr);
 
     // Single memory block should be allocated.
@@ -192,3 +192,348 @@ TEST(SegmentedMemoryAllocatorTests, QueryInfo) {
     EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
     EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize);
 }
+
+TEST(SegmentedMemoryAllocatorTests, ReleaseMemoryLeastRecentlyUsedFirst) {
+    SegmentedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                       kDefaultMemoryAlignment);
+
+    std::unique_ptr<MemoryAllocation> firstAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(firstAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize / 2, kDefaultMemoryAlignment));
+    ASSERT_NE(secondAllocation, nullptr);
+
+    // Free the larger segment first so it becomes the least recently used.
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize + kDefaultMemorySize / 2);
+
+    // Releasing a single byte must only release the least recently used memory.
+    EXPECT_EQ(allocator.ReleaseMemory(1), kDefaultMemorySize);
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize / 2);
+
+    EXPECT_EQ(allocator.ReleaseMemory(), kDefaultMemorySize / 2);
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
+
+    EXPECT_EQ(allocator.ReleaseMemory(), 0u);
+}
+
+TEST(SegmentedMemoryAllocatorTests, ReuseSegmentsOfManySizes) {
+    SegmentedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                       kDefaultMemoryAlignment);
+
+    // Sizes are a mix of power-of-two and non-power-of-two sizes.
+    constexpr uint64_t kNumOfSizes = 32;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        for (uint64_t i = 1; i <= kNumOfSizes; i++) {
+            std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+                CreateBasicRequest(i * kDefaultMemoryAlignment, kDefaultMemoryAlignment));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetSize(), i * kDefaultMemoryAlignment);
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+        EXPECT_EQ(allocator.GetSegmentSizeForTesting(), kNumOfSizes);
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage,
+              kDefaultMemoryAlignment * kNumOfSizes * (kNumOfSizes + 1) / 2);
+}
+
+// Verify resident memory is re-used before evicted memory.
+TEST(SegmentedMemoryAllocatorTests, ReuseResidentHeapsFirst) {
+    SegmentedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                       kDefaultMemoryAlignment);
+
+    std::unique_ptr<MemoryAllocation> evictedAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(evictedAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> residentAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(residentAllocation, nullptr);
+
+    MemoryBase* evictedMemory = evictedAllocation->GetMemory();
+    MemoryBase* residentMemory = residentAllocation->GetMemory();
+    static_cast<DummyMemory*>(evictedMemory)->SetEvicted(true);
+
+    // Evicted memory is returned last so it would be re-used first.
+    allocator.DeallocateMemory(std::move(residentAllocation));
+    allocator.DeallocateMemory(std::move(evictedAllocation));
+
+    std::unique_ptr<MemoryAllocation> firstAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_EQ(firstAllocation->GetMemory(), residentMemory);
+    EXPECT_EQ(allocator.QueryInfo().EvictedMemoryReuseCount, 0u);
+
+    // Only evicted memory remains, so it gets re-used.
+    std::unique_ptr<MemoryAllocation> secondAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetMemory(), evictedMemory);
+    EXPECT_EQ(allocator.QueryInfo().EvictedMemoryReuseCount, 1u);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+}
+
+// Verify reserved memory is allocated ahead of demand and refilled once used.
+TEST(SegmentedMemoryAllocatorTests, ReservedMemory) {
+    constexpr uint64_t kReservedMemoryCount = 2u;
+    SegmentedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                       kDefaultMemoryAlignment, kDefaultMemorySize,
+                                       kReservedMemoryCount);
+
+    allocator.WaitForReservedMemoryForTesting();
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * kReservedMemoryCount);
+
+    // Reserved memory gets used then refilled.
+    std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, kDefaultMemorySize);
+
+    allocator.WaitForReservedMemoryForTesting();
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * kReservedMemoryCount);
+
+    // Memory of other sizes is not reserved.
+    std::unique_ptr<MemoryAllocation> otherAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(otherAllocation, nullptr);
+
+    allocator.WaitForReservedMemoryForTesting();
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * kReservedMemoryCount);
+
+    allocator.DeallocateMemory(std::move(allocation));
+    allocator.DeallocateMemory(std::move(otherAllocation));
+
+    // Reserved memory is released like any other free memory.
+    allocator.ReleaseMemory();
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
+}
+
+// Verify memory allocated outside of the allocator is re-used once imported.
+TEST(SegmentedMemoryAllocatorTests, ImportMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* childAllocator = dummyAllocator.get();
+
+    SegmentedMemoryAllocator allocator(std::move(dummyAllocator), kDefaultMemoryAlignment);
+
+    std::unique_ptr<MemoryAllocation> importedAllocation = childAllocator->TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(importedAllocation, nullptr);
+
+    MemoryBase* importedMemory = importedAllocation->GetMemory();
+    allocator.ImportMemory(std::move(importedAllocation));
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize);
+    EXPECT_EQ(allocator.GetSegmentSizeForTesting(), 1u);
+
+    std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory(), importedMemory);
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 1u);
+
+    allocator.DeallocateMemory(std::move(allocation));
+
+    // Imported memory is deallocated by the child allocator like any other free memory.
+    allocator.ReleaseMemory();
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify free memory of a larger segment is only re-used within the best-fit waste limit.
+TEST(SegmentedMemoryAllocatorTests, BestFitReuseLargerMemory) {
+    std::unique_ptr<DummyMemoryAllocator> dummyAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* childAllocator = dummyAllocator.get();
+
+    SegmentedMemoryAllocator allocator(std::move(dummyAllocator), kDefaultMemoryAlignment,
+                                       /*reservedMemorySize*/ 0, /*reservedMemoryCount*/ 0,
+                                       /*bestFitWasteLimit*/ 0.5);
+
+    std::unique_ptr<MemoryAllocation> largeAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(largeAllocation, nullptr);
+    MemoryBase* largeMemory = largeAllocation->GetMemory();
+    allocator.DeallocateMemory(std::move(largeAllocation));
+
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryMissCount, 1u);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryHitCount, 0u);
+
+    // Exceeds the waste limit: a new memory is allocated.
+    std::unique_ptr<MemoryAllocation> smallAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize / 2, kDefaultMemoryAlignment));
+    ASSERT_NE(smallAllocation, nullptr);
+    EXPECT_NE(smallAllocation->GetMemory(), largeMemory);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryMissCount, 2u);
+    EXPECT_EQ(allocator.QueryInfo().BestFitWastedUsage, 0u);
+
+    // Within the waste limit: the pooled memory is re-used.
+    std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory(), largeMemory);
+    EXPECT_EQ(allocation->GetSize(), kDefaultMemorySize * 2);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryHitCount, 1u);
+    EXPECT_EQ(allocator.QueryInfo().BestFitWastedUsage, kDefaultMemorySize);
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 2u);
+
+    // Re-used memory returns to the segment it was allocated for.
+    allocator.DeallocateMemory(std::move(allocation));
+    EXPECT_EQ(allocator.QueryInfo().BestFitWastedUsage, 0u);
+
+    allocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory(), largeMemory);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryHitCount, 2u);
+    EXPECT_EQ(allocator.QueryInfo().BestFitWastedUsage, 0u);
+
+    allocator.DeallocateMemory(std::move(allocation));
+    allocator.DeallocateMemory(std::move(smallAllocation));
+    allocator.ReleaseMemory();
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify free memory of a larger segment is never re-used by default.
+TEST(SegmentedMemoryAllocatorTests, BestFitDisabled) {
+    SegmentedMemoryAllocator allocator(std::make_unique<DummyMemoryAllocator>(),
+                                       kDefaultMemoryAlignment);
+
+    std::unique_ptr<MemoryAllocation> largeAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(largeAllocation, nullptr);
+    MemoryBase* largeMemory = largeAllocation->GetMemory();
+    allocator.DeallocateMemory(std::move(largeAllocation));
+
+    std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_NE(allocation->GetMemory(), largeMemory);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryHitCount, 0u);
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryMissCount, 2u);
+
+    allocator.DeallocateMemory(std::move(allocation));
+    allocator.ReleaseMemory();
+}
+
+// Verify memory deallocated once its segment pool is full is deallocated instead.
+TEST(SegmentedMemoryAllocatorTests, MaxSegmentPoolSize) {
+    std::unique_ptr<DummyMemoryAllocator> dummyAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* childAllocator = dummyAllocator.get();
+
+    SegmentedMemoryAllocator allocator(
+        std::move(dummyAllocator), kDefaultMemoryAlignment, /*reservedMemorySize*/ 0,
+        /*reservedMemoryCount*/ 0, /*bestFitWasteLimit*/ 0,
+        /*maxSegmentPoolSize*/ kDefaultMemorySize * 2);
+
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations;
+    for (uint32_t i = 0; i < 4; i++) {
+        allocations.push_back(allocator.TryAllocateMemory(
+            CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment)));
+        ASSERT_NE(allocations.back(), nullptr);
+    }
+
+    // Other segments have pools of their own.
+    std::unique_ptr<MemoryAllocation> otherAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(otherAllocation, nullptr);
+
+    for (std::unique_ptr<MemoryAllocation>& allocation : allocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+    allocator.DeallocateMemory(std::move(otherAllocation));
+
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 4);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 3u);
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify memory deallocated once the pools are full, in total, is deallocated instead.
+TEST(SegmentedMemoryAllocatorTests, MaxPoolSize) {
+    std::unique_ptr<DummyMemoryAllocator> dummyAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* childAllocator = dummyAllocator.get();
+
+    SegmentedMemoryAllocator allocator(std::move(dummyAllocator), kDefaultMemoryAlignment,
+                                       /*reservedMemorySize*/ 0, /*reservedMemoryCount*/ 0,
+                                       /*bestFitWasteLimit*/ 0, /*maxSegmentPoolSize*/ kInvalidSize,
+                                       /*maxPoolSize*/ kDefaultMemorySize * 3);
+
+    std::unique_ptr<MemoryAllocation> firstAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(firstAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> secondAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize * 2, kDefaultMemoryAlignment));
+    ASSERT_NE(secondAllocation, nullptr);
+
+    std::unique_ptr<MemoryAllocation> thirdAllocation = allocator.TryAllocateMemory(
+        CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment));
+    ASSERT_NE(thirdAllocation, nullptr);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 2);
+
+    allocator.DeallocateMemory(std::move(secondAllocation));
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 2);
+
+    allocator.DeallocateMemory(std::move(thirdAllocation));
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 3);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 2u);
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify the pool shrinks back to the peak used memory once a spike has passed.
+TEST(SegmentedMemoryAllocatorTests, PeakUsageWindow) {
+    std::unique_ptr<DummyMemoryAllocator> dummyAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* childAllocator = dummyAllocator.get();
+
+    constexpr uint64_t kPeakUsageWindow = 16;
+    SegmentedMemoryAllocator allocator(std::move(dummyAllocator), kDefaultMemoryAlignment,
+                                       /*reservedMemorySize*/ 0, /*reservedMemoryCount*/ 0,
+                                       /*bestFitWasteLimit*/ 0, /*maxSegmentPoolSize*/ kInvalidSize,
+                                       /*maxPoolSize*/ kInvalidSize, kPeakUsageWindow);
+
+    auto allocateAndDeallocate = [&](uint32_t count) {
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations;
+        for (uint32_t i = 0; i < count; i++) {
+            allocations.push_back(allocator.TryAllocateMemory(
+                CreateBasicRequest(kDefaultMemorySize, kDefaultMemoryAlignment)));
+            ASSERT_NE(allocations.back(), nullptr);
+        }
+        for (std::unique_ptr<MemoryAllocation>& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+    };
+
+    // The spike is entirely pooled, since it could be needed again.
+    allocateAndDeallocate(8);
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 8);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 8u);
+
+    // Steady demand never needs more than two memory, so the rest is released.
+    for (uint32_t i = 0; i < kPeakUsageWindow; i++) {
+        allocateAndDeallocate(2);
+    }
+    EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize * 2);
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 2u);
+
+    // Pooled memory still satisfies the steady demand.
+    EXPECT_EQ(allocator.QueryInfo().PooledMemoryMissCount, 8u);
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(childAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
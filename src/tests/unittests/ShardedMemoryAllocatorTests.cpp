@@ -0,0 +1,122 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/BuddyMemoryAllocator.h"
+#include "gpgmm/SegmentedMemoryAllocator.h"
+#include "gpgmm/ShardedMemoryAllocator.h"
+#include "gpgmm/SharedMemoryAllocator.h"
+#include "tests/DummyMemoryAllocator.h"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+static constexpr uint64_t kDefaultMemorySize = 128u;
+static constexpr uint64_t kDefaultMemoryAlignment = 1u;
+static constexpr size_t kShardCount = 4;
+
+// Creates shards which sub-allocate memory from the same |memoryAllocator|.
+static std::vector<std::unique_ptr<MemoryAllocator>> CreateBuddyShards(
+    MemoryAllocator* memoryAllocator) {
+    std::vector<std::unique_ptr<MemoryAllocator>> shards;
+    for (size_t i = 0; i < kShardCount; i++) {
+        shards.push_back(std::make_unique<BuddyMemoryAllocator>(
+            kDefaultMemorySize, kDefaultMemorySize, kDefaultMemoryAlignment,
+            std::make_unique<SharedMemoryAllocator>(memoryAllocator)));
+    }
+    return shards;
+}
+
+TEST(ShardedMemoryAllocatorTests, SameThreadSameShard) {
+    DummyMemoryAllocator memoryAllocator;
+    ShardedMemoryAllocator allocator(CreateBuddyShards(&memoryAllocator));
+
+    std::unique_ptr<MemoryAllocation> firstAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
+    ASSERT_NE(firstAllocation, nullptr);
+    EXPECT_TRUE(allocator.IsShard(firstAllocation->GetAllocator()));
+
+    std::unique_ptr<MemoryAllocation> secondAllocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
+    ASSERT_NE(secondAllocation, nullptr);
+    EXPECT_EQ(secondAllocation->GetAllocator(), firstAllocation->GetAllocator());
+
+    // Both blocks are sub-allocated from the same memory.
+    EXPECT_EQ(secondAllocation->GetMemory(), firstAllocation->GetMemory());
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 2u);
+
+    allocator.DeallocateMemory(std::move(firstAllocation));
+    allocator.DeallocateMemory(std::move(secondAllocation));
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(memoryAllocator.QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify threads are spread over every shard and blocks can be de-allocated by any thread.
+TEST(ShardedMemoryAllocatorTests, MultipleThreads) {
+    DummyMemoryAllocator memoryAllocator;
+    ShardedMemoryAllocator allocator(CreateBuddyShards(&memoryAllocator));
+
+    // Threads which allocate one after the other are assigned different shards.
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations(kShardCount);
+    for (size_t i = 0; i < kShardCount; i++) {
+        std::thread([&]() {
+            allocations[i] =
+                allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
+        }).join();
+        ASSERT_NE(allocations[i], nullptr);
+    }
+
+    std::set<MemoryAllocator*> shardsUsed;
+    for (size_t i = 0; i < kShardCount; i++) {
+        shardsUsed.insert(allocations[i]->GetAllocator());
+    }
+    EXPECT_EQ(shardsUsed.size(), kShardCount);
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, kShardCount);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 4u * kShardCount);
+    EXPECT_EQ(memoryAllocator.QueryInfo().UsedMemoryCount, kShardCount);
+
+    // De-allocated by a thread other than the one which allocated it.
+    for (std::unique_ptr<MemoryAllocation>& allocation : allocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(memoryAllocator.QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify memory de-allocated by one shard is re-used by another.
+TEST(ShardedMemoryAllocatorTests, ShareMemory) {
+    SegmentedMemoryAllocator memoryAllocator(std::make_unique<DummyMemoryAllocator>(),
+                                             kDefaultMemoryAlignment);
+    ShardedMemoryAllocator allocator(CreateBuddyShards(&memoryAllocator));
+
+    for (size_t i = 0; i < kShardCount; i++) {
+        std::thread([&]() {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(4, kDefaultMemoryAlignment));
+            ASSERT_NE(allocation, nullptr);
+            allocator.DeallocateMemory(std::move(allocation));
+        }).join();
+    }
+
+    // Only the first shard created memory, every other re-used it from the pool.
+    EXPECT_EQ(memoryAllocator.QueryInfo().UsedMemoryCount, 0u);
+    EXPECT_EQ(memoryAllocator.QueryInfo().FreeMemoryUsage, kDefaultMemorySize);
+}
@@ -14,10 +14,13 @@
 
 #include <gtest/gtest.h>
 
+#include "gpgmm/BitmapSlabBlockAllocator.h"
 #include "gpgmm/SlabBlockAllocator.h"
 #include "gpgmm/common/Math.h"
 
+#include <chrono>
 #include <unordered_set>
+#include <vector>
 
 using namespace gpgmm;
 
@@ -143,3 +146,150 @@ TEST(SlabBlockAllocatorTests, MultipleBlocksVarious) {
     allocator.DeallocateBlock(blockC);
     allocator.DeallocateBlock(blockB);
 }
+
+// Verify a single allocation in a bitmap slab.
+TEST(BitmapSlabBlockAllocatorTests, SingleBlock) {
+    constexpr uint64_t blockSize = 32;
+    constexpr uint64_t slabSize = 128;
+    BitmapSlabBlockAllocator allocator(slabSize / blockSize, blockSize);
+
+    // Check that we cannot allocate a oversized block.
+    EXPECT_EQ(allocator.TryAllocateBlock(slabSize * 2), nullptr);
+
+    // Check that we cannot allocate a zero sized block.
+    EXPECT_EQ(allocator.TryAllocateBlock(0u), nullptr);
+
+    // Check that we cannot allocate a misaligned block.
+    EXPECT_EQ(allocator.TryAllocateBlock(blockSize, 64u), nullptr);
+
+    // Allocate the block.
+    MemoryBlock* block = allocator.TryAllocateBlock(blockSize);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->Offset, 0u);
+    EXPECT_EQ(block->Size, blockSize);
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), (slabSize / blockSize) - 1);
+
+    allocator.DeallocateBlock(block);
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), slabSize / blockSize);
+}
+
+// Verify multiple allocations fill a bitmap slab spanning more than one word and that
+// deallocated blocks are reused lowest offset first.
+TEST(BitmapSlabBlockAllocatorTests, MultipleBlocks) {
+    constexpr uint64_t blockSize = 1;
+    constexpr uint64_t blockCount = 130;
+    BitmapSlabBlockAllocator allocator(blockCount, blockSize);
+
+    std::vector<MemoryBlock*> blocks = {};
+    for (uint64_t blockIdx = 0; blockIdx < blockCount; blockIdx++) {
+        MemoryBlock* block = allocator.TryAllocateBlock(blockSize);
+        ASSERT_NE(block, nullptr);
+        EXPECT_EQ(block->Offset, blockSize * blockIdx);
+        blocks.push_back(block);
+    }
+
+    // Check that we are full.
+    EXPECT_EQ(allocator.TryAllocateBlock(blockSize), nullptr);
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), 0u);
+
+    allocator.DeallocateBlock(blocks[100]);
+    allocator.DeallocateBlock(blocks[65]);
+
+    blocks[65] = allocator.TryAllocateBlock(blockSize);
+    ASSERT_NE(blocks[65], nullptr);
+    EXPECT_EQ(blocks[65]->Offset, 65u);
+
+    blocks[100] = allocator.TryAllocateBlock(blockSize);
+    ASSERT_NE(blocks[100], nullptr);
+    EXPECT_EQ(blocks[100]->Offset, 100u);
+
+    for (MemoryBlock* block : blocks) {
+        allocator.DeallocateBlock(block);
+    }
+
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), blockCount);
+}
+
+// Verify requests larger than the block size allocate contiguous blocks.
+TEST(BitmapSlabBlockAllocatorTests, ContiguousBlocks) {
+    constexpr uint64_t blockSize = 16;
+    constexpr uint64_t blockCount = 128;
+    BitmapSlabBlockAllocator allocator(blockCount, blockSize);
+
+    // Spans blocks [0, 3).
+    MemoryBlock* blockA = allocator.TryAllocateBlock(blockSize * 2 + 1);
+    ASSERT_NE(blockA, nullptr);
+    EXPECT_EQ(blockA->Offset, 0u);
+    EXPECT_EQ(blockA->Size, blockSize * 3);
+
+    // Spans blocks [3, 67), which crosses a word boundary.
+    MemoryBlock* blockB = allocator.TryAllocateBlock(blockSize * 64);
+    ASSERT_NE(blockB, nullptr);
+    EXPECT_EQ(blockB->Offset, blockSize * 3);
+    EXPECT_EQ(blockB->Size, blockSize * 64);
+
+    // Only 61 blocks remain.
+    EXPECT_EQ(allocator.TryAllocateBlock(blockSize * 62), nullptr);
+
+    MemoryBlock* blockC = allocator.TryAllocateBlock(blockSize * 61);
+    ASSERT_NE(blockC, nullptr);
+    EXPECT_EQ(blockC->Offset, blockSize * 67);
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), 0u);
+
+    // Freeing |blockA| leaves a hole too small for four blocks.
+    allocator.DeallocateBlock(blockA);
+    EXPECT_EQ(allocator.TryAllocateBlock(blockSize * 4), nullptr);
+
+    // Freeing |blockB| merges with the hole.
+    allocator.DeallocateBlock(blockB);
+    MemoryBlock* blockD = allocator.TryAllocateBlock(blockSize * 67);
+    ASSERT_NE(blockD, nullptr);
+    EXPECT_EQ(blockD->Offset, 0u);
+
+    allocator.DeallocateBlock(blockC);
+    allocator.DeallocateBlock(blockD);
+    EXPECT_EQ(allocator.GetFreeBlockCountForTesting(), blockCount);
+}
+
+// Compare the bitmap and free-list slab block allocators using the same workload. Both must
+// hand out every block exactly once; elapsed times are recorded for comparison.
+TEST(BitmapSlabBlockAllocatorTests, CompareWithFreeList) {
+    constexpr uint64_t blockSize = 256;
+    constexpr uint64_t blockCount = 4096;
+    constexpr uint32_t iterationCount = 16;
+
+    auto runWorkload = [&](BlockAllocator* allocator) -> int64_t {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<MemoryBlock*> blocks(blockCount);
+        for (uint32_t iteration = 0; iteration < iterationCount; iteration++) {
+            for (uint64_t blockIdx = 0; blockIdx < blockCount; blockIdx++) {
+                blocks[blockIdx] = allocator->TryAllocateBlock(blockSize, 1);
+                EXPECT_NE(blocks[blockIdx], nullptr);
+            }
+
+            EXPECT_EQ(allocator->TryAllocateBlock(blockSize, 1), nullptr);
+
+            std::unordered_set<uint64_t> offsets = {};
+            for (MemoryBlock* block : blocks) {
+                EXPECT_TRUE(offsets.insert(block->Offset).second);
+            }
+
+            // Deallocate every other block first to fragment the slab.
+            for (uint64_t blockIdx = 0; blockIdx < blockCount; blockIdx += 2) {
+                allocator->DeallocateBlock(blocks[blockIdx]);
+            }
+            for (uint64_t blockIdx = 1; blockIdx < blockCount; blockIdx += 2) {
+                allocator->DeallocateBlock(blocks[blockIdx]);
+            }
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    };
+
+    SlabBlockAllocator freeListAllocator(blockCount, blockSize);
+    BitmapSlabBlockAllocator bitmapAllocator(blockCount, blockSize);
+
+    RecordProperty("FreeListElapsedUs", std::to_string(runWorkload(&freeListAllocator)));
+    RecordProperty("BitmapElapsedUs", std::to_string(runWorkload(&bitmapAllocator)));
+}
@@ -22,6 +22,7 @@
 #include "tests/DummyMemoryAllocator.h"
 
 #include <set>
+#include <thread>
 #include <vector>
 
 using namespace gpgmm;
@@ -45,10 +46,10 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
                                       kDefaultPrefetchSlab, dummyMemoryAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize * 2, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize * 2, 1));
         ASSERT_EQ(allocation, nullptr);
 
-        allocation = allocator.TryAllocateMemory(22, 1, false, false, false);
+        allocation = allocator.TryAllocateMemory(CreateBasicRequest(22, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -67,7 +68,7 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
                                       dummyMemoryAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -86,11 +87,11 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
         // Max allocation cannot be more than 1/8th the max slab size or 4 bytes.
         // Since a 10 byte allocation requires a 128 byte slab, allocation should always fail.
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(10, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(10, 1));
         ASSERT_EQ(allocation, nullptr);
 
         // Re-attempt with an allocation that is under the fragmentation limit.
-        allocation = allocator.TryAllocateMemory(14, 1, false, false, false);
+        allocation = allocator.TryAllocateMemory(CreateBasicRequest(14, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -107,7 +108,7 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
                                       dummyMemoryAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_GE(allocation->GetSize(), kBlockSize);
         EXPECT_GE(allocation->GetMemory()->GetSize(), kSlabSize);
@@ -123,7 +124,7 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
                                       dummyMemoryAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_GE(allocation->GetSize(), kBlockSize);
         EXPECT_GE(allocation->GetMemory()->GetSize(), kSlabSize);
@@ -137,9 +138,11 @@ TEST(SlabMemoryAllocatorTests, SingleSlab) {
                                       kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
                                       kDefaultPrefetchSlab, dummyMemoryAllocator.get());
 
-        EXPECT_EQ(allocator.TryAllocateMemory(kBlockSize, 1, true, false, false), nullptr);
-        EXPECT_EQ(allocator.TryAllocateMemory(kBlockSize / 2, 1, true, false, false), nullptr);
-        EXPECT_EQ(allocator.TryAllocateMemory(kBlockSize / 4, 1, true, false, false), nullptr);
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1, true)), nullptr);
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize / 2, 1, true)),
+                  nullptr);
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize / 4, 1, true)),
+                  nullptr);
     }
 }
 
@@ -157,7 +160,7 @@ TEST(SlabMemoryAllocatorTests, MultipleSlabs) {
     std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
     for (uint32_t blocki = 0; blocki < (kDefaultSlabSize * 2 / kBlockSize); blocki++) {
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(22, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(22, 1));
         ASSERT_NE(allocation, nullptr);
         allocations.push_back(std::move(allocation));
     }
@@ -185,7 +188,7 @@ TEST(SlabMemoryAllocatorTests, AllocationOverflow) {
 
     constexpr uint64_t largeBlock = (1ull << 63) + 1;
     std::unique_ptr<MemoryAllocation> invalidAllocation =
-        allocator.TryAllocateMemory(largeBlock, kDefaultSlabAlignment, true, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(largeBlock, kDefaultSlabAlignment, true));
     ASSERT_EQ(invalidAllocation, nullptr);
 }
 
@@ -211,7 +214,7 @@ TEST(SlabMemoryAllocatorTests, ReuseSlabs) {
     // Allocate |kNumOfSlabs| worth.
     while (slabMemory.size() < kNumOfSlabs) {
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetSize(), kBlockSize);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -232,6 +235,189 @@ TEST(SlabMemoryAllocatorTests, ReuseSlabs) {
     pool.ReleasePool();
 }
 
+// Verify allocating succeeds when more than one slab at the front of the free-list is full.
+TEST(SlabMemoryAllocatorTests, ReuseFullSlabs) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    constexpr uint64_t kBlocksPerSlab = kDefaultSlabSize / kBlockSize;
+    SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize, kDefaultSlabAlignment,
+                                  kDefaultSlabFragmentationLimit, kDefaultPrefetchSlab,
+                                  dummyMemoryAllocator.get());
+
+    // Fill two slabs.
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (uint64_t i = 0; i < kBlocksPerSlab * 2; i++) {
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+        ASSERT_NE(allocation, nullptr);
+        allocations.push_back(std::move(allocation));
+    }
+
+    // Free a block from the first (full) slab then fill it again, which leaves both slabs full
+    // on the free-list.
+    allocator.DeallocateMemory(std::move(allocations.front()));
+    allocations.front() = allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+    ASSERT_NE(allocations.front(), nullptr);
+
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+    ASSERT_NE(allocation, nullptr);
+    allocations.push_back(std::move(allocation));
+
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryCount, 3u);
+
+    for (auto& allocationToDeallocate : allocations) {
+        allocator.DeallocateMemory(std::move(allocationToDeallocate));
+    }
+
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify the slab size grows while allocating and shrinks once everything is de-allocated.
+TEST(SlabMemoryAllocatorTests, AdaptSlabSize) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize, kDefaultSlabAlignment,
+                                  kDefaultSlabFragmentationLimit, kDefaultPrefetchSlab,
+                                  dummyMemoryAllocator.get(), /*adaptSlabSize*/ true);
+
+    std::vector<uint64_t> slabSizes = {};
+    std::set<MemoryBase*> slabMemory = {};
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    while (slabSizes.empty() || slabSizes.back() < kMaxSlabSize) {
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+        ASSERT_NE(allocation, nullptr);
+        if (slabMemory.insert(allocation->GetMemory()).second) {
+            slabSizes.push_back(allocation->GetMemory()->GetSize());
+        }
+        allocations.push_back(std::move(allocation));
+    }
+
+    // The first slab of each size is created before the previous slab became full.
+    EXPECT_EQ(slabSizes, std::vector<uint64_t>({128, 128, 256, 256, 512}));
+
+    for (auto& allocation : allocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, 0u);
+
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetMemory()->GetSize(), kMaxSlabSize / 2);
+    allocator.DeallocateMemory(std::move(allocation));
+}
+
+// Verify empty slabs keep their memory for the next allocation, up to the max empty slab count.
+TEST(SlabMemoryAllocatorTests, KeepEmptySlabs) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    constexpr uint64_t kMaxEmptySlabCount = 1;
+    {
+        SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                      kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                      kDefaultPrefetchSlab, dummyMemoryAllocator.get(),
+                                      /*adaptSlabSize*/ false, kMaxEmptySlabCount);
+
+        // Allocating and de-allocating across a slab boundary re-uses the same slab memory.
+        for (size_t i = 0; i < 3; i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            allocator.DeallocateMemory(std::move(allocation));
+
+            EXPECT_EQ(allocator.GetEmptySlabCount(), 1u);
+            EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, kDefaultSlabSize);
+        }
+
+        EXPECT_EQ(allocator.QueryInfo().RetainedMemoryReuseCount, 2u);
+
+        // Only one of two empty slabs keeps its memory.
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+        for (size_t i = 0; i < 2 * (kDefaultSlabSize / kBlockSize); i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            allocations.push_back(std::move(allocation));
+        }
+
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.GetEmptySlabCount(), 1u);
+        EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, kDefaultSlabSize);
+
+        EXPECT_EQ(allocator.ReleaseMemory(), kDefaultSlabSize);
+        EXPECT_EQ(allocator.GetEmptySlabCount(), 0u);
+        EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, 0u);
+
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+        ASSERT_NE(allocation, nullptr);
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+
+    // Empty slab memory is released with the allocator.
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, 0u);
+}
+
+// Verify prefetching slabs in a burst deepens the prefetch and releases all slab memory.
+TEST(SlabMemoryAllocatorTests, PrefetchSlabsDepth) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    {
+        SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                      kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                      /*prefetchSlab*/ true, dummyMemoryAllocator.get());
+
+        EXPECT_EQ(allocator.GetPrefetchDepthForTesting(), 1u);
+
+        constexpr uint64_t kNumOfSlabs = 10u;
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+        for (size_t i = 0; i < kNumOfSlabs * (kDefaultSlabSize / kBlockSize); i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            allocations.push_back(std::move(allocation));
+        }
+
+        EXPECT_GT(allocator.GetPrefetchDepthForTesting(), 1u);
+        EXPECT_EQ(allocator.GetSlabSizeForTesting(), kNumOfSlabs);
+
+        // Slabs after the first few use prefetched memory, waited on or not.
+        const MEMORY_ALLOCATOR_INFO info = allocator.QueryInfo();
+        EXPECT_GT(info.PrefetchedMemoryReuseCount, 0u);
+        EXPECT_LT(info.PrefetchedMemoryReuseCount, kNumOfSlabs);
+        EXPECT_LE(info.PrefetchedMemoryWaitCount, info.PrefetchedMemoryReuseCount);
+
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.GetSlabSizeForTesting(), 0u);
+    }
+
+    // Unused prefetched slab memory is released with the allocator, or once the prefetches
+    // cancelled by it complete.
+    dummyMemoryAllocator->WaitForPendingAllocations();
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryUsage, 0u);
+}
+
 TEST(SlabMemoryAllocatorTests, QueryInfo) {
     // Test slab allocator.
     {
@@ -245,7 +431,7 @@ TEST(SlabMemoryAllocatorTests, QueryInfo) {
                                       kDefaultPrefetchSlab, dummyMemoryAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         EXPECT_NE(allocation, nullptr);
 
         // Single sub-allocation within a slab should be allocated.
@@ -279,7 +465,7 @@ TEST(SlabMemoryAllocatorTests, QueryInfo) {
                                       kDefaultPrefetchSlab, poolAllocator.get());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         EXPECT_NE(allocation, nullptr);
 
         EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 1u);
@@ -298,6 +484,99 @@ TEST(SlabMemoryAllocatorTests, QueryInfo) {
     }
 }
 
+// Verify new slab memory is no larger than the memory size limit.
+TEST(SlabMemoryAllocatorTests, MemorySizeLimit) {
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize, kDefaultSlabAlignment,
+                                  kDefaultSlabFragmentationLimit, kDefaultPrefetchSlab,
+                                  dummyMemoryAllocator.get());
+
+    // Slab is limited to two blocks.
+    MEMORY_ALLOCATION_REQUEST request = CreateBasicRequest(kBlockSize, 1);
+    request.MemorySizeLimit = kBlockSize * 2;
+
+    std::unique_ptr<MemoryAllocation> allocationInSmallSlab = allocator.TryAllocateMemory(request);
+    ASSERT_NE(allocationInSmallSlab, nullptr);
+    EXPECT_EQ(allocationInSmallSlab->GetMemory()->GetSize(), kBlockSize * 2);
+
+    // Slab is never smaller than a block.
+    request.MemorySizeLimit = 1;
+    std::unique_ptr<MemoryAllocation> allocationInBlockSlab = allocator.TryAllocateMemory(request);
+    ASSERT_NE(allocationInBlockSlab, nullptr);
+    EXPECT_EQ(allocationInBlockSlab->GetMemory()->GetSize(), kBlockSize);
+
+    // Without a limit, the slab size is used.
+    std::unique_ptr<MemoryAllocation> allocationInSlab =
+        allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+    ASSERT_NE(allocationInSlab, nullptr);
+    EXPECT_EQ(allocationInSlab->GetMemory()->GetSize(), kDefaultSlabSize);
+
+    // Slab which already has memory is used regardless of the limit.
+    std::unique_ptr<MemoryAllocation> allocationInSameSlab = allocator.TryAllocateMemory(request);
+    ASSERT_NE(allocationInSameSlab, nullptr);
+    EXPECT_EQ(allocationInSameSlab->GetMemory(), allocationInSlab->GetMemory());
+
+    EXPECT_EQ(allocator.GetSlabSizeForTesting(), 3u);
+
+    allocator.DeallocateMemory(std::move(allocationInSmallSlab));
+    allocator.DeallocateMemory(std::move(allocationInBlockSlab));
+    allocator.DeallocateMemory(std::move(allocationInSlab));
+    allocator.DeallocateMemory(std::move(allocationInSameSlab));
+
+    EXPECT_EQ(allocator.GetSlabSizeForTesting(), 0u);
+}
+
+// Verify blocks de-allocated by other threads, while allocating, are all returned.
+TEST(SlabMemoryAllocatorTests, DeallocateFromMultipleThreads) {
+    constexpr uint64_t kThreadCount = 8;
+    constexpr uint64_t kAllocationCount = 64;
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+
+    SlabMemoryAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                  kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                  kDefaultPrefetchSlab, dummyMemoryAllocator.get());
+
+    std::vector<std::vector<std::unique_ptr<MemoryAllocation>>> allocationsPerThread(kThreadCount);
+    for (auto& allocations : allocationsPerThread) {
+        for (uint64_t i = 0; i < kAllocationCount; i++) {
+            std::unique_ptr<MemoryAllocation> allocation =
+                allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+            ASSERT_NE(allocation, nullptr);
+            allocations.push_back(std::move(allocation));
+        }
+    }
+
+    std::vector<std::thread> threads(kThreadCount);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); threadIdx++) {
+        threads[threadIdx] = std::thread([&, threadIdx]() {
+            for (auto& allocation : allocationsPerThread[threadIdx]) {
+                allocator.DeallocateMemory(std::move(allocation));
+                allocator.DeallocateMemory(
+                    allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1)));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // De-allocations left pending by a contended lock are drained upon release.
+    allocator.ReleaseMemory();
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 0u);
+    EXPECT_EQ(dummyMemoryAllocator->QueryInfo().UsedMemoryCount, 0u);
+}
+
 TEST(SlabCacheAllocatorTests, SingleSlabMultipleSize) {
     constexpr uint64_t kMinBlockSize = 4;
     constexpr uint64_t kMaxSlabSize = 256;
@@ -308,8 +587,9 @@ TEST(SlabCacheAllocatorTests, SingleSlabMultipleSize) {
 
     // Verify requesting an allocation without memory will not return a valid allocation.
     {
-        EXPECT_EQ(allocator.TryAllocateMemory(kMinBlockSize, 1, true, false, false), nullptr);
-        EXPECT_EQ(allocator.TryAllocateMemory(kMinBlockSize * 2, 1, true, false, false), nullptr);
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kMinBlockSize, 1, true)), nullptr);
+        EXPECT_EQ(allocator.TryAllocateMemory(CreateBasicRequest(kMinBlockSize * 2, 1, true)),
+                  nullptr);
     }
 }
 
@@ -322,22 +602,22 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsSameSize) {
                                  std::make_unique<DummyMemoryAllocator>());
 
     std::unique_ptr<MemoryAllocation> firstAllocation =
-        allocator.TryAllocateMemory(22, 1, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(22, 1));
     ASSERT_NE(firstAllocation, nullptr);
 
     std::unique_ptr<MemoryAllocation> secondAllocation =
-        allocator.TryAllocateMemory(22, 1, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(22, 1));
     ASSERT_NE(secondAllocation, nullptr);
 
     allocator.DeallocateMemory(std::move(firstAllocation));
     allocator.DeallocateMemory(std::move(secondAllocation));
 
     std::unique_ptr<MemoryAllocation> thirdAllocation =
-        allocator.TryAllocateMemory(44, 1, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(44, 1));
     ASSERT_NE(thirdAllocation, nullptr);
 
     std::unique_ptr<MemoryAllocation> fourthAllocation =
-        allocator.TryAllocateMemory(44, 1, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(44, 1));
     ASSERT_NE(fourthAllocation, nullptr);
 
     allocator.DeallocateMemory(std::move(thirdAllocation));
@@ -354,7 +634,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsVariableSizes) {
     {
         constexpr uint64_t allocationSize = 22;
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(allocationSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -365,7 +645,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsVariableSizes) {
     {
         constexpr uint64_t allocationSize = 44;
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(allocationSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -376,7 +656,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsVariableSizes) {
     {
         constexpr uint64_t allocationSize = 88;
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(allocationSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
         ASSERT_NE(allocation, nullptr);
         EXPECT_EQ(allocation->GetOffset(), 0u);
         EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -388,6 +668,40 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsVariableSizes) {
     EXPECT_EQ(allocator.GetSlabCacheSizeForTesting(), 0u);
 }
 
+// Verify block sizes too large to be indexed by size class are still cached.
+TEST(SlabCacheAllocatorTests, SizeClassOutliers) {
+    constexpr uint64_t kMinBlockSize = 1;
+    constexpr uint64_t kMaxSlabSize = 1 << 20;
+    constexpr uint64_t kSlabSize = 0;  // deduce slab size from allocation size.
+    SlabCacheAllocator allocator(kMinBlockSize, kMaxSlabSize, kSlabSize, kDefaultSlabAlignment,
+                                 kDefaultSlabFragmentationLimit, kDefaultPrefetchSlab,
+                                 std::make_unique<DummyMemoryAllocator>());
+
+    // Largest indexed size is 256 * 256 size classes of the min. block size.
+    constexpr uint64_t kLastIndexedSize = 256 * 256 * kMinBlockSize;
+
+    for (bool cacheSize : {false, true}) {
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations;
+        for (uint64_t allocationSize : {kMinBlockSize, kLastIndexedSize, kLastIndexedSize + 1}) {
+            std::unique_ptr<MemoryAllocation> allocation = allocator.TryAllocateMemory(
+                CreateBasicRequest(allocationSize, 1, false, cacheSize));
+            ASSERT_NE(allocation, nullptr);
+            EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
+            EXPECT_GE(allocation->GetSize(), allocationSize);
+            allocations.push_back(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.GetSlabCacheSizeForTesting(), 3u);
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 3u);
+
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+    }
+}
+
 TEST(SlabCacheAllocatorTests, SingleSlabInBuddy) {
     // 1. Create a buddy allocator as the back-end allocator.
     // 2. Create a slab allocator as the front-end allocator.
@@ -402,7 +716,7 @@ TEST(SlabCacheAllocatorTests, SingleSlabInBuddy) {
                                      std::make_unique<DummyMemoryAllocator>()));
 
     std::unique_ptr<MemoryAllocation> allocation =
-        allocator.TryAllocateMemory(kMinBlockSize, 1, false, false, false);
+        allocator.TryAllocateMemory(CreateBasicRequest(kMinBlockSize, 1));
     ASSERT_NE(allocation, nullptr);
     EXPECT_EQ(allocation->GetOffset(), 0u);
     EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -428,7 +742,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsInBuddy) {
     {
         constexpr uint64_t allocationSize = kMinBlockSize * 2;
         std::unique_ptr<MemoryAllocation> firstAllocation =
-            allocator.TryAllocateMemory(allocationSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
         ASSERT_NE(firstAllocation, nullptr);
         EXPECT_EQ(firstAllocation->GetOffset(), 0u);
         EXPECT_EQ(firstAllocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -437,7 +751,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsInBuddy) {
         EXPECT_EQ(firstAllocation->GetMemory()->GetSize(), kDefaultSlabSize);
 
         std::unique_ptr<MemoryAllocation> secondAllocation =
-            allocator.TryAllocateMemory(allocationSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(allocationSize, 1));
         ASSERT_NE(secondAllocation, nullptr);
         EXPECT_EQ(secondAllocation->GetOffset(), allocationSize);
         EXPECT_EQ(secondAllocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -455,7 +769,7 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsInBuddy) {
         std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
         for (uint32_t i = 0; i < kDefaultSlabSize / kSlabSize; i++) {
             std::unique_ptr<MemoryAllocation> allocation =
-                allocator.TryAllocateMemory(kSlabSize, 1, false, false, false);
+                allocator.TryAllocateMemory(CreateBasicRequest(kSlabSize, 1));
             ASSERT_NE(allocation, nullptr);
             EXPECT_EQ(allocation->GetOffset(), i * kSlabSize);
             EXPECT_EQ(allocation->GetMethod(), AllocationMethod::kSubAllocated);
@@ -465,14 +779,14 @@ TEST(SlabCacheAllocatorTests, MultipleSlabsInBuddy) {
 
         // Next slab-buddy sub-allocation must be in the second buddy.
         std::unique_ptr<MemoryAllocation> firstSlabInSecondBuddy =
-            allocator.TryAllocateMemory(kSlabSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kSlabSize, 1));
         ASSERT_NE(firstSlabInSecondBuddy, nullptr);
         EXPECT_EQ(firstSlabInSecondBuddy->GetOffset(), 0u);
         EXPECT_EQ(firstSlabInSecondBuddy->GetMethod(), AllocationMethod::kSubAllocated);
         EXPECT_GE(firstSlabInSecondBuddy->GetSize(), kSlabSize);
 
         std::unique_ptr<MemoryAllocation> secondSlabInSecondBuddy =
-            allocator.TryAllocateMemory(kSlabSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kSlabSize, 1));
         ASSERT_NE(secondSlabInSecondBuddy, nullptr);
         EXPECT_EQ(secondSlabInSecondBuddy->GetOffset(), kSlabSize);
         EXPECT_EQ(secondSlabInSecondBuddy->GetMethod(), AllocationMethod::kSubAllocated);
@@ -501,7 +815,7 @@ TEST(SlabCacheAllocatorTests, QueryInfo) {
                                      std::make_unique<DummyMemoryAllocator>());
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         EXPECT_NE(allocation, nullptr);
 
         // Single sub-allocation within a slab should be allocated.
@@ -534,7 +848,7 @@ TEST(SlabCacheAllocatorTests, QueryInfo) {
                                          std::make_unique<DummyMemoryAllocator>(), &pool));
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
         EXPECT_NE(allocation, nullptr);
 
         // Single sub-allocation within a slab should be used.
@@ -567,7 +881,7 @@ TEST(SlabCacheAllocatorTests, QueryInfo) {
                                          std::make_unique<DummyMemoryAllocator>()));
 
         std::unique_ptr<MemoryAllocation> allocation =
-            allocator.TryAllocateMemory(kMinBlockSize, 1, false, false, false);
+            allocator.TryAllocateMemory(CreateBasicRequest(kMinBlockSize, 1));
         EXPECT_NE(allocation, nullptr);
 
         // Single slab block within buddy memory should be used.
@@ -586,9 +900,66 @@ TEST(SlabCacheAllocatorTests, QueryInfo) {
         EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
         EXPECT_EQ(allocator.QueryInfo().FreeMemoryUsage, 0u);
     }
+
+    // Test Slab allocator with multiple block sizes.
+    {
+        constexpr uint64_t kMinBlockSize = 4;
+        constexpr uint64_t kMaxSlabSize = 512;
+        SlabCacheAllocator allocator(kMinBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                     kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                     kDefaultPrefetchSlab,
+                                     std::make_unique<DummyMemoryAllocator>());
+
+        std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+        uint64_t totalBlockUsage = 0;
+        for (uint64_t blockSize = kMinBlockSize; blockSize <= kDefaultSlabSize; blockSize *= 2) {
+            allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(blockSize, 1)));
+            EXPECT_NE(allocations.back(), nullptr);
+            totalBlockUsage += blockSize;
+        }
+
+        // Blocks of every size should be counted.
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, allocations.size());
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, totalBlockUsage);
+
+        for (auto& allocation : allocations) {
+            allocator.DeallocateMemory(std::move(allocation));
+        }
+
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockUsage, 0u);
+    }
 }
 
 // Pre-fetch |kNumOfSlabs| slabs worth of sub-allocations of various sizes.
+// Verify the slab allocator of an empty size class is kept while it keeps empty slabs.
+TEST(SlabCacheAllocatorTests, KeepEmptySlabs) {
+    constexpr uint64_t kMinBlockSize = 4;
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    SlabCacheAllocator allocator(kMinBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                 kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                 kDefaultPrefetchSlab, std::make_unique<DummyMemoryAllocator>(),
+                                 /*adaptSlabSize*/ false, /*maxEmptySlabCount*/ 1);
+
+    for (size_t i = 0; i < 3; i++) {
+        std::unique_ptr<MemoryAllocation> allocation =
+            allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1));
+        ASSERT_NE(allocation, nullptr);
+        allocator.DeallocateMemory(std::move(allocation));
+
+        EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+        EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, kDefaultSlabSize);
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().RetainedMemoryReuseCount, 2u);
+    EXPECT_GT(allocator.QueryFragmentationInfo().PooledMemoryUsage, 0u);
+
+    allocator.ReleaseMemory();
+    EXPECT_EQ(allocator.QueryInfo().UsedMemoryUsage, 0u);
+    EXPECT_EQ(allocator.GetSlabCacheSizeForTesting(), 0u);
+}
+
 TEST(SlabCacheAllocatorTests, PrefetchSlabs) {
     constexpr uint64_t kBlockSize = 32;
     constexpr uint64_t kMinBlockSize = 4;
@@ -601,12 +972,134 @@ TEST(SlabCacheAllocatorTests, PrefetchSlabs) {
     constexpr uint64_t kNumOfSlabs = 10u;
     std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
     for (size_t i = 0; i < kNumOfSlabs * (kDefaultSlabSize / kBlockSize); i++) {
-        allocations.push_back(allocator.TryAllocateMemory(kBlockSize, 1, false, false, false));
-        allocations.push_back(allocator.TryAllocateMemory(kBlockSize * 2, 1, false, false, false));
-        allocations.push_back(allocator.TryAllocateMemory(kBlockSize * 3, 1, false, false, false));
+        allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1)));
+        allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize * 2, 1)));
+        allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize * 3, 1)));
     }
 
     for (auto& allocation : allocations) {
         allocator.DeallocateMemory(std::move(allocation));
     }
 }
+
+// Verify a repeated sequence of sizes gets predicted, and slabs prefetched for the next size.
+TEST(SlabCacheAllocatorTests, PrefetchPredictedSlabs) {
+    constexpr uint64_t kMinBlockSize = 4;
+    constexpr uint64_t kMaxSlabSize = 512;
+
+    SlabCacheAllocator allocator(kMinBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                 kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                 kDefaultPrefetchSlab, std::make_unique<DummyMemoryAllocator>(),
+                                 /*adaptSlabSize*/ false, /*maxEmptySlabCount*/ 0,
+                                 /*predictSlab*/ true);
+
+    // Every block fills a slab of its own, so each allocation needs new slab memory.
+    constexpr uint64_t kNumOfSequences = 10u;
+    const std::vector<uint64_t> sequence = {kDefaultSlabSize, kDefaultSlabSize * 4,
+                                            kDefaultSlabSize * 2};
+
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (size_t i = 0; i < kNumOfSequences; i++) {
+        for (uint64_t size : sequence) {
+            allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(size, 1)));
+            ASSERT_NE(allocations.back(), nullptr);
+        }
+    }
+
+    // Each transition must be seen twice before it gets predicted, so the first prediction is
+    // made by the first allocation of the third sequence.
+    const MEMORY_ALLOCATOR_INFO info = allocator.QueryInfo();
+    EXPECT_EQ(info.PredictedSizeHitCount, (kNumOfSequences - 2) * sequence.size() - 1);
+    EXPECT_EQ(info.PredictedSizeMissCount, 0u);
+    EXPECT_GT(info.PrefetchedMemoryReuseCount, 0u);
+
+    for (auto& allocation : allocations) {
+        allocator.DeallocateMemory(std::move(allocation));
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+}
+
+// Verify allocations relocate from sparse slabs to denser ones so the sparse slab can be released.
+TEST(SlabCacheAllocatorTests, RelocateMemory) {
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+
+    std::unique_ptr<DummyMemoryAllocator> dummyMemoryAllocator =
+        std::make_unique<DummyMemoryAllocator>();
+    DummyMemoryAllocator* dummyMemoryAllocatorPtr = dummyMemoryAllocator.get();
+
+    SlabCacheAllocator allocator(kBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                 kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                 kDefaultPrefetchSlab, std::move(dummyMemoryAllocator));
+
+    // Fill two slabs.
+    constexpr uint64_t kBlocksPerSlab = kDefaultSlabSize / kBlockSize;
+    std::vector<std::unique_ptr<MemoryAllocation>> allocations = {};
+    for (size_t i = 0; i < kBlocksPerSlab * 2; i++) {
+        allocations.push_back(allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize, 1)));
+        ASSERT_NE(allocations.back(), nullptr);
+    }
+
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 2u);
+
+    // First slab is 75% used and the second slab is 25% used.
+    allocator.DeallocateMemory(std::move(allocations[0]));
+    for (size_t i = kBlocksPerSlab + 1; i < kBlocksPerSlab * 2; i++) {
+        allocator.DeallocateMemory(std::move(allocations[i]));
+    }
+
+    // Not sparse enough.
+    EXPECT_EQ(allocator.TryRelocateMemory(*allocations[kBlocksPerSlab], 1, 0.1), nullptr);
+
+    std::unique_ptr<MemoryAllocation> relocatedAllocation =
+        allocator.TryRelocateMemory(*allocations[kBlocksPerSlab], 1, 0.5);
+    ASSERT_NE(relocatedAllocation, nullptr);
+    EXPECT_EQ(relocatedAllocation->GetMemory(), allocations[1]->GetMemory());
+    EXPECT_EQ(relocatedAllocation->GetSize(), kBlockSize);
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, kBlocksPerSlab + 1);
+
+    // Second slab is released once the relocated allocation is.
+    allocator.DeallocateMemory(std::move(allocations[kBlocksPerSlab]));
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 1u);
+
+    // No other slab is used more than the first (and now full) slab.
+    EXPECT_EQ(allocator.TryRelocateMemory(*allocations[1], 1, 1.0), nullptr);
+
+    allocator.DeallocateMemory(std::move(relocatedAllocation));
+    for (size_t i = 1; i < kBlocksPerSlab; i++) {
+        allocator.DeallocateMemory(std::move(allocations[i]));
+    }
+
+    EXPECT_EQ(allocator.QueryInfo().UsedBlockCount, 0u);
+    EXPECT_EQ(dummyMemoryAllocatorPtr->QueryInfo().UsedMemoryCount, 0u);
+}
+
+// Verify blocks rounded-up to the size class are wasted and the remaining blocks of the slab are
+// free.
+TEST(SlabCacheAllocatorTests, QueryFragmentation) {
+    constexpr uint64_t kMinBlockSize = 4;
+    constexpr uint64_t kBlockSize = 32;
+    constexpr uint64_t kMaxSlabSize = 512;
+    SlabCacheAllocator allocator(kMinBlockSize, kMaxSlabSize, kDefaultSlabSize,
+                                 kDefaultSlabAlignment, kDefaultSlabFragmentationLimit,
+                                 kDefaultPrefetchSlab, std::make_unique<DummyMemoryAllocator>());
+
+    std::unique_ptr<MemoryAllocation> allocation =
+        allocator.TryAllocateMemory(CreateBasicRequest(kBlockSize - 2, 1));
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(allocation->GetSize(), kBlockSize);
+
+    const MEMORY_ALLOCATOR_FRAGMENTATION_INFO& info = allocator.QueryFragmentationInfo();
+    EXPECT_EQ(info.InternalFragmentationUsage, 2u);
+    EXPECT_EQ(info.FreeBlockUsage, kDefaultSlabSize - kBlockSize);
+    EXPECT_EQ(info.LargestFreeBlockSize, kBlockSize);
+    EXPECT_DOUBLE_EQ(info.GetExternalFragmentation(),
+                     1.0 - kBlockSize / static_cast<double>(kDefaultSlabSize - kBlockSize));
+    EXPECT_EQ(info.PooledMemoryUsage, 0u);
+
+    allocator.DeallocateMemory(std::move(allocation));
+
+    EXPECT_EQ(allocator.QueryFragmentationInfo().InternalFragmentationUsage, 0u);
+    EXPECT_EQ(allocator.QueryFragmentationInfo().FreeBlockUsage, 0u);
+}
@@ -0,0 +1,259 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/TLSFBlockAllocator.h"
+
+#include <vector>
+
+using namespace gpgmm;
+
+// Verify a single block which is an entire root.
+TEST(TLSFBlockAllocatorTests, SingleBlock) {
+    constexpr uint64_t maxBlockSize = 32;
+    TLSFBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    // Check that we cannot allocate a oversized block.
+    ASSERT_EQ(allocator.TryAllocateBlock(maxBlockSize * 2, 1), nullptr);
+
+    // Check that we cannot allocate a zero sized block.
+    ASSERT_EQ(allocator.TryAllocateBlock(0u, 1), nullptr);
+
+    MemoryBlock* block = allocator.TryAllocateBlock(maxBlockSize, 1);
+    ASSERT_NE(block, nullptr);
+    ASSERT_EQ(block->Offset, 0u);
+    ASSERT_EQ(block->Size, maxBlockSize);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 1u);
+
+    // Check that we are full.
+    ASSERT_EQ(allocator.TryAllocateBlock(maxBlockSize, 1), nullptr);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+
+    // Entirely free roots are removed.
+    allocator.DeallocateBlock(block);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify blocks are split to fit and merged with free neighbors once deallocated.
+TEST(TLSFBlockAllocatorTests, SplitAndMergeBlocks) {
+    // After allocating a 24 byte and 8 byte block:
+    //
+    //    ------------------------------------------
+    //    |    A1 (24)    | A2 (8) |    F (32)     |      A - allocated
+    //    ------------------------------------------      F - free
+    //
+    constexpr uint64_t maxBlockSize = 64;
+    TLSFBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    MemoryBlock* block1 = allocator.TryAllocateBlock(24, 1);
+    ASSERT_NE(block1, nullptr);
+    ASSERT_EQ(block1->Offset, 0u);
+    ASSERT_EQ(block1->Size, 24u);
+
+    MemoryBlock* block2 = allocator.TryAllocateBlock(8, 1);
+    ASSERT_NE(block2, nullptr);
+    ASSERT_EQ(block2->Offset, 24u);
+    ASSERT_EQ(block2->Size, 8u);
+
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+
+    // A2 keeps A1 from merging with F.
+    allocator.DeallocateBlock(block1);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+
+    // A2 merges with both neighbors, which frees the root.
+    allocator.DeallocateBlock(block2);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify blocks are only rounded up to the minimum block size.
+TEST(TLSFBlockAllocatorTests, MinBlockSize) {
+    constexpr uint64_t maxBlockSize = 64;
+    constexpr uint64_t minBlockSize = 4;
+    TLSFBlockAllocator allocator(maxBlockSize, maxBlockSize, minBlockSize);
+
+    MemoryBlock* block1 = allocator.TryAllocateBlock(12, 1);
+    ASSERT_NE(block1, nullptr);
+    ASSERT_EQ(block1->Offset, 0u);
+    ASSERT_EQ(block1->Size, 12u);
+
+    MemoryBlock* block2 = allocator.TryAllocateBlock(10, 1);
+    ASSERT_NE(block2, nullptr);
+    ASSERT_EQ(block2->Offset, 12u);
+    ASSERT_EQ(block2->Size, 12u);
+
+    allocator.DeallocateBlock(block1);
+    allocator.DeallocateBlock(block2);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify aligned blocks leave the unaligned front of the free block free.
+TEST(TLSFBlockAllocatorTests, VariousAlignment) {
+    // After allocating a 16 byte block then a 16 byte block aligned to 64 bytes:
+    //
+    //    -----------------------------------------------------
+    //    | A1 (16) |   F (48)   | A2 (16) |      F (176)     |
+    //    -----------------------------------------------------
+    //
+    constexpr uint64_t maxBlockSize = 256;
+    constexpr uint64_t minBlockSize = 16;
+    TLSFBlockAllocator allocator(maxBlockSize, maxBlockSize, minBlockSize);
+
+    MemoryBlock* block1 = allocator.TryAllocateBlock(16, 1);
+    ASSERT_NE(block1, nullptr);
+    ASSERT_EQ(block1->Offset, 0u);
+
+    MemoryBlock* block2 = allocator.TryAllocateBlock(16, 64);
+    ASSERT_NE(block2, nullptr);
+    ASSERT_EQ(block2->Offset, 64u);
+
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+
+    // The 48 byte hole fits exactly, so it is used before the larger free block.
+    MemoryBlock* block3 = allocator.TryAllocateBlock(48, 16);
+    ASSERT_NE(block3, nullptr);
+    ASSERT_EQ(block3->Offset, 16u);
+
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+
+    // Alignment cannot exceed the root block size.
+    ASSERT_EQ(allocator.TryAllocateBlock(16, maxBlockSize * 2), nullptr);
+
+    allocator.DeallocateBlock(block1);
+    allocator.DeallocateBlock(block2);
+    allocator.DeallocateBlock(block3);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify roots are added on-demand and removed roots are re-used lowest offset first.
+TEST(TLSFBlockAllocatorTests, MultipleRoots) {
+    constexpr uint64_t maxBlockSize = 256;
+    constexpr uint64_t rootBlockSize = 64;
+    TLSFBlockAllocator allocator(maxBlockSize, rootBlockSize, /*minBlockSize*/ 1);
+
+    std::vector<MemoryBlock*> blocks;
+    for (uint64_t i = 0; i < maxBlockSize / rootBlockSize; i++) {
+        MemoryBlock* block = allocator.TryAllocateBlock(48, 1);
+        ASSERT_NE(block, nullptr);
+        ASSERT_EQ(block->Offset, i * rootBlockSize);
+        blocks.push_back(block);
+    }
+
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 4u);
+
+    // Blocks never cross roots, even when the free blocks within them would fit.
+    ASSERT_EQ(allocator.TryAllocateBlock(32, 1), nullptr);
+
+    allocator.DeallocateBlock(blocks[2]);
+    allocator.DeallocateBlock(blocks[1]);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 2u);
+
+    blocks[1] = allocator.TryAllocateBlock(64, 1);
+    ASSERT_NE(blocks[1], nullptr);
+    ASSERT_EQ(blocks[1]->Offset, rootBlockSize);
+
+    blocks[2] = allocator.TryAllocateBlock(64, 1);
+    ASSERT_NE(blocks[2], nullptr);
+    ASSERT_EQ(blocks[2]->Offset, rootBlockSize * 2);
+
+    for (MemoryBlock* block : blocks) {
+        allocator.DeallocateBlock(block);
+    }
+
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify many blocks of varying sizes always merge back into empty roots.
+TEST(TLSFBlockAllocatorTests, MergeAll) {
+    constexpr uint64_t maxBlockSize = 1 << 24;
+    constexpr uint64_t rootBlockSize = 1 << 16;
+    constexpr uint64_t minBlockSize = 16;
+    TLSFBlockAllocator allocator(maxBlockSize, rootBlockSize, minBlockSize);
+
+    std::vector<MemoryBlock*> blocks;
+    for (uint64_t i = 1; i <= 512; i++) {
+        const uint64_t alignment = uint64_t(1) << (i % 8);
+        MemoryBlock* block = allocator.TryAllocateBlock((i * 97) % 4096 + 1, alignment);
+        ASSERT_NE(block, nullptr);
+        ASSERT_EQ(block->Offset % alignment, 0u);
+        ASSERT_EQ(block->Offset / rootBlockSize, (block->Offset + block->Size - 1) / rootBlockSize);
+        blocks.push_back(block);
+    }
+
+    // Deallocate every other block first so the rest merge with neighbors on both sides.
+    for (size_t i = 0; i < blocks.size(); i += 2) {
+        allocator.DeallocateBlock(blocks[i]);
+    }
+
+    for (size_t i = 1; i < blocks.size(); i += 2) {
+        allocator.DeallocateBlock(blocks[i]);
+    }
+
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
+
+// Verify a block grows in place into the free block which follows it.
+TEST(TLSFBlockAllocatorTests, ExtendBlock) {
+    // After allocating two 8 byte blocks then de-allocating the second:
+    //
+    //    -----------------------------------------
+    //    | A1 (8) | F (8)  |   A3 (16)  | F (32) |       A - allocated
+    //    -----------------------------------------       F - free
+    //
+    constexpr uint64_t maxBlockSize = 64;
+    TLSFBlockAllocator allocator(maxBlockSize, maxBlockSize, /*minBlockSize*/ 1);
+
+    MemoryBlock* block1 = allocator.TryAllocateBlock(8, 1);
+    MemoryBlock* block2 = allocator.TryAllocateBlock(8, 1);
+    MemoryBlock* block3 = allocator.TryAllocateBlock(16, 1);
+    ASSERT_NE(block3, nullptr);
+    allocator.DeallocateBlock(block2);
+
+    // Blocks already large enough are unchanged.
+    ASSERT_EQ(allocator.TryExtendBlock(block1, 8), block1);
+    ASSERT_EQ(block1->Size, 8u);
+
+    // The free block which follows is too small.
+    ASSERT_EQ(allocator.TryExtendBlock(block1, 24), nullptr);
+    ASSERT_EQ(block1->Size, 8u);
+
+    // Only part of the free block is taken, the rest remains free.
+    ASSERT_EQ(allocator.TryExtendBlock(block1, 12), block1);
+    ASSERT_EQ(block1->Offset, 0u);
+    ASSERT_EQ(block1->Size, 12u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 2u);
+
+    ASSERT_EQ(allocator.TryExtendBlock(block1, 16), block1);
+    ASSERT_EQ(block1->Size, 16u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 1u);
+
+    // The next block is allocated.
+    ASSERT_EQ(allocator.TryExtendBlock(block1, 17), nullptr);
+
+    // The last block takes the rest of the root.
+    ASSERT_EQ(allocator.TryExtendBlock(block3, 48), block3);
+    ASSERT_EQ(block3->Size, 48u);
+    ASSERT_EQ(allocator.ComputeTotalNumOfFreeBlocksForTesting(), 0u);
+
+    // Blocks never cross roots.
+    ASSERT_EQ(allocator.TryExtendBlock(block3, maxBlockSize * 2), nullptr);
+
+    allocator.DeallocateBlock(block1);
+    allocator.DeallocateBlock(block3);
+    ASSERT_EQ(allocator.GetRootCountForTesting(), 0u);
+}
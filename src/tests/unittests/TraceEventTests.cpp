@@ -0,0 +1,62 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/TraceEvent.h"
+#include "gpgmm/common/JSONEncoder.h"
+
+using namespace gpgmm;
+
+namespace {
+
+    struct TestArgs {
+        uint64_t Size;
+        bool IsPooled;
+    };
+
+    void SerializeTestArgs(JSONWriter* writer, const TestArgs& args) {
+        writer->AddItem("Size", args.Size);
+        writer->AddItem("IsPooled", args.IsPooled);
+    }
+
+}  // namespace
+
+TEST(TraceEventTests, DeferredArgsEmpty) {
+    EXPECT_TRUE(TraceEventDeferredArgs().IsEmpty());
+}
+
+// Verify deferred args serialize the same as args encoded when recorded.
+TEST(TraceEventTests, DeferredArgsSerialize) {
+    TestArgs args = {};
+    args.Size = 64;
+    args.IsPooled = true;
+
+    const TraceEventDeferredArgs deferredArgs =
+        TraceEventDeferredArgs::Create<TestArgs, SerializeTestArgs>(args);
+    ASSERT_FALSE(deferredArgs.IsEmpty());
+
+    // Changing the args after they were deferred does not change what is serialized.
+    args.Size = 128;
+
+    JSONWriter writer;
+    writer.BeginDict();
+    deferredArgs.Serialize(&writer);
+    writer.EndDict();
+
+    JSONDict expected;
+    expected.AddItem("Size", 64u);
+    expected.AddItem("IsPooled", true);
+    EXPECT_EQ(writer.GetBuffer(), expected.ToString());
+}
@@ -0,0 +1,193 @@
+// Copyright 2022 The GPGMM Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "gpgmm/WorkerThread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace gpgmm;
+
+class CountingCallback : public VoidCallback {
+  public:
+    CountingCallback(std::atomic<uint32_t>* count) : mCount(count) {
+    }
+
+    void operator()() override {
+        (*mCount)++;
+    }
+
+  private:
+    std::atomic<uint32_t>* const mCount;
+};
+
+// Blocks the worker running it until Release is called.
+class BlockingCallback : public VoidCallback {
+  public:
+    void operator()() override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mIsReleased; });
+    }
+
+    void Release() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsReleased = true;
+        }
+        mCondition.notify_all();
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mIsReleased = false;
+};
+
+class RecordingCallback : public VoidCallback {
+  public:
+    RecordingCallback(std::vector<TaskClass>* order, TaskClass taskClass)
+        : mOrder(order), mTaskClass(taskClass) {
+    }
+
+    void operator()() override {
+        mOrder->push_back(mTaskClass);
+    }
+
+  private:
+    std::vector<TaskClass>* const mOrder;
+    const TaskClass mTaskClass;
+};
+
+// Runs each task scheduled on its own thread.
+class ThreadedTaskScheduler : public TaskScheduler {
+  public:
+    ~ThreadedTaskScheduler() override {
+        for (std::thread& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    void ScheduleTask(std::shared_ptr<VoidCallback> task, TaskClass taskClass) override {
+        mScheduledTaskCount++;
+        mThreads.emplace_back([task]() { (*task)(); });
+    }
+
+    uint32_t GetScheduledTaskCount() const {
+        return mScheduledTaskCount;
+    }
+
+  private:
+    std::vector<std::thread> mThreads;
+    uint32_t mScheduledTaskCount = 0;
+};
+
+// Verify every posted task runs and signals its event.
+TEST(WorkerThreadTests, PostTask) {
+    std::shared_ptr<ThreadPool> pool = ThreadPool::Create(/*maxWorkerCount*/ 2);
+
+    std::atomic<uint32_t> count = {0};
+    std::vector<std::shared_ptr<Event>> events = {};
+    for (uint32_t i = 0; i < 100; i++) {
+        events.push_back(ThreadPool::PostTask(pool, std::make_shared<CountingCallback>(&count)));
+    }
+
+    for (auto& event : events) {
+        event->Wait();
+        EXPECT_TRUE(event->IsSignaled());
+    }
+
+    EXPECT_EQ(count, 100u);
+}
+
+// Verify destroying the pool runs tasks which were still queued.
+TEST(WorkerThreadTests, Shutdown) {
+    std::shared_ptr<ThreadPool> pool = ThreadPool::Create(/*maxWorkerCount*/ 1);
+
+    std::atomic<uint32_t> count = {0};
+    std::vector<std::shared_ptr<Event>> events = {};
+    for (uint32_t i = 0; i < 100; i++) {
+        events.push_back(ThreadPool::PostTask(pool, std::make_shared<CountingCallback>(&count)));
+    }
+
+    pool = nullptr;
+
+    EXPECT_EQ(count, 100u);
+    for (auto& event : events) {
+        EXPECT_TRUE(event->IsSignaled());
+    }
+}
+
+// Verify queued tasks run by the most urgent task class first.
+TEST(WorkerThreadTests, PostTaskByClass) {
+    std::shared_ptr<ThreadPool> pool = ThreadPool::Create(/*maxWorkerCount*/ 1);
+
+    // Keeps the only worker busy so the tasks below stay queued.
+    std::shared_ptr<BlockingCallback> blocking = std::make_shared<BlockingCallback>();
+    std::shared_ptr<Event> blockingEvent = ThreadPool::PostTask(pool, blocking);
+
+    std::vector<TaskClass> order = {};
+    const std::vector<TaskClass> taskClasses = {TaskClass::kRelease, TaskClass::kPrefetch,
+                                                TaskClass::kRequested, TaskClass::kEviction,
+                                                TaskClass::kRelease, TaskClass::kRequested};
+
+    std::vector<std::shared_ptr<Event>> events = {};
+    for (TaskClass taskClass : taskClasses) {
+        events.push_back(ThreadPool::PostTask(
+            pool, std::make_shared<RecordingCallback>(&order, taskClass), taskClass));
+    }
+
+    blocking->Release();
+    for (auto& event : events) {
+        event->Wait();
+    }
+
+    const std::vector<TaskClass> expectedOrder = {TaskClass::kRequested, TaskClass::kRequested,
+                                                  TaskClass::kEviction,  TaskClass::kPrefetch,
+                                                  TaskClass::kRelease,   TaskClass::kRelease};
+    EXPECT_EQ(order, expectedOrder);
+}
+
+// Verify tasks run on the scheduler of the host when one is specified.
+TEST(WorkerThreadTests, PostTaskWithScheduler) {
+    ThreadedTaskScheduler scheduler;
+
+    WORKER_THREAD_DESC desc = {};
+    desc.Scheduler = &scheduler;
+    SetWorkerThreadDesc(desc);
+
+    std::shared_ptr<ThreadPool> pool = ThreadPool::Create();
+    SetWorkerThreadDesc({});
+
+    std::atomic<uint32_t> count = {0};
+    std::vector<std::shared_ptr<Event>> events = {};
+    for (uint32_t i = 0; i < 10; i++) {
+        events.push_back(ThreadPool::PostTask(pool, std::make_shared<CountingCallback>(&count),
+                                              TaskClass::kRelease));
+    }
+
+    for (auto& event : events) {
+        event->Wait();
+        EXPECT_TRUE(event->IsSignaled());
+    }
+
+    EXPECT_EQ(count, 10u);
+    EXPECT_EQ(scheduler.GetScheduledTaskCount(), 10u);
+
+    pool = nullptr;
+}